@@ -0,0 +1,989 @@
+#include "stdafx.h"
+#include "Culling/BVH.h"
+
+#include "Culling/SIMDLanes.h"
+#include "IO/ModelData.h"
+#include "System/ThreadPool.h"
+
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+
+namespace
+{
+    // Ranges at least this large are binned in parallel batches and split into parallel subtree builds
+    constexpr size_t PARALLEL_BATCH_SIZE = 16 * 1024;
+    constexpr uint32_t PARALLEL_SUBTREE_SIZE = 16 * 1024;
+
+    // SAH costs relative to one primitive test
+    constexpr float TRAVERSAL_COST = 1.0f;
+
+    constexpr uint32_t ALL_PLANES = (1u << FRUSTUM_PLANE_COUNT) - 1;
+
+    // Multi-view culls keep the views still testing plane p in byte p of one 64-bit mask
+    static_assert(MAX_CULL_VIEWS <= 8 && FRUSTUM_PLANE_COUNT <= 8, "Per plane view masks have to fit one byte each");
+
+    // Repeats a view mask into the byte of every plane
+    uint64_t BroadcastViews(uint32_t viewMask)
+    {
+        uint64_t planeViews = 0;
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            planeViews |= uint64_t(viewMask) << (p * 8);
+        }
+        return planeViews;
+    }
+
+    struct Bin
+    {
+        AABB bounds;
+        uint32_t count = 0;
+    };
+
+    struct BinSet
+    {
+        Bin bins[3][BVH::SAH_BIN_COUNT];
+    };
+
+    struct RangeBounds
+    {
+        AABB bounds;
+        AABB centroidBounds;
+    };
+
+    float GetComponent(const XMFLOAT3& v, uint32_t axis)
+    {
+        return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+    }
+
+    float HalfArea(const AABB& bounds)
+    {
+        if (!bounds.IsValid())
+        {
+            return 0.0f;
+        }
+
+        float dx = bounds.max.x - bounds.min.x;
+        float dy = bounds.max.y - bounds.min.y;
+        float dz = bounds.max.z - bounds.min.z;
+        return dx * dy + dy * dz + dz * dx;
+    }
+
+    // Binning and partitioning both go through here so a primitive always lands on the same side
+    uint32_t ComputeBinIndex(float centroid, float centroidMin, float binScale)
+    {
+        int32_t bin = static_cast<int32_t>((centroid - centroidMin) * binScale);
+        return static_cast<uint32_t>(std::clamp(bin, 0, static_cast<int32_t>(BVH::SAH_BIN_COUNT) - 1));
+    }
+
+    float Dequantize(uint8_t value, float origin, float scale)
+    {
+        return origin + static_cast<float>(value) * scale;
+    }
+
+    // The scale is nudged up until the top code reaches max despite rounding, so every child box can be encoded
+    void ComputeQuantization(float minValue, float maxValue, float& outOrigin, float& outScale)
+    {
+        outOrigin = minValue;
+        outScale = (maxValue - minValue) / 255.0f;
+        while (Dequantize(255, outOrigin, outScale) < maxValue)
+        {
+            outScale = std::nextafter(outScale, FLT_MAX);
+        }
+    }
+
+    uint8_t QuantizeMin(float value, float origin, float scale)
+    {
+        if (scale <= 0.0f)
+        {
+            return 0;
+        }
+
+        int32_t q = std::clamp(static_cast<int32_t>(std::floor((value - origin) / scale)), 0, 255);
+        while (q > 0 && Dequantize(static_cast<uint8_t>(q), origin, scale) > value)
+        {
+            --q;
+        }
+        return static_cast<uint8_t>(q);
+    }
+
+    uint8_t QuantizeMax(float value, float origin, float scale)
+    {
+        if (scale <= 0.0f)
+        {
+            return 0;
+        }
+
+        int32_t q = std::clamp(static_cast<int32_t>(std::ceil((value - origin) / scale)), 0, 255);
+        while (q < 255 && Dequantize(static_cast<uint8_t>(q), origin, scale) < value)
+        {
+            ++q;
+        }
+        return static_cast<uint8_t>(q);
+    }
+
+    // Same p-vertex test as FrustumCuller so leaf results match brute force culling
+    bool IsOutsideAnyPlane(const AABB& bounds, const Frustum& frustum, uint32_t planeMask)
+    {
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            if (!(planeMask & (1u << p)))
+            {
+                continue;
+            }
+
+            const XMFLOAT4& plane = frustum.planes[p];
+            float x = plane.x >= 0.0f ? bounds.max.x : bounds.min.x;
+            float y = plane.y >= 0.0f ? bounds.max.y : bounds.min.y;
+            float z = plane.z >= 0.0f ? bounds.max.z : bounds.min.z;
+            if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+struct BVH::BuildContext
+{
+    const AABB* bounds = nullptr;
+    std::vector<XMFLOAT3> centroids;
+    std::vector<BuildNode> nodes;
+    std::atomic<uint32_t> nodeCount = 0;
+};
+
+void BVH::Build(const AABB* bounds, size_t count)
+{
+    assertm(bounds != nullptr || count == 0, "BVH::Build called with null bounds");
+    assertm(count < UINT32_MAX / 2, "BVH primitive count exceeds 32-bit node range");
+
+    Clear();
+
+    // Empty boxes (meshes without vertices) can never be visible and would poison the SAH bins
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (bounds[i].IsValid())
+        {
+            m_primitiveIndices.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    if (m_primitiveIndices.empty())
+    {
+        return;
+    }
+
+    uint32_t primitiveCount = static_cast<uint32_t>(m_primitiveIndices.size());
+
+    BuildContext context;
+    context.bounds = bounds;
+    context.centroids.resize(count);
+    ThreadPool::Get().ParallelFor(count, PARALLEL_BATCH_SIZE, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            context.centroids[i] = bounds[i].GetCenter();
+        }
+    });
+
+    // A binary tree with at least one primitive per leaf never needs more nodes than this
+    context.nodes.resize(size_t(primitiveCount) * 2 - 1);
+    context.nodeCount = 1;
+    BuildRecursive(context, 0, 0, primitiveCount);
+
+    m_bounds = context.nodes[0].bounds;
+    m_nodes.reserve(context.nodeCount / 4 + 1);
+    Collapse(context, 0);
+
+    m_primitiveBounds.resize(primitiveCount);
+    for (uint32_t i = 0; i < primitiveCount; ++i)
+    {
+        m_primitiveBounds[i] = bounds[m_primitiveIndices[i]];
+    }
+}
+
+void BVH::Build(const std::vector<MeshData>& meshes)
+{
+    std::vector<AABB> bounds(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        bounds[i] = meshes[i].bounds;
+    }
+    Build(bounds.data(), bounds.size());
+}
+
+void BVH::Clear()
+{
+    m_nodes.clear();
+    m_primitiveIndices.clear();
+    m_primitiveBounds.clear();
+    m_bounds = AABB();
+}
+
+void BVH::BuildRecursive(BuildContext& context, uint32_t nodeIndex, uint32_t begin, uint32_t end)
+{
+    const uint32_t count = end - begin;
+    const uint32_t* indices = m_primitiveIndices.data();
+
+    // The large upper levels are reduced in parallel batches, everything below that runs inline
+    const bool parallel = count >= 2 * PARALLEL_BATCH_SIZE;
+    const size_t batchCount = parallel ? (count + PARALLEL_BATCH_SIZE - 1) / PARALLEL_BATCH_SIZE : 1;
+
+    auto computeBounds = [&](size_t rangeBegin, size_t rangeEnd, RangeBounds& result)
+    {
+        for (size_t i = rangeBegin; i < rangeEnd; ++i)
+        {
+            result.bounds.Merge(context.bounds[indices[i]]);
+            result.centroidBounds.Expand(context.centroids[indices[i]]);
+        }
+    };
+
+    RangeBounds rangeBounds;
+    if (parallel)
+    {
+        std::vector<RangeBounds> batchBounds(batchCount);
+        ThreadPool::Get().ParallelFor(count, PARALLEL_BATCH_SIZE, [&](size_t batchBegin, size_t batchEnd)
+        {
+            computeBounds(begin + batchBegin, begin + batchEnd, batchBounds[batchBegin / PARALLEL_BATCH_SIZE]);
+        });
+
+        for (const RangeBounds& batch : batchBounds)
+        {
+            rangeBounds.bounds.Merge(batch.bounds);
+            rangeBounds.centroidBounds.Merge(batch.centroidBounds);
+        }
+    }
+    else
+    {
+        computeBounds(begin, end, rangeBounds);
+    }
+
+    BuildNode& node = context.nodes[nodeIndex];
+    node.bounds = rangeBounds.bounds;
+    node.begin = begin;
+    node.count = count;
+
+    if (count == 1)
+    {
+        node.isLeaf = true;
+        return;
+    }
+
+    float binScales[3];
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        float extent = GetComponent(rangeBounds.centroidBounds.max, axis) - GetComponent(rangeBounds.centroidBounds.min, axis);
+        binScales[axis] = extent > 0.0f ? float(SAH_BIN_COUNT) / extent : 0.0f;
+    }
+
+    auto binPrimitives = [&](size_t rangeBegin, size_t rangeEnd, BinSet& bins)
+    {
+        for (size_t i = rangeBegin; i < rangeEnd; ++i)
+        {
+            const XMFLOAT3& centroid = context.centroids[indices[i]];
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                uint32_t binIndex = ComputeBinIndex(GetComponent(centroid, axis), GetComponent(rangeBounds.centroidBounds.min, axis), binScales[axis]);
+                Bin& bin = bins.bins[axis][binIndex];
+                bin.bounds.Merge(context.bounds[indices[i]]);
+                bin.count++;
+            }
+        }
+    };
+
+    BinSet bins;
+    if (parallel)
+    {
+        std::vector<BinSet> batchBins(batchCount);
+        ThreadPool::Get().ParallelFor(count, PARALLEL_BATCH_SIZE, [&](size_t batchBegin, size_t batchEnd)
+        {
+            binPrimitives(begin + batchBegin, begin + batchEnd, batchBins[batchBegin / PARALLEL_BATCH_SIZE]);
+        });
+
+        for (const BinSet& batch : batchBins)
+        {
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                for (uint32_t b = 0; b < SAH_BIN_COUNT; ++b)
+                {
+                    if (batch.bins[axis][b].count > 0)
+                    {
+                        bins.bins[axis][b].bounds.Merge(batch.bins[axis][b].bounds);
+                        bins.bins[axis][b].count += batch.bins[axis][b].count;
+                    }
+                }
+            }
+        }
+    }
+    else
+    {
+        binPrimitives(begin, end, bins);
+    }
+
+    // Sweep the bin boundaries of every axis for the cheapest split
+    float bestCost = FLT_MAX;
+    int32_t bestAxis = -1;
+    uint32_t bestBin = 0;
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        if (binScales[axis] == 0.0f)
+        {
+            continue;
+        }
+
+        float rightArea[SAH_BIN_COUNT] = {};
+        uint32_t rightCount[SAH_BIN_COUNT] = {};
+        AABB accumulated;
+        uint32_t accumulatedCount = 0;
+        for (uint32_t b = SAH_BIN_COUNT - 1; b > 0; --b)
+        {
+            const Bin& bin = bins.bins[axis][b];
+            if (bin.count > 0)
+            {
+                accumulated.Merge(bin.bounds);
+                accumulatedCount += bin.count;
+            }
+            rightArea[b] = HalfArea(accumulated);
+            rightCount[b] = accumulatedCount;
+        }
+
+        accumulated = AABB();
+        accumulatedCount = 0;
+        for (uint32_t b = 0; b < SAH_BIN_COUNT - 1; ++b)
+        {
+            const Bin& bin = bins.bins[axis][b];
+            if (bin.count > 0)
+            {
+                accumulated.Merge(bin.bounds);
+                accumulatedCount += bin.count;
+            }
+
+            if (accumulatedCount == 0 || rightCount[b + 1] == 0)
+            {
+                continue;
+            }
+
+            float cost = HalfArea(accumulated) * accumulatedCount + rightArea[b + 1] * rightCount[b + 1];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = static_cast<int32_t>(axis);
+                bestBin = b;
+            }
+        }
+    }
+
+    float nodeArea = HalfArea(node.bounds);
+    bool splitFound = bestAxis >= 0;
+    if (count <= MAX_LEAF_SIZE && (!splitFound || count * nodeArea <= TRAVERSAL_COST * nodeArea + bestCost))
+    {
+        node.isLeaf = true;
+        return;
+    }
+
+    uint32_t* first = m_primitiveIndices.data() + begin;
+    uint32_t* last = m_primitiveIndices.data() + end;
+    uint32_t* middle = first + count / 2;
+    if (splitFound)
+    {
+        uint32_t axis = static_cast<uint32_t>(bestAxis);
+        float centroidMin = GetComponent(rangeBounds.centroidBounds.min, axis);
+        middle = std::partition(first, last, [&](uint32_t primitive)
+        {
+            return ComputeBinIndex(GetComponent(context.centroids[primitive], axis), centroidMin, binScales[axis]) <= bestBin;
+        });
+    }
+
+    // Coincident centroids cannot be separated by the bins, fall back to an index median
+    if (middle == first || middle == last)
+    {
+        middle = first + count / 2;
+    }
+
+    uint32_t split = begin + static_cast<uint32_t>(middle - first);
+    uint32_t leftChild = context.nodeCount.fetch_add(2);
+    node.leftChild = leftChild;
+    node.rightChild = leftChild + 1;
+
+    if (count >= PARALLEL_SUBTREE_SIZE)
+    {
+        ThreadPool::Get().ParallelFor(2, 1, [&](size_t childBegin, size_t childEnd)
+        {
+            for (size_t child = childBegin; child < childEnd; ++child)
+            {
+                if (child == 0)
+                {
+                    BuildRecursive(context, leftChild, begin, split);
+                }
+                else
+                {
+                    BuildRecursive(context, leftChild + 1, split, end);
+                }
+            }
+        });
+    }
+    else
+    {
+        BuildRecursive(context, leftChild, begin, split);
+        BuildRecursive(context, leftChild + 1, split, end);
+    }
+}
+
+uint32_t BVH::Collapse(const BuildContext& context, uint32_t buildNodeIndex)
+{
+    uint32_t nodeIndex = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+
+    const BuildNode& buildNode = context.nodes[buildNodeIndex];
+
+    // Open the largest inner child until the node is full, pulling grandchildren up a level
+    uint32_t children[NODE_WIDTH] = {};
+    uint32_t childCount = 0;
+    if (buildNode.isLeaf)
+    {
+        children[childCount++] = buildNodeIndex;
+    }
+    else
+    {
+        children[childCount++] = buildNode.leftChild;
+        children[childCount++] = buildNode.rightChild;
+    }
+
+    while (childCount < NODE_WIDTH)
+    {
+        int32_t largest = -1;
+        float largestArea = -1.0f;
+        for (uint32_t i = 0; i < childCount; ++i)
+        {
+            const BuildNode& child = context.nodes[children[i]];
+            float area = HalfArea(child.bounds);
+            if (!child.isLeaf && area > largestArea)
+            {
+                largest = static_cast<int32_t>(i);
+                largestArea = area;
+            }
+        }
+
+        if (largest < 0)
+        {
+            break;
+        }
+
+        const BuildNode& opened = context.nodes[children[largest]];
+        children[largest] = opened.leftChild;
+        children[childCount++] = opened.rightChild;
+    }
+
+    Node node = {};
+    ComputeQuantization(buildNode.bounds.min.x, buildNode.bounds.max.x, node.origin.x, node.scale.x);
+    ComputeQuantization(buildNode.bounds.min.y, buildNode.bounds.max.y, node.origin.y, node.scale.y);
+    ComputeQuantization(buildNode.bounds.min.z, buildNode.bounds.max.z, node.origin.z, node.scale.z);
+    node.primitiveBegin = buildNode.begin;
+    node.primitiveEnd = buildNode.begin + buildNode.count;
+
+    for (uint32_t i = 0; i < childCount; ++i)
+    {
+        const BuildNode& child = context.nodes[children[i]];
+        node.minX[i] = QuantizeMin(child.bounds.min.x, node.origin.x, node.scale.x);
+        node.minY[i] = QuantizeMin(child.bounds.min.y, node.origin.y, node.scale.y);
+        node.minZ[i] = QuantizeMin(child.bounds.min.z, node.origin.z, node.scale.z);
+        node.maxX[i] = QuantizeMax(child.bounds.max.x, node.origin.x, node.scale.x);
+        node.maxY[i] = QuantizeMax(child.bounds.max.y, node.origin.y, node.scale.y);
+        node.maxZ[i] = QuantizeMax(child.bounds.max.z, node.origin.z, node.scale.z);
+
+        if (child.isLeaf)
+        {
+            node.child[i] = child.begin;
+            node.childType[i] = static_cast<uint8_t>(child.count);
+        }
+        else
+        {
+            node.child[i] = Collapse(context, children[i]);
+            node.childType[i] = INNER_CHILD;
+        }
+    }
+
+    // Collapsing children grows m_nodes, so the node is written back by index
+    m_nodes[nodeIndex] = node;
+    return nodeIndex;
+}
+
+AABB BVH::GetChildBounds(const Node& node, uint32_t childIndex)
+{
+    assert(childIndex < NODE_WIDTH);
+
+    AABB bounds;
+    bounds.min.x = Dequantize(node.minX[childIndex], node.origin.x, node.scale.x);
+    bounds.min.y = Dequantize(node.minY[childIndex], node.origin.y, node.scale.y);
+    bounds.min.z = Dequantize(node.minZ[childIndex], node.origin.z, node.scale.z);
+    bounds.max.x = Dequantize(node.maxX[childIndex], node.origin.x, node.scale.x);
+    bounds.max.y = Dequantize(node.maxY[childIndex], node.origin.y, node.scale.y);
+    bounds.max.z = Dequantize(node.maxZ[childIndex], node.origin.z, node.scale.z);
+    return bounds;
+}
+
+size_t BVH::Cull(const Frustum& frustum, std::vector<uint32_t>& outVisibleIndices, CullPath path) const
+{
+    assertm(path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2, "BVH::Cull called with a path this build does not support");
+
+    outVisibleIndices.clear();
+    if (m_nodes.empty())
+    {
+        return 0;
+    }
+
+    struct StackEntry
+    {
+        uint32_t nodeIndex;
+        uint32_t planeMask;
+    };
+
+    std::vector<StackEntry> stack;
+    stack.reserve(64);
+    stack.push_back({ 0, ALL_PLANES });
+
+    auto emitRange = [&](uint32_t begin, uint32_t end)
+    {
+        outVisibleIndices.insert(outVisibleIndices.end(), m_primitiveIndices.begin() + begin, m_primitiveIndices.begin() + end);
+    };
+
+    while (!stack.empty())
+    {
+        StackEntry entry = stack.back();
+        stack.pop_back();
+
+        const Node& node = m_nodes[entry.nodeIndex];
+        uint32_t insideMasks[FRUSTUM_PLANE_COUNT];
+        uint32_t outsideMask = TestNode(node, frustum, entry.planeMask, insideMasks, path);
+
+        for (uint32_t lane = 0; lane < NODE_WIDTH; ++lane)
+        {
+            uint8_t type = node.childType[lane];
+            if (type == EMPTY_CHILD || (outsideMask & (1u << lane)))
+            {
+                continue;
+            }
+
+            // Planes the child is fully inside of cannot cull anything below it
+            uint32_t childMask = entry.planeMask;
+            for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+            {
+                if (insideMasks[p] & (1u << lane))
+                {
+                    childMask &= ~(1u << p);
+                }
+            }
+
+            if (type == INNER_CHILD)
+            {
+                if (childMask == 0)
+                {
+                    const Node& child = m_nodes[node.child[lane]];
+                    emitRange(child.primitiveBegin, child.primitiveEnd);
+                }
+                else
+                {
+                    stack.push_back({ node.child[lane], childMask });
+                }
+                continue;
+            }
+
+            uint32_t begin = node.child[lane];
+            uint32_t end = begin + type;
+            if (childMask == 0)
+            {
+                emitRange(begin, end);
+                continue;
+            }
+
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                if (!IsOutsideAnyPlane(m_primitiveBounds[i], frustum, childMask))
+                {
+                    outVisibleIndices.push_back(m_primitiveIndices[i]);
+                }
+            }
+        }
+    }
+
+    return outVisibleIndices.size();
+}
+
+size_t BVH::CullViews(const Frustum* frusta, uint32_t viewCount, std::vector<uint32_t>& outVisibleIndices,
+    std::vector<uint8_t>& outViewMasks, CullPath path) const
+{
+    assertm(frusta != nullptr && viewCount > 0 && viewCount <= MAX_CULL_VIEWS, "BVH::CullViews called with invalid views");
+    assertm(path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2, "BVH::CullViews called with a path this build does not support");
+
+    outVisibleIndices.clear();
+    outViewMasks.clear();
+    if (m_nodes.empty())
+    {
+        return 0;
+    }
+
+    // Unused lanes get zero planes, they never reject anything and are masked out anyway
+    ViewPlanes planes = {};
+    for (uint32_t v = 0; v < viewCount; ++v)
+    {
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            const XMFLOAT4& plane = frusta[v].planes[p];
+            planes.x[p][v] = plane.x;
+            planes.y[p][v] = plane.y;
+            planes.z[p][v] = plane.z;
+            planes.w[p][v] = plane.w;
+        }
+    }
+
+    switch (path)
+    {
+#if defined(__AVX2__)
+    case CullPath::AVX2:
+        return CullViewsLanes<SIMD::AVX2Lanes>(frusta, planes, viewCount, outVisibleIndices, outViewMasks);
+#endif
+    case CullPath::SSE:
+        return CullViewsLanes<SIMD::SSELanes>(frusta, planes, viewCount, outVisibleIndices, outViewMasks);
+    default:
+        return CullViewsLanes<SIMD::ScalarLanes>(frusta, planes, viewCount, outVisibleIndices, outViewMasks);
+    }
+}
+
+template<typename Lanes>
+size_t BVH::CullViewsLanes(const Frustum* frusta, const ViewPlanes& planes, uint32_t viewCount, std::vector<uint32_t>& outVisibleIndices,
+    std::vector<uint8_t>& outViewMasks) const
+{
+    // Views in viewMask see at least part of the subtree, those without any plane left see all of it
+    struct StackEntry
+    {
+        uint32_t nodeIndex;
+        uint32_t viewMask;
+        uint64_t planeViews;
+    };
+
+    uint32_t allViews = (1u << viewCount) - 1;
+    std::vector<StackEntry> stack;
+    stack.reserve(64);
+    stack.push_back({ 0, allViews, BroadcastViews(allViews) });
+
+    auto emitRange = [&](uint32_t begin, uint32_t end, uint32_t viewMask)
+    {
+        outVisibleIndices.insert(outVisibleIndices.end(), m_primitiveIndices.begin() + begin, m_primitiveIndices.begin() + end);
+        outViewMasks.resize(outViewMasks.size() + (end - begin), static_cast<uint8_t>(viewMask));
+    };
+
+    while (!stack.empty())
+    {
+        StackEntry entry = stack.back();
+        stack.pop_back();
+
+        const Node& node = m_nodes[entry.nodeIndex];
+        uint32_t rejectedViews[NODE_WIDTH];
+        uint64_t retiredPlanes[NODE_WIDTH];
+        TestNodeViews<Lanes>(node, frusta, entry.viewMask, entry.planeViews, rejectedViews, retiredPlanes);
+
+        for (uint32_t lane = 0; lane < NODE_WIDTH; ++lane)
+        {
+            uint8_t type = node.childType[lane];
+            uint32_t childViews = entry.viewMask & ~rejectedViews[lane];
+            if (type == EMPTY_CHILD || childViews == 0)
+            {
+                continue;
+            }
+
+            uint64_t childPlanes = entry.planeViews & ~retiredPlanes[lane];
+            if (type == INNER_CHILD)
+            {
+                if (childPlanes == 0)
+                {
+                    const Node& child = m_nodes[node.child[lane]];
+                    emitRange(child.primitiveBegin, child.primitiveEnd, childViews);
+                }
+                else
+                {
+                    stack.push_back({ node.child[lane], childViews, childPlanes });
+                }
+                continue;
+            }
+
+            uint32_t begin = node.child[lane];
+            uint32_t end = begin + type;
+            if (childPlanes == 0)
+            {
+                emitRange(begin, end, childViews);
+                continue;
+            }
+
+            // Every primitive is accepted or rejected for all views in one test
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                uint32_t visibleViews = childViews & ~TestPrimitiveViews<Lanes>(planes, viewCount, m_primitiveBounds[i], childViews, childPlanes);
+                if (visibleViews != 0)
+                {
+                    outVisibleIndices.push_back(m_primitiveIndices[i]);
+                    outViewMasks.push_back(static_cast<uint8_t>(visibleViews));
+                }
+            }
+        }
+    }
+
+    return outVisibleIndices.size();
+}
+
+template<typename Lanes>
+void BVH::TestNodeViews(const Node& node, const Frustum* frusta, uint32_t viewMask, uint64_t planeViews,
+    uint32_t* outRejectedViews, uint64_t* outRetiredPlanes)
+{
+    using Float = typename Lanes::Float;
+    constexpr uint32_t WIDTH = static_cast<uint32_t>(Lanes::WIDTH);
+
+    uint32_t outsideMasks[MAX_CULL_VIEWS] = {};
+    uint32_t insideMasks[MAX_CULL_VIEWS][FRUSTUM_PLANE_COUNT] = {};
+    for (uint32_t i = 0; i < NODE_WIDTH; i += WIDTH)
+    {
+        // Same decode and evaluation order as TestNode, so every view classifies exactly like a single view cull
+        Float minX = node.origin.x + Lanes::LoadBytes(node.minX + i) * node.scale.x;
+        Float minY = node.origin.y + Lanes::LoadBytes(node.minY + i) * node.scale.y;
+        Float minZ = node.origin.z + Lanes::LoadBytes(node.minZ + i) * node.scale.z;
+        Float maxX = node.origin.x + Lanes::LoadBytes(node.maxX + i) * node.scale.x;
+        Float maxY = node.origin.y + Lanes::LoadBytes(node.maxY + i) * node.scale.y;
+        Float maxZ = node.origin.z + Lanes::LoadBytes(node.maxZ + i) * node.scale.z;
+
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            for (uint32_t views = static_cast<uint32_t>(planeViews >> (p * 8)) & viewMask & 0xFFu; views; views &= views - 1)
+            {
+                uint32_t v = std::countr_zero(views);
+                const XMFLOAT4& plane = frusta[v].planes[p];
+                Float positive = plane.x * (plane.x >= 0.0f ? maxX : minX) + plane.y * (plane.y >= 0.0f ? maxY : minY) +
+                    plane.z * (plane.z >= 0.0f ? maxZ : minZ) + plane.w;
+                Float negative = plane.x * (plane.x >= 0.0f ? minX : maxX) + plane.y * (plane.y >= 0.0f ? minY : maxY) +
+                    plane.z * (plane.z >= 0.0f ? minZ : maxZ) + plane.w;
+                outsideMasks[v] |= Lanes::MoveMask(positive < 0.0f) << i;
+                insideMasks[v][p] |= Lanes::MoveMask(negative >= 0.0f) << i;
+            }
+        }
+    }
+
+    // Transpose the per view lane masks into per lane view masks
+    for (uint32_t lane = 0; lane < NODE_WIDTH; ++lane)
+    {
+        uint32_t rejected = 0;
+        uint64_t retired = 0;
+        for (uint32_t views = viewMask; views; views &= views - 1)
+        {
+            uint32_t v = std::countr_zero(views);
+            rejected |= ((outsideMasks[v] >> lane) & 1u) << v;
+            for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+            {
+                retired |= uint64_t((insideMasks[v][p] >> lane) & 1u) << (p * 8 + v);
+            }
+        }
+        outRejectedViews[lane] = rejected;
+        outRetiredPlanes[lane] = retired | BroadcastViews(rejected);
+    }
+}
+
+template<typename Lanes>
+uint32_t BVH::TestPrimitiveViews(const ViewPlanes& planes, uint32_t viewCount, const AABB& bounds, uint32_t viewMask, uint64_t planeViews)
+{
+    using Float = typename Lanes::Float;
+    constexpr uint32_t WIDTH = static_cast<uint32_t>(Lanes::WIDTH);
+
+    const Float minX = bounds.min.x, minY = bounds.min.y, minZ = bounds.min.z;
+    const Float maxX = bounds.max.x, maxY = bounds.max.y, maxZ = bounds.max.z;
+
+    uint32_t outsideViews = 0;
+    for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        uint32_t activeViews = static_cast<uint32_t>(planeViews >> (p * 8)) & 0xFFu;
+        if (activeViews == 0)
+        {
+            continue;
+        }
+
+        for (uint32_t v = 0; v < viewCount; v += WIDTH)
+        {
+            Float nx = Lanes::Load(planes.x[p] + v), ny = Lanes::Load(planes.y[p] + v), nz = Lanes::Load(planes.z[p] + v);
+            Float nw = Lanes::Load(planes.w[p] + v);
+
+            // The p-vertex term n * p is the larger of n * min and n * max, so each view sums exactly the products
+            // a single view test picks by the plane's signs
+            Float positive = Lanes::Max(nx * minX, nx * maxX) + Lanes::Max(ny * minY, ny * maxY) + Lanes::Max(nz * minZ, nz * maxZ) + nw;
+            outsideViews |= (Lanes::MoveMask(positive < 0.0f) << v) & activeViews;
+        }
+
+        if (outsideViews == viewMask)
+        {
+            break;
+        }
+    }
+    return outsideViews;
+}
+
+uint32_t BVH::TestNode(const Node& node, const Frustum& frustum, uint32_t planeMask, uint32_t* insideMasks, CullPath path) const
+{
+    switch (path)
+    {
+    case CullPath::AVX2:
+        return TestNodeAVX2(node, frustum, planeMask, insideMasks);
+    case CullPath::SSE:
+        return TestNodeSSE(node, frustum, planeMask, insideMasks);
+    default:
+        return TestNodeScalar(node, frustum, planeMask, insideMasks);
+    }
+}
+
+uint32_t BVH::TestNodeScalar(const Node& node, const Frustum& frustum, uint32_t planeMask, uint32_t* insideMasks) const
+{
+    AABB childBounds[NODE_WIDTH];
+    for (uint32_t lane = 0; lane < NODE_WIDTH; ++lane)
+    {
+        childBounds[lane] = GetChildBounds(node, lane);
+    }
+
+    uint32_t outsideMask = 0;
+    for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        insideMasks[p] = 0;
+        if (!(planeMask & (1u << p)))
+        {
+            continue;
+        }
+
+        const XMFLOAT4& plane = frustum.planes[p];
+        for (uint32_t lane = 0; lane < NODE_WIDTH; ++lane)
+        {
+            const AABB& bounds = childBounds[lane];
+            XMFLOAT3 positive(
+                plane.x >= 0.0f ? bounds.max.x : bounds.min.x,
+                plane.y >= 0.0f ? bounds.max.y : bounds.min.y,
+                plane.z >= 0.0f ? bounds.max.z : bounds.min.z);
+            XMFLOAT3 negative(
+                plane.x >= 0.0f ? bounds.min.x : bounds.max.x,
+                plane.y >= 0.0f ? bounds.min.y : bounds.max.y,
+                plane.z >= 0.0f ? bounds.min.z : bounds.max.z);
+
+            float positiveDistance = plane.x * positive.x + plane.y * positive.y + plane.z * positive.z + plane.w;
+            float negativeDistance = plane.x * negative.x + plane.y * negative.y + plane.z * negative.z + plane.w;
+            outsideMask |= positiveDistance < 0.0f ? (1u << lane) : 0u;
+            insideMasks[p] |= negativeDistance >= 0.0f ? (1u << lane) : 0u;
+        }
+    }
+    return outsideMask;
+}
+
+uint32_t BVH::TestNodeSSE(const Node& node, const Frustum& frustum, uint32_t planeMask, uint32_t* insideMasks) const
+{
+    // SSE2 only: widen 4 quantized bytes to floats with unpacks instead of the SSE4.1 conversions
+    auto decode = [](const uint8_t* values, float origin, float scale)
+    {
+        int32_t packed;
+        memcpy(&packed, values, sizeof(packed));
+        __m128i zero = _mm_setzero_si128();
+        __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+        __m128 q = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+        return _mm_add_ps(_mm_set1_ps(origin), _mm_mul_ps(q, _mm_set1_ps(scale)));
+    };
+
+    for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        insideMasks[p] = 0;
+    }
+
+    uint32_t outsideMask = 0;
+    const __m128 zero = _mm_setzero_ps();
+    for (uint32_t half = 0; half < NODE_WIDTH; half += 4)
+    {
+        __m128 minX = decode(node.minX + half, node.origin.x, node.scale.x);
+        __m128 minY = decode(node.minY + half, node.origin.y, node.scale.y);
+        __m128 minZ = decode(node.minZ + half, node.origin.z, node.scale.z);
+        __m128 maxX = decode(node.maxX + half, node.origin.x, node.scale.x);
+        __m128 maxY = decode(node.maxY + half, node.origin.y, node.scale.y);
+        __m128 maxZ = decode(node.maxZ + half, node.origin.z, node.scale.z);
+
+        __m128 outside = _mm_setzero_ps();
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            if (!(planeMask & (1u << p)))
+            {
+                continue;
+            }
+
+            const XMFLOAT4& plane = frustum.planes[p];
+            __m128 nx = _mm_set1_ps(plane.x);
+            __m128 ny = _mm_set1_ps(plane.y);
+            __m128 nz = _mm_set1_ps(plane.z);
+            __m128 nw = _mm_set1_ps(plane.w);
+
+            __m128 positive = _mm_mul_ps(nx, plane.x >= 0.0f ? maxX : minX);
+            positive = _mm_add_ps(positive, _mm_mul_ps(ny, plane.y >= 0.0f ? maxY : minY));
+            positive = _mm_add_ps(positive, _mm_mul_ps(nz, plane.z >= 0.0f ? maxZ : minZ));
+            positive = _mm_add_ps(positive, nw);
+
+            __m128 negative = _mm_mul_ps(nx, plane.x >= 0.0f ? minX : maxX);
+            negative = _mm_add_ps(negative, _mm_mul_ps(ny, plane.y >= 0.0f ? minY : maxY));
+            negative = _mm_add_ps(negative, _mm_mul_ps(nz, plane.z >= 0.0f ? minZ : maxZ));
+            negative = _mm_add_ps(negative, nw);
+
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(positive, zero));
+            insideMasks[p] |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(negative, zero))) << half;
+        }
+        outsideMask |= static_cast<uint32_t>(_mm_movemask_ps(outside)) << half;
+    }
+    return outsideMask;
+}
+
+uint32_t BVH::TestNodeAVX2(const Node& node, const Frustum& frustum, uint32_t planeMask, uint32_t* insideMasks) const
+{
+#if defined(__AVX2__)
+    auto decode = [](const uint8_t* values, float origin, float scale)
+    {
+        __m256i widened = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(values)));
+        return _mm256_add_ps(_mm256_set1_ps(origin), _mm256_mul_ps(_mm256_cvtepi32_ps(widened), _mm256_set1_ps(scale)));
+    };
+
+    __m256 minX = decode(node.minX, node.origin.x, node.scale.x);
+    __m256 minY = decode(node.minY, node.origin.y, node.scale.y);
+    __m256 minZ = decode(node.minZ, node.origin.z, node.scale.z);
+    __m256 maxX = decode(node.maxX, node.origin.x, node.scale.x);
+    __m256 maxY = decode(node.maxY, node.origin.y, node.scale.y);
+    __m256 maxZ = decode(node.maxZ, node.origin.z, node.scale.z);
+
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 outside = _mm256_setzero_ps();
+    for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        insideMasks[p] = 0;
+        if (!(planeMask & (1u << p)))
+        {
+            continue;
+        }
+
+        const XMFLOAT4& plane = frustum.planes[p];
+        __m256 nx = _mm256_set1_ps(plane.x);
+        __m256 ny = _mm256_set1_ps(plane.y);
+        __m256 nz = _mm256_set1_ps(plane.z);
+        __m256 nw = _mm256_set1_ps(plane.w);
+
+        __m256 positive = _mm256_mul_ps(nx, plane.x >= 0.0f ? maxX : minX);
+        positive = _mm256_add_ps(positive, _mm256_mul_ps(ny, plane.y >= 0.0f ? maxY : minY));
+        positive = _mm256_add_ps(positive, _mm256_mul_ps(nz, plane.z >= 0.0f ? maxZ : minZ));
+        positive = _mm256_add_ps(positive, nw);
+
+        __m256 negative = _mm256_mul_ps(nx, plane.x >= 0.0f ? minX : maxX);
+        negative = _mm256_add_ps(negative, _mm256_mul_ps(ny, plane.y >= 0.0f ? minY : maxY));
+        negative = _mm256_add_ps(negative, _mm256_mul_ps(nz, plane.z >= 0.0f ? minZ : maxZ));
+        negative = _mm256_add_ps(negative, nw);
+
+        outside = _mm256_or_ps(outside, _mm256_cmp_ps(positive, zero, _CMP_LT_OQ));
+        insideMasks[p] = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(negative, zero, _CMP_GE_OQ)));
+    }
+    return static_cast<uint32_t>(_mm256_movemask_ps(outside));
+#else
+    return TestNodeSSE(node, frustum, planeMask, insideMasks);
+#endif
+}
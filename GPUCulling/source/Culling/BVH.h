@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include "Culling/CullingCommon.h"
+#include "Culling/Frustum.h"
+#include <vector>
+#include <cstdint>
+
+struct MeshData;
+
+// Wide bounding volume hierarchy over instance AABBs for hierarchical frustum culling.
+// Built top down with a binned SAH, then collapsed into 8-wide nodes whose child boxes are quantized to 8 bits
+// relative to the node, so one AVX2 register (or two SSE registers) tests every child of a node against a plane.
+class BVH
+{
+    BVH(const BVH&) = delete;
+    BVH& operator=(const BVH&) = delete;
+
+public:
+    static constexpr uint32_t NODE_WIDTH = 8;
+    static constexpr uint32_t MAX_LEAF_SIZE = 4;
+    static constexpr uint32_t SAH_BIN_COUNT = 16;
+
+    // Child slot types, any other value is the primitive count of a leaf child
+    static constexpr uint8_t EMPTY_CHILD = 0;
+    static constexpr uint8_t INNER_CHILD = 0xFF;
+
+    struct alignas(64) Node
+    {
+        // Child bounds decode as origin + q * scale and are rounded outward at build time
+        uint8_t minX[NODE_WIDTH];
+        uint8_t minY[NODE_WIDTH];
+        uint8_t minZ[NODE_WIDTH];
+        uint8_t maxX[NODE_WIDTH];
+        uint8_t maxY[NODE_WIDTH];
+        uint8_t maxZ[NODE_WIDTH];
+        XMFLOAT3 origin;
+        XMFLOAT3 scale;
+
+        // Node index for inner children, first primitive for leaf children
+        uint32_t child[NODE_WIDTH];
+        uint8_t childType[NODE_WIDTH];
+
+        // Every subtree covers a contiguous range of the reordered primitives
+        uint32_t primitiveBegin;
+        uint32_t primitiveEnd;
+    };
+
+    BVH() = default;
+    ~BVH() = default;
+
+    void Build(const AABB* bounds, size_t count);
+    // One primitive per mesh, primitive indices match mesh indices
+    void Build(const std::vector<MeshData>& meshes);
+    void Clear();
+
+    // Writes the indices of every primitive intersecting the frustum. Subtrees fully inside a plane stop testing it,
+    // subtrees fully inside the frustum are emitted without further tests. Returns the visible count.
+    size_t Cull(const Frustum& frustum, std::vector<uint32_t>& outVisibleIndices, CullPath path = DEFAULT_CULL_PATH) const;
+    // Culls up to MAX_CULL_VIEWS frusta (shadow cascades, mirrors, split screen) in one traversal. Every primitive
+    // visible in at least one view is written once, with bit v of its view mask set when frusta[v] sees it. A subtree
+    // is dropped once every view rejected it. Per view the result equals Cull. Returns the visible count.
+    size_t CullViews(const Frustum* frusta, uint32_t viewCount, std::vector<uint32_t>& outVisibleIndices,
+        std::vector<uint8_t>& outViewMasks, CullPath path = DEFAULT_CULL_PATH) const;
+
+    size_t GetPrimitiveCount() const { return m_primitiveIndices.size(); }
+    size_t GetNodeCount() const { return m_nodes.size(); }
+    const std::vector<Node>& GetNodes() const { return m_nodes; }
+    const AABB& GetBounds() const { return m_bounds; }
+    // Original primitive index and exact bounds of every primitive in tree order
+    const std::vector<uint32_t>& GetPrimitiveIndices() const { return m_primitiveIndices; }
+    const std::vector<AABB>& GetPrimitiveBounds() const { return m_primitiveBounds; }
+
+    // Decoded child bounds, conservative with respect to the primitives below the child
+    static AABB GetChildBounds(const Node& node, uint32_t childIndex);
+
+private:
+    struct BuildNode
+    {
+        AABB bounds;
+        uint32_t leftChild = 0;
+        uint32_t rightChild = 0;
+        uint32_t begin = 0;
+        uint32_t count = 0;
+        bool isLeaf = false;
+    };
+
+    struct BuildContext;
+
+    void BuildRecursive(BuildContext& context, uint32_t nodeIndex, uint32_t begin, uint32_t end);
+    uint32_t Collapse(const BuildContext& context, uint32_t buildNodeIndex);
+
+    // Returns the lanes outside any active plane. insideMasks[p] gets a bit per lane fully inside plane p.
+    uint32_t TestNode(const Node& node, const Frustum& frustum, uint32_t planeMask, uint32_t* insideMasks, CullPath path) const;
+    uint32_t TestNodeScalar(const Node& node, const Frustum& frustum, uint32_t planeMask, uint32_t* insideMasks) const;
+    uint32_t TestNodeSSE(const Node& node, const Frustum& frustum, uint32_t planeMask, uint32_t* insideMasks) const;
+    uint32_t TestNodeAVX2(const Node& node, const Frustum& frustum, uint32_t planeMask, uint32_t* insideMasks) const;
+
+    // Planes of every view transposed, so one register holds a plane component of several views
+    struct ViewPlanes
+    {
+        float x[FRUSTUM_PLANE_COUNT][MAX_CULL_VIEWS];
+        float y[FRUSTUM_PLANE_COUNT][MAX_CULL_VIEWS];
+        float z[FRUSTUM_PLANE_COUNT][MAX_CULL_VIEWS];
+        float w[FRUSTUM_PLANE_COUNT][MAX_CULL_VIEWS];
+    };
+
+    template<typename Lanes>
+    size_t CullViewsLanes(const Frustum* frusta, const ViewPlanes& planes, uint32_t viewCount, std::vector<uint32_t>& outVisibleIndices,
+        std::vector<uint8_t>& outViewMasks) const;
+    // Tests the children of a node once per view, one child per lane, the node is decoded a single time. Byte p of
+    // planeViews holds the views still testing plane p. Per child, writes the views that reject it and the plane
+    // view bits it retires by being fully inside.
+    template<typename Lanes>
+    static void TestNodeViews(const Node& node, const Frustum* frusta, uint32_t viewMask, uint64_t planeViews,
+        uint32_t* outRejectedViews, uint64_t* outRetiredPlanes);
+    // Tests one primitive against every view in viewMask at once, one view per lane. Returns the views it is outside
+    // of, stops as soon as all of them rejected it.
+    template<typename Lanes>
+    static uint32_t TestPrimitiveViews(const ViewPlanes& planes, uint32_t viewCount, const AABB& bounds, uint32_t viewMask, uint64_t planeViews);
+
+    std::vector<Node> m_nodes;
+    // Original primitive index and exact bounds in tree order
+    std::vector<uint32_t> m_primitiveIndices;
+    std::vector<AABB> m_primitiveBounds;
+    AABB m_bounds;
+};
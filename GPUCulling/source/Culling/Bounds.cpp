@@ -0,0 +1,218 @@
+#include "stdafx.h"
+#include "Culling/Bounds.h"
+
+namespace
+{
+    const XMFLOAT3& PointAt(const XMFLOAT3* points, size_t index, size_t strideBytes)
+    {
+        return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(points) + index * strideBytes);
+    }
+
+    float GetAxis(const XMFLOAT3& point, uint32_t axis)
+    {
+        return axis == 0 ? point.x : (axis == 1 ? point.y : point.z);
+    }
+
+    struct GrowingSphere
+    {
+        XMVECTOR center;
+        float radius = 0.0f;
+        float radiusSq = 0.0f;
+
+        // Ritter's update: grow to enclose a point left outside, moving the center towards it by half the overshoot
+        void Grow(FXMVECTOR point)
+        {
+            XMVECTOR delta = XMVectorSubtract(point, center);
+            float distanceSq = XMVectorGetX(XMVector3LengthSq(delta));
+            if (distanceSq > radiusSq)
+            {
+                float distance = sqrtf(distanceSq);
+                float newRadius = (radius + distance) * 0.5f;
+                center = XMVectorAdd(center, XMVectorScale(delta, (newRadius - radius) / distance));
+                radius = newRadius;
+                radiusSq = newRadius * newRadius;
+            }
+        }
+    };
+}
+
+BoundsAccumulator::BoundsAccumulator()
+{
+    m_min = XMVectorReplicate(FLT_MAX);
+    m_max = XMVectorReplicate(-FLT_MAX);
+}
+
+void BoundsAccumulator::Add(const XMFLOAT3& point)
+{
+    XMVECTOR p = XMLoadFloat3(&point);
+    m_min = XMVectorMin(m_min, p);
+    m_max = XMVectorMax(m_max, p);
+
+    if (m_count++ == 0)
+    {
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            m_axisMin[axis] = point;
+            m_axisMax[axis] = point;
+        }
+        return;
+    }
+
+    const float coordinates[3] = { point.x, point.y, point.z };
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        if (coordinates[axis] < GetAxis(m_axisMin[axis], axis))
+        {
+            m_axisMin[axis] = point;
+        }
+        if (coordinates[axis] > GetAxis(m_axisMax[axis], axis))
+        {
+            m_axisMax[axis] = point;
+        }
+    }
+}
+
+AABB BoundsAccumulator::GetAABB() const
+{
+    AABB bounds;
+    if (m_count > 0)
+    {
+        XMStoreFloat3(&bounds.min, m_min);
+        XMStoreFloat3(&bounds.max, m_max);
+    }
+    return bounds;
+}
+
+Sphere BoundsAccumulator::GetSphere(const XMFLOAT3* points, size_t count, size_t strideBytes) const
+{
+    assertm(count == m_count, "BoundsAccumulator::GetSphere called with other points than were added");
+
+    Sphere sphere;
+    if (m_count == 0)
+    {
+        return sphere;
+    }
+
+    // Seed with the pair of extremes furthest apart
+    XMVECTOR seedMin = XMLoadFloat3(&m_axisMin[0]);
+    XMVECTOR seedMax = XMLoadFloat3(&m_axisMax[0]);
+    float seedLengthSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(seedMax, seedMin)));
+    for (uint32_t axis = 1; axis < 3; ++axis)
+    {
+        XMVECTOR axisMin = XMLoadFloat3(&m_axisMin[axis]);
+        XMVECTOR axisMax = XMLoadFloat3(&m_axisMax[axis]);
+        float lengthSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(axisMax, axisMin)));
+        if (lengthSq > seedLengthSq)
+        {
+            seedMin = axisMin;
+            seedMax = axisMax;
+            seedLengthSq = lengthSq;
+        }
+    }
+
+    GrowingSphere growing;
+    growing.center = XMVectorScale(XMVectorAdd(seedMin, seedMax), 0.5f);
+    growing.radius = sqrtf(seedLengthSq) * 0.5f;
+    growing.radiusSq = growing.radius * growing.radius;
+
+    // Most points already lie inside, so four at a time are tested together and only a group with a point outside
+    // grows the sphere, one point after the other in order
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const XMFLOAT3& p0 = PointAt(points, i, strideBytes);
+        const XMFLOAT3& p1 = PointAt(points, i + 1, strideBytes);
+        const XMFLOAT3& p2 = PointAt(points, i + 2, strideBytes);
+        const XMFLOAT3& p3 = PointAt(points, i + 3, strideBytes);
+        XMVECTOR dx = XMVectorSubtract(XMVectorSet(p0.x, p1.x, p2.x, p3.x), XMVectorSplatX(growing.center));
+        XMVECTOR dy = XMVectorSubtract(XMVectorSet(p0.y, p1.y, p2.y, p3.y), XMVectorSplatY(growing.center));
+        XMVECTOR dz = XMVectorSubtract(XMVectorSet(p0.z, p1.z, p2.z, p3.z), XMVectorSplatZ(growing.center));
+        XMVECTOR distanceSq = XMVectorMultiplyAdd(dz, dz, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dx, dx)));
+        if (XMVector4Less(distanceSq, XMVectorReplicate(growing.radiusSq)))
+        {
+            continue;
+        }
+
+        for (const XMFLOAT3* point : { &p0, &p1, &p2, &p3 })
+        {
+            growing.Grow(XMLoadFloat3(point));
+        }
+    }
+    for (; i < count; ++i)
+    {
+        growing.Grow(XMLoadFloat3(&PointAt(points, i, strideBytes)));
+    }
+
+    // Incoherent point orders can still leave the grown sphere loose, the box around the points bounds how badly
+    AABB bounds = GetAABB();
+    XMFLOAT3 extents = bounds.GetExtents();
+    float boxRadius = sqrtf(extents.x * extents.x + extents.y * extents.y + extents.z * extents.z);
+    XMVECTOR center = growing.center;
+    float radius = growing.radius;
+    if (boxRadius < radius)
+    {
+        XMFLOAT3 boxCenter = bounds.GetCenter();
+        center = XMLoadFloat3(&boxCenter);
+        radius = boxRadius;
+    }
+
+    // Absorb the rounding of the center updates and distance tests so the sphere stays conservative. That rounding is
+    // relative to the coordinates, so far from the origin it outgrows a pad relative to the radius alone.
+    XMStoreFloat3(&sphere.center, center);
+    sphere.radius = radius + 1e-5f * std::max(XMVectorGetX(XMVector3Length(center)), radius);
+    return sphere;
+}
+
+Sphere ComputeBoundingSphere(const XMFLOAT3* points, size_t count, size_t strideBytes)
+{
+    BoundsAccumulator accumulator;
+    for (size_t i = 0; i < count; ++i)
+    {
+        accumulator.Add(PointAt(points, i, strideBytes));
+    }
+    return accumulator.GetSphere(points, count, strideBytes);
+}
+
+AABB TransformAABB(const AABB& bounds, FXMMATRIX transform)
+{
+    if (!bounds.IsValid())
+    {
+        return bounds;
+    }
+
+    XMFLOAT4X4 m;
+    XMStoreFloat4x4(&m, transform);
+
+    const float boxMin[3] = { bounds.min.x, bounds.min.y, bounds.min.z };
+    const float boxMax[3] = { bounds.max.x, bounds.max.y, bounds.max.z };
+    float outMin[3] = { m._41, m._42, m._43 };
+    float outMax[3] = { m._41, m._42, m._43 };
+
+    // Every output axis takes the smaller and the larger of each input axis' contribution
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            float a = m.m[i][j] * boxMin[i];
+            float b = m.m[i][j] * boxMax[i];
+            outMin[j] += a < b ? a : b;
+            outMax[j] += a < b ? b : a;
+        }
+    }
+
+    AABB result;
+    result.min = XMFLOAT3(outMin[0], outMin[1], outMin[2]);
+    result.max = XMFLOAT3(outMax[0], outMax[1], outMax[2]);
+    return result;
+}
+
+Sphere TransformSphere(const Sphere& sphere, FXMMATRIX transform)
+{
+    float scaleSq = std::max(std::max(XMVectorGetX(XMVector3LengthSq(transform.r[0])), XMVectorGetX(XMVector3LengthSq(transform.r[1]))),
+        XMVectorGetX(XMVector3LengthSq(transform.r[2])));
+
+    Sphere result;
+    XMStoreFloat3(&result.center, XMVector3Transform(XMLoadFloat3(&sphere.center), transform));
+    result.radius = sphere.radius * std::sqrt(scaleSq);
+    return result;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cfloat>
+#include <cstddef>
+
+using namespace DirectX;
+
+struct AABB
+{
+    XMFLOAT3 min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+    XMFLOAT3 max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    bool IsValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+
+    XMFLOAT3 GetCenter() const
+    {
+        return XMFLOAT3((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f);
+    }
+
+    XMFLOAT3 GetExtents() const
+    {
+        return XMFLOAT3((max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f);
+    }
+
+    void Expand(const XMFLOAT3& point)
+    {
+        min.x = min.x < point.x ? min.x : point.x;
+        min.y = min.y < point.y ? min.y : point.y;
+        min.z = min.z < point.z ? min.z : point.z;
+        max.x = max.x > point.x ? max.x : point.x;
+        max.y = max.y > point.y ? max.y : point.y;
+        max.z = max.z > point.z ? max.z : point.z;
+    }
+
+    void Merge(const AABB& other)
+    {
+        Expand(other.min);
+        Expand(other.max);
+    }
+};
+
+struct Sphere
+{
+    XMFLOAT3 center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    float radius = 0.0f;
+};
+
+// Collects the AABB and the extreme points along each axis while points are streamed through it, so the first of
+// Ritter's two passes happens in the pass that copies vertex data
+class BoundsAccumulator
+{
+public:
+    BoundsAccumulator();
+
+    void Add(const XMFLOAT3& point);
+    AABB GetAABB() const;
+    // Ritter's sphere over the same points that were added: seeded with the most distant pair of axis extremes and grown
+    // over the points four at a time, or the sphere around the AABB when that one is smaller
+    Sphere GetSphere(const XMFLOAT3* points, size_t count, size_t strideBytes = sizeof(XMFLOAT3)) const;
+    bool IsEmpty() const { return m_count == 0; }
+
+private:
+    XMVECTOR m_min;
+    XMVECTOR m_max;
+    // Points with the smallest and the largest x, y and z
+    XMFLOAT3 m_axisMin[3] = {};
+    XMFLOAT3 m_axisMax[3] = {};
+    size_t m_count = 0;
+};
+
+Sphere ComputeBoundingSphere(const XMFLOAT3* points, size_t count, size_t strideBytes = sizeof(XMFLOAT3));
+
+// Box around the 8 transformed corners for a row vector transform, built from the matrix entries directly (Arvo).
+// Invalid bounds stay invalid.
+AABB TransformAABB(const AABB& bounds, FXMMATRIX transform);
+// Sphere around the transformed sphere for a row vector transform, the radius grows with the largest axis scale
+Sphere TransformSphere(const Sphere& sphere, FXMMATRIX transform);
@@ -0,0 +1,168 @@
+#include "stdafx.h"
+#include "Culling/ClusterCuller.h"
+
+#include "Culling/SIMDLanes.h"
+#include "Engine/Camera.h"
+
+#include <bit>
+
+using namespace ShaderInterop;
+using namespace SIMD;
+
+void ClusterCuller::Reserve(size_t clusterCount)
+{
+    for (std::vector<float>* stream : { &m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_apexX, &m_apexY, &m_apexZ,
+        &m_axisX, &m_axisY, &m_axisZ, &m_cutoff })
+    {
+        stream->reserve(clusterCount);
+    }
+}
+
+void ClusterCuller::Clear()
+{
+    for (std::vector<float>* stream : { &m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_apexX, &m_apexY, &m_apexZ,
+        &m_axisX, &m_axisY, &m_axisZ, &m_cutoff })
+    {
+        stream->clear();
+    }
+}
+
+uint32_t ClusterCuller::AddCluster(const Meshlet& meshlet)
+{
+    assertm(m_centerX.size() < UINT32_MAX, "ClusterCuller cluster count exceeds 32-bit index range");
+
+    uint32_t clusterIndex = static_cast<uint32_t>(m_centerX.size());
+    m_centerX.push_back(meshlet.boundingSphere.center.x);
+    m_centerY.push_back(meshlet.boundingSphere.center.y);
+    m_centerZ.push_back(meshlet.boundingSphere.center.z);
+    m_radius.push_back(meshlet.boundingSphere.radius);
+    m_apexX.push_back(meshlet.coneApex.x);
+    m_apexY.push_back(meshlet.coneApex.y);
+    m_apexZ.push_back(meshlet.coneApex.z);
+    m_axisX.push_back(meshlet.coneAxis.x);
+    m_axisY.push_back(meshlet.coneAxis.y);
+    m_axisZ.push_back(meshlet.coneAxis.z);
+    m_cutoff.push_back(meshlet.coneCutoff);
+    return clusterIndex;
+}
+
+uint32_t ClusterCuller::AddMeshlets(const MeshletData& meshletData)
+{
+    uint32_t firstCluster = static_cast<uint32_t>(m_centerX.size());
+    Reserve(m_centerX.size() + meshletData.meshlets.size());
+    for (const Meshlet& meshlet : meshletData.meshlets)
+    {
+        AddCluster(meshlet);
+    }
+    return firstCluster;
+}
+
+ClusterBounds ClusterCuller::GetClusterBounds(uint32_t clusterIndex) const
+{
+    assert(clusterIndex < m_centerX.size());
+
+    ClusterBounds bounds = {};
+    bounds.center = XMFLOAT3(m_centerX[clusterIndex], m_centerY[clusterIndex], m_centerZ[clusterIndex]);
+    bounds.radius = m_radius[clusterIndex];
+    bounds.coneApex = XMFLOAT3(m_apexX[clusterIndex], m_apexY[clusterIndex], m_apexZ[clusterIndex]);
+    bounds.coneCutoff = m_cutoff[clusterIndex];
+    bounds.coneAxis = XMFLOAT3(m_axisX[clusterIndex], m_axisY[clusterIndex], m_axisZ[clusterIndex]);
+    return bounds;
+}
+
+ClusterCullConstants ClusterCuller::BuildConstants(const Camera& camera, float viewportWidth, float viewportHeight, uint32_t cullFlags)
+{
+    XMFLOAT4X4 projection;
+    XMStoreFloat4x4(&projection, camera.GetProjectionMatrix());
+
+    ClusterCullConstants constants = {};
+    XMStoreFloat4x4(&constants.view, XMMatrixTranspose(camera.GetViewMatrix()));
+    constants.cameraPosition = camera.GetPosition();
+    constants.projectionScaleX = projection._11;
+    constants.viewportSize = XMFLOAT2(viewportWidth, viewportHeight);
+    constants.projectionScaleY = projection._22;
+    constants.nearPlane = camera.GetNearPlane();
+    constants.cullFlags = cullFlags;
+    return constants;
+}
+
+size_t ClusterCuller::Cull(const ClusterCullConstants& constants, uint32_t* outVisibleIndices, CullPath path) const
+{
+    assertm(outVisibleIndices != nullptr, "ClusterCuller::Cull called with null output buffer");
+    assertm(path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2, "ClusterCuller::Cull called with a path this build does not support");
+
+    const size_t count = GetClusterCount();
+    switch (path)
+    {
+#if defined(__AVX2__)
+    case CullPath::AVX2:
+    {
+        size_t simdCount = count & ~size_t(7);
+        size_t visibleCount = CullLanes<AVX2Lanes>(constants, 0, simdCount, outVisibleIndices);
+        return visibleCount + CullLanes<ScalarLanes>(constants, simdCount, count, outVisibleIndices + visibleCount);
+    }
+#endif
+    case CullPath::SSE:
+    {
+        size_t simdCount = count & ~size_t(3);
+        size_t visibleCount = CullLanes<SSELanes>(constants, 0, simdCount, outVisibleIndices);
+        return visibleCount + CullLanes<ScalarLanes>(constants, simdCount, count, outVisibleIndices + visibleCount);
+    }
+    default:
+        return CullLanes<ScalarLanes>(constants, 0, count, outVisibleIndices);
+    }
+}
+
+size_t ClusterCuller::Cull(const ClusterCullConstants& constants, std::vector<uint32_t>& outVisibleIndices, CullPath path) const
+{
+    outVisibleIndices.resize(GetClusterCount());
+    size_t visibleCount = Cull(constants, outVisibleIndices.data(), path);
+    outVisibleIndices.resize(visibleCount);
+    return visibleCount;
+}
+
+template<typename Lanes>
+size_t ClusterCuller::CullLanes(const ClusterCullConstants& constants, size_t begin, size_t end, uint32_t* outVisibleIndices) const
+{
+    using Float = typename Lanes::Float;
+    using Mask = typename Lanes::Mask;
+
+    const bool cullBackfacing = (constants.cullFlags & CLUSTER_CULL_BACKFACE) != 0;
+    const bool cullSmall = (constants.cullFlags & CLUSTER_CULL_SMALL_PRIMITIVE) != 0;
+
+    // The view matrix is stored transposed for the shader, so its rows are the columns of the row vector transform
+    const XMFLOAT4X4& view = constants.view;
+
+    size_t visibleCount = 0;
+    for (size_t i = begin; i < end; i += Lanes::WIDTH)
+    {
+        uint32_t culledMask = 0;
+
+        if (cullBackfacing)
+        {
+            culledMask |= Lanes::MoveMask(IsClusterBackfacing<Float, Mask>(
+                Lanes::Load(&m_apexX[i]), Lanes::Load(&m_apexY[i]), Lanes::Load(&m_apexZ[i]),
+                Lanes::Load(&m_axisX[i]), Lanes::Load(&m_axisY[i]), Lanes::Load(&m_axisZ[i]),
+                Lanes::Load(&m_cutoff[i]), constants.cameraPosition));
+        }
+
+        if (cullSmall)
+        {
+            Float x = Lanes::Load(&m_centerX[i]);
+            Float y = Lanes::Load(&m_centerY[i]);
+            Float z = Lanes::Load(&m_centerZ[i]);
+            Float viewX = x * view._11 + y * view._12 + z * view._13 + view._14;
+            Float viewY = x * view._21 + y * view._22 + z * view._23 + view._24;
+            Float viewZ = x * view._31 + y * view._32 + z * view._33 + view._34;
+            culledMask |= Lanes::MoveMask(IsClusterBetweenSamples<Float, Mask>(viewX, viewY, viewZ, Lanes::Load(&m_radius[i]), constants));
+        }
+
+        uint32_t visibleMask = ~culledMask & ((1u << Lanes::WIDTH) - 1);
+        while (visibleMask)
+        {
+            outVisibleIndices[visibleCount++] = static_cast<uint32_t>(i) + std::countr_zero(visibleMask);
+            visibleMask &= visibleMask - 1;
+        }
+    }
+    return visibleCount;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Culling/CullingCommon.h"
+#include "IO/MeshletBuilder.h"
+#include "Shaders/ClusterCullingShared.h"
+#include <vector>
+#include <cstdint>
+
+class Camera;
+
+// Rejects clusters whose normal cone faces away from the camera and clusters too small to cover a pixel sample.
+// The tests live in Shaders/ClusterCullingShared.h and are shared with the compute shader. The CPU paths run them
+// over structure-of-arrays cluster data, 4 (SSE) or 8 (AVX2) clusters at a time.
+class ClusterCuller
+{
+    ClusterCuller(const ClusterCuller&) = delete;
+    ClusterCuller& operator=(const ClusterCuller&) = delete;
+
+public:
+    static constexpr uint32_t ALL_CULL_FLAGS = ShaderInterop::CLUSTER_CULL_BACKFACE | ShaderInterop::CLUSTER_CULL_SMALL_PRIMITIVE;
+
+    ClusterCuller() = default;
+    ~ClusterCuller() = default;
+
+    void Reserve(size_t clusterCount);
+    void Clear();
+
+    uint32_t AddCluster(const Meshlet& meshlet);
+    // Adds every meshlet of a mesh and returns the index of the first one
+    uint32_t AddMeshlets(const MeshletData& meshletData);
+    ShaderInterop::ClusterBounds GetClusterBounds(uint32_t clusterIndex) const;
+    size_t GetClusterCount() const { return m_centerX.size(); }
+
+    static ShaderInterop::ClusterCullConstants BuildConstants(const Camera& camera, float viewportWidth, float viewportHeight,
+        uint32_t cullFlags = ALL_CULL_FLAGS);
+
+    // outVisibleIndices must hold at least GetClusterCount() elements, only surviving indices are written. Returns the visible count.
+    size_t Cull(const ShaderInterop::ClusterCullConstants& constants, uint32_t* outVisibleIndices, CullPath path = DEFAULT_CULL_PATH) const;
+    size_t Cull(const ShaderInterop::ClusterCullConstants& constants, std::vector<uint32_t>& outVisibleIndices, CullPath path = DEFAULT_CULL_PATH) const;
+
+private:
+    template<typename Lanes>
+    size_t CullLanes(const ShaderInterop::ClusterCullConstants& constants, size_t begin, size_t end, uint32_t* outVisibleIndices) const;
+
+    std::vector<float> m_centerX;
+    std::vector<float> m_centerY;
+    std::vector<float> m_centerZ;
+    std::vector<float> m_radius;
+    std::vector<float> m_apexX;
+    std::vector<float> m_apexY;
+    std::vector<float> m_apexZ;
+    std::vector<float> m_axisX;
+    std::vector<float> m_axisY;
+    std::vector<float> m_axisZ;
+    std::vector<float> m_cutoff;
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+// Selects the instruction set a CPU culling routine runs on. The scalar path is the reference
+// every SIMD path has to reproduce exactly.
+enum class CullPath
+{
+    Scalar,
+    SSE,
+    AVX2
+};
+
+#if defined(__AVX2__)
+static constexpr CullPath DEFAULT_CULL_PATH = CullPath::AVX2;
+#else
+static constexpr CullPath DEFAULT_CULL_PATH = CullPath::SSE;
+#endif
@@ -0,0 +1,53 @@
+#include "stdafx.h"
+#include "Culling/Frustum.h"
+
+Frustum Frustum::FromMatrix(FXMMATRIX viewProjection)
+{
+    // With row vectors clip = p * M, so every clip component is a column of M.
+    // Transposing turns those columns into rows we can combine directly.
+    XMMATRIX columns = XMMatrixTranspose(viewProjection);
+
+    XMVECTOR planes[FRUSTUM_PLANE_COUNT];
+    planes[(uint32_t)FrustumPlane::Left] = XMVectorAdd(columns.r[3], columns.r[0]);
+    planes[(uint32_t)FrustumPlane::Right] = XMVectorSubtract(columns.r[3], columns.r[0]);
+    planes[(uint32_t)FrustumPlane::Bottom] = XMVectorAdd(columns.r[3], columns.r[1]);
+    planes[(uint32_t)FrustumPlane::Top] = XMVectorSubtract(columns.r[3], columns.r[1]);
+    planes[(uint32_t)FrustumPlane::Near] = columns.r[2];
+    planes[(uint32_t)FrustumPlane::Far] = XMVectorSubtract(columns.r[3], columns.r[2]);
+
+    Frustum frustum;
+    for (uint32_t i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+    {
+        XMStoreFloat4(&frustum.planes[i], XMPlaneNormalize(planes[i]));
+    }
+    return frustum;
+}
+
+bool Frustum::IntersectsAABB(const AABB& bounds) const
+{
+    for (const XMFLOAT4& plane : planes)
+    {
+        // Test the corner furthest along the plane normal (the "positive vertex")
+        float px = plane.x >= 0.0f ? bounds.max.x : bounds.min.x;
+        float py = plane.y >= 0.0f ? bounds.max.y : bounds.min.y;
+        float pz = plane.z >= 0.0f ? bounds.max.z : bounds.min.z;
+
+        if (plane.x * px + plane.y * py + plane.z * pz + plane.w < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::ContainsPoint(const XMFLOAT3& point) const
+{
+    for (const XMFLOAT4& plane : planes)
+    {
+        if (plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include <DirectXMath.h>
+#include <array>
+#include <cstdint>
+
+using namespace DirectX;
+
+static constexpr uint32_t FRUSTUM_PLANE_COUNT = 6;
+// Views one multi-view cull handles together, one bit each in a uint8_t view mask
+static constexpr uint32_t MAX_CULL_VIEWS = 8;
+
+enum class FrustumPlane : uint32_t
+{
+    Left = 0,
+    Right,
+    Bottom,
+    Top,
+    Near,
+    Far
+};
+
+struct Frustum
+{
+    // Planes are stored as (normal, distance) with the normal pointing into the frustum,
+    // so a point p is inside a plane when dot(normal, p) + distance >= 0
+    std::array<XMFLOAT4, FRUSTUM_PLANE_COUNT> planes = {};
+
+    // Extracts normalized planes from a row-vector view projection matrix with a [0, 1] depth range
+    static Frustum FromMatrix(FXMMATRIX viewProjection);
+
+    bool IntersectsAABB(const AABB& bounds) const;
+    bool ContainsPoint(const XMFLOAT3& point) const;
+};
@@ -0,0 +1,235 @@
+#include "stdafx.h"
+#include "Culling/FrustumCuller.h"
+
+#include <bit>
+#include <immintrin.h>
+
+namespace
+{
+#if defined(__AVX2__)
+    // For every 8 bit visibility mask, the lane permutation that packs the visible lanes to the front
+    constexpr std::array<std::array<int32_t, 8>, 256> BuildCompactionTable()
+    {
+        std::array<std::array<int32_t, 8>, 256> table = {};
+        for (uint32_t mask = 0; mask < 256; ++mask)
+        {
+            uint32_t count = 0;
+            for (int32_t lane = 0; lane < 8; ++lane)
+            {
+                if (mask & (1u << lane))
+                {
+                    table[mask][count++] = lane;
+                }
+            }
+        }
+        return table;
+    }
+
+    alignas(32) constexpr std::array<std::array<int32_t, 8>, 256> COMPACTION_TABLE = BuildCompactionTable();
+#endif
+}
+
+void FrustumCuller::Reserve(size_t instanceCount)
+{
+    m_minX.reserve(instanceCount);
+    m_minY.reserve(instanceCount);
+    m_minZ.reserve(instanceCount);
+    m_maxX.reserve(instanceCount);
+    m_maxY.reserve(instanceCount);
+    m_maxZ.reserve(instanceCount);
+}
+
+void FrustumCuller::Clear()
+{
+    m_minX.clear();
+    m_minY.clear();
+    m_minZ.clear();
+    m_maxX.clear();
+    m_maxY.clear();
+    m_maxZ.clear();
+}
+
+uint32_t FrustumCuller::AddInstance(const AABB& bounds)
+{
+    assertm(m_minX.size() < UINT32_MAX, "FrustumCuller instance count exceeds 32-bit index range");
+
+    uint32_t instanceIndex = static_cast<uint32_t>(m_minX.size());
+    m_minX.push_back(bounds.min.x);
+    m_minY.push_back(bounds.min.y);
+    m_minZ.push_back(bounds.min.z);
+    m_maxX.push_back(bounds.max.x);
+    m_maxY.push_back(bounds.max.y);
+    m_maxZ.push_back(bounds.max.z);
+    return instanceIndex;
+}
+
+void FrustumCuller::SetInstanceBounds(uint32_t instanceIndex, const AABB& bounds)
+{
+    assert(instanceIndex < m_minX.size());
+
+    m_minX[instanceIndex] = bounds.min.x;
+    m_minY[instanceIndex] = bounds.min.y;
+    m_minZ[instanceIndex] = bounds.min.z;
+    m_maxX[instanceIndex] = bounds.max.x;
+    m_maxY[instanceIndex] = bounds.max.y;
+    m_maxZ[instanceIndex] = bounds.max.z;
+}
+
+AABB FrustumCuller::GetInstanceBounds(uint32_t instanceIndex) const
+{
+    assert(instanceIndex < m_minX.size());
+
+    AABB bounds;
+    bounds.min = XMFLOAT3(m_minX[instanceIndex], m_minY[instanceIndex], m_minZ[instanceIndex]);
+    bounds.max = XMFLOAT3(m_maxX[instanceIndex], m_maxY[instanceIndex], m_maxZ[instanceIndex]);
+    return bounds;
+}
+
+size_t FrustumCuller::Cull(const Frustum& frustum, uint32_t* outVisibleIndices, CullPath path) const
+{
+    assertm(outVisibleIndices != nullptr, "FrustumCuller::Cull called with null output buffer");
+    assertm(IsCullPathSupported(path), "FrustumCuller::Cull called with a path this build does not support");
+
+    PlaneStreams streams[FRUSTUM_PLANE_COUNT];
+    SelectPlaneStreams(frustum, streams);
+
+    switch (path)
+    {
+    case CullPath::AVX2:
+        return CullAVX2(streams, outVisibleIndices);
+    case CullPath::SSE:
+        return CullSSE(streams, outVisibleIndices);
+    default:
+        return CullScalar(streams, 0, GetInstanceCount(), outVisibleIndices);
+    }
+}
+
+size_t FrustumCuller::Cull(const Frustum& frustum, std::vector<uint32_t>& outVisibleIndices, CullPath path) const
+{
+    outVisibleIndices.resize(GetInstanceCount() + OUTPUT_PADDING);
+    size_t visibleCount = Cull(frustum, outVisibleIndices.data(), path);
+    outVisibleIndices.resize(visibleCount);
+    return visibleCount;
+}
+
+bool FrustumCuller::IsCullPathSupported(CullPath path)
+{
+    return path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2;
+}
+
+void FrustumCuller::SelectPlaneStreams(const Frustum& frustum, PlaneStreams* outStreams) const
+{
+    for (uint32_t i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+    {
+        const XMFLOAT4& plane = frustum.planes[i];
+        outStreams[i].x = plane.x >= 0.0f ? m_maxX.data() : m_minX.data();
+        outStreams[i].y = plane.y >= 0.0f ? m_maxY.data() : m_minY.data();
+        outStreams[i].z = plane.z >= 0.0f ? m_maxZ.data() : m_minZ.data();
+        outStreams[i].plane = plane;
+    }
+}
+
+size_t FrustumCuller::CullScalar(const PlaneStreams* streams, size_t begin, size_t end, uint32_t* outVisibleIndices) const
+{
+    size_t visibleCount = 0;
+    for (size_t i = begin; i < end; ++i)
+    {
+        bool outside = false;
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            const PlaneStreams& s = streams[p];
+            float distance = s.plane.x * s.x[i] + s.plane.y * s.y[i] + s.plane.z * s.z[i] + s.plane.w;
+            outside |= distance < 0.0f;
+        }
+
+        // Branch free compaction: always write, only advance when visible
+        outVisibleIndices[visibleCount] = static_cast<uint32_t>(i);
+        visibleCount += outside ? 0 : 1;
+    }
+    return visibleCount;
+}
+
+size_t FrustumCuller::CullSSE(const PlaneStreams* streams, uint32_t* outVisibleIndices) const
+{
+    const size_t count = GetInstanceCount();
+    const size_t simdCount = count & ~size_t(3);
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 nx[FRUSTUM_PLANE_COUNT], ny[FRUSTUM_PLANE_COUNT], nz[FRUSTUM_PLANE_COUNT], nw[FRUSTUM_PLANE_COUNT];
+    for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        nx[p] = _mm_set1_ps(streams[p].plane.x);
+        ny[p] = _mm_set1_ps(streams[p].plane.y);
+        nz[p] = _mm_set1_ps(streams[p].plane.z);
+        nw[p] = _mm_set1_ps(streams[p].plane.w);
+    }
+
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < simdCount; i += 4)
+    {
+        __m128 outside = _mm_setzero_ps();
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            __m128 distance = _mm_mul_ps(nx[p], _mm_loadu_ps(streams[p].x + i));
+            distance = _mm_add_ps(distance, _mm_mul_ps(ny[p], _mm_loadu_ps(streams[p].y + i)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(nz[p], _mm_loadu_ps(streams[p].z + i)));
+            distance = _mm_add_ps(distance, nw[p]);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+        }
+
+        uint32_t visibleMask = ~static_cast<uint32_t>(_mm_movemask_ps(outside)) & 0xFu;
+        while (visibleMask)
+        {
+            outVisibleIndices[visibleCount++] = static_cast<uint32_t>(i) + std::countr_zero(visibleMask);
+            visibleMask &= visibleMask - 1;
+        }
+    }
+
+    return visibleCount + CullScalar(streams, simdCount, count, outVisibleIndices + visibleCount);
+}
+
+size_t FrustumCuller::CullAVX2(const PlaneStreams* streams, uint32_t* outVisibleIndices) const
+{
+#if defined(__AVX2__)
+    const size_t count = GetInstanceCount();
+    const size_t simdCount = count & ~size_t(7);
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 nx[FRUSTUM_PLANE_COUNT], ny[FRUSTUM_PLANE_COUNT], nz[FRUSTUM_PLANE_COUNT], nw[FRUSTUM_PLANE_COUNT];
+    for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        nx[p] = _mm256_set1_ps(streams[p].plane.x);
+        ny[p] = _mm256_set1_ps(streams[p].plane.y);
+        nz[p] = _mm256_set1_ps(streams[p].plane.z);
+        nw[p] = _mm256_set1_ps(streams[p].plane.w);
+    }
+
+    __m256i indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i indexStep = _mm256_set1_epi32(8);
+
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < simdCount; i += 8)
+    {
+        __m256 outside = _mm256_setzero_ps();
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            __m256 distance = _mm256_mul_ps(nx[p], _mm256_loadu_ps(streams[p].x + i));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(ny[p], _mm256_loadu_ps(streams[p].y + i)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(nz[p], _mm256_loadu_ps(streams[p].z + i)));
+            distance = _mm256_add_ps(distance, nw[p]);
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero, _CMP_LT_OQ));
+        }
+
+        uint32_t visibleMask = ~static_cast<uint32_t>(_mm256_movemask_ps(outside)) & 0xFFu;
+        __m256i permutation = _mm256_load_si256(reinterpret_cast<const __m256i*>(COMPACTION_TABLE[visibleMask].data()));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(outVisibleIndices + visibleCount), _mm256_permutevar8x32_epi32(indices, permutation));
+        visibleCount += std::popcount(visibleMask);
+        indices = _mm256_add_epi32(indices, indexStep);
+    }
+
+    return visibleCount + CullScalar(streams, simdCount, count, outVisibleIndices + visibleCount);
+#else
+    assertm(false, "FrustumCuller::CullAVX2 called in a build without AVX2 support");
+    return CullScalar(streams, 0, GetInstanceCount(), outVisibleIndices);
+#endif
+}
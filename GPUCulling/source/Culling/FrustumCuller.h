@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include "Culling/CullingCommon.h"
+#include "Culling/Frustum.h"
+#include <vector>
+#include <cstdint>
+
+// Frustum culls a flat list of instance AABBs stored as structure-of-arrays.
+// The SIMD paths test 4 (SSE) or 8 (AVX2) boxes per iteration and write a compact list of visible instance indices.
+class FrustumCuller
+{
+    FrustumCuller(const FrustumCuller&) = delete;
+    FrustumCuller& operator=(const FrustumCuller&) = delete;
+
+public:
+    // The SIMD paths store a full register of indices per iteration, so output buffers need this much slack
+    static constexpr size_t OUTPUT_PADDING = 8;
+
+    FrustumCuller() = default;
+    ~FrustumCuller() = default;
+
+    void Reserve(size_t instanceCount);
+    void Clear();
+
+    uint32_t AddInstance(const AABB& bounds);
+    void SetInstanceBounds(uint32_t instanceIndex, const AABB& bounds);
+    AABB GetInstanceBounds(uint32_t instanceIndex) const;
+    size_t GetInstanceCount() const { return m_minX.size(); }
+
+    // outVisibleIndices must hold at least GetInstanceCount() + OUTPUT_PADDING elements. Returns the visible count.
+    size_t Cull(const Frustum& frustum, uint32_t* outVisibleIndices, CullPath path = DEFAULT_CULL_PATH) const;
+    size_t Cull(const Frustum& frustum, std::vector<uint32_t>& outVisibleIndices, CullPath path = DEFAULT_CULL_PATH) const;
+
+    static bool IsCullPathSupported(CullPath path);
+
+private:
+    // Per plane the p-vertex component arrays are chosen once, so the inner loops are branch free
+    struct PlaneStreams
+    {
+        const float* x = nullptr;
+        const float* y = nullptr;
+        const float* z = nullptr;
+        XMFLOAT4 plane = {};
+    };
+
+    void SelectPlaneStreams(const Frustum& frustum, PlaneStreams* outStreams) const;
+    size_t CullScalar(const PlaneStreams* streams, size_t begin, size_t end, uint32_t* outVisibleIndices) const;
+    size_t CullSSE(const PlaneStreams* streams, uint32_t* outVisibleIndices) const;
+    size_t CullAVX2(const PlaneStreams* streams, uint32_t* outVisibleIndices) const;
+
+    std::vector<float> m_minX;
+    std::vector<float> m_minY;
+    std::vector<float> m_minZ;
+    std::vector<float> m_maxX;
+    std::vector<float> m_maxY;
+    std::vector<float> m_maxZ;
+};
@@ -0,0 +1,166 @@
+#include "stdafx.h"
+#include "Culling/HiZPyramid.h"
+#include "Shaders/HiZShared.h"
+
+#include <cmath>
+
+uint32_t HiZPyramid::ComputeMipCount(uint32_t width, uint32_t height)
+{
+    uint32_t mipCount = 1;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(width >> 1, 1u);
+        height = std::max(height >> 1, 1u);
+        ++mipCount;
+    }
+    return mipCount;
+}
+
+void HiZPyramid::Build(const float* depth, uint32_t width, uint32_t height)
+{
+    assertm(depth != nullptr && width > 0 && height > 0, "HiZPyramid::Build called with an empty depth image");
+
+    m_levels.resize(ComputeMipCount(width, height));
+
+    Level& base = m_levels[0];
+    base.width = width;
+    base.height = height;
+    base.depth.assign(depth, depth + static_cast<size_t>(width) * height);
+
+    for (size_t mip = 1; mip < m_levels.size(); ++mip)
+    {
+        ReduceLevel(m_levels[mip - 1], m_levels[mip]);
+    }
+}
+
+void HiZPyramid::ReduceLevel(const Level& source, Level& destination)
+{
+    destination.width = std::max(source.width >> 1, 1u);
+    destination.height = std::max(source.height >> 1, 1u);
+    destination.depth.resize(static_cast<size_t>(destination.width) * destination.height);
+
+    // Odd sources have one row/column left over, the last destination texel covers a 3 texel footprint
+    bool extraColumn = (source.width & 1) != 0 && source.width > 1;
+    bool extraRow = (source.height & 1) != 0 && source.height > 1;
+
+    for (uint32_t y = 0; y < destination.height; ++y)
+    {
+        uint32_t footprintHeight = (extraRow && y == destination.height - 1) ? 3 : 2;
+        for (uint32_t x = 0; x < destination.width; ++x)
+        {
+            uint32_t footprintWidth = (extraColumn && x == destination.width - 1) ? 3 : 2;
+
+            float farthest = 0.0f;
+            for (uint32_t dy = 0; dy < footprintHeight; ++dy)
+            {
+                uint32_t sy = std::min(y * 2 + dy, source.height - 1);
+                for (uint32_t dx = 0; dx < footprintWidth; ++dx)
+                {
+                    uint32_t sx = std::min(x * 2 + dx, source.width - 1);
+                    farthest = std::max(farthest, source.depth[static_cast<size_t>(sy) * source.width + sx]);
+                }
+            }
+            destination.depth[static_cast<size_t>(y) * destination.width + x] = farthest;
+        }
+    }
+}
+
+bool HiZPyramid::IsVisible(const AABB& bounds, FXMMATRIX viewProjection) const
+{
+    assertm(!m_levels.empty(), "HiZPyramid::IsVisible called before Build");
+
+    float uvMinX = FLT_MAX;
+    float uvMinY = FLT_MAX;
+    float uvMaxX = -FLT_MAX;
+    float uvMaxY = -FLT_MAX;
+    float zMin = FLT_MAX;
+
+    for (uint32_t corner = 0; corner < 8; ++corner)
+    {
+        XMFLOAT3 position(
+            (corner & 1) ? bounds.max.x : bounds.min.x,
+            (corner & 2) ? bounds.max.y : bounds.min.y,
+            (corner & 4) ? bounds.max.z : bounds.min.z
+        );
+
+        XMFLOAT4 clip;
+        XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&position), viewProjection));
+        if (clip.w <= 0.0f)
+        {
+            return true;
+        }
+
+        float invW = 1.0f / clip.w;
+        float u = clip.x * invW * 0.5f + 0.5f;
+        float v = clip.y * invW * -0.5f + 0.5f;
+        uvMinX = std::min(uvMinX, u);
+        uvMinY = std::min(uvMinY, v);
+        uvMaxX = std::max(uvMaxX, u);
+        uvMaxY = std::max(uvMaxY, v);
+        zMin = std::min(zMin, clip.z * invW);
+    }
+
+    if (uvMaxX < 0.0f || uvMaxY < 0.0f || uvMinX > 1.0f || uvMinY > 1.0f || zMin > 1.0f)
+    {
+        return false;
+    }
+
+    uvMinX = std::clamp(uvMinX, 0.0f, 1.0f);
+    uvMinY = std::clamp(uvMinY, 0.0f, 1.0f);
+    uvMaxX = std::clamp(uvMaxX, 0.0f, 1.0f);
+    uvMaxY = std::clamp(uvMaxY, 0.0f, 1.0f);
+
+    // The rectangle is found once on level 0 and carried down the footprints of the reduction, so every level covers
+    // at least the texels the level 0 rectangle does. Walk down to the first level where it touches at most 2x2 texels.
+    const Level& base = m_levels[0];
+    uint32_t baseX0 = std::min(static_cast<uint32_t>(std::floor(uvMinX * (float)base.width)), base.width - 1);
+    uint32_t baseX1 = std::min(static_cast<uint32_t>(std::floor(uvMaxX * (float)base.width)), base.width - 1);
+    uint32_t baseY0 = std::min(static_cast<uint32_t>(std::floor(uvMinY * (float)base.height)), base.height - 1);
+    uint32_t baseY1 = std::min(static_cast<uint32_t>(std::floor(uvMaxY * (float)base.height)), base.height - 1);
+
+    uint32_t mip = 0;
+    uint32_t x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+    for (;;)
+    {
+        const Level& level = m_levels[mip];
+        x0 = ShaderInterop::GetHiZTexel(baseX0, mip, level.width);
+        x1 = ShaderInterop::GetHiZTexel(baseX1, mip, level.width);
+        y0 = ShaderInterop::GetHiZTexel(baseY0, mip, level.height);
+        y1 = ShaderInterop::GetHiZTexel(baseY1, mip, level.height);
+        if ((x1 - x0 <= 1 && y1 - y0 <= 1) || mip + 1 == m_levels.size())
+        {
+            break;
+        }
+        ++mip;
+    }
+
+    const Level& level = m_levels[mip];
+    float farthest = 0.0f;
+    for (uint32_t y = y0; y <= y1; ++y)
+    {
+        for (uint32_t x = x0; x <= x1; ++x)
+        {
+            farthest = std::max(farthest, level.depth[static_cast<size_t>(y) * level.width + x]);
+        }
+    }
+
+    return zMin <= farthest;
+}
+
+void HiZPyramid::CullInstances(const AABB* bounds, size_t instanceCount, FXMMATRIX viewProjection,
+    std::vector<uint32_t>& inOutVisibility, std::vector<uint32_t>& outNewlyVisible) const
+{
+    inOutVisibility.resize(instanceCount, 0);
+    outNewlyVisible.clear();
+
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        uint32_t flags = IsVisible(bounds[i], viewProjection) ? ShaderInterop::HIZ_VISIBLE : 0u;
+        if (flags != 0 && (inOutVisibility[i] & ShaderInterop::HIZ_VISIBLE) == 0)
+        {
+            flags |= ShaderInterop::HIZ_NEWLY_VISIBLE;
+            outNewlyVisible.push_back(static_cast<uint32_t>(i));
+        }
+        inOutVisibility[i] = flags;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+
+using namespace DirectX;
+
+// CPU reference of the GPU Hi-Z pyramid used by two phase occlusion culling.
+// Level 0 is a copy of the depth buffer and every further level halves the resolution (rounding down).
+// Texels keep the farthest depth of their footprint, which is the conservative reduction for the renderer
+// convention of 0 = near and 1 = far. Odd source sizes fold the extra row/column into the last texel.
+// HiZBuild.hlsl and HiZCull.hlsl mirror this code; the pyramid only uses max() so it is bit exact.
+class HiZPyramid
+{
+    HiZPyramid(const HiZPyramid&) = delete;
+    HiZPyramid& operator=(const HiZPyramid&) = delete;
+
+public:
+    struct Level
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<float> depth;
+    };
+
+    HiZPyramid() = default;
+    ~HiZPyramid() = default;
+
+    void Build(const float* depth, uint32_t width, uint32_t height);
+
+    // Tests a world space box against the pyramid. Boxes crossing the near plane are always visible.
+    bool IsVisible(const AABB& bounds, FXMMATRIX viewProjection) const;
+
+    // Reference for the GPU cull pass: updates the per instance HIZ_VISIBLE and HIZ_NEWLY_VISIBLE flags and lists the
+    // instances that were hidden last frame but are visible now, i.e. the ones phase two has to draw
+    void CullInstances(const AABB* bounds, size_t instanceCount, FXMMATRIX viewProjection,
+        std::vector<uint32_t>& inOutVisibility, std::vector<uint32_t>& outNewlyVisible) const;
+
+    uint32_t GetMipCount() const { return static_cast<uint32_t>(m_levels.size()); }
+    const Level& GetLevel(uint32_t mip) const { return m_levels[mip]; }
+
+    static uint32_t ComputeMipCount(uint32_t width, uint32_t height);
+    static void ReduceLevel(const Level& source, Level& destination);
+
+private:
+    std::vector<Level> m_levels;
+};
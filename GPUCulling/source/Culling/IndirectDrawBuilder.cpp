@@ -0,0 +1,151 @@
+#include "stdafx.h"
+#include "Culling/IndirectDrawBuilder.h"
+
+#include <cstring>
+
+using namespace ShaderInterop;
+
+namespace
+{
+    static_assert(sizeof(DrawIndexedArguments) == INDIRECT_DRAW_ARGUMENT_UINTS * sizeof(uint32_t), "Draw arguments have to stay tightly packed");
+
+    uint32_t DivideRoundUp(uint32_t value, uint32_t divisor)
+    {
+        return (value + divisor - 1) / divisor;
+    }
+}
+
+void IndirectDrawBuilder::SetInstances(const BoundsQuantization& boundsQuantization, const DrawInstance* instances, size_t instanceCount)
+{
+    assertm(instanceCount < UINT32_MAX, "IndirectDrawBuilder instance count exceeds 32-bit index range");
+
+    m_boundsQuantization = boundsQuantization;
+    m_instances.assign(instances, instances + instanceCount);
+    m_groupOffsets.assign(DivideRoundUp(static_cast<uint32_t>(instanceCount), INDIRECT_DRAW_GROUP_SIZE), 0);
+    m_argumentBuffer.assign(GetArgumentBufferSize(static_cast<uint32_t>(instanceCount)) / sizeof(uint32_t), 0);
+}
+
+void IndirectDrawBuilder::Clear()
+{
+    m_instances.clear();
+    m_groupOffsets.clear();
+    m_argumentBuffer.clear();
+}
+
+DrawInstance IndirectDrawBuilder::MakeInstance(const AABB& bounds, const BoundsQuantization& boundsQuantization, uint32_t meshHandle,
+    uint32_t firstIndex, uint32_t indexCount, uint32_t visibilityIndex)
+{
+    DrawInstance instance = {};
+    instance.bounds = QuantizeBounds(bounds, boundsQuantization);
+    instance.meshHandle = meshHandle;
+    instance.firstIndex = firstIndex;
+    instance.indexCount = indexCount;
+    instance.visibilityIndex = visibilityIndex;
+    return instance;
+}
+
+IndirectDrawConstants IndirectDrawBuilder::BuildConstants(const Frustum& frustum, const BoundsQuantization& boundsQuantization, uint32_t instanceCount,
+    uint32_t geometryCount, uint32_t visibilityMask, uint32_t visibilityCount)
+{
+    IndirectDrawConstants constants = {};
+    for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        constants.frustumPlanes[p] = frustum.planes[p];
+    }
+    constants.boundsQuantization = boundsQuantization;
+    constants.instanceCount = instanceCount;
+    constants.groupCount = DivideRoundUp(instanceCount, INDIRECT_DRAW_GROUP_SIZE);
+    constants.geometryCount = geometryCount;
+    constants.visibilityMask = visibilityMask;
+    constants.visibilityCount = visibilityCount;
+    return constants;
+}
+
+uint64_t IndirectDrawBuilder::GetArgumentBufferSize(uint32_t instanceCount)
+{
+    return INDIRECT_DRAW_ARGUMENTS_OFFSET + uint64_t(instanceCount) * sizeof(DrawIndexedArguments);
+}
+
+bool IndirectDrawBuilder::IsVisible(const DrawInstance& instance, const IndirectDrawConstants& constants, const GeometryDescriptor* geometry,
+    const uint32_t* visibility) const
+{
+    // Same fallback as GetVisibilityFlags in the shader
+    uint32_t visibilityFlags = constants.visibilityMask != 0 && instance.visibilityIndex < constants.visibilityCount ?
+        visibility[instance.visibilityIndex] : HIZ_VISIBLE;
+    return instance.meshHandle < constants.geometryCount && IsDrawInstanceResident(instance, geometry[instance.meshHandle], constants) &&
+        IsDrawInstanceSelected(visibilityFlags, constants) && IsDrawInstanceVisible(instance, constants);
+}
+
+void IndirectDrawBuilder::Build(const Frustum& frustum, const std::vector<GeometryDescriptor>& geometry)
+{
+    Build(BuildConstants(frustum, m_boundsQuantization, GetInstanceCount(), static_cast<uint32_t>(geometry.size())), geometry.data());
+}
+
+void IndirectDrawBuilder::Build(const Frustum& frustum, const std::vector<GeometryDescriptor>& geometry, const std::vector<uint32_t>& visibility,
+    uint32_t visibilityMask)
+{
+    Build(BuildConstants(frustum, m_boundsQuantization, GetInstanceCount(), static_cast<uint32_t>(geometry.size()), visibilityMask,
+        static_cast<uint32_t>(visibility.size())), geometry.data(), visibility.data());
+}
+
+void IndirectDrawBuilder::Build(const IndirectDrawConstants& constants, const GeometryDescriptor* geometry, const uint32_t* visibility)
+{
+    assertm(constants.instanceCount == m_instances.size(), "IndirectDrawBuilder::Build called with constants of a different instance buffer");
+    assertm(constants.groupCount == m_groupOffsets.size(), "IndirectDrawBuilder::Build called with a mismatched group count");
+    assertm(constants.visibilityMask == 0 || constants.visibilityCount == 0 || visibility != nullptr,
+        "IndirectDrawBuilder::Build called with a visibility mask but no visibility flags");
+
+    // CSCountVisible
+    for (uint32_t group = 0; group < constants.groupCount; ++group)
+    {
+        uint32_t begin = group * INDIRECT_DRAW_GROUP_SIZE;
+        uint32_t end = std::min(begin + INDIRECT_DRAW_GROUP_SIZE, constants.instanceCount);
+
+        uint32_t visibleCount = 0;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            visibleCount += IsVisible(m_instances[i], constants, geometry, visibility) ? 1 : 0;
+        }
+        m_groupOffsets[group] = visibleCount;
+    }
+
+    // CSScanGroups, the chunked scan of the shader adds up to the same exclusive prefix sum
+    uint32_t drawCount = 0;
+    for (uint32_t group = 0; group < constants.groupCount; ++group)
+    {
+        uint32_t count = m_groupOffsets[group];
+        m_groupOffsets[group] = drawCount;
+        drawCount += count;
+    }
+    m_argumentBuffer[INDIRECT_DRAW_COUNT_OFFSET / 4] = drawCount;
+
+    // CSWriteDraws, each visible instance lands after the visible ones before it in its group
+    for (uint32_t group = 0; group < constants.groupCount; ++group)
+    {
+        uint32_t begin = group * INDIRECT_DRAW_GROUP_SIZE;
+        uint32_t end = std::min(begin + INDIRECT_DRAW_GROUP_SIZE, constants.instanceCount);
+
+        uint32_t drawIndex = m_groupOffsets[group];
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            if (!IsVisible(m_instances[i], constants, geometry, visibility))
+            {
+                continue;
+            }
+
+            DrawIndexedArguments arguments = MakeDrawArguments(m_instances[i], geometry[m_instances[i].meshHandle], i);
+            uint32_t base = INDIRECT_DRAW_ARGUMENTS_OFFSET / 4 + drawIndex * INDIRECT_DRAW_ARGUMENT_UINTS;
+            std::memcpy(&m_argumentBuffer[base], &arguments, sizeof(arguments));
+            ++drawIndex;
+        }
+    }
+}
+
+DrawIndexedArguments IndirectDrawBuilder::GetDrawArguments(uint32_t drawIndex) const
+{
+    assert(drawIndex < GetDrawCount());
+
+    DrawIndexedArguments arguments;
+    std::memcpy(&arguments, &m_argumentBuffer[INDIRECT_DRAW_ARGUMENTS_OFFSET / 4 + drawIndex * INDIRECT_DRAW_ARGUMENT_UINTS], sizeof(arguments));
+    return arguments;
+}
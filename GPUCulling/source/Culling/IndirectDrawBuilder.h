@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include "Culling/Frustum.h"
+#include "Culling/QuantizedBounds.h"
+#include "Shaders/IndirectDrawShared.h"
+#include <vector>
+#include <cstdint>
+
+// CPU emulation of the GPU driven draw generation in IndirectDraw.hlsl. Culls the instance buffer against a frustum
+// and compacts the survivors into the ExecuteIndirect argument buffer: the draw count followed by one
+// DrawIndexedArguments per visible instance in ascending instance order. Build runs the count, scan and write passes
+// group by group, so the buffer is byte identical to the one the compute passes write from the same instances and
+// geometry descriptors.
+class IndirectDrawBuilder
+{
+    IndirectDrawBuilder(const IndirectDrawBuilder&) = delete;
+    IndirectDrawBuilder& operator=(const IndirectDrawBuilder&) = delete;
+
+public:
+    IndirectDrawBuilder() = default;
+    ~IndirectDrawBuilder() = default;
+
+    // The instance bounds are quantized in boundsQuantization
+    void SetInstances(const ShaderInterop::BoundsQuantization& boundsQuantization, const ShaderInterop::DrawInstance* instances,
+        size_t instanceCount);
+    void Clear();
+
+    // bounds have to lie inside the quantization cell, see IsInsideQuantization. firstIndex is relative to the first
+    // index of the mesh, a GeometryPool::GetLODRange range less the descriptor's firstIndex. visibilityIndex is the instance's slot in the
+    // Hi-Z visibility buffer.
+    static ShaderInterop::DrawInstance MakeInstance(const AABB& bounds, const ShaderInterop::BoundsQuantization& boundsQuantization,
+        uint32_t meshHandle, uint32_t firstIndex, uint32_t indexCount, uint32_t visibilityIndex);
+    // A visibilityMask of 0 draws every instance in the frustum, see IndirectDrawConstants::visibilityMask
+    static ShaderInterop::IndirectDrawConstants BuildConstants(const Frustum& frustum, const ShaderInterop::BoundsQuantization& boundsQuantization,
+        uint32_t instanceCount, uint32_t geometryCount, uint32_t visibilityMask = 0, uint32_t visibilityCount = 0);
+    // Bytes the argument buffer needs for every instance to be visible
+    static uint64_t GetArgumentBufferSize(uint32_t instanceCount);
+
+    // geometry holds constants.geometryCount descriptors indexed by mesh handle, see GeometryPool::GetDescriptors.
+    // visibility holds constants.visibilityCount Hi-Z flags, see HiZPyramid::CullInstances, and may be null while
+    // constants.visibilityMask is 0.
+    void Build(const ShaderInterop::IndirectDrawConstants& constants, const ShaderInterop::GeometryDescriptor* geometry,
+        const uint32_t* visibility = nullptr);
+    void Build(const Frustum& frustum, const std::vector<ShaderInterop::GeometryDescriptor>& geometry);
+    // One occlusion phase: only instances with one of the visibilityMask flags set are drawn
+    void Build(const Frustum& frustum, const std::vector<ShaderInterop::GeometryDescriptor>& geometry, const std::vector<uint32_t>& visibility,
+        uint32_t visibilityMask);
+
+    uint32_t GetInstanceCount() const { return static_cast<uint32_t>(m_instances.size()); }
+    const std::vector<ShaderInterop::DrawInstance>& GetInstances() const { return m_instances; }
+    const ShaderInterop::BoundsQuantization& GetBoundsQuantization() const { return m_boundsQuantization; }
+    // Laid out as the GPU argument buffer, only the first GetArgumentBufferSize(GetDrawCount()) bytes are written
+    const std::vector<uint32_t>& GetArgumentBuffer() const { return m_argumentBuffer; }
+    uint32_t GetDrawCount() const { return m_argumentBuffer.empty() ? 0 : m_argumentBuffer[ShaderInterop::INDIRECT_DRAW_COUNT_OFFSET / 4]; }
+    ShaderInterop::DrawIndexedArguments GetDrawArguments(uint32_t drawIndex) const;
+
+private:
+    bool IsVisible(const ShaderInterop::DrawInstance& instance, const ShaderInterop::IndirectDrawConstants& constants,
+        const ShaderInterop::GeometryDescriptor* geometry, const uint32_t* visibility) const;
+
+    std::vector<ShaderInterop::DrawInstance> m_instances;
+    ShaderInterop::BoundsQuantization m_boundsQuantization = {};
+    // Visible count per dispatch group, turned into the group's first draw by the scan
+    std::vector<uint32_t> m_groupOffsets;
+    std::vector<uint32_t> m_argumentBuffer;
+};
@@ -0,0 +1,140 @@
+#include "stdafx.h"
+#include "Culling/LODSelector.h"
+
+#include "Engine/Camera.h"
+#include "IO/GeometryPool.h"
+#include "IO/ModelData.h"
+
+#include <cmath>
+
+namespace
+{
+    // Coarsest level whose projected error stays within maxPixels, level 0 when none does
+    uint32_t FindCoarsestLOD(const float* lodErrors, uint32_t lodCount, float errorScale, float maxPixels)
+    {
+        uint32_t lod = 0;
+        for (uint32_t i = 1; i < lodCount; ++i)
+        {
+            if (lodErrors[i] * errorScale > maxPixels)
+            {
+                break;
+            }
+            lod = i;
+        }
+        return lod;
+    }
+}
+
+void LODSelector::SetView(const Camera& camera, float viewportHeight)
+{
+    SetView(camera.GetPosition(), camera.GetFOV(), camera.GetNearPlane(), viewportHeight);
+}
+
+void LODSelector::SetView(const XMFLOAT3& cameraPosition, float fovYDegrees, float nearPlane, float viewportHeight)
+{
+    assertm(fovYDegrees > 0.0f && fovYDegrees < 180.0f, "LODSelector::SetView called with an invalid field of view");
+
+    m_cameraPosition = cameraPosition;
+    m_nearPlane = nearPlane;
+    m_projectionScale = viewportHeight / (2.0f * std::tan(XMConvertToRadians(fovYDegrees) * 0.5f));
+}
+
+float LODSelector::ComputeProjectedError(float error, const Sphere& bounds) const
+{
+    float dx = bounds.center.x - m_cameraPosition.x;
+    float dy = bounds.center.y - m_cameraPosition.y;
+    float dz = bounds.center.z - m_cameraPosition.z;
+
+    // Inside the sphere the closest point is as near as anything can be drawn
+    float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - bounds.radius, m_nearPlane);
+    return error * m_projectionScale / distance;
+}
+
+uint32_t LODSelector::SelectLOD(const float* lodErrors, uint32_t lodCount, const Sphere& bounds, uint32_t currentLOD) const
+{
+    assert(lodErrors != nullptr || lodCount == 0);
+
+    if (lodCount <= 1)
+    {
+        return 0;
+    }
+
+    currentLOD = std::min(currentLOD, lodCount - 1);
+
+    // Error scale is shared by every level, only the per level error differs
+    float errorScale = ComputeProjectedError(1.0f, bounds);
+    uint32_t target = FindCoarsestLOD(lodErrors, lodCount, errorScale, m_pixelThreshold);
+
+    if (target > currentLOD)
+    {
+        // Only coarsen as far as the stricter threshold allows
+        uint32_t coarser = FindCoarsestLOD(lodErrors, lodCount, errorScale, m_pixelThreshold * (1.0f - m_hysteresis));
+        return std::max(currentLOD, coarser);
+    }
+
+    if (target < currentLOD && lodErrors[currentLOD] * errorScale <= m_pixelThreshold * (1.0f + m_hysteresis))
+    {
+        return currentLOD;
+    }
+
+    return target;
+}
+
+uint32_t LODSelector::SelectLOD(const MeshData& mesh, uint32_t currentLOD) const
+{
+    float lodErrors[16];
+    uint32_t lodCount = std::min(mesh.GetLODCount(), static_cast<uint32_t>(std::size(lodErrors)));
+    for (uint32_t i = 0; i < lodCount; ++i)
+    {
+        lodErrors[i] = mesh.GetLODError(i);
+    }
+    return SelectLOD(lodErrors, lodCount, mesh.boundingSphere, currentLOD);
+}
+
+void LODSelector::SelectLODs(const std::vector<MeshData>& meshes, std::vector<uint32_t>& inOutLODs) const
+{
+    inOutLODs.resize(meshes.size(), 0);
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        inOutLODs[i] = SelectLOD(meshes[i], inOutLODs[i]);
+    }
+}
+
+size_t LODSelector::SelectLODs(const GeometryPool& pool, const Sphere* worldSpheres, ShaderInterop::DrawInstance* instances, uint32_t* inOutLODs,
+    size_t instanceCount) const
+{
+    size_t switchCount = 0;
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        ShaderInterop::DrawInstance& instance = instances[i];
+        if (!pool.IsMeshValid(instance.meshHandle))
+        {
+            continue;
+        }
+
+        // The errors are in object space and scale with the instance like its sphere does
+        const ShaderInterop::GeometryDescriptor& descriptor = pool.GetDescriptor(instance.meshHandle);
+        float errorScale = descriptor.sphereRadius > 0.0f ? worldSpheres[i].radius / descriptor.sphereRadius : 1.0f;
+        const std::vector<float>& meshErrors = pool.GetLODErrors(instance.meshHandle);
+        float lodErrors[16];
+        uint32_t lodCount = std::min(static_cast<uint32_t>(meshErrors.size()), static_cast<uint32_t>(std::size(lodErrors)));
+        for (uint32_t lod = 0; lod < lodCount; ++lod)
+        {
+            lodErrors[lod] = meshErrors[lod] * errorScale;
+        }
+
+        uint32_t lod = SelectLOD(lodErrors, lodCount, worldSpheres[i], inOutLODs[i]);
+        if (lod == inOutLODs[i])
+        {
+            continue;
+        }
+
+        // The pool's ranges are absolute, the instance's are relative to the mesh so they survive defragmentation
+        GeometryPool::IndexRange range = pool.GetLODRange(instance.meshHandle, lod);
+        instance.firstIndex = range.firstIndex - descriptor.firstIndex;
+        instance.indexCount = range.indexCount;
+        inOutLODs[i] = lod;
+        ++switchCount;
+    }
+    return switchCount;
+}
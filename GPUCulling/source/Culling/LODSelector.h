@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include "Shaders/IndirectDrawShared.h"
+#include <vector>
+#include <cstdint>
+
+class Camera;
+class GeometryPool;
+struct MeshData;
+
+// Picks the coarsest level of detail whose geometric error projects to less than a pixel threshold.
+// Hysteresis keeps a mesh on its current level until the error moves clearly past the threshold, so meshes near
+// the switching distance do not pop back and forth between frames.
+class LODSelector
+{
+public:
+    static constexpr float DEFAULT_PIXEL_THRESHOLD = 1.0f;
+    static constexpr float DEFAULT_HYSTERESIS = 0.25f;
+
+    LODSelector() = default;
+    ~LODSelector() = default;
+
+    // Projected errors are measured against the camera's vertical FOV and the viewport height in pixels
+    void SetView(const Camera& camera, float viewportHeight);
+    void SetView(const XMFLOAT3& cameraPosition, float fovYDegrees, float nearPlane, float viewportHeight);
+
+    // A coarser level is only taken once its error drops below threshold * (1 - hysteresis), and the current
+    // level is kept until its error exceeds threshold * (1 + hysteresis)
+    void SetPixelThreshold(float pixels) { m_pixelThreshold = pixels; }
+    void SetHysteresis(float fraction) { m_hysteresis = fraction; }
+    float GetPixelThreshold() const { return m_pixelThreshold; }
+    float GetHysteresis() const { return m_hysteresis; }
+
+    // Size in pixels of a world space error at the point of the sphere closest to the camera
+    float ComputeProjectedError(float error, const Sphere& bounds) const;
+
+    // lodErrors must increase with the level index
+    uint32_t SelectLOD(const float* lodErrors, uint32_t lodCount, const Sphere& bounds, uint32_t currentLOD) const;
+    uint32_t SelectLOD(const MeshData& mesh, uint32_t currentLOD) const;
+
+    // inOutLODs holds last frame's levels and is resized to the mesh count, new entries start at full resolution
+    void SelectLODs(const std::vector<MeshData>& meshes, std::vector<uint32_t>& inOutLODs) const;
+    // Draw instances of pooled meshes with their world space bounding spheres, the mesh errors are scaled by the ratio
+    // of the world to the object space radius. inOutLODs holds the level each instance draws, an instance that switches
+    // gets the index range GeometryPool::GetLODRange has for the new level. Returns the number of instances that switched.
+    size_t SelectLODs(const GeometryPool& pool, const Sphere* worldSpheres, ShaderInterop::DrawInstance* instances, uint32_t* inOutLODs,
+        size_t instanceCount) const;
+
+private:
+    XMFLOAT3 m_cameraPosition = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    float m_nearPlane = 0.1f;
+    // Viewport height / (2 * tan(fovY / 2)): pixels covered by one world unit at distance one
+    float m_projectionScale = 1.0f;
+    float m_pixelThreshold = DEFAULT_PIXEL_THRESHOLD;
+    float m_hysteresis = DEFAULT_HYSTERESIS;
+};
@@ -0,0 +1,442 @@
+#include "stdafx.h"
+#include "Culling/LightGrid.h"
+
+#include "Culling/SIMDLanes.h"
+#include "Engine/Camera.h"
+#include "System/ThreadPool.h"
+
+#include <bit>
+
+using namespace ShaderInterop;
+using namespace SIMD;
+
+namespace
+{
+    // Multiple of every lane width so only the last batch has a scalar tail. Small enough that 10k lights spread
+    // over 40 range batches, which keeps every thread of a desktop CPU busy.
+    constexpr size_t LIGHT_BATCH_SIZE = 256;
+    constexpr uint32_t RANGE_MIN_MASK = 0xFFFF;
+
+    uint32_t RangeMin(uint32_t range) { return range & RANGE_MIN_MASK; }
+    uint32_t RangeMax(uint32_t range) { return range >> 16; }
+
+    uint32_t DivideRoundUp(uint32_t value, uint32_t divisor)
+    {
+        return (value + divisor - 1) / divisor;
+    }
+
+    // Plane through the eye at a tile boundary with view space slope x / z (or y / z), normalized so the distance
+    // compares directly against a radius
+    XMFLOAT2 BoundaryPlane(float sign, float slope)
+    {
+        float inverseLength = 1.0f / std::sqrt(1.0f + slope * slope);
+        return XMFLOAT2(sign * inverseLength, -sign * slope * inverseLength);
+    }
+}
+
+void LightGrid::ComputeTileBoundaries(uint32_t viewportWidth, uint32_t viewportHeight, float projectionScaleX, float projectionScaleY,
+    uint32_t tileSize, std::vector<LightGridBoundary>& boundaries)
+{
+    uint32_t columnCount = DivideRoundUp(viewportWidth, tileSize);
+    uint32_t rowCount = DivideRoundUp(viewportHeight, tileSize);
+    boundaries.resize(std::max({ boundaries.size(), size_t(columnCount) + 1, size_t(rowCount) + 1 }));
+
+    for (uint32_t k = 0; k <= columnCount; ++k)
+    {
+        float ndcX = float(std::min(k * tileSize, viewportWidth)) / float(viewportWidth) * 2.0f - 1.0f;
+        boundaries[k].columnPlane = BoundaryPlane(1.0f, ndcX / projectionScaleX);
+    }
+
+    // Rows count down the screen while view space y points up
+    for (uint32_t k = 0; k <= rowCount; ++k)
+    {
+        float ndcY = 1.0f - float(std::min(k * tileSize, viewportHeight)) / float(viewportHeight) * 2.0f;
+        boundaries[k].rowPlane = BoundaryPlane(-1.0f, ndcY / projectionScaleY);
+    }
+}
+
+void LightGrid::Configure(uint32_t viewportWidth, uint32_t viewportHeight, float projectionScaleX, float projectionScaleY,
+    float nearPlane, float farPlane, uint32_t tileSize, uint32_t sliceCount)
+{
+    assertm(viewportWidth > 0 && viewportHeight > 0, "LightGrid::Configure called with an empty viewport");
+    assertm(nearPlane > 0.0f && farPlane > nearPlane, "LightGrid needs 0 < near < far for exponential slices");
+    assertm(sliceCount > 0 && sliceCount <= LIGHT_GRID_MAX_SLICES, "LightGrid slice count out of range");
+
+    tileSize = std::max({ tileSize, 1u, DivideRoundUp(viewportWidth, LIGHT_GRID_MAX_TILES), DivideRoundUp(viewportHeight, LIGHT_GRID_MAX_TILES) });
+
+    m_viewportWidth = viewportWidth;
+    m_viewportHeight = viewportHeight;
+
+    XMUINT3 gridSize(DivideRoundUp(viewportWidth, tileSize), DivideRoundUp(viewportHeight, tileSize), sliceCount);
+    m_constants.gridSize = gridSize;
+    m_constants.clusterCount = gridSize.x * gridSize.y * gridSize.z;
+    m_constants.tileSize = tileSize;
+
+    m_boundaries.assign(gridSize.z + 1, LightGridBoundary{});
+    ComputeTileBoundaries(viewportWidth, viewportHeight, projectionScaleX, projectionScaleY, tileSize, m_boundaries);
+
+    // Exponential slices keep clusters roughly cubic in view space
+    double depthRatio = double(farPlane) / double(nearPlane);
+    for (uint32_t k = 0; k <= gridSize.z; ++k)
+    {
+        m_boundaries[k].sliceDepth = k == gridSize.z ? farPlane : float(nearPlane * std::pow(depthRatio, double(k) / gridSize.z));
+    }
+
+    m_cells.assign(m_constants.clusterCount, LightGridCell{});
+    m_lightIndices.clear();
+}
+
+void LightGrid::Configure(const Camera& camera, uint32_t viewportWidth, uint32_t viewportHeight, uint32_t tileSize, uint32_t sliceCount)
+{
+    XMFLOAT4X4 projection;
+    XMStoreFloat4x4(&projection, camera.GetProjectionMatrix());
+
+    Configure(viewportWidth, viewportHeight, projection._11, projection._22, camera.GetNearPlane(), camera.GetFarPlane(), tileSize, sliceCount);
+    SetView(camera.GetViewMatrix());
+}
+
+void LightGrid::SetView(FXMMATRIX view)
+{
+    XMFLOAT4X4 matrix;
+    XMStoreFloat4x4(&matrix, view);
+
+    m_constants.viewColumnX = XMFLOAT4(matrix._11, matrix._21, matrix._31, matrix._41);
+    m_constants.viewColumnY = XMFLOAT4(matrix._12, matrix._22, matrix._32, matrix._42);
+    m_constants.viewColumnZ = XMFLOAT4(matrix._13, matrix._23, matrix._33, matrix._43);
+}
+
+LightGridConstants LightGrid::GetConstants(size_t lightCount) const
+{
+    assertm(lightCount <= UINT32_MAX, "LightGrid light count exceeds 32-bit index range");
+
+    LightGridConstants constants = m_constants;
+    constants.lightCount = static_cast<uint32_t>(lightCount);
+    constants.maxLightIndices = m_maxLightIndices;
+    return constants;
+}
+
+uint32_t LightGrid::GetClusterIndex(uint32_t column, uint32_t row, uint32_t slice) const
+{
+    assert(column < m_constants.gridSize.x && row < m_constants.gridSize.y && slice < m_constants.gridSize.z);
+    return (slice * m_constants.gridSize.y + row) * m_constants.gridSize.x + column;
+}
+
+uint32_t LightGrid::GetClusterIndex(float pixelX, float pixelY, float viewZ) const
+{
+    const XMUINT3& gridSize = m_constants.gridSize;
+    if (viewZ < m_boundaries[0].sliceDepth || viewZ > m_boundaries[gridSize.z].sliceDepth)
+    {
+        return UINT32_MAX;
+    }
+
+    // The slice is looked up against the same boundaries the builder tested, never recomputed with log()
+    uint32_t slice = 0;
+    while (slice + 1 < gridSize.z && viewZ >= m_boundaries[slice + 1].sliceDepth)
+    {
+        ++slice;
+    }
+
+    uint32_t column = std::min(static_cast<uint32_t>(std::max(pixelX, 0.0f)) / m_constants.tileSize, gridSize.x - 1);
+    uint32_t row = std::min(static_cast<uint32_t>(std::max(pixelY, 0.0f)) / m_constants.tileSize, gridSize.y - 1);
+    return GetClusterIndex(column, row, slice);
+}
+
+size_t LightGrid::GetMemoryUsage() const
+{
+    return sizeof(LightGridCell) * m_cells.size() + sizeof(uint32_t) * size_t(m_maxLightIndices);
+}
+
+void LightGrid::Build(const LightList& lights, CullPath path)
+{
+    assertm(IsConfigured(), "LightGrid::Build called before Configure");
+    assertm(path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2, "LightGrid::Build called with a path this build does not support");
+
+    const size_t lightCount = lights.GetLightCount();
+    m_constants = GetConstants(lightCount);
+    m_lightRanges.resize(lightCount);
+
+    const uint32_t sliceCount = m_constants.gridSize.z;
+    const size_t batchCount = (lightCount + LIGHT_BATCH_SIZE - 1) / LIGHT_BATCH_SIZE;
+    m_batchSliceCursors.assign(batchCount * sliceCount, 0);
+
+    ThreadPool::Get().ParallelFor(lightCount, LIGHT_BATCH_SIZE, [&](size_t begin, size_t end)
+    {
+        switch (path)
+        {
+#if defined(__AVX2__)
+        case CullPath::AVX2:
+        {
+            size_t simdEnd = begin + ((end - begin) & ~size_t(7));
+            ComputeLightRanges<AVX2Lanes>(lights, begin, simdEnd);
+            ComputeLightRanges<ScalarLanes>(lights, simdEnd, end);
+            break;
+        }
+#endif
+        case CullPath::SSE:
+        {
+            size_t simdEnd = begin + ((end - begin) & ~size_t(3));
+            ComputeLightRanges<SSELanes>(lights, begin, simdEnd);
+            ComputeLightRanges<ScalarLanes>(lights, simdEnd, end);
+            break;
+        }
+        default:
+            ComputeLightRanges<ScalarLanes>(lights, begin, end);
+            break;
+        }
+
+        CountBatchSlices(begin / LIGHT_BATCH_SIZE, begin, end);
+    });
+
+    // Slice major, batch minor, so every slice lists its lights in ascending order
+    m_sliceLightOffsets.assign(sliceCount + 1, 0);
+    uint32_t sliceLightCount = 0;
+    for (uint32_t slice = 0; slice < sliceCount; ++slice)
+    {
+        m_sliceLightOffsets[slice] = sliceLightCount;
+        for (size_t batch = 0; batch < batchCount; ++batch)
+        {
+            uint32_t& cursor = m_batchSliceCursors[batch * sliceCount + slice];
+            uint32_t count = cursor;
+            cursor = sliceLightCount;
+            sliceLightCount += count;
+        }
+    }
+    m_sliceLightOffsets[sliceCount] = sliceLightCount;
+    m_sliceLights.resize(sliceLightCount);
+
+    ThreadPool::Get().ParallelFor(lightCount, LIGHT_BATCH_SIZE, [&](size_t begin, size_t end)
+    {
+        ScatterBatchSlices(begin / LIGHT_BATCH_SIZE, begin, end);
+    });
+
+    ThreadPool::Get().ParallelFor(sliceCount, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t slice = begin; slice < end; ++slice)
+        {
+            CountSlice(static_cast<uint32_t>(slice));
+        }
+    });
+
+    // Offsets follow the unclamped counts so a truncated cluster never shifts the ones after it
+    uint32_t offset = 0;
+    for (LightGridCell& cell : m_cells)
+    {
+        uint32_t capacity = offset < m_maxLightIndices ? m_maxLightIndices - offset : 0;
+        uint32_t count = cell.count;
+        cell.offset = offset;
+        cell.count = std::min(count, capacity);
+        offset += count;
+    }
+    m_lightIndices.resize(std::min(offset, m_maxLightIndices));
+    const bool isTruncated = offset > m_maxLightIndices;
+
+    ThreadPool::Get().ParallelFor(sliceCount, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t slice = begin; slice < end; ++slice)
+        {
+            FillSlice(static_cast<uint32_t>(slice), isTruncated);
+        }
+    });
+}
+
+template<typename Lanes>
+void LightGrid::ComputeLightRanges(const LightList& lights, size_t begin, size_t end)
+{
+    using Float = typename Lanes::Float;
+    using Mask = typename Lanes::Mask;
+    constexpr size_t WIDTH = Lanes::WIDTH;
+
+    const XMUINT3& gridSize = m_constants.gridSize;
+    const LightGridBoundary* boundaries = m_boundaries.data();
+
+    for (size_t i = begin; i < end; i += WIDTH)
+    {
+        Float x = Lanes::Load(lights.GetCullCenterX() + i);
+        Float y = Lanes::Load(lights.GetCullCenterY() + i);
+        Float z = Lanes::Load(lights.GetCullCenterZ() + i);
+        Float radius = Lanes::Load(lights.GetCullRadius() + i);
+
+        Float viewX = TransformToView<Float, Mask>(x, y, z, m_constants.viewColumnX);
+        Float viewY = TransformToView<Float, Mask>(x, y, z, m_constants.viewColumnY);
+        Float viewZ = TransformToView<Float, Mask>(x, y, z, m_constants.viewColumnZ);
+
+        // First and last overlapping index per axis, tracked branchlessly in float lanes. Indices stay far below
+        // 2^24 so the float round trip is exact.
+        const Float none = float(RANGE_MIN_MASK);
+        Float first[3] = { none, none, none };
+        Float last[3] = { -1.0f, -1.0f, -1.0f };
+        auto track = [&](uint32_t axis, uint32_t k, Mask overlaps)
+        {
+            Float index = float(k);
+            first[axis] = Lanes::Min(first[axis], Lanes::Select(overlaps, index, none));
+            last[axis] = Lanes::Select(overlaps, index, last[axis]);
+        };
+
+        uint32_t anySlice = 0;
+        for (uint32_t k = 0; k < gridSize.z; ++k)
+        {
+            Mask overlaps = SphereOverlapsSlice<Float, Mask>(viewZ, radius, boundaries[k].sliceDepth, boundaries[k + 1].sliceDepth);
+            track(2, k, overlaps);
+            anySlice |= Lanes::MoveMask(overlaps);
+        }
+
+        // Lights behind the camera or past the far plane skip the tile tests, the result is empty either way
+        if (anySlice)
+        {
+            Float lowDistance = TileBoundaryDistance<Float, Mask>(viewX, viewZ, boundaries[0].columnPlane);
+            for (uint32_t k = 0; k < gridSize.x; ++k)
+            {
+                Float highDistance = TileBoundaryDistance<Float, Mask>(viewX, viewZ, boundaries[k + 1].columnPlane);
+                track(0, k, SphereOverlapsTileSlab<Float, Mask>(lowDistance, highDistance, radius));
+                lowDistance = highDistance;
+            }
+
+            lowDistance = TileBoundaryDistance<Float, Mask>(viewY, viewZ, boundaries[0].rowPlane);
+            for (uint32_t k = 0; k < gridSize.y; ++k)
+            {
+                Float highDistance = TileBoundaryDistance<Float, Mask>(viewY, viewZ, boundaries[k + 1].rowPlane);
+                track(1, k, SphereOverlapsTileSlab<Float, Mask>(lowDistance, highDistance, radius));
+                lowDistance = highDistance;
+            }
+        }
+
+        float firstValues[3][WIDTH];
+        float lastValues[3][WIDTH];
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            Lanes::Store(firstValues[axis], first[axis]);
+            Lanes::Store(lastValues[axis], last[axis]);
+        }
+
+        for (size_t lane = 0; lane < WIDTH; ++lane)
+        {
+            LightClusterRange& range = m_lightRanges[i + lane];
+            if (lastValues[0][lane] < 0.0f || lastValues[1][lane] < 0.0f || lastValues[2][lane] < 0.0f)
+            {
+                range = { LIGHT_RANGE_EMPTY, LIGHT_RANGE_EMPTY, LIGHT_RANGE_EMPTY };
+                continue;
+            }
+
+            auto pack = [&](uint32_t axis)
+            {
+                return uint32_t(firstValues[axis][lane]) | (uint32_t(lastValues[axis][lane]) << 16);
+            };
+            range = { pack(0), pack(1), pack(2) };
+        }
+    }
+}
+
+void LightGrid::CountBatchSlices(size_t batch, size_t begin, size_t end)
+{
+    uint32_t* sliceCounts = &m_batchSliceCursors[batch * m_constants.gridSize.z];
+    for (size_t i = begin; i < end; ++i)
+    {
+        uint32_t slices = m_lightRanges[i].slices;
+        for (uint32_t slice = RangeMin(slices); slice <= RangeMax(slices); ++slice)
+        {
+            ++sliceCounts[slice];
+        }
+    }
+}
+
+void LightGrid::ScatterBatchSlices(size_t batch, size_t begin, size_t end)
+{
+    uint32_t* sliceCursors = &m_batchSliceCursors[batch * m_constants.gridSize.z];
+    for (size_t i = begin; i < end; ++i)
+    {
+        uint32_t slices = m_lightRanges[i].slices;
+        for (uint32_t slice = RangeMin(slices); slice <= RangeMax(slices); ++slice)
+        {
+            m_sliceLights[sliceCursors[slice]++] = static_cast<uint32_t>(i);
+        }
+    }
+}
+
+void LightGrid::CountSlice(uint32_t slice)
+{
+    const uint32_t columnCount = m_constants.gridSize.x;
+    const uint32_t rowCount = m_constants.gridSize.y;
+
+    // Every light adds a rectangle of the slice, so mark its corners and integrate once instead of touching
+    // every covered cell
+    std::vector<int32_t> corners((columnCount + 1) * (rowCount + 1), 0);
+    for (uint32_t i = m_sliceLightOffsets[slice]; i < m_sliceLightOffsets[slice + 1]; ++i)
+    {
+        const LightClusterRange& range = m_lightRanges[m_sliceLights[i]];
+        uint32_t column0 = RangeMin(range.columns), column1 = RangeMax(range.columns) + 1;
+        uint32_t row0 = RangeMin(range.rows), row1 = RangeMax(range.rows) + 1;
+        ++corners[row0 * (columnCount + 1) + column0];
+        --corners[row0 * (columnCount + 1) + column1];
+        --corners[row1 * (columnCount + 1) + column0];
+        ++corners[row1 * (columnCount + 1) + column1];
+    }
+
+    LightGridCell* cells = &m_cells[GetClusterIndex(0, 0, slice)];
+    std::vector<int32_t> columnSums(columnCount + 1, 0);
+    for (uint32_t row = 0; row < rowCount; ++row)
+    {
+        int32_t rowSum = 0;
+        for (uint32_t column = 0; column < columnCount; ++column)
+        {
+            columnSums[column] += corners[row * (columnCount + 1) + column];
+            rowSum += columnSums[column];
+            cells[row * columnCount + column].count = static_cast<uint32_t>(rowSum);
+        }
+    }
+}
+
+void LightGrid::FillSlice(uint32_t slice, bool isTruncated)
+{
+    const uint32_t columnCount = m_constants.gridSize.x;
+    const uint32_t sliceClusterCount = columnCount * m_constants.gridSize.y;
+    const LightGridCell* cells = &m_cells[GetClusterIndex(0, 0, slice)];
+
+    std::vector<uint32_t> cursors(sliceClusterCount);
+    for (uint32_t i = 0; i < sliceClusterCount; ++i)
+    {
+        cursors[i] = cells[i].offset;
+    }
+
+    uint32_t* lightIndices = m_lightIndices.data();
+    if (!isTruncated)
+    {
+        // Every list fits, so the writes need no capacity check
+        for (uint32_t i = m_sliceLightOffsets[slice]; i < m_sliceLightOffsets[slice + 1]; ++i)
+        {
+            uint32_t lightIndex = m_sliceLights[i];
+            const LightClusterRange& range = m_lightRanges[lightIndex];
+            for (uint32_t row = RangeMin(range.rows); row <= RangeMax(range.rows); ++row)
+            {
+                uint32_t* rowCursors = &cursors[row * columnCount];
+                for (uint32_t column = RangeMin(range.columns); column <= RangeMax(range.columns); ++column)
+                {
+                    lightIndices[rowCursors[column]++] = lightIndex;
+                }
+            }
+        }
+        return;
+    }
+
+    // The end of every cluster list only bites for clusters truncated by the capacity
+    std::vector<uint32_t> ends(sliceClusterCount);
+    for (uint32_t i = 0; i < sliceClusterCount; ++i)
+    {
+        ends[i] = cells[i].offset + cells[i].count;
+    }
+
+    for (uint32_t i = m_sliceLightOffsets[slice]; i < m_sliceLightOffsets[slice + 1]; ++i)
+    {
+        uint32_t lightIndex = m_sliceLights[i];
+        const LightClusterRange& range = m_lightRanges[lightIndex];
+        for (uint32_t row = RangeMin(range.rows); row <= RangeMax(range.rows); ++row)
+        {
+            for (uint32_t cluster = row * columnCount + RangeMin(range.columns); cluster <= row * columnCount + RangeMax(range.columns); ++cluster)
+            {
+                if (cursors[cluster] < ends[cluster])
+                {
+                    lightIndices[cursors[cluster]++] = lightIndex;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Culling/CullingCommon.h"
+#include "Culling/LightList.h"
+#include "Shaders/LightGridShared.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+
+using namespace DirectX;
+
+class Camera;
+
+// Clustered Forward+ light grid: screen tiles times exponential depth slices, each cluster holding a compact list
+// of the lights whose cull sphere overlaps it. This is the CPU builder, LightGrid.hlsl runs the same shared tests
+// from Shaders/LightGridShared.h and produces byte identical ranges, cells and light indices.
+class LightGrid
+{
+    LightGrid(const LightGrid&) = delete;
+    LightGrid& operator=(const LightGrid&) = delete;
+
+public:
+    static constexpr uint32_t DEFAULT_TILE_SIZE = 64;
+    static constexpr uint32_t DEFAULT_SLICE_COUNT = 24;
+    static constexpr uint32_t DEFAULT_MAX_LIGHT_INDICES = 1u << 20;
+
+    LightGrid() = default;
+    ~LightGrid() = default;
+
+    // Lays out the grid for a viewport and projection. The tile size grows if the screen would need more than
+    // LIGHT_GRID_MAX_TILES tiles along an axis.
+    void Configure(uint32_t viewportWidth, uint32_t viewportHeight, float projectionScaleX, float projectionScaleY,
+        float nearPlane, float farPlane, uint32_t tileSize = DEFAULT_TILE_SIZE, uint32_t sliceCount = DEFAULT_SLICE_COUNT);
+    void Configure(const Camera& camera, uint32_t viewportWidth, uint32_t viewportHeight,
+        uint32_t tileSize = DEFAULT_TILE_SIZE, uint32_t sliceCount = DEFAULT_SLICE_COUNT);
+    // Column and row planes for a screen split into square tiles, shared with the Z-binned light culler.
+    // Grows the boundary array as needed and leaves the slice depths alone.
+    static void ComputeTileBoundaries(uint32_t viewportWidth, uint32_t viewportHeight, float projectionScaleX, float projectionScaleY,
+        uint32_t tileSize, std::vector<ShaderInterop::LightGridBoundary>& boundaries);
+    void SetMaxLightIndices(uint32_t maxLightIndices) { m_maxLightIndices = maxLightIndices; }
+    void SetView(FXMMATRIX view);
+
+    // Assigns every light to the clusters its cull sphere overlaps, spread over the thread pool
+    void Build(const LightList& lights, CullPath path = DEFAULT_CULL_PATH);
+
+    bool IsConfigured() const { return m_constants.clusterCount != 0; }
+    // Constants for the compute builder, matching what Build used for the same view and light count
+    ShaderInterop::LightGridConstants GetConstants(size_t lightCount) const;
+    const std::vector<ShaderInterop::LightGridBoundary>& GetBoundaries() const { return m_boundaries; }
+
+    uint32_t GetClusterCount() const { return m_constants.clusterCount; }
+    uint32_t GetClusterIndex(uint32_t column, uint32_t row, uint32_t slice) const;
+    // Cluster containing a pixel at a view depth, or UINT32_MAX outside the near and far planes
+    uint32_t GetClusterIndex(float pixelX, float pixelY, float viewZ) const;
+
+    const std::vector<ShaderInterop::LightClusterRange>& GetLightRanges() const { return m_lightRanges; }
+    const std::vector<ShaderInterop::LightGridCell>& GetCells() const { return m_cells; }
+    const std::vector<uint32_t>& GetLightIndices() const { return m_lightIndices; }
+    // Bytes shading reads: the cells plus the full light index capacity the GPU allocates
+    size_t GetMemoryUsage() const;
+
+private:
+    template<typename Lanes>
+    void ComputeLightRanges(const LightList& lights, size_t begin, size_t end);
+    void CountBatchSlices(size_t batch, size_t begin, size_t end);
+    void ScatterBatchSlices(size_t batch, size_t begin, size_t end);
+    void CountSlice(uint32_t slice);
+    void FillSlice(uint32_t slice, bool isTruncated);
+
+    ShaderInterop::LightGridConstants m_constants = {};
+    std::vector<ShaderInterop::LightGridBoundary> m_boundaries;
+    uint32_t m_viewportWidth = 0;
+    uint32_t m_viewportHeight = 0;
+    uint32_t m_maxLightIndices = DEFAULT_MAX_LIGHT_INDICES;
+
+    std::vector<ShaderInterop::LightClusterRange> m_lightRanges;
+    std::vector<ShaderInterop::LightGridCell> m_cells;
+    std::vector<uint32_t> m_lightIndices;
+
+    // Lights touching each depth slice in ascending order, so slices can be filled independently. Built from
+    // per batch slice histograms, batch major, which double as the scatter cursors.
+    std::vector<uint32_t> m_batchSliceCursors;
+    std::vector<uint32_t> m_sliceLightOffsets;
+    std::vector<uint32_t> m_sliceLights;
+};
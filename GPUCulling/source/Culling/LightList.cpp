@@ -0,0 +1,119 @@
+#include "stdafx.h"
+#include "Culling/LightList.h"
+
+using namespace ShaderInterop;
+
+void LightList::Reserve(size_t lightCount)
+{
+    m_lights.reserve(lightCount);
+    for (std::vector<float>* stream : { &m_cullCenterX, &m_cullCenterY, &m_cullCenterZ, &m_cullRadius })
+    {
+        stream->reserve(lightCount);
+    }
+}
+
+void LightList::Clear()
+{
+    m_lights.clear();
+    for (std::vector<float>* stream : { &m_cullCenterX, &m_cullCenterY, &m_cullCenterZ, &m_cullRadius })
+    {
+        stream->clear();
+    }
+}
+
+uint32_t LightList::AddPointLight(const XMFLOAT3& position, float range, const XMFLOAT3& color, float intensity)
+{
+    LightData light = {};
+    light.position = position;
+    light.range = range;
+    light.color = color;
+    light.intensity = intensity;
+    light.direction = XMFLOAT3(0.0f, 0.0f, 1.0f);
+    light.spotCosOuter = -1.0f;
+    light.spotCosInner = -1.0f;
+    light.type = LIGHT_TYPE_POINT;
+    return AddLight(light);
+}
+
+uint32_t LightList::AddSpotLight(const XMFLOAT3& position, const XMFLOAT3& direction, float range, float innerAngleDegrees,
+    float outerAngleDegrees, const XMFLOAT3& color, float intensity)
+{
+    assertm(innerAngleDegrees <= outerAngleDegrees, "Spot light inner angle wider than its outer angle");
+
+    LightData light = {};
+    light.position = position;
+    light.range = range;
+    light.color = color;
+    light.intensity = intensity;
+    XMStoreFloat3(&light.direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+    light.spotCosOuter = std::cos(XMConvertToRadians(outerAngleDegrees));
+    light.spotCosInner = std::cos(XMConvertToRadians(innerAngleDegrees));
+    light.type = LIGHT_TYPE_SPOT;
+    return AddLight(light);
+}
+
+void LightList::SetPosition(uint32_t lightIndex, const XMFLOAT3& position)
+{
+    assert(lightIndex < m_lights.size());
+
+    m_lights[lightIndex].position = position;
+    UpdateCullSphere(lightIndex);
+}
+
+void LightList::SetDirection(uint32_t lightIndex, const XMFLOAT3& direction)
+{
+    assert(lightIndex < m_lights.size());
+
+    XMStoreFloat3(&m_lights[lightIndex].direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+    UpdateCullSphere(lightIndex);
+}
+
+uint32_t LightList::AddLight(const LightData& light)
+{
+    assertm(m_lights.size() < UINT32_MAX, "LightList light count exceeds 32-bit index range");
+
+    uint32_t lightIndex = static_cast<uint32_t>(m_lights.size());
+    m_lights.push_back(light);
+    m_cullCenterX.push_back(0.0f);
+    m_cullCenterY.push_back(0.0f);
+    m_cullCenterZ.push_back(0.0f);
+    m_cullRadius.push_back(0.0f);
+    UpdateCullSphere(lightIndex);
+    return lightIndex;
+}
+
+void LightList::UpdateCullSphere(uint32_t lightIndex)
+{
+    LightData& light = m_lights[lightIndex];
+
+    XMVECTOR position = XMLoadFloat3(&light.position);
+    XMVECTOR center = position;
+    float radius = light.range;
+
+    // Smallest sphere around the cone and its spherical cap. Past 45 degrees that is the sphere through the rim
+    // circle, below it the sphere touching apex and rim. Cones wider than a hemisphere keep the point light sphere.
+    const float cos45 = 0.70710678f;
+    if (light.type == LIGHT_TYPE_SPOT && light.spotCosOuter > 0.0f)
+    {
+        XMVECTOR direction = XMLoadFloat3(&light.direction);
+        if (light.spotCosOuter <= cos45)
+        {
+            float sinOuter = std::sqrt(std::max(0.0f, 1.0f - light.spotCosOuter * light.spotCosOuter));
+            center = XMVectorAdd(position, XMVectorScale(direction, light.range * light.spotCosOuter));
+            radius = light.range * sinOuter;
+        }
+        else
+        {
+            radius = light.range / (2.0f * light.spotCosOuter);
+            center = XMVectorAdd(position, XMVectorScale(direction, radius));
+        }
+    }
+
+    XMStoreFloat3(&light.cullCenter, center);
+    light.cullRadius = radius;
+
+    m_cullCenterX[lightIndex] = light.cullCenter.x;
+    m_cullCenterY[lightIndex] = light.cullCenter.y;
+    m_cullCenterZ[lightIndex] = light.cullCenter.z;
+    m_cullRadius[lightIndex] = radius;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Shaders/LightShared.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+
+using namespace DirectX;
+
+// Scene lights in the layout the GPU reads, plus structure-of-arrays copies of each light's cull sphere for the
+// SIMD light culling paths. Every light culling mode (clustered grid, Z-binned tiles) consumes the same list.
+class LightList
+{
+    LightList(const LightList&) = delete;
+    LightList& operator=(const LightList&) = delete;
+
+public:
+    LightList() = default;
+    ~LightList() = default;
+
+    void Reserve(size_t lightCount);
+    void Clear();
+
+    uint32_t AddPointLight(const XMFLOAT3& position, float range, const XMFLOAT3& color, float intensity);
+    // Cone angles are half angles in degrees, range is measured from the apex
+    uint32_t AddSpotLight(const XMFLOAT3& position, const XMFLOAT3& direction, float range, float innerAngleDegrees,
+        float outerAngleDegrees, const XMFLOAT3& color, float intensity);
+
+    // Dynamic lights move every frame, both keep the cull sphere in sync
+    void SetPosition(uint32_t lightIndex, const XMFLOAT3& position);
+    void SetDirection(uint32_t lightIndex, const XMFLOAT3& direction);
+
+    size_t GetLightCount() const { return m_lights.size(); }
+    const ShaderInterop::LightData& GetLight(uint32_t lightIndex) const { return m_lights[lightIndex]; }
+    const ShaderInterop::LightData* GetData() const { return m_lights.data(); }
+
+    const float* GetCullCenterX() const { return m_cullCenterX.data(); }
+    const float* GetCullCenterY() const { return m_cullCenterY.data(); }
+    const float* GetCullCenterZ() const { return m_cullCenterZ.data(); }
+    const float* GetCullRadius() const { return m_cullRadius.data(); }
+
+private:
+    uint32_t AddLight(const ShaderInterop::LightData& light);
+    void UpdateCullSphere(uint32_t lightIndex);
+
+    std::vector<ShaderInterop::LightData> m_lights;
+    std::vector<float> m_cullCenterX;
+    std::vector<float> m_cullCenterY;
+    std::vector<float> m_cullCenterZ;
+    std::vector<float> m_cullRadius;
+};
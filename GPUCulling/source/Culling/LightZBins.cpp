@@ -0,0 +1,412 @@
+#include "stdafx.h"
+#include "Culling/LightZBins.h"
+
+#include "Culling/LightGrid.h"
+#include "Culling/SIMDLanes.h"
+#include "Engine/Camera.h"
+#include "System/ThreadPool.h"
+
+#include <bit>
+
+using namespace ShaderInterop;
+using namespace SIMD;
+
+namespace
+{
+    // Multiple of every lane width so only the last batch has a scalar tail
+    constexpr size_t LIGHT_BATCH_SIZE = 1024;
+    constexpr uint32_t BIN_BATCH_SIZE = 256;
+    constexpr uint32_t MASK_WORD_BATCH_SIZE = 4;
+    constexpr uint32_t RANGE_MIN_MASK = 0xFFFF;
+    constexpr uint32_t RADIX_BITS = 11;
+    constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+
+    uint32_t RangeMin(uint32_t range) { return range & RANGE_MIN_MASK; }
+    uint32_t RangeMax(uint32_t range) { return range >> 16; }
+
+    uint32_t DivideRoundUp(uint32_t value, uint32_t divisor)
+    {
+        return (value + divisor - 1) / divisor;
+    }
+
+    // Flips the float bits so unsigned integer order matches float order, negatives included
+    uint32_t OrderedKey(float value)
+    {
+        uint32_t bits = std::bit_cast<uint32_t>(value);
+        return bits ^ ((bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u);
+    }
+}
+
+void LightZBins::Configure(uint32_t viewportWidth, uint32_t viewportHeight, float projectionScaleX, float projectionScaleY,
+    float nearPlane, float farPlane, uint32_t tileSize, uint32_t binCount)
+{
+    assertm(viewportWidth > 0 && viewportHeight > 0, "LightZBins::Configure called with an empty viewport");
+    assertm(nearPlane >= 0.0f && farPlane > nearPlane, "LightZBins needs 0 <= near < far");
+    assertm(binCount > 0 && binCount <= RANGE_MIN_MASK, "LightZBins bin count out of range");
+
+    tileSize = std::max({ tileSize, 1u, DivideRoundUp(viewportWidth, LIGHT_ZBIN_MAX_TILES), DivideRoundUp(viewportHeight, LIGHT_ZBIN_MAX_TILES) });
+
+    m_viewportWidth = viewportWidth;
+    m_viewportHeight = viewportHeight;
+    m_nearPlane = nearPlane;
+    m_farPlane = farPlane;
+
+    m_constants.tileCount = XMUINT2(DivideRoundUp(viewportWidth, tileSize), DivideRoundUp(viewportHeight, tileSize));
+    m_constants.tileSize = tileSize;
+    m_constants.binCount = binCount;
+    m_constants.binNear = nearPlane;
+    m_constants.binScale = float(binCount) / (farPlane - nearPlane);
+    m_constants.lightCount = 0;
+    m_constants.wordCount = 0;
+
+    m_boundaries.clear();
+    LightGrid::ComputeTileBoundaries(viewportWidth, viewportHeight, projectionScaleX, projectionScaleY, tileSize, m_boundaries);
+
+    m_bins.assign(binCount, LightZBin{ LIGHT_ZBIN_EMPTY_MIN, LIGHT_ZBIN_EMPTY_MAX });
+    m_sortedLights.clear();
+    m_sortedTileRanges.clear();
+    m_sortedBinRanges.clear();
+    m_tileMasks.clear();
+}
+
+void LightZBins::Configure(const Camera& camera, uint32_t viewportWidth, uint32_t viewportHeight, uint32_t tileSize, uint32_t binCount)
+{
+    XMFLOAT4X4 projection;
+    XMStoreFloat4x4(&projection, camera.GetProjectionMatrix());
+
+    Configure(viewportWidth, viewportHeight, projection._11, projection._22, camera.GetNearPlane(), camera.GetFarPlane(), tileSize, binCount);
+    SetView(camera.GetViewMatrix());
+}
+
+void LightZBins::SetView(FXMMATRIX view)
+{
+    XMFLOAT4X4 matrix;
+    XMStoreFloat4x4(&matrix, view);
+
+    m_constants.viewColumnX = XMFLOAT4(matrix._11, matrix._21, matrix._31, matrix._41);
+    m_constants.viewColumnY = XMFLOAT4(matrix._12, matrix._22, matrix._32, matrix._42);
+    m_constants.viewColumnZ = XMFLOAT4(matrix._13, matrix._23, matrix._33, matrix._43);
+}
+
+uint32_t LightZBins::GetTileIndex(float pixelX, float pixelY) const
+{
+    uint32_t column = std::min(static_cast<uint32_t>(std::max(pixelX, 0.0f)) / m_constants.tileSize, m_constants.tileCount.x - 1);
+    uint32_t row = std::min(static_cast<uint32_t>(std::max(pixelY, 0.0f)) / m_constants.tileSize, m_constants.tileCount.y - 1);
+    return row * m_constants.tileCount.x + column;
+}
+
+uint32_t LightZBins::GetBinIndex(float viewZ) const
+{
+    return GetLightZBin(viewZ, m_constants.binNear, m_constants.binScale, m_constants.binCount);
+}
+
+size_t LightZBins::GetMemoryUsage() const
+{
+    return sizeof(LightZBin) * m_bins.size() + sizeof(uint32_t) * (m_tileMasks.size() + m_sortedLights.size());
+}
+
+void LightZBins::Build(const LightList& lights, CullPath path)
+{
+    BuildBins(lights, path);
+    BuildTileMasks();
+}
+
+void LightZBins::BuildBins(const LightList& lights, CullPath path)
+{
+    assertm(IsConfigured(), "LightZBins::BuildBins called before Configure");
+    assertm(path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2, "LightZBins::BuildBins called with a path this build does not support");
+
+    const size_t lightCount = lights.GetLightCount();
+    assertm(lightCount <= UINT32_MAX, "LightZBins light count exceeds 32-bit index range");
+
+    m_tileRanges.resize(lightCount);
+    m_viewDepths.resize(lightCount);
+    m_binRanges.resize(lightCount);
+
+    ThreadPool::Get().ParallelFor(lightCount, LIGHT_BATCH_SIZE, [&](size_t begin, size_t end)
+    {
+        switch (path)
+        {
+#if defined(__AVX2__)
+        case CullPath::AVX2:
+        {
+            size_t simdEnd = begin + ((end - begin) & ~size_t(7));
+            ComputeTileRanges<AVX2Lanes>(lights, begin, simdEnd);
+            ComputeTileRanges<ScalarLanes>(lights, simdEnd, end);
+            break;
+        }
+#endif
+        case CullPath::SSE:
+        {
+            size_t simdEnd = begin + ((end - begin) & ~size_t(3));
+            ComputeTileRanges<SSELanes>(lights, begin, simdEnd);
+            ComputeTileRanges<ScalarLanes>(lights, simdEnd, end);
+            break;
+        }
+        default:
+            ComputeTileRanges<ScalarLanes>(lights, begin, end);
+            break;
+        }
+    });
+
+    SortVisibleLights(lightCount);
+
+    const uint32_t visibleCount = static_cast<uint32_t>(m_sortedLights.size());
+    m_sortedTileRanges.resize(visibleCount);
+    m_sortedBinRanges.resize(visibleCount);
+    for (uint32_t i = 0; i < visibleCount; ++i)
+    {
+        m_sortedTileRanges[i] = m_tileRanges[m_sortedLights[i]];
+        m_sortedBinRanges[i] = m_binRanges[m_sortedLights[i]];
+    }
+
+    m_constants.lightCount = visibleCount;
+    m_constants.wordCount = DivideRoundUp(visibleCount, 32);
+
+    ThreadPool::Get().ParallelFor(m_constants.binCount, BIN_BATCH_SIZE, [&](size_t begin, size_t end)
+    {
+        FillBins(static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+    });
+}
+
+void LightZBins::BuildTileMasks()
+{
+    const uint32_t tileCount = GetTileCount();
+    const uint32_t cornerCount = (m_constants.tileCount.x + 1) * (m_constants.tileCount.y + 1);
+    m_tileMasks.resize(size_t(m_constants.wordCount) * tileCount);
+
+    ThreadPool::Get().ParallelFor(m_constants.wordCount, MASK_WORD_BATCH_SIZE, [&](size_t begin, size_t end)
+    {
+        std::vector<uint32_t> corners(cornerCount);
+        std::vector<uint32_t> columnSums(m_constants.tileCount.x);
+        for (size_t word = begin; word < end; ++word)
+        {
+            FillTileMaskWord(static_cast<uint32_t>(word), corners, columnSums);
+        }
+    });
+}
+
+template<typename Lanes>
+void LightZBins::ComputeTileRanges(const LightList& lights, size_t begin, size_t end)
+{
+    using Float = typename Lanes::Float;
+    using Mask = typename Lanes::Mask;
+    constexpr size_t WIDTH = Lanes::WIDTH;
+
+    const XMUINT2& tileCount = m_constants.tileCount;
+    const LightGridBoundary* boundaries = m_boundaries.data();
+
+    for (size_t i = begin; i < end; i += WIDTH)
+    {
+        Float x = Lanes::Load(lights.GetCullCenterX() + i);
+        Float y = Lanes::Load(lights.GetCullCenterY() + i);
+        Float z = Lanes::Load(lights.GetCullCenterZ() + i);
+        Float radius = Lanes::Load(lights.GetCullRadius() + i);
+
+        Float viewX = TransformToView<Float, Mask>(x, y, z, m_constants.viewColumnX);
+        Float viewY = TransformToView<Float, Mask>(x, y, z, m_constants.viewColumnY);
+        Float viewZ = TransformToView<Float, Mask>(x, y, z, m_constants.viewColumnZ);
+
+        // Same branchless first / last tracking as LightGrid::ComputeLightRanges
+        const Float none = float(RANGE_MIN_MASK);
+        Float first[2] = { none, none };
+        Float last[2] = { -1.0f, -1.0f };
+        auto track = [&](uint32_t axis, uint32_t k, Mask overlaps)
+        {
+            Float index = float(k);
+            first[axis] = Lanes::Min(first[axis], Lanes::Select(overlaps, index, none));
+            last[axis] = Lanes::Select(overlaps, index, last[axis]);
+        };
+
+        uint32_t depthVisible = Lanes::MoveMask(SphereOverlapsSlice<Float, Mask>(viewZ, radius, m_nearPlane, m_farPlane));
+        if (depthVisible)
+        {
+            Float lowDistance = TileBoundaryDistance<Float, Mask>(viewX, viewZ, boundaries[0].columnPlane);
+            for (uint32_t k = 0; k < tileCount.x; ++k)
+            {
+                Float highDistance = TileBoundaryDistance<Float, Mask>(viewX, viewZ, boundaries[k + 1].columnPlane);
+                track(0, k, SphereOverlapsTileSlab<Float, Mask>(lowDistance, highDistance, radius));
+                lowDistance = highDistance;
+            }
+
+            lowDistance = TileBoundaryDistance<Float, Mask>(viewY, viewZ, boundaries[0].rowPlane);
+            for (uint32_t k = 0; k < tileCount.y; ++k)
+            {
+                Float highDistance = TileBoundaryDistance<Float, Mask>(viewY, viewZ, boundaries[k + 1].rowPlane);
+                track(1, k, SphereOverlapsTileSlab<Float, Mask>(lowDistance, highDistance, radius));
+                lowDistance = highDistance;
+            }
+        }
+
+        float firstValues[2][WIDTH];
+        float lastValues[2][WIDTH];
+        float depthValues[WIDTH];
+        for (uint32_t axis = 0; axis < 2; ++axis)
+        {
+            Lanes::Store(firstValues[axis], first[axis]);
+            Lanes::Store(lastValues[axis], last[axis]);
+        }
+        Lanes::Store(depthValues, viewZ);
+
+        for (size_t lane = 0; lane < WIDTH; ++lane)
+        {
+            float depth = depthValues[lane];
+            float laneRadius = lights.GetCullRadius()[i + lane];
+            m_viewDepths[i + lane] = depth;
+
+            LightTileRange& range = m_tileRanges[i + lane];
+            if (!(depthVisible & (1u << lane)) || lastValues[0][lane] < 0.0f || lastValues[1][lane] < 0.0f)
+            {
+                range = { LIGHT_RANGE_EMPTY, LIGHT_RANGE_EMPTY };
+                m_binRanges[i + lane] = LIGHT_RANGE_EMPTY;
+                continue;
+            }
+
+            range.columns = uint32_t(firstValues[0][lane]) | (uint32_t(lastValues[0][lane]) << 16);
+            range.rows = uint32_t(firstValues[1][lane]) | (uint32_t(lastValues[1][lane]) << 16);
+            m_binRanges[i + lane] = GetBinIndex(depth - laneRadius) | (GetBinIndex(depth + laneRadius) << 16);
+        }
+    }
+}
+
+void LightZBins::SortVisibleLights(size_t lightCount)
+{
+    m_sortedLights.clear();
+    m_sortKeys.clear();
+    for (size_t i = 0; i < lightCount; ++i)
+    {
+        if (m_tileRanges[i].columns != LIGHT_RANGE_EMPTY)
+        {
+            m_sortedLights.push_back(static_cast<uint32_t>(i));
+            m_sortKeys.push_back(OrderedKey(m_viewDepths[i]));
+        }
+    }
+
+    // Stable LSD radix sort over three 11-bit digits, equal depths keep their submission order so the result
+    // does not depend on thread timing
+    const size_t visibleCount = m_sortedLights.size();
+    m_sortScratchKeys.resize(visibleCount);
+    m_sortScratchLights.resize(visibleCount);
+
+    std::vector<uint32_t> digitOffsets(RADIX_SIZE);
+    for (uint32_t shift = 0; shift < 32; shift += RADIX_BITS)
+    {
+        std::fill(digitOffsets.begin(), digitOffsets.end(), 0u);
+        for (uint32_t key : m_sortKeys)
+        {
+            ++digitOffsets[(key >> shift) & (RADIX_SIZE - 1)];
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t& digitOffset : digitOffsets)
+        {
+            uint32_t count = digitOffset;
+            digitOffset = offset;
+            offset += count;
+        }
+
+        for (size_t i = 0; i < visibleCount; ++i)
+        {
+            uint32_t destination = digitOffsets[(m_sortKeys[i] >> shift) & (RADIX_SIZE - 1)]++;
+            m_sortScratchKeys[destination] = m_sortKeys[i];
+            m_sortScratchLights[destination] = m_sortedLights[i];
+        }
+
+        m_sortKeys.swap(m_sortScratchKeys);
+        m_sortedLights.swap(m_sortScratchLights);
+    }
+}
+
+void LightZBins::FillBins(uint32_t binBegin, uint32_t binEnd)
+{
+    for (uint32_t bin = binBegin; bin < binEnd; ++bin)
+    {
+        m_bins[bin] = { LIGHT_ZBIN_EMPTY_MIN, LIGHT_ZBIN_EMPTY_MAX };
+    }
+
+    // Lights are visited in sorted order, so the first light to touch a bin is its min and the last its max
+    for (uint32_t i = 0; i < m_constants.lightCount; ++i)
+    {
+        uint32_t first = std::max(RangeMin(m_sortedBinRanges[i]), binBegin);
+        uint32_t last = std::min(RangeMax(m_sortedBinRanges[i]) + 1, binEnd);
+        for (uint32_t bin = first; bin < last; ++bin)
+        {
+            m_bins[bin].minLight = std::min(m_bins[bin].minLight, i);
+            m_bins[bin].maxLight = i;
+        }
+    }
+}
+
+void LightZBins::FillTileMaskWord(uint32_t word, std::vector<uint32_t>& corners, std::vector<uint32_t>& columnSums)
+{
+    const uint32_t columnCount = m_constants.tileCount.x;
+    const uint32_t rowCount = m_constants.tileCount.y;
+    const uint32_t firstLight = word * 32;
+    const uint32_t lightCount = std::min(32u, m_constants.lightCount - firstLight);
+
+    // Every light owns one bit of the word, so toggling its rectangle corners and integrating with XOR sets the bit
+    // exactly inside the rectangle. The cost is one pass over the tiles per word however large the lights are.
+    std::fill(corners.begin(), corners.end(), 0u);
+    std::fill(columnSums.begin(), columnSums.end(), 0u);
+    for (uint32_t i = 0; i < lightCount; ++i)
+    {
+        const LightTileRange& range = m_sortedTileRanges[firstLight + i];
+        uint32_t column0 = RangeMin(range.columns), column1 = RangeMax(range.columns) + 1;
+        uint32_t row0 = RangeMin(range.rows), row1 = RangeMax(range.rows) + 1;
+        uint32_t bit = 1u << i;
+        corners[row0 * (columnCount + 1) + column0] ^= bit;
+        corners[row0 * (columnCount + 1) + column1] ^= bit;
+        corners[row1 * (columnCount + 1) + column0] ^= bit;
+        corners[row1 * (columnCount + 1) + column1] ^= bit;
+    }
+
+    uint32_t* masks = &m_tileMasks[size_t(word) * GetTileCount()];
+    for (uint32_t row = 0; row < rowCount; ++row)
+    {
+        uint32_t rowMask = 0;
+        for (uint32_t column = 0; column < columnCount; ++column)
+        {
+            columnSums[column] ^= corners[row * (columnCount + 1) + column];
+            rowMask ^= columnSums[column];
+            masks[row * columnCount + column] = rowMask;
+        }
+    }
+}
+
+void LightZBins::GatherLights(float pixelX, float pixelY, float viewZ, std::vector<uint32_t>& lightIndices) const
+{
+    lightIndices.clear();
+    if (viewZ < m_nearPlane || viewZ > m_farPlane)
+    {
+        return;
+    }
+
+    const LightZBin& bin = m_bins[GetBinIndex(viewZ)];
+    if (bin.minLight > bin.maxLight)
+    {
+        return;
+    }
+
+    // Only the words overlapping the bin range are read, the edge words are trimmed to the range
+    const uint32_t tileCount = GetTileCount();
+    const uint32_t tile = GetTileIndex(pixelX, pixelY);
+    for (uint32_t word = bin.minLight / 32; word <= bin.maxLight / 32; ++word)
+    {
+        uint32_t mask = m_tileMasks[size_t(word) * tileCount + tile];
+        if (word == bin.minLight / 32)
+        {
+            mask &= ~0u << (bin.minLight % 32);
+        }
+        if (word == bin.maxLight / 32)
+        {
+            mask &= ~0u >> (31 - bin.maxLight % 32);
+        }
+
+        while (mask)
+        {
+            uint32_t bit = static_cast<uint32_t>(std::countr_zero(mask));
+            lightIndices.push_back(m_sortedLights[word * 32 + bit]);
+            mask &= mask - 1;
+        }
+    }
+}
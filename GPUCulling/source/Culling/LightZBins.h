@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Culling/CullingCommon.h"
+#include "Culling/LightList.h"
+#include "Shaders/LightZBinShared.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+
+using namespace DirectX;
+
+class Camera;
+
+// Z-binned tiled light culling, the alternative to the clustered LightGrid. Visible lights are sorted by view depth,
+// a 1D array of depth bins stores the range of sorted lights touching each bin and 2D screen tiles store one bit per
+// sorted light. Shading ANDs the tile words with its bin range, so memory grows with tiles times lights instead of
+// tiles times slices times lights per cluster.
+//
+// BuildBins runs on the CPU every frame in both the CPU and GPU modes; BuildTileMasks is the CPU reference of
+// LightZBins.hlsl and produces byte identical masks.
+class LightZBins
+{
+    LightZBins(const LightZBins&) = delete;
+    LightZBins& operator=(const LightZBins&) = delete;
+
+public:
+    static constexpr uint32_t DEFAULT_TILE_SIZE = 32;
+    static constexpr uint32_t DEFAULT_BIN_COUNT = 1024;
+
+    LightZBins() = default;
+    ~LightZBins() = default;
+
+    // Lays out tiles and bins for a viewport and projection. The tile size grows if the screen would need more
+    // than LIGHT_ZBIN_MAX_TILES tiles along an axis.
+    void Configure(uint32_t viewportWidth, uint32_t viewportHeight, float projectionScaleX, float projectionScaleY,
+        float nearPlane, float farPlane, uint32_t tileSize = DEFAULT_TILE_SIZE, uint32_t binCount = DEFAULT_BIN_COUNT);
+    void Configure(const Camera& camera, uint32_t viewportWidth, uint32_t viewportHeight,
+        uint32_t tileSize = DEFAULT_TILE_SIZE, uint32_t binCount = DEFAULT_BIN_COUNT);
+    void SetView(FXMMATRIX view);
+
+    // Culls, sorts and bins the lights. Tile ranges are computed here as well, the masks are left to the GPU.
+    void BuildBins(const LightList& lights, CullPath path = DEFAULT_CULL_PATH);
+    // Expands the tile ranges of the last BuildBins into the per tile light masks
+    void BuildTileMasks();
+    void Build(const LightList& lights, CullPath path = DEFAULT_CULL_PATH);
+
+    bool IsConfigured() const { return m_constants.binCount != 0; }
+    const ShaderInterop::LightZBinConstants& GetConstants() const { return m_constants; }
+    uint32_t GetTileCount() const { return m_constants.tileCount.x * m_constants.tileCount.y; }
+    // Tile containing a pixel and bin containing a view depth, both clamped to the grid
+    uint32_t GetTileIndex(float pixelX, float pixelY) const;
+    uint32_t GetBinIndex(float viewZ) const;
+
+    // Original light index of every sorted light
+    const std::vector<uint32_t>& GetSortedLights() const { return m_sortedLights; }
+    const std::vector<ShaderInterop::LightTileRange>& GetTileRanges() const { return m_sortedTileRanges; }
+    const std::vector<ShaderInterop::LightZBin>& GetBins() const { return m_bins; }
+    // wordCount * tileCount words, word w of tile t at w * tileCount + t
+    const std::vector<uint32_t>& GetTileMasks() const { return m_tileMasks; }
+
+    // Original indices of the lights shading a pixel at a view depth would loop over, in sorted order
+    void GatherLights(float pixelX, float pixelY, float viewZ, std::vector<uint32_t>& lightIndices) const;
+    // Bytes shading reads: bins, tile masks and the sorted light indices
+    size_t GetMemoryUsage() const;
+
+private:
+    template<typename Lanes>
+    void ComputeTileRanges(const LightList& lights, size_t begin, size_t end);
+    void SortVisibleLights(size_t lightCount);
+    void FillBins(uint32_t binBegin, uint32_t binEnd);
+    void FillTileMaskWord(uint32_t word, std::vector<uint32_t>& corners, std::vector<uint32_t>& columnSums);
+
+    ShaderInterop::LightZBinConstants m_constants = {};
+    std::vector<ShaderInterop::LightGridBoundary> m_boundaries;
+    uint32_t m_viewportWidth = 0;
+    uint32_t m_viewportHeight = 0;
+    float m_nearPlane = 0.0f;
+    float m_farPlane = 0.0f;
+
+    // Per original light, written by the parallel range pass
+    std::vector<ShaderInterop::LightTileRange> m_tileRanges;
+    std::vector<float> m_viewDepths;
+    // First bin in the low and last bin in the high 16 bits
+    std::vector<uint32_t> m_binRanges;
+
+    // Radix sort scratch, keys are the view depths mapped to order preserving integers
+    std::vector<uint32_t> m_sortKeys;
+    std::vector<uint32_t> m_sortScratchKeys;
+    std::vector<uint32_t> m_sortScratchLights;
+
+    std::vector<uint32_t> m_sortedLights;
+    std::vector<ShaderInterop::LightTileRange> m_sortedTileRanges;
+    std::vector<uint32_t> m_sortedBinRanges;
+    std::vector<ShaderInterop::LightZBin> m_bins;
+    std::vector<uint32_t> m_tileMasks;
+};
@@ -0,0 +1,483 @@
+#include "stdafx.h"
+#include "Culling/LooseOctree.h"
+
+#include "Culling/SIMDLanes.h"
+#include "IO/ModelData.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace
+{
+    constexpr uint32_t ALL_PLANES = (1u << FRUSTUM_PLANE_COUNT) - 1;
+
+    // Same p-vertex test as FrustumCuller so object results match brute force culling
+    bool IsOutsideAnyPlane(const AABB& bounds, const Frustum& frustum, uint32_t planeMask)
+    {
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            if (!(planeMask & (1u << p)))
+            {
+                continue;
+            }
+
+            const XMFLOAT4& plane = frustum.planes[p];
+            float x = plane.x >= 0.0f ? bounds.max.x : bounds.min.x;
+            float y = plane.y >= 0.0f ? bounds.max.y : bounds.min.y;
+            float z = plane.z >= 0.0f ? bounds.max.z : bounds.min.z;
+            if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns false when the center is outside [0, cellCount) or not a number
+    bool ComputeCell(float center, float rootMin, float cellScale, uint32_t cellCount, uint32_t& outCell)
+    {
+        float cell = (center - rootMin) * cellScale;
+        if (!(cell >= 0.0f && cell < static_cast<float>(cellCount)))
+        {
+            return false;
+        }
+        outCell = std::min(static_cast<uint32_t>(cell), cellCount - 1);
+        return true;
+    }
+}
+
+void LooseOctree::Initialize(const AABB& worldBounds, uint32_t maxDepth)
+{
+    assertm(worldBounds.IsValid(), "LooseOctree::Initialize called with invalid bounds");
+    assertm(maxDepth <= MAX_DEPTH, "LooseOctree::Initialize called with a depth beyond MAX_DEPTH");
+
+    XMFLOAT3 center = worldBounds.GetCenter();
+    XMFLOAT3 extents = worldBounds.GetExtents();
+    float halfSize = std::max(std::max(extents.x, extents.y), extents.z);
+    if (halfSize <= 0.0f)
+    {
+        halfSize = 1.0f;
+    }
+
+    m_rootMin = XMFLOAT3(center.x - halfSize, center.y - halfSize, center.z - halfSize);
+    m_rootSize = 2.0f * halfSize;
+    m_maxDepth = maxDepth;
+    Clear();
+}
+
+void LooseOctree::Clear()
+{
+    m_nodes.clear();
+    m_objects.clear();
+    m_freeNode = INVALID_INDEX;
+    m_freeObject = INVALID_INDEX;
+    m_nodeCount = 0;
+    m_objectCount = 0;
+
+    if (m_rootSize <= 0.0f)
+    {
+        return;
+    }
+
+    // The root is never freed, so node 0 is always the root
+    Node root = {};
+    float halfSize = m_rootSize * 0.5f;
+    root.center = XMFLOAT3(m_rootMin.x + halfSize, m_rootMin.y + halfSize, m_rootMin.z + halfSize);
+    root.halfSize = halfSize;
+    root.parent = INVALID_INDEX;
+    root.firstObject = INVALID_INDEX;
+    std::fill(std::begin(root.child), std::end(root.child), INVALID_INDEX);
+    m_nodes.push_back(root);
+    m_nodeCount = 1;
+}
+
+uint32_t LooseOctree::Insert(const AABB& bounds)
+{
+    assertm(!m_nodes.empty(), "LooseOctree::Insert called before Initialize");
+    assertm(bounds.IsValid(), "LooseOctree::Insert called with invalid bounds");
+
+    uint32_t handle;
+    if (m_freeObject != INVALID_INDEX)
+    {
+        handle = m_freeObject;
+        m_freeObject = m_objects[handle].next;
+    }
+    else
+    {
+        handle = static_cast<uint32_t>(m_objects.size());
+        m_objects.emplace_back();
+    }
+
+    m_objects[handle].bounds = bounds;
+    LinkObject(handle, FindOrCreateNode(bounds, ComputePlacement(bounds)));
+    ++m_objectCount;
+    return handle;
+}
+
+uint32_t LooseOctree::Insert(const MeshData& mesh, FXMMATRIX transform)
+{
+    return Insert(TransformAABB(mesh.bounds, transform));
+}
+
+void LooseOctree::Remove(uint32_t handle)
+{
+    assertm(handle < m_objects.size() && m_objects[handle].node != INVALID_INDEX, "LooseOctree::Remove called with invalid handle");
+
+    uint32_t nodeIndex = m_objects[handle].node;
+    UnlinkObject(handle);
+
+    Object& object = m_objects[handle];
+    object.node = INVALID_INDEX;
+    object.next = m_freeObject;
+    m_freeObject = handle;
+    --m_objectCount;
+
+    PruneNode(nodeIndex);
+}
+
+void LooseOctree::Move(uint32_t handle, const AABB& bounds)
+{
+    assertm(handle < m_objects.size() && m_objects[handle].node != INVALID_INDEX, "LooseOctree::Move called with invalid handle");
+    assertm(bounds.IsValid(), "LooseOctree::Move called with invalid bounds");
+
+    uint32_t nodeIndex = m_objects[handle].node;
+    m_objects[handle].bounds = bounds;
+
+    // Most moves stay in the same cell: same depth, same cell and still inside the loose box the parent tests
+    Placement placement = ComputePlacement(bounds);
+    const Node& node = m_nodes[nodeIndex];
+    if (node.depth == placement.depth && node.cellX == placement.cellX && node.cellY == placement.cellY && node.cellZ == placement.cellZ)
+    {
+        if (nodeIndex == 0)
+        {
+            return;
+        }
+
+        const Node& parent = m_nodes[node.parent];
+        uint32_t slot = (node.cellX & 1) | ((node.cellY & 1) << 1) | ((node.cellZ & 1) << 2);
+        if (bounds.min.x >= parent.minX[slot] && bounds.min.y >= parent.minY[slot] && bounds.min.z >= parent.minZ[slot] &&
+            bounds.max.x <= parent.maxX[slot] && bounds.max.y <= parent.maxY[slot] && bounds.max.z <= parent.maxZ[slot])
+        {
+            return;
+        }
+    }
+
+    // Link into the new cell first, so pruning the old one never frees a cell on the new path
+    UnlinkObject(handle);
+    LinkObject(handle, FindOrCreateNode(bounds, placement));
+    PruneNode(nodeIndex);
+}
+
+void LooseOctree::Move(uint32_t handle, const MeshData& mesh, FXMMATRIX transform)
+{
+    Move(handle, TransformAABB(mesh.bounds, transform));
+}
+
+LooseOctree::Placement LooseOctree::ComputePlacement(const AABB& bounds) const
+{
+    XMFLOAT3 center = bounds.GetCenter();
+    XMFLOAT3 extents = bounds.GetExtents();
+    float radius = std::max(std::max(extents.x, extents.y), extents.z);
+
+    // An object whose extents fit a cell's half size stays inside the loose box wherever its center is in the cell
+    Placement placement = {};
+    float halfSize = m_rootSize * 0.5f;
+    while (placement.depth < m_maxDepth && radius <= halfSize * 0.5f)
+    {
+        halfSize *= 0.5f;
+        ++placement.depth;
+    }
+
+    uint32_t cellCount = 1u << placement.depth;
+    float cellScale = static_cast<float>(cellCount) / m_rootSize;
+    if (!ComputeCell(center.x, m_rootMin.x, cellScale, cellCount, placement.cellX) ||
+        !ComputeCell(center.y, m_rootMin.y, cellScale, cellCount, placement.cellY) ||
+        !ComputeCell(center.z, m_rootMin.z, cellScale, cellCount, placement.cellZ))
+    {
+        return {};
+    }
+    return placement;
+}
+
+uint32_t LooseOctree::FindOrCreateNode(const AABB& bounds, const Placement& placement)
+{
+    uint32_t nodeIndex = 0;
+    for (uint32_t depth = 0; depth < placement.depth; ++depth)
+    {
+        uint32_t shift = placement.depth - 1 - depth;
+        uint32_t slot = ((placement.cellX >> shift) & 1) | (((placement.cellY >> shift) & 1) << 1) | (((placement.cellZ >> shift) & 1) << 2);
+
+        bool created = false;
+        uint32_t childIndex = m_nodes[nodeIndex].child[slot];
+        if (childIndex == INVALID_INDEX)
+        {
+            childIndex = CreateChild(nodeIndex, slot);
+            created = true;
+        }
+
+        const Node& node = m_nodes[nodeIndex];
+        if (!(bounds.min.x >= node.minX[slot] && bounds.min.y >= node.minY[slot] && bounds.min.z >= node.minZ[slot] &&
+            bounds.max.x <= node.maxX[slot] && bounds.max.y <= node.maxY[slot] && bounds.max.z <= node.maxZ[slot]))
+        {
+            if (created)
+            {
+                FreeNode(childIndex);
+            }
+            break;
+        }
+        nodeIndex = childIndex;
+    }
+    return nodeIndex;
+}
+
+uint32_t LooseOctree::CreateChild(uint32_t parentIndex, uint32_t slot)
+{
+    uint32_t childIndex;
+    if (m_freeNode != INVALID_INDEX)
+    {
+        childIndex = m_freeNode;
+        m_freeNode = m_nodes[childIndex].parent;
+    }
+    else
+    {
+        childIndex = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+    ++m_nodeCount;
+
+    Node& parent = m_nodes[parentIndex];
+    float halfSize = parent.halfSize * 0.5f;
+
+    Node& child = m_nodes[childIndex];
+    child = {};
+    child.center.x = parent.center.x + ((slot & 1) ? halfSize : -halfSize);
+    child.center.y = parent.center.y + ((slot & 2) ? halfSize : -halfSize);
+    child.center.z = parent.center.z + ((slot & 4) ? halfSize : -halfSize);
+    child.halfSize = halfSize;
+    child.parent = parentIndex;
+    child.firstObject = INVALID_INDEX;
+    child.cellX = static_cast<uint16_t>((parent.cellX << 1) | (slot & 1));
+    child.cellY = static_cast<uint16_t>((parent.cellY << 1) | ((slot >> 1) & 1));
+    child.cellZ = static_cast<uint16_t>((parent.cellZ << 1) | ((slot >> 2) & 1));
+    child.depth = static_cast<uint8_t>(parent.depth + 1);
+    std::fill(std::begin(child.child), std::end(child.child), INVALID_INDEX);
+
+    // The loose box of the child reaches a full child size past its cell on every side
+    float looseSize = 2.0f * halfSize;
+    parent.minX[slot] = child.center.x - looseSize;
+    parent.minY[slot] = child.center.y - looseSize;
+    parent.minZ[slot] = child.center.z - looseSize;
+    parent.maxX[slot] = child.center.x + looseSize;
+    parent.maxY[slot] = child.center.y + looseSize;
+    parent.maxZ[slot] = child.center.z + looseSize;
+    parent.child[slot] = childIndex;
+    parent.childMask |= static_cast<uint8_t>(1u << slot);
+    return childIndex;
+}
+
+void LooseOctree::FreeNode(uint32_t nodeIndex)
+{
+    assert(nodeIndex != 0);
+
+    Node& node = m_nodes[nodeIndex];
+    assert(node.objectCount == 0 && node.childMask == 0);
+
+    Node& parent = m_nodes[node.parent];
+    uint32_t slot = (node.cellX & 1) | ((node.cellY & 1) << 1) | ((node.cellZ & 1) << 2);
+    parent.minX[slot] = parent.minY[slot] = parent.minZ[slot] = 0.0f;
+    parent.maxX[slot] = parent.maxY[slot] = parent.maxZ[slot] = 0.0f;
+    parent.child[slot] = INVALID_INDEX;
+    parent.childMask &= static_cast<uint8_t>(~(1u << slot));
+
+    node.parent = m_freeNode;
+    m_freeNode = nodeIndex;
+    --m_nodeCount;
+}
+
+void LooseOctree::PruneNode(uint32_t nodeIndex)
+{
+    while (nodeIndex != 0 && m_nodes[nodeIndex].objectCount == 0 && m_nodes[nodeIndex].childMask == 0)
+    {
+        uint32_t parentIndex = m_nodes[nodeIndex].parent;
+        FreeNode(nodeIndex);
+        nodeIndex = parentIndex;
+    }
+}
+
+void LooseOctree::LinkObject(uint32_t handle, uint32_t nodeIndex)
+{
+    Node& node = m_nodes[nodeIndex];
+    Object& object = m_objects[handle];
+    object.node = nodeIndex;
+    object.previous = INVALID_INDEX;
+    object.next = node.firstObject;
+    if (node.firstObject != INVALID_INDEX)
+    {
+        m_objects[node.firstObject].previous = handle;
+    }
+    node.firstObject = handle;
+    ++node.objectCount;
+}
+
+void LooseOctree::UnlinkObject(uint32_t handle)
+{
+    Object& object = m_objects[handle];
+    Node& node = m_nodes[object.node];
+    if (object.previous != INVALID_INDEX)
+    {
+        m_objects[object.previous].next = object.next;
+    }
+    else
+    {
+        node.firstObject = object.next;
+    }
+    if (object.next != INVALID_INDEX)
+    {
+        m_objects[object.next].previous = object.previous;
+    }
+    --node.objectCount;
+}
+
+size_t LooseOctree::Cull(const Frustum& frustum, std::vector<uint32_t>& outVisibleHandles, CullPath path) const
+{
+    assertm(path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2, "LooseOctree::Cull called with a path this build does not support");
+
+    outVisibleHandles.clear();
+    if (m_nodes.empty())
+    {
+        return 0;
+    }
+
+    switch (path)
+    {
+#if defined(__AVX2__)
+    case CullPath::AVX2:
+        return CullLanes<SIMD::AVX2Lanes>(frustum, outVisibleHandles);
+#endif
+    case CullPath::SSE:
+        return CullLanes<SIMD::SSELanes>(frustum, outVisibleHandles);
+    default:
+        return CullLanes<SIMD::ScalarLanes>(frustum, outVisibleHandles);
+    }
+}
+
+void LooseOctree::EmitSubtree(uint32_t nodeIndex, std::vector<uint32_t>& outVisibleHandles) const
+{
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(nodeIndex);
+
+    while (!stack.empty())
+    {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        for (uint32_t handle = node.firstObject; handle != INVALID_INDEX; handle = m_objects[handle].next)
+        {
+            outVisibleHandles.push_back(handle);
+        }
+        for (uint32_t slots = node.childMask; slots; slots &= slots - 1)
+        {
+            stack.push_back(node.child[std::countr_zero(slots)]);
+        }
+    }
+}
+
+template<typename Lanes>
+size_t LooseOctree::CullLanes(const Frustum& frustum, std::vector<uint32_t>& outVisibleHandles) const
+{
+    struct StackEntry
+    {
+        uint32_t nodeIndex;
+        uint32_t planeMask;
+    };
+
+    std::vector<StackEntry> stack;
+    stack.reserve(64);
+    stack.push_back({ 0, ALL_PLANES });
+
+    while (!stack.empty())
+    {
+        StackEntry entry = stack.back();
+        stack.pop_back();
+
+        const Node& node = m_nodes[entry.nodeIndex];
+        for (uint32_t handle = node.firstObject; handle != INVALID_INDEX; handle = m_objects[handle].next)
+        {
+            if (!IsOutsideAnyPlane(m_objects[handle].bounds, frustum, entry.planeMask))
+            {
+                outVisibleHandles.push_back(handle);
+            }
+        }
+
+        if (node.childMask == 0)
+        {
+            continue;
+        }
+
+        uint32_t insideMasks[FRUSTUM_PLANE_COUNT];
+        uint32_t visibleSlots = node.childMask & ~TestChildren<Lanes>(node, frustum, entry.planeMask, insideMasks);
+        for (; visibleSlots; visibleSlots &= visibleSlots - 1)
+        {
+            uint32_t slot = std::countr_zero(visibleSlots);
+
+            // Planes the child is fully inside of cannot cull anything below it
+            uint32_t childMask = entry.planeMask;
+            for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+            {
+                if (insideMasks[p] & (1u << slot))
+                {
+                    childMask &= ~(1u << p);
+                }
+            }
+
+            if (childMask == 0)
+            {
+                EmitSubtree(node.child[slot], outVisibleHandles);
+            }
+            else
+            {
+                stack.push_back({ node.child[slot], childMask });
+            }
+        }
+    }
+
+    return outVisibleHandles.size();
+}
+
+template<typename Lanes>
+uint32_t LooseOctree::TestChildren(const Node& node, const Frustum& frustum, uint32_t planeMask, uint32_t* insideMasks)
+{
+    using Float = typename Lanes::Float;
+    constexpr uint32_t WIDTH = static_cast<uint32_t>(Lanes::WIDTH);
+
+    for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        insideMasks[p] = 0;
+    }
+
+    uint32_t outsideMask = 0;
+    for (uint32_t i = 0; i < NODE_WIDTH; i += WIDTH)
+    {
+        Float minX = Lanes::Load(node.minX + i), minY = Lanes::Load(node.minY + i), minZ = Lanes::Load(node.minZ + i);
+        Float maxX = Lanes::Load(node.maxX + i), maxY = Lanes::Load(node.maxY + i), maxZ = Lanes::Load(node.maxZ + i);
+
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            if (!(planeMask & (1u << p)))
+            {
+                continue;
+            }
+
+            // Same evaluation order as the object test, an object inside a loose box can never be further out
+            const XMFLOAT4& plane = frustum.planes[p];
+            Float positive = plane.x * (plane.x >= 0.0f ? maxX : minX) + plane.y * (plane.y >= 0.0f ? maxY : minY) +
+                plane.z * (plane.z >= 0.0f ? maxZ : minZ) + plane.w;
+            Float negative = plane.x * (plane.x >= 0.0f ? minX : maxX) + plane.y * (plane.y >= 0.0f ? minY : maxY) +
+                plane.z * (plane.z >= 0.0f ? minZ : maxZ) + plane.w;
+            outsideMask |= Lanes::MoveMask(positive < 0.0f) << i;
+            insideMasks[p] |= Lanes::MoveMask(negative >= 0.0f) << i;
+        }
+    }
+    return outsideMask;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include "Culling/CullingCommon.h"
+#include "Culling/Frustum.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+
+using namespace DirectX;
+
+struct MeshData;
+
+// Loose octree for moving objects, the dynamic counterpart of the BVH. Every cell is enlarged to twice its size, so an
+// object only depends on its size and its center: the size picks the depth, the center picks the cell at that depth.
+// Insert, Remove and Move never rebalance anything, they descend at most MAX_DEPTH levels, create missing cells on the
+// way and drop cells that became empty. Nodes and objects live in flat pools with free lists, handles stay valid until
+// the object is removed.
+//
+// Every node keeps the loose boxes of its 8 children in SoA arrays, so one AVX2 register (or two SSE registers) tests
+// all children against a plane. An object always lies inside the loose boxes of its cell and all its ancestors, so the
+// result equals testing every object on its own.
+class LooseOctree
+{
+    LooseOctree(const LooseOctree&) = delete;
+    LooseOctree& operator=(const LooseOctree&) = delete;
+
+public:
+    static constexpr uint32_t NODE_WIDTH = 8;
+    static constexpr uint32_t MAX_DEPTH = 15;
+    static constexpr uint32_t DEFAULT_MAX_DEPTH = 8;
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    struct alignas(64) Node
+    {
+        // Loose bounds of the children, lanes not set in childMask are zero
+        float minX[NODE_WIDTH];
+        float minY[NODE_WIDTH];
+        float minZ[NODE_WIDTH];
+        float maxX[NODE_WIDTH];
+        float maxY[NODE_WIDTH];
+        float maxZ[NODE_WIDTH];
+        uint32_t child[NODE_WIDTH];
+
+        // Center and half size of the cell, the loose box is twice as large
+        XMFLOAT3 center;
+        float halfSize;
+
+        // Next free node while the node is in the free list
+        uint32_t parent;
+        // Head of the doubly linked list of objects stored in this cell
+        uint32_t firstObject;
+        uint32_t objectCount;
+        uint16_t cellX;
+        uint16_t cellY;
+        uint16_t cellZ;
+        uint8_t depth;
+        // Child slot bit i is set when child[i] exists, slot bits are (x, y, z) from low to high
+        uint8_t childMask;
+    };
+
+    struct Object
+    {
+        AABB bounds;
+        // INVALID_INDEX while the slot is free
+        uint32_t node;
+        uint32_t previous;
+        uint32_t next;
+    };
+
+    LooseOctree() = default;
+    ~LooseOctree() = default;
+
+    // Covers worldBounds with a cube. Objects whose center falls outside of it are kept in the root and tested on
+    // their own. Removes every object.
+    void Initialize(const AABB& worldBounds, uint32_t maxDepth = DEFAULT_MAX_DEPTH);
+    void Clear();
+
+    // World space bounds, returns the handle of the object
+    uint32_t Insert(const AABB& bounds);
+    // Object space mesh bounds placed with a row vector world transform
+    uint32_t Insert(const MeshData& mesh, FXMMATRIX transform);
+    void Remove(uint32_t handle);
+    // Relinks the object only when its size or center moved it to another cell
+    void Move(uint32_t handle, const AABB& bounds);
+    void Move(uint32_t handle, const MeshData& mesh, FXMMATRIX transform);
+
+    // Writes the handles of every object intersecting the frustum. Cells fully inside a plane stop testing it, cells
+    // fully inside the frustum are emitted without further tests. Returns the visible count.
+    size_t Cull(const Frustum& frustum, std::vector<uint32_t>& outVisibleHandles, CullPath path = DEFAULT_CULL_PATH) const;
+
+    const AABB& GetObjectBounds(uint32_t handle) const { return m_objects[handle].bounds; }
+    size_t GetObjectCount() const { return m_objectCount; }
+    size_t GetNodeCount() const { return m_nodeCount; }
+    // The pools including free slots, node 0 is the root
+    const std::vector<Node>& GetNodes() const { return m_nodes; }
+    const std::vector<Object>& GetObjects() const { return m_objects; }
+    uint32_t GetMaxDepth() const { return m_maxDepth; }
+
+private:
+    struct Placement
+    {
+        uint32_t depth;
+        uint32_t cellX;
+        uint32_t cellY;
+        uint32_t cellZ;
+    };
+
+    Placement ComputePlacement(const AABB& bounds) const;
+    // Walks down to the placement cell, creating missing nodes. Stops early where the bounds leave a child's loose
+    // box through rounding, so the containment the culling relies on holds exactly.
+    uint32_t FindOrCreateNode(const AABB& bounds, const Placement& placement);
+    uint32_t CreateChild(uint32_t parentIndex, uint32_t slot);
+    void FreeNode(uint32_t nodeIndex);
+    // Frees empty leaf cells from nodeIndex upwards
+    void PruneNode(uint32_t nodeIndex);
+
+    void LinkObject(uint32_t handle, uint32_t nodeIndex);
+    void UnlinkObject(uint32_t handle);
+
+    void EmitSubtree(uint32_t nodeIndex, std::vector<uint32_t>& outVisibleHandles) const;
+
+    template<typename Lanes>
+    size_t CullLanes(const Frustum& frustum, std::vector<uint32_t>& outVisibleHandles) const;
+    // Returns the children outside any active plane. insideMasks[p] gets a bit per child fully inside plane p.
+    template<typename Lanes>
+    static uint32_t TestChildren(const Node& node, const Frustum& frustum, uint32_t planeMask, uint32_t* insideMasks);
+
+    std::vector<Node> m_nodes;
+    std::vector<Object> m_objects;
+    uint32_t m_freeNode = INVALID_INDEX;
+    uint32_t m_freeObject = INVALID_INDEX;
+    size_t m_nodeCount = 0;
+    size_t m_objectCount = 0;
+
+    XMFLOAT3 m_rootMin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    float m_rootSize = 0.0f;
+    uint32_t m_maxDepth = 0;
+};
@@ -0,0 +1,469 @@
+#include "stdafx.h"
+#include "Culling/MaskedOcclusionRasterizer.h"
+
+#include <cmath>
+#include <fstream>
+#include <immintrin.h>
+
+namespace
+{
+    constexpr uint32_t FULL_ROW_MASK = 0xFFFFFFFFu;
+
+    uint32_t ShiftLeft(uint32_t value, int32_t shift)
+    {
+        return shift >= 32 ? 0u : value << shift;
+    }
+
+    // NaN clamps to minValue, the result _mm256_max_ps(value, minValue) gives, so both coverage paths agree on it
+    float Clamp(float value, float minValue, float maxValue)
+    {
+        return !(value >= minValue) ? minValue : (value > maxValue ? maxValue : value);
+    }
+}
+
+bool MaskedOcclusionRasterizer::Initialize(uint32_t width, uint32_t height)
+{
+    if (width == 0 || height == 0 || width % TILE_WIDTH != 0 || height % TILE_HEIGHT != 0)
+    {
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_tilesX = width / TILE_WIDTH;
+    m_tilesY = height / TILE_HEIGHT;
+    m_tiles.resize(static_cast<size_t>(m_tilesX) * m_tilesY);
+    ClearBuffer();
+    return true;
+}
+
+void MaskedOcclusionRasterizer::ClearBuffer()
+{
+    for (Tile& tile : m_tiles)
+    {
+        for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+        {
+            tile.mask[row] = 0;
+        }
+        tile.zMax0 = 1.0f;
+        tile.zMax1 = 0.0f;
+    }
+}
+
+bool MaskedOcclusionRasterizer::IsCullPathSupported(CullPath path)
+{
+    return path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2;
+}
+
+void MaskedOcclusionRasterizer::RenderTriangles(const XMFLOAT3* positions, size_t strideBytes, const uint32_t* indices, size_t triangleCount,
+    FXMMATRIX modelToClip, CullPath path)
+{
+    assertm(!m_tiles.empty(), "MaskedOcclusionRasterizer::RenderTriangles called before Initialize");
+    assertm(IsCullPathSupported(path), "MaskedOcclusionRasterizer::RenderTriangles called with a path this build does not support");
+
+    const uint8_t* positionBytes = reinterpret_cast<const uint8_t*>(positions);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        ScreenTriangle triangle;
+        bool behindNearPlane = false;
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const XMFLOAT3* position = reinterpret_cast<const XMFLOAT3*>(positionBytes + indices[t * 3 + k] * strideBytes);
+            XMFLOAT4 clip;
+            XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(position), modelToClip));
+
+            // Dropping an occluder only makes the result more conservative, so near plane clipping is not needed
+            if (clip.w < NEAR_CLIP_W)
+            {
+                behindNearPlane = true;
+                break;
+            }
+
+            float invW = 1.0f / clip.w;
+            triangle.x[k] = (clip.x * invW * 0.5f + 0.5f) * m_width;
+            triangle.y[k] = (0.5f - clip.y * invW * 0.5f) * m_height;
+            triangle.z[k] = clip.z * invW;
+        }
+
+        TriangleSetup setup;
+        if (!behindNearPlane && SetupTriangle(triangle, setup))
+        {
+            RasterizeTriangle(setup, path);
+        }
+    }
+}
+
+bool MaskedOcclusionRasterizer::SetupTriangle(const ScreenTriangle& triangle, TriangleSetup& outSetup) const
+{
+    const float* x = triangle.x;
+    const float* y = triangle.y;
+    const float* z = triangle.z;
+
+    float determinant = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (!(std::fabs(determinant) > 0.0f) || !std::isfinite(determinant))
+    {
+        return false;
+    }
+
+    // Occluders are rasterized double sided, so orient every edge to be positive inside
+    float orientation = determinant > 0.0f ? -1.0f : 1.0f;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        uint32_t j = (i + 1) % 3;
+        float a = (y[j] - y[i]) * orientation;
+        float b = (x[i] - x[j]) * orientation;
+
+        // An edge so close to horizontal that 1 / a overflows would feed inf * 0 = NaN into the row crossings, which
+        // the scalar clamp and the AVX2 min/max resolve differently. Its a * x term is far below a pixel anywhere on
+        // screen, so it is rasterized as the horizontal edge it practically is.
+        float invA = a != 0.0f ? 1.0f / a : 0.0f;
+        if (!std::isfinite(invA))
+        {
+            a = 0.0f;
+            invA = 0.0f;
+        }
+
+        outSetup.edgeA[i] = a;
+        outSetup.edgeB[i] = b;
+        outSetup.edgeC[i] = -(a * x[i] + b * y[i]);
+        outSetup.edgeInvA[i] = invA;
+    }
+
+    float invDeterminant = 1.0f / determinant;
+    outSetup.zA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * invDeterminant;
+    outSetup.zB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) * invDeterminant;
+    outSetup.zC = z[0] - outSetup.zA * x[0] - outSetup.zB * y[0];
+    outSetup.zMin = std::min(z[0], std::min(z[1], z[2]));
+    outSetup.zMax = std::max(z[0], std::max(z[1], z[2]));
+
+    if (outSetup.zMax < 0.0f || outSetup.zMin > 1.0f)
+    {
+        return false;
+    }
+
+    float minX = std::min(x[0], std::min(x[1], x[2]));
+    float maxX = std::max(x[0], std::max(x[1], x[2]));
+    float minY = std::min(y[0], std::min(y[1], y[2]));
+    float maxY = std::max(y[0], std::max(y[1], y[2]));
+    if (maxX < 0.0f || maxY < 0.0f || minX >= (float)m_width || minY >= (float)m_height)
+    {
+        return false;
+    }
+
+    outSetup.tileMinX = static_cast<uint32_t>(Clamp(minX, 0.0f, (float)(m_width - 1))) / TILE_WIDTH;
+    outSetup.tileMaxX = static_cast<uint32_t>(Clamp(maxX, 0.0f, (float)(m_width - 1))) / TILE_WIDTH;
+    outSetup.tileMinY = static_cast<uint32_t>(Clamp(minY, 0.0f, (float)(m_height - 1))) / TILE_HEIGHT;
+    outSetup.tileMaxY = static_cast<uint32_t>(Clamp(maxY, 0.0f, (float)(m_height - 1))) / TILE_HEIGHT;
+    return true;
+}
+
+void MaskedOcclusionRasterizer::RasterizeTriangle(const TriangleSetup& setup, CullPath path)
+{
+    // SSE has no dedicated rasterizer, 8 rows per tile map naturally onto AVX2 only
+    bool useAVX2 = path == CullPath::AVX2;
+
+    for (uint32_t tileY = setup.tileMinY; tileY <= setup.tileMaxY; ++tileY)
+    {
+        for (uint32_t tileX = setup.tileMinX; tileX <= setup.tileMaxX; ++tileX)
+        {
+            Tile& tile = m_tiles[static_cast<size_t>(tileY) * m_tilesX + tileX];
+
+            // A triangle that is not in front of the reference layer cannot tighten the tile
+            float zTile = ComputeTileDepth(setup, tileX, tileY);
+            if (zTile >= tile.zMax0)
+            {
+                continue;
+            }
+
+            alignas(32) uint32_t coverage[TILE_HEIGHT];
+            if (useAVX2)
+            {
+                ComputeCoverageAVX2(setup, tileX, tileY, coverage);
+            }
+            else
+            {
+                ComputeCoverageScalar(setup, tileX, tileY, coverage);
+            }
+
+            UpdateTile(tile, coverage, zTile);
+        }
+    }
+}
+
+float MaskedOcclusionRasterizer::ComputeTileDepth(const TriangleSetup& setup, uint32_t tileX, uint32_t tileY) const
+{
+    // The depth plane is linear, so its maximum over the tile is at one of the corners
+    float x0 = (float)(tileX * TILE_WIDTH);
+    float x1 = x0 + (float)TILE_WIDTH;
+    float y0 = (float)(tileY * TILE_HEIGHT);
+    float y1 = y0 + (float)TILE_HEIGHT;
+
+    float z00 = setup.zA * x0 + setup.zB * y0 + setup.zC;
+    float z10 = setup.zA * x1 + setup.zB * y0 + setup.zC;
+    float z01 = setup.zA * x0 + setup.zB * y1 + setup.zC;
+    float z11 = setup.zA * x1 + setup.zB * y1 + setup.zC;
+    float zCorner = std::max(std::max(z00, z10), std::max(z01, z11));
+
+    return Clamp(zCorner, setup.zMin, setup.zMax);
+}
+
+void MaskedOcclusionRasterizer::ComputeCoverageScalar(const TriangleSetup& setup, uint32_t tileX, uint32_t tileY, uint32_t* outMask) const
+{
+    float tileOffsetX = (float)(tileX * TILE_WIDTH) + 0.5f;
+    float tileOriginY = (float)(tileY * TILE_HEIGHT);
+
+    for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+    {
+        float rowCenterY = tileOriginY + ((float)row + 0.5f);
+        uint32_t rowMask = FULL_ROW_MASK;
+
+        for (uint32_t e = 0; e < 3; ++e)
+        {
+            float rowTerm = setup.edgeB[e] * rowCenterY + setup.edgeC[e];
+            float a = setup.edgeA[e];
+            if (a == 0.0f)
+            {
+                rowMask &= rowTerm >= 0.0f ? FULL_ROW_MASK : 0u;
+                continue;
+            }
+
+            // Column (relative to the tile) where the edge crosses the row, measured at pixel centers
+            float crossing = (0.0f - rowTerm) * setup.edgeInvA[e] - tileOffsetX;
+            if (a > 0.0f)
+            {
+                int32_t firstColumn = (int32_t)Clamp(std::ceil(crossing), 0.0f, 32.0f);
+                rowMask &= ShiftLeft(FULL_ROW_MASK, firstColumn);
+            }
+            else
+            {
+                int32_t columnCount = (int32_t)Clamp(std::floor(crossing) + 1.0f, 0.0f, 32.0f);
+                rowMask &= ~ShiftLeft(FULL_ROW_MASK, columnCount);
+            }
+        }
+
+        outMask[row] = rowMask;
+    }
+}
+
+void MaskedOcclusionRasterizer::ComputeCoverageAVX2(const TriangleSetup& setup, uint32_t tileX, uint32_t tileY, uint32_t* outMask) const
+{
+#if defined(__AVX2__)
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 maxShift = _mm256_set1_ps(32.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256i fullMask = _mm256_set1_epi32(-1);
+
+    const __m256 tileOffsetX = _mm256_set1_ps((float)(tileX * TILE_WIDTH) + 0.5f);
+    const __m256 rowCenterY = _mm256_add_ps(_mm256_set1_ps((float)(tileY * TILE_HEIGHT)),
+        _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+
+    __m256i coverage = fullMask;
+    for (uint32_t e = 0; e < 3; ++e)
+    {
+        __m256 rowTerm = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(setup.edgeB[e]), rowCenterY), _mm256_set1_ps(setup.edgeC[e]));
+        float a = setup.edgeA[e];
+        if (a == 0.0f)
+        {
+            coverage = _mm256_and_si256(coverage, _mm256_castps_si256(_mm256_cmp_ps(rowTerm, zero, _CMP_GE_OQ)));
+            continue;
+        }
+
+        __m256 crossing = _mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(zero, rowTerm), _mm256_set1_ps(setup.edgeInvA[e])), tileOffsetX);
+        if (a > 0.0f)
+        {
+            __m256 firstColumn = _mm256_min_ps(_mm256_max_ps(_mm256_ceil_ps(crossing), zero), maxShift);
+            coverage = _mm256_and_si256(coverage, _mm256_sllv_epi32(fullMask, _mm256_cvttps_epi32(firstColumn)));
+        }
+        else
+        {
+            __m256 columnCount = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_floor_ps(crossing), one), zero), maxShift);
+            coverage = _mm256_andnot_si256(_mm256_sllv_epi32(fullMask, _mm256_cvttps_epi32(columnCount)), coverage);
+        }
+    }
+
+    _mm256_store_si256(reinterpret_cast<__m256i*>(outMask), coverage);
+#else
+    assertm(false, "MaskedOcclusionRasterizer::ComputeCoverageAVX2 called in a build without AVX2 support");
+    ComputeCoverageScalar(setup, tileX, tileY, outMask);
+#endif
+}
+
+void MaskedOcclusionRasterizer::UpdateTile(Tile& tile, const uint32_t* coverage, float zTile)
+{
+    uint32_t anyCoverage = 0;
+    for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+    {
+        anyCoverage |= coverage[row];
+    }
+    if (anyCoverage == 0)
+    {
+        return;
+    }
+
+    // Discard the working layer when the new triangle is much closer to it than it is to the reference layer
+    float distanceToWorking = tile.zMax1 - zTile;
+    float distanceWorkingToReference = tile.zMax0 - tile.zMax1;
+    if (distanceToWorking > distanceWorkingToReference)
+    {
+        tile.zMax1 = 0.0f;
+        for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+        {
+            tile.mask[row] = 0;
+        }
+    }
+
+    tile.zMax1 = std::max(tile.zMax1, zTile);
+
+    uint32_t fullCoverage = FULL_ROW_MASK;
+    for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+    {
+        tile.mask[row] |= coverage[row];
+        fullCoverage &= tile.mask[row];
+    }
+
+    // Once the working layer covers the tile it becomes the new reference layer
+    if (fullCoverage == FULL_ROW_MASK)
+    {
+        tile.zMax0 = tile.zMax1;
+        tile.zMax1 = 0.0f;
+        for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+        {
+            tile.mask[row] = 0;
+        }
+    }
+}
+
+OcclusionResult MaskedOcclusionRasterizer::TestRect(float xMin, float yMin, float xMax, float yMax, float zMin) const
+{
+    assertm(!m_tiles.empty(), "MaskedOcclusionRasterizer::TestRect called before Initialize");
+
+    if (xMax < 0.0f || yMax < 0.0f || xMin >= (float)m_width || yMin >= (float)m_height || xMin > xMax || yMin > yMax)
+    {
+        return OcclusionResult::ViewCulled;
+    }
+
+    // Every pixel the rectangle touches is tested, so partially covered pixels count as covered
+    uint32_t pixelMinX = static_cast<uint32_t>(Clamp(std::floor(xMin), 0.0f, (float)(m_width - 1)));
+    uint32_t pixelMaxX = static_cast<uint32_t>(Clamp(std::ceil(xMax) - 1.0f, (float)pixelMinX, (float)(m_width - 1)));
+    uint32_t pixelMinY = static_cast<uint32_t>(Clamp(std::floor(yMin), 0.0f, (float)(m_height - 1)));
+    uint32_t pixelMaxY = static_cast<uint32_t>(Clamp(std::ceil(yMax) - 1.0f, (float)pixelMinY, (float)(m_height - 1)));
+
+    for (uint32_t tileY = pixelMinY / TILE_HEIGHT; tileY <= pixelMaxY / TILE_HEIGHT; ++tileY)
+    {
+        for (uint32_t tileX = pixelMinX / TILE_WIDTH; tileX <= pixelMaxX / TILE_WIDTH; ++tileX)
+        {
+            const Tile& tile = m_tiles[static_cast<size_t>(tileY) * m_tilesX + tileX];
+
+            // Cheap reject: nothing in this tile is farther than the object
+            if (zMin >= tile.zMax0 && zMin >= tile.zMax1)
+            {
+                continue;
+            }
+
+            uint32_t originX = tileX * TILE_WIDTH;
+            uint32_t originY = tileY * TILE_HEIGHT;
+            uint32_t firstColumn = pixelMinX > originX ? pixelMinX - originX : 0;
+            uint32_t lastColumn = std::min(pixelMaxX - originX, TILE_WIDTH - 1);
+            uint32_t columnMask = ShiftLeft(FULL_ROW_MASK, firstColumn) & ~ShiftLeft(FULL_ROW_MASK, lastColumn + 1);
+
+            uint32_t referencePixels = 0;
+            uint32_t workingPixels = 0;
+            for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+            {
+                uint32_t pixelY = originY + row;
+                if (pixelY < pixelMinY || pixelY > pixelMaxY)
+                {
+                    continue;
+                }
+                referencePixels |= columnMask & ~tile.mask[row];
+                workingPixels |= columnMask & tile.mask[row];
+            }
+
+            if ((referencePixels != 0 && zMin < tile.zMax0) || (workingPixels != 0 && zMin < tile.zMax1))
+            {
+                return OcclusionResult::Visible;
+            }
+        }
+    }
+
+    return OcclusionResult::Occluded;
+}
+
+OcclusionResult MaskedOcclusionRasterizer::TestAABB(const AABB& bounds, FXMMATRIX modelToClip) const
+{
+    float xMin = FLT_MAX;
+    float yMin = FLT_MAX;
+    float xMax = -FLT_MAX;
+    float yMax = -FLT_MAX;
+    float zMin = FLT_MAX;
+
+    for (uint32_t corner = 0; corner < 8; ++corner)
+    {
+        XMFLOAT3 position(
+            (corner & 1) ? bounds.max.x : bounds.min.x,
+            (corner & 2) ? bounds.max.y : bounds.min.y,
+            (corner & 4) ? bounds.max.z : bounds.min.z
+        );
+
+        XMFLOAT4 clip;
+        XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&position), modelToClip));
+
+        // A box crossing the near plane cannot be projected safely, keep it
+        if (clip.w < NEAR_CLIP_W)
+        {
+            return OcclusionResult::Visible;
+        }
+
+        float invW = 1.0f / clip.w;
+        float x = (clip.x * invW * 0.5f + 0.5f) * m_width;
+        float y = (0.5f - clip.y * invW * 0.5f) * m_height;
+        xMin = std::min(xMin, x);
+        xMax = std::max(xMax, x);
+        yMin = std::min(yMin, y);
+        yMax = std::max(yMax, y);
+        zMin = std::min(zMin, clip.z * invW);
+    }
+
+    if (zMin > 1.0f)
+    {
+        return OcclusionResult::ViewCulled;
+    }
+
+    return TestRect(xMin, yMin, xMax, yMax, std::max(zMin, 0.0f));
+}
+
+void MaskedOcclusionRasterizer::ComputeDepthImage(std::vector<float>& outDepth) const
+{
+    outDepth.resize(static_cast<size_t>(m_width) * m_height);
+    for (uint32_t y = 0; y < m_height; ++y)
+    {
+        for (uint32_t x = 0; x < m_width; ++x)
+        {
+            const Tile& tile = m_tiles[static_cast<size_t>(y / TILE_HEIGHT) * m_tilesX + x / TILE_WIDTH];
+            bool inWorkingLayer = (tile.mask[y % TILE_HEIGHT] >> (x % TILE_WIDTH)) & 1u;
+            outDepth[static_cast<size_t>(y) * m_width + x] = inWorkingLayer ? tile.zMax1 : tile.zMax0;
+        }
+    }
+}
+
+bool MaskedOcclusionRasterizer::WriteDepthImage(const std::string& filePath) const
+{
+    // 16-bit binary PGM keeps enough precision to diff against reference images
+    std::vector<float> depth;
+    ComputeDepthImage(depth);
+
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    file << "P5\n" << m_width << " " << m_height << "\n65535\n";
+    for (float value : depth)
+    {
+        uint16_t quantized = static_cast<uint16_t>(Clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+        uint8_t bigEndian[2] = { static_cast<uint8_t>(quantized >> 8), static_cast<uint8_t>(quantized & 0xFF) };
+        file.write(reinterpret_cast<const char*>(bigEndian), 2);
+    }
+    return file.good();
+}
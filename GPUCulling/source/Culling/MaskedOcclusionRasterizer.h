@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include "Culling/CullingCommon.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+using namespace DirectX;
+
+enum class OcclusionResult
+{
+    Visible,
+    Occluded,
+    ViewCulled
+};
+
+// CPU occlusion buffer in the style of Masked Software Occlusion Culling (Andersson et al. 2015).
+// The screen is split into 32x8 pixel tiles. Instead of per pixel depth every tile keeps a coverage mask
+// (one 32-bit word per row) and two conservative max depths: a reference layer for the whole tile and a
+// working layer for the pixels in the mask. With AVX2 all 8 rows of a tile are rasterized in one register.
+// Depth follows the renderer convention: 0 is near, 1 is far. Both paths produce bit identical buffers
+// as long as the compiler does not contract multiply-adds (MSVC default, -ffp-contract=off on GCC/Clang).
+class MaskedOcclusionRasterizer
+{
+    MaskedOcclusionRasterizer(const MaskedOcclusionRasterizer&) = delete;
+    MaskedOcclusionRasterizer& operator=(const MaskedOcclusionRasterizer&) = delete;
+
+public:
+    static constexpr uint32_t TILE_WIDTH = 32;
+    static constexpr uint32_t TILE_HEIGHT = 8;
+    static constexpr uint32_t DEFAULT_WIDTH = 256;
+    static constexpr uint32_t DEFAULT_HEIGHT = 128;
+    // Triangles and boxes with a vertex closer than this clip space w are not clipped, they are handled conservatively
+    static constexpr float NEAR_CLIP_W = 1e-4f;
+
+    MaskedOcclusionRasterizer() = default;
+    ~MaskedOcclusionRasterizer() = default;
+
+    bool Initialize(uint32_t width = DEFAULT_WIDTH, uint32_t height = DEFAULT_HEIGHT);
+    void ClearBuffer();
+
+    // Rasterizes indexed occluder triangles. positions is strided so interleaved vertex data can be passed directly.
+    void RenderTriangles(const XMFLOAT3* positions, size_t strideBytes, const uint32_t* indices, size_t triangleCount,
+        FXMMATRIX modelToClip, CullPath path = DEFAULT_CULL_PATH);
+
+    // Tests a screen space rectangle in pixels against the buffer, zMin is the nearest depth of the tested object
+    OcclusionResult TestRect(float xMin, float yMin, float xMax, float yMax, float zMin) const;
+    OcclusionResult TestAABB(const AABB& bounds, FXMMATRIX modelToClip) const;
+
+    // Resolves the conservative depth of every pixel, used to compare against reference images
+    void ComputeDepthImage(std::vector<float>& outDepth) const;
+    bool WriteDepthImage(const std::string& filePath) const;
+
+    uint32_t GetWidth() const { return m_width; }
+    uint32_t GetHeight() const { return m_height; }
+    static bool IsCullPathSupported(CullPath path);
+
+private:
+    struct alignas(32) Tile
+    {
+        uint32_t mask[TILE_HEIGHT];
+        float zMax0;
+        float zMax1;
+    };
+
+    struct ScreenTriangle
+    {
+        float x[3];
+        float y[3];
+        float z[3];
+    };
+
+    struct TriangleSetup
+    {
+        // Edge functions a * x + b * y + c, positive inside
+        float edgeA[3];
+        float edgeB[3];
+        float edgeC[3];
+        float edgeInvA[3];
+        // Depth plane z = zA * x + zB * y + zC
+        float zA;
+        float zB;
+        float zC;
+        float zMin;
+        float zMax;
+        uint32_t tileMinX;
+        uint32_t tileMinY;
+        uint32_t tileMaxX;
+        uint32_t tileMaxY;
+    };
+
+    bool SetupTriangle(const ScreenTriangle& triangle, TriangleSetup& outSetup) const;
+    void RasterizeTriangle(const TriangleSetup& setup, CullPath path);
+    float ComputeTileDepth(const TriangleSetup& setup, uint32_t tileX, uint32_t tileY) const;
+    void ComputeCoverageScalar(const TriangleSetup& setup, uint32_t tileX, uint32_t tileY, uint32_t* outMask) const;
+    void ComputeCoverageAVX2(const TriangleSetup& setup, uint32_t tileX, uint32_t tileY, uint32_t* outMask) const;
+    static void UpdateTile(Tile& tile, const uint32_t* coverage, float zTile);
+
+    std::vector<Tile> m_tiles;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_tilesX = 0;
+    uint32_t m_tilesY = 0;
+};
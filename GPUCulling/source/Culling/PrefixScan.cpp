@@ -0,0 +1,332 @@
+#include "stdafx.h"
+#include "Culling/PrefixScan.h"
+
+#include "System/ThreadPool.h"
+
+#include <bit>
+#include <immintrin.h>
+
+namespace
+{
+    // Lane positions of the set bits of every 8-bit mask, packed one byte each from the lowest lane up
+    constexpr std::array<uint64_t, 256> BuildCompactTable()
+    {
+        std::array<uint64_t, 256> table = {};
+        for (uint32_t mask = 0; mask < 256; ++mask)
+        {
+            uint32_t slot = 0;
+            for (uint32_t lane = 0; lane < 8; ++lane)
+            {
+                if (mask & (1u << lane))
+                {
+                    table[mask] |= uint64_t(lane) << (slot * 8);
+                    ++slot;
+                }
+            }
+        }
+        return table;
+    }
+
+    constexpr std::array<uint64_t, 256> COMPACT_TABLE = BuildCompactTable();
+
+    size_t GetBlockCount(size_t count)
+    {
+        return (count + PrefixScan::BLOCK_SIZE - 1) / PrefixScan::BLOCK_SIZE;
+    }
+
+    // Turns the per block sums into block offsets and returns the total
+    uint32_t ScanBlockSums(std::vector<uint32_t>& blockSums)
+    {
+        uint32_t total = 0;
+        for (uint32_t& sum : blockSums)
+        {
+            uint32_t blockSum = sum;
+            sum = total;
+            total += blockSum;
+        }
+        return total;
+    }
+}
+
+uint32_t PrefixScan::ExclusiveScan(const uint32_t* values, size_t count, uint32_t* outSums, CullPath path)
+{
+    assertm(count == 0 || (values != nullptr && outSums != nullptr), "PrefixScan::ExclusiveScan called with null buffers");
+    assertm(path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2, "PrefixScan::ExclusiveScan called with a path this build does not support");
+
+    size_t blockCount = GetBlockCount(count);
+    if (blockCount <= 1)
+    {
+        uint32_t total = ReduceBlock(values, 0, count, path);
+        ScanBlock(values, 0, count, 0, outSums, path);
+        return total;
+    }
+
+    m_blockSums.resize(blockCount);
+    ThreadPool::Get().ParallelFor(blockCount, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t block = begin; block < end; ++block)
+        {
+            m_blockSums[block] = ReduceBlock(values, block * BLOCK_SIZE, std::min((block + 1) * BLOCK_SIZE, count), path);
+        }
+    });
+
+    uint32_t total = ScanBlockSums(m_blockSums);
+
+    ThreadPool::Get().ParallelFor(blockCount, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t block = begin; block < end; ++block)
+        {
+            ScanBlock(values, block * BLOCK_SIZE, std::min((block + 1) * BLOCK_SIZE, count), m_blockSums[block], outSums, path);
+        }
+    });
+
+    return total;
+}
+
+size_t PrefixScan::Compact(const uint32_t* flags, size_t count, uint32_t* outIndices, CullPath path)
+{
+    assertm(count == 0 || (flags != nullptr && outIndices != nullptr), "PrefixScan::Compact called with null buffers");
+    assertm(count <= UINT32_MAX, "PrefixScan::Compact element count exceeds 32-bit index range");
+    assertm(path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2, "PrefixScan::Compact called with a path this build does not support");
+
+    // A single block never writes past its own input position, so it needs no count up front
+    size_t blockCount = GetBlockCount(count);
+    if (blockCount <= 1)
+    {
+        return CompactBlock(flags, 0, count, outIndices, count, path);
+    }
+
+    m_blockSums.resize(blockCount);
+    ThreadPool::Get().ParallelFor(blockCount, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t block = begin; block < end; ++block)
+        {
+            m_blockSums[block] = CountBlock(flags, block * BLOCK_SIZE, std::min((block + 1) * BLOCK_SIZE, count), path);
+        }
+    });
+
+    // Blocks write next to each other, so each one may only store full registers inside its own count
+    m_blockCounts = m_blockSums;
+    uint32_t total = ScanBlockSums(m_blockSums);
+
+    ThreadPool::Get().ParallelFor(blockCount, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t block = begin; block < end; ++block)
+        {
+            CompactBlock(flags, block * BLOCK_SIZE, std::min((block + 1) * BLOCK_SIZE, count), outIndices + m_blockSums[block],
+                m_blockCounts[block], path);
+        }
+    });
+
+    return total;
+}
+
+size_t PrefixScan::Compact(const uint32_t* flags, size_t count, std::vector<uint32_t>& outIndices, CullPath path)
+{
+    outIndices.resize(count);
+    size_t keptCount = Compact(flags, count, outIndices.data(), path);
+    outIndices.resize(keptCount);
+    return keptCount;
+}
+
+uint32_t PrefixScan::ReduceBlock(const uint32_t* values, size_t begin, size_t end, CullPath path)
+{
+    size_t i = begin;
+    uint32_t sum = 0;
+
+    switch (path)
+    {
+#if defined(__AVX2__)
+    case CullPath::AVX2:
+    {
+        __m256i sums = _mm256_setzero_si256();
+        for (; i + 8 <= end; i += 8)
+        {
+            sums = _mm256_add_epi32(sums, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum = static_cast<uint32_t>(_mm_cvtsi128_si32(half));
+        break;
+    }
+#endif
+    case CullPath::SSE:
+    {
+        __m128i sums = _mm_setzero_si128();
+        for (; i + 4 <= end; i += 4)
+        {
+            sums = _mm_add_epi32(sums, _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)));
+        }
+        sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(1, 0, 3, 2)));
+        sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum = static_cast<uint32_t>(_mm_cvtsi128_si32(sums));
+        break;
+    }
+    default:
+        break;
+    }
+
+    for (; i < end; ++i)
+    {
+        sum += values[i];
+    }
+    return sum;
+}
+
+void PrefixScan::ScanBlock(const uint32_t* values, size_t begin, size_t end, uint32_t offset, uint32_t* outSums, CullPath path)
+{
+    size_t i = begin;
+    uint32_t running = offset;
+
+    switch (path)
+    {
+#if defined(__AVX2__)
+    case CullPath::AVX2:
+    {
+        // Inclusive scan inside each 128-bit half, then the low half's total is carried into the high half
+        __m256i carry = _mm256_set1_epi32(static_cast<int>(running));
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+            __m256i inclusive = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+            inclusive = _mm256_add_epi32(inclusive, _mm256_slli_si256(inclusive, 8));
+            __m256i lowTotal = _mm256_shuffle_epi32(inclusive, _MM_SHUFFLE(3, 3, 3, 3));
+            inclusive = _mm256_add_epi32(inclusive, _mm256_permute2x128_si256(lowTotal, lowTotal, 0x08));
+
+            __m256i exclusive = _mm256_add_epi32(carry, _mm256_sub_epi32(inclusive, x));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(outSums + i), exclusive);
+            carry = _mm256_add_epi32(carry, _mm256_permutevar8x32_epi32(inclusive, _mm256_set1_epi32(7)));
+        }
+        running = static_cast<uint32_t>(_mm256_cvtsi256_si32(carry));
+        break;
+    }
+#endif
+    case CullPath::SSE:
+    {
+        __m128i carry = _mm_set1_epi32(static_cast<int>(running));
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+            __m128i inclusive = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+            inclusive = _mm_add_epi32(inclusive, _mm_slli_si128(inclusive, 8));
+
+            __m128i exclusive = _mm_add_epi32(carry, _mm_sub_epi32(inclusive, x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(outSums + i), exclusive);
+            carry = _mm_add_epi32(carry, _mm_shuffle_epi32(inclusive, _MM_SHUFFLE(3, 3, 3, 3)));
+        }
+        running = static_cast<uint32_t>(_mm_cvtsi128_si32(carry));
+        break;
+    }
+    default:
+        break;
+    }
+
+    for (; i < end; ++i)
+    {
+        uint32_t value = values[i];
+        outSums[i] = running;
+        running += value;
+    }
+}
+
+uint32_t PrefixScan::CountBlock(const uint32_t* flags, size_t begin, size_t end, CullPath path)
+{
+    size_t i = begin;
+    uint32_t keptCount = 0;
+
+    switch (path)
+    {
+#if defined(__AVX2__)
+    case CullPath::AVX2:
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256i cleared = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(flags + i)), zero);
+            keptCount += 8 - std::popcount(static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(cleared))));
+        }
+        break;
+    }
+#endif
+    case CullPath::SSE:
+    {
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128i cleared = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(flags + i)), zero);
+            keptCount += 4 - std::popcount(static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(cleared))));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    for (; i < end; ++i)
+    {
+        keptCount += flags[i] != 0 ? 1 : 0;
+    }
+    return keptCount;
+}
+
+size_t PrefixScan::CompactBlock(const uint32_t* flags, size_t begin, size_t end, uint32_t* outIndices, size_t outputLimit, CullPath path)
+{
+    size_t i = begin;
+    size_t keptCount = 0;
+
+    switch (path)
+    {
+#if defined(__AVX2__)
+    case CullPath::AVX2:
+    {
+        // The table packs the kept lanes to the front, one full store writes them and garbage the next store overwrites
+        const __m256i zero = _mm256_setzero_si256();
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256i cleared = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(flags + i)), zero);
+            uint32_t keepMask = ~static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(cleared))) & 0xFF;
+            if (keptCount + 8 <= outputLimit)
+            {
+                __m256i lanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&COMPACT_TABLE[keepMask])));
+                __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), lanes);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(outIndices + keptCount), indices);
+                keptCount += std::popcount(keepMask);
+                continue;
+            }
+
+            for (; keepMask; keepMask &= keepMask - 1)
+            {
+                outIndices[keptCount++] = static_cast<uint32_t>(i) + std::countr_zero(keepMask);
+            }
+        }
+        break;
+    }
+#endif
+    case CullPath::SSE:
+    {
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128i cleared = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(flags + i)), zero);
+            uint32_t keepMask = ~static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(cleared))) & 0xF;
+            for (; keepMask; keepMask &= keepMask - 1)
+            {
+                outIndices[keptCount++] = static_cast<uint32_t>(i) + std::countr_zero(keepMask);
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    for (; i < end; ++i)
+    {
+        if (flags[i] != 0)
+        {
+            outIndices[keptCount++] = static_cast<uint32_t>(i);
+        }
+    }
+    return keptCount;
+}
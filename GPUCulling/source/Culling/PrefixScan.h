@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Culling/CullingCommon.h"
+#include "Shaders/PrefixScanShared.h"
+#include <vector>
+#include <cstdint>
+
+// Exclusive prefix sums and stream compaction, the primitive that turns sparse per element culling flags into dense
+// index lists. Large inputs are split into blocks on the thread pool: every block is reduced, the block sums are
+// scanned serially, then every block is scanned again from its offset. Inside a block the SSE and AVX2 paths scan
+// 4 or 8 values in register and compact 8 flags per step.
+// PrefixScan.hlsl is the single pass GPU version and produces the same sums and indices from the same input.
+class PrefixScan
+{
+    PrefixScan(const PrefixScan&) = delete;
+    PrefixScan& operator=(const PrefixScan&) = delete;
+
+public:
+    // Elements per thread pool batch, a multiple of the GPU partition size
+    static constexpr size_t BLOCK_SIZE = ShaderInterop::SCAN_PARTITION_SIZE * 16;
+
+    PrefixScan() = default;
+    ~PrefixScan() = default;
+
+    // outSums[i] is the sum of values[0, i), sums wrap around like the 32-bit GPU adds. outSums may alias values.
+    // Returns the total.
+    uint32_t ExclusiveScan(const uint32_t* values, size_t count, uint32_t* outSums, CullPath path = DEFAULT_CULL_PATH);
+
+    // Writes the index of every non zero flag in ascending order. outIndices must hold count elements.
+    // Returns the kept count.
+    size_t Compact(const uint32_t* flags, size_t count, uint32_t* outIndices, CullPath path = DEFAULT_CULL_PATH);
+    size_t Compact(const uint32_t* flags, size_t count, std::vector<uint32_t>& outIndices, CullPath path = DEFAULT_CULL_PATH);
+
+private:
+    static uint32_t ReduceBlock(const uint32_t* values, size_t begin, size_t end, CullPath path);
+    static void ScanBlock(const uint32_t* values, size_t begin, size_t end, uint32_t offset, uint32_t* outSums, CullPath path);
+    static uint32_t CountBlock(const uint32_t* flags, size_t begin, size_t end, CullPath path);
+    // outputLimit bounds how far past the written indices full register stores may reach
+    static size_t CompactBlock(const uint32_t* flags, size_t begin, size_t end, uint32_t* outIndices, size_t outputLimit, CullPath path);
+
+    // Per block sums, turned into block offsets by the serial scan
+    std::vector<uint32_t> m_blockSums;
+    std::vector<uint32_t> m_blockCounts;
+};
@@ -0,0 +1,153 @@
+#include "stdafx.h"
+#include "Culling/QuantizedBounds.h"
+
+#include <DirectXPackedVector.h>
+#include <cmath>
+
+using namespace ShaderInterop;
+
+namespace
+{
+    // The scale is nudged up until the top code reaches max despite rounding
+    void ComputeQuantization(float minValue, float maxValue, float& outOrigin, float& outScale)
+    {
+        outOrigin = minValue;
+        outScale = (maxValue - minValue) / static_cast<float>(QUANTIZED_BOUNDS_MAX_CODE);
+        while (DequantizeBound(QUANTIZED_BOUNDS_MAX_CODE, outOrigin, outScale) < maxValue)
+        {
+            outScale = std::nextafter(outScale, FLT_MAX);
+        }
+    }
+
+    float GetCellMax(float origin, float scale)
+    {
+        return DequantizeBound(QUANTIZED_BOUNDS_MAX_CODE, origin, scale);
+    }
+
+    float Distance(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        float dx = a.x - b.x;
+        float dy = a.y - b.y;
+        float dz = a.z - b.z;
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    QuantizedBounds EncodeBox(const AABB& bounds, const BoundsQuantization& quantization)
+    {
+        const float3& origin = quantization.origin;
+        const float3& scale = quantization.scale;
+
+        QuantizedBounds result = {};
+        result.minXY = QuantizeBoundMin(bounds.min.x, origin.x, scale.x) | (uint32_t(QuantizeBoundMin(bounds.min.y, origin.y, scale.y)) << 16);
+        result.minZMaxX = QuantizeBoundMin(bounds.min.z, origin.z, scale.z) | (uint32_t(QuantizeBoundMax(bounds.max.x, origin.x, scale.x)) << 16);
+        result.maxYZ = QuantizeBoundMax(bounds.max.y, origin.y, scale.y) | (uint32_t(QuantizeBoundMax(bounds.max.z, origin.z, scale.z)) << 16);
+        return result;
+    }
+}
+
+BoundsQuantization MakeBoundsQuantization(const AABB& cellBounds)
+{
+    assertm(cellBounds.IsValid(), "MakeBoundsQuantization called with invalid bounds");
+
+    BoundsQuantization quantization = {};
+    ComputeQuantization(cellBounds.min.x, cellBounds.max.x, quantization.origin.x, quantization.scale.x);
+    ComputeQuantization(cellBounds.min.y, cellBounds.max.y, quantization.origin.y, quantization.scale.y);
+    ComputeQuantization(cellBounds.min.z, cellBounds.max.z, quantization.origin.z, quantization.scale.z);
+    return quantization;
+}
+
+bool IsInsideQuantization(const AABB& bounds, const BoundsQuantization& quantization)
+{
+    const float3& origin = quantization.origin;
+    const float3& scale = quantization.scale;
+    return bounds.min.x >= origin.x && bounds.min.y >= origin.y && bounds.min.z >= origin.z &&
+        bounds.max.x <= GetCellMax(origin.x, scale.x) && bounds.max.y <= GetCellMax(origin.y, scale.y) &&
+        bounds.max.z <= GetCellMax(origin.z, scale.z);
+}
+
+uint16_t QuantizeBoundMin(float value, float origin, float scale)
+{
+    if (scale <= 0.0f)
+    {
+        return 0;
+    }
+
+    int32_t q = std::clamp(static_cast<int32_t>(std::floor((value - origin) / scale)), 0, static_cast<int32_t>(QUANTIZED_BOUNDS_MAX_CODE));
+    while (q > 0 && DequantizeBound(static_cast<uint32_t>(q), origin, scale) > value)
+    {
+        --q;
+    }
+    // The division can also round a code short, which would loosen the bound by a step
+    while (q < static_cast<int32_t>(QUANTIZED_BOUNDS_MAX_CODE) && DequantizeBound(static_cast<uint32_t>(q + 1), origin, scale) <= value)
+    {
+        ++q;
+    }
+    return static_cast<uint16_t>(q);
+}
+
+uint16_t QuantizeBoundMax(float value, float origin, float scale)
+{
+    if (scale <= 0.0f)
+    {
+        return 0;
+    }
+
+    int32_t q = std::clamp(static_cast<int32_t>(std::ceil((value - origin) / scale)), 0, static_cast<int32_t>(QUANTIZED_BOUNDS_MAX_CODE));
+    while (q < static_cast<int32_t>(QUANTIZED_BOUNDS_MAX_CODE) && DequantizeBound(static_cast<uint32_t>(q), origin, scale) < value)
+    {
+        ++q;
+    }
+    while (q > 0 && DequantizeBound(static_cast<uint32_t>(q - 1), origin, scale) >= value)
+    {
+        --q;
+    }
+    return static_cast<uint16_t>(q);
+}
+
+uint32_t QuantizeRadius(float radius)
+{
+    // Positive half floats order like their bits, stepping the bits moves to the next larger value
+    uint32_t bits = PackedVector::XMConvertFloatToHalf(radius);
+    while (f16tof32(bits) < radius)
+    {
+        ++bits;
+    }
+    return bits;
+}
+
+QuantizedBounds QuantizeBounds(const AABB& bounds, const BoundsQuantization& quantization)
+{
+    assertm(bounds.IsValid(), "QuantizeBounds called with invalid bounds");
+    assertm(IsInsideQuantization(bounds, quantization), "QuantizeBounds called with bounds outside the quantization cell");
+
+    QuantizedBounds result = EncodeBox(bounds, quantization);
+    float3 boundsMin = GetQuantizedBoundsMin(result, quantization);
+    float3 boundsMax = GetQuantizedBoundsMax(result, quantization);
+
+    // Absorbs the rounding of the center and of the plane distance the sphere test evaluates
+    float halfDiagonal = Distance(boundsMin, boundsMax) * 0.5f;
+    result.radius = QuantizeRadius(halfDiagonal * (1.0f + 1e-5f));
+    return result;
+}
+
+QuantizedBounds QuantizeBounds(const AABB& bounds, const Sphere& sphere, const BoundsQuantization& quantization)
+{
+    QuantizedBounds result = QuantizeBounds(bounds, quantization);
+
+    // The sphere only helps when it is tighter than the box after moving it to the box center
+    float3 center = GetQuantizedBoundsCenter(result, quantization);
+    float movedRadius = (sphere.radius + Distance(sphere.center, center)) * (1.0f + 1e-5f);
+    if (movedRadius < GetQuantizedBoundsRadius(result))
+    {
+        result.radius = QuantizeRadius(movedRadius);
+    }
+    return result;
+}
+
+AABB DequantizeBounds(const QuantizedBounds& bounds, const BoundsQuantization& quantization)
+{
+    AABB result;
+    result.min = GetQuantizedBoundsMin(bounds, quantization);
+    result.max = GetQuantizedBoundsMax(bounds, quantization);
+    return result;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include "Shaders/QuantizedBoundsShared.h"
+#include <cstdint>
+
+// CPU encoder of the 16-bit bounds format in Shaders/QuantizedBoundsShared.h. Encoding checks every code against the
+// shared decode and steps it outward until the decoded value encloses the input, so culling the decoded bounds never
+// rejects anything the float bounds would keep.
+
+// Covers cellBounds with 65536 steps per axis, the top code decodes to at least the max
+ShaderInterop::BoundsQuantization MakeBoundsQuantization(const AABB& cellBounds);
+// Whether the bounds can be encoded without clamping to the cell
+bool IsInsideQuantization(const AABB& bounds, const ShaderInterop::BoundsQuantization& quantization);
+
+// Largest code decoding to at most value and smallest code decoding to at least value, clamped to the cell
+uint16_t QuantizeBoundMin(float value, float origin, float scale);
+uint16_t QuantizeBoundMax(float value, float origin, float scale);
+// Smallest half float at least radius, in the low 16 bits
+uint32_t QuantizeRadius(float radius);
+
+// The radius is the half diagonal of the decoded box
+ShaderInterop::QuantizedBounds QuantizeBounds(const AABB& bounds, const ShaderInterop::BoundsQuantization& quantization);
+// The radius also considers the sphere, moved to the decoded box center, and takes whichever is smaller
+ShaderInterop::QuantizedBounds QuantizeBounds(const AABB& bounds, const Sphere& sphere, const ShaderInterop::BoundsQuantization& quantization);
+
+AABB DequantizeBounds(const ShaderInterop::QuantizedBounds& bounds, const ShaderInterop::BoundsQuantization& quantization);
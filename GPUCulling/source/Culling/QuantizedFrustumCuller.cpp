@@ -0,0 +1,337 @@
+#include "stdafx.h"
+#include "Culling/QuantizedFrustumCuller.h"
+
+#include <bit>
+#include <immintrin.h>
+
+using namespace ShaderInterop;
+
+namespace
+{
+#if defined(__AVX2__)
+    // For every 8 bit visibility mask, the lane permutation that packs the visible lanes to the front
+    constexpr std::array<std::array<int32_t, 8>, 256> BuildCompactionTable()
+    {
+        std::array<std::array<int32_t, 8>, 256> table = {};
+        for (uint32_t mask = 0; mask < 256; ++mask)
+        {
+            uint32_t count = 0;
+            for (int32_t lane = 0; lane < 8; ++lane)
+            {
+                if (mask & (1u << lane))
+                {
+                    table[mask][count++] = lane;
+                }
+            }
+        }
+        return table;
+    }
+
+    alignas(32) constexpr std::array<std::array<int32_t, 8>, 256> COMPACTION_TABLE = BuildCompactionTable();
+#endif
+}
+
+void QuantizedFrustumCuller::Initialize(const AABB& cellBounds)
+{
+    Clear();
+    SetCell(cellBounds);
+}
+
+void QuantizedFrustumCuller::Reserve(size_t instanceCount)
+{
+    m_minX.reserve(instanceCount);
+    m_minY.reserve(instanceCount);
+    m_minZ.reserve(instanceCount);
+    m_maxX.reserve(instanceCount);
+    m_maxY.reserve(instanceCount);
+    m_maxZ.reserve(instanceCount);
+}
+
+void QuantizedFrustumCuller::Clear()
+{
+    m_minX.clear();
+    m_minY.clear();
+    m_minZ.clear();
+    m_maxX.clear();
+    m_maxY.clear();
+    m_maxZ.clear();
+}
+
+uint32_t QuantizedFrustumCuller::AddInstance(const AABB& bounds)
+{
+    assertm(m_minX.size() < UINT32_MAX, "QuantizedFrustumCuller instance count exceeds 32-bit index range");
+
+    uint32_t instanceIndex = static_cast<uint32_t>(m_minX.size());
+    m_minX.push_back(0);
+    m_minY.push_back(0);
+    m_minZ.push_back(0);
+    m_maxX.push_back(0);
+    m_maxY.push_back(0);
+    m_maxZ.push_back(0);
+    SetInstanceBounds(instanceIndex, bounds);
+    return instanceIndex;
+}
+
+void QuantizedFrustumCuller::SetInstanceBounds(uint32_t instanceIndex, const AABB& bounds)
+{
+    assert(instanceIndex < m_minX.size());
+    assertm(bounds.IsValid(), "QuantizedFrustumCuller::SetInstanceBounds called with invalid bounds");
+
+    if (!m_cellBounds.IsValid() || !IsInsideQuantization(bounds, m_quantization))
+    {
+        GrowCell(bounds);
+    }
+    EncodeInstance(instanceIndex, bounds);
+}
+
+AABB QuantizedFrustumCuller::GetInstanceBounds(uint32_t instanceIndex) const
+{
+    assert(instanceIndex < m_minX.size());
+
+    AABB bounds;
+    bounds.min.x = DequantizeBound(m_minX[instanceIndex], m_quantization.origin.x, m_quantization.scale.x);
+    bounds.min.y = DequantizeBound(m_minY[instanceIndex], m_quantization.origin.y, m_quantization.scale.y);
+    bounds.min.z = DequantizeBound(m_minZ[instanceIndex], m_quantization.origin.z, m_quantization.scale.z);
+    bounds.max.x = DequantizeBound(m_maxX[instanceIndex], m_quantization.origin.x, m_quantization.scale.x);
+    bounds.max.y = DequantizeBound(m_maxY[instanceIndex], m_quantization.origin.y, m_quantization.scale.y);
+    bounds.max.z = DequantizeBound(m_maxZ[instanceIndex], m_quantization.origin.z, m_quantization.scale.z);
+    return bounds;
+}
+
+void QuantizedFrustumCuller::SetCell(const AABB& cellBounds)
+{
+    m_cellBounds = cellBounds;
+    m_quantization = MakeBoundsQuantization(cellBounds);
+}
+
+void QuantizedFrustumCuller::EncodeInstance(uint32_t instanceIndex, const AABB& bounds)
+{
+    const float3& origin = m_quantization.origin;
+    const float3& scale = m_quantization.scale;
+    m_minX[instanceIndex] = QuantizeBoundMin(bounds.min.x, origin.x, scale.x);
+    m_minY[instanceIndex] = QuantizeBoundMin(bounds.min.y, origin.y, scale.y);
+    m_minZ[instanceIndex] = QuantizeBoundMin(bounds.min.z, origin.z, scale.z);
+    m_maxX[instanceIndex] = QuantizeBoundMax(bounds.max.x, origin.x, scale.x);
+    m_maxY[instanceIndex] = QuantizeBoundMax(bounds.max.y, origin.y, scale.y);
+    m_maxZ[instanceIndex] = QuantizeBoundMax(bounds.max.z, origin.z, scale.z);
+}
+
+void QuantizedFrustumCuller::GrowCell(const AABB& bounds)
+{
+    std::vector<AABB> decoded(m_cellBounds.IsValid() ? GetInstanceCount() : 0);
+    for (size_t i = 0; i < decoded.size(); ++i)
+    {
+        decoded[i] = GetInstanceBounds(static_cast<uint32_t>(i));
+    }
+
+    // Doubling keeps the number of re-encodes logarithmic in the growth of the scene
+    AABB cell = bounds;
+    if (m_cellBounds.IsValid())
+    {
+        cell.Merge(m_cellBounds);
+        XMFLOAT3 center = cell.GetCenter();
+        XMFLOAT3 extents = cell.GetExtents();
+        cell.min = XMFLOAT3(center.x - 2.0f * extents.x, center.y - 2.0f * extents.y, center.z - 2.0f * extents.z);
+        cell.max = XMFLOAT3(center.x + 2.0f * extents.x, center.y + 2.0f * extents.y, center.z + 2.0f * extents.z);
+        // The rounding of the center must not cut off either box
+        cell.Merge(bounds);
+        cell.Merge(m_cellBounds);
+    }
+    SetCell(cell);
+
+    for (size_t i = 0; i < decoded.size(); ++i)
+    {
+        EncodeInstance(static_cast<uint32_t>(i), decoded[i]);
+    }
+}
+
+size_t QuantizedFrustumCuller::Cull(const Frustum& frustum, uint32_t* outVisibleIndices, CullPath path) const
+{
+    assertm(outVisibleIndices != nullptr, "QuantizedFrustumCuller::Cull called with null output buffer");
+    assertm(path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2, "QuantizedFrustumCuller::Cull called with a path this build does not support");
+
+    PlaneStreams streams[FRUSTUM_PLANE_COUNT];
+    SelectPlaneStreams(frustum, streams);
+
+    switch (path)
+    {
+    case CullPath::AVX2:
+        return CullAVX2(streams, outVisibleIndices);
+    case CullPath::SSE:
+        return CullSSE(streams, outVisibleIndices);
+    default:
+        return CullScalar(streams, 0, GetInstanceCount(), outVisibleIndices);
+    }
+}
+
+size_t QuantizedFrustumCuller::Cull(const Frustum& frustum, std::vector<uint32_t>& outVisibleIndices, CullPath path) const
+{
+    outVisibleIndices.resize(GetInstanceCount() + OUTPUT_PADDING);
+    size_t visibleCount = Cull(frustum, outVisibleIndices.data(), path);
+    outVisibleIndices.resize(visibleCount);
+    return visibleCount;
+}
+
+void QuantizedFrustumCuller::SelectPlaneStreams(const Frustum& frustum, PlaneStreams* outStreams) const
+{
+    const float3& origin = m_quantization.origin;
+    const float3& scale = m_quantization.scale;
+
+    for (uint32_t i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+    {
+        const XMFLOAT4& plane = frustum.planes[i];
+        outStreams[i].x = plane.x >= 0.0f ? 1 : 0;
+        outStreams[i].y = plane.y >= 0.0f ? 1 : 0;
+        outStreams[i].z = plane.z >= 0.0f ? 1 : 0;
+
+        // The decode is folded into the plane, n . (origin + q * scale) + w = (n * scale) . q + (n . origin + w), so
+        // the codes are only converted to float. Both sides round differently from the decode, the distance is
+        // raised by a few ulps of its largest term so no box the decoded bounds keep is culled.
+        float largestTerm = std::abs(plane.x) * (std::abs(origin.x) + QUANTIZED_BOUNDS_MAX_CODE * scale.x) +
+            std::abs(plane.y) * (std::abs(origin.y) + QUANTIZED_BOUNDS_MAX_CODE * scale.y) +
+            std::abs(plane.z) * (std::abs(origin.z) + QUANTIZED_BOUNDS_MAX_CODE * scale.z) + std::abs(plane.w);
+        outStreams[i].plane = XMFLOAT4(plane.x * scale.x, plane.y * scale.y, plane.z * scale.z,
+            plane.x * origin.x + plane.y * origin.y + plane.z * origin.z + plane.w + 8.0f * FLT_EPSILON * largestTerm);
+    }
+}
+
+size_t QuantizedFrustumCuller::CullScalar(const PlaneStreams* streams, size_t begin, size_t end, uint32_t* outVisibleIndices) const
+{
+    // One instance at a time there is nothing to share, each plane reads and converts its p-vertex codes directly
+    const uint16_t* x[2] = { m_minX.data(), m_maxX.data() };
+    const uint16_t* y[2] = { m_minY.data(), m_maxY.data() };
+    const uint16_t* z[2] = { m_minZ.data(), m_maxZ.data() };
+    const uint16_t* planeX[FRUSTUM_PLANE_COUNT];
+    const uint16_t* planeY[FRUSTUM_PLANE_COUNT];
+    const uint16_t* planeZ[FRUSTUM_PLANE_COUNT];
+    for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        planeX[p] = x[streams[p].x];
+        planeY[p] = y[streams[p].y];
+        planeZ[p] = z[streams[p].z];
+    }
+
+    size_t visibleCount = 0;
+    for (size_t i = begin; i < end; ++i)
+    {
+        bool outside = false;
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            const XMFLOAT4& plane = streams[p].plane;
+            float distance = plane.x * static_cast<float>(planeX[p][i]) + plane.y * static_cast<float>(planeY[p][i]) +
+                plane.z * static_cast<float>(planeZ[p][i]) + plane.w;
+            outside |= distance < 0.0f;
+        }
+
+        // Branch free compaction: always write, only advance when visible
+        outVisibleIndices[visibleCount] = static_cast<uint32_t>(i);
+        visibleCount += outside ? 0 : 1;
+    }
+    return visibleCount;
+}
+
+size_t QuantizedFrustumCuller::CullSSE(const PlaneStreams* streams, uint32_t* outVisibleIndices) const
+{
+    const size_t count = GetInstanceCount();
+    const size_t simdCount = count & ~size_t(3);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128i zeroInt = _mm_setzero_si128();
+
+    // 4 codes widened with an unpack, SSE2 has no zero extending conversion
+    auto widen = [&](const uint16_t* codes)
+    {
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes)), zeroInt));
+    };
+
+    __m128 nx[FRUSTUM_PLANE_COUNT], ny[FRUSTUM_PLANE_COUNT], nz[FRUSTUM_PLANE_COUNT], nw[FRUSTUM_PLANE_COUNT];
+    for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        nx[p] = _mm_set1_ps(streams[p].plane.x);
+        ny[p] = _mm_set1_ps(streams[p].plane.y);
+        nz[p] = _mm_set1_ps(streams[p].plane.z);
+        nw[p] = _mm_set1_ps(streams[p].plane.w);
+    }
+
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < simdCount; i += 4)
+    {
+        // Every code array is converted once, the planes pick their p-vertex components from the converted registers
+        __m128 x[2] = { widen(m_minX.data() + i), widen(m_maxX.data() + i) };
+        __m128 y[2] = { widen(m_minY.data() + i), widen(m_maxY.data() + i) };
+        __m128 z[2] = { widen(m_minZ.data() + i), widen(m_maxZ.data() + i) };
+
+        __m128 outside = _mm_setzero_ps();
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            __m128 distance = _mm_mul_ps(nx[p], x[streams[p].x]);
+            distance = _mm_add_ps(distance, _mm_mul_ps(ny[p], y[streams[p].y]));
+            distance = _mm_add_ps(distance, _mm_mul_ps(nz[p], z[streams[p].z]));
+            distance = _mm_add_ps(distance, nw[p]);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+        }
+
+        uint32_t visibleMask = ~static_cast<uint32_t>(_mm_movemask_ps(outside)) & 0xFu;
+        while (visibleMask)
+        {
+            outVisibleIndices[visibleCount++] = static_cast<uint32_t>(i) + std::countr_zero(visibleMask);
+            visibleMask &= visibleMask - 1;
+        }
+    }
+
+    return visibleCount + CullScalar(streams, simdCount, count, outVisibleIndices + visibleCount);
+}
+
+size_t QuantizedFrustumCuller::CullAVX2(const PlaneStreams* streams, uint32_t* outVisibleIndices) const
+{
+#if defined(__AVX2__)
+    const size_t count = GetInstanceCount();
+    const size_t simdCount = count & ~size_t(7);
+    const __m256 zero = _mm256_setzero_ps();
+
+    auto widen = [](const uint16_t* codes)
+    {
+        return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(codes))));
+    };
+
+    __m256 nx[FRUSTUM_PLANE_COUNT], ny[FRUSTUM_PLANE_COUNT], nz[FRUSTUM_PLANE_COUNT], nw[FRUSTUM_PLANE_COUNT];
+    for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        nx[p] = _mm256_set1_ps(streams[p].plane.x);
+        ny[p] = _mm256_set1_ps(streams[p].plane.y);
+        nz[p] = _mm256_set1_ps(streams[p].plane.z);
+        nw[p] = _mm256_set1_ps(streams[p].plane.w);
+    }
+
+    __m256i indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i indexStep = _mm256_set1_epi32(8);
+
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < simdCount; i += 8)
+    {
+        __m256 x[2] = { widen(m_minX.data() + i), widen(m_maxX.data() + i) };
+        __m256 y[2] = { widen(m_minY.data() + i), widen(m_maxY.data() + i) };
+        __m256 z[2] = { widen(m_minZ.data() + i), widen(m_maxZ.data() + i) };
+
+        __m256 outside = _mm256_setzero_ps();
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            __m256 distance = _mm256_mul_ps(nx[p], x[streams[p].x]);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(ny[p], y[streams[p].y]));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(nz[p], z[streams[p].z]));
+            distance = _mm256_add_ps(distance, nw[p]);
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero, _CMP_LT_OQ));
+        }
+
+        uint32_t visibleMask = ~static_cast<uint32_t>(_mm256_movemask_ps(outside)) & 0xFFu;
+        __m256i permutation = _mm256_load_si256(reinterpret_cast<const __m256i*>(COMPACTION_TABLE[visibleMask].data()));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(outVisibleIndices + visibleCount), _mm256_permutevar8x32_epi32(indices, permutation));
+        visibleCount += std::popcount(visibleMask);
+        indices = _mm256_add_epi32(indices, indexStep);
+    }
+
+    return visibleCount + CullScalar(streams, simdCount, count, outVisibleIndices + visibleCount);
+#else
+    assertm(false, "QuantizedFrustumCuller::CullAVX2 called in a build without AVX2 support");
+    return CullScalar(streams, 0, GetInstanceCount(), outVisibleIndices);
+#endif
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include "Culling/CullingCommon.h"
+#include "Culling/Frustum.h"
+#include "Culling/QuantizedBounds.h"
+#include <vector>
+#include <cstdint>
+
+// FrustumCuller over 16-bit bounds: the instance boxes are stored as structure-of-arrays codes relative to one cell,
+// 12 bytes per instance instead of 24, so culling huge instance counts moves half the memory. The planes are moved
+// into the cell's code space once per cull, the codes are only widened and converted in register and tested against
+// them like FrustumCuller tests the decoded (outward rounded) box.
+//
+// The conversions still cost more than the loads they save while the bounds sit in cache, every path is slower than
+// FrustumCuller then. The quantized layout only pays off once culling is bound by memory bandwidth, or for its
+// footprint alone.
+//
+// The cell covers every instance. An instance reaching outside of it grows the cell to twice its size around both,
+// and the existing codes are re-encoded from their decoded bounds, which keeps them conservative.
+class QuantizedFrustumCuller
+{
+    QuantizedFrustumCuller(const QuantizedFrustumCuller&) = delete;
+    QuantizedFrustumCuller& operator=(const QuantizedFrustumCuller&) = delete;
+
+public:
+    // The SIMD paths store a full register of indices per iteration, so output buffers need this much slack
+    static constexpr size_t OUTPUT_PADDING = 8;
+
+    QuantizedFrustumCuller() = default;
+    ~QuantizedFrustumCuller() = default;
+
+    // Sets the cell up front, e.g. to the scene bounds, so adding instances never has to re-encode. Removes every
+    // instance.
+    void Initialize(const AABB& cellBounds);
+    void Reserve(size_t instanceCount);
+    void Clear();
+
+    uint32_t AddInstance(const AABB& bounds);
+    void SetInstanceBounds(uint32_t instanceIndex, const AABB& bounds);
+    // Decoded bounds, enclosing the bounds the instance was given
+    AABB GetInstanceBounds(uint32_t instanceIndex) const;
+    size_t GetInstanceCount() const { return m_minX.size(); }
+    const ShaderInterop::BoundsQuantization& GetQuantization() const { return m_quantization; }
+
+    // outVisibleIndices must hold at least GetInstanceCount() + OUTPUT_PADDING elements. Returns the visible count.
+    size_t Cull(const Frustum& frustum, uint32_t* outVisibleIndices, CullPath path = DEFAULT_CULL_PATH) const;
+    size_t Cull(const Frustum& frustum, std::vector<uint32_t>& outVisibleIndices, CullPath path = DEFAULT_CULL_PATH) const;
+
+private:
+    // Per plane the p-vertex components are chosen once, 0 picks the decoded min and 1 the decoded max
+    struct PlaneStreams
+    {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t z = 0;
+        XMFLOAT4 plane = {};
+    };
+
+    void SetCell(const AABB& cellBounds);
+    void EncodeInstance(uint32_t instanceIndex, const AABB& bounds);
+    // Grows the cell until it holds bounds and re-encodes every instance
+    void GrowCell(const AABB& bounds);
+
+    void SelectPlaneStreams(const Frustum& frustum, PlaneStreams* outStreams) const;
+    size_t CullScalar(const PlaneStreams* streams, size_t begin, size_t end, uint32_t* outVisibleIndices) const;
+    size_t CullSSE(const PlaneStreams* streams, uint32_t* outVisibleIndices) const;
+    size_t CullAVX2(const PlaneStreams* streams, uint32_t* outVisibleIndices) const;
+
+    std::vector<uint16_t> m_minX;
+    std::vector<uint16_t> m_minY;
+    std::vector<uint16_t> m_minZ;
+    std::vector<uint16_t> m_maxX;
+    std::vector<uint16_t> m_maxY;
+    std::vector<uint16_t> m_maxZ;
+
+    ShaderInterop::BoundsQuantization m_quantization = {};
+    AABB m_cellBounds;
+};
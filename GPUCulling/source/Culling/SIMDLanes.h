@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+// Lane types the shared kernels in Shaders/ are instantiated with on the CPU. Each one exposes the operators and
+// intrinsics the kernels use, implemented with IEEE exact instructions so every path returns the same result.
+namespace SIMD
+{
+    struct ScalarLanes
+    {
+        using Float = float;
+        using Mask = bool;
+        static constexpr size_t WIDTH = 1;
+
+        static Float Load(const float* values) { return *values; }
+        static Float LoadBytes(const uint8_t* values) { return static_cast<float>(*values); }
+        static uint32_t MoveMask(Mask mask) { return mask ? 1u : 0u; }
+        static void Store(float* values, Float value) { *values = value; }
+        static Float Select(Mask mask, Float a, Float b) { return mask ? a : b; }
+        static Float Min(Float a, Float b) { return a < b ? a : b; }
+        static Float Max(Float a, Float b) { return a > b ? a : b; }
+    };
+
+    struct Float4
+    {
+        __m128 v;
+        Float4(__m128 value) : v(value) {}
+        Float4(float value) : v(_mm_set1_ps(value)) {}
+    };
+
+    struct Mask4
+    {
+        __m128 v;
+    };
+
+    inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+    inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+    inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+    inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+    inline Float4 operator-(Float4 a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+    inline Mask4 operator>(Float4 a, Float4 b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+    inline Mask4 operator>=(Float4 a, Float4 b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+    inline Mask4 operator<(Float4 a, Float4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+    inline Mask4 operator<=(Float4 a, Float4 b) { return { _mm_cmple_ps(a.v, b.v) }; }
+    inline Mask4 operator&&(Mask4 a, Mask4 b) { return { _mm_and_ps(a.v, b.v) }; }
+    inline Mask4 operator||(Mask4 a, Mask4 b) { return { _mm_or_ps(a.v, b.v) }; }
+    inline Float4 sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+
+    // SSE2 has no rounding instruction: truncate, step down where that rounded up, keep values that are already integral
+    inline Float4 floor(Float4 a)
+    {
+        const __m128 integralLimit = _mm_set1_ps(8388608.0f);
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+        __m128 rounded = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a.v), _mm_set1_ps(1.0f)));
+        __m128 integral = _mm_cmpge_ps(_mm_and_ps(a.v, absMask), integralLimit);
+        return _mm_or_ps(_mm_and_ps(integral, a.v), _mm_andnot_ps(integral, rounded));
+    }
+
+    inline Float4 ceil(Float4 a)
+    {
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        return _mm_xor_ps(floor(_mm_xor_ps(a.v, signMask)).v, signMask);
+    }
+
+    struct SSELanes
+    {
+        using Float = Float4;
+        using Mask = Mask4;
+        static constexpr size_t WIDTH = 4;
+
+        static Float Load(const float* values) { return _mm_loadu_ps(values); }
+        // Widens 4 bytes with unpacks, SSE2 has no zero extending conversion
+        static Float LoadBytes(const uint8_t* values)
+        {
+            int32_t packed;
+            memcpy(&packed, values, sizeof(packed));
+            __m128i zero = _mm_setzero_si128();
+            __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+            return _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+        }
+        static uint32_t MoveMask(Mask mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask.v)); }
+        static void Store(float* values, Float value) { _mm_storeu_ps(values, value.v); }
+        static Float Select(Mask mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+        static Float Min(Float a, Float b) { return _mm_min_ps(a.v, b.v); }
+        static Float Max(Float a, Float b) { return _mm_max_ps(a.v, b.v); }
+    };
+
+#if defined(__AVX2__)
+    struct Float8
+    {
+        __m256 v;
+        Float8(__m256 value) : v(value) {}
+        Float8(float value) : v(_mm256_set1_ps(value)) {}
+    };
+
+    struct Mask8
+    {
+        __m256 v;
+    };
+
+    inline Float8 operator+(Float8 a, Float8 b) { return _mm256_add_ps(a.v, b.v); }
+    inline Float8 operator-(Float8 a, Float8 b) { return _mm256_sub_ps(a.v, b.v); }
+    inline Float8 operator*(Float8 a, Float8 b) { return _mm256_mul_ps(a.v, b.v); }
+    inline Float8 operator/(Float8 a, Float8 b) { return _mm256_div_ps(a.v, b.v); }
+    inline Float8 operator-(Float8 a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+    inline Mask8 operator>(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+    inline Mask8 operator>=(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+    inline Mask8 operator<(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+    inline Mask8 operator<=(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+    inline Mask8 operator&&(Mask8 a, Mask8 b) { return { _mm256_and_ps(a.v, b.v) }; }
+    inline Mask8 operator||(Mask8 a, Mask8 b) { return { _mm256_or_ps(a.v, b.v) }; }
+    inline Float8 sqrt(Float8 a) { return _mm256_sqrt_ps(a.v); }
+    inline Float8 floor(Float8 a) { return _mm256_floor_ps(a.v); }
+    inline Float8 ceil(Float8 a) { return _mm256_ceil_ps(a.v); }
+
+    struct AVX2Lanes
+    {
+        using Float = Float8;
+        using Mask = Mask8;
+        static constexpr size_t WIDTH = 8;
+
+        static Float Load(const float* values) { return _mm256_loadu_ps(values); }
+        static Float LoadBytes(const uint8_t* values) { return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(values)))); }
+        static uint32_t MoveMask(Mask mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask.v)); }
+        static void Store(float* values, Float value) { _mm256_storeu_ps(values, value.v); }
+        static Float Select(Mask mask, Float a, Float b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+        static Float Min(Float a, Float b) { return _mm256_min_ps(a.v, b.v); }
+        static Float Max(Float a, Float b) { return _mm256_max_ps(a.v, b.v); }
+    };
+#endif
+}
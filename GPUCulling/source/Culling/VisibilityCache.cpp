@@ -0,0 +1,417 @@
+#include "stdafx.h"
+#include "Culling/VisibilityCache.h"
+
+#include "Culling/SIMDLanes.h"
+#include "Engine/Camera.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+using namespace SIMD;
+
+namespace
+{
+    // Float rounding of the plane distances and extraction, relative to the size of the coordinates involved
+    constexpr float MARGIN_SLACK = 1e-5f;
+
+    // The accumulators are floats, a full cull restarts them before they lose precision
+    constexpr float MAX_ACCUMULATED_PATH = 4096.0f;
+    constexpr float MAX_ACCUMULATED_ROTATION = 64.0f;
+
+    float Distance(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&a), XMLoadFloat3(&b))));
+    }
+}
+
+void VisibilityCache::Initialize(const BVH& bvh)
+{
+    m_bvh = &bvh;
+    m_nodeEntries.assign(bvh.GetNodeCount() * BVH::NODE_WIDTH, CacheEntry{ 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, BoxState::Unknown });
+    m_primitiveEntries.assign(bvh.GetPrimitiveCount(), CacheEntry{ 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, BoxState::Unknown });
+    m_visibilityBits.assign((bvh.GetPrimitiveCount() + 63) / 64, 0);
+    m_visibleCount = 0;
+    m_changedIndices.clear();
+    m_stats = {};
+    m_hasCamera = false;
+}
+
+void VisibilityCache::SetCutThresholds(float distance, float angleDegrees)
+{
+    assertm(distance >= 0.0f && angleDegrees >= 0.0f, "VisibilityCache cut thresholds must not be negative");
+    m_cutDistance = distance;
+    m_cutAngle = angleDegrees;
+}
+
+bool VisibilityCache::DetectCut(const Camera& camera)
+{
+    XMFLOAT3 position = camera.GetPosition();
+    float yaw = camera.GetYaw();
+    float pitch = camera.GetPitch();
+    const Frustum& frustum = camera.GetFrustum();
+
+    XMFLOAT4X4 projection;
+    XMStoreFloat4x4(&projection, camera.GetProjectionMatrix());
+
+    bool isCut = !m_hasCamera || std::memcmp(&projection, &m_projection, sizeof(XMFLOAT4X4)) != 0;
+    float translation = 0.0f;
+    float offset = 0.0f;
+    float rotation = 0.0f;
+    if (!isCut)
+    {
+        // Measured on the planes themselves rather than derived from the camera, the far plane extracted from the
+        // view projection moves by far more than the camera when near and far are far apart
+        translation = Distance(position, m_position);
+        XMVECTOR cameraPosition = XMVectorSetW(XMLoadFloat3(&position), 1.0f);
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            XMVECTOR plane = XMLoadFloat4(&frustum.planes[p]);
+            XMVECTOR previousPlane = XMLoadFloat4(&m_planes[p]);
+            offset = std::max(offset, std::fabs(XMVectorGetX(XMVector4Dot(XMVectorSubtract(plane, previousPlane), cameraPosition))));
+            rotation = std::max(rotation, XMVectorGetX(XMVector3Length(XMVectorSubtract(plane, previousPlane))));
+        }
+
+        float cutChord = 2.0f * std::sin(XMConvertToRadians(m_cutAngle) * 0.5f);
+        isCut = translation > m_cutDistance || std::fabs(yaw - m_yaw) > m_cutAngle || std::fabs(pitch - m_pitch) > m_cutAngle ||
+            rotation > cutChord || m_path + translation > MAX_ACCUMULATED_PATH || m_rotation + rotation > MAX_ACCUMULATED_ROTATION;
+    }
+
+    m_hasCamera = true;
+    m_position = position;
+    m_yaw = yaw;
+    m_pitch = pitch;
+    m_projection = projection;
+    m_planes = frustum.planes;
+
+    // Plane distances are evaluated on coordinates up to this size
+    float slackScale = 1.0f + XMVectorGetX(XMVector3Length(XMLoadFloat3(&position)));
+    for (const XMFLOAT4& plane : frustum.planes)
+    {
+        slackScale = std::max(slackScale, 1.0f + std::fabs(plane.w));
+    }
+
+    if (isCut)
+    {
+        m_path = 0.0f;
+        m_offset = 0.0f;
+        m_rotation = 0.0f;
+        m_slackScale = slackScale;
+    }
+    else
+    {
+        m_path += translation;
+        m_offset += offset;
+        m_rotation += rotation;
+        m_slackScale = std::max(m_slackScale, slackScale);
+    }
+    return isCut;
+}
+
+float VisibilityCache::GetRemainingMargin(const CacheEntry& entry) const
+{
+    if (entry.state == BoxState::Unknown)
+    {
+        return -1.0f;
+    }
+
+    // Between two frames a plane distance moves by at most the offset change at the new camera plus the distance
+    // from it times the normal change, and the distance to the box grows by at most the camera translation. Summed
+    // over every frame since the test.
+    float path = m_path - entry.path;
+    float reach = entry.reach + path;
+    float drift = (m_offset - entry.offset) + reach * (m_rotation - entry.rotation);
+    return entry.margin - drift - MARGIN_SLACK * (m_slackScale + reach);
+}
+
+void VisibilityCache::Update(const Camera& camera, CullPath path)
+{
+    assertm(path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2, "VisibilityCache::Update called with a path this build does not support");
+
+    m_stats = {};
+    m_changedIndices.clear();
+    if (!m_bvh || m_bvh->GetNodeCount() == 0)
+    {
+        return;
+    }
+
+    assertm(m_nodeEntries.size() == m_bvh->GetNodeCount() * BVH::NODE_WIDTH, "VisibilityCache used after its BVH was rebuilt");
+
+    bool isCut = DetectCut(camera);
+    m_stats.fullCull = isCut;
+    m_frustum = &camera.GetFrustum();
+
+    CullNode(0, isCut, path);
+
+    m_frustum = nullptr;
+}
+
+float VisibilityCache::CullNode(uint32_t nodeIndex, bool force, CullPath path)
+{
+    const std::vector<BVH::Node>& nodes = m_bvh->GetNodes();
+    const BVH::Node& node = nodes[nodeIndex];
+    CacheEntry* entries = &m_nodeEntries[size_t(nodeIndex) * BVH::NODE_WIDTH];
+
+    float subtreeMargin = FLT_MAX;
+    BoxBatch batch = {};
+    uint32_t testMask = 0;
+    for (uint32_t lane = 0; lane < BVH::NODE_WIDTH; ++lane)
+    {
+        if (node.childType[lane] == BVH::EMPTY_CHILD)
+        {
+            continue;
+        }
+
+        float remainingMargin = force ? -1.0f : GetRemainingMargin(entries[lane]);
+        if (remainingMargin > 0.0f)
+        {
+            ++m_stats.nodeReuses;
+            subtreeMargin = std::min(subtreeMargin, remainingMargin);
+            continue;
+        }
+
+        AABB bounds = BVH::GetChildBounds(node, lane);
+        batch.minX[lane] = bounds.min.x;
+        batch.minY[lane] = bounds.min.y;
+        batch.minZ[lane] = bounds.min.z;
+        batch.maxX[lane] = bounds.max.x;
+        batch.maxY[lane] = bounds.max.y;
+        batch.maxZ[lane] = bounds.max.z;
+        testMask |= 1u << lane;
+    }
+
+    if (testMask == 0)
+    {
+        return subtreeMargin;
+    }
+
+    CacheEntry results[BVH::NODE_WIDTH];
+    ClassifyBatch(batch, false, results, path);
+    m_stats.nodeTests += std::popcount(testMask);
+
+    for (uint32_t lane = 0; lane < BVH::NODE_WIDTH; ++lane)
+    {
+        if (!(testMask & (1u << lane)))
+        {
+            continue;
+        }
+
+        // Children of a box that was fully inside or outside were written wholesale and have to be retested
+        BoxState previousState = entries[lane].state;
+        CacheEntry& entry = entries[lane];
+        entry = results[lane];
+        bool forceChildren = force || previousState != BoxState::Partial;
+
+        uint8_t type = node.childType[lane];
+        uint32_t begin = 0;
+        uint32_t end = 0;
+        if (type == BVH::INNER_CHILD)
+        {
+            const BVH::Node& child = nodes[node.child[lane]];
+            begin = child.primitiveBegin;
+            end = child.primitiveEnd;
+        }
+        else
+        {
+            begin = node.child[lane];
+            end = begin + type;
+        }
+
+        // A straddling box is reusable for as long as nothing below it can change
+        if (entry.state == BoxState::Partial)
+        {
+            entry.margin = type == BVH::INNER_CHILD ? CullNode(node.child[lane], forceChildren, path) : CullLeaf(begin, end, forceChildren, path);
+        }
+        else if (force || entry.state != previousState)
+        {
+            SetRangeVisible(begin, end, entry.state == BoxState::Inside);
+        }
+
+        subtreeMargin = std::min(subtreeMargin, GetRemainingMargin(entry));
+    }
+
+    return subtreeMargin;
+}
+
+float VisibilityCache::CullLeaf(uint32_t begin, uint32_t end, bool force, CullPath path)
+{
+    static_assert(BVH::MAX_LEAF_SIZE <= BVH::NODE_WIDTH, "A leaf has to fit one box batch");
+
+    const std::vector<AABB>& primitiveBounds = m_bvh->GetPrimitiveBounds();
+
+    float leafMargin = FLT_MAX;
+    BoxBatch batch = {};
+    uint32_t testMask = 0;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        float remainingMargin = force ? -1.0f : GetRemainingMargin(m_primitiveEntries[i]);
+        if (remainingMargin > 0.0f)
+        {
+            ++m_stats.primitiveReuses;
+            leafMargin = std::min(leafMargin, remainingMargin);
+            continue;
+        }
+
+        const AABB& bounds = primitiveBounds[i];
+        uint32_t slot = i - begin;
+        batch.minX[slot] = bounds.min.x;
+        batch.minY[slot] = bounds.min.y;
+        batch.minZ[slot] = bounds.min.z;
+        batch.maxX[slot] = bounds.max.x;
+        batch.maxY[slot] = bounds.max.y;
+        batch.maxZ[slot] = bounds.max.z;
+        testMask |= 1u << slot;
+    }
+
+    if (testMask == 0)
+    {
+        return leafMargin;
+    }
+
+    CacheEntry results[BVH::NODE_WIDTH];
+    ClassifyBatch(batch, true, results, path);
+    m_stats.primitiveTests += std::popcount(testMask);
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        uint32_t slot = i - begin;
+        if (testMask & (1u << slot))
+        {
+            m_primitiveEntries[i] = results[slot];
+            SetVisible(i, results[slot].state == BoxState::Inside);
+            leafMargin = std::min(leafMargin, GetRemainingMargin(results[slot]));
+        }
+    }
+
+    return leafMargin;
+}
+
+void VisibilityCache::ClassifyBatch(const BoxBatch& batch, bool isPrimitive, CacheEntry* outEntries, CullPath path) const
+{
+    switch (path)
+    {
+#if defined(__AVX2__)
+    case CullPath::AVX2:
+        ClassifyBatchLanes<AVX2Lanes>(batch, isPrimitive, outEntries);
+        break;
+#endif
+    case CullPath::SSE:
+        ClassifyBatchLanes<SSELanes>(batch, isPrimitive, outEntries);
+        break;
+    default:
+        ClassifyBatchLanes<ScalarLanes>(batch, isPrimitive, outEntries);
+        break;
+    }
+}
+
+template<typename Lanes>
+void VisibilityCache::ClassifyBatchLanes(const BoxBatch& batch, bool isPrimitive, CacheEntry* outEntries) const
+{
+    using Float = typename Lanes::Float;
+    using std::sqrt;
+    constexpr size_t WIDTH = Lanes::WIDTH;
+
+    for (size_t i = 0; i < BVH::NODE_WIDTH; i += WIDTH)
+    {
+        Float minX = Lanes::Load(batch.minX + i), minY = Lanes::Load(batch.minY + i), minZ = Lanes::Load(batch.minZ + i);
+        Float maxX = Lanes::Load(batch.maxX + i), maxY = Lanes::Load(batch.maxY + i), maxZ = Lanes::Load(batch.maxZ + i);
+
+        // Outside by the largest margin of any plane the p-vertex is behind, inside by the smallest margin of the
+        // n-vertex over all planes. The p-vertex distance is evaluated exactly like BVH::Cull.
+        Float outsideMargin = -FLT_MAX;
+        Float insideMargin = FLT_MAX;
+        for (const XMFLOAT4& plane : m_frustum->planes)
+        {
+            Float px = plane.x >= 0.0f ? maxX : minX, nx = plane.x >= 0.0f ? minX : maxX;
+            Float py = plane.y >= 0.0f ? maxY : minY, ny = plane.y >= 0.0f ? minY : maxY;
+            Float pz = plane.z >= 0.0f ? maxZ : minZ, nz = plane.z >= 0.0f ? minZ : maxZ;
+            Float outsideDistance = plane.x * px + plane.y * py + plane.z * pz + plane.w;
+            Float insideDistance = plane.x * nx + plane.y * ny + plane.z * nz + plane.w;
+            outsideMargin = Lanes::Max(outsideMargin, -outsideDistance);
+            insideMargin = Lanes::Min(insideMargin, insideDistance);
+        }
+
+        // Farthest corner from the camera
+        Float dx = Lanes::Max(maxX - m_position.x, m_position.x - minX);
+        Float dy = Lanes::Max(maxY - m_position.y, m_position.y - minY);
+        Float dz = Lanes::Max(maxZ - m_position.z, m_position.z - minZ);
+        Float reach = sqrt(dx * dx + dy * dy + dz * dz);
+
+        float outsideValues[WIDTH];
+        float insideValues[WIDTH];
+        float reachValues[WIDTH];
+        Lanes::Store(outsideValues, outsideMargin);
+        Lanes::Store(insideValues, insideMargin);
+        Lanes::Store(reachValues, reach);
+
+        for (size_t lane = 0; lane < WIDTH; ++lane)
+        {
+            CacheEntry& entry = outEntries[i + lane];
+            entry.reach = reachValues[lane];
+            entry.path = m_path;
+            entry.offset = m_offset;
+            entry.rotation = m_rotation;
+            if (outsideValues[lane] > 0.0f)
+            {
+                entry.state = BoxState::Outside;
+                entry.margin = outsideValues[lane];
+            }
+            else if (isPrimitive)
+            {
+                // Primitives only flip between visible and culled, a straddling one stays visible until it is
+                // behind some plane
+                entry.state = BoxState::Inside;
+                entry.margin = -outsideValues[lane];
+            }
+            else if (insideValues[lane] >= 0.0f)
+            {
+                entry.state = BoxState::Inside;
+                entry.margin = insideValues[lane];
+            }
+            else
+            {
+                entry.state = BoxState::Partial;
+                entry.margin = 0.0f;
+            }
+        }
+    }
+}
+
+void VisibilityCache::SetRangeVisible(uint32_t begin, uint32_t end, bool visible)
+{
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        SetVisible(i, visible);
+    }
+}
+
+void VisibilityCache::SetVisible(uint32_t treeIndex, bool visible)
+{
+    uint32_t primitiveIndex = m_bvh->GetPrimitiveIndices()[treeIndex];
+    uint64_t& word = m_visibilityBits[primitiveIndex / 64];
+    uint64_t bit = uint64_t(1) << (primitiveIndex % 64);
+    if (((word & bit) != 0) == visible)
+    {
+        return;
+    }
+
+    word ^= bit;
+    m_visibleCount = visible ? m_visibleCount + 1 : m_visibleCount - 1;
+    m_changedIndices.push_back(primitiveIndex);
+}
+
+void VisibilityCache::GetVisibleIndices(std::vector<uint32_t>& outVisibleIndices) const
+{
+    outVisibleIndices.clear();
+    outVisibleIndices.reserve(m_visibleCount);
+    for (size_t wordIndex = 0; wordIndex < m_visibilityBits.size(); ++wordIndex)
+    {
+        uint64_t word = m_visibilityBits[wordIndex];
+        while (word)
+        {
+            outVisibleIndices.push_back(static_cast<uint32_t>(wordIndex * 64 + std::countr_zero(word)));
+            word &= word - 1;
+        }
+    }
+}
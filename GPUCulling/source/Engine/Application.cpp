@@ -1,7 +1,11 @@
 #include "stdafx.h"
 #include "Application.h"
 
-void Application::Startup(HWND hwnd)
+#include "Culling/IndirectDrawBuilder.h"
+#include "Culling/QuantizedBounds.h"
+#include "IO/ModelCache.h"
+
+void Application::Startup(HWND hwnd, const std::string& scenePath)
 {
     m_hwnd = hwnd;
 
@@ -38,7 +42,7 @@ void Application::Startup(HWND hwnd)
 
     // Create renderer
     m_renderer = std::make_unique<Renderer>();
-    if (!m_renderer->Initialize(device, m_commandQueue))
+    if (!m_renderer->Initialize(device, m_commandQueue, m_swapChain->GetBackBufferFormat(), m_swapChain->GetDepthStencilFormat()))
     {
         m_renderer.reset();
         m_swapChain.reset();
@@ -50,11 +54,27 @@ void Application::Startup(HWND hwnd)
 
     // Set initial viewport
     m_renderer->SetViewport((float)m_width, (float)m_height);
+
+    m_camera.Initialize(60.0f, (float)m_width / (float)m_height, 0.1f, 1000.0f);
+    m_renderer->SetLights(&m_lights);
+
+    m_renderer->SetDepthBuffer(
+        m_swapChain->GetDepthStencilBuffer(),
+        m_swapChain->GetDepthShaderResourceFormat(),
+        m_width,
+        m_height
+    );
+
+    if (!scenePath.empty())
+    {
+        LoadScene(scenePath);
+    }
 }
 
 void Application::Shutdown()
 {
     m_renderer.reset();
+    m_geometryPool.Release();
     m_swapChain.reset();
 
     if (m_commandQueue)
@@ -94,6 +114,13 @@ void Application::Present()
 
 void Application::Simulate()
 {
+    if (!m_renderer)
+    {
+        return;
+    }
+
+    m_renderer->SetViewProjectionMatrix(m_camera.GetViewProjectionMatrix());
+    m_renderer->SetCamera(m_camera);
 }
 
 void Application::Resize(UINT width, UINT height)
@@ -108,8 +135,113 @@ void Application::Resize(UINT width, UINT height)
 
     m_swapChain->Resize(width, height);
 
+    m_camera.SetAspectRatio((float)width / (float)height);
+
     if (m_renderer)
     {
         m_renderer->SetViewport((float)width, (float)height);
+        m_renderer->SetDepthBuffer(
+            m_swapChain->GetDepthStencilBuffer(),
+            m_swapChain->GetDepthShaderResourceFormat(),
+            width,
+            height
+        );
+    }
+}
+
+bool Application::LoadScene(const std::string& filePath)
+{
+    // Only cooked files are read here, AssetCooker imports the source models ahead of time. The meshes are uploaded
+    // straight out of the mapping, which is closed again once the pool holds them.
+    CookedModel model;
+    if (!model.Open(filePath) || model.GetInstances().empty())
+    {
+        std::cerr << "Failed to load scene " << filePath << ", expected a model cooked by AssetCooker" << std::endl;
+        return false;
+    }
+
+    // The pool is sized for exactly this scene, nothing streams in later
+    uint64_t vertexCount = 0;
+    std::array<uint64_t, INDEX_FORMAT_COUNT> indexCounts = {};
+    for (size_t i = 0; i < model.GetMeshCount(); ++i)
+    {
+        CookedMesh mesh = model.GetMesh(i);
+        vertexCount += mesh.GetVertexCount();
+        for (uint32_t lod = 0; lod < mesh.GetLODCount(); ++lod)
+        {
+            indexCounts[static_cast<size_t>(mesh.indexFormat)] += mesh.GetLODIndices(lod).size();
+        }
+    }
+
+    if (vertexCount > UINT32_MAX || indexCounts[0] > UINT32_MAX || indexCounts[1] > UINT32_MAX)
+    {
+        std::cerr << "Scene " << filePath << " does not fit the geometry pool" << std::endl;
+        return false;
+    }
+
+    m_geometryPool.Initialize(static_cast<uint32_t>(vertexCount), static_cast<uint32_t>(indexCounts[static_cast<size_t>(IndexFormat::UInt16)]),
+        static_cast<uint32_t>(indexCounts[static_cast<size_t>(IndexFormat::UInt32)]), FRAME_COUNT);
+
+    std::vector<uint32_t> meshHandles(model.GetMeshCount(), GeometryPool::INVALID_MESH);
+    std::vector<AABB> meshBounds(model.GetMeshCount());
+    for (size_t i = 0; i < model.GetMeshCount(); ++i)
+    {
+        CookedMesh mesh = model.GetMesh(i);
+        meshBounds[i] = mesh.bounds;
+        if (mesh.GetVertexCount() > 0 && !mesh.indices.empty())
+        {
+            meshHandles[i] = m_geometryPool.AddMesh(mesh);
+        }
+    }
+    m_renderer->SetGeometryPool(&m_geometryPool);
+
+    // Hi-Z bounds are in instance order, draw instances of both index formats refer to them by that order
+    std::span<const MeshInstance> instances = model.GetInstances();
+    std::vector<AABB> instanceBounds(instances.size());
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        instanceBounds[i] = TransformAABB(meshBounds[instances[i].meshIndex], XMLoadFloat4x4(&instances[i].world));
+    }
+
+    AABB sceneBounds;
+    sceneBounds.min = model.GetBoundingBoxMin();
+    sceneBounds.max = model.GetBoundingBoxMax();
+    ShaderInterop::BoundsQuantization boundsQuantization = MakeBoundsQuantization(sceneBounds);
+
+    std::array<std::vector<ShaderInterop::DrawInstance>, INDEX_FORMAT_COUNT> drawInstances;
+    std::array<std::vector<XMFLOAT4X4>, INDEX_FORMAT_COUNT> transforms;
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        const MeshInstance& instance = instances[i];
+        uint32_t meshHandle = meshHandles[instance.meshIndex];
+        if (meshHandle == GeometryPool::INVALID_MESH)
+        {
+            continue;
+        }
+
+        // Instances start at full resolution, the renderer picks their levels every frame
+        const ShaderInterop::GeometryDescriptor& descriptor = m_geometryPool.GetDescriptor(meshHandle);
+        size_t format = descriptor.indexFormat;
+        GeometryPool::IndexRange range = m_geometryPool.GetLODRange(meshHandle, 0);
+        // The Hi-Z pass gets the bounds of every instance in model order, so i is the instance's visibility slot
+        drawInstances[format].push_back(IndirectDrawBuilder::MakeInstance(instanceBounds[i], boundsQuantization, meshHandle,
+            range.firstIndex - descriptor.firstIndex, range.indexCount, static_cast<uint32_t>(i)));
+        transforms[format].push_back(instance.world);
+    }
+
+    for (size_t format = 0; format < INDEX_FORMAT_COUNT; ++format)
+    {
+        m_renderer->SetDrawInstances(static_cast<IndexFormat>(format), boundsQuantization, drawInstances[format].data(),
+            transforms[format].data(), drawInstances[format].size());
     }
+    m_renderer->SetInstanceBounds(instanceBounds.data(), instanceBounds.size());
+
+    // Frame the whole scene from the front
+    XMFLOAT3 center = sceneBounds.GetCenter();
+    XMFLOAT3 extents = sceneBounds.GetExtents();
+    float radius = std::max(std::sqrt(extents.x * extents.x + extents.y * extents.y + extents.z * extents.z), 1.0f);
+    m_camera.SetPosition(center.x, center.y + radius * 0.5f, center.z - radius * 2.0f);
+    m_camera.SetTarget(center);
+    m_camera.SetClipPlanes(radius * 0.01f, radius * 10.0f);
+    return true;
 }
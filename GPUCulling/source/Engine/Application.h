@@ -3,12 +3,17 @@
 #include "Graphics/GPUDevice.h"
 #include "Graphics/GPUSwapChain.h"
 #include "Renderer.h"
+#include "Camera.h"
+#include "Culling/LightList.h"
+#include "IO/GeometryPool.h"
 #include <memory>
+#include <string>
 
 class Application
 {
 public:
-    void Startup(HWND hwnd);
+    // Draws the cooked model at scenePath, nothing but the clear color when it is empty
+    void Startup(HWND hwnd, const std::string& scenePath);
     void Shutdown();
 
     void Present();
@@ -16,10 +21,17 @@ public:
     void Resize(UINT width, UINT height);
 
 private:
+    // Maps the cooked file, uploads every mesh into the geometry pool and hands the renderer one draw instance per mesh instance
+    bool LoadScene(const std::string& filePath);
+
     GPUDevice m_gpuDevice;
     ID3D12CommandQueue* m_commandQueue = nullptr;
     std::unique_ptr<GPUSwapChain> m_swapChain;
+    // Declared ahead of the renderer, which reads it until it is destroyed
+    GeometryPool m_geometryPool;
     std::unique_ptr<Renderer> m_renderer;
+    Camera m_camera;
+    LightList m_lights;
 
     HWND m_hwnd = nullptr;
     UINT m_width = 0;
@@ -177,6 +177,17 @@ XMMATRIX Camera::GetViewProjectionMatrix() const
     return XMMatrixMultiply(GetViewMatrix(), GetProjectionMatrix());
 }
 
+const Frustum& Camera::GetFrustum() const
+{
+    // The setters only flag the matrix they touch, the frustum is stale once either matrix is
+    if (m_frustumDirty || m_viewDirty || m_projectionDirty)
+    {
+        m_frustum = Frustum::FromMatrix(GetViewProjectionMatrix());
+        m_frustumDirty = false;
+    }
+    return m_frustum;
+}
+
 XMFLOAT3 Camera::GetForward() const
 {
     XMFLOAT3 direction = GetDirection();
@@ -204,6 +215,7 @@ void Camera::UpdateViewMatrix()
 
     m_viewMatrix = XMMatrixLookAtLH(posVec, targetVec, upVec);
     m_viewDirty = false;
+    m_frustumDirty = true;
 }
 
 void Camera::UpdateProjectionMatrix()
@@ -215,6 +227,7 @@ void Camera::UpdateProjectionMatrix()
         m_farPlane
     );
     m_projectionDirty = false;
+    m_frustumDirty = true;
 }
 
 XMFLOAT3 Camera::GetDirection() const
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Culling/Frustum.h"
 #include <DirectXMath.h>
 
 using namespace DirectX;
@@ -46,12 +47,17 @@ public:
     XMMATRIX GetProjectionMatrix() const;
     XMMATRIX GetViewProjectionMatrix() const;
 
+    // Culling
+    const Frustum& GetFrustum() const;
+
     // Position and orientation accessors
     XMFLOAT3 GetPosition() const { return m_position; }
     XMFLOAT3 GetTarget() const { return m_target; }
     XMFLOAT3 GetForward() const;
     XMFLOAT3 GetRight() const;
     XMFLOAT3 GetUpVector() const { return m_upVector; }
+    float GetYaw() const { return m_yaw; }
+    float GetPitch() const { return m_pitch; }
 
     // Camera properties
     float GetFOV() const { return m_fov; }
@@ -84,4 +90,8 @@ private:
     mutable XMMATRIX m_projectionMatrix = XMMatrixIdentity();
     mutable bool m_viewDirty = true;
     mutable bool m_projectionDirty = true;
+
+    // Cached frustum planes, rebuilt whenever either matrix changes
+    mutable Frustum m_frustum;
+    mutable bool m_frustumDirty = true;
 };
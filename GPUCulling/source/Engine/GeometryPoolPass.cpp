@@ -0,0 +1,236 @@
+#include "stdafx.h"
+#include "Engine/GeometryPoolPass.h"
+
+namespace
+{
+    D3D12_RESOURCE_STATES GetStreamState(GeometryStream stream)
+    {
+        D3D12_RESOURCE_STATES inputState = stream == GeometryStream::Vertices ?
+            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER : D3D12_RESOURCE_STATE_INDEX_BUFFER;
+        return inputState | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    }
+}
+
+GeometryPoolPass::~GeometryPoolPass()
+{
+    Release();
+}
+
+bool GeometryPoolPass::Initialize(ID3D12Device* device, UINT frameCount)
+{
+    assertm(device != nullptr && frameCount > 0, "GeometryPoolPass::Initialize called with invalid parameters");
+
+    m_device = device;
+
+    m_frameBuffers.resize(frameCount);
+    for (std::unique_ptr<FrameBuffers>& buffers : m_frameBuffers)
+    {
+        buffers = std::make_unique<FrameBuffers>();
+    }
+    return true;
+}
+
+void GeometryPoolPass::Release()
+{
+    for (GPUBuffer& buffer : m_streamBuffers)
+    {
+        buffer.Release();
+    }
+    m_frameBuffers.clear();
+    m_device = nullptr;
+}
+
+bool GeometryPoolPass::SetCapacity(const GeometryPool& pool)
+{
+    assertm(m_device != nullptr, "GeometryPoolPass::SetCapacity called before Initialize");
+
+    for (size_t i = 0; i < GEOMETRY_STREAM_COUNT; ++i)
+    {
+        GeometryStream stream = static_cast<GeometryStream>(i);
+        GPUBuffer& buffer = m_streamBuffers[i];
+        buffer.Release();
+
+        // A stream without capacity never receives work, e.g. the 16-bit indices of a pool without small meshes
+        uint64_t capacity = pool.GetStreamCapacity(stream);
+        if (capacity > 0 && !buffer.Initialize(m_device, capacity, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_NONE, GetStreamState(stream)))
+        {
+            for (GPUBuffer& streamBuffer : m_streamBuffers)
+            {
+                streamBuffer.Release();
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GeometryPoolPass::Update(GPUCommandList* commandList, UINT frameIndex, const GeometryPool& pool)
+{
+    assert(commandList && IsReady() && frameIndex < m_frameBuffers.size());
+
+    FrameBuffers& buffers = *m_frameBuffers[frameIndex];
+
+    const std::vector<ShaderInterop::GeometryDescriptor>& descriptors = pool.GetDescriptors();
+    if (!descriptors.empty())
+    {
+        uint64_t descriptorSize = sizeof(ShaderInterop::GeometryDescriptor) * descriptors.size();
+        if (!Reserve(buffers.descriptors, descriptorSize, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ))
+        {
+            return false;
+        }
+        buffers.descriptors.Upload(descriptors.data(), descriptorSize);
+    }
+
+    const std::vector<uint8_t>& uploadData = pool.GetUploadData();
+    if (!uploadData.empty())
+    {
+        if (!Reserve(buffers.upload, uploadData.size(), D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ))
+        {
+            return false;
+        }
+        buffers.upload.Upload(uploadData.data(), uploadData.size());
+    }
+
+    if (pool.GetPendingCopySize() > 0 &&
+        !Reserve(buffers.scratch, pool.GetPendingCopySize(), D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COPY_DEST))
+    {
+        return false;
+    }
+
+    std::array<bool, GEOMETRY_STREAM_COUNT> isWritten = {};
+    for (const GeometryPool::Upload& upload : pool.GetPendingUploads())
+    {
+        isWritten[static_cast<size_t>(upload.stream)] |= upload.size > 0;
+    }
+    for (const GeometryPool::Copy& copy : pool.GetPendingCopies())
+    {
+        isWritten[static_cast<size_t>(copy.stream)] |= copy.size > 0;
+    }
+
+    if (pool.GetPendingCopySize() > 0)
+    {
+        RecordCopies(commandList, buffers, pool);
+    }
+
+    ID3D12GraphicsCommandList* cmd = commandList->GetCommandList();
+
+    // Streams that took part in a copy are already in the copy destination state
+    for (size_t i = 0; i < GEOMETRY_STREAM_COUNT; ++i)
+    {
+        if (isWritten[i] && pool.GetPendingCopySize() == 0)
+        {
+            commandList->TransitionResource(m_streamBuffers[i].GetResource(), GetStreamState(static_cast<GeometryStream>(i)),
+                D3D12_RESOURCE_STATE_COPY_DEST);
+        }
+    }
+    commandList->FlushResourceBarriers();
+
+    for (const GeometryPool::Upload& upload : pool.GetPendingUploads())
+    {
+        if (upload.size > 0)
+        {
+            cmd->CopyBufferRegion(m_streamBuffers[static_cast<size_t>(upload.stream)].GetResource(), upload.destinationOffset,
+                buffers.upload.GetResource(), upload.dataOffset, upload.size);
+        }
+    }
+
+    for (size_t i = 0; i < GEOMETRY_STREAM_COUNT; ++i)
+    {
+        if (isWritten[i] || (pool.GetPendingCopySize() > 0 && m_streamBuffers[i].GetResource()))
+        {
+            commandList->TransitionResource(m_streamBuffers[i].GetResource(), D3D12_RESOURCE_STATE_COPY_DEST,
+                GetStreamState(static_cast<GeometryStream>(i)));
+        }
+    }
+    if (pool.GetPendingCopySize() > 0)
+    {
+        commandList->TransitionResource(buffers.scratch.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+    }
+    commandList->FlushResourceBarriers();
+    return true;
+}
+
+// Every source is read into scratch before any destination is written, the pool guarantees no copy reads a range
+// written this frame. Leaves every stream in the copy destination state and scratch in the copy source state.
+void GeometryPoolPass::RecordCopies(GPUCommandList* commandList, FrameBuffers& buffers, const GeometryPool& pool)
+{
+    ID3D12GraphicsCommandList* cmd = commandList->GetCommandList();
+
+    for (size_t i = 0; i < GEOMETRY_STREAM_COUNT; ++i)
+    {
+        if (m_streamBuffers[i].GetResource())
+        {
+            commandList->TransitionResource(m_streamBuffers[i].GetResource(), GetStreamState(static_cast<GeometryStream>(i)),
+                D3D12_RESOURCE_STATE_COPY_SOURCE);
+        }
+    }
+    commandList->FlushResourceBarriers();
+
+    uint64_t scratchOffset = 0;
+    for (const GeometryPool::Copy& copy : pool.GetPendingCopies())
+    {
+        if (copy.size > 0)
+        {
+            cmd->CopyBufferRegion(buffers.scratch.GetResource(), scratchOffset, m_streamBuffers[static_cast<size_t>(copy.stream)].GetResource(),
+                copy.sourceOffset, copy.size);
+            scratchOffset += copy.size;
+        }
+    }
+
+    for (size_t i = 0; i < GEOMETRY_STREAM_COUNT; ++i)
+    {
+        if (m_streamBuffers[i].GetResource())
+        {
+            commandList->TransitionResource(m_streamBuffers[i].GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+        }
+    }
+    commandList->TransitionResource(buffers.scratch.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    commandList->FlushResourceBarriers();
+
+    scratchOffset = 0;
+    for (const GeometryPool::Copy& copy : pool.GetPendingCopies())
+    {
+        if (copy.size > 0)
+        {
+            cmd->CopyBufferRegion(m_streamBuffers[static_cast<size_t>(copy.stream)].GetResource(), copy.destinationOffset,
+                buffers.scratch.GetResource(), scratchOffset, copy.size);
+            scratchOffset += copy.size;
+        }
+    }
+}
+
+D3D12_VERTEX_BUFFER_VIEW GeometryPoolPass::GetVertexBufferView() const
+{
+    const GPUBuffer& buffer = GetStreamBuffer(GeometryStream::Vertices);
+    assertm(buffer.GetSize() <= UINT32_MAX, "GeometryPoolPass vertex buffer exceeds the 32-bit view size");
+
+    D3D12_VERTEX_BUFFER_VIEW view = {};
+    view.BufferLocation = buffer.GetGPUAddress();
+    view.SizeInBytes = static_cast<UINT>(buffer.GetSize());
+    view.StrideInBytes = GetGeometryStreamStride(GeometryStream::Vertices);
+    return view;
+}
+
+D3D12_INDEX_BUFFER_VIEW GeometryPoolPass::GetIndexBufferView(IndexFormat indexFormat) const
+{
+    const GPUBuffer& buffer = GetStreamBuffer(GetIndexStream(indexFormat));
+    assertm(buffer.GetSize() <= UINT32_MAX, "GeometryPoolPass index buffer exceeds the 32-bit view size");
+
+    D3D12_INDEX_BUFFER_VIEW view = {};
+    view.BufferLocation = buffer.GetGPUAddress();
+    view.SizeInBytes = static_cast<UINT>(buffer.GetSize());
+    view.Format = indexFormat == IndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    return view;
+}
+
+bool GeometryPoolPass::Reserve(GPUBuffer& buffer, uint64_t size, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_STATES initialState)
+{
+    if (buffer.GetResource() && buffer.GetSize() >= size)
+    {
+        return true;
+    }
+
+    // Grow geometrically so streaming in a little more every frame does not recreate the buffer every frame
+    uint64_t capacity = std::max(size, buffer.GetSize() * 2);
+    return buffer.Initialize(m_device, capacity, heapType, D3D12_RESOURCE_FLAG_NONE, initialState);
+}
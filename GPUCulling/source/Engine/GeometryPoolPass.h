@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Graphics/GPUBuffer.h"
+#include "Graphics/GPUCommandList.h"
+#include "IO/GeometryPool.h"
+#include <array>
+#include <memory>
+#include <vector>
+
+// GPU side of the scene geometry pool. Owns the vertex buffer and the two index buffers GeometryPool places meshes in
+// and replays the pool's queued uploads and moves into them. Moves go through a scratch buffer since a buffer cannot
+// be a copy source and destination at once. The descriptors are uploaded every frame for shaders that build draws.
+class GeometryPoolPass
+{
+    GeometryPoolPass(const GeometryPoolPass&) = delete;
+    GeometryPoolPass& operator=(const GeometryPoolPass&) = delete;
+
+public:
+    GeometryPoolPass() = default;
+    ~GeometryPoolPass();
+
+    bool Initialize(ID3D12Device* device, UINT frameCount);
+    void Release();
+
+    // Creates the stream buffers at the pool's capacities, their contents are lost. The GPU must be idle.
+    bool SetCapacity(const GeometryPool& pool);
+
+    // Records the pool's pending uploads and copies and writes its descriptors into this frame's upload buffer, the
+    // frame must have retired on the GPU. The caller clears the pool's pending work afterwards.
+    bool Update(GPUCommandList* commandList, UINT frameIndex, const GeometryPool& pool);
+
+    bool IsReady() const { return m_streamBuffers[0].GetResource() != nullptr; }
+    // Streams rest in a state readable as vertex or index buffer and as shader resource
+    const GPUBuffer& GetStreamBuffer(GeometryStream stream) const { return m_streamBuffers[static_cast<size_t>(stream)]; }
+    D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView() const;
+    D3D12_INDEX_BUFFER_VIEW GetIndexBufferView(IndexFormat indexFormat) const;
+    // Holds GeometryPool::GetDescriptors as of this frame's Update
+    const GPUBuffer& GetDescriptorBuffer(UINT frameIndex) const { return m_frameBuffers[frameIndex]->descriptors; }
+
+private:
+    struct FrameBuffers
+    {
+        GPUBuffer upload;
+        GPUBuffer descriptors;
+        // Default heap, rests in the copy destination state
+        GPUBuffer scratch;
+    };
+
+    // Grows buffer geometrically to hold size bytes, keeping nothing of its contents
+    bool Reserve(GPUBuffer& buffer, uint64_t size, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_STATES initialState);
+    void RecordCopies(GPUCommandList* commandList, FrameBuffers& buffers, const GeometryPool& pool);
+
+    ID3D12Device* m_device = nullptr;
+    std::array<GPUBuffer, GEOMETRY_STREAM_COUNT> m_streamBuffers;
+    // The upload data and descriptors are rewritten every frame, so each frame in flight owns its buffers
+    std::vector<std::unique_ptr<FrameBuffers>> m_frameBuffers;
+};
@@ -0,0 +1,319 @@
+#include "stdafx.h"
+#include "Engine/HiZOcclusionPass.h"
+
+#include "Culling/HiZPyramid.h"
+#include "Shaders/HiZShared.h"
+
+namespace
+{
+    UINT DivideRoundUp(UINT value, UINT divisor)
+    {
+        return (value + divisor - 1) / divisor;
+    }
+}
+
+HiZOcclusionPass::~HiZOcclusionPass()
+{
+    Release();
+}
+
+bool HiZOcclusionPass::Initialize(ID3D12Device* device)
+{
+    assertm(device != nullptr, "HiZOcclusionPass::Initialize called with null device");
+
+    m_device = device;
+
+    if (!m_buildPipeline.Initialize(m_device, L"HiZBuild.hlsl") ||
+        !m_cullPipeline.Initialize(m_device, L"HiZCull.hlsl"))
+    {
+        Release();
+        return false;
+    }
+
+    // Source for resetting the newly visible counter with a copy
+    uint32_t zero = 0;
+    if (!m_zeroBuffer.Initialize(m_device, sizeof(zero), D3D12_HEAP_TYPE_UPLOAD))
+    {
+        Release();
+        return false;
+    }
+    m_zeroBuffer.Upload(&zero, sizeof(zero));
+
+    return true;
+}
+
+void HiZOcclusionPass::Release()
+{
+    ReleasePyramid();
+
+    m_instanceBoundsBuffer.Release();
+    m_visibilityBuffer.Release();
+    m_newlyVisibleBuffer.Release();
+    m_zeroBuffer.Release();
+    m_instanceCount = 0;
+
+    m_buildPipeline.Release();
+    m_cullPipeline.Release();
+    m_device = nullptr;
+}
+
+void HiZOcclusionPass::ReleasePyramid()
+{
+    for (FrameDescriptors& frame : m_frameDescriptors)
+    {
+        for (DescriptorHandle& handle : frame.buildSources)
+        {
+            frame.heap->FreeDescriptor(handle.cpu, handle.gpu);
+        }
+        for (DescriptorHandle& handle : frame.buildDestinations)
+        {
+            frame.heap->FreeDescriptor(handle.cpu, handle.gpu);
+        }
+        frame.heap->FreeDescriptor(frame.pyramid.cpu, frame.pyramid.gpu);
+    }
+    m_frameDescriptors.clear();
+
+    if (m_hiZTexture)
+    {
+        m_hiZTexture->Release();
+        m_hiZTexture = nullptr;
+    }
+
+    m_depthBuffer = nullptr;
+    m_width = 0;
+    m_height = 0;
+    m_mipCount = 0;
+}
+
+HiZOcclusionPass::DescriptorHandle HiZOcclusionPass::AllocateDescriptor(GPUDescriptorHeap* heap)
+{
+    DescriptorHandle handle;
+    heap->AllocateDescriptor(&handle.cpu, &handle.gpu);
+    return handle;
+}
+
+bool HiZOcclusionPass::SetDepthBuffer(ID3D12Resource* depthBuffer, DXGI_FORMAT depthShaderResourceFormat, UINT width, UINT height,
+    GPUDescriptorHeap* const* frameHeaps, UINT frameCount)
+{
+    assertm(m_device != nullptr, "HiZOcclusionPass::SetDepthBuffer called before Initialize");
+    assertm(depthBuffer && frameHeaps && frameCount > 0, "HiZOcclusionPass::SetDepthBuffer called with invalid parameters");
+
+    ReleasePyramid();
+
+    if (width == 0 || height == 0)
+    {
+        return false;
+    }
+
+    m_depthBuffer = depthBuffer;
+    m_width = width;
+    m_height = height;
+    m_mipCount = HiZPyramid::ComputeMipCount(width, height);
+
+    D3D12_HEAP_PROPERTIES heapProps = {};
+    heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
+    heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+    D3D12_RESOURCE_DESC textureDesc = {};
+    textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    textureDesc.Width = width;
+    textureDesc.Height = height;
+    textureDesc.DepthOrArraySize = 1;
+    textureDesc.MipLevels = static_cast<UINT16>(m_mipCount);
+    textureDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    textureDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+    // Every mip rests in the shader resource state and only becomes unordered access while it is written
+    HRESULT hr = m_device->CreateCommittedResource(
+        &heapProps,
+        D3D12_HEAP_FLAG_NONE,
+        &textureDesc,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+        nullptr,
+        IID_PPV_ARGS(&m_hiZTexture)
+    );
+
+    if (FAILED(hr))
+    {
+        ReleasePyramid();
+        return false;
+    }
+
+    m_frameDescriptors.resize(frameCount);
+    for (UINT frame = 0; frame < frameCount; ++frame)
+    {
+        FrameDescriptors& descriptors = m_frameDescriptors[frame];
+        descriptors.heap = frameHeaps[frame];
+        assertm(descriptors.heap->GetAvailableDescriptors() >= m_mipCount * 2 + 1, "Descriptor heap too small for the Hi-Z pyramid");
+
+        for (UINT mip = 0; mip < m_mipCount; ++mip)
+        {
+            // Level 0 is copied out of the depth buffer, every other level reads the one above it
+            DescriptorHandle source = AllocateDescriptor(descriptors.heap);
+            D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+            srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+            srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+            srvDesc.Texture2D.MipLevels = 1;
+            if (mip == 0)
+            {
+                srvDesc.Format = depthShaderResourceFormat;
+                srvDesc.Texture2D.MostDetailedMip = 0;
+                m_device->CreateShaderResourceView(m_depthBuffer, &srvDesc, source.cpu);
+            }
+            else
+            {
+                srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+                srvDesc.Texture2D.MostDetailedMip = mip - 1;
+                m_device->CreateShaderResourceView(m_hiZTexture, &srvDesc, source.cpu);
+            }
+            descriptors.buildSources.push_back(source);
+
+            DescriptorHandle destination = AllocateDescriptor(descriptors.heap);
+            D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+            uavDesc.Format = DXGI_FORMAT_R32_FLOAT;
+            uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+            uavDesc.Texture2D.MipSlice = mip;
+            m_device->CreateUnorderedAccessView(m_hiZTexture, nullptr, &uavDesc, destination.cpu);
+            descriptors.buildDestinations.push_back(destination);
+        }
+
+        descriptors.pyramid = AllocateDescriptor(descriptors.heap);
+        D3D12_SHADER_RESOURCE_VIEW_DESC pyramidDesc = {};
+        pyramidDesc.Format = DXGI_FORMAT_R32_FLOAT;
+        pyramidDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        pyramidDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        pyramidDesc.Texture2D.MostDetailedMip = 0;
+        pyramidDesc.Texture2D.MipLevels = m_mipCount;
+        m_device->CreateShaderResourceView(m_hiZTexture, &pyramidDesc, descriptors.pyramid.cpu);
+    }
+
+    return true;
+}
+
+bool HiZOcclusionPass::SetInstanceBounds(const AABB* bounds, size_t instanceCount)
+{
+    assertm(m_device != nullptr, "HiZOcclusionPass::SetInstanceBounds called before Initialize");
+
+    m_instanceBoundsBuffer.Release();
+    m_visibilityBuffer.Release();
+    m_newlyVisibleBuffer.Release();
+    m_instanceCount = 0;
+
+    if (instanceCount == 0)
+    {
+        return true;
+    }
+
+    std::vector<ShaderInterop::InstanceBounds> gpuBounds(instanceCount);
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        gpuBounds[i].boundsMin = bounds[i].min;
+        gpuBounds[i].boundsMax = bounds[i].max;
+    }
+
+    uint64_t boundsSize = sizeof(ShaderInterop::InstanceBounds) * instanceCount;
+    uint64_t visibilitySize = sizeof(uint32_t) * instanceCount;
+    uint64_t newlyVisibleSize = sizeof(uint32_t) * (instanceCount + 1);
+
+    // Default heap buffers start zeroed, so the first frame treats everything as hidden last frame
+    if (!m_instanceBoundsBuffer.Initialize(m_device, boundsSize, D3D12_HEAP_TYPE_UPLOAD) ||
+        !m_visibilityBuffer.Initialize(m_device, visibilitySize, D3D12_HEAP_TYPE_DEFAULT,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS) ||
+        !m_newlyVisibleBuffer.Initialize(m_device, newlyVisibleSize, D3D12_HEAP_TYPE_DEFAULT,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS))
+    {
+        m_instanceBoundsBuffer.Release();
+        m_visibilityBuffer.Release();
+        m_newlyVisibleBuffer.Release();
+        return false;
+    }
+
+    m_instanceBoundsBuffer.Upload(gpuBounds.data(), boundsSize);
+    m_instanceCount = static_cast<UINT>(instanceCount);
+    return true;
+}
+
+void HiZOcclusionPass::BuildPyramid(GPUCommandList* commandList, UINT frameIndex, D3D12_RESOURCE_STATES depthState)
+{
+    assert(commandList && IsReady());
+    assert(frameIndex < m_frameDescriptors.size());
+
+    ID3D12GraphicsCommandList* cmd = commandList->GetCommandList();
+    const FrameDescriptors& descriptors = m_frameDescriptors[frameIndex];
+
+    commandList->TransitionResource(m_depthBuffer, depthState, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+    m_buildPipeline.Bind(cmd);
+
+    ShaderInterop::HiZBuildConstants constants = {};
+    constants.sourceSize = XMUINT2(m_width, m_height);
+    constants.destinationSize = XMUINT2(m_width, m_height);
+
+    for (UINT mip = 0; mip < m_mipCount; ++mip)
+    {
+        if (mip > 0)
+        {
+            constants.sourceSize = constants.destinationSize;
+            constants.destinationSize = XMUINT2(std::max(constants.sourceSize.x >> 1, 1u), std::max(constants.sourceSize.y >> 1, 1u));
+        }
+
+        commandList->TransitionResource(m_hiZTexture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, mip);
+        commandList->FlushResourceBarriers();
+
+        cmd->SetComputeRoot32BitConstants(0, sizeof(constants) / sizeof(uint32_t), &constants, 0);
+        cmd->SetComputeRootDescriptorTable(1, descriptors.buildSources[mip].gpu);
+        cmd->SetComputeRootDescriptorTable(2, descriptors.buildDestinations[mip].gpu);
+        cmd->Dispatch(
+            DivideRoundUp(constants.destinationSize.x, ShaderInterop::HIZ_BUILD_GROUP_SIZE),
+            DivideRoundUp(constants.destinationSize.y, ShaderInterop::HIZ_BUILD_GROUP_SIZE),
+            1
+        );
+
+        // The transition back also orders the writes before the next level reads them
+        commandList->TransitionResource(m_hiZTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, mip);
+    }
+
+    commandList->TransitionResource(m_depthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, depthState);
+    commandList->FlushResourceBarriers();
+}
+
+void HiZOcclusionPass::CullInstances(GPUCommandList* commandList, UINT frameIndex, FXMMATRIX viewProjection)
+{
+    assert(commandList && IsReady());
+    assert(frameIndex < m_frameDescriptors.size());
+
+    if (m_instanceCount == 0)
+    {
+        return;
+    }
+
+    ID3D12GraphicsCommandList* cmd = commandList->GetCommandList();
+
+    // Reset the newly visible counter
+    commandList->TransitionResource(m_newlyVisibleBuffer.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST);
+    commandList->FlushResourceBarriers();
+    cmd->CopyBufferRegion(m_newlyVisibleBuffer.GetResource(), 0, m_zeroBuffer.GetResource(), 0, sizeof(uint32_t));
+    commandList->TransitionResource(m_newlyVisibleBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    commandList->FlushResourceBarriers();
+
+    ShaderInterop::HiZCullConstants constants = {};
+    XMStoreFloat4x4(&constants.viewProjection, XMMatrixTranspose(viewProjection));
+    constants.hiZSize = XMUINT2(m_width, m_height);
+    constants.mipCount = m_mipCount;
+    constants.instanceCount = m_instanceCount;
+
+    m_cullPipeline.Bind(cmd);
+    cmd->SetComputeRoot32BitConstants(0, sizeof(constants) / sizeof(uint32_t), &constants, 0);
+    cmd->SetComputeRootShaderResourceView(1, m_instanceBoundsBuffer.GetGPUAddress());
+    cmd->SetComputeRootDescriptorTable(2, m_frameDescriptors[frameIndex].pyramid.gpu);
+    cmd->SetComputeRootUnorderedAccessView(3, m_visibilityBuffer.GetGPUAddress());
+    cmd->SetComputeRootUnorderedAccessView(4, m_newlyVisibleBuffer.GetGPUAddress());
+    cmd->Dispatch(DivideRoundUp(m_instanceCount, ShaderInterop::HIZ_CULL_GROUP_SIZE), 1, 1);
+
+    commandList->UAVBarrier(m_visibilityBuffer.GetResource());
+    commandList->UAVBarrier(m_newlyVisibleBuffer.GetResource());
+    commandList->FlushResourceBarriers();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include "Graphics/GPUBuffer.h"
+#include "Graphics/GPUCommandList.h"
+#include "Graphics/GPUComputePipeline.h"
+#include "Graphics/GPUDescriptorHeap.h"
+#include <DirectXMath.h>
+#include <vector>
+
+using namespace DirectX;
+
+// GPU side of two phase occlusion culling: builds a Hi-Z pyramid from the depth buffer and tests every
+// instance against it. HiZPyramid is the CPU reference both compute shaders are validated against.
+class HiZOcclusionPass
+{
+    HiZOcclusionPass(const HiZOcclusionPass&) = delete;
+    HiZOcclusionPass& operator=(const HiZOcclusionPass&) = delete;
+
+public:
+    HiZOcclusionPass() = default;
+    ~HiZOcclusionPass();
+
+    bool Initialize(ID3D12Device* device);
+    void Release();
+
+    // (Re)creates the pyramid for a depth buffer and writes its descriptors into every per frame heap.
+    // The GPU must be idle, the previous pyramid is released immediately.
+    bool SetDepthBuffer(ID3D12Resource* depthBuffer, DXGI_FORMAT depthShaderResourceFormat, UINT width, UINT height,
+        GPUDescriptorHeap* const* frameHeaps, UINT frameCount);
+
+    // Uploads instance bounds and resets the visibility history. The GPU must be idle.
+    bool SetInstanceBounds(const AABB* bounds, size_t instanceCount);
+
+    // Both passes expect the descriptor heap of frameIndex to be bound
+    void BuildPyramid(GPUCommandList* commandList, UINT frameIndex, D3D12_RESOURCE_STATES depthState);
+    void CullInstances(GPUCommandList* commandList, UINT frameIndex, FXMMATRIX viewProjection);
+
+    bool IsReady() const { return m_hiZTexture != nullptr; }
+    UINT GetInstanceCount() const { return m_instanceCount; }
+    UINT GetMipCount() const { return m_mipCount; }
+    ID3D12Resource* GetPyramid() const { return m_hiZTexture; }
+    // One uint of HIZ_VISIBLE and HIZ_NEWLY_VISIBLE flags per instance from the last cull, rests in the unordered
+    // access state
+    const GPUBuffer& GetVisibilityBuffer() const { return m_visibilityBuffer; }
+    // Element 0 is the count, followed by the indices phase two has to draw
+    const GPUBuffer& GetNewlyVisibleBuffer() const { return m_newlyVisibleBuffer; }
+
+private:
+    struct DescriptorHandle
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE cpu = {};
+        D3D12_GPU_DESCRIPTOR_HANDLE gpu = {};
+    };
+
+    struct FrameDescriptors
+    {
+        GPUDescriptorHeap* heap = nullptr;
+        std::vector<DescriptorHandle> buildSources;
+        std::vector<DescriptorHandle> buildDestinations;
+        DescriptorHandle pyramid;
+    };
+
+    void ReleasePyramid();
+    DescriptorHandle AllocateDescriptor(GPUDescriptorHeap* heap);
+
+    ID3D12Device* m_device = nullptr;
+    GPUComputePipeline m_buildPipeline;
+    GPUComputePipeline m_cullPipeline;
+
+    // Pyramid resources
+    ID3D12Resource* m_depthBuffer = nullptr;
+    ID3D12Resource* m_hiZTexture = nullptr;
+    std::vector<FrameDescriptors> m_frameDescriptors;
+    UINT m_width = 0;
+    UINT m_height = 0;
+    UINT m_mipCount = 0;
+
+    // Instance resources
+    GPUBuffer m_instanceBoundsBuffer;
+    GPUBuffer m_visibilityBuffer;
+    GPUBuffer m_newlyVisibleBuffer;
+    GPUBuffer m_zeroBuffer;
+    UINT m_instanceCount = 0;
+};
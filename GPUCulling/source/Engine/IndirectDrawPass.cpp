@@ -0,0 +1,222 @@
+#include "stdafx.h"
+#include "Engine/IndirectDrawPass.h"
+
+#include "Culling/IndirectDrawBuilder.h"
+
+namespace
+{
+    static_assert(sizeof(ShaderInterop::DrawIndexedArguments) == sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), "Draw arguments must match the D3D12 layout");
+
+    UINT DivideRoundUp(UINT value, UINT divisor)
+    {
+        return (value + divisor - 1) / divisor;
+    }
+}
+
+IndirectDrawPass::~IndirectDrawPass()
+{
+    Release();
+}
+
+bool IndirectDrawPass::Initialize(ID3D12Device* device, UINT frameCount)
+{
+    assertm(device != nullptr && frameCount > 0, "IndirectDrawPass::Initialize called with invalid parameters");
+
+    m_device = device;
+
+    m_instanceBuffers.resize(frameCount);
+    for (std::unique_ptr<GPUBuffer>& buffer : m_instanceBuffers)
+    {
+        buffer = std::make_unique<GPUBuffer>();
+    }
+
+    if (!m_countPipeline.Initialize(m_device, L"IndirectDraw.hlsl", "CSCountVisible") ||
+        !m_scanPipeline.Initialize(m_device, L"IndirectDraw.hlsl", "CSScanGroups") ||
+        !m_writePipeline.Initialize(m_device, L"IndirectDraw.hlsl", "CSWriteDraws"))
+    {
+        Release();
+        return false;
+    }
+
+    // Draw arguments only, so the signature works with any graphics root signature
+    D3D12_INDIRECT_ARGUMENT_DESC argumentDesc = {};
+    argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+    D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+    signatureDesc.ByteStride = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+    signatureDesc.NumArgumentDescs = 1;
+    signatureDesc.pArgumentDescs = &argumentDesc;
+
+    HRESULT hr = m_device->CreateCommandSignature(&signatureDesc, nullptr, IID_PPV_ARGS(&m_commandSignature));
+    if (FAILED(hr))
+    {
+        Release();
+        return false;
+    }
+
+    return true;
+}
+
+void IndirectDrawPass::Release()
+{
+    m_instanceBuffers.clear();
+    m_transformBuffer.Release();
+    m_groupOffsetBuffer.Release();
+    m_argumentBuffer.Release();
+    m_instanceCount = 0;
+
+    if (m_commandSignature)
+    {
+        m_commandSignature->Release();
+        m_commandSignature = nullptr;
+    }
+
+    m_countPipeline.Release();
+    m_scanPipeline.Release();
+    m_writePipeline.Release();
+    m_device = nullptr;
+}
+
+bool IndirectDrawPass::SetInstances(const ShaderInterop::BoundsQuantization& boundsQuantization, const ShaderInterop::DrawInstance* instances,
+    const ShaderInterop::DrawInstanceTransform* transforms, size_t instanceCount)
+{
+    assertm(m_device != nullptr, "IndirectDrawPass::SetInstances called before Initialize");
+
+    for (std::unique_ptr<GPUBuffer>& buffer : m_instanceBuffers)
+    {
+        buffer->Release();
+    }
+    m_transformBuffer.Release();
+    m_groupOffsetBuffer.Release();
+    m_argumentBuffer.Release();
+    m_instanceCount = 0;
+
+    if (instanceCount == 0)
+    {
+        return true;
+    }
+
+    UINT count = static_cast<UINT>(instanceCount);
+    uint64_t instanceSize = sizeof(ShaderInterop::DrawInstance) * instanceCount;
+    uint64_t transformSize = sizeof(ShaderInterop::DrawInstanceTransform) * instanceCount;
+    uint64_t groupOffsetSize = sizeof(uint32_t) * DivideRoundUp(count, ShaderInterop::INDIRECT_DRAW_GROUP_SIZE);
+    uint64_t argumentSize = IndirectDrawBuilder::GetArgumentBufferSize(count);
+
+    bool isCreated = true;
+    for (std::unique_ptr<GPUBuffer>& buffer : m_instanceBuffers)
+    {
+        isCreated = isCreated && buffer->Initialize(m_device, instanceSize, D3D12_HEAP_TYPE_UPLOAD);
+    }
+
+    if (!isCreated ||
+        !m_transformBuffer.Initialize(m_device, transformSize, D3D12_HEAP_TYPE_UPLOAD) ||
+        !m_groupOffsetBuffer.Initialize(m_device, groupOffsetSize, D3D12_HEAP_TYPE_DEFAULT,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS) ||
+        !m_argumentBuffer.Initialize(m_device, argumentSize, D3D12_HEAP_TYPE_DEFAULT,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS))
+    {
+        for (std::unique_ptr<GPUBuffer>& buffer : m_instanceBuffers)
+        {
+            buffer->Release();
+        }
+        m_transformBuffer.Release();
+        m_groupOffsetBuffer.Release();
+        m_argumentBuffer.Release();
+        return false;
+    }
+
+    for (std::unique_ptr<GPUBuffer>& buffer : m_instanceBuffers)
+    {
+        buffer->Upload(instances, instanceSize);
+    }
+    m_transformBuffer.Upload(transforms, transformSize);
+    m_boundsQuantization = boundsQuantization;
+    m_instanceCount = count;
+    return true;
+}
+
+void IndirectDrawPass::UpdateInstances(UINT frameIndex, const ShaderInterop::DrawInstance* instances, size_t instanceCount)
+{
+    assert(IsReady() && frameIndex < m_instanceBuffers.size());
+    assertm(instanceCount == m_instanceCount, "IndirectDrawPass::UpdateInstances called with another instance count than SetInstances");
+
+    m_instanceBuffers[frameIndex]->Upload(instances, sizeof(ShaderInterop::DrawInstance) * instanceCount);
+}
+
+void IndirectDrawPass::BindArguments(ID3D12GraphicsCommandList* cmd, const ShaderInterop::IndirectDrawConstants& constants,
+    const GPUBuffer& instanceBuffer, const GPUBuffer& geometryBuffer, D3D12_GPU_VIRTUAL_ADDRESS visibilityAddress) const
+{
+    cmd->SetComputeRoot32BitConstants(0, sizeof(constants) / sizeof(uint32_t), &constants, 0);
+    cmd->SetComputeRootShaderResourceView(1, instanceBuffer.GetGPUAddress());
+    cmd->SetComputeRootShaderResourceView(2, geometryBuffer.GetGPUAddress());
+    cmd->SetComputeRootUnorderedAccessView(3, m_groupOffsetBuffer.GetGPUAddress());
+    cmd->SetComputeRootUnorderedAccessView(4, m_argumentBuffer.GetGPUAddress());
+    cmd->SetComputeRootUnorderedAccessView(5, visibilityAddress);
+}
+
+void IndirectDrawPass::Build(GPUCommandList* commandList, UINT frameIndex, const Frustum& frustum, const GPUBuffer& geometryBuffer,
+    UINT geometryCount, const GPUBuffer* visibilityBuffer, UINT visibilityMask)
+{
+    assert(commandList && IsReady() && frameIndex < m_instanceBuffers.size());
+    // Root descriptors are not bounds checked, the shaders clamp mesh handles into a buffer that must not be empty
+    assertm(geometryCount > 0 && geometryBuffer.GetSize() >= sizeof(ShaderInterop::GeometryDescriptor) * geometryCount,
+        "IndirectDrawPass::Build called with a geometry buffer smaller than geometryCount");
+    assertm(visibilityMask == 0 || visibilityBuffer != nullptr, "IndirectDrawPass::Build called with a visibility mask but no visibility buffer");
+
+    // The shaders never read the visibility buffer without a mask, so nothing has to be bound to it then
+    D3D12_GPU_VIRTUAL_ADDRESS visibilityAddress = 0;
+    UINT visibilityCount = 0;
+    if (visibilityMask != 0)
+    {
+        visibilityAddress = visibilityBuffer->GetGPUAddress();
+        visibilityCount = static_cast<UINT>(visibilityBuffer->GetSize() / sizeof(uint32_t));
+    }
+
+    ID3D12GraphicsCommandList* cmd = commandList->GetCommandList();
+    const GPUBuffer& instanceBuffer = *m_instanceBuffers[frameIndex];
+    ShaderInterop::IndirectDrawConstants constants = IndirectDrawBuilder::BuildConstants(frustum, m_boundsQuantization, m_instanceCount, geometryCount,
+        visibilityMask, visibilityCount);
+
+    // Each pipeline carries its own root signature object, so the arguments are bound again after every switch
+    m_countPipeline.Bind(cmd);
+    BindArguments(cmd, constants, instanceBuffer, geometryBuffer, visibilityAddress);
+    cmd->Dispatch(constants.groupCount, 1, 1);
+    commandList->UAVBarrier(m_groupOffsetBuffer.GetResource());
+    commandList->FlushResourceBarriers();
+
+    m_scanPipeline.Bind(cmd);
+    BindArguments(cmd, constants, instanceBuffer, geometryBuffer, visibilityAddress);
+    cmd->Dispatch(1, 1, 1);
+    commandList->UAVBarrier(m_groupOffsetBuffer.GetResource());
+    commandList->UAVBarrier(m_argumentBuffer.GetResource());
+    commandList->FlushResourceBarriers();
+
+    m_writePipeline.Bind(cmd);
+    BindArguments(cmd, constants, instanceBuffer, geometryBuffer, visibilityAddress);
+    cmd->Dispatch(constants.groupCount, 1, 1);
+    commandList->UAVBarrier(m_argumentBuffer.GetResource());
+    // The next cull overwrites the flags these passes read
+    if (visibilityMask != 0)
+    {
+        commandList->UAVBarrier(visibilityBuffer->GetResource());
+    }
+    commandList->FlushResourceBarriers();
+}
+
+void IndirectDrawPass::Draw(GPUCommandList* commandList)
+{
+    assert(commandList && IsReady());
+
+    D3D12_VERTEX_BUFFER_VIEW transformView = {};
+    transformView.BufferLocation = m_transformBuffer.GetGPUAddress();
+    transformView.SizeInBytes = static_cast<UINT>(m_transformBuffer.GetSize());
+    transformView.StrideInBytes = sizeof(ShaderInterop::DrawInstanceTransform);
+    commandList->GetCommandList()->IASetVertexBuffers(1, 1, &transformView);
+
+    ID3D12Resource* arguments = m_argumentBuffer.GetResource();
+    commandList->TransitionResource(arguments, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    commandList->ExecuteIndirect(m_commandSignature, m_instanceCount, arguments, ShaderInterop::INDIRECT_DRAW_ARGUMENTS_OFFSET,
+        arguments, ShaderInterop::INDIRECT_DRAW_COUNT_OFFSET);
+    commandList->TransitionResource(arguments, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    commandList->FlushResourceBarriers();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Culling/Frustum.h"
+#include "Graphics/GPUBuffer.h"
+#include "Graphics/GPUCommandList.h"
+#include "Graphics/GPUComputePipeline.h"
+#include "Shaders/IndirectDrawShared.h"
+#include <memory>
+#include <vector>
+
+// GPU driven draw submission. The compute passes cull the instance buffer and write D3D12_DRAW_INDEXED_ARGUMENTS plus
+// the draw count into one buffer that ExecuteIndirect consumes, so the CPU records a single call however many
+// instances survive. IndirectDrawBuilder is the CPU emulation and writes the same bytes.
+class IndirectDrawPass
+{
+    IndirectDrawPass(const IndirectDrawPass&) = delete;
+    IndirectDrawPass& operator=(const IndirectDrawPass&) = delete;
+
+public:
+    IndirectDrawPass() = default;
+    ~IndirectDrawPass();
+
+    bool Initialize(ID3D12Device* device, UINT frameCount);
+    void Release();
+
+    // Uploads the instances, whose bounds are quantized in boundsQuantization, with their object to world transforms
+    // and vertex quantization and sizes the argument buffer for all of them. The GPU must be idle.
+    bool SetInstances(const ShaderInterop::BoundsQuantization& boundsQuantization, const ShaderInterop::DrawInstance* instances,
+        const ShaderInterop::DrawInstanceTransform* transforms, size_t instanceCount);
+    // Rewrites this frame's copy of the instances, e.g. with the index ranges of newly selected levels of detail. Takes
+    // as many instances as SetInstances did, in the same order, and the frame must have retired on the GPU.
+    void UpdateInstances(UINT frameIndex, const ShaderInterop::DrawInstance* instances, size_t instanceCount);
+
+    // Culls the instances and compacts the visible ones into the argument buffer. geometryBuffer holds geometryCount
+    // GeometryDescriptors indexed by mesh handle, the draws take the current place of their mesh from it. With a
+    // visibility buffer, the Hi-Z flags of HiZOcclusionPass in the unordered access state, only instances with one of
+    // the visibilityMask flags set are drawn. The argument buffer is reused, so each Build has to be drawn before
+    // the next one.
+    void Build(GPUCommandList* commandList, UINT frameIndex, const Frustum& frustum, const GPUBuffer& geometryBuffer, UINT geometryCount,
+        const GPUBuffer* visibilityBuffer = nullptr, UINT visibilityMask = 0);
+    // Records the draws of the last Build. Expects the graphics pipeline, the vertex buffer in slot 0 and the index
+    // buffer to be bound, binds the transforms as the per instance stream of slot 1. Each draw starts at its
+    // instance, so the stream hands it the transform of the instance that produced it.
+    void Draw(GPUCommandList* commandList);
+
+    bool IsReady() const { return m_instanceCount != 0; }
+    UINT GetInstanceCount() const { return m_instanceCount; }
+    ID3D12CommandSignature* GetCommandSignature() const { return m_commandSignature; }
+    // Rests in the unordered access state, laid out as IndirectDrawBuilder::GetArgumentBuffer
+    const GPUBuffer& GetArgumentBuffer() const { return m_argumentBuffer; }
+
+private:
+    void BindArguments(ID3D12GraphicsCommandList* cmd, const ShaderInterop::IndirectDrawConstants& constants, const GPUBuffer& instanceBuffer,
+        const GPUBuffer& geometryBuffer, D3D12_GPU_VIRTUAL_ADDRESS visibilityAddress) const;
+
+    ID3D12Device* m_device = nullptr;
+    GPUComputePipeline m_countPipeline;
+    GPUComputePipeline m_scanPipeline;
+    GPUComputePipeline m_writePipeline;
+    ID3D12CommandSignature* m_commandSignature = nullptr;
+
+    // The instances are rewritten as their levels of detail change, so each frame in flight owns a copy
+    std::vector<std::unique_ptr<GPUBuffer>> m_instanceBuffers;
+    GPUBuffer m_transformBuffer;
+    ShaderInterop::BoundsQuantization m_boundsQuantization = {};
+    GPUBuffer m_groupOffsetBuffer;
+    GPUBuffer m_argumentBuffer;
+    UINT m_instanceCount = 0;
+};
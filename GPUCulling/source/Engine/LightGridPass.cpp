@@ -0,0 +1,196 @@
+#include "stdafx.h"
+#include "Engine/LightGridPass.h"
+
+#include "Shaders/LightGridShared.h"
+#include "Shaders/LightShared.h"
+
+namespace
+{
+    constexpr UINT MIN_LIGHT_CAPACITY = 256;
+
+    UINT DivideRoundUp(UINT value, UINT divisor)
+    {
+        return (value + divisor - 1) / divisor;
+    }
+}
+
+LightGridPass::~LightGridPass()
+{
+    Release();
+}
+
+bool LightGridPass::Initialize(ID3D12Device* device, UINT frameCount)
+{
+    assertm(device != nullptr && frameCount > 0, "LightGridPass::Initialize called with invalid parameters");
+
+    m_device = device;
+
+    if (!m_rangesPipeline.Initialize(m_device, L"LightGrid.hlsl", "CSLightRanges") ||
+        !m_countPipeline.Initialize(m_device, L"LightGrid.hlsl", "CSCountLights") ||
+        !m_scanPipeline.Initialize(m_device, L"LightGrid.hlsl", "CSScanCells") ||
+        !m_fillPipeline.Initialize(m_device, L"LightGrid.hlsl", "CSFillLights"))
+    {
+        Release();
+        return false;
+    }
+
+    m_lightBuffers.resize(frameCount);
+    for (std::unique_ptr<GPUBuffer>& buffer : m_lightBuffers)
+    {
+        buffer = std::make_unique<GPUBuffer>();
+    }
+
+    if (!ReserveLights(MIN_LIGHT_CAPACITY))
+    {
+        Release();
+        return false;
+    }
+
+    return true;
+}
+
+void LightGridPass::Release()
+{
+    m_lightBuffers.clear();
+    m_lightRangeBuffer.Release();
+    m_lightCapacity = 0;
+
+    m_boundaryBuffer.Release();
+    m_cellBuffer.Release();
+    m_lightIndexBuffer.Release();
+    m_clusterCount = 0;
+
+    m_rangesPipeline.Release();
+    m_countPipeline.Release();
+    m_scanPipeline.Release();
+    m_fillPipeline.Release();
+    m_device = nullptr;
+}
+
+bool LightGridPass::SetGrid(const LightGrid& grid, uint32_t maxLightIndices)
+{
+    assertm(m_device != nullptr, "LightGridPass::SetGrid called before Initialize");
+    assertm(grid.IsConfigured() && maxLightIndices > 0, "LightGridPass::SetGrid called with an unconfigured grid");
+
+    m_boundaryBuffer.Release();
+    m_cellBuffer.Release();
+    m_lightIndexBuffer.Release();
+    m_clusterCount = 0;
+
+    const auto& boundaries = grid.GetBoundaries();
+    uint64_t boundarySize = sizeof(ShaderInterop::LightGridBoundary) * boundaries.size();
+    uint64_t cellSize = sizeof(ShaderInterop::LightGridCell) * grid.GetClusterCount();
+    uint64_t indexSize = sizeof(uint32_t) * uint64_t(maxLightIndices);
+
+    if (!m_boundaryBuffer.Initialize(m_device, boundarySize, D3D12_HEAP_TYPE_UPLOAD) ||
+        !m_cellBuffer.Initialize(m_device, cellSize, D3D12_HEAP_TYPE_DEFAULT,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS) ||
+        !m_lightIndexBuffer.Initialize(m_device, indexSize, D3D12_HEAP_TYPE_DEFAULT,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS))
+    {
+        m_boundaryBuffer.Release();
+        m_cellBuffer.Release();
+        m_lightIndexBuffer.Release();
+        return false;
+    }
+
+    m_boundaryBuffer.Upload(boundaries.data(), boundarySize);
+    m_clusterCount = grid.GetClusterCount();
+    return true;
+}
+
+bool LightGridPass::ReserveLights(size_t lightCount)
+{
+    assertm(m_device != nullptr, "LightGridPass::ReserveLights called before Initialize");
+    assertm(lightCount <= UINT32_MAX, "LightGridPass light count exceeds 32-bit index range");
+
+    if (lightCount <= m_lightCapacity)
+    {
+        return true;
+    }
+
+    // Grow geometrically so a slowly growing light count does not stall on every frame
+    UINT capacity = std::max(m_lightCapacity, MIN_LIGHT_CAPACITY);
+    while (capacity < lightCount)
+    {
+        capacity *= 2;
+    }
+
+    m_lightCapacity = 0;
+    for (std::unique_ptr<GPUBuffer>& buffer : m_lightBuffers)
+    {
+        if (!buffer->Initialize(m_device, sizeof(ShaderInterop::LightData) * uint64_t(capacity), D3D12_HEAP_TYPE_UPLOAD))
+        {
+            return false;
+        }
+    }
+
+    if (!m_lightRangeBuffer.Initialize(m_device, sizeof(ShaderInterop::LightClusterRange) * uint64_t(capacity), D3D12_HEAP_TYPE_DEFAULT,
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS))
+    {
+        return false;
+    }
+
+    m_lightCapacity = capacity;
+    return true;
+}
+
+void LightGridPass::UploadLights(UINT frameIndex, const LightList& lights)
+{
+    assert(frameIndex < m_lightBuffers.size());
+    assertm(lights.GetLightCount() <= m_lightCapacity, "LightGridPass::UploadLights called without reserving the lights");
+
+    if (lights.GetLightCount() > 0)
+    {
+        m_lightBuffers[frameIndex]->Upload(lights.GetData(), sizeof(ShaderInterop::LightData) * lights.GetLightCount());
+    }
+}
+
+void LightGridPass::BindArguments(ID3D12GraphicsCommandList* cmd, UINT frameIndex, const ShaderInterop::LightGridConstants& constants) const
+{
+    cmd->SetComputeRoot32BitConstants(0, sizeof(constants) / sizeof(uint32_t), &constants, 0);
+    cmd->SetComputeRootShaderResourceView(1, m_lightBuffers[frameIndex]->GetGPUAddress());
+    cmd->SetComputeRootShaderResourceView(2, m_boundaryBuffer.GetGPUAddress());
+    cmd->SetComputeRootUnorderedAccessView(3, m_lightRangeBuffer.GetGPUAddress());
+    cmd->SetComputeRootUnorderedAccessView(4, m_cellBuffer.GetGPUAddress());
+    cmd->SetComputeRootUnorderedAccessView(5, m_lightIndexBuffer.GetGPUAddress());
+}
+
+void LightGridPass::Build(GPUCommandList* commandList, UINT frameIndex, const ShaderInterop::LightGridConstants& constants)
+{
+    assert(commandList && IsReady());
+    assert(frameIndex < m_lightBuffers.size());
+    assertm(constants.clusterCount == m_clusterCount, "LightGridPass::Build called with constants of a different grid");
+    assertm(constants.lightCount <= m_lightCapacity, "LightGridPass::Build called with more lights than reserved");
+    assertm(uint64_t(constants.maxLightIndices) * sizeof(uint32_t) <= m_lightIndexBuffer.GetSize(), "Light index capacity exceeds the buffer");
+
+    ID3D12GraphicsCommandList* cmd = commandList->GetCommandList();
+
+    // Each pipeline carries its own root signature object, so the arguments are bound again after every switch
+    if (constants.lightCount > 0)
+    {
+        m_rangesPipeline.Bind(cmd);
+        BindArguments(cmd, frameIndex, constants);
+        cmd->Dispatch(DivideRoundUp(constants.lightCount, ShaderInterop::LIGHT_GRID_GROUP_SIZE), 1, 1);
+        commandList->UAVBarrier(m_lightRangeBuffer.GetResource());
+        commandList->FlushResourceBarriers();
+    }
+
+    m_countPipeline.Bind(cmd);
+    BindArguments(cmd, frameIndex, constants);
+    cmd->Dispatch(DivideRoundUp(m_clusterCount, ShaderInterop::LIGHT_GRID_GROUP_SIZE), 1, 1);
+    commandList->UAVBarrier(m_cellBuffer.GetResource());
+    commandList->FlushResourceBarriers();
+
+    m_scanPipeline.Bind(cmd);
+    BindArguments(cmd, frameIndex, constants);
+    cmd->Dispatch(1, 1, 1);
+    commandList->UAVBarrier(m_cellBuffer.GetResource());
+    commandList->FlushResourceBarriers();
+
+    m_fillPipeline.Bind(cmd);
+    BindArguments(cmd, frameIndex, constants);
+    cmd->Dispatch(DivideRoundUp(m_clusterCount, ShaderInterop::LIGHT_GRID_GROUP_SIZE), 1, 1);
+    commandList->UAVBarrier(m_lightIndexBuffer.GetResource());
+    commandList->FlushResourceBarriers();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Culling/LightGrid.h"
+#include "Culling/LightList.h"
+#include "Graphics/GPUBuffer.h"
+#include "Graphics/GPUCommandList.h"
+#include "Graphics/GPUComputePipeline.h"
+#include <memory>
+#include <vector>
+
+// GPU side of the clustered light grid. LightGrid is the CPU reference, both consume the same constants and
+// boundaries and the compute passes reproduce its ranges, cells and light indices exactly.
+class LightGridPass
+{
+    LightGridPass(const LightGridPass&) = delete;
+    LightGridPass& operator=(const LightGridPass&) = delete;
+
+public:
+    LightGridPass() = default;
+    ~LightGridPass();
+
+    bool Initialize(ID3D12Device* device, UINT frameCount);
+    void Release();
+
+    // Sizes the cell and index buffers for the grid layout and uploads its boundaries. The GPU must be idle.
+    bool SetGrid(const LightGrid& grid, uint32_t maxLightIndices);
+    // Grows the light buffers of every frame. The GPU must be idle.
+    bool ReserveLights(size_t lightCount);
+    UINT GetLightCapacity() const { return m_lightCapacity; }
+
+    // Writes the lights into this frame's upload buffer, the frame must have retired on the GPU
+    void UploadLights(UINT frameIndex, const LightList& lights);
+    void Build(GPUCommandList* commandList, UINT frameIndex, const ShaderInterop::LightGridConstants& constants);
+
+    bool IsReady() const { return m_clusterCount != 0 && m_lightCapacity != 0; }
+    const GPUBuffer& GetLightRangeBuffer() const { return m_lightRangeBuffer; }
+    const GPUBuffer& GetCellBuffer() const { return m_cellBuffer; }
+    const GPUBuffer& GetLightIndexBuffer() const { return m_lightIndexBuffer; }
+
+private:
+    void BindArguments(ID3D12GraphicsCommandList* cmd, UINT frameIndex, const ShaderInterop::LightGridConstants& constants) const;
+
+    ID3D12Device* m_device = nullptr;
+    GPUComputePipeline m_rangesPipeline;
+    GPUComputePipeline m_countPipeline;
+    GPUComputePipeline m_scanPipeline;
+    GPUComputePipeline m_fillPipeline;
+
+    // Lights are rewritten every frame, so each frame in flight owns its upload buffer
+    std::vector<std::unique_ptr<GPUBuffer>> m_lightBuffers;
+    GPUBuffer m_lightRangeBuffer;
+    UINT m_lightCapacity = 0;
+
+    GPUBuffer m_boundaryBuffer;
+    GPUBuffer m_cellBuffer;
+    GPUBuffer m_lightIndexBuffer;
+    UINT m_clusterCount = 0;
+};
@@ -0,0 +1,180 @@
+#include "stdafx.h"
+#include "Engine/LightZBinPass.h"
+
+#include "Shaders/LightShared.h"
+#include "Shaders/LightZBinShared.h"
+
+namespace
+{
+    constexpr UINT MIN_LIGHT_CAPACITY = 256;
+
+    UINT DivideRoundUp(UINT value, UINT divisor)
+    {
+        return (value + divisor - 1) / divisor;
+    }
+}
+
+LightZBinPass::~LightZBinPass()
+{
+    Release();
+}
+
+bool LightZBinPass::Initialize(ID3D12Device* device, UINT frameCount)
+{
+    assertm(device != nullptr && frameCount > 0, "LightZBinPass::Initialize called with invalid parameters");
+
+    m_device = device;
+
+    if (!m_tileMaskPipeline.Initialize(m_device, L"LightZBins.hlsl", "CSTileMasks"))
+    {
+        Release();
+        return false;
+    }
+
+    m_frameBuffers.resize(frameCount);
+    for (std::unique_ptr<FrameBuffers>& buffers : m_frameBuffers)
+    {
+        buffers = std::make_unique<FrameBuffers>();
+    }
+
+    if (!ReserveLights(MIN_LIGHT_CAPACITY))
+    {
+        Release();
+        return false;
+    }
+
+    return true;
+}
+
+void LightZBinPass::Release()
+{
+    m_frameBuffers.clear();
+    m_sortedLightData.clear();
+    m_lightCapacity = 0;
+
+    m_tileMaskBuffer.Release();
+    m_tileCount = 0;
+    m_binCount = 0;
+
+    m_tileMaskPipeline.Release();
+    m_device = nullptr;
+}
+
+bool LightZBinPass::SetLayout(const LightZBins& zBins)
+{
+    assertm(m_device != nullptr, "LightZBinPass::SetLayout called before Initialize");
+    assertm(zBins.IsConfigured(), "LightZBinPass::SetLayout called with unconfigured Z-bins");
+
+    m_tileCount = 0;
+    m_binCount = zBins.GetConstants().binCount;
+
+    for (std::unique_ptr<FrameBuffers>& buffers : m_frameBuffers)
+    {
+        if (!buffers->bins.Initialize(m_device, sizeof(ShaderInterop::LightZBin) * uint64_t(m_binCount), D3D12_HEAP_TYPE_UPLOAD))
+        {
+            return false;
+        }
+    }
+
+    m_tileCount = zBins.GetTileCount();
+    if (!CreateTileMasks())
+    {
+        m_tileCount = 0;
+        return false;
+    }
+
+    return true;
+}
+
+bool LightZBinPass::ReserveLights(size_t lightCount)
+{
+    assertm(m_device != nullptr, "LightZBinPass::ReserveLights called before Initialize");
+    assertm(lightCount <= UINT32_MAX, "LightZBinPass light count exceeds 32-bit index range");
+
+    if (lightCount <= m_lightCapacity)
+    {
+        return true;
+    }
+
+    // Grow geometrically so a slowly growing light count does not stall on every frame
+    UINT capacity = std::max(m_lightCapacity, MIN_LIGHT_CAPACITY);
+    while (capacity < lightCount)
+    {
+        capacity *= 2;
+    }
+
+    m_lightCapacity = 0;
+    for (std::unique_ptr<FrameBuffers>& buffers : m_frameBuffers)
+    {
+        if (!buffers->sortedLights.Initialize(m_device, sizeof(ShaderInterop::LightData) * uint64_t(capacity), D3D12_HEAP_TYPE_UPLOAD) ||
+            !buffers->tileRanges.Initialize(m_device, sizeof(ShaderInterop::LightTileRange) * uint64_t(capacity), D3D12_HEAP_TYPE_UPLOAD))
+        {
+            return false;
+        }
+    }
+
+    m_lightCapacity = capacity;
+    if (m_tileCount != 0 && !CreateTileMasks())
+    {
+        m_tileCount = 0;
+        return false;
+    }
+
+    return true;
+}
+
+bool LightZBinPass::CreateTileMasks()
+{
+    // One word per 32 lights of capacity for every tile, culling only ever shrinks the sorted list
+    uint64_t maskSize = sizeof(uint32_t) * uint64_t(m_tileCount) * DivideRoundUp(m_lightCapacity, 32);
+    return m_tileMaskBuffer.Initialize(m_device, maskSize, D3D12_HEAP_TYPE_DEFAULT,
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+}
+
+void LightZBinPass::Upload(UINT frameIndex, const LightList& lights, const LightZBins& zBins)
+{
+    assert(frameIndex < m_frameBuffers.size());
+    assertm(lights.GetLightCount() <= m_lightCapacity, "LightZBinPass::Upload called without reserving the lights");
+    assertm(zBins.GetBins().size() == m_binCount, "LightZBinPass::Upload called with bins of a different layout");
+
+    FrameBuffers& buffers = *m_frameBuffers[frameIndex];
+    const std::vector<uint32_t>& sortedLights = zBins.GetSortedLights();
+
+    if (!sortedLights.empty())
+    {
+        m_sortedLightData.resize(sortedLights.size());
+        for (size_t i = 0; i < sortedLights.size(); ++i)
+        {
+            m_sortedLightData[i] = lights.GetLight(sortedLights[i]);
+        }
+
+        buffers.sortedLights.Upload(m_sortedLightData.data(), sizeof(ShaderInterop::LightData) * m_sortedLightData.size());
+        buffers.tileRanges.Upload(zBins.GetTileRanges().data(), sizeof(ShaderInterop::LightTileRange) * zBins.GetTileRanges().size());
+    }
+
+    buffers.bins.Upload(zBins.GetBins().data(), sizeof(ShaderInterop::LightZBin) * m_binCount);
+}
+
+void LightZBinPass::Build(GPUCommandList* commandList, UINT frameIndex, const ShaderInterop::LightZBinConstants& constants)
+{
+    assert(commandList && IsReady());
+    assert(frameIndex < m_frameBuffers.size());
+    assertm(constants.tileCount.x * constants.tileCount.y == m_tileCount, "LightZBinPass::Build called with constants of a different layout");
+    assertm(constants.lightCount <= m_lightCapacity, "LightZBinPass::Build called with more lights than reserved");
+
+    if (constants.wordCount == 0)
+    {
+        return;
+    }
+
+    ID3D12GraphicsCommandList* cmd = commandList->GetCommandList();
+
+    m_tileMaskPipeline.Bind(cmd);
+    cmd->SetComputeRoot32BitConstants(0, sizeof(constants) / sizeof(uint32_t), &constants, 0);
+    cmd->SetComputeRootShaderResourceView(1, m_frameBuffers[frameIndex]->tileRanges.GetGPUAddress());
+    cmd->SetComputeRootUnorderedAccessView(2, m_tileMaskBuffer.GetGPUAddress());
+    cmd->Dispatch(DivideRoundUp(m_tileCount, ShaderInterop::LIGHT_ZBIN_GROUP_SIZE), constants.wordCount, 1);
+
+    commandList->UAVBarrier(m_tileMaskBuffer.GetResource());
+    commandList->FlushResourceBarriers();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Culling/LightList.h"
+#include "Culling/LightZBins.h"
+#include "Graphics/GPUBuffer.h"
+#include "Graphics/GPUCommandList.h"
+#include "Graphics/GPUComputePipeline.h"
+#include <memory>
+#include <vector>
+
+// GPU side of Z-binned light culling. The CPU sorts and bins the lights every frame (LightZBins::BuildBins), this
+// pass uploads the sorted lights, their tile ranges and the bins, then expands the tile masks exactly like
+// LightZBins::BuildTileMasks.
+class LightZBinPass
+{
+    LightZBinPass(const LightZBinPass&) = delete;
+    LightZBinPass& operator=(const LightZBinPass&) = delete;
+
+public:
+    LightZBinPass() = default;
+    ~LightZBinPass();
+
+    bool Initialize(ID3D12Device* device, UINT frameCount);
+    void Release();
+
+    // Sizes the bin and tile mask buffers for the tile and bin layout. The GPU must be idle.
+    bool SetLayout(const LightZBins& zBins);
+    // Grows the per frame light buffers and the tile masks. The GPU must be idle.
+    bool ReserveLights(size_t lightCount);
+    UINT GetLightCapacity() const { return m_lightCapacity; }
+
+    // Writes the sorted lights, tile ranges and bins of the last BuildBins into this frame's upload buffers,
+    // the frame must have retired on the GPU
+    void Upload(UINT frameIndex, const LightList& lights, const LightZBins& zBins);
+    void Build(GPUCommandList* commandList, UINT frameIndex, const ShaderInterop::LightZBinConstants& constants);
+
+    bool IsReady() const { return m_tileCount != 0 && m_lightCapacity != 0; }
+    // Shading reads the sorted lights and bins of its frame together with the shared tile masks
+    const GPUBuffer& GetSortedLightBuffer(UINT frameIndex) const { return m_frameBuffers[frameIndex]->sortedLights; }
+    const GPUBuffer& GetBinBuffer(UINT frameIndex) const { return m_frameBuffers[frameIndex]->bins; }
+    const GPUBuffer& GetTileMaskBuffer() const { return m_tileMaskBuffer; }
+
+private:
+    struct FrameBuffers
+    {
+        GPUBuffer sortedLights;
+        GPUBuffer tileRanges;
+        GPUBuffer bins;
+    };
+
+    bool CreateTileMasks();
+
+    ID3D12Device* m_device = nullptr;
+    GPUComputePipeline m_tileMaskPipeline;
+
+    // Rewritten every frame, so each frame in flight owns its upload buffers
+    std::vector<std::unique_ptr<FrameBuffers>> m_frameBuffers;
+    std::vector<ShaderInterop::LightData> m_sortedLightData;
+    UINT m_lightCapacity = 0;
+
+    GPUBuffer m_tileMaskBuffer;
+    UINT m_tileCount = 0;
+    UINT m_binCount = 0;
+};
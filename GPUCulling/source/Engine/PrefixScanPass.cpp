@@ -0,0 +1,118 @@
+#include "stdafx.h"
+#include "Engine/PrefixScanPass.h"
+
+namespace
+{
+    UINT DivideRoundUp(UINT value, UINT divisor)
+    {
+        return (value + divisor - 1) / divisor;
+    }
+}
+
+PrefixScanPass::~PrefixScanPass()
+{
+    Release();
+}
+
+bool PrefixScanPass::Initialize(ID3D12Device* device)
+{
+    assertm(device != nullptr, "PrefixScanPass::Initialize called with null device");
+
+    m_device = device;
+
+    if (!m_clearPipeline.Initialize(m_device, L"PrefixScan.hlsl", "CSClearStatus") ||
+        !m_scanPipeline.Initialize(m_device, L"PrefixScan.hlsl", "CSExclusiveScan") ||
+        !m_compactPipeline.Initialize(m_device, L"PrefixScan.hlsl", "CSCompact"))
+    {
+        Release();
+        return false;
+    }
+
+    return true;
+}
+
+void PrefixScanPass::Release()
+{
+    m_statusBuffer.Release();
+    m_elementCapacity = 0;
+
+    m_clearPipeline.Release();
+    m_scanPipeline.Release();
+    m_compactPipeline.Release();
+    m_device = nullptr;
+}
+
+bool PrefixScanPass::Reserve(uint32_t elementCount)
+{
+    assertm(m_device != nullptr, "PrefixScanPass::Reserve called before Initialize");
+
+    if (elementCount <= m_elementCapacity)
+    {
+        return true;
+    }
+
+    // Every partition is one group, the dispatch limit caps a single scan at 65535 partitions
+    assertm(ShaderInterop::GetScanPartitionCount(elementCount) <= D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION,
+        "PrefixScanPass element count exceeds one dispatch");
+
+    m_statusBuffer.Release();
+    m_elementCapacity = 0;
+
+    uint64_t statusSize = sizeof(uint32_t) * uint64_t(ShaderInterop::GetScanStatusCount(elementCount));
+    if (!m_statusBuffer.Initialize(m_device, statusSize, D3D12_HEAP_TYPE_DEFAULT,
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS))
+    {
+        return false;
+    }
+
+    m_elementCapacity = elementCount;
+    return true;
+}
+
+void PrefixScanPass::ExclusiveScan(GPUCommandList* commandList, const GPUBuffer& input, const GPUBuffer& output, uint32_t elementCount)
+{
+    assertm(output.GetSize() >= sizeof(uint32_t) * (uint64_t(elementCount) + 1), "PrefixScanPass::ExclusiveScan output buffer too small");
+    Dispatch(commandList, m_scanPipeline, input, output, elementCount);
+}
+
+void PrefixScanPass::Compact(GPUCommandList* commandList, const GPUBuffer& input, const GPUBuffer& output, uint32_t elementCount)
+{
+    assertm(output.GetSize() >= sizeof(uint32_t) * (uint64_t(elementCount) + 1), "PrefixScanPass::Compact output buffer too small");
+    Dispatch(commandList, m_compactPipeline, input, output, elementCount);
+}
+
+void PrefixScanPass::Dispatch(GPUCommandList* commandList, const GPUComputePipeline& pipeline, const GPUBuffer& input, const GPUBuffer& output,
+    uint32_t elementCount)
+{
+    assert(commandList);
+    assertm(elementCount > 0 && elementCount <= m_elementCapacity, "PrefixScanPass called with more elements than reserved");
+    assertm(input.GetSize() >= sizeof(uint32_t) * uint64_t(elementCount), "PrefixScanPass input buffer too small");
+
+    ID3D12GraphicsCommandList* cmd = commandList->GetCommandList();
+
+    ShaderInterop::PrefixScanConstants constants = {};
+    constants.elementCount = elementCount;
+    constants.partitionCount = ShaderInterop::GetScanPartitionCount(elementCount);
+
+    // Both pipelines share the root signature layout, but each carries its own object, so the arguments are bound twice
+    auto bindArguments = [&]()
+    {
+        cmd->SetComputeRoot32BitConstants(0, sizeof(constants) / sizeof(uint32_t), &constants, 0);
+        cmd->SetComputeRootShaderResourceView(1, input.GetGPUAddress());
+        cmd->SetComputeRootUnorderedAccessView(2, output.GetGPUAddress());
+        cmd->SetComputeRootUnorderedAccessView(3, m_statusBuffer.GetGPUAddress());
+    };
+
+    m_clearPipeline.Bind(cmd);
+    bindArguments();
+    cmd->Dispatch(DivideRoundUp(ShaderInterop::GetScanStatusCount(elementCount), ShaderInterop::SCAN_GROUP_SIZE), 1, 1);
+    commandList->UAVBarrier(m_statusBuffer.GetResource());
+    commandList->FlushResourceBarriers();
+
+    pipeline.Bind(cmd);
+    bindArguments();
+    cmd->Dispatch(constants.partitionCount, 1, 1);
+    commandList->UAVBarrier(output.GetResource());
+    commandList->UAVBarrier(m_statusBuffer.GetResource());
+    commandList->FlushResourceBarriers();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Graphics/GPUBuffer.h"
+#include "Graphics/GPUCommandList.h"
+#include "Graphics/GPUComputePipeline.h"
+#include "Shaders/PrefixScanShared.h"
+
+// GPU side of the scan and compaction primitive: one single pass dispatch with decoupled lookback per call.
+// PrefixScan is the CPU reference, the GPU output adds the total (scan) or the count (compaction) to the same values.
+class PrefixScanPass
+{
+    PrefixScanPass(const PrefixScanPass&) = delete;
+    PrefixScanPass& operator=(const PrefixScanPass&) = delete;
+
+public:
+    PrefixScanPass() = default;
+    ~PrefixScanPass();
+
+    bool Initialize(ID3D12Device* device);
+    void Release();
+
+    // Grows the partition status buffer to cover elementCount elements. The GPU must be idle.
+    bool Reserve(uint32_t elementCount);
+    uint32_t GetElementCapacity() const { return m_elementCapacity; }
+
+    // Both read elementCount uints from input, which has to be readable as a shader resource, and expect output in the
+    // unordered access state.
+    // ExclusiveScan writes elementCount + 1 uints, the last one is the total.
+    void ExclusiveScan(GPUCommandList* commandList, const GPUBuffer& input, const GPUBuffer& output, uint32_t elementCount);
+    // Writes the kept count followed by the index of every non zero input element, elementCount + 1 uints at most
+    void Compact(GPUCommandList* commandList, const GPUBuffer& input, const GPUBuffer& output, uint32_t elementCount);
+
+private:
+    void Dispatch(GPUCommandList* commandList, const GPUComputePipeline& pipeline, const GPUBuffer& input, const GPUBuffer& output,
+        uint32_t elementCount);
+
+    ID3D12Device* m_device = nullptr;
+    GPUComputePipeline m_clearPipeline;
+    GPUComputePipeline m_scanPipeline;
+    GPUComputePipeline m_compactPipeline;
+
+    GPUBuffer m_statusBuffer;
+    uint32_t m_elementCapacity = 0;
+};
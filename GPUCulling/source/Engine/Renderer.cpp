@@ -1,12 +1,48 @@
 #include "stdafx.h"
 #include "Engine/Renderer.h"
 
+#include "Engine/Camera.h"
+#include "Culling/Frustum.h"
+#include "Culling/LightList.h"
+#include "Shaders/IndirectDrawShared.h"
+#include "Shaders/OpaqueShared.h"
+
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+    using ShaderInterop::DrawInstanceTransform;
+    using ShaderInterop::QuantizedVertex;
+
+    // The packed QuantizedVertex words as the pool stores them, decoded in the vertex shader, plus the per instance
+    // DrawInstanceTransform IndirectDrawPass binds to slot 1. Tangent and texture coordinates are not shaded yet.
+    const D3D12_INPUT_ELEMENT_DESC OPAQUE_INPUT_ELEMENTS[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32_UINT, 0, offsetof(QuantizedVertex, positionXY), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R32_UINT, 0, offsetof(QuantizedVertex, normal), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(DrawInstanceTransform, world), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(DrawInstanceTransform, world) + 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(DrawInstanceTransform, world) + 32, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(DrawInstanceTransform, world) + 48, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "QUANTIZATION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(DrawInstanceTransform, vertexQuantization), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "QUANTIZATION", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(DrawInstanceTransform, vertexQuantization) + 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+    };
+
+    static_assert(offsetof(QuantizedVertex, positionZ) == offsetof(QuantizedVertex, positionXY) + 4, "POSITION reads both position words");
+
+    constexpr float OPAQUE_AMBIENT = 0.2f;
+
+    // Bytes of resident geometry the pool may move per frame to gather its free space
+    constexpr uint64_t GEOMETRY_DEFRAGMENT_BUDGET = 1 << 20;
+}
+
 Renderer::~Renderer()
 {
     Release();
 }
 
-bool Renderer::Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue)
+bool Renderer::Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue, DXGI_FORMAT renderTargetFormat, DXGI_FORMAT depthStencilFormat)
 {
     if (!device || !commandQueue)
     {
@@ -63,6 +99,7 @@ bool Renderer::Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue
 
     // Initialize compute resources for clustering
     InitializeComputeResources();
+    InitializeGraphicsResources(renderTargetFormat, depthStencilFormat);
 
     m_isInitialized = true;
     return true;
@@ -71,10 +108,18 @@ bool Renderer::Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue
 void Renderer::Release()
 {
     // Wait for all frames to complete before releasing
-    for (UINT i = 0; i < FRAME_COUNT; ++i)
+    WaitForAllFrames();
+
+    m_geometryPoolPass.reset();
+    m_geometryPool = nullptr;
+    m_hiZOcclusionPass.reset();
+    m_opaquePipeline.reset();
+    for (auto& indirectDrawPass : m_indirectDrawPasses)
     {
-        WaitForFrameCompletion(i);
+        indirectDrawPass.reset();
     }
+    m_lightGridPass.reset();
+    m_lightZBinPass.reset();
 
     // Release triple buffered resources (unique_ptr handles cleanup automatically)
     for (UINT i = 0; i < FRAME_COUNT; ++i)
@@ -119,6 +164,7 @@ void Renderer::BeginFrame()
     // Set default viewport and scissor rect
     commandList->GetCommandList()->RSSetViewports(1, &m_currentViewport);
     commandList->GetCommandList()->RSSetScissorRects(1, &m_currentScissorRect);
+    commandList->GetCommandList()->OMSetRenderTargets(1, &m_currentRTV, FALSE, &m_currentDSV);
 
     // Set the descriptor heap for this frame
     ID3D12DescriptorHeap* heaps[] = { m_descriptorHeaps[m_currentFrameIndex]->GetHeap() };
@@ -153,6 +199,37 @@ void Renderer::ClearRenderTarget()
 
 void Renderer::Render()
 {
+    // Geometry streamed in or moved this frame has to land before anything draws it
+    bool isGeometryCurrent = RenderGeometryUpdates();
+    if (isGeometryCurrent)
+    {
+        UpdateDrawLODs();
+    }
+
+    // Two phase occlusion culling: phase one draws what was visible last frame, the Hi-Z pyramid is built from its
+    // depth, and phase two draws what the cull against that pyramid finds visible for the first time. Without Hi-Z
+    // every instance in the frustum is drawn at once.
+    bool isOcclusionCulled = m_hiZOcclusionPass && m_hiZOcclusionPass->IsReady() && m_hiZOcclusionPass->GetInstanceCount() > 0;
+    if (!isOcclusionCulled)
+    {
+        if (isGeometryCurrent)
+        {
+            RenderIndirectDraws(0);
+        }
+    }
+    else
+    {
+        if (isGeometryCurrent)
+        {
+            RenderIndirectDraws(ShaderInterop::HIZ_VISIBLE);
+        }
+        RenderOcclusionCulling();
+        if (isGeometryCurrent)
+        {
+            RenderIndirectDraws(ShaderInterop::HIZ_NEWLY_VISIBLE);
+        }
+    }
+
     // Render the clustered Forward+ outline in stages
     RenderClustering();
     RenderClusterDebugOutlines();
@@ -186,14 +263,9 @@ void Renderer::EndFrame()
 
 void Renderer::SetRenderTarget(D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle)
 {
+    // Recorded by BeginFrame, the frame's command list is not open yet
     m_currentRTV = rtvHandle;
     m_currentDSV = dsvHandle;
-
-    GPUCommandList* commandList = GetCurrentCommandList();
-    assert(commandList);
-    assert(commandList->GetCommandList());
-
-    commandList->GetCommandList()->OMSetRenderTargets(1, &m_currentRTV, FALSE, &m_currentDSV);
 }
 
 void Renderer::SetViewport(float width, float height)
@@ -219,6 +291,201 @@ void Renderer::SetClearColor(float r, float g, float b, float a)
     m_clearColor[3] = a;
 }
 
+void Renderer::SetDepthBuffer(ID3D12Resource* depthBuffer, DXGI_FORMAT shaderResourceFormat, UINT width, UINT height)
+{
+    if (!m_hiZOcclusionPass)
+    {
+        return;
+    }
+
+    // The pyramid and its descriptors may still be referenced by frames in flight
+    WaitForAllFrames();
+
+    GPUDescriptorHeap* heaps[FRAME_COUNT];
+    for (UINT i = 0; i < FRAME_COUNT; ++i)
+    {
+        heaps[i] = m_descriptorHeaps[i].get();
+    }
+
+    if (!m_hiZOcclusionPass->SetDepthBuffer(depthBuffer, shaderResourceFormat, width, height, heaps, FRAME_COUNT))
+    {
+        std::cerr << "Failed to create Hi-Z pyramid, occlusion culling disabled" << std::endl;
+    }
+}
+
+void Renderer::SetViewProjectionMatrix(FXMMATRIX viewProjection)
+{
+    XMStoreFloat4x4(&m_viewProjection, viewProjection);
+}
+
+void Renderer::SetInstanceBounds(const AABB* bounds, size_t instanceCount)
+{
+    if (!m_hiZOcclusionPass)
+    {
+        return;
+    }
+
+    WaitForAllFrames();
+
+    if (!m_hiZOcclusionPass->SetInstanceBounds(bounds, instanceCount))
+    {
+        std::cerr << "Failed to upload instance bounds for occlusion culling" << std::endl;
+    }
+}
+
+void Renderer::SetDrawInstances(IndexFormat indexFormat, const ShaderInterop::BoundsQuantization& boundsQuantization,
+    const ShaderInterop::DrawInstance* instances, const XMFLOAT4X4* transforms, size_t instanceCount)
+{
+    IndirectDrawPass* indirectDrawPass = m_indirectDrawPasses[static_cast<size_t>(indexFormat)].get();
+    if (!indirectDrawPass)
+    {
+        return;
+    }
+
+    WaitForAllFrames();
+
+    DrawInstanceLODs& drawLODs = m_drawInstanceLODs[static_cast<size_t>(indexFormat)];
+    drawLODs = DrawInstanceLODs();
+
+    // Vertex positions decode in the frame of each instance's mesh and levels are picked from the mesh errors, both
+    // are only known to the pool
+    if (!m_geometryPool)
+    {
+        std::cerr << "Draw instances need the geometry pool their meshes live in" << std::endl;
+        indirectDrawPass->SetInstances(boundsQuantization, nullptr, nullptr, 0);
+        return;
+    }
+
+    std::vector<ShaderInterop::DrawInstanceTransform> drawTransforms(instanceCount);
+    drawLODs.instances.assign(instances, instances + instanceCount);
+    drawLODs.spheres.resize(instanceCount);
+    drawLODs.lods.resize(instanceCount);
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        drawTransforms[i].world = transforms[i];
+        uint32_t meshHandle = instances[i].meshHandle;
+        if (!m_geometryPool->IsMeshValid(meshHandle))
+        {
+            continue;
+        }
+        drawTransforms[i].vertexQuantization = m_geometryPool->GetVertexQuantization(meshHandle);
+
+        // The instance's range tells which level it starts at
+        const ShaderInterop::GeometryDescriptor& descriptor = m_geometryPool->GetDescriptor(meshHandle);
+        for (uint32_t lod = 0; lod < descriptor.lodCount; ++lod)
+        {
+            if (m_geometryPool->GetLODRange(meshHandle, lod).firstIndex == descriptor.firstIndex + instances[i].firstIndex)
+            {
+                drawLODs.lods[i] = lod;
+                break;
+            }
+        }
+
+        Sphere sphere;
+        sphere.center = descriptor.sphereCenter;
+        sphere.radius = descriptor.sphereRadius;
+        drawLODs.spheres[i] = TransformSphere(sphere, XMLoadFloat4x4(&transforms[i]));
+    }
+
+    if (!indirectDrawPass->SetInstances(boundsQuantization, instances, drawTransforms.data(), instanceCount))
+    {
+        std::cerr << "Failed to upload draw instances for indirect drawing" << std::endl;
+        drawLODs = DrawInstanceLODs();
+    }
+}
+
+void Renderer::SetGeometryPool(GeometryPool* pool)
+{
+    if (!m_geometryPoolPass)
+    {
+        return;
+    }
+
+    // The stream buffers are recreated, frames still drawing from the old ones have to finish first
+    WaitForAllFrames();
+
+    // The views point into the stream buffers SetCapacity releases, and the draw instances name meshes of the old pool
+    m_geometryPool = nullptr;
+    m_drawInstanceLODs = {};
+    m_indexBufferViews = {};
+    if (pool && !m_geometryPoolPass->SetCapacity(*pool))
+    {
+        std::cerr << "Failed to create geometry pool buffers" << std::endl;
+        return;
+    }
+
+    m_geometryPool = pool;
+    if (!m_geometryPool)
+    {
+        return;
+    }
+
+    for (size_t format = 0; format < INDEX_FORMAT_COUNT; ++format)
+    {
+        IndexFormat indexFormat = static_cast<IndexFormat>(format);
+        if (m_geometryPoolPass->GetStreamBuffer(GetIndexStream(indexFormat)).GetResource())
+        {
+            m_indexBufferViews[format] = m_geometryPoolPass->GetIndexBufferView(indexFormat);
+        }
+    }
+}
+
+void Renderer::SetCamera(const Camera& camera)
+{
+    if (m_currentViewport.Height > 0.0f)
+    {
+        m_lodSelector.SetView(camera, m_currentViewport.Height);
+    }
+
+    m_lightGrid.SetView(camera.GetViewMatrix());
+    m_lightZBins.SetView(camera.GetViewMatrix());
+
+    if (!m_lightGridPass && !m_lightZBinPass)
+    {
+        return;
+    }
+
+    XMFLOAT4X4 projection;
+    XMStoreFloat4x4(&projection, camera.GetProjectionMatrix());
+    XMFLOAT4 lightGridProjection(projection._11, projection._22, camera.GetNearPlane(), camera.GetFarPlane());
+    XMUINT2 lightGridViewport(static_cast<uint32_t>(m_currentViewport.Width), static_cast<uint32_t>(m_currentViewport.Height));
+
+    bool projectionChanged = std::memcmp(&lightGridProjection, &m_lightGridProjection, sizeof(XMFLOAT4)) != 0;
+    bool viewportChanged = lightGridViewport.x != m_lightGridViewport.x || lightGridViewport.y != m_lightGridViewport.y;
+    if ((!projectionChanged && !viewportChanged) || lightGridViewport.x == 0 || lightGridViewport.y == 0)
+    {
+        return;
+    }
+
+    m_lightGridProjection = lightGridProjection;
+    m_lightGridViewport = lightGridViewport;
+
+    // The cell and mask buffers may still be referenced by frames in flight
+    WaitForAllFrames();
+
+    m_lightGrid.Configure(lightGridViewport.x, lightGridViewport.y, lightGridProjection.x, lightGridProjection.y,
+        lightGridProjection.z, lightGridProjection.w);
+    if (m_lightGridPass && !m_lightGridPass->SetGrid(m_lightGrid, m_lightGrid.GetConstants(0).maxLightIndices))
+    {
+        std::cerr << "Failed to create light grid buffers, light clustering disabled" << std::endl;
+    }
+
+    m_lightZBins.Configure(lightGridViewport.x, lightGridViewport.y, lightGridProjection.x, lightGridProjection.y,
+        lightGridProjection.z, lightGridProjection.w);
+    if (m_lightZBinPass && !m_lightZBinPass->SetLayout(m_lightZBins))
+    {
+        std::cerr << "Failed to create light Z-bin buffers, Z-binned light culling disabled" << std::endl;
+    }
+}
+
+void Renderer::WaitForAllFrames()
+{
+    for (UINT i = 0; i < FRAME_COUNT; ++i)
+    {
+        WaitForFrameCompletion(i);
+    }
+}
+
 void Renderer::WaitForFrameCompletion(UINT frameIndex)
 {
     assert(m_fence);
@@ -236,23 +503,249 @@ void Renderer::WaitForFrameCompletion(UINT frameIndex)
 
 void Renderer::InitializeComputeResources()
 {
-    // TODO: Initialize cluster compute shaders and resources
-    // This would include:
-    // - Cluster grid buffer
-    // - Light culling compute shader
-    // - Debug visualization resources
+    m_geometryPoolPass = std::make_unique<GeometryPoolPass>();
+    if (!m_geometryPoolPass->Initialize(m_device, FRAME_COUNT))
+    {
+        std::cerr << "Failed to initialize geometry pool pass" << std::endl;
+        m_geometryPoolPass.reset();
+    }
+
+    // Occlusion culling is optional, the renderer keeps running without it if the shaders fail to compile
+    m_hiZOcclusionPass = std::make_unique<HiZOcclusionPass>();
+    if (!m_hiZOcclusionPass->Initialize(m_device))
+    {
+        std::cerr << "Failed to initialize Hi-Z occlusion pass" << std::endl;
+        m_hiZOcclusionPass.reset();
+    }
+
+    for (auto& indirectDrawPass : m_indirectDrawPasses)
+    {
+        indirectDrawPass = std::make_unique<IndirectDrawPass>();
+        if (!indirectDrawPass->Initialize(m_device, FRAME_COUNT))
+        {
+            std::cerr << "Failed to initialize indirect draw pass" << std::endl;
+            indirectDrawPass.reset();
+        }
+    }
+
+    // The light grid is laid out once the first camera arrives
+    m_lightGridPass = std::make_unique<LightGridPass>();
+    if (!m_lightGridPass->Initialize(m_device, FRAME_COUNT))
+    {
+        std::cerr << "Failed to initialize light grid pass" << std::endl;
+        m_lightGridPass.reset();
+    }
+
+    m_lightZBinPass = std::make_unique<LightZBinPass>();
+    if (!m_lightZBinPass->Initialize(m_device, FRAME_COUNT))
+    {
+        std::cerr << "Failed to initialize light Z-bin pass" << std::endl;
+        m_lightZBinPass.reset();
+    }
+
+    // TODO: Debug visualization resources
+}
+
+void Renderer::InitializeGraphicsResources(DXGI_FORMAT renderTargetFormat, DXGI_FORMAT depthStencilFormat)
+{
+    // Without it the indirect draws are still built, nothing shades them
+    m_opaquePipeline = std::make_unique<GPUGraphicsPipeline>();
+    if (!m_opaquePipeline->Initialize(m_device, L"Opaque.hlsl", OPAQUE_INPUT_ELEMENTS, static_cast<UINT>(std::size(OPAQUE_INPUT_ELEMENTS)),
+        renderTargetFormat, depthStencilFormat))
+    {
+        std::cerr << "Failed to initialize opaque pipeline" << std::endl;
+        m_opaquePipeline.reset();
+    }
+}
+
+bool Renderer::RenderGeometryUpdates()
+{
+    assert(m_commandLists[m_currentFrameIndex]);
+
+    if (!m_geometryPool || !m_geometryPoolPass || !m_geometryPoolPass->IsReady())
+    {
+        return false;
+    }
+
+    // The moves are queued with the rest of the frame's work, the draws read the descriptors they update
+    m_geometryPool->Defragment(GEOMETRY_DEFRAGMENT_BUDGET);
+
+    // On failure the work stays queued and is retried next frame. The descriptors may already point at ranges the
+    // data did not reach, so nothing draws from the pool this frame.
+    if (!m_geometryPoolPass->Update(GetCurrentCommandList(), m_currentFrameIndex, *m_geometryPool))
+    {
+        std::cerr << "Failed to grow geometry pool upload buffers, geometry updates delayed" << std::endl;
+        return false;
+    }
+
+    m_geometryPool->ClearPendingWork();
+    m_geometryPool->AdvanceFrame();
+    return true;
+}
+
+void Renderer::UpdateDrawLODs()
+{
+    for (size_t format = 0; format < INDEX_FORMAT_COUNT; ++format)
+    {
+        IndirectDrawPass* indirectDrawPass = m_indirectDrawPasses[format].get();
+        DrawInstanceLODs& drawLODs = m_drawInstanceLODs[format];
+        if (!indirectDrawPass || !indirectDrawPass->IsReady() || drawLODs.instances.empty())
+        {
+            continue;
+        }
+
+        if (m_lodSelector.SelectLODs(*m_geometryPool, drawLODs.spheres.data(), drawLODs.instances.data(), drawLODs.lods.data(),
+            drawLODs.instances.size()) > 0)
+        {
+            drawLODs.staleFrames = FRAME_COUNT;
+        }
+
+        // Each frame in flight has its own instance buffer, every one of them has to see the switch once
+        if (drawLODs.staleFrames > 0)
+        {
+            indirectDrawPass->UpdateInstances(m_currentFrameIndex, drawLODs.instances.data(), drawLODs.instances.size());
+            --drawLODs.staleFrames;
+        }
+    }
+}
+
+void Renderer::RenderOcclusionCulling()
+{
+    assert(m_commandLists[m_currentFrameIndex]);
+
+    if (!m_hiZOcclusionPass || !m_hiZOcclusionPass->IsReady())
+    {
+        return;
+    }
+
+    GPUCommandList* commandList = GetCurrentCommandList();
+
+    // Phase one depth becomes the occluder set for everything else
+    m_hiZOcclusionPass->BuildPyramid(commandList, m_currentFrameIndex, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    m_hiZOcclusionPass->CullInstances(commandList, m_currentFrameIndex, XMLoadFloat4x4(&m_viewProjection));
+}
+
+void Renderer::RenderIndirectDraws(UINT visibilityMask)
+{
+    assert(m_commandLists[m_currentFrameIndex]);
+
+    // The instances refer to pooled meshes, there is nothing else to draw them from
+    UINT geometryCount = static_cast<UINT>(m_geometryPool->GetDescriptors().size());
+    if (geometryCount == 0)
+    {
+        return;
+    }
+
+    GPUCommandList* commandList = GetCurrentCommandList();
+    const GPUBuffer& geometryBuffer = m_geometryPoolPass->GetDescriptorBuffer(m_currentFrameIndex);
+    Frustum frustum = Frustum::FromMatrix(XMLoadFloat4x4(&m_viewProjection));
+    const GPUBuffer* visibilityBuffer = visibilityMask != 0 ? &m_hiZOcclusionPass->GetVisibilityBuffer() : nullptr;
+    bool hasDraws = false;
+    for (auto& indirectDrawPass : m_indirectDrawPasses)
+    {
+        if (indirectDrawPass && indirectDrawPass->IsReady())
+        {
+            indirectDrawPass->Build(commandList, m_currentFrameIndex, frustum, geometryBuffer, geometryCount, visibilityBuffer, visibilityMask);
+            hasDraws = true;
+        }
+    }
+
+    if (!hasDraws || !m_opaquePipeline)
+    {
+        return;
+    }
+
+    ID3D12GraphicsCommandList* cmd = commandList->GetCommandList();
+
+    ShaderInterop::OpaqueConstants constants = {};
+    XMStoreFloat4x4(&constants.viewProjection, XMMatrixTranspose(XMLoadFloat4x4(&m_viewProjection)));
+    XMStoreFloat3(&constants.lightDirection, XMVector3Normalize(XMVectorSet(0.4f, 1.0f, -0.6f, 0.0f)));
+    constants.ambient = OPAQUE_AMBIENT;
+
+    m_opaquePipeline->Bind(cmd);
+    cmd->SetGraphicsRoot32BitConstants(0, sizeof(constants) / sizeof(uint32_t), &constants, 0);
+
+    D3D12_VERTEX_BUFFER_VIEW vertexBufferView = m_geometryPoolPass->GetVertexBufferView();
+    cmd->IASetVertexBuffers(0, 1, &vertexBufferView);
+
+    for (size_t format = 0; format < INDEX_FORMAT_COUNT; ++format)
+    {
+        // A format without an index buffer has no mesh its instances could draw
+        IndirectDrawPass* indirectDrawPass = m_indirectDrawPasses[format].get();
+        const D3D12_INDEX_BUFFER_VIEW& indexBufferView = m_indexBufferViews[format];
+        if (!indirectDrawPass || !indirectDrawPass->IsReady() || indexBufferView.SizeInBytes == 0)
+        {
+            continue;
+        }
+
+        commandList->SetIndexBuffer(indexBufferView.BufferLocation, indexBufferView.SizeInBytes, indexBufferView.Format);
+        indirectDrawPass->Draw(commandList);
+    }
 }
 
 void Renderer::RenderClustering()
 {
     assert(m_commandLists[m_currentFrameIndex]);
 
-    // TODO: Execute light clustering compute shader
-    // This would:
-    // 1. Set up compute shader
-    // 2. Set compute buffers
-    // 3. Dispatch compute work
-    // 4. Insert barriers between compute and graphics
+    if (!m_lights)
+    {
+        return;
+    }
+
+    switch (m_lightCullingMode)
+    {
+    case LightCullingMode::ZBinnedTiles:
+        RenderLightZBins();
+        break;
+    default:
+        RenderLightGrid();
+        break;
+    }
+}
+
+void Renderer::RenderLightGrid()
+{
+    if (!m_lightGridPass || !m_lightGridPass->IsReady())
+    {
+        return;
+    }
+
+    // Growing the shared light range buffer has to wait for the frames still reading it
+    if (m_lights->GetLightCount() > m_lightGridPass->GetLightCapacity())
+    {
+        WaitForAllFrames();
+        if (!m_lightGridPass->ReserveLights(m_lights->GetLightCount()))
+        {
+            std::cerr << "Failed to grow light buffers, light clustering skipped" << std::endl;
+            return;
+        }
+    }
+
+    m_lightGridPass->UploadLights(m_currentFrameIndex, *m_lights);
+    m_lightGridPass->Build(GetCurrentCommandList(), m_currentFrameIndex, m_lightGrid.GetConstants(m_lights->GetLightCount()));
+}
+
+void Renderer::RenderLightZBins()
+{
+    if (!m_lightZBinPass || !m_lightZBinPass->IsReady())
+    {
+        return;
+    }
+
+    // The tile masks are shared between frames, growing them has to wait for the frames still reading them
+    if (m_lights->GetLightCount() > m_lightZBinPass->GetLightCapacity())
+    {
+        WaitForAllFrames();
+        if (!m_lightZBinPass->ReserveLights(m_lights->GetLightCount()))
+        {
+            std::cerr << "Failed to grow light Z-bin buffers, light culling skipped" << std::endl;
+            return;
+        }
+    }
+
+    m_lightZBins.BuildBins(*m_lights);
+    m_lightZBinPass->Upload(m_currentFrameIndex, *m_lights, m_lightZBins);
+    m_lightZBinPass->Build(GetCurrentCommandList(), m_currentFrameIndex, m_lightZBins.GetConstants());
 }
 
 void Renderer::RenderClusterDebugOutlines()
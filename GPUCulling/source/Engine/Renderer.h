@@ -5,15 +5,37 @@
 #include "Graphics/GPUCommandList.h"
 #include "Graphics/GPUCommandAllocatorPool.h"
 #include "Graphics/GPUDescriptorHeap.h"
+#include "Graphics/GPUGraphicsPipeline.h"
+#include "Engine/GeometryPoolPass.h"
+#include "Engine/HiZOcclusionPass.h"
+#include "Engine/IndirectDrawPass.h"
+#include "Engine/LightGridPass.h"
+#include "Engine/LightZBinPass.h"
+#include "Culling/Bounds.h"
+#include "Culling/LODSelector.h"
+#include "Culling/LightGrid.h"
+#include "Culling/LightZBins.h"
+#include "IO/IndexFormat.h"
 #include <DirectXMath.h>
 #include <memory>
 #include <array>
+#include <vector>
 
 using namespace DirectX;
 
+class Camera;
+class LightList;
+
 static constexpr UINT FRAME_COUNT = 3;
 static constexpr float CLEAR_COLOR[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
 
+// Light culling structure built every frame, both read the same light list
+enum class LightCullingMode
+{
+    ClusteredGrid,
+    ZBinnedTiles
+};
+
 class Renderer
 {
     Renderer(const Renderer&) = delete;
@@ -23,7 +45,8 @@ public:
     Renderer() = default;
     ~Renderer();
 
-    bool Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue);
+    // The formats are those of the render and depth targets given to SetRenderTarget
+    bool Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue, DXGI_FORMAT renderTargetFormat, DXGI_FORMAT depthStencilFormat);
     void Release();
 
     // Rendering interface
@@ -32,11 +55,37 @@ public:
     void Render();
     void EndFrame();
 
-    // Render pass setup
+    // Render pass setup, the targets are bound when the frame begins
     void SetRenderTarget(D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle);
     void SetViewport(float width, float height);
     void SetClearColor(float r, float g, float b, float a);
 
+    // Occlusion culling setup
+    void SetDepthBuffer(ID3D12Resource* depthBuffer, DXGI_FORMAT shaderResourceFormat, UINT width, UINT height);
+    void SetViewProjectionMatrix(FXMMATRIX viewProjection);
+    void SetInstanceBounds(const AABB* bounds, size_t instanceCount);
+
+    // GPU driven draw submission, the instances are culled against the view projection every frame. Their bounds are
+    // quantized in boundsQuantization, see IndirectDrawBuilder::MakeInstance, and transforms holds the object to world
+    // matrix of each. Instances name their mesh by geometry pool handle and are grouped by the mesh's index format,
+    // each group is drawn with the pool's index buffer of its format bound. Every frame each instance draws the level
+    // of detail LODSelector picks for the camera, so set the geometry pool first.
+    void SetDrawInstances(IndexFormat indexFormat, const ShaderInterop::BoundsQuantization& boundsQuantization,
+        const ShaderInterop::DrawInstance* instances, const XMFLOAT4X4* transforms, size_t instanceCount);
+    // Scene geometry held in one pooled vertex buffer and one index buffer per format, the buffers every draw reads.
+    // Draw instances find their meshes through the pool's descriptors, so the pool is defragmented a little every frame
+    // while they draw. The pool's queued uploads and moves are applied at the start of every frame, then it advances a
+    // frame, so it needs a frame latency of FRAME_COUNT. It has to outlive the renderer or be replaced with nullptr.
+    void SetGeometryPool(GeometryPool* pool);
+
+    // Light culling and level of detail setup. The grid and Z-bins are laid out for the current viewport and the
+    // projected mesh errors measured against it, call SetViewport first.
+    void SetCamera(const Camera& camera);
+    // The list is read while rendering and has to outlive the renderer or be replaced with nullptr
+    void SetLights(const LightList* lights) { m_lights = lights; }
+    void SetLightCullingMode(LightCullingMode mode) { m_lightCullingMode = mode; }
+    LightCullingMode GetLightCullingMode() const { return m_lightCullingMode; }
+
     // Accessors
     GPUCommandList* GetCurrentCommandList() const { return m_commandLists[m_currentFrameIndex].get(); }
     GPUDescriptorHeap* GetDescriptorHeap(UINT frameIndex) const { return m_descriptorHeaps[frameIndex].get(); }
@@ -44,10 +93,22 @@ public:
 
 private:
     void InitializeComputeResources();
+    void InitializeGraphicsResources(DXGI_FORMAT renderTargetFormat, DXGI_FORMAT depthStencilFormat);
+    // Whether the pool's buffers and this frame's descriptors are up to date, only then can the draws read them
+    bool RenderGeometryUpdates();
+    // Picks the level of detail of every draw instance and uploads this frame's instances if any level changed lately
+    void UpdateDrawLODs();
+    // Builds the Hi-Z pyramid from the depth drawn so far and culls every instance against it
+    void RenderOcclusionCulling();
+    // Draws the instances in the frustum with one of the visibilityMask Hi-Z flags set, all of them for a mask of 0
+    void RenderIndirectDraws(UINT visibilityMask);
     void RenderClustering();
+    void RenderLightGrid();
+    void RenderLightZBins();
     void RenderClusterDebugOutlines();
     void RenderDebugVisualization();
     void WaitForFrameCompletion(UINT frameIndex);
+    void WaitForAllFrames();
 
     // Core GPU resources (triple buffered)
     ID3D12Device* m_device = nullptr;
@@ -71,5 +132,45 @@ private:
     D3D12_RECT m_currentScissorRect = {};
     float m_clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
 
+    // Pooled scene geometry, the pool places meshes and the pass mirrors it on the GPU
+    std::unique_ptr<GeometryPoolPass> m_geometryPoolPass;
+    GeometryPool* m_geometryPool = nullptr;
+
+    // Two phase occlusion culling
+    std::unique_ptr<HiZOcclusionPass> m_hiZOcclusionPass;
+    XMFLOAT4X4 m_viewProjection = {};
+
+    // Shades the indirect draws of every index format
+    std::unique_ptr<GPUGraphicsPipeline> m_opaquePipeline;
+
+    // Culled draw arguments consumed by ExecuteIndirect, one set per index format
+    std::array<std::unique_ptr<IndirectDrawPass>, INDEX_FORMAT_COUNT> m_indirectDrawPasses;
+
+    // The draw instances of one index format as last uploaded, with the world space sphere and the level of each
+    struct DrawInstanceLODs
+    {
+        std::vector<ShaderInterop::DrawInstance> instances;
+        std::vector<Sphere> spheres;
+        std::vector<uint32_t> lods;
+        // Frames whose instance buffer still holds levels from before the last switch
+        UINT staleFrames = 0;
+    };
+    std::array<DrawInstanceLODs, INDEX_FORMAT_COUNT> m_drawInstanceLODs;
+    LODSelector m_lodSelector;
+    // The pool's index buffers, empty for a format the pool has no capacity for
+    std::array<D3D12_INDEX_BUFFER_VIEW, INDEX_FORMAT_COUNT> m_indexBufferViews = {};
+
+    // Clustered Forward+ light grid, the CPU grid holds the layout the compute passes build into
+    std::unique_ptr<LightGridPass> m_lightGridPass;
+    LightGrid m_lightGrid;
+    // Z-binned alternative, sorted and binned on the CPU with the tile masks expanded on the GPU
+    std::unique_ptr<LightZBinPass> m_lightZBinPass;
+    LightZBins m_lightZBins;
+    const LightList* m_lights = nullptr;
+    LightCullingMode m_lightCullingMode = LightCullingMode::ClusteredGrid;
+    // Projection scale x and y, near and far plus the viewport size the light culling was laid out for
+    XMFLOAT4 m_lightGridProjection = {};
+    XMUINT2 m_lightGridViewport = {};
+
     bool m_isInitialized = false;
 };
@@ -0,0 +1,81 @@
+#include "stdafx.h"
+#include "GPUBuffer.h"
+
+#include <cstring>
+
+GPUBuffer::~GPUBuffer()
+{
+    Release();
+}
+
+bool GPUBuffer::Initialize(ID3D12Device* device, uint64_t sizeInBytes, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES initialState)
+{
+    assertm(device != nullptr && sizeInBytes > 0, "GPUBuffer::Initialize called with null device or zero size");
+
+    Release();
+
+    D3D12_HEAP_PROPERTIES heapProps = {};
+    heapProps.Type = heapType;
+    heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+    D3D12_RESOURCE_DESC bufferDesc = {};
+    bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    bufferDesc.Width = sizeInBytes;
+    bufferDesc.Height = 1;
+    bufferDesc.DepthOrArraySize = 1;
+    bufferDesc.MipLevels = 1;
+    bufferDesc.Format = DXGI_FORMAT_UNKNOWN;
+    bufferDesc.SampleDesc.Count = 1;
+    bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    bufferDesc.Flags = flags;
+
+    if (heapType == D3D12_HEAP_TYPE_UPLOAD)
+    {
+        initialState = D3D12_RESOURCE_STATE_GENERIC_READ;
+    }
+
+    HRESULT hr = device->CreateCommittedResource(
+        &heapProps,
+        D3D12_HEAP_FLAG_NONE,
+        &bufferDesc,
+        initialState,
+        nullptr,
+        IID_PPV_ARGS(&m_resource)
+    );
+
+    if (FAILED(hr))
+    {
+        return false;
+    }
+
+    m_size = sizeInBytes;
+    m_heapType = heapType;
+    return true;
+}
+
+void GPUBuffer::Release()
+{
+    if (m_resource)
+    {
+        m_resource->Release();
+        m_resource = nullptr;
+    }
+    m_size = 0;
+}
+
+void GPUBuffer::Upload(const void* data, uint64_t sizeInBytes, uint64_t offset)
+{
+    assertm(m_heapType == D3D12_HEAP_TYPE_UPLOAD, "GPUBuffer::Upload called on a buffer outside the upload heap");
+    assertm(m_resource && offset + sizeInBytes <= m_size, "GPUBuffer::Upload out of range");
+
+    D3D12_RANGE readRange = { 0, 0 };
+    uint8_t* mapped = nullptr;
+    HRESULT hr = m_resource->Map(0, &readRange, reinterpret_cast<void**>(&mapped));
+    assert(SUCCEEDED(hr));
+
+    std::memcpy(mapped + offset, data, static_cast<size_t>(sizeInBytes));
+
+    D3D12_RANGE writtenRange = { static_cast<SIZE_T>(offset), static_cast<SIZE_T>(offset + sizeInBytes) };
+    m_resource->Unmap(0, &writtenRange);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "GraphicsAPICommon.h"
+
+class GPUBuffer
+{
+    GPUBuffer(const GPUBuffer&) = delete;
+    GPUBuffer& operator=(const GPUBuffer&) = delete;
+
+public:
+    GPUBuffer() = default;
+    ~GPUBuffer();
+
+    // Upload heap buffers are created in GENERIC_READ and stay mappable, default heap buffers can be unordered access
+    bool Initialize(ID3D12Device* device, uint64_t sizeInBytes, D3D12_HEAP_TYPE heapType,
+        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_COMMON);
+    void Release();
+
+    // Copies data into an upload heap buffer
+    void Upload(const void* data, uint64_t sizeInBytes, uint64_t offset = 0);
+
+    ID3D12Resource* GetResource() const { return m_resource; }
+    D3D12_GPU_VIRTUAL_ADDRESS GetGPUAddress() const { return m_resource ? m_resource->GetGPUVirtualAddress() : 0; }
+    uint64_t GetSize() const { return m_size; }
+    D3D12_HEAP_TYPE GetHeapType() const { return m_heapType; }
+
+private:
+    ID3D12Resource* m_resource = nullptr;
+    uint64_t m_size = 0;
+    D3D12_HEAP_TYPE m_heapType = D3D12_HEAP_TYPE_DEFAULT;
+};
@@ -119,7 +119,7 @@ void GPUCommandList::Reset()
     }
 }
 
-void GPUCommandList::TransitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+void GPUCommandList::TransitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after, UINT subresource)
 {
     if (!resource || before == after || m_pendingBarrierCount >= MAX_PENDING_BARRIERS)
     {
@@ -132,7 +132,7 @@ void GPUCommandList::TransitionResource(ID3D12Resource* resource, D3D12_RESOURCE
     barrier.Transition.pResource = resource;
     barrier.Transition.StateBefore = before;
     barrier.Transition.StateAfter = after;
-    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    barrier.Transition.Subresource = subresource;
 }
 
 void GPUCommandList::UAVBarrier(ID3D12Resource* resource)
@@ -167,6 +167,33 @@ void GPUCommandList::FlushResourceBarriers()
     FlushPendingBarriers();
 }
 
+void GPUCommandList::SetIndexBuffer(D3D12_GPU_VIRTUAL_ADDRESS address, UINT sizeInBytes, DXGI_FORMAT format)
+{
+    assert(m_commandList && m_isOpen);
+    assertm(format == DXGI_FORMAT_R16_UINT || format == DXGI_FORMAT_R32_UINT, "GPUCommandList::SetIndexBuffer called with a format that is not an index format");
+
+    D3D12_INDEX_BUFFER_VIEW view = {};
+    view.BufferLocation = address;
+    view.SizeInBytes = sizeInBytes;
+    view.Format = format;
+    m_commandList->IASetIndexBuffer(&view);
+}
+
+void GPUCommandList::ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount, ID3D12Resource* argumentBuffer,
+    UINT64 argumentOffset, ID3D12Resource* countBuffer, UINT64 countOffset)
+{
+    assert(m_commandList && m_isOpen);
+    assert(commandSignature && argumentBuffer);
+
+    if (maxCommandCount == 0)
+    {
+        return;
+    }
+
+    FlushPendingBarriers();
+    m_commandList->ExecuteIndirect(commandSignature, maxCommandCount, argumentBuffer, argumentOffset, countBuffer, countOffset);
+}
+
 void GPUCommandList::FlushPendingBarriers()
 {
     if (m_pendingBarrierCount > 0 && m_commandList && m_isOpen)
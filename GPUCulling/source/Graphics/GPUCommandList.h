@@ -23,11 +23,20 @@ public:
     void Reset();
     
     // Resource barriers
-    void TransitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+    void TransitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after,
+        UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
     void UAVBarrier(ID3D12Resource* resource);
     void AliasingBarrier(ID3D12Resource* resourceBefore, ID3D12Resource* resourceAfter);
     void FlushResourceBarriers();
 
+    // Input assembly, format is DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
+    void SetIndexBuffer(D3D12_GPU_VIRTUAL_ADDRESS address, UINT sizeInBytes, DXGI_FORMAT format);
+
+    // Indirect draws and dispatches, pending barriers are flushed first. Without a count buffer maxCommandCount
+    // commands are executed, otherwise the smaller of the two.
+    void ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount, ID3D12Resource* argumentBuffer,
+        UINT64 argumentOffset, ID3D12Resource* countBuffer = nullptr, UINT64 countOffset = 0);
+
     // Accessors
     ID3D12GraphicsCommandList* GetCommandList() { return m_commandList; }
     bool IsOpen() const { return m_isOpen; }
@@ -0,0 +1,66 @@
+#include "stdafx.h"
+#include "GPUComputePipeline.h"
+#include "GPUShaderCompiler.h"
+
+GPUComputePipeline::~GPUComputePipeline()
+{
+    Release();
+}
+
+bool GPUComputePipeline::Initialize(ID3D12Device* device, const std::wstring& shaderFileName, const char* entryPoint)
+{
+    assertm(device != nullptr, "GPUComputePipeline::Initialize called with null device");
+
+    ID3DBlob* bytecode = GPUShaderCompiler::CompileFromFile(shaderFileName, entryPoint, "cs_5_1");
+    if (!bytecode)
+    {
+        return false;
+    }
+
+    // The root signature is embedded in the bytecode
+    HRESULT hr = device->CreateRootSignature(0, bytecode->GetBufferPointer(), bytecode->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature));
+    if (FAILED(hr))
+    {
+        bytecode->Release();
+        return false;
+    }
+
+    D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineDesc = {};
+    pipelineDesc.pRootSignature = m_rootSignature;
+    pipelineDesc.CS.pShaderBytecode = bytecode->GetBufferPointer();
+    pipelineDesc.CS.BytecodeLength = bytecode->GetBufferSize();
+
+    hr = device->CreateComputePipelineState(&pipelineDesc, IID_PPV_ARGS(&m_pipelineState));
+    bytecode->Release();
+
+    if (FAILED(hr))
+    {
+        Release();
+        return false;
+    }
+
+    return true;
+}
+
+void GPUComputePipeline::Release()
+{
+    if (m_pipelineState)
+    {
+        m_pipelineState->Release();
+        m_pipelineState = nullptr;
+    }
+
+    if (m_rootSignature)
+    {
+        m_rootSignature->Release();
+        m_rootSignature = nullptr;
+    }
+}
+
+void GPUComputePipeline::Bind(ID3D12GraphicsCommandList* commandList) const
+{
+    assert(commandList && m_rootSignature && m_pipelineState);
+
+    commandList->SetComputeRootSignature(m_rootSignature);
+    commandList->SetPipelineState(m_pipelineState);
+}
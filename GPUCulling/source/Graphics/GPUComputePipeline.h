@@ -0,0 +1,28 @@
+#pragma once
+
+#include "GraphicsAPICommon.h"
+#include <string>
+
+// Compute pipeline whose root signature is declared in the shader with the [RootSignature] attribute
+class GPUComputePipeline
+{
+    GPUComputePipeline(const GPUComputePipeline&) = delete;
+    GPUComputePipeline& operator=(const GPUComputePipeline&) = delete;
+
+public:
+    GPUComputePipeline() = default;
+    ~GPUComputePipeline();
+
+    bool Initialize(ID3D12Device* device, const std::wstring& shaderFileName, const char* entryPoint = "CSMain");
+    void Release();
+
+    // Sets the root signature and pipeline state on a command list
+    void Bind(ID3D12GraphicsCommandList* commandList) const;
+
+    ID3D12RootSignature* GetRootSignature() const { return m_rootSignature; }
+    ID3D12PipelineState* GetPipelineState() const { return m_pipelineState; }
+
+private:
+    ID3D12RootSignature* m_rootSignature = nullptr;
+    ID3D12PipelineState* m_pipelineState = nullptr;
+};
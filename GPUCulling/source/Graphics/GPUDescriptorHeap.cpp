@@ -44,6 +44,13 @@ bool GPUDescriptorHeap::Initialize(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_T
 
     m_allocatedCount = 0;
 
+    // Hand out indices from the start of the heap first
+    m_freeIndices.resize(m_descriptorCount);
+    for (UINT i = 0; i < m_descriptorCount; ++i)
+    {
+        m_freeIndices[i] = m_descriptorCount - 1 - i;
+    }
+
     return true;
 }
 
@@ -62,6 +69,7 @@ void GPUDescriptorHeap::Release()
     m_cpuHeapStart = {};
     m_gpuHeapStart = {};
     m_shaderVisible = false;
+    m_freeIndices.clear();
 }
 
 void GPUDescriptorHeap::AllocateDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE* outCpuHandle, D3D12_GPU_DESCRIPTOR_HANDLE* outGpuHandle)
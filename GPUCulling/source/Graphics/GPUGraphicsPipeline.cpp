@@ -0,0 +1,106 @@
+#include "stdafx.h"
+#include "GPUGraphicsPipeline.h"
+#include "GPUShaderCompiler.h"
+
+GPUGraphicsPipeline::~GPUGraphicsPipeline()
+{
+    Release();
+}
+
+bool GPUGraphicsPipeline::Initialize(ID3D12Device* device, const std::wstring& shaderFileName, const D3D12_INPUT_ELEMENT_DESC* inputElements,
+    UINT inputElementCount, DXGI_FORMAT renderTargetFormat, DXGI_FORMAT depthStencilFormat, const char* vertexEntryPoint,
+    const char* pixelEntryPoint)
+{
+    assertm(device != nullptr, "GPUGraphicsPipeline::Initialize called with null device");
+
+    ID3DBlob* vertexBytecode = GPUShaderCompiler::CompileFromFile(shaderFileName, vertexEntryPoint, "vs_5_1");
+    if (!vertexBytecode)
+    {
+        return false;
+    }
+
+    ID3DBlob* pixelBytecode = GPUShaderCompiler::CompileFromFile(shaderFileName, pixelEntryPoint, "ps_5_1");
+    if (!pixelBytecode)
+    {
+        vertexBytecode->Release();
+        return false;
+    }
+
+    // The root signature is embedded in the vertex shader bytecode
+    HRESULT hr = device->CreateRootSignature(0, vertexBytecode->GetBufferPointer(), vertexBytecode->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature));
+    if (FAILED(hr))
+    {
+        vertexBytecode->Release();
+        pixelBytecode->Release();
+        return false;
+    }
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineDesc = {};
+    pipelineDesc.pRootSignature = m_rootSignature;
+    pipelineDesc.VS.pShaderBytecode = vertexBytecode->GetBufferPointer();
+    pipelineDesc.VS.BytecodeLength = vertexBytecode->GetBufferSize();
+    pipelineDesc.PS.pShaderBytecode = pixelBytecode->GetBufferPointer();
+    pipelineDesc.PS.BytecodeLength = pixelBytecode->GetBufferSize();
+    pipelineDesc.InputLayout.pInputElementDescs = inputElements;
+    pipelineDesc.InputLayout.NumElements = inputElementCount;
+    pipelineDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    pipelineDesc.SampleMask = UINT_MAX;
+    pipelineDesc.SampleDesc.Count = 1;
+    pipelineDesc.NumRenderTargets = 1;
+    pipelineDesc.RTVFormats[0] = renderTargetFormat;
+    pipelineDesc.DSVFormat = depthStencilFormat;
+
+    pipelineDesc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_ONE;
+    pipelineDesc.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_ZERO;
+    pipelineDesc.BlendState.RenderTarget[0].BlendOp = D3D12_BLEND_OP_ADD;
+    pipelineDesc.BlendState.RenderTarget[0].SrcBlendAlpha = D3D12_BLEND_ONE;
+    pipelineDesc.BlendState.RenderTarget[0].DestBlendAlpha = D3D12_BLEND_ZERO;
+    pipelineDesc.BlendState.RenderTarget[0].BlendOpAlpha = D3D12_BLEND_OP_ADD;
+    pipelineDesc.BlendState.RenderTarget[0].LogicOp = D3D12_LOGIC_OP_NOOP;
+    pipelineDesc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+
+    // Imported models keep the winding of their source files, so nothing is culled by facing
+    pipelineDesc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+    pipelineDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+    pipelineDesc.RasterizerState.DepthClipEnable = TRUE;
+
+    pipelineDesc.DepthStencilState.DepthEnable = TRUE;
+    pipelineDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+    pipelineDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+
+    hr = device->CreateGraphicsPipelineState(&pipelineDesc, IID_PPV_ARGS(&m_pipelineState));
+    vertexBytecode->Release();
+    pixelBytecode->Release();
+
+    if (FAILED(hr))
+    {
+        Release();
+        return false;
+    }
+
+    return true;
+}
+
+void GPUGraphicsPipeline::Release()
+{
+    if (m_pipelineState)
+    {
+        m_pipelineState->Release();
+        m_pipelineState = nullptr;
+    }
+
+    if (m_rootSignature)
+    {
+        m_rootSignature->Release();
+        m_rootSignature = nullptr;
+    }
+}
+
+void GPUGraphicsPipeline::Bind(ID3D12GraphicsCommandList* commandList) const
+{
+    assert(commandList && m_rootSignature && m_pipelineState);
+
+    commandList->SetGraphicsRootSignature(m_rootSignature);
+    commandList->SetPipelineState(m_pipelineState);
+    commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "GraphicsAPICommon.h"
+#include <string>
+
+// Graphics pipeline drawing into one render target with depth, its root signature is declared in the vertex shader
+// with the [RootSignature] attribute
+class GPUGraphicsPipeline
+{
+    GPUGraphicsPipeline(const GPUGraphicsPipeline&) = delete;
+    GPUGraphicsPipeline& operator=(const GPUGraphicsPipeline&) = delete;
+
+public:
+    GPUGraphicsPipeline() = default;
+    ~GPUGraphicsPipeline();
+
+    bool Initialize(ID3D12Device* device, const std::wstring& shaderFileName, const D3D12_INPUT_ELEMENT_DESC* inputElements,
+        UINT inputElementCount, DXGI_FORMAT renderTargetFormat, DXGI_FORMAT depthStencilFormat,
+        const char* vertexEntryPoint = "VSMain", const char* pixelEntryPoint = "PSMain");
+    void Release();
+
+    // Sets the root signature, pipeline state and triangle list topology on a command list
+    void Bind(ID3D12GraphicsCommandList* commandList) const;
+
+    ID3D12RootSignature* GetRootSignature() const { return m_rootSignature; }
+    ID3D12PipelineState* GetPipelineState() const { return m_pipelineState; }
+
+private:
+    ID3D12RootSignature* m_rootSignature = nullptr;
+    ID3D12PipelineState* m_pipelineState = nullptr;
+};
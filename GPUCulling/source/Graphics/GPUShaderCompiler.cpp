@@ -0,0 +1,49 @@
+#include "stdafx.h"
+#include "GPUShaderCompiler.h"
+
+#include <d3dcompiler.h>
+
+ID3DBlob* GPUShaderCompiler::CompileFromFile(const std::wstring& fileName, const char* entryPoint, const char* target)
+{
+    assertm(entryPoint && target, "GPUShaderCompiler::CompileFromFile called without entry point or target");
+
+    UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
+#ifdef _DEBUG
+    flags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+    flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+
+    std::wstring filePath = std::wstring(SHADER_DIRECTORY) + fileName;
+
+    ID3DBlob* bytecode = nullptr;
+    ID3DBlob* errors = nullptr;
+    HRESULT hr = D3DCompileFromFile(
+        filePath.c_str(),
+        nullptr,
+        D3D_COMPILE_STANDARD_FILE_INCLUDE,
+        entryPoint,
+        target,
+        flags,
+        0,
+        &bytecode,
+        &errors
+    );
+
+    if (errors)
+    {
+        std::cerr << static_cast<const char*>(errors->GetBufferPointer()) << std::endl;
+        errors->Release();
+    }
+
+    if (FAILED(hr))
+    {
+        if (bytecode)
+        {
+            bytecode->Release();
+        }
+        return nullptr;
+    }
+
+    return bytecode;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "GraphicsAPICommon.h"
+#include <d3dcommon.h>
+#include <string>
+
+// Shaders are compiled at startup from the source tree, relative to the working directory
+static constexpr wchar_t SHADER_DIRECTORY[] = L"source/Shaders/";
+
+class GPUShaderCompiler
+{
+public:
+    // Returns the compiled bytecode or nullptr on failure, compile errors are written to std::cerr.
+    // The caller owns the returned blob and must Release it.
+    static ID3DBlob* CompileFromFile(const std::wstring& fileName, const char* entryPoint, const char* target);
+};
@@ -257,7 +257,7 @@ void GPUSwapChain::CreateDepthStencilBuffer()
     depthDesc.Height = m_height;
     depthDesc.DepthOrArraySize = 1;
     depthDesc.MipLevels = 1;
-    depthDesc.Format = DEPTH_STENCIL_FORMAT;
+    depthDesc.Format = DEPTH_RESOURCE_FORMAT;
     depthDesc.SampleDesc.Count = 1;
     depthDesc.SampleDesc.Quality = 0;
     depthDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
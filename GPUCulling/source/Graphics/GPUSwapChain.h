@@ -24,9 +24,13 @@ public:
     D3D12_CPU_DESCRIPTOR_HANDLE GetBackBufferRTV() const;
     D3D12_CPU_DESCRIPTOR_HANDLE GetBackBufferRTV(UINT index) const;
 
+    DXGI_FORMAT GetBackBufferFormat() const { return BACK_BUFFER_FORMAT; }
+
     // Depth stencil
     ID3D12Resource* GetDepthStencilBuffer() const { return m_depthStencilBuffer; }
     D3D12_CPU_DESCRIPTOR_HANDLE GetDepthStencilView() const { return m_depthStencilView; }
+    DXGI_FORMAT GetDepthStencilFormat() const { return DEPTH_STENCIL_FORMAT; }
+    DXGI_FORMAT GetDepthShaderResourceFormat() const { return DEPTH_SHADER_RESOURCE_FORMAT; }
 
     // Properties
     UINT GetBackBufferCount() const { return BACK_BUFFER_COUNT; }
@@ -45,6 +49,9 @@ private:
 
     static constexpr DXGI_FORMAT BACK_BUFFER_FORMAT = DXGI_FORMAT_R8G8B8A8_UNORM;
     static constexpr DXGI_FORMAT DEPTH_STENCIL_FORMAT = DXGI_FORMAT_D24_UNORM_S8_UINT;
+    // The depth buffer is typeless so it can also be read by the Hi-Z pass
+    static constexpr DXGI_FORMAT DEPTH_RESOURCE_FORMAT = DXGI_FORMAT_R24G8_TYPELESS;
+    static constexpr DXGI_FORMAT DEPTH_SHADER_RESOURCE_FORMAT = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
     static constexpr UINT BACK_BUFFER_COUNT = 3;
 
     ID3D12Device* m_device = nullptr;
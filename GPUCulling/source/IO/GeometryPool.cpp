@@ -0,0 +1,416 @@
+#include "stdafx.h"
+#include "IO/GeometryPool.h"
+#include "IO/ModelCache.h"
+#include "IO/VertexPacking.h"
+#include "Culling/QuantizedBounds.h"
+
+#include <cstring>
+
+using namespace ShaderInterop;
+
+GeometryStream GetIndexStream(IndexFormat format)
+{
+    return format == IndexFormat::UInt16 ? GeometryStream::Indices16 : GeometryStream::Indices32;
+}
+
+uint32_t GetGeometryStreamStride(GeometryStream stream)
+{
+    switch (stream)
+    {
+    case GeometryStream::Vertices:
+        return sizeof(QuantizedVertex);
+    case GeometryStream::Indices16:
+        return GetIndexSize(IndexFormat::UInt16);
+    default:
+        return GetIndexSize(IndexFormat::UInt32);
+    }
+}
+
+void GeometryPool::Initialize(uint32_t vertexCapacity, uint32_t uint16IndexCapacity, uint32_t uint32IndexCapacity, uint32_t frameLatency)
+{
+    Release();
+
+    GetAllocator(GeometryStream::Vertices).Initialize(vertexCapacity);
+    GetAllocator(GeometryStream::Indices16).Initialize(uint16IndexCapacity);
+    GetAllocator(GeometryStream::Indices32).Initialize(uint32IndexCapacity);
+    m_frameLatency = frameLatency;
+}
+
+void GeometryPool::Release()
+{
+    for (RangeAllocator& allocator : m_allocators)
+    {
+        allocator.Release();
+    }
+
+    m_meshes.clear();
+    m_descriptors.clear();
+    m_freeHandles.clear();
+    m_meshCount = 0;
+
+    m_retiredRanges.clear();
+    m_frame = 0;
+    m_frameLatency = 0;
+
+    m_pendingUploads.clear();
+    m_uploadData.clear();
+    m_pendingCopies.clear();
+    m_pendingCopySize = 0;
+}
+
+uint32_t GeometryPool::AddMesh(const MeshData& mesh)
+{
+    return AddMeshData(mesh);
+}
+
+uint32_t GeometryPool::AddMesh(const CookedMesh& mesh)
+{
+    return AddMeshData(mesh);
+}
+
+template<typename Mesh>
+uint32_t GeometryPool::AddMeshData(const Mesh& mesh)
+{
+    assertm(mesh.GetVertexCount() > 0 && !mesh.indices.empty(), "GeometryPool::AddMesh called with an empty mesh");
+
+    // Every level goes into one index range behind LOD 0, so a mesh costs one allocation per stream
+    std::vector<IndexRange> lods(mesh.GetLODCount());
+    std::vector<float> lodErrors(mesh.GetLODCount());
+    uint64_t indexCount = 0;
+    for (uint32_t lod = 0; lod < mesh.GetLODCount(); ++lod)
+    {
+        lods[lod].firstIndex = static_cast<uint32_t>(indexCount);
+        lods[lod].indexCount = static_cast<uint32_t>(mesh.GetLODIndices(lod).size());
+        lodErrors[lod] = mesh.GetLODError(lod);
+        indexCount += lods[lod].indexCount;
+    }
+
+    if (indexCount > UINT32_MAX)
+    {
+        return INVALID_MESH;
+    }
+
+    GeometryStream indexStream = GetIndexStream(mesh.indexFormat);
+    RangeAllocator::Allocation vertices = GetAllocator(GeometryStream::Vertices).Allocate(mesh.GetVertexCount());
+    if (!vertices.IsValid())
+    {
+        return INVALID_MESH;
+    }
+
+    RangeAllocator::Allocation indices = GetAllocator(indexStream).Allocate(static_cast<uint32_t>(indexCount));
+    if (!indices.IsValid())
+    {
+        // Never handed out, so it can go back right away
+        GetAllocator(GeometryStream::Vertices).Free(vertices);
+        return INVALID_MESH;
+    }
+
+    uint32_t meshHandle;
+    if (!m_freeHandles.empty())
+    {
+        meshHandle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    }
+    else
+    {
+        meshHandle = static_cast<uint32_t>(m_meshes.size());
+        m_meshes.emplace_back();
+        m_descriptors.emplace_back();
+    }
+
+    MeshEntry& entry = m_meshes[meshHandle];
+    entry = MeshEntry();
+    entry.vertices.allocation = vertices;
+    entry.indices.allocation = indices;
+    entry.indexFormat = mesh.indexFormat;
+    entry.lods = std::move(lods);
+    entry.lodErrors = std::move(lodErrors);
+    entry.quantization = mesh.quantizedVertices.empty() ? MakeBoundsQuantization(mesh.bounds) : mesh.quantization;
+    entry.isValid = true;
+    ++m_meshCount;
+
+    uint64_t vertexSize = uint64_t(vertices.size) * sizeof(QuantizedVertex);
+    entry.vertices.pendingUpload = QueueUpload(GeometryStream::Vertices, vertices, vertexSize);
+    uint8_t* vertexData = m_uploadData.data() + m_pendingUploads[entry.vertices.pendingUpload].dataOffset;
+    if (!mesh.quantizedVertices.empty())
+    {
+        std::memcpy(vertexData, mesh.quantizedVertices.data(), vertexSize);
+    }
+    else
+    {
+        PackVertices(mesh.vertices.data(), vertices.size, entry.quantization, reinterpret_cast<QuantizedVertex*>(vertexData));
+    }
+
+    uint32_t indexSize = GetIndexSize(mesh.indexFormat);
+    entry.indices.pendingUpload = QueueUpload(indexStream, indices, uint64_t(indices.size) * indexSize);
+    uint8_t* indexData = m_uploadData.data() + m_pendingUploads[entry.indices.pendingUpload].dataOffset;
+    for (uint32_t lod = 0; lod < mesh.GetLODCount(); ++lod)
+    {
+        const auto& lodIndices = mesh.GetLODIndices(lod);
+        WriteIndices(lodIndices.data(), lodIndices.size(), mesh.indexFormat, indexData + uint64_t(entry.lods[lod].firstIndex) * indexSize);
+    }
+
+    GeometryDescriptor& descriptor = m_descriptors[meshHandle];
+    descriptor = {};
+    descriptor.boundsMin = mesh.bounds.min;
+    descriptor.boundsMax = mesh.bounds.max;
+    descriptor.sphereCenter = mesh.boundingSphere.center;
+    descriptor.sphereRadius = mesh.boundingSphere.radius;
+    descriptor.baseVertex = vertices.offset;
+    descriptor.vertexCount = vertices.size;
+    descriptor.firstIndex = indices.offset;
+    descriptor.indexCount = entry.lods[0].indexCount;
+    descriptor.indexFormat = static_cast<uint32_t>(mesh.indexFormat);
+    descriptor.lodCount = mesh.GetLODCount();
+    return meshHandle;
+}
+
+void GeometryPool::RemoveMesh(uint32_t meshHandle)
+{
+    assertm(IsMeshValid(meshHandle), "GeometryPool::RemoveMesh called with an invalid mesh handle");
+
+    MeshEntry& entry = m_meshes[meshHandle];
+    GeometryStream indexStream = GetIndexStream(entry.indexFormat);
+
+    // Work queued for the mesh this frame is dropped, nothing will read its ranges anymore
+    for (GeometryStream stream : { GeometryStream::Vertices, indexStream })
+    {
+        StreamRange& range = GetStreamRange(entry, stream);
+        if (range.pendingUpload != NO_PENDING_WORK)
+        {
+            m_pendingUploads[range.pendingUpload].size = 0;
+        }
+        if (range.pendingCopy != NO_PENDING_WORK)
+        {
+            m_pendingCopySize -= m_pendingCopies[range.pendingCopy].size;
+            m_pendingCopies[range.pendingCopy].size = 0;
+        }
+        Retire(stream, range.allocation);
+    }
+
+    entry = MeshEntry();
+    m_descriptors[meshHandle] = {};
+    m_freeHandles.push_back(meshHandle);
+    --m_meshCount;
+}
+
+const GeometryDescriptor& GeometryPool::GetDescriptor(uint32_t meshHandle) const
+{
+    assertm(IsMeshValid(meshHandle), "GeometryPool::GetDescriptor called with an invalid mesh handle");
+
+    return m_descriptors[meshHandle];
+}
+
+GeometryPool::IndexRange GeometryPool::GetLODRange(uint32_t meshHandle, uint32_t lod) const
+{
+    assertm(IsMeshValid(meshHandle), "GeometryPool::GetLODRange called with an invalid mesh handle");
+    assertm(lod < m_meshes[meshHandle].lods.size(), "GeometryPool::GetLODRange called with an out of range level");
+
+    const MeshEntry& entry = m_meshes[meshHandle];
+    IndexRange range = entry.lods[lod];
+    range.firstIndex += entry.indices.allocation.offset;
+    return range;
+}
+
+const std::vector<float>& GeometryPool::GetLODErrors(uint32_t meshHandle) const
+{
+    assertm(IsMeshValid(meshHandle), "GeometryPool::GetLODErrors called with an invalid mesh handle");
+
+    return m_meshes[meshHandle].lodErrors;
+}
+
+const BoundsQuantization& GeometryPool::GetVertexQuantization(uint32_t meshHandle) const
+{
+    assertm(IsMeshValid(meshHandle), "GeometryPool::GetVertexQuantization called with an invalid mesh handle");
+
+    return m_meshes[meshHandle].quantization;
+}
+
+uint64_t GeometryPool::Defragment(uint64_t maxBytes)
+{
+    uint64_t movedBytes = 0;
+    std::vector<uint32_t> order;
+
+    for (size_t streamIndex = 0; streamIndex < GEOMETRY_STREAM_COUNT; ++streamIndex)
+    {
+        GeometryStream stream = static_cast<GeometryStream>(streamIndex);
+
+        order.clear();
+        uint64_t streamEnd = 0;
+        for (uint32_t meshHandle = 0; meshHandle < m_meshes.size(); ++meshHandle)
+        {
+            MeshEntry& entry = m_meshes[meshHandle];
+            if (entry.isValid && (stream == GeometryStream::Vertices || stream == GetIndexStream(entry.indexFormat)))
+            {
+                const RangeAllocator::Allocation& allocation = GetStreamRange(entry, stream).allocation;
+                streamEnd = std::max(streamEnd, uint64_t(allocation.offset) + allocation.size);
+                order.push_back(meshHandle);
+            }
+        }
+
+        // Nothing free below the last mesh, or the free space is mostly in one piece anyway. Moving meshes then only
+        // costs copy bandwidth.
+        if (streamEnd == GetAllocator(stream).GetUsedSize() || GetStreamFragmentation(stream) < DEFRAGMENT_THRESHOLD)
+        {
+            continue;
+        }
+
+        // Highest first: every move frees a range at the top, which merges with the free space behind it
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+        {
+            return GetStreamRange(m_meshes[a], stream).allocation.offset > GetStreamRange(m_meshes[b], stream).allocation.offset;
+        });
+
+        for (uint32_t meshHandle : order)
+        {
+            if (movedBytes >= maxBytes)
+            {
+                return movedBytes;
+            }
+            movedBytes += MoveDown(meshHandle, stream);
+        }
+    }
+
+    return movedBytes;
+}
+
+void GeometryPool::ClearPendingWork()
+{
+    for (MeshEntry& entry : m_meshes)
+    {
+        entry.vertices.pendingUpload = NO_PENDING_WORK;
+        entry.vertices.pendingCopy = NO_PENDING_WORK;
+        entry.indices.pendingUpload = NO_PENDING_WORK;
+        entry.indices.pendingCopy = NO_PENDING_WORK;
+    }
+
+    m_pendingUploads.clear();
+    m_uploadData.clear();
+    m_pendingCopies.clear();
+    m_pendingCopySize = 0;
+}
+
+void GeometryPool::AdvanceFrame()
+{
+    ++m_frame;
+
+    size_t keptCount = 0;
+    for (const RetiredRange& retired : m_retiredRanges)
+    {
+        if (m_frame - retired.frame >= m_frameLatency)
+        {
+            GetAllocator(retired.stream).Free(retired.allocation);
+        }
+        else
+        {
+            m_retiredRanges[keptCount++] = retired;
+        }
+    }
+    m_retiredRanges.resize(keptCount);
+}
+
+uint64_t GeometryPool::GetStreamCapacity(GeometryStream stream) const
+{
+    return uint64_t(GetAllocator(stream).GetCapacity()) * GetGeometryStreamStride(stream);
+}
+
+uint64_t GeometryPool::GetStreamUsedSize(GeometryStream stream) const
+{
+    return uint64_t(GetAllocator(stream).GetUsedSize()) * GetGeometryStreamStride(stream);
+}
+
+float GeometryPool::GetStreamFragmentation(GeometryStream stream) const
+{
+    const RangeAllocator& allocator = GetAllocator(stream);
+    if (allocator.GetFreeSize() == 0)
+    {
+        return 0.0f;
+    }
+    return 1.0f - static_cast<float>(allocator.GetLargestFreeRange()) / static_cast<float>(allocator.GetFreeSize());
+}
+
+GeometryPool::StreamRange& GeometryPool::GetStreamRange(MeshEntry& mesh, GeometryStream stream)
+{
+    return stream == GeometryStream::Vertices ? mesh.vertices : mesh.indices;
+}
+
+uint32_t GeometryPool::QueueUpload(GeometryStream stream, const RangeAllocator::Allocation& allocation, uint64_t size)
+{
+    Upload upload;
+    upload.stream = stream;
+    // Aligned for the vertices packed in place
+    upload.dataOffset = (m_uploadData.size() + alignof(QuantizedVertex) - 1) & ~uint64_t(alignof(QuantizedVertex) - 1);
+    upload.destinationOffset = uint64_t(allocation.offset) * GetGeometryStreamStride(stream);
+    upload.size = size;
+
+    m_uploadData.resize(upload.dataOffset + size);
+    m_pendingUploads.push_back(upload);
+    return static_cast<uint32_t>(m_pendingUploads.size() - 1);
+}
+
+void GeometryPool::Retire(GeometryStream stream, const RangeAllocator::Allocation& allocation)
+{
+    RetiredRange retired;
+    retired.stream = stream;
+    retired.allocation = allocation;
+    retired.frame = m_frame;
+    m_retiredRanges.push_back(retired);
+}
+
+uint64_t GeometryPool::MoveDown(uint32_t meshHandle, GeometryStream stream)
+{
+    MeshEntry& entry = m_meshes[meshHandle];
+    StreamRange& range = GetStreamRange(entry, stream);
+    RangeAllocator& allocator = GetAllocator(stream);
+
+    // The allocator picks a range by size, not by address, one above the mesh would not help
+    RangeAllocator::Allocation moved = allocator.Allocate(range.allocation.size);
+    if (!moved.IsValid())
+    {
+        return 0;
+    }
+    if (moved.offset > range.allocation.offset)
+    {
+        allocator.Free(moved);
+        return 0;
+    }
+
+    uint32_t stride = GetGeometryStreamStride(stream);
+    uint64_t size = uint64_t(range.allocation.size) * stride;
+    uint64_t destinationOffset = uint64_t(moved.offset) * stride;
+
+    // Data that has not reached the GPU yet is sent to the new range directly
+    if (range.pendingUpload != NO_PENDING_WORK)
+    {
+        m_pendingUploads[range.pendingUpload].destinationOffset = destinationOffset;
+    }
+    else if (range.pendingCopy != NO_PENDING_WORK)
+    {
+        m_pendingCopies[range.pendingCopy].destinationOffset = destinationOffset;
+    }
+    else
+    {
+        Copy copy;
+        copy.stream = stream;
+        copy.sourceOffset = uint64_t(range.allocation.offset) * stride;
+        copy.destinationOffset = destinationOffset;
+        copy.size = size;
+        range.pendingCopy = static_cast<uint32_t>(m_pendingCopies.size());
+        m_pendingCopies.push_back(copy);
+        m_pendingCopySize += size;
+    }
+
+    Retire(stream, range.allocation);
+    range.allocation = moved;
+
+    GeometryDescriptor& descriptor = m_descriptors[meshHandle];
+    if (stream == GeometryStream::Vertices)
+    {
+        descriptor.baseVertex = moved.offset;
+    }
+    else
+    {
+        descriptor.firstIndex = moved.offset;
+    }
+    return size;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "IO/IndexFormat.h"
+#include "IO/ModelData.h"
+#include "Shaders/GeometryPoolShared.h"
+#include "System/RangeAllocator.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct CookedMesh;
+
+// The streams of the scene geometry pool. Every mesh has its vertices in the vertex stream as QuantizedVertex, positions
+// quantized to the mesh's own bounds, and its indices in the index stream of its IndexFormat.
+enum class GeometryStream : uint8_t
+{
+    Vertices,
+    Indices16,
+    Indices32,
+};
+
+static constexpr size_t GEOMETRY_STREAM_COUNT = 3;
+
+GeometryStream GetIndexStream(IndexFormat format);
+// Bytes per element of the stream
+uint32_t GetGeometryStreamStride(GeometryStream stream);
+
+// CPU side of the scene geometry pool: one vertex buffer and one index buffer per index format hold every mesh, so
+// the whole scene draws with a single binding per index format and one ExecuteIndirect each. Meshes are placed by
+// RangeAllocator and described by a GeometryDescriptor. The pool itself holds no geometry, it only tracks placement
+// and queues the uploads and moves that GeometryPoolPass replays into the GPU buffers.
+//
+// Ranges given up by RemoveMesh or Defragment are still read by the frames in flight, they only return to the
+// allocator frameLatency AdvanceFrame calls later.
+class GeometryPool
+{
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+public:
+    static constexpr uint32_t INVALID_MESH = UINT32_MAX;
+    // Streams with less of their free space outside the largest free range are left alone by Defragment
+    static constexpr float DEFRAGMENT_THRESHOLD = 0.25f;
+
+    // Write of new mesh data into a stream, the bytes are at dataOffset in GetUploadData()
+    struct Upload
+    {
+        GeometryStream stream = GeometryStream::Vertices;
+        uint64_t dataOffset = 0;
+        uint64_t destinationOffset = 0;
+        uint64_t size = 0;
+    };
+
+    // Move of resident data inside one stream, the source and destination ranges never overlap
+    struct Copy
+    {
+        GeometryStream stream = GeometryStream::Vertices;
+        uint64_t sourceOffset = 0;
+        uint64_t destinationOffset = 0;
+        uint64_t size = 0;
+    };
+
+    // Index range of one level of detail in the index stream of the mesh
+    struct IndexRange
+    {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+    };
+
+    GeometryPool() = default;
+    ~GeometryPool() = default;
+
+    // Capacities are in vertices and indices. Drops every mesh and all pending work.
+    void Initialize(uint32_t vertexCapacity, uint32_t uint16IndexCapacity, uint32_t uint32IndexCapacity, uint32_t frameLatency);
+    void Release();
+
+    // Places the mesh with all its levels of detail and queues their upload. INVALID_MESH when a stream has no range
+    // large enough left, Defragment may make room. Quantized vertices are uploaded as they are, a mesh without them
+    // has its vertices packed in its bounds on the way in.
+    uint32_t AddMesh(const MeshData& mesh);
+    // Same for a mesh of a mapped cooked file, read straight out of the mapping
+    uint32_t AddMesh(const CookedMesh& mesh);
+    void RemoveMesh(uint32_t meshHandle);
+    bool IsMeshValid(uint32_t meshHandle) const { return meshHandle < m_meshes.size() && m_meshes[meshHandle].isValid; }
+    uint32_t GetMeshCount() const { return m_meshCount; }
+
+    // Descriptors are indexed by mesh handle, the slots of removed meshes are zeroed until the handle is reused
+    const ShaderInterop::GeometryDescriptor& GetDescriptor(uint32_t meshHandle) const;
+    const std::vector<ShaderInterop::GeometryDescriptor>& GetDescriptors() const { return m_descriptors; }
+    IndexRange GetLODRange(uint32_t meshHandle, uint32_t lod) const;
+    // Object space error of every level, increasing with the level and 0 for LOD 0, see LODSelector
+    const std::vector<float>& GetLODErrors(uint32_t meshHandle) const;
+    // Frame the mesh's vertex positions are quantized in, the vertex shader decodes them with it
+    const ShaderInterop::BoundsQuantization& GetVertexQuantization(uint32_t meshHandle) const;
+
+    // Moves the meshes nearest the end of each fragmented stream into free ranges further down, so free space gathers
+    // in one range at the end. Stops after maxBytes were moved, run it with a small budget every frame while meshes
+    // stream in and out. Returns the bytes moved.
+    uint64_t Defragment(uint64_t maxBytes);
+
+    // Work queued since the last ClearPendingWork. Uploads and copies touch disjoint ranges, so they can be replayed
+    // in any order.
+    const std::vector<Upload>& GetPendingUploads() const { return m_pendingUploads; }
+    const std::vector<uint8_t>& GetUploadData() const { return m_uploadData; }
+    const std::vector<Copy>& GetPendingCopies() const { return m_pendingCopies; }
+    uint64_t GetPendingCopySize() const { return m_pendingCopySize; }
+    void ClearPendingWork();
+
+    // Returns the ranges retired frameLatency calls ago to the allocators. Call once per frame after the pending work
+    // was recorded.
+    void AdvanceFrame();
+
+    // Sizes in bytes
+    uint64_t GetStreamCapacity(GeometryStream stream) const;
+    uint64_t GetStreamUsedSize(GeometryStream stream) const;
+    // Share of the free space outside the largest free range, 0 when it is all in one piece
+    float GetStreamFragmentation(GeometryStream stream) const;
+
+private:
+    static constexpr uint32_t NO_PENDING_WORK = UINT32_MAX;
+
+    // A mesh's range in one stream and the work queued for it this frame. A move retargets that work instead of
+    // queueing another copy, so no copy ever reads a range written in the same frame.
+    struct StreamRange
+    {
+        RangeAllocator::Allocation allocation;
+        uint32_t pendingUpload = NO_PENDING_WORK;
+        uint32_t pendingCopy = NO_PENDING_WORK;
+    };
+
+    struct MeshEntry
+    {
+        StreamRange vertices;
+        StreamRange indices;
+        IndexFormat indexFormat = IndexFormat::UInt32;
+        // Relative to the start of the index allocation
+        std::vector<IndexRange> lods;
+        std::vector<float> lodErrors;
+        ShaderInterop::BoundsQuantization quantization = {};
+        bool isValid = false;
+    };
+
+    struct RetiredRange
+    {
+        GeometryStream stream = GeometryStream::Vertices;
+        RangeAllocator::Allocation allocation;
+        uint64_t frame = 0;
+    };
+
+    RangeAllocator& GetAllocator(GeometryStream stream) { return m_allocators[static_cast<size_t>(stream)]; }
+    const RangeAllocator& GetAllocator(GeometryStream stream) const { return m_allocators[static_cast<size_t>(stream)]; }
+    static StreamRange& GetStreamRange(MeshEntry& mesh, GeometryStream stream);
+
+    // Both AddMesh overloads, Mesh is MeshData or CookedMesh
+    template<typename Mesh>
+    uint32_t AddMeshData(const Mesh& mesh);
+    // Reserves size bytes of upload data for the allocation, the caller writes them. Returns the upload index.
+    uint32_t QueueUpload(GeometryStream stream, const RangeAllocator::Allocation& allocation, uint64_t size);
+    void Retire(GeometryStream stream, const RangeAllocator::Allocation& allocation);
+    // Moves the mesh to a lower range of the stream if the allocator has one, returns the bytes moved
+    uint64_t MoveDown(uint32_t meshHandle, GeometryStream stream);
+
+    std::array<RangeAllocator, GEOMETRY_STREAM_COUNT> m_allocators;
+    std::vector<MeshEntry> m_meshes;
+    std::vector<ShaderInterop::GeometryDescriptor> m_descriptors;
+    std::vector<uint32_t> m_freeHandles;
+    uint32_t m_meshCount = 0;
+
+    std::vector<RetiredRange> m_retiredRanges;
+    uint64_t m_frame = 0;
+    uint32_t m_frameLatency = 0;
+
+    std::vector<Upload> m_pendingUploads;
+    std::vector<uint8_t> m_uploadData;
+    std::vector<Copy> m_pendingCopies;
+    uint64_t m_pendingCopySize = 0;
+};
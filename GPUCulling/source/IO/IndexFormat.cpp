@@ -0,0 +1,30 @@
+#include "stdafx.h"
+#include "IO/IndexFormat.h"
+
+#include <cstring>
+
+IndexFormat SelectIndexFormat(size_t vertexCount)
+{
+    return vertexCount <= MAX_UINT16_INDEX_VERTICES ? IndexFormat::UInt16 : IndexFormat::UInt32;
+}
+
+uint32_t GetIndexSize(IndexFormat format)
+{
+    return format == IndexFormat::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+void WriteIndices(const uint32_t* indices, size_t count, IndexFormat format, void* outData)
+{
+    if (format == IndexFormat::UInt32)
+    {
+        std::memcpy(outData, indices, count * sizeof(uint32_t));
+        return;
+    }
+
+    uint16_t* output = static_cast<uint16_t*>(outData);
+    for (size_t i = 0; i < count; ++i)
+    {
+        assertm(indices[i] < MAX_UINT16_INDEX_VERTICES, "WriteIndices called with an index that does not fit 16 bits");
+        output[i] = static_cast<uint16_t>(indices[i]);
+    }
+}
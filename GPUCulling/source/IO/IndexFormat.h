@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Width of a mesh's GPU index buffer. Indices are always processed as 32-bit on the CPU, the width only applies when
+// they are written for upload. A mesh and everything drawn from its index buffer share one width, draws of different
+// widths need separate index buffer bindings.
+enum class IndexFormat : uint8_t
+{
+    UInt16,
+    UInt32,
+};
+
+static constexpr size_t INDEX_FORMAT_COUNT = 2;
+
+// Meshes with at most this many vertices can be addressed with 16-bit indices
+static constexpr size_t MAX_UINT16_INDEX_VERTICES = 65536;
+
+// The narrowest width addressing every vertex
+IndexFormat SelectIndexFormat(size_t vertexCount);
+uint32_t GetIndexSize(IndexFormat format);
+
+// Narrows or copies count indices into outData, which holds count * GetIndexSize(format) bytes
+void WriteIndices(const uint32_t* indices, size_t count, IndexFormat format, void* outData);
@@ -0,0 +1,405 @@
+#include "stdafx.h"
+#include "IO/MeshOptimizer.h"
+#include "IO/ModelData.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    const XMFLOAT3& GetPosition(const XMFLOAT3* positions, size_t strideBytes, uint32_t index)
+    {
+        return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + index * strideBytes);
+    }
+
+    // FIFO post-transform cache: a hit leaves the order untouched, a miss evicts the oldest entry
+    class VertexCacheSimulator
+    {
+    public:
+        VertexCacheSimulator(size_t vertexCount, uint32_t cacheSize)
+            : m_timestamps(vertexCount, 0)
+            , m_cacheSize(cacheSize)
+        {
+            Reset();
+        }
+
+        // Returns whether the vertex had to be transformed
+        bool Access(uint32_t vertex)
+        {
+            if (m_time - m_timestamps[vertex] <= m_cacheSize)
+            {
+                return false;
+            }
+            m_timestamps[vertex] = m_time++;
+            return true;
+        }
+
+        // Empties the cache without touching every timestamp
+        void Reset()
+        {
+            m_time += m_cacheSize + 1;
+        }
+
+    private:
+        std::vector<uint64_t> m_timestamps;
+        uint64_t m_time = 0;
+        uint32_t m_cacheSize;
+    };
+
+    // Triangles around every vertex in one flat array
+    struct VertexTriangles
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        VertexTriangles(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+        {
+            offsets.assign(vertexCount + 1, 0);
+            for (size_t i = 0; i < indexCount; ++i)
+            {
+                ++offsets[indices[i] + 1];
+            }
+            for (size_t v = 0; v < vertexCount; ++v)
+            {
+                offsets[v + 1] += offsets[v];
+            }
+
+            std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+            triangles.resize(indexCount);
+            for (size_t i = 0; i < indexCount; ++i)
+            {
+                triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+    };
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStatistics statistics;
+    statistics.triangleCount = indexCount / 3;
+
+    VertexCacheSimulator cache(vertexCount, cacheSize);
+    std::vector<uint8_t> referenced(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        uint32_t vertex = indices[i];
+        statistics.vertexTransforms += cache.Access(vertex) ? 1 : 0;
+        statistics.vertexCount += referenced[vertex] ? 0 : 1;
+        referenced[vertex] = 1;
+    }
+    return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    assertm(indexCount % 3 == 0, "MeshOptimizer::OptimizeVertexCache called with a partial triangle");
+
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    VertexTriangles adjacency(indices, indexCount, vertexCount);
+
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    // Timestamps start far enough in the past that no vertex counts as cached
+    std::vector<uint64_t> cacheTime(vertexCount, 0);
+    uint64_t time = cacheSize + 1;
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> output;
+    output.reserve(indexCount);
+
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    uint32_t scanCursor = 0;
+
+    // Fans out from the current vertex, then moves to the candidate that will still be cached after its remaining
+    // triangles are emitted, preferring the oldest such entry
+    uint32_t fanVertex = 0;
+    while (fanVertex != INVALID_INDEX)
+    {
+        candidates.clear();
+        for (uint32_t i = adjacency.offsets[fanVertex]; i < adjacency.offsets[fanVertex + 1]; ++i)
+        {
+            uint32_t triangle = adjacency.triangles[i];
+            if (emitted[triangle])
+            {
+                continue;
+            }
+
+            for (uint32_t corner = 0; corner < 3; ++corner)
+            {
+                uint32_t vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+                if (time - cacheTime[vertex] > cacheSize)
+                {
+                    cacheTime[vertex] = time++;
+                }
+            }
+            emitted[triangle] = 1;
+        }
+
+        uint32_t bestVertex = INVALID_INDEX;
+        int64_t bestPriority = -1;
+        for (uint32_t vertex : candidates)
+        {
+            if (liveTriangles[vertex] == 0)
+            {
+                continue;
+            }
+
+            int64_t priority = 0;
+            int64_t age = static_cast<int64_t>(time - cacheTime[vertex]);
+            if (age + 2 * static_cast<int64_t>(liveTriangles[vertex]) <= static_cast<int64_t>(cacheSize))
+            {
+                priority = age;
+            }
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                bestVertex = vertex;
+            }
+        }
+
+        // Dead end: back up through recently emitted vertices, then fall back to scanning the input order
+        while (bestVertex == INVALID_INDEX && !deadEnd.empty())
+        {
+            uint32_t vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[vertex] > 0)
+            {
+                bestVertex = vertex;
+            }
+        }
+        while (bestVertex == INVALID_INDEX && scanCursor < vertexCount)
+        {
+            if (liveTriangles[scanCursor] > 0)
+            {
+                bestVertex = scanCursor;
+            }
+            ++scanCursor;
+        }
+
+        fanVertex = bestVertex;
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const XMFLOAT3* positions, size_t vertexCount,
+    size_t strideBytes, float threshold, uint32_t cacheSize)
+{
+    assertm(indexCount % 3 == 0, "MeshOptimizer::OptimizeOverdraw called with a partial triangle");
+
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    // Hard boundaries: triangles missing all three vertices start over with a cold cache, cutting there costs nothing
+    std::vector<uint32_t> hardClusters;
+    {
+        VertexCacheSimulator cache(vertexCount, cacheSize);
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            uint32_t misses = 0;
+            for (uint32_t corner = 0; corner < 3; ++corner)
+            {
+                misses += cache.Access(indices[t * 3 + corner]) ? 1 : 0;
+            }
+            if (t == 0 || misses == 3)
+            {
+                hardClusters.push_back(static_cast<uint32_t>(t));
+            }
+        }
+        hardClusters.push_back(static_cast<uint32_t>(triangleCount));
+    }
+
+    // Soft boundaries: a cluster is closed as soon as its own ACMR is within threshold of the ACMR of the hard
+    // cluster it belongs to, restarting the cache there costs at most that much
+    std::vector<uint32_t> clusters;
+    {
+        VertexCacheSimulator cache(vertexCount, cacheSize);
+        for (size_t c = 0; c + 1 < hardClusters.size(); ++c)
+        {
+            uint32_t begin = hardClusters[c];
+            uint32_t end = hardClusters[c + 1];
+
+            cache.Reset();
+            uint32_t misses = 0;
+            for (uint32_t i = begin * 3; i < end * 3; ++i)
+            {
+                misses += cache.Access(indices[i]) ? 1 : 0;
+            }
+            float clusterACMR = static_cast<float>(misses) / (end - begin);
+
+            cache.Reset();
+            uint32_t clusterStart = begin;
+            uint32_t clusterMisses = 0;
+            clusters.push_back(begin);
+            for (uint32_t t = begin; t < end; ++t)
+            {
+                for (uint32_t corner = 0; corner < 3; ++corner)
+                {
+                    clusterMisses += cache.Access(indices[t * 3 + corner]) ? 1 : 0;
+                }
+
+                float acmr = static_cast<float>(clusterMisses) / (t + 1 - clusterStart);
+                if (t + 1 < end && acmr <= clusterACMR * threshold)
+                {
+                    clusterStart = t + 1;
+                    clusterMisses = 0;
+                    clusters.push_back(clusterStart);
+                    cache.Reset();
+                }
+            }
+        }
+        clusters.push_back(static_cast<uint32_t>(triangleCount));
+    }
+
+    size_t clusterCount = clusters.size() - 1;
+    if (clusterCount < 2)
+    {
+        return;
+    }
+
+    // Area weighted centroid and normal per cluster, plus the mesh centroid they are measured from
+    std::vector<XMFLOAT3> centroids(clusterCount);
+    std::vector<XMFLOAT3> normals(clusterCount);
+    double meshX = 0.0, meshY = 0.0, meshZ = 0.0, meshArea = 0.0;
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        double cx = 0.0, cy = 0.0, cz = 0.0, area = 0.0;
+        double nx = 0.0, ny = 0.0, nz = 0.0;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            const XMFLOAT3& p0 = GetPosition(positions, strideBytes, indices[t * 3 + 0]);
+            const XMFLOAT3& p1 = GetPosition(positions, strideBytes, indices[t * 3 + 1]);
+            const XMFLOAT3& p2 = GetPosition(positions, strideBytes, indices[t * 3 + 2]);
+
+            double e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+            double e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+            double crossX = e1y * e2z - e1z * e2y;
+            double crossY = e1z * e2x - e1x * e2z;
+            double crossZ = e1x * e2y - e1y * e2x;
+            double triangleArea = std::sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ);
+
+            cx += (p0.x + p1.x + p2.x) / 3.0 * triangleArea;
+            cy += (p0.y + p1.y + p2.y) / 3.0 * triangleArea;
+            cz += (p0.z + p1.z + p2.z) / 3.0 * triangleArea;
+            area += triangleArea;
+            nx += crossX;
+            ny += crossY;
+            nz += crossZ;
+        }
+
+        meshX += cx;
+        meshY += cy;
+        meshZ += cz;
+        meshArea += area;
+
+        double invArea = area > 0.0 ? 1.0 / area : 0.0;
+        centroids[c] = XMFLOAT3(static_cast<float>(cx * invArea), static_cast<float>(cy * invArea), static_cast<float>(cz * invArea));
+        double normalLength = std::sqrt(nx * nx + ny * ny + nz * nz);
+        double invLength = normalLength > 0.0 ? 1.0 / normalLength : 0.0;
+        normals[c] = XMFLOAT3(static_cast<float>(nx * invLength), static_cast<float>(ny * invLength), static_cast<float>(nz * invLength));
+    }
+
+    if (meshArea <= 0.0)
+    {
+        return;
+    }
+
+    float centerX = static_cast<float>(meshX / meshArea);
+    float centerY = static_cast<float>(meshY / meshArea);
+    float centerZ = static_cast<float>(meshZ / meshArea);
+
+    // Clusters far out along their own normal are likely to be in front from any view that sees them
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        sortKeys[c] = (centroids[c].x - centerX) * normals[c].x + (centroids[c].y - centerY) * normals[c].y +
+            (centroids[c].z - centerZ) * normals[c].z;
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(indexCount);
+    for (uint32_t c : order)
+    {
+        sorted.insert(sorted.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+    }
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+void MeshOptimizer::BuildVertexFetchRemap(const uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& outRemap)
+{
+    outRemap.assign(vertexCount, INVALID_INDEX);
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        uint32_t& remapped = outRemap[indices[i]];
+        if (remapped == INVALID_INDEX)
+        {
+            remapped = next++;
+        }
+    }
+
+    for (uint32_t& remapped : outRemap)
+    {
+        if (remapped == INVALID_INDEX)
+        {
+            remapped = next++;
+        }
+    }
+}
+
+MeshOptimizer::Report MeshOptimizer::Optimize(MeshData& mesh)
+{
+    assertm(mesh.meshletData.meshlets.empty() && mesh.lods.empty(), "MeshOptimizer::Optimize called on a mesh with meshlets or LODs");
+
+    Report report;
+    size_t vertexCount = mesh.vertices.size();
+    report.before = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount);
+
+    if (mesh.indices.size() >= 3)
+    {
+        OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount);
+        OptimizeOverdraw(mesh.indices.data(), mesh.indices.size(), &mesh.vertices[0].position, vertexCount, sizeof(VertexData));
+
+        std::vector<uint32_t> remap;
+        BuildVertexFetchRemap(mesh.indices.data(), mesh.indices.size(), vertexCount, remap);
+
+        std::vector<VertexData> vertices(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            vertices[remap[v]] = mesh.vertices[v];
+        }
+        mesh.vertices = std::move(vertices);
+
+        for (uint32_t& index : mesh.indices)
+        {
+            index = remap[index];
+        }
+    }
+
+    report.after = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount);
+    return report;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+
+using namespace DirectX;
+
+struct MeshData;
+
+// Post-transform vertex cache efficiency of an index buffer, measured on a FIFO cache simulator
+struct VertexCacheStatistics
+{
+    uint64_t vertexTransforms = 0;
+    uint64_t triangleCount = 0;
+    uint64_t vertexCount = 0;
+
+    // Average cache miss ratio, transformed vertices per triangle. 0.5 is the limit for large regular grids, 3 the worst.
+    float GetACMR() const { return triangleCount ? static_cast<float>(vertexTransforms) / triangleCount : 0.0f; }
+    // Average transform to vertex ratio, 1 means every referenced vertex is shaded exactly once
+    float GetATVR() const { return vertexCount ? static_cast<float>(vertexTransforms) / vertexCount : 0.0f; }
+
+    void Add(const VertexCacheStatistics& other)
+    {
+        vertexTransforms += other.vertexTransforms;
+        triangleCount += other.triangleCount;
+        vertexCount += other.vertexCount;
+    }
+};
+
+// Import stage that reorders a triangle mesh for the GPU in three steps:
+// 1. Tipsify (Sander et al. 2007) orders triangles so vertices are reused while still in the post-transform cache.
+// 2. The result is cut into clusters where the cache restarts anyway, and clusters facing outwards from the mesh
+//    center are drawn first so they occlude the rest, which cuts overdraw at almost no cache cost.
+// 3. Vertices are renumbered in order of first use so vertex fetch walks memory forward.
+class MeshOptimizer
+{
+public:
+    // Common FIFO size of post-transform caches, Tipsify and the statistics both assume it
+    static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+    // A cluster may cost this much more than its share of the optimized ACMR to be split off for overdraw sorting
+    static constexpr float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+    struct Report
+    {
+        VertexCacheStatistics before;
+        VertexCacheStatistics after;
+
+        void Add(const Report& other)
+        {
+            before.Add(other.before);
+            after.Add(other.after);
+        }
+    };
+
+    MeshOptimizer() = delete;
+
+    // Counts the vertices a FIFO cache of cacheSize entries transforms for the index buffer
+    static VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+        uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+    // Reorders triangles in place for the post-transform cache
+    static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+    // Reorders the clusters of a cache optimized index buffer, front facing outer clusters first
+    static void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const XMFLOAT3* positions, size_t vertexCount,
+        size_t strideBytes, float threshold = DEFAULT_OVERDRAW_THRESHOLD, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+    // Fills outRemap with the new index of every vertex, in order of first use. Unreferenced vertices go last.
+    static void BuildVertexFetchRemap(const uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& outRemap);
+
+    // All three steps on the mesh's vertices and indices. Must run before meshlets and LODs are built, they
+    // reference the vertex order.
+    static Report Optimize(MeshData& mesh);
+};
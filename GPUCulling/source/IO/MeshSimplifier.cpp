@@ -0,0 +1,891 @@
+#include "stdafx.h"
+#include "IO/MeshSimplifier.h"
+#include "IO/ModelData.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    // Border planes are weighted well above the surface so open edges keep their outline
+    constexpr double BORDER_WEIGHT = 10.0;
+    // Each pass may go this far past the cost needed to reach its goal before stopping
+    constexpr double PASS_COST_SLACK = 1.5;
+    // Cosine of the largest turn a collapse may give a triangle, about 78 degrees
+    constexpr double MIN_TURN_COSINE = 0.2;
+    // A level is dropped if it keeps more than this fraction of the previous level's triangles
+    constexpr float MIN_LOD_REDUCTION = 0.85f;
+
+    const XMFLOAT3& GetPosition(const XMFLOAT3* positions, size_t strideBytes, size_t index)
+    {
+        return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + index * strideBytes);
+    }
+
+    void Cross(double ax, double ay, double az, double bx, double by, double bz, double& x, double& y, double& z)
+    {
+        x = ay * bz - az * by;
+        y = az * bx - ax * bz;
+        z = ax * by - ay * bx;
+    }
+
+    void TriangleNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, double& x, double& y, double& z)
+    {
+        Cross(
+            double(b.x) - a.x, double(b.y) - a.y, double(b.z) - a.z,
+            double(c.x) - a.x, double(c.y) - a.y, double(c.z) - a.z,
+            x, y, z);
+    }
+
+    struct PositionHash
+    {
+        size_t operator()(const XMFLOAT3& p) const
+        {
+            uint32_t bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    struct PositionEqual
+    {
+        bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const
+        {
+            return std::memcmp(&a, &b, sizeof(XMFLOAT3)) == 0;
+        }
+    };
+
+    uint64_t EdgeKey(uint32_t a, uint32_t b)
+    {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+
+    double Dot(double ax, double ay, double az, const XMFLOAT3& b)
+    {
+        return ax * b.x + ay * b.y + az * b.z;
+    }
+
+    double GetDistance(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        double x = double(b.x) - a.x, y = double(b.y) - a.y, z = double(b.z) - a.z;
+        return std::sqrt(x * x + y * y + z * z);
+    }
+
+    // A point of the projection plane and its height along the projection direction
+    struct ProjectedPoint
+    {
+        double u, v, height;
+    };
+
+    // Barycentric weights of p in the projected triangle, false if the triangle has no area
+    bool GetBarycentrics(const ProjectedPoint& p, const ProjectedPoint& a, const ProjectedPoint& b, const ProjectedPoint& c, double weights[3])
+    {
+        double area = (b.u - a.u) * (c.v - a.v) - (b.v - a.v) * (c.u - a.u);
+        if (area == 0.0)
+        {
+            return false;
+        }
+
+        weights[1] = ((p.u - a.u) * (c.v - a.v) - (p.v - a.v) * (c.u - a.u)) / area;
+        weights[2] = ((b.u - a.u) * (p.v - a.v) - (b.v - a.v) * (p.u - a.u)) / area;
+        weights[0] = 1.0 - weights[1] - weights[2];
+        return true;
+    }
+}
+
+void MeshSimplifier::Quadric::AddPlane(double nx, double ny, double nz, double d, double planeWeight)
+{
+    a00 += planeWeight * nx * nx;
+    a01 += planeWeight * nx * ny;
+    a02 += planeWeight * nx * nz;
+    a11 += planeWeight * ny * ny;
+    a12 += planeWeight * ny * nz;
+    a22 += planeWeight * nz * nz;
+    b0 += planeWeight * nx * d;
+    b1 += planeWeight * ny * d;
+    b2 += planeWeight * nz * d;
+    c += planeWeight * d * d;
+    weight += planeWeight;
+}
+
+void MeshSimplifier::Quadric::Add(const Quadric& other)
+{
+    a00 += other.a00;
+    a01 += other.a01;
+    a02 += other.a02;
+    a11 += other.a11;
+    a12 += other.a12;
+    a22 += other.a22;
+    b0 += other.b0;
+    b1 += other.b1;
+    b2 += other.b2;
+    c += other.c;
+    weight += other.weight;
+}
+
+double MeshSimplifier::Quadric::Evaluate(const XMFLOAT3& p) const
+{
+    double x = p.x, y = p.y, z = p.z;
+    double error =
+        a00 * x * x + a11 * y * y + a22 * z * z +
+        2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+        2.0 * (b0 * x + b1 * y + b2 * z) + c;
+
+    return weight > 0.0 ? std::max(error, 0.0) / weight : 0.0;
+}
+
+MeshSimplifier::MeshSimplifier(const XMFLOAT3* positions, size_t vertexCount, size_t strideBytes, const uint32_t* indices, size_t indexCount)
+    : m_indices(indices, indices + indexCount)
+{
+    assertm(indexCount % 3 == 0, "Simplifier expects a triangle list");
+
+    m_positions.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        m_positions[i] = GetPosition(positions, strideBytes, i);
+    }
+
+    RemoveDegenerateTriangles();
+    BuildAdjacency();
+    ClassifyVertices();
+    BuildQuadrics();
+    m_triangleBounds.assign(m_indices.size() / 3, 0.0);
+}
+
+void MeshSimplifier::ClassifyVertices()
+{
+    m_kinds.assign(m_positions.size(), VertexKind::Manifold);
+    m_remap.resize(m_positions.size());
+    m_twins.assign(m_positions.size(), NO_TWIN);
+
+    // A vertex split by an attribute leaves a twin at the same position. A pair may slide along a seam together,
+    // a position split more than once never moves.
+    std::unordered_map<XMFLOAT3, uint32_t, PositionHash, PositionEqual> firstAtPosition;
+    firstAtPosition.reserve(m_positions.size());
+    std::vector<uint32_t> positionUses(m_positions.size(), 0);
+    for (uint32_t i = 0; i < m_positions.size(); ++i)
+    {
+        m_remap[i] = firstAtPosition.emplace(m_positions[i], i).first->second;
+        ++positionUses[m_remap[i]];
+    }
+
+    for (uint32_t i = 0; i < m_positions.size(); ++i)
+    {
+        uint32_t first = m_remap[i];
+        if (positionUses[first] > 2)
+        {
+            m_kinds[i] = VertexKind::Locked;
+        }
+        else if (first != i)
+        {
+            m_twins[i] = first;
+            m_twins[first] = i;
+        }
+    }
+
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    std::unordered_map<uint64_t, uint32_t> positionEdgeUses;
+    edgeUses.reserve(m_indices.size());
+    positionEdgeUses.reserve(m_indices.size());
+    for (size_t i = 0; i < m_indices.size(); i += 3)
+    {
+        for (uint32_t e = 0; e < 3; ++e)
+        {
+            uint32_t a = m_indices[i + e];
+            uint32_t b = m_indices[i + (e + 1) % 3];
+            ++edgeUses[EdgeKey(a, b)];
+            ++positionEdgeUses[EdgeKey(m_remap[a], m_remap[b])];
+        }
+    }
+
+    std::vector<uint32_t> borderEdgeCount(m_positions.size(), 0);
+    std::vector<uint32_t> seamEdgeCount(m_positions.size(), 0);
+    for (const auto& [key, uses] : edgeUses)
+    {
+        uint32_t a = uint32_t(key >> 32);
+        uint32_t b = uint32_t(key);
+        uint32_t usesByPosition = positionEdgeUses[EdgeKey(m_remap[a], m_remap[b])];
+        if (uses > 2 || usesByPosition > 2)
+        {
+            m_kinds[a] = VertexKind::Locked;
+            m_kinds[b] = VertexKind::Locked;
+        }
+        else if (uses == 1)
+        {
+            ++borderEdgeCount[a];
+            ++borderEdgeCount[b];
+
+            // Open on this side but closed by position, by the open edge between the twins on the other side
+            if (usesByPosition == 2 && m_twins[a] != NO_TWIN && m_twins[b] != NO_TWIN)
+            {
+                auto twinEdge = edgeUses.find(EdgeKey(m_twins[a], m_twins[b]));
+                if (twinEdge != edgeUses.end() && twinEdge->second == 1)
+                {
+                    ++seamEdgeCount[a];
+                    ++seamEdgeCount[b];
+                }
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < m_positions.size(); ++i)
+    {
+        if (m_kinds[i] == VertexKind::Locked)
+        {
+            continue;
+        }
+
+        // Only a simple border or seam, one edge in and one out, can slide along itself. Anything else where a
+        // seam runs, such as its ends or a seam meeting a border, is locked.
+        if (m_twins[i] != NO_TWIN)
+        {
+            m_kinds[i] = borderEdgeCount[i] == 2 && seamEdgeCount[i] == 2 ? VertexKind::Seam : VertexKind::Locked;
+        }
+        else if (borderEdgeCount[i] > 0)
+        {
+            m_kinds[i] = borderEdgeCount[i] == 2 ? VertexKind::Border : VertexKind::Locked;
+        }
+    }
+
+    // Both sides of a seam move together or not at all
+    for (uint32_t i = 0; i < m_positions.size(); ++i)
+    {
+        if (m_kinds[i] == VertexKind::Seam && m_kinds[m_twins[i]] != VertexKind::Seam)
+        {
+            m_kinds[i] = VertexKind::Locked;
+        }
+    }
+}
+
+void MeshSimplifier::BuildQuadrics()
+{
+    m_quadrics.assign(m_positions.size(), Quadric());
+
+    for (size_t i = 0; i < m_indices.size(); i += 3)
+    {
+        uint32_t triangle[3] = { m_indices[i], m_indices[i + 1], m_indices[i + 2] };
+        const XMFLOAT3& p0 = m_positions[triangle[0]];
+
+        double nx, ny, nz;
+        TriangleNormal(p0, m_positions[triangle[1]], m_positions[triangle[2]], nx, ny, nz);
+        double length = std::sqrt(nx * nx + ny * ny + nz * nz);
+        if (length <= 0.0)
+        {
+            continue;
+        }
+
+        // Area weighted so the error stays independent of the tessellation
+        double area = 0.5 * length;
+        nx /= length;
+        ny /= length;
+        nz /= length;
+        double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+
+        for (uint32_t vertex : triangle)
+        {
+            m_quadrics[vertex].AddPlane(nx, ny, nz, d, area);
+        }
+
+        for (uint32_t e = 0; e < 3; ++e)
+        {
+            uint32_t a = triangle[e];
+            uint32_t b = triangle[(e + 1) % 3];
+            if (!IsBorderEdge(a, b))
+            {
+                continue;
+            }
+
+            // Plane through the edge perpendicular to the triangle
+            const XMFLOAT3& pa = m_positions[a];
+            const XMFLOAT3& pb = m_positions[b];
+            double ex = double(pb.x) - pa.x, ey = double(pb.y) - pa.y, ez = double(pb.z) - pa.z;
+            double edgeLengthSquared = ex * ex + ey * ey + ez * ez;
+
+            double mx, my, mz;
+            Cross(ex, ey, ez, nx, ny, nz, mx, my, mz);
+            double mLength = std::sqrt(mx * mx + my * my + mz * mz);
+            if (mLength <= 0.0)
+            {
+                continue;
+            }
+
+            mx /= mLength;
+            my /= mLength;
+            mz /= mLength;
+            double md = -(mx * pa.x + my * pa.y + mz * pa.z);
+
+            m_quadrics[a].AddPlane(mx, my, mz, md, edgeLengthSquared * BORDER_WEIGHT);
+            m_quadrics[b].AddPlane(mx, my, mz, md, edgeLengthSquared * BORDER_WEIGHT);
+        }
+    }
+}
+
+void MeshSimplifier::BuildAdjacency()
+{
+    m_adjacencyOffsets.assign(m_positions.size() + 1, 0);
+    for (uint32_t index : m_indices)
+    {
+        ++m_adjacencyOffsets[index + 1];
+    }
+
+    for (size_t i = 1; i < m_adjacencyOffsets.size(); ++i)
+    {
+        m_adjacencyOffsets[i] += m_adjacencyOffsets[i - 1];
+    }
+
+    m_adjacency.resize(m_indices.size());
+    std::vector<uint32_t> cursor(m_adjacencyOffsets.begin(), m_adjacencyOffsets.end() - 1);
+    for (uint32_t i = 0; i < m_indices.size(); ++i)
+    {
+        m_adjacency[cursor[m_indices[i]]++] = i / 3;
+    }
+}
+
+bool MeshSimplifier::IsBorderEdge(uint32_t a, uint32_t b) const
+{
+    // Triangles folded by earlier collapses of the same pass still show up in the adjacency, they do not count
+    uint32_t uses = 0;
+    for (uint32_t i = m_adjacencyOffsets[a]; i < m_adjacencyOffsets[a + 1]; ++i)
+    {
+        const uint32_t* triangle = &m_indices[m_adjacency[i] * 3];
+        bool isFolded = triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2];
+        uses += !isFolded && (triangle[0] == b || triangle[1] == b || triangle[2] == b) ? 1 : 0;
+    }
+
+    return uses == 1;
+}
+
+bool MeshSimplifier::CanCollapse(uint32_t from, uint32_t to) const
+{
+    switch (m_kinds[from])
+    {
+    case VertexKind::Manifold:
+        return true;
+    case VertexKind::Border:
+        // Sliding along the border keeps the outline, crossing the interior would cut into it
+        return (m_kinds[to] == VertexKind::Border || m_kinds[to] == VertexKind::Locked) && IsBorderEdge(from, to);
+    case VertexKind::Seam:
+        // Along the seam only, where the twins share the edge as well, so the other side can follow
+        return (m_kinds[to] == VertexKind::Seam || m_kinds[to] == VertexKind::Locked) && m_twins[to] != NO_TWIN &&
+            IsBorderEdge(from, to) && IsBorderEdge(m_twins[from], m_twins[to]);
+    default:
+        return false;
+    }
+}
+
+double MeshSimplifier::GetCollapseCost(uint32_t from, uint32_t to) const
+{
+    double cost = m_quadrics[from].Evaluate(m_positions[to]);
+    if (m_kinds[from] == VertexKind::Seam)
+    {
+        cost = std::max(cost, m_quadrics[m_twins[from]].Evaluate(m_positions[to]));
+    }
+    return cost;
+}
+
+void MeshSimplifier::GatherRing(uint32_t vertex, std::vector<uint32_t>& ring) const
+{
+    for (uint32_t side : { vertex, m_twins[vertex] })
+    {
+        if (side == NO_TWIN)
+        {
+            continue;
+        }
+
+        for (uint32_t i = m_adjacencyOffsets[side]; i < m_adjacencyOffsets[side + 1]; ++i)
+        {
+            const uint32_t* triangle = &m_indices[m_adjacency[i] * 3];
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                ring.push_back(m_remap[triangle[k]]);
+            }
+        }
+    }
+}
+
+double MeshSimplifier::GetCollapseDistance(uint32_t from, uint32_t to) const
+{
+    // Mapping every point to the one of the same barycentrics after the collapse moves no point further than from
+    // itself. Mostly much tighter is the projection below, the smaller of the two bounds holds.
+    const XMFLOAT3& fromPosition = m_positions[from];
+    const XMFLOAT3& toPosition = m_positions[to];
+    double distance = GetDistance(fromPosition, toPosition);
+
+    // The triangles around from on both sides of a seam, before the collapse and after it without the ones that
+    // fold onto the edge. Projected along a direction none of them turns away from, both cover the same polygon and
+    // the points above each other correspond.
+    std::vector<std::array<XMFLOAT3, 3>> before;
+    std::vector<std::array<XMFLOAT3, 3>> after;
+    double nx = 0.0, ny = 0.0, nz = 0.0;
+    for (uint32_t side : { from, m_twins[from] })
+    {
+        if (side == NO_TWIN)
+        {
+            continue;
+        }
+
+        for (uint32_t i = m_adjacencyOffsets[side]; i < m_adjacencyOffsets[side + 1]; ++i)
+        {
+            // Triangles folded by earlier collapses of this pass are no part of the surface anymore
+            const uint32_t* triangle = &m_indices[m_adjacency[i] * 3];
+            if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])
+            {
+                continue;
+            }
+
+            std::array<XMFLOAT3, 3> corners = { m_positions[triangle[0]], m_positions[triangle[1]], m_positions[triangle[2]] };
+            before.push_back(corners);
+
+            double x, y, z;
+            TriangleNormal(corners[0], corners[1], corners[2], x, y, z);
+            nx += x;
+            ny += y;
+            nz += z;
+
+            bool isFolded = false;
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                isFolded |= m_remap[triangle[k]] == m_remap[to];
+                if (triangle[k] == side)
+                {
+                    corners[k] = toPosition;
+                }
+            }
+            if (!isFolded)
+            {
+                after.push_back(corners);
+            }
+        }
+    }
+
+    // A border vertex slides along the line through its border neighbors, so the direction is tilted into their
+    // plane. The outline then projects the same before and after.
+    if (m_kinds[from] == VertexKind::Border)
+    {
+        uint32_t previous = NO_TWIN;
+        for (uint32_t i = m_adjacencyOffsets[from]; i < m_adjacencyOffsets[from + 1] && previous == NO_TWIN; ++i)
+        {
+            const uint32_t* triangle = &m_indices[m_adjacency[i] * 3];
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                if (triangle[k] != from && triangle[k] != to && IsBorderEdge(from, triangle[k]))
+                {
+                    previous = triangle[k];
+                }
+            }
+        }
+
+        double mx = 0.0, my = 0.0, mz = 0.0;
+        if (previous != NO_TWIN)
+        {
+            TriangleNormal(m_positions[previous], fromPosition, toPosition, mx, my, mz);
+        }
+        double mLengthSquared = mx * mx + my * my + mz * mz;
+        if (mLengthSquared > 0.0)
+        {
+            double d = (nx * mx + ny * my + nz * mz) / mLengthSquared;
+            nx -= d * mx;
+            ny -= d * my;
+            nz -= d * mz;
+        }
+    }
+
+    double length = std::sqrt(nx * nx + ny * ny + nz * nz);
+    if (length <= 0.0)
+    {
+        return distance;
+    }
+    nx /= length;
+    ny /= length;
+    nz /= length;
+
+    for (const auto* triangles : { &before, &after })
+    {
+        for (const std::array<XMFLOAT3, 3>& corners : *triangles)
+        {
+            // Triangles without area project to a segment and cover nothing
+            double x, y, z;
+            TriangleNormal(corners[0], corners[1], corners[2], x, y, z);
+            if (x * nx + y * ny + z * nz <= 0.0 && (x != 0.0 || y != 0.0 || z != 0.0))
+            {
+                return distance;
+            }
+        }
+    }
+
+    // Any two axes across the direction span the projection plane
+    double ux, uy, uz;
+    Cross(nx, ny, nz, std::abs(nx) < 0.9 ? 1.0 : 0.0, std::abs(nx) < 0.9 ? 0.0 : 1.0, 0.0, ux, uy, uz);
+    double uLength = std::sqrt(ux * ux + uy * uy + uz * uz);
+    ux /= uLength;
+    uy /= uLength;
+    uz /= uLength;
+    double vx, vy, vz;
+    Cross(nx, ny, nz, ux, uy, uz, vx, vy, vz);
+    auto project = [&](const XMFLOAT3& p)
+    {
+        return ProjectedPoint{ Dot(ux, uy, uz, p), Dot(vx, vy, vz, p), Dot(nx, ny, nz, p) };
+    };
+
+    // The height difference is linear between the crossings of the edges before and after, so its extremes are at
+    // from, where the surface after is found by its triangle, and where the spokes of from cross the spokes of to
+    ProjectedPoint fromPoint = project(fromPosition);
+    ProjectedPoint toPoint = project(toPosition);
+    constexpr double BARYCENTRIC_EPSILON = 1e-6;
+    double projectedDistance = -1.0;
+    for (const std::array<XMFLOAT3, 3>& corners : after)
+    {
+        ProjectedPoint a = project(corners[0]), b = project(corners[1]), c = project(corners[2]);
+        double weights[3];
+        if (GetBarycentrics(fromPoint, a, b, c, weights) &&
+            weights[0] >= -BARYCENTRIC_EPSILON && weights[1] >= -BARYCENTRIC_EPSILON && weights[2] >= -BARYCENTRIC_EPSILON)
+        {
+            double height = weights[0] * a.height + weights[1] * b.height + weights[2] * c.height;
+            projectedDistance = std::abs(height - fromPoint.height);
+            break;
+        }
+    }
+    if (projectedDistance < 0.0)
+    {
+        return distance;
+    }
+
+    for (const std::array<XMFLOAT3, 3>& oldCorners : before)
+    {
+        for (const XMFLOAT3& oldEnd : oldCorners)
+        {
+            ProjectedPoint p = project(oldEnd);
+            for (const std::array<XMFLOAT3, 3>& newCorners : after)
+            {
+                for (const XMFLOAT3& newEnd : newCorners)
+                {
+                    // Solve from + s * (oldEnd - from) = to + t * (newEnd - to) in the plane
+                    ProjectedPoint q = project(newEnd);
+                    double du = p.u - fromPoint.u, dv = p.v - fromPoint.v;
+                    double eu = q.u - toPoint.u, ev = q.v - toPoint.v;
+                    double determinant = du * ev - dv * eu;
+                    if (determinant == 0.0)
+                    {
+                        continue;
+                    }
+
+                    double wu = toPoint.u - fromPoint.u, wv = toPoint.v - fromPoint.v;
+                    double s = (wu * ev - wv * eu) / determinant;
+                    double t = (wu * dv - wv * du) / determinant;
+                    if (s < 0.0 || s > 1.0 || t < 0.0 || t > 1.0)
+                    {
+                        continue;
+                    }
+
+                    double oldHeight = fromPoint.height + s * (p.height - fromPoint.height);
+                    double newHeight = toPoint.height + t * (q.height - toPoint.height);
+                    projectedDistance = std::max(projectedDistance, std::abs(newHeight - oldHeight));
+                }
+            }
+        }
+    }
+
+    return std::min(distance, projectedDistance);
+}
+
+bool MeshSimplifier::PassesLinkCondition(uint32_t from, uint32_t to, bool borderEdge) const
+{
+    // The collapse stays manifold only if the two one rings share just the vertices opposite the edge. The rings
+    // are compared by position, so the triangles on both sides of a seam count.
+    uint32_t fromPosition = m_remap[from];
+    uint32_t toPosition = m_remap[to];
+    auto isEdgeEnd = [&](uint32_t position) { return position == fromPosition || position == toPosition; };
+
+    std::vector<uint32_t> fromRing;
+    GatherRing(from, fromRing);
+    fromRing.erase(std::remove_if(fromRing.begin(), fromRing.end(), isEdgeEnd), fromRing.end());
+    std::sort(fromRing.begin(), fromRing.end());
+    fromRing.erase(std::unique(fromRing.begin(), fromRing.end()), fromRing.end());
+
+    std::vector<uint32_t> toRing;
+    GatherRing(to, toRing);
+    toRing.erase(std::remove_if(toRing.begin(), toRing.end(), isEdgeEnd), toRing.end());
+    std::sort(toRing.begin(), toRing.end());
+    toRing.erase(std::unique(toRing.begin(), toRing.end()), toRing.end());
+
+    size_t sharedCount = 0;
+    for (uint32_t position : toRing)
+    {
+        sharedCount += std::binary_search(fromRing.begin(), fromRing.end(), position) ? 1 : 0;
+    }
+
+    return sharedCount == (borderEdge ? 1u : 2u);
+}
+
+bool MeshSimplifier::FlipsTriangles(uint32_t from, uint32_t to) const
+{
+    const XMFLOAT3& target = m_positions[to];
+
+    for (uint32_t i = m_adjacencyOffsets[from]; i < m_adjacencyOffsets[from + 1]; ++i)
+    {
+        const uint32_t* triangle = &m_indices[m_adjacency[i] * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+        {
+            continue;
+        }
+
+        XMFLOAT3 before[3] = { m_positions[triangle[0]], m_positions[triangle[1]], m_positions[triangle[2]] };
+        XMFLOAT3 after[3] = { before[0], before[1], before[2] };
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            if (triangle[k] == from)
+            {
+                after[k] = target;
+            }
+        }
+
+        double bx, by, bz, ax, ay, az;
+        TriangleNormal(before[0], before[1], before[2], bx, by, bz);
+        TriangleNormal(after[0], after[1], after[2], ax, ay, az);
+
+        // Already degenerate input triangles have no orientation to lose
+        if (bx == 0.0 && by == 0.0 && bz == 0.0)
+        {
+            continue;
+        }
+
+        // Also rejects collapses that squash a triangle to zero area or stand it up across the surface
+        double turn = bx * ax + by * ay + bz * az;
+        if (turn <= MIN_TURN_COSINE * std::sqrt((bx * bx + by * by + bz * bz) * (ax * ax + ay * ay + az * az)))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void MeshSimplifier::ApplyCollapse(uint32_t from, uint32_t to)
+{
+    for (uint32_t i = m_adjacencyOffsets[from]; i < m_adjacencyOffsets[from + 1]; ++i)
+    {
+        uint32_t* triangle = &m_indices[m_adjacency[i] * 3];
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            if (triangle[k] == from)
+            {
+                triangle[k] = to;
+            }
+        }
+    }
+
+    m_quadrics[to].Add(m_quadrics[from]);
+}
+
+void MeshSimplifier::RemoveDegenerateTriangles()
+{
+    size_t write = 0;
+    for (size_t i = 0; i < m_indices.size(); i += 3)
+    {
+        uint32_t a = m_indices[i], b = m_indices[i + 1], c = m_indices[i + 2];
+        if (a == b || b == c || a == c)
+        {
+            continue;
+        }
+
+        if (!m_triangleBounds.empty())
+        {
+            m_triangleBounds[write / 3] = m_triangleBounds[i / 3];
+        }
+        m_indices[write++] = a;
+        m_indices[write++] = b;
+        m_indices[write++] = c;
+    }
+
+    m_indices.resize(write);
+    m_triangleBounds.resize(m_triangleBounds.empty() ? 0 : write / 3);
+}
+
+float MeshSimplifier::Simplify(size_t targetIndexCount)
+{
+    std::vector<Collapse> collapses;
+    std::vector<uint64_t> edges;
+    std::vector<uint8_t> touched;
+    std::vector<uint32_t> ring;
+
+    while (m_indices.size() > targetIndexCount)
+    {
+        // Gather each edge once, ordered so the passes stay deterministic
+        edges.clear();
+        for (size_t i = 0; i < m_indices.size(); i += 3)
+        {
+            for (uint32_t e = 0; e < 3; ++e)
+            {
+                edges.push_back(EdgeKey(m_indices[i + e], m_indices[i + (e + 1) % 3]));
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        collapses.clear();
+        for (uint64_t edge : edges)
+        {
+            uint32_t a = uint32_t(edge >> 32);
+            uint32_t b = uint32_t(edge);
+
+            // Half edge collapse, so the cheaper of the two directions that is allowed
+            Collapse best = { 0, 0, -1.0 };
+            if (CanCollapse(a, b))
+            {
+                best = { a, b, GetCollapseCost(a, b) };
+            }
+
+            if (CanCollapse(b, a))
+            {
+                double cost = GetCollapseCost(b, a);
+                if (best.cost < 0.0 || cost < best.cost)
+                {
+                    best = { b, a, cost };
+                }
+            }
+
+            if (best.cost >= 0.0)
+            {
+                collapses.push_back(best);
+            }
+        }
+
+        if (collapses.empty())
+        {
+            break;
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+        {
+            return a.cost != b.cost ? a.cost < b.cost : (a.from != b.from ? a.from < b.from : a.to < b.to);
+        });
+
+        // Interior collapses remove two triangles. Cap the pass near the cost needed for the goal so cheap
+        // collapses blocked this pass are not overtaken by expensive ones.
+        size_t trianglesToRemove = (m_indices.size() - targetIndexCount + 2) / 3;
+        size_t goal = std::min(collapses.size(), std::max<size_t>(1, trianglesToRemove / 2));
+        double costLimit = collapses[goal - 1].cost * PASS_COST_SLACK;
+
+        touched.assign(m_positions.size(), 0);
+        size_t trianglesRemoved = 0;
+        size_t collapsesApplied = 0;
+
+        for (const Collapse& collapse : collapses)
+        {
+            if (trianglesRemoved >= trianglesToRemove || collapse.cost > costLimit)
+            {
+                break;
+            }
+
+            if (touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+
+            // The twins of a seam edge collapse in step, one triangle goes on either side
+            bool seamEdge = m_kinds[collapse.from] == VertexKind::Seam;
+            uint32_t twinFrom = m_twins[collapse.from];
+            uint32_t twinTo = m_twins[collapse.to];
+            if (seamEdge && (touched[twinFrom] || touched[twinTo] || FlipsTriangles(twinFrom, twinTo)))
+            {
+                continue;
+            }
+
+            bool borderEdge = m_kinds[collapse.from] == VertexKind::Border;
+            if (!PassesLinkCondition(collapse.from, collapse.to, borderEdge) || FlipsTriangles(collapse.from, collapse.to))
+            {
+                continue;
+            }
+
+            // Every triangle left around from carries the bounds of the ones it replaces plus the collapse's own
+            ring.clear();
+            for (uint32_t side : { collapse.from, twinFrom })
+            {
+                if (side == collapse.from || seamEdge)
+                {
+                    ring.insert(ring.end(), m_adjacency.begin() + m_adjacencyOffsets[side], m_adjacency.begin() + m_adjacencyOffsets[side + 1]);
+                }
+            }
+
+            double bound = 0.0;
+            for (uint32_t triangle : ring)
+            {
+                bound = std::max(bound, m_triangleBounds[triangle]);
+            }
+            bound += GetCollapseDistance(collapse.from, collapse.to);
+            for (uint32_t triangle : ring)
+            {
+                m_triangleBounds[triangle] = bound;
+            }
+            m_maxDistance = std::max(m_maxDistance, bound);
+
+            ApplyCollapse(collapse.from, collapse.to);
+            touched[collapse.from] = 1;
+            touched[collapse.to] = 1;
+            if (seamEdge)
+            {
+                ApplyCollapse(twinFrom, twinTo);
+                touched[twinFrom] = 1;
+                touched[twinTo] = 1;
+            }
+
+            trianglesRemoved += borderEdge ? 1 : 2;
+            ++collapsesApplied;
+        }
+
+        RemoveDegenerateTriangles();
+        BuildAdjacency();
+
+        if (collapsesApplied == 0)
+        {
+            break;
+        }
+    }
+
+    // Rounded up, so the float still bounds it
+    m_error = static_cast<float>(m_maxDistance);
+    if (m_error < m_maxDistance)
+    {
+        m_error = std::nextafter(m_error, INFINITY);
+    }
+    return m_error;
+}
+
+void MeshSimplifier::GenerateLODs(MeshData& mesh, const float* ratios, size_t ratioCount)
+{
+    mesh.lods.clear();
+    if (mesh.indices.size() < 3 || mesh.vertices.empty())
+    {
+        return;
+    }
+
+    MeshSimplifier simplifier(&mesh.vertices[0].position, mesh.vertices.size(), sizeof(VertexData), mesh.indices.data(), mesh.indices.size());
+
+    // Each level continues from the previous one, so quadrics and error accumulate along the chain
+    size_t fullTriangleCount = mesh.indices.size() / 3;
+    size_t previousTriangleCount = fullTriangleCount;
+    for (size_t i = 0; i < ratioCount; ++i)
+    {
+        size_t targetTriangleCount = static_cast<size_t>(fullTriangleCount * ratios[i]);
+        if (targetTriangleCount < MIN_LOD_TRIANGLES)
+        {
+            break;
+        }
+
+        float error = simplifier.Simplify(targetTriangleCount * 3);
+        size_t triangleCount = simplifier.GetIndices().size() / 3;
+        if (triangleCount > previousTriangleCount * MIN_LOD_REDUCTION)
+        {
+            break;
+        }
+
+        MeshLOD lod;
+        lod.indices = simplifier.GetIndices();
+        lod.error = error;
+        mesh.lods.push_back(std::move(lod));
+        previousTriangleCount = triangleCount;
+    }
+}
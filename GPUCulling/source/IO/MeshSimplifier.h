@@ -0,0 +1,106 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+
+using namespace DirectX;
+
+struct MeshData;
+
+// Quadric error metric simplifier working by half edge collapses, so every level keeps indexing the original
+// vertex buffer. Open borders only collapse along themselves. A pair of vertices split by an attribute along a
+// seam (UVs, normals) collapses along the seam, and its twin on the other side collapses in step so the seam stays
+// closed. Vertices shared by more than two splits, seam ends and non-manifold vertices never move.
+//
+// The reported error bounds the distance between a level and the input surface, both ways. Each collapse maps the
+// triangles around the vertex before and after it onto each other along a common projection direction, the points
+// furthest apart are where their edges cross, and the bounds of consecutive collapses add up.
+class MeshSimplifier
+{
+    MeshSimplifier(const MeshSimplifier&) = delete;
+    MeshSimplifier& operator=(const MeshSimplifier&) = delete;
+
+public:
+    // Triangle ratios of the generated levels relative to the full resolution mesh
+    static constexpr float DEFAULT_LOD_RATIOS[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+    // Levels below this many triangles are not worth a draw of their own
+    static constexpr size_t MIN_LOD_TRIANGLES = 16;
+
+    MeshSimplifier(const XMFLOAT3* positions, size_t vertexCount, size_t strideBytes, const uint32_t* indices, size_t indexCount);
+    ~MeshSimplifier() = default;
+
+    // Continues simplifying towards targetIndexCount and returns a bound on the distance between the current and the
+    // input surface in world units. Stops early when every remaining collapse is blocked.
+    float Simplify(size_t targetIndexCount);
+
+    const std::vector<uint32_t>& GetIndices() const { return m_indices; }
+    float GetError() const { return m_error; }
+
+    // Fills mesh.lods with one level per ratio, dropping levels that fail to reduce the previous one noticeably
+    static void GenerateLODs(MeshData& mesh, const float* ratios, size_t ratioCount);
+
+private:
+    struct Quadric
+    {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        double c = 0.0;
+        double weight = 0.0;
+
+        void AddPlane(double nx, double ny, double nz, double d, double planeWeight);
+        void Add(const Quadric& other);
+        // Weighted mean squared distance of p to the accumulated planes
+        double Evaluate(const XMFLOAT3& p) const;
+    };
+
+    enum class VertexKind : uint8_t
+    {
+        Manifold,
+        Border,
+        Seam,
+        Locked,
+    };
+
+    static constexpr uint32_t NO_TWIN = UINT32_MAX;
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    void ClassifyVertices();
+    void BuildQuadrics();
+    void BuildAdjacency();
+    bool IsBorderEdge(uint32_t a, uint32_t b) const;
+    bool CanCollapse(uint32_t from, uint32_t to) const;
+    // Cost of moving from onto to, for a seam collapse the larger of the two sides
+    double GetCollapseCost(uint32_t from, uint32_t to) const;
+    // Appends the neighbors of vertex and of its twin, by position
+    void GatherRing(uint32_t vertex, std::vector<uint32_t>& ring) const;
+    // Bound on how far the surface around from moves in the collapse
+    double GetCollapseDistance(uint32_t from, uint32_t to) const;
+    bool PassesLinkCondition(uint32_t from, uint32_t to, bool borderEdge) const;
+    bool FlipsTriangles(uint32_t from, uint32_t to) const;
+    void ApplyCollapse(uint32_t from, uint32_t to);
+    void RemoveDegenerateTriangles();
+
+    std::vector<XMFLOAT3> m_positions;
+    std::vector<uint32_t> m_indices;
+    std::vector<VertexKind> m_kinds;
+    // First vertex at the same position, and the other vertex at it where exactly two share it
+    std::vector<uint32_t> m_remap;
+    std::vector<uint32_t> m_twins;
+    std::vector<Quadric> m_quadrics;
+
+    // Vertex to triangle adjacency of the current indices in compressed rows
+    std::vector<uint32_t> m_adjacencyOffsets;
+    std::vector<uint32_t> m_adjacency;
+
+    // Per triangle bound on its distance to the input surface, compacted along with m_indices
+    std::vector<double> m_triangleBounds;
+    double m_maxDistance = 0.0;
+    float m_error = 0.0f;
+};
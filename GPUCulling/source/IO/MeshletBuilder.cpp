@@ -0,0 +1,399 @@
+#include "stdafx.h"
+#include "IO/MeshletBuilder.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+    constexpr uint32_t KD_LEAF_SIZE = 8;
+    constexpr uint32_t KD_LEAF_AXIS = 3;
+
+    // Below this the normals spread too far for the cone to ever reject the meshlet
+    constexpr float MIN_CONE_DOT = 0.1f;
+
+    const XMFLOAT3& GetPosition(const XMFLOAT3* positions, size_t strideBytes, uint32_t index)
+    {
+        return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + index * strideBytes);
+    }
+
+    float GetComponent(const XMFLOAT3& v, uint32_t axis)
+    {
+        return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+    }
+
+    float DistanceSquared(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        float dx = a.x - b.x;
+        float dy = a.y - b.y;
+        float dz = a.z - b.z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    // Triangle centroids in a kd-tree, used to find the nearest unused triangle when a meshlet runs out of neighbours
+    class TriangleKdTree
+    {
+    public:
+        TriangleKdTree(const std::vector<XMFLOAT3>& centroids)
+            : m_centroids(centroids)
+        {
+            m_items.resize(centroids.size());
+            std::iota(m_items.begin(), m_items.end(), 0u);
+            m_nodes.reserve(centroids.size() / KD_LEAF_SIZE * 2 + 1);
+            BuildNode(0, static_cast<uint32_t>(m_items.size()));
+        }
+
+        uint32_t FindNearest(const XMFLOAT3& point, const std::vector<uint8_t>& emitted) const
+        {
+            uint32_t best = INVALID_INDEX;
+            float bestDistance = FLT_MAX;
+            if (!m_nodes.empty())
+            {
+                Search(0, point, emitted, best, bestDistance);
+            }
+            return best;
+        }
+
+    private:
+        struct Node
+        {
+            float split = 0.0f;
+            uint32_t axis = KD_LEAF_AXIS;
+            // Leaves: item range. Inner nodes: the left child follows the node, first is the right child
+            uint32_t first = 0;
+            uint32_t count = 0;
+        };
+
+        uint32_t BuildNode(uint32_t begin, uint32_t end)
+        {
+            uint32_t nodeIndex = static_cast<uint32_t>(m_nodes.size());
+            m_nodes.emplace_back();
+
+            if (end - begin <= KD_LEAF_SIZE)
+            {
+                m_nodes[nodeIndex].first = begin;
+                m_nodes[nodeIndex].count = end - begin;
+                return nodeIndex;
+            }
+
+            AABB bounds;
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                bounds.Expand(m_centroids[m_items[i]]);
+            }
+
+            XMFLOAT3 extents = bounds.GetExtents();
+            uint32_t axis = extents.x >= extents.y && extents.x >= extents.z ? 0 : (extents.y >= extents.z ? 1 : 2);
+
+            uint32_t middle = begin + (end - begin) / 2;
+            std::nth_element(m_items.begin() + begin, m_items.begin() + middle, m_items.begin() + end, [&](uint32_t a, uint32_t b)
+            {
+                return GetComponent(m_centroids[a], axis) < GetComponent(m_centroids[b], axis);
+            });
+
+            float split = GetComponent(m_centroids[m_items[middle]], axis);
+            BuildNode(begin, middle);
+            uint32_t right = BuildNode(middle, end);
+
+            m_nodes[nodeIndex].axis = axis;
+            m_nodes[nodeIndex].split = split;
+            m_nodes[nodeIndex].first = right;
+            return nodeIndex;
+        }
+
+        void Search(uint32_t nodeIndex, const XMFLOAT3& point, const std::vector<uint8_t>& emitted, uint32_t& best, float& bestDistance) const
+        {
+            const Node& node = m_nodes[nodeIndex];
+            if (node.axis == KD_LEAF_AXIS)
+            {
+                for (uint32_t i = node.first; i < node.first + node.count; ++i)
+                {
+                    uint32_t triangle = m_items[i];
+                    if (emitted[triangle])
+                    {
+                        continue;
+                    }
+
+                    float distance = DistanceSquared(point, m_centroids[triangle]);
+                    if (distance < bestDistance)
+                    {
+                        best = triangle;
+                        bestDistance = distance;
+                    }
+                }
+                return;
+            }
+
+            float delta = GetComponent(point, node.axis) - node.split;
+            uint32_t nearChild = delta < 0.0f ? nodeIndex + 1 : node.first;
+            uint32_t farChild = delta < 0.0f ? node.first : nodeIndex + 1;
+
+            Search(nearChild, point, emitted, best, bestDistance);
+            if (delta * delta < bestDistance)
+            {
+                Search(farChild, point, emitted, best, bestDistance);
+            }
+        }
+
+        const std::vector<XMFLOAT3>& m_centroids;
+        std::vector<uint32_t> m_items;
+        std::vector<Node> m_nodes;
+    };
+}
+
+MeshletBuilder::MeshletBuilder(uint32_t maxVertices, uint32_t maxTriangles)
+{
+    SetLimits(maxVertices, maxTriangles);
+}
+
+void MeshletBuilder::SetLimits(uint32_t maxVertices, uint32_t maxTriangles)
+{
+    assertm(maxVertices >= 3 && maxVertices <= MAX_VERTICES_LIMIT, "Meshlet vertex limit must fit 8-bit local indices");
+    assertm(maxTriangles >= 1 && maxTriangles <= MAX_TRIANGLES_LIMIT, "Meshlet triangle limit out of range");
+
+    m_maxVertices = maxVertices;
+    m_maxTriangles = maxTriangles;
+}
+
+void MeshletBuilder::Build(const XMFLOAT3* positions, size_t vertexCount, size_t strideBytes,
+    const uint32_t* indices, size_t indexCount, MeshletData& outData) const
+{
+    assertm(indexCount % 3 == 0, "MeshletBuilder::Build expects a triangle list");
+    assertm(vertexCount < INVALID_INDEX && indexCount / 3 < INVALID_INDEX, "MeshletBuilder::Build input exceeds 32-bit range");
+
+    outData.Clear();
+
+    const uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Vertex to triangle adjacency in compressed rows
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        assert(indices[i] < vertexCount);
+        adjacencyOffsets[indices[i] + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+
+    std::vector<uint32_t> adjacency(indexCount);
+    std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            adjacency[adjacencyFill[indices[t * 3 + k]]++] = t;
+        }
+    }
+
+    std::vector<XMFLOAT3> centroids(triangleCount);
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        const XMFLOAT3& p0 = GetPosition(positions, strideBytes, indices[t * 3 + 0]);
+        const XMFLOAT3& p1 = GetPosition(positions, strideBytes, indices[t * 3 + 1]);
+        const XMFLOAT3& p2 = GetPosition(positions, strideBytes, indices[t * 3 + 2]);
+        centroids[t] = XMFLOAT3((p0.x + p1.x + p2.x) / 3.0f, (p0.y + p1.y + p2.y) / 3.0f, (p0.z + p1.z + p2.z) / 3.0f);
+    }
+
+    TriangleKdTree kdTree(centroids);
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> localIndex(vertexCount, INVALID_INDEX);
+
+    outData.meshlets.reserve(triangleCount / m_maxTriangles + 1);
+    outData.vertices.reserve(indexCount / 2);
+    outData.triangles.reserve(indexCount);
+
+    Meshlet meshlet;
+    XMFLOAT3 centroidSum = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    XMFLOAT3 searchCenter = centroids[0];
+
+    auto countNewVertices = [&](uint32_t triangle)
+    {
+        uint32_t a = indices[triangle * 3 + 0];
+        uint32_t b = indices[triangle * 3 + 1];
+        uint32_t c = indices[triangle * 3 + 2];
+        return (localIndex[a] == INVALID_INDEX ? 1u : 0u) +
+            (localIndex[b] == INVALID_INDEX && b != a ? 1u : 0u) +
+            (localIndex[c] == INVALID_INDEX && c != a && c != b ? 1u : 0u);
+    };
+
+    auto finishMeshlet = [&]()
+    {
+        for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+        {
+            localIndex[outData.vertices[meshlet.vertexOffset + i]] = INVALID_INDEX;
+        }
+
+        ComputeBounds(positions, strideBytes, outData, meshlet);
+        outData.meshlets.push_back(meshlet);
+
+        meshlet = Meshlet();
+        meshlet.vertexOffset = static_cast<uint32_t>(outData.vertices.size());
+        meshlet.triangleOffset = static_cast<uint32_t>(outData.triangles.size());
+        centroidSum = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    };
+
+    for (uint32_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        if (meshlet.triangleCount == m_maxTriangles)
+        {
+            finishMeshlet();
+        }
+
+        // Neighbours of the meshlet that still fit, fewest new vertices first, then closest to the centre
+        uint32_t best = INVALID_INDEX;
+        uint32_t bestNewVertices = 4;
+        float bestDistance = FLT_MAX;
+        for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+        {
+            uint32_t vertex = outData.vertices[meshlet.vertexOffset + i];
+            for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; ++a)
+            {
+                uint32_t triangle = adjacency[a];
+                if (emitted[triangle])
+                {
+                    continue;
+                }
+
+                uint32_t newVertices = countNewVertices(triangle);
+                if (meshlet.vertexCount + newVertices > m_maxVertices)
+                {
+                    continue;
+                }
+
+                float distance = DistanceSquared(centroids[triangle], searchCenter);
+                if (newVertices < bestNewVertices || (newVertices == bestNewVertices && distance < bestDistance))
+                {
+                    best = triangle;
+                    bestNewVertices = newVertices;
+                    bestDistance = distance;
+                }
+            }
+        }
+
+        if (best == INVALID_INDEX)
+        {
+            best = kdTree.FindNearest(searchCenter, emitted);
+            assert(best != INVALID_INDEX);
+
+            if (meshlet.vertexCount + countNewVertices(best) > m_maxVertices)
+            {
+                finishMeshlet();
+            }
+        }
+
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            uint32_t vertex = indices[best * 3 + k];
+            if (localIndex[vertex] == INVALID_INDEX)
+            {
+                localIndex[vertex] = meshlet.vertexCount++;
+                outData.vertices.push_back(vertex);
+            }
+            outData.triangles.push_back(static_cast<uint8_t>(localIndex[vertex]));
+        }
+
+        emitted[best] = 1;
+        meshlet.triangleCount++;
+
+        centroidSum.x += centroids[best].x;
+        centroidSum.y += centroids[best].y;
+        centroidSum.z += centroids[best].z;
+        float inverseCount = 1.0f / meshlet.triangleCount;
+        searchCenter = XMFLOAT3(centroidSum.x * inverseCount, centroidSum.y * inverseCount, centroidSum.z * inverseCount);
+    }
+
+    if (meshlet.triangleCount > 0)
+    {
+        finishMeshlet();
+    }
+}
+
+void MeshletBuilder::ComputeBounds(const XMFLOAT3* positions, size_t strideBytes, const MeshletData& data, Meshlet& meshlet)
+{
+    std::vector<XMFLOAT3> points(meshlet.vertexCount);
+    for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+    {
+        points[i] = GetPosition(positions, strideBytes, data.vertices[meshlet.vertexOffset + i]);
+    }
+
+    meshlet.boundingSphere = ComputeBoundingSphere(points.data(), points.size());
+
+    struct Face
+    {
+        XMFLOAT3 normal;
+        XMFLOAT3 point;
+    };
+
+    // Average of the unit face normals, degenerate triangles do not vote
+    std::vector<Face> faces;
+    faces.reserve(meshlet.triangleCount);
+    XMVECTOR normalSum = XMVectorZero();
+    for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+    {
+        const uint8_t* triangle = &data.triangles[meshlet.triangleOffset + t * 3];
+        XMVECTOR p0 = XMLoadFloat3(&points[triangle[0]]);
+        XMVECTOR p1 = XMLoadFloat3(&points[triangle[1]]);
+        XMVECTOR p2 = XMLoadFloat3(&points[triangle[2]]);
+
+        XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+        float length = XMVectorGetX(XMVector3Length(normal));
+        if (length <= 0.0f)
+        {
+            continue;
+        }
+
+        normal = XMVectorScale(normal, 1.0f / length);
+        normalSum = XMVectorAdd(normalSum, normal);
+
+        Face face;
+        XMStoreFloat3(&face.normal, normal);
+        face.point = points[triangle[0]];
+        faces.push_back(face);
+    }
+
+    meshlet.coneApex = meshlet.boundingSphere.center;
+    meshlet.coneAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    meshlet.coneCutoff = 1.0f;
+
+    float sumLength = XMVectorGetX(XMVector3Length(normalSum));
+    if (faces.empty() || sumLength <= 0.0f)
+    {
+        return;
+    }
+
+    XMVECTOR axis = XMVectorScale(normalSum, 1.0f / sumLength);
+    XMStoreFloat3(&meshlet.coneAxis, axis);
+
+    float minDot = 1.0f;
+    for (const Face& face : faces)
+    {
+        minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&face.normal), axis)));
+    }
+
+    if (minDot <= MIN_CONE_DOT)
+    {
+        return;
+    }
+
+    // Slide the apex back along the axis until it lies behind every triangle plane, so the test stays valid
+    // for viewers close to the meshlet
+    XMVECTOR center = XMLoadFloat3(&meshlet.boundingSphere.center);
+    float maxOffset = 0.0f;
+    for (const Face& face : faces)
+    {
+        XMVECTOR normal = XMLoadFloat3(&face.normal);
+        float centerDistance = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, XMLoadFloat3(&face.point)), normal));
+        float axisDot = XMVectorGetX(XMVector3Dot(axis, normal));
+        maxOffset = std::max(maxOffset, centerDistance / axisDot);
+    }
+
+    XMStoreFloat3(&meshlet.coneApex, XMVectorSubtract(center, XMVectorScale(axis, maxOffset)));
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include <vector>
+#include <cstdint>
+
+struct Meshlet
+{
+    // First entry in MeshletData::vertices
+    uint32_t vertexOffset = 0;
+    // First entry in MeshletData::triangles, three entries per triangle
+    uint32_t triangleOffset = 0;
+    uint32_t vertexCount = 0;
+    uint32_t triangleCount = 0;
+
+    Sphere boundingSphere;
+
+    // Every triangle is back facing for a viewer at p when dot(normalize(coneApex - p), coneAxis) >= coneCutoff.
+    // Meshlets whose normals spread too far get a cutoff of 1 and are effectively never cone culled.
+    XMFLOAT3 coneApex = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    XMFLOAT3 coneAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    float coneCutoff = 1.0f;
+};
+
+struct MeshletData
+{
+    std::vector<Meshlet> meshlets;
+    // Mesh vertex index of every meshlet local vertex
+    std::vector<uint32_t> vertices;
+    // Meshlet local vertex indices, three per triangle
+    std::vector<uint8_t> triangles;
+
+    void Clear()
+    {
+        meshlets.clear();
+        vertices.clear();
+        triangles.clear();
+    }
+};
+
+// Splits an indexed triangle list into meshlets for cluster culling.
+// Meshlets grow greedily from a seed triangle, preferring neighbours that add the fewest new vertices and then the
+// ones closest to the meshlet centre. When no neighbour fits, the nearest unused triangle continues the meshlet.
+class MeshletBuilder
+{
+public:
+    static constexpr uint32_t DEFAULT_MAX_VERTICES = 64;
+    static constexpr uint32_t DEFAULT_MAX_TRIANGLES = 124;
+
+    // Local indices are stored in 8 bits
+    static constexpr uint32_t MAX_VERTICES_LIMIT = 256;
+    static constexpr uint32_t MAX_TRIANGLES_LIMIT = 512;
+
+    MeshletBuilder(uint32_t maxVertices = DEFAULT_MAX_VERTICES, uint32_t maxTriangles = DEFAULT_MAX_TRIANGLES);
+
+    void SetLimits(uint32_t maxVertices, uint32_t maxTriangles);
+    uint32_t GetMaxVertices() const { return m_maxVertices; }
+    uint32_t GetMaxTriangles() const { return m_maxTriangles; }
+
+    // positions is a strided array so vertices can be read straight out of interleaved vertex data
+    void Build(const XMFLOAT3* positions, size_t vertexCount, size_t strideBytes,
+        const uint32_t* indices, size_t indexCount, MeshletData& outData) const;
+
+    // Fills the bounding sphere and normal cone of a meshlet whose vertices and triangles are already in data
+    static void ComputeBounds(const XMFLOAT3* positions, size_t strideBytes, const MeshletData& data, Meshlet& meshlet);
+
+private:
+    uint32_t m_maxVertices = DEFAULT_MAX_VERTICES;
+    uint32_t m_maxTriangles = DEFAULT_MAX_TRIANGLES;
+};
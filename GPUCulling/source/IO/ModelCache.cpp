@@ -0,0 +1,542 @@
+#include "stdafx.h"
+#include "IO/ModelCache.h"
+#include "IO/VertexPacking.h"
+#include "System/Hash.h"
+
+#include <fstream>
+#include <type_traits>
+
+using namespace ModelCacheFormat;
+
+static_assert(std::is_trivially_copyable_v<VertexData>, "VertexData is stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<Meshlet>, "Meshlet is stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<MeshRecord>, "MeshRecord is stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<MaterialRecord>, "MaterialRecord is stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<MeshInstance>, "MeshInstance is stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<ShaderInterop::QuantizedVertex>, "QuantizedVertex is stored as raw bytes");
+// The records are written as raw bytes, any change to their layout needs a VERSION bump
+static_assert(sizeof(Header) == 128 && sizeof(MeshRecord) == 232 && sizeof(MaterialRecord) == 104 && sizeof(LODRecord) == 16 &&
+    sizeof(DependencyRecord) == 32, "Cooked model record layout changed");
+
+namespace
+{
+    // Every piece of the file in write order, offsets are assigned before anything is written
+    struct Chunk
+    {
+        uint64_t offset;
+        const void* data;
+        uint64_t size;
+    };
+
+    class FileLayout
+    {
+    public:
+        Range Add(const void* data, uint64_t count, uint64_t elementSize, uint64_t alignment = ALIGNMENT)
+        {
+            // Empty arrays take no space and keep offset 0
+            Range range;
+            if (count == 0)
+            {
+                return range;
+            }
+
+            range.offset = (m_size + alignment - 1) / alignment * alignment;
+            range.count = count;
+            m_chunks.push_back({ range.offset, data, count * elementSize });
+            m_size = range.offset + count * elementSize;
+            return range;
+        }
+
+        template<typename T>
+        Range Add(const std::vector<T>& values)
+        {
+            return Add(values.data(), values.size(), sizeof(T));
+        }
+
+        Range AddString(const std::string& value)
+        {
+            return Add(value.data(), value.size(), 1, 1);
+        }
+
+        uint64_t GetSize() const { return m_size; }
+        const std::vector<Chunk>& GetChunks() const { return m_chunks; }
+
+    private:
+        std::vector<Chunk> m_chunks;
+        uint64_t m_size = 0;
+    };
+
+    bool IsRangeValid(const Range& range, uint64_t elementSize, uint64_t alignment, uint64_t fileSize)
+    {
+        if (range.offset % alignment != 0 || range.offset > fileSize)
+        {
+            return false;
+        }
+        return range.count <= (fileSize - range.offset) / elementSize;
+    }
+
+    template<typename T>
+    bool IsArrayValid(const Range& range, uint64_t fileSize)
+    {
+        return IsRangeValid(range, sizeof(T), alignof(T), fileSize);
+    }
+
+    bool IsStringValid(const Range& range, uint64_t fileSize)
+    {
+        return IsRangeValid(range, 1, 1, fileSize);
+    }
+
+    // Branch free so the scan vectorizes, it runs over every index of the file
+    bool AreIndicesValid(std::span<const uint32_t> indices, uint64_t vertexCount)
+    {
+        uint32_t maxIndex = 0;
+        for (uint32_t index : indices)
+        {
+            maxIndex = std::max(maxIndex, index);
+        }
+        return indices.empty() || maxIndex < vertexCount;
+    }
+
+    bool AreMeshletsValid(std::span<const Meshlet> meshlets, std::span<const uint8_t> triangles, uint64_t meshletVertexCount)
+    {
+        for (const Meshlet& meshlet : meshlets)
+        {
+            if (meshlet.vertexOffset > meshletVertexCount || meshlet.vertexCount > meshletVertexCount - meshlet.vertexOffset ||
+                meshlet.triangleOffset > triangles.size() || meshlet.triangleCount > (triangles.size() - meshlet.triangleOffset) / 3)
+            {
+                return false;
+            }
+
+            uint8_t maxIndex = 0;
+            for (uint8_t index : triangles.subspan(meshlet.triangleOffset, size_t(meshlet.triangleCount) * 3))
+            {
+                maxIndex = std::max(maxIndex, index);
+            }
+            if (meshlet.triangleCount > 0 && maxIndex >= meshlet.vertexCount)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool CookedModel::Open(const std::string& filePath, const ModelCacheKey& key)
+{
+    return Open(filePath, &key);
+}
+
+bool CookedModel::Open(const std::string& filePath)
+{
+    return Open(filePath, nullptr);
+}
+
+bool CookedModel::Open(const std::string& filePath, const ModelCacheKey* key)
+{
+    Close();
+
+    if (!m_file.Open(filePath) || m_file.GetSize() < sizeof(Header))
+    {
+        m_file.Close();
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(m_file.GetData());
+    if (header->magic != MAGIC || header->version != VERSION || header->fileSize != m_file.GetSize() ||
+        (key && !(header->key == *key)))
+    {
+        m_file.Close();
+        return false;
+    }
+
+    m_header = header;
+    if (!Validate() || (key && !AreDependenciesCurrent()))
+    {
+        Close();
+        return false;
+    }
+
+    m_meshes = GetArray<MeshRecord>(m_header->meshes);
+    m_materials = GetArray<MaterialRecord>(m_header->materials);
+    m_instances = GetArray<MeshInstance>(m_header->instances);
+    return true;
+}
+
+void CookedModel::Close()
+{
+    m_file.Close();
+    m_header = nullptr;
+    m_meshes = {};
+    m_materials = {};
+    m_instances = {};
+}
+
+// Checks that every range lies inside the file, so the accessors never read past the mapping, and that every index
+// stays inside its vertex range, an out of range index would read past the vertex buffer on the GPU. Only the index
+// arrays are scanned, the vertex data is left unmapped until it is used.
+bool CookedModel::Validate() const
+{
+    uint64_t fileSize = m_file.GetSize();
+    if (!IsArrayValid<MeshRecord>(m_header->meshes, fileSize) || !IsArrayValid<MaterialRecord>(m_header->materials, fileSize) ||
+        !IsArrayValid<MeshInstance>(m_header->instances, fileSize) || !IsArrayValid<DependencyRecord>(m_header->dependencies, fileSize))
+    {
+        return false;
+    }
+
+    for (const DependencyRecord& dependency : GetArray<DependencyRecord>(m_header->dependencies))
+    {
+        if (!IsStringValid(dependency.path, fileSize))
+        {
+            return false;
+        }
+    }
+
+    // The instance table is small next to the geometry, checking it keeps every mesh index safe to follow
+    for (const MeshInstance& instance : GetArray<MeshInstance>(m_header->instances))
+    {
+        if (instance.meshIndex >= m_header->meshes.count)
+        {
+            return false;
+        }
+    }
+
+    for (const MeshRecord& mesh : GetArray<MeshRecord>(m_header->meshes))
+    {
+        if (mesh.indexFormat >= INDEX_FORMAT_COUNT ||
+            !IsStringValid(mesh.name, fileSize) ||
+            !IsArrayValid<VertexData>(mesh.vertices, fileSize) ||
+            !IsArrayValid<uint32_t>(mesh.indices, fileSize) ||
+            !IsArrayValid<Meshlet>(mesh.meshlets, fileSize) ||
+            !IsArrayValid<uint32_t>(mesh.meshletVertices, fileSize) ||
+            !IsArrayValid<uint8_t>(mesh.meshletTriangles, fileSize) ||
+            !IsArrayValid<LODRecord>(mesh.lods, fileSize) ||
+            !IsArrayValid<uint32_t>(mesh.lodIndices, fileSize) ||
+            !IsArrayValid<ShaderInterop::QuantizedVertex>(mesh.quantizedVertices, fileSize) ||
+            (mesh.vertices.count != 0 && mesh.quantizedVertices.count != 0) ||
+            std::max(mesh.vertices.count, mesh.quantizedVertices.count) != mesh.vertexCount ||
+            (mesh.indexFormat == uint32_t(IndexFormat::UInt16) && mesh.vertexCount > MAX_UINT16_INDEX_VERTICES))
+        {
+            return false;
+        }
+
+        if (!AreIndicesValid(GetArray<uint32_t>(mesh.indices), mesh.vertexCount) ||
+            !AreIndicesValid(GetArray<uint32_t>(mesh.lodIndices), mesh.vertexCount) ||
+            !AreIndicesValid(GetArray<uint32_t>(mesh.meshletVertices), mesh.vertexCount) ||
+            !AreMeshletsValid(GetArray<Meshlet>(mesh.meshlets), GetArray<uint8_t>(mesh.meshletTriangles), mesh.meshletVertices.count))
+        {
+            return false;
+        }
+
+        for (const LODRecord& lod : GetArray<LODRecord>(mesh.lods))
+        {
+            if (lod.firstIndex > mesh.lodIndices.count || lod.indexCount > mesh.lodIndices.count - lod.firstIndex)
+            {
+                return false;
+            }
+        }
+    }
+
+    for (const MaterialRecord& material : GetArray<MaterialRecord>(m_header->materials))
+    {
+        if (!IsStringValid(material.name, fileSize) ||
+            !IsStringValid(material.diffuseTexture, fileSize) ||
+            !IsStringValid(material.normalTexture, fileSize) ||
+            !IsStringValid(material.specularTexture, fileSize))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CookedModel::AreDependenciesCurrent() const
+{
+    for (const DependencyRecord& record : GetArray<DependencyRecord>(m_header->dependencies))
+    {
+        ModelDependency dependency;
+        if (!GetModelDependency(std::string(GetString(record.path)), dependency) || dependency.size != record.size ||
+            dependency.writeTime != record.writeTime)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view CookedModel::GetString(const Range& range) const
+{
+    return std::string_view(reinterpret_cast<const char*>(m_file.GetData() + range.offset), static_cast<size_t>(range.count));
+}
+
+CookedMesh CookedModel::GetMesh(size_t meshIndex) const
+{
+    assertm(meshIndex < m_meshes.size(), "CookedModel::GetMesh called with an out of range mesh index");
+
+    const MeshRecord& record = m_meshes[meshIndex];
+
+    CookedMesh mesh;
+    mesh.name = GetString(record.name);
+    mesh.materialIndex = record.materialIndex;
+    mesh.indexFormat = static_cast<IndexFormat>(record.indexFormat);
+    mesh.bounds = record.bounds;
+    mesh.boundingSphere = record.boundingSphere;
+    mesh.vertexCount = record.vertexCount;
+    mesh.vertices = GetArray<VertexData>(record.vertices);
+    mesh.indices = GetArray<uint32_t>(record.indices);
+    mesh.meshlets = GetArray<Meshlet>(record.meshlets);
+    mesh.meshletVertices = GetArray<uint32_t>(record.meshletVertices);
+    mesh.meshletTriangles = GetArray<uint8_t>(record.meshletTriangles);
+    mesh.lods = GetArray<LODRecord>(record.lods);
+    mesh.lodIndices = GetArray<uint32_t>(record.lodIndices);
+    mesh.quantizedVertices = GetArray<ShaderInterop::QuantizedVertex>(record.quantizedVertices);
+    mesh.quantization = record.quantization;
+    return mesh;
+}
+
+CookedMaterial CookedModel::GetMaterial(size_t materialIndex) const
+{
+    assertm(materialIndex < m_materials.size(), "CookedModel::GetMaterial called with an out of range material index");
+
+    const MaterialRecord& record = m_materials[materialIndex];
+
+    CookedMaterial material;
+    material.name = GetString(record.name);
+    material.diffuse = record.diffuse;
+    material.specular = record.specular;
+    material.ambient = record.ambient;
+    material.shininess = record.shininess;
+    material.diffuseTexture = GetString(record.diffuseTexture);
+    material.normalTexture = GetString(record.normalTexture);
+    material.specularTexture = GetString(record.specularTexture);
+    return material;
+}
+
+std::unique_ptr<ModelData> CookedModel::ToModelData() const
+{
+    assertm(IsOpen(), "CookedModel::ToModelData called without an open file");
+
+    auto model = std::make_unique<ModelData>();
+    model->meshes.resize(m_meshes.size());
+
+    for (size_t i = 0; i < m_meshes.size(); ++i)
+    {
+        CookedMesh cooked = GetMesh(i);
+        MeshData& mesh = model->meshes[i];
+
+        mesh.name = cooked.name;
+        mesh.materialIndex = cooked.materialIndex;
+        mesh.indexFormat = cooked.indexFormat;
+        mesh.bounds = cooked.bounds;
+        mesh.boundingSphere = cooked.boundingSphere;
+        if (!cooked.vertices.empty())
+        {
+            mesh.vertices.assign(cooked.vertices.begin(), cooked.vertices.end());
+        }
+        else
+        {
+            // Only the quantized stream was cooked, the full precision one is decoded from it
+            mesh.vertices.resize(cooked.vertexCount);
+            for (uint32_t vertex = 0; vertex < cooked.vertexCount; ++vertex)
+            {
+                mesh.vertices[vertex] = UnpackVertex(cooked.quantizedVertices[vertex], cooked.quantization);
+            }
+        }
+        mesh.indices.assign(cooked.indices.begin(), cooked.indices.end());
+        mesh.meshletData.meshlets.assign(cooked.meshlets.begin(), cooked.meshlets.end());
+        mesh.meshletData.vertices.assign(cooked.meshletVertices.begin(), cooked.meshletVertices.end());
+        mesh.meshletData.triangles.assign(cooked.meshletTriangles.begin(), cooked.meshletTriangles.end());
+
+        mesh.lods.resize(cooked.lods.size());
+        for (uint32_t lod = 1; lod < cooked.GetLODCount(); ++lod)
+        {
+            std::span<const uint32_t> indices = cooked.GetLODIndices(lod);
+            mesh.lods[lod - 1].indices.assign(indices.begin(), indices.end());
+            mesh.lods[lod - 1].error = cooked.GetLODError(lod);
+        }
+
+        mesh.quantizedVertices.assign(cooked.quantizedVertices.begin(), cooked.quantizedVertices.end());
+        mesh.quantization = cooked.quantization;
+    }
+
+    model->materials.resize(m_materials.size());
+    for (size_t i = 0; i < m_materials.size(); ++i)
+    {
+        CookedMaterial cooked = GetMaterial(i);
+        MaterialData& material = model->materials[i];
+
+        material.name = cooked.name;
+        material.diffuse = cooked.diffuse;
+        material.specular = cooked.specular;
+        material.ambient = cooked.ambient;
+        material.shininess = cooked.shininess;
+        material.diffuseTexture = cooked.diffuseTexture;
+        material.normalTexture = cooked.normalTexture;
+        material.specularTexture = cooked.specularTexture;
+    }
+
+    model->instances.assign(m_instances.begin(), m_instances.end());
+    model->boundingBoxMin = m_header->boundingBoxMin;
+    model->boundingBoxMax = m_header->boundingBoxMax;
+    return model;
+}
+
+bool ComputeModelCacheKey(const std::string& sourcePath, uint64_t settingsHash, ModelCacheKey& outKey)
+{
+    MappedFile source;
+    if (!source.Open(sourcePath))
+    {
+        return false;
+    }
+
+    outKey.sourceHash = HashBytes(source.GetData(), source.GetSize());
+    outKey.sourceSize = source.GetSize();
+    outKey.settingsHash = settingsHash;
+    return true;
+}
+
+bool GetModelDependency(const std::string& path, ModelDependency& outDependency)
+{
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(path, error);
+    if (error)
+    {
+        return false;
+    }
+    std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+    if (error)
+    {
+        return false;
+    }
+
+    outDependency.path = path;
+    outDependency.size = size;
+    outDependency.writeTime = static_cast<int64_t>(writeTime.time_since_epoch().count());
+    return true;
+}
+
+bool WriteCookedModel(const std::string& filePath, const ModelData& model, const ModelCacheKey& key,
+    const std::vector<ModelDependency>& dependencies)
+{
+    Header header;
+    header.key = key;
+    header.boundingBoxMin = model.boundingBoxMin;
+    header.boundingBoxMax = model.boundingBoxMax;
+
+    std::vector<MeshRecord> meshRecords(model.meshes.size());
+    std::vector<MaterialRecord> materialRecords(model.materials.size());
+    // LOD indices are concatenated per mesh so each mesh needs a single range for them
+    std::vector<std::vector<LODRecord>> lodRecords(model.meshes.size());
+    std::vector<std::vector<uint32_t>> lodIndices(model.meshes.size());
+    std::vector<DependencyRecord> dependencyRecords(dependencies.size());
+
+    FileLayout layout;
+    layout.Add(&header, 1, sizeof(Header));
+    header.meshes = layout.Add(meshRecords);
+    header.materials = layout.Add(materialRecords);
+    header.instances = layout.Add(model.instances);
+    header.dependencies = layout.Add(dependencyRecords);
+
+    for (size_t i = 0; i < model.meshes.size(); ++i)
+    {
+        const MeshData& mesh = model.meshes[i];
+        MeshRecord& record = meshRecords[i];
+
+        for (const MeshLOD& lod : mesh.lods)
+        {
+            LODRecord lodRecord;
+            lodRecord.firstIndex = static_cast<uint32_t>(lodIndices[i].size());
+            lodRecord.indexCount = static_cast<uint32_t>(lod.indices.size());
+            lodRecord.error = lod.error;
+            lodRecords[i].push_back(lodRecord);
+            lodIndices[i].insert(lodIndices[i].end(), lod.indices.begin(), lod.indices.end());
+        }
+
+        record.materialIndex = mesh.materialIndex;
+        record.indexFormat = static_cast<uint32_t>(mesh.indexFormat);
+        record.bounds = mesh.bounds;
+        record.boundingSphere = mesh.boundingSphere;
+        record.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        // The quantized vertices are all the runtime draws, the full precision stream would only double the file
+        if (mesh.quantizedVertices.empty())
+        {
+            record.vertices = layout.Add(mesh.vertices);
+        }
+        record.indices = layout.Add(mesh.indices);
+        record.meshlets = layout.Add(mesh.meshletData.meshlets);
+        record.meshletVertices = layout.Add(mesh.meshletData.vertices);
+        record.meshletTriangles = layout.Add(mesh.meshletData.triangles);
+        record.lods = layout.Add(lodRecords[i]);
+        record.lodIndices = layout.Add(lodIndices[i]);
+        record.quantizedVertices = layout.Add(mesh.quantizedVertices);
+        record.quantization = mesh.quantization;
+    }
+
+    // Strings go last so the arrays above stay densely packed
+    for (size_t i = 0; i < model.meshes.size(); ++i)
+    {
+        meshRecords[i].name = layout.AddString(model.meshes[i].name);
+    }
+
+    for (size_t i = 0; i < model.materials.size(); ++i)
+    {
+        const MaterialData& material = model.materials[i];
+        MaterialRecord& record = materialRecords[i];
+
+        record.name = layout.AddString(material.name);
+        record.diffuse = material.diffuse;
+        record.specular = material.specular;
+        record.ambient = material.ambient;
+        record.shininess = material.shininess;
+        record.diffuseTexture = layout.AddString(material.diffuseTexture);
+        record.normalTexture = layout.AddString(material.normalTexture);
+        record.specularTexture = layout.AddString(material.specularTexture);
+    }
+
+    for (size_t i = 0; i < dependencies.size(); ++i)
+    {
+        dependencyRecords[i].path = layout.AddString(dependencies[i].path);
+        dependencyRecords[i].size = dependencies[i].size;
+        dependencyRecords[i].writeTime = dependencies[i].writeTime;
+    }
+
+    header.fileSize = layout.GetSize();
+
+    std::filesystem::path finalPath(filePath);
+    std::filesystem::path tempPath = finalPath;
+    tempPath += ".tmp";
+
+    {
+        std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+        if (!stream)
+        {
+            return false;
+        }
+
+        static const char zeros[ALIGNMENT] = {};
+        uint64_t position = 0;
+        for (const Chunk& chunk : layout.GetChunks())
+        {
+            stream.write(zeros, static_cast<std::streamsize>(chunk.offset - position));
+            stream.write(static_cast<const char*>(chunk.data), static_cast<std::streamsize>(chunk.size));
+            position = chunk.offset + chunk.size;
+        }
+
+        if (!stream.flush())
+        {
+            stream.close();
+            std::error_code error;
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, finalPath, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "IO/ModelData.h"
+#include "System/MappedFile.h"
+
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Cooked model files hold the ModelData the loader produced as flat, 16 byte aligned arrays behind a small table of
+// records, so a cache hit maps the file and points straight into it instead of running the Assimp import again.
+// The arrays are stored in the in-memory layout of VertexData, Meshlet and friends: the format is only portable
+// between builds sharing that layout and endianness, and VERSION has to change whenever any of them does.
+
+// What a cooked file was built from. A file is only used when every field matches the current source and settings.
+struct ModelCacheKey
+{
+    uint64_t sourceHash = 0;
+    uint64_t sourceSize = 0;
+    // Import flags and every loader setting that changes the output
+    uint64_t settingsHash = 0;
+
+    bool operator==(const ModelCacheKey&) const = default;
+};
+
+// A file besides the source that went into a cooked file: what the importer opened next to it, such as an OBJ's .mtl
+// or a glTF's .bin, and the textures the materials reference. Side files are compared by size and write time rather
+// than hashed, textures alone can outweigh the model many times over and the check runs on every load.
+struct ModelDependency
+{
+    std::string path;
+    uint64_t size = 0;
+    int64_t writeTime = 0;
+};
+
+// Reads the current size and write time of path. Returns false when it is not a regular file.
+bool GetModelDependency(const std::string& path, ModelDependency& outDependency);
+
+namespace ModelCacheFormat
+{
+    static constexpr uint32_t MAGIC = 0x4C444D43; // "CMDL"
+    static constexpr uint32_t VERSION = 7;
+    static constexpr uint64_t ALIGNMENT = 16;
+
+    // Byte offset from the start of the file and element count of one array
+    struct Range
+    {
+        uint64_t offset = 0;
+        uint64_t count = 0;
+    };
+
+    struct Header
+    {
+        uint32_t magic = MAGIC;
+        uint32_t version = VERSION;
+        ModelCacheKey key;
+        XMFLOAT3 boundingBoxMin = {};
+        XMFLOAT3 boundingBoxMax = {};
+        Range meshes;
+        Range materials;
+        Range instances;
+        Range dependencies;
+        // Detects truncated files
+        uint64_t fileSize = 0;
+    };
+
+    // LOD 1 and up, indices live in the mesh's lodIndices array
+    struct LODRecord
+    {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        float error = 0.0f;
+        uint32_t padding = 0;
+    };
+
+    struct DependencyRecord
+    {
+        Range path;
+        uint64_t size = 0;
+        int64_t writeTime = 0;
+    };
+
+    struct MeshRecord
+    {
+        Range name;
+        uint32_t materialIndex = 0;
+        // IndexFormat
+        uint32_t indexFormat = 0;
+        uint32_t vertexCount = 0;
+        AABB bounds;
+        Sphere boundingSphere;
+        uint32_t padding = 0;
+        // Empty when the quantized vertices replace it, otherwise one per vertex
+        Range vertices;
+        Range indices;
+        Range meshlets;
+        Range meshletVertices;
+        Range meshletTriangles;
+        Range lods;
+        Range lodIndices;
+        // Empty or one per vertex, written instead of the full precision vertices
+        Range quantizedVertices;
+        ShaderInterop::BoundsQuantization quantization = {};
+    };
+
+    struct MaterialRecord
+    {
+        Range name;
+        XMFLOAT3 diffuse = {};
+        XMFLOAT3 specular = {};
+        XMFLOAT3 ambient = {};
+        float shininess = 0.0f;
+        Range diffuseTexture;
+        Range normalTexture;
+        Range specularTexture;
+    };
+}
+
+// One mesh of a mapped CookedModel, mirrors MeshData. Every span points into the mapping and is valid for as long as
+// the CookedModel is.
+struct CookedMesh
+{
+    std::string_view name;
+    uint32_t materialIndex = 0;
+    // The indices are stored 32-bit, this is the width they are uploaded with
+    IndexFormat indexFormat = IndexFormat::UInt32;
+    AABB bounds;
+    Sphere boundingSphere;
+
+    // Only one of the two vertex streams is stored, vertices is empty for a mesh cooked with quantized vertices
+    uint32_t vertexCount = 0;
+    std::span<const VertexData> vertices;
+    std::span<const uint32_t> indices;
+
+    std::span<const Meshlet> meshlets;
+    std::span<const uint32_t> meshletVertices;
+    std::span<const uint8_t> meshletTriangles;
+
+    std::span<const ModelCacheFormat::LODRecord> lods;
+    std::span<const uint32_t> lodIndices;
+
+    std::span<const ShaderInterop::QuantizedVertex> quantizedVertices;
+    ShaderInterop::BoundsQuantization quantization = {};
+
+    uint32_t GetVertexCount() const { return vertexCount; }
+    uint32_t GetLODCount() const { return static_cast<uint32_t>(lods.size()) + 1; }
+    float GetLODError(uint32_t lod) const { return lod == 0 ? 0.0f : lods[lod - 1].error; }
+    std::span<const uint32_t> GetLODIndices(uint32_t lod) const
+    {
+        return lod == 0 ? indices : lodIndices.subspan(lods[lod - 1].firstIndex, lods[lod - 1].indexCount);
+    }
+};
+
+struct CookedMaterial
+{
+    std::string_view name;
+    XMFLOAT3 diffuse;
+    XMFLOAT3 specular;
+    XMFLOAT3 ambient;
+    float shininess;
+    std::string_view diffuseTexture;
+    std::string_view normalTexture;
+    std::string_view specularTexture;
+};
+
+// Read only view of a cooked model file. Open validates the header and every record once, after that the accessors
+// only build spans, nothing is copied until ToModelData.
+class CookedModel
+{
+    CookedModel(const CookedModel&) = delete;
+    CookedModel& operator=(const CookedModel&) = delete;
+
+public:
+    CookedModel() = default;
+    ~CookedModel() = default;
+
+    // Fails for missing, truncated or corrupt files, other format versions, files cooked from another key and files
+    // with a dependency that changed or went missing since
+    bool Open(const std::string& filePath, const ModelCacheKey& key);
+    // Same checks without the key and the dependencies, for files cooked ahead of time that ship without their source
+    bool Open(const std::string& filePath);
+    void Close();
+    bool IsOpen() const { return m_header != nullptr; }
+
+    size_t GetMeshCount() const { return m_meshes.size(); }
+    CookedMesh GetMesh(size_t meshIndex) const;
+    size_t GetMaterialCount() const { return m_materials.size(); }
+    CookedMaterial GetMaterial(size_t materialIndex) const;
+    std::span<const MeshInstance> GetInstances() const { return m_instances; }
+
+    const XMFLOAT3& GetBoundingBoxMin() const { return m_header->boundingBoxMin; }
+    const XMFLOAT3& GetBoundingBoxMax() const { return m_header->boundingBoxMax; }
+
+    // Copies everything into a regular ModelData, for callers that own or edit their meshes
+    std::unique_ptr<ModelData> ToModelData() const;
+
+private:
+    // key is null when any key is accepted
+    bool Open(const std::string& filePath, const ModelCacheKey* key);
+    bool Validate() const;
+    bool AreDependenciesCurrent() const;
+
+    template<typename T>
+    std::span<const T> GetArray(const ModelCacheFormat::Range& range) const
+    {
+        return std::span<const T>(reinterpret_cast<const T*>(m_file.GetData() + range.offset), static_cast<size_t>(range.count));
+    }
+
+    std::string_view GetString(const ModelCacheFormat::Range& range) const;
+
+    MappedFile m_file;
+    const ModelCacheFormat::Header* m_header = nullptr;
+    std::span<const ModelCacheFormat::MeshRecord> m_meshes;
+    std::span<const ModelCacheFormat::MaterialRecord> m_materials;
+    std::span<const MeshInstance> m_instances;
+};
+
+// Fingerprints the source file through a mapping. Returns false when it cannot be read.
+bool ComputeModelCacheKey(const std::string& sourcePath, uint64_t settingsHash, ModelCacheKey& outKey);
+
+// Writes model as a cooked file under key and dependencies. The file is written next to filePath first and renamed into place, so an
+// interrupted write never leaves a file behind that Open would accept.
+bool WriteCookedModel(const std::string& filePath, const ModelData& model, const ModelCacheKey& key,
+    const std::vector<ModelDependency>& dependencies = {});
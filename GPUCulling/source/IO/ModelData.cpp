@@ -0,0 +1,18 @@
+#include "stdafx.h"
+#include "IO/ModelData.h"
+
+AABB GetInstanceBounds(const ModelData& model, const MeshInstance& instance)
+{
+    assertm(instance.meshIndex < model.meshes.size(), "GetInstanceBounds called with an out of range mesh index");
+
+    return TransformAABB(model.meshes[instance.meshIndex].bounds, XMLoadFloat4x4(&instance.world));
+}
+
+void GetInstanceBounds(const ModelData& model, std::vector<AABB>& outBounds)
+{
+    outBounds.resize(model.instances.size());
+    for (size_t i = 0; i < model.instances.size(); ++i)
+    {
+        outBounds[i] = GetInstanceBounds(model, model.instances[i]);
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <DirectXMath.h>
+
+#include "Culling/Bounds.h"
+#include "IO/IndexFormat.h"
+#include "IO/MeshletBuilder.h"
+#include "Shaders/PackedVertexShared.h"
+
+// In-memory form of an imported model. ModelLoader fills it from Assimp in the asset cooker, CookedModel mirrors it
+// as views into a cooked file at runtime.
+
+using namespace DirectX;
+
+struct VertexData
+{
+    XMFLOAT3 position;
+    XMFLOAT3 normal;
+    XMFLOAT2 texCoord;
+    XMFLOAT3 tangent;
+    XMFLOAT3 bitangent;
+};
+
+// One simplified level of a mesh. Indices reference the mesh's own vertex buffer.
+struct MeshLOD
+{
+    std::vector<uint32_t> indices;
+    // Bound on the object space distance to the full resolution surface, in world units
+    float error = 0.0f;
+};
+
+struct MeshData
+{
+    std::vector<VertexData> vertices;
+    std::vector<uint32_t> indices;
+    std::string name;
+    uint32_t materialIndex = 0;
+    // GPU index width of indices and every LOD, chosen at import from the vertex count
+    IndexFormat indexFormat = IndexFormat::UInt32;
+
+    // Object space bounds, built while the vertices are imported
+    AABB bounds;
+    Sphere boundingSphere;
+
+    // Cluster split of the triangle list for fine grained culling
+    MeshletData meshletData;
+
+    // Coarser levels with increasing error. LOD 0 is indices itself with zero error.
+    std::vector<MeshLOD> lods;
+
+    // Vertices in the 20 byte QuantizedVertex layout, positions quantized to the mesh bounds. Empty unless the loader
+    // quantizes vertices.
+    std::vector<ShaderInterop::QuantizedVertex> quantizedVertices;
+    ShaderInterop::BoundsQuantization quantization = {};
+
+    uint32_t GetVertexCount() const { return static_cast<uint32_t>(vertices.size()); }
+    uint32_t GetLODCount() const { return static_cast<uint32_t>(lods.size()) + 1; }
+    float GetLODError(uint32_t lod) const { return lod == 0 ? 0.0f : lods[lod - 1].error; }
+    const std::vector<uint32_t>& GetLODIndices(uint32_t lod) const { return lod == 0 ? indices : lods[lod - 1].indices; }
+};
+
+struct MaterialData
+{
+    std::string name;
+    XMFLOAT3 diffuse = XMFLOAT3(0.8f, 0.8f, 0.8f);
+    XMFLOAT3 specular = XMFLOAT3(0.5f, 0.5f, 0.5f);
+    XMFLOAT3 ambient = XMFLOAT3(0.2f, 0.2f, 0.2f);
+    float shininess = 32.0f;
+    std::string diffuseTexture;
+    std::string normalTexture;
+    std::string specularTexture;
+};
+
+// One placement of a mesh in the scene. A mesh split into chunks gets one instance per chunk.
+struct MeshInstance
+{
+    // Object to world, row vector convention like the rest of DirectXMath
+    XMFLOAT4X4 world;
+    uint32_t meshIndex = 0;
+    // Material of the node that placed the mesh, which can differ from the material of the mesh's first use
+    uint32_t materialIndex = 0;
+};
+
+struct ModelData
+{
+    std::vector<MeshData> meshes;
+    std::vector<MaterialData> materials;
+    // Every placement of every mesh. Flattened imports place each mesh once with the identity transform.
+    std::vector<MeshInstance> instances;
+    XMFLOAT3 boundingBoxMin;
+    XMFLOAT3 boundingBoxMax;
+};
+
+// World bounds of one instance, the box around the transformed mesh bounds
+AABB GetInstanceBounds(const ModelData& model, const MeshInstance& instance);
+// Per instance world bounds in instance order, the input of the instance cullers and BVH::Build
+void GetInstanceBounds(const ModelData& model, std::vector<AABB>& outBounds);
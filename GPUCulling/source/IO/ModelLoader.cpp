@@ -1,24 +1,210 @@
 #include "stdafx.h"
 #include "ModelLoader.h"
+#include "Culling/QuantizedBounds.h"
+#include "IO/ModelCache.h"
+#include "IO/VertexPacking.h"
+#include "System/Hash.h"
+#include "System/ThreadPool.h"
 
+#include <assimp/DefaultIOSystem.h>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <unordered_map>
 
-std::unique_ptr<ModelData> ModelLoader::LoadModel(const std::string& filePath)
+namespace
 {
-    Assimp::Importer importer;
-
-    const aiScene* scene = importer.ReadFile(
-        filePath,
+    const unsigned int IMPORT_FLAGS =
         aiProcess_Triangulate |
         aiProcess_FlipUVs |
         aiProcess_GenNormals |
         aiProcess_GenSmoothNormals |
         aiProcess_CalcTangentSpace |
         aiProcess_JoinIdenticalVertices |
-        aiProcess_RemoveRedundantMaterials |
-        aiProcess_PreTransformVertices
-    );
+        aiProcess_RemoveRedundantMaterials;
+
+    const uint32_t INVALID_JOB = UINT32_MAX;
+
+    // Assimp matrices transform column vectors, DirectXMath ones row vectors
+    XMFLOAT4X4 ToRowVectorMatrix(const aiMatrix4x4& m)
+    {
+        return XMFLOAT4X4(
+            m.a1, m.b1, m.c1, m.d1,
+            m.a2, m.b2, m.c2, m.d2,
+            m.a3, m.b3, m.c3, m.d3,
+            m.a4, m.b4, m.c4, m.d4);
+    }
+
+    uint64_t HashVectors(const aiVector3D* vectors, uint32_t count, uint64_t hash)
+    {
+        // Presence is hashed too, a missing stream must not match an empty one
+        hash = HashCombine(hash, vectors ? 1 : 0);
+        return vectors ? HashBytes(vectors, count * sizeof(aiVector3D), hash) : hash;
+    }
+
+    // Remembers every file the importer reads, so the side files of a format end up in the cooked file's dependencies
+    class RecordingIOSystem : public Assimp::DefaultIOSystem
+    {
+    public:
+        Assimp::IOStream* Open(const char* filePath, const char* mode) override
+        {
+            Assimp::IOStream* stream = DefaultIOSystem::Open(filePath, mode);
+            if (stream)
+            {
+                m_openedFiles.insert(filePath);
+            }
+            return stream;
+        }
+
+        const std::set<std::string>& GetOpenedFiles() const { return m_openedFiles; }
+
+    private:
+        std::set<std::string> m_openedFiles;
+    };
+
+    bool IsSameVectors(const aiVector3D* a, const aiVector3D* b, uint32_t count)
+    {
+        if (!a || !b)
+        {
+            return a == b;
+        }
+        return std::memcmp(a, b, count * sizeof(aiVector3D)) == 0;
+    }
+}
+
+std::unique_ptr<ModelData> ModelLoader::LoadModel(const std::string& filePath)
+{
+    m_optimizationReport = {};
+
+    std::vector<ModelDependency> dependencies;
+    if (!m_cacheEnabled)
+    {
+        return ImportModel(filePath, dependencies);
+    }
+
+    ModelCacheKey key;
+    if (!ComputeModelCacheKey(filePath, GetSettingsHash(filePath), key))
+    {
+        return nullptr;
+    }
+
+    std::string cachePath = GetCachePath(filePath);
+    CookedModel cooked;
+    if (cooked.Open(cachePath, key))
+    {
+        return cooked.ToModelData();
+    }
+
+    auto model = ImportModel(filePath, dependencies);
+    if (model)
+    {
+        // A cache that cannot be written only costs the next load its speed
+        WriteCookedModel(cachePath, *model, key, dependencies);
+    }
+    return model;
+}
+
+std::unique_ptr<CookedModel> ModelLoader::LoadCookedModel(const std::string& filePath)
+{
+    m_optimizationReport = {};
+
+    ModelCacheKey key;
+    if (!ComputeModelCacheKey(filePath, GetSettingsHash(filePath), key))
+    {
+        return nullptr;
+    }
+
+    std::string cachePath = GetCachePath(filePath);
+    auto cooked = std::make_unique<CookedModel>();
+    if (cooked->Open(cachePath, key))
+    {
+        return cooked;
+    }
+
+    std::vector<ModelDependency> dependencies;
+    auto model = ImportModel(filePath, dependencies);
+    if (!model || !WriteCookedModel(cachePath, *model, key, dependencies) || !cooked->Open(cachePath, key))
+    {
+        return nullptr;
+    }
+    return cooked;
+}
+
+ModelLoader::CookResult ModelLoader::CookModel(const std::string& filePath, const std::string& outputPath)
+{
+    m_optimizationReport = {};
+
+    ModelCacheKey key;
+    if (!ComputeModelCacheKey(filePath, GetSettingsHash(filePath), key))
+    {
+        return CookResult::Failed;
+    }
+
+    // A failed Open leaves nothing mapped, so the stale file can be replaced
+    CookedModel cooked;
+    if (cooked.Open(outputPath, key))
+    {
+        return CookResult::UpToDate;
+    }
+
+    std::vector<ModelDependency> dependencies;
+    auto model = ImportModel(filePath, dependencies);
+    if (!model || !WriteCookedModel(outputPath, *model, key, dependencies))
+    {
+        return CookResult::Failed;
+    }
+    return CookResult::Cooked;
+}
+
+std::string ModelLoader::GetCachePath(const std::string& filePath) const
+{
+    if (m_cacheDirectory.empty())
+    {
+        return filePath + ".cooked";
+    }
+
+    // Sources with the same name in different directories share the cache directory, the path hash keeps them apart
+    std::string absolutePath = std::filesystem::absolute(filePath).string();
+    char pathHash[17];
+    snprintf(pathHash, sizeof(pathHash), "%016llx", static_cast<unsigned long long>(HashBytes(absolutePath.data(), absolutePath.size())));
+
+    std::string fileName = std::filesystem::path(filePath).filename().string() + "." + pathHash + ".cooked";
+    return (std::filesystem::path(m_cacheDirectory) / fileName).string();
+}
+
+uint64_t ModelLoader::GetSettingsHash(const std::string& filePath) const
+{
+    uint64_t hash = HashCombine(0, GetImportFlags());
+    hash = HashCombine(hash, m_meshletBuilder.GetMaxVertices());
+    hash = HashCombine(hash, m_meshletBuilder.GetMaxTriangles());
+    hash = HashBytes(m_lodRatios.data(), m_lodRatios.size() * sizeof(float), hash);
+    hash = HashCombine(hash, m_optimizeMeshes ? 1 : 0);
+    hash = HashCombine(hash, m_splitLargeMeshes ? 1 : 0);
+    hash = HashCombine(hash, m_preserveInstancing ? 1 : 0);
+    hash = HashCombine(hash, m_quantizeVertices ? 1 : 0);
+
+    // Texture paths are stored resolved against the model directory, a moved model has to be imported again
+    std::string modelDir = std::filesystem::path(filePath).parent_path().string();
+    return HashBytes(modelDir.data(), modelDir.size(), hash);
+}
+
+unsigned int ModelLoader::GetImportFlags() const
+{
+    return m_preserveInstancing ? IMPORT_FLAGS : IMPORT_FLAGS | aiProcess_PreTransformVertices;
+}
+
+std::unique_ptr<ModelData> ModelLoader::ImportModel(const std::string& filePath, std::vector<ModelDependency>& outDependencies)
+{
+    outDependencies.clear();
+
+    // The importer owns its IO system and deletes it along with the scene
+    Assimp::Importer importer;
+    RecordingIOSystem* ioSystem = new RecordingIOSystem();
+    importer.SetIOHandler(ioSystem);
+
+    const aiScene* scene = importer.ReadFile(filePath, GetImportFlags());
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
@@ -27,19 +213,168 @@ std::unique_ptr<ModelData> ModelLoader::LoadModel(const std::string& filePath)
 
     auto model = std::make_unique<ModelData>();
 
-    ProcessNode(scene->mRootNode, scene, model.get());
+    std::vector<MeshReference> references;
+    CollectMeshes(scene, references);
+
+    // One job per referenced scene mesh, in order of first reference, however many nodes place it
+    std::vector<const aiMesh*> meshJobs;
+    std::vector<uint32_t> sceneMeshJobs(scene->mNumMeshes, INVALID_JOB);
+    for (const MeshReference& reference : references)
+    {
+        if (sceneMeshJobs[reference.sceneMeshIndex] == INVALID_JOB)
+        {
+            sceneMeshJobs[reference.sceneMeshIndex] = static_cast<uint32_t>(meshJobs.size());
+            meshJobs.push_back(scene->mMeshes[reference.sceneMeshIndex]);
+        }
+    }
+
+    // Exporters often write every copy of a mesh as its own mesh under its own node name. Copies are found by content
+    // and resolved to the first job with that geometry, which is the only one converted. Flattened imports have their
+    // transforms baked in, so equal geometry there is a real duplicate at the same spot and stays as it is.
+    std::vector<uint32_t> jobSources(meshJobs.size());
+    for (uint32_t i = 0; i < jobSources.size(); ++i)
+    {
+        jobSources[i] = i;
+    }
+
+    if (m_preserveInstancing)
+    {
+        std::vector<uint64_t> geometryHashes(meshJobs.size());
+        ThreadPool::Get().ParallelFor(meshJobs.size(), 1, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                geometryHashes[i] = HashMeshGeometry(meshJobs[i]);
+            }
+        });
+
+        // Equal hashes are compared in full before they are merged
+        std::unordered_multimap<uint64_t, uint32_t> jobsByHash;
+        jobsByHash.reserve(meshJobs.size());
+        for (uint32_t i = 0; i < meshJobs.size(); ++i)
+        {
+            auto range = jobsByHash.equal_range(geometryHashes[i]);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (IsSameGeometry(meshJobs[it->second], meshJobs[i]))
+                {
+                    jobSources[i] = it->second;
+                    break;
+                }
+            }
+
+            if (jobSources[i] == i)
+            {
+                jobsByHash.emplace(geometryHashes[i], i);
+            }
+        }
+    }
+
+    // Every job owns one preallocated slot, so the mesh order is the node walk order whatever the thread count.
+    // One mesh per batch balances best since mesh sizes vary wildly, and each mesh is simplified right after it is
+    // built while its data is still in cache.
+    std::vector<std::vector<MeshData>> jobMeshes(meshJobs.size());
+    std::vector<MeshOptimizer::Report> reports(meshJobs.size());
+    ThreadPool::Get().ParallelFor(meshJobs.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (jobSources[i] != i)
+            {
+                continue;
+            }
+
+            ProcessMesh(meshJobs[i], jobMeshes[i], reports[i]);
+            for (MeshData& mesh : jobMeshes[i])
+            {
+                GenerateLODs(mesh);
+            }
+        }
+    });
+
+    // Split meshes produce several chunks per job, the buffers are moved over and never copied
+    std::vector<uint32_t> jobFirstMeshes(meshJobs.size());
+    size_t meshCount = 0;
+    for (size_t i = 0; i < jobMeshes.size(); ++i)
+    {
+        jobFirstMeshes[i] = static_cast<uint32_t>(meshCount);
+        meshCount += jobMeshes[i].size();
+    }
+
+    model->meshes.reserve(meshCount);
+    for (std::vector<MeshData>& meshes : jobMeshes)
+    {
+        std::move(meshes.begin(), meshes.end(), std::back_inserter(model->meshes));
+    }
+
+    // The chunk counts survive the move, the vectors themselves are only emptied of their buffers
+    model->instances.reserve(references.size());
+    for (const MeshReference& reference : references)
+    {
+        uint32_t job = jobSources[sceneMeshJobs[reference.sceneMeshIndex]];
+        for (uint32_t i = 0; i < jobMeshes[job].size(); ++i)
+        {
+            MeshInstance instance;
+            instance.world = reference.world;
+            instance.meshIndex = jobFirstMeshes[job] + i;
+            instance.materialIndex = scene->mMeshes[reference.sceneMeshIndex]->mMaterialIndex;
+            model->instances.push_back(instance);
+        }
+    }
+
+    for (const MeshOptimizer::Report& report : reports)
+    {
+        m_optimizationReport.Add(report);
+    }
 
+    std::string modelDir = std::filesystem::path(filePath).parent_path().string();
+    model->materials.reserve(scene->mNumMaterials);
     for (uint32_t i = 0; i < scene->mNumMaterials; ++i)
     {
-        auto material = ProcessMaterial(scene->mMaterials[i], std::filesystem::path(filePath).parent_path().string());
+        auto material = ProcessMaterial(scene->mMaterials[i], modelDir);
         if (material)
         {
-            model->materials.push_back(*material);
+            model->materials.push_back(std::move(*material));
         }
     }
 
     CalculateBoundingBox(model.get());
 
+    // The source itself is covered by the cache key. Textures are only referenced by path, they are recorded so a
+    // cooked file is rebuilt and shipped again along with a changed texture. Embedded and missing ones are skipped.
+    std::set<std::string> dependencyPaths;
+    std::filesystem::path sourcePath = std::filesystem::absolute(filePath).lexically_normal();
+    auto addDependency = [&](const std::string& path)
+    {
+        if (path.empty())
+        {
+            return;
+        }
+
+        std::filesystem::path absolutePath = std::filesystem::absolute(path).lexically_normal();
+        if (absolutePath == sourcePath || !dependencyPaths.insert(absolutePath.string()).second)
+        {
+            return;
+        }
+
+        ModelDependency dependency;
+        if (GetModelDependency(absolutePath.string(), dependency))
+        {
+            outDependencies.push_back(std::move(dependency));
+        }
+    };
+
+    for (const std::string& path : ioSystem->GetOpenedFiles())
+    {
+        addDependency(path);
+    }
+    for (const MaterialData& material : model->materials)
+    {
+        addDependency(material.diffuseTexture);
+        addDependency(material.normalTexture);
+        addDependency(material.specularTexture);
+    }
+
     return model;
 }
 
@@ -64,39 +399,115 @@ bool ModelLoader::IsFileSupported(const std::string& filePath) const
     return false;
 }
 
-void ModelLoader::ProcessNode(aiNode* node, const aiScene* scene, ModelData* outModel)
+void ModelLoader::CollectMeshes(const aiScene* scene, std::vector<MeshReference>& outReferences) const
 {
-    for (uint32_t i = 0; i < node->mNumMeshes; ++i)
+    struct NodeEntry
+    {
+        const aiNode* node;
+        XMFLOAT4X4 parentWorld;
+    };
+
+    XMFLOAT4X4 identity;
+    XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+    // Depth first with an explicit stack, children pushed in reverse so they pop in order, which gives the same
+    // order as visiting each node's meshes and then recursing into its children
+    std::vector<NodeEntry> stack;
+    stack.push_back({ scene->mRootNode, identity });
+
+    while (!stack.empty())
     {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        auto processedMesh = ProcessMesh(mesh, scene);
-        if (processedMesh)
+        NodeEntry entry = stack.back();
+        stack.pop_back();
+
+        // Row vectors apply the node's own transform first
+        XMFLOAT4X4 local = ToRowVectorMatrix(entry.node->mTransformation);
+        XMFLOAT4X4 world;
+        XMStoreFloat4x4(&world, XMMatrixMultiply(XMLoadFloat4x4(&local), XMLoadFloat4x4(&entry.parentWorld)));
+
+        for (uint32_t i = 0; i < entry.node->mNumMeshes; ++i)
         {
-            outModel->meshes.push_back(*processedMesh);
+            // Pre-transformed scenes have every node transform baked into the vertices already
+            MeshReference reference;
+            reference.sceneMeshIndex = entry.node->mMeshes[i];
+            reference.world = m_preserveInstancing ? world : identity;
+            outReferences.push_back(reference);
+        }
+
+        for (uint32_t i = entry.node->mNumChildren; i > 0; --i)
+        {
+            stack.push_back({ entry.node->mChildren[i - 1], world });
         }
     }
+}
+
+uint64_t ModelLoader::HashMeshGeometry(const aiMesh* mesh)
+{
+    uint64_t hash = HashCombine(0, mesh->mPrimitiveTypes);
+    hash = HashCombine(hash, mesh->mNumVertices);
+    hash = HashCombine(hash, mesh->mNumFaces);
+    hash = HashVectors(mesh->mVertices, mesh->mNumVertices, hash);
+    hash = HashVectors(mesh->mNormals, mesh->mNumVertices, hash);
+    hash = HashVectors(mesh->mTextureCoords[0], mesh->mNumVertices, hash);
+    hash = HashVectors(mesh->mTangents, mesh->mNumVertices, hash);
+    hash = HashVectors(mesh->mBitangents, mesh->mNumVertices, hash);
 
-    for (uint32_t i = 0; i < node->mNumChildren; ++i)
+    for (uint32_t i = 0; i < mesh->mNumFaces; ++i)
     {
-        ProcessNode(node->mChildren[i], scene, outModel);
+        const aiFace& face = mesh->mFaces[i];
+        hash = HashBytes(face.mIndices, face.mNumIndices * sizeof(uint32_t), HashCombine(hash, face.mNumIndices));
     }
+    return hash;
 }
 
-std::unique_ptr<MeshData> ModelLoader::ProcessMesh(aiMesh* mesh, const aiScene* scene)
+bool ModelLoader::IsSameGeometry(const aiMesh* a, const aiMesh* b)
 {
-    auto processedMesh = std::make_unique<MeshData>();
-    processedMesh->name = mesh->mName.C_Str();
-    processedMesh->materialIndex = mesh->mMaterialIndex;
+    if (a->mPrimitiveTypes != b->mPrimitiveTypes || a->mNumVertices != b->mNumVertices || a->mNumFaces != b->mNumFaces ||
+        !IsSameVectors(a->mVertices, b->mVertices, a->mNumVertices) ||
+        !IsSameVectors(a->mNormals, b->mNormals, a->mNumVertices) ||
+        !IsSameVectors(a->mTextureCoords[0], b->mTextureCoords[0], a->mNumVertices) ||
+        !IsSameVectors(a->mTangents, b->mTangents, a->mNumVertices) ||
+        !IsSameVectors(a->mBitangents, b->mBitangents, a->mNumVertices))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < a->mNumFaces; ++i)
+    {
+        const aiFace& faceA = a->mFaces[i];
+        const aiFace& faceB = b->mFaces[i];
+        if (faceA.mNumIndices != faceB.mNumIndices ||
+            std::memcmp(faceA.mIndices, faceB.mIndices, faceA.mNumIndices * sizeof(uint32_t)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ModelLoader::ProcessMesh(const aiMesh* mesh, std::vector<MeshData>& outMeshes, MeshOptimizer::Report& outReport) const
+{
+    outMeshes.resize(1);
+    MeshData& outMesh = outMeshes[0];
+
+    outMesh.name = mesh->mName.C_Str();
+    outMesh.materialIndex = mesh->mMaterialIndex;
+
+    // The box and the sphere's extreme points are accumulated while vertices are copied, only the sphere's growth pass
+    // reads the positions again
+    BoundsAccumulator boundsAccumulator;
+    outMesh.vertices.resize(mesh->mNumVertices);
 
     for (uint32_t i = 0; i < mesh->mNumVertices; ++i)
     {
-        VertexData vertex{};
+        VertexData& vertex = outMesh.vertices[i];
 
         vertex.position = XMFLOAT3(
             mesh->mVertices[i].x,
             mesh->mVertices[i].y,
             mesh->mVertices[i].z
         );
+        boundsAccumulator.Add(vertex.position);
 
         if (mesh->HasNormals())
         {
@@ -142,20 +553,129 @@ std::unique_ptr<MeshData> ModelLoader::ProcessMesh(aiMesh* mesh, const aiScene*
             vertex.tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
             vertex.bitangent = XMFLOAT3(0.0f, 1.0f, 0.0f);
         }
+    }
+
+    if (!outMesh.vertices.empty())
+    {
+        outMesh.bounds = boundsAccumulator.GetAABB();
+        outMesh.boundingSphere = boundsAccumulator.GetSphere(&outMesh.vertices[0].position, outMesh.vertices.size(), sizeof(VertexData));
+    }
 
-        processedMesh->vertices.push_back(vertex);
+    size_t indexCount = 0;
+    for (uint32_t i = 0; i < mesh->mNumFaces; ++i)
+    {
+        indexCount += mesh->mFaces[i].mNumIndices;
     }
 
+    outMesh.indices.resize(indexCount);
+    uint32_t* indices = outMesh.indices.data();
     for (uint32_t i = 0; i < mesh->mNumFaces; ++i)
     {
-        aiFace face = mesh->mFaces[i];
+        const aiFace& face = mesh->mFaces[i];
         for (uint32_t j = 0; j < face.mNumIndices; ++j)
         {
-            processedMesh->indices.push_back(face.mIndices[j]);
+            *indices++ = face.mIndices[j];
         }
     }
 
-    return processedMesh;
+    // Point and line meshes have no triangles to reorder, split or cluster
+    bool isTriangleMesh = mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE && !outMesh.indices.empty();
+    if (isTriangleMesh)
+    {
+        // Renumbers the vertices, so it has to run before meshlets capture vertex indices
+        if (m_optimizeMeshes)
+        {
+            outReport = MeshOptimizer::Optimize(outMesh);
+        }
+
+        if (m_splitLargeMeshes && outMesh.vertices.size() > MAX_UINT16_INDEX_VERTICES)
+        {
+            SplitMesh(outMeshes);
+        }
+    }
+
+    for (MeshData& chunk : outMeshes)
+    {
+        chunk.indexFormat = SelectIndexFormat(chunk.vertices.size());
+
+        if (isTriangleMesh)
+        {
+            m_meshletBuilder.Build(
+                &chunk.vertices[0].position,
+                chunk.vertices.size(),
+                sizeof(VertexData),
+                chunk.indices.data(),
+                chunk.indices.size(),
+                chunk.meshletData
+            );
+        }
+
+        if (m_quantizeVertices && !chunk.vertices.empty())
+        {
+            chunk.quantization = MakeBoundsQuantization(chunk.bounds);
+            chunk.quantizedVertices.resize(chunk.vertices.size());
+            PackVertices(chunk.vertices.data(), chunk.vertices.size(), chunk.quantization, chunk.quantizedVertices.data());
+        }
+    }
+}
+
+void ModelLoader::SplitMesh(std::vector<MeshData>& meshes)
+{
+    assertm(meshes.size() == 1, "ModelLoader::SplitMesh called with more than one mesh");
+
+    MeshData& source = meshes[0];
+    std::vector<MeshData> chunks;
+
+    // Triangles are taken in their optimized order, a chunk closes when the next triangle's new vertices would not
+    // fit. Chunk vertices are numbered by first use, which keeps the fetch order.
+    std::vector<uint32_t> chunkVertex(source.vertices.size(), UINT32_MAX);
+    std::vector<uint32_t> chunkOwner(source.vertices.size(), UINT32_MAX);
+    for (size_t i = 0; i < source.indices.size(); i += 3)
+    {
+        uint32_t newVertices = 0;
+        if (!chunks.empty())
+        {
+            uint32_t chunkIndex = static_cast<uint32_t>(chunks.size() - 1);
+            for (size_t corner = 0; corner < 3; ++corner)
+            {
+                newVertices += chunkOwner[source.indices[i + corner]] != chunkIndex ? 1 : 0;
+            }
+        }
+
+        if (chunks.empty() || chunks.back().vertices.size() + newVertices > MAX_UINT16_INDEX_VERTICES)
+        {
+            MeshData& chunk = chunks.emplace_back();
+            chunk.name = source.name;
+            chunk.materialIndex = source.materialIndex;
+        }
+
+        uint32_t chunkIndex = static_cast<uint32_t>(chunks.size() - 1);
+        MeshData& chunk = chunks.back();
+        for (size_t corner = 0; corner < 3; ++corner)
+        {
+            uint32_t vertex = source.indices[i + corner];
+            if (chunkOwner[vertex] != chunkIndex)
+            {
+                chunkOwner[vertex] = chunkIndex;
+                chunkVertex[vertex] = static_cast<uint32_t>(chunk.vertices.size());
+                chunk.vertices.push_back(source.vertices[vertex]);
+            }
+            chunk.indices.push_back(chunkVertex[vertex]);
+        }
+    }
+
+    for (MeshData& chunk : chunks)
+    {
+        BoundsAccumulator boundsAccumulator;
+        for (const VertexData& vertex : chunk.vertices)
+        {
+            boundsAccumulator.Add(vertex.position);
+        }
+        chunk.bounds = boundsAccumulator.GetAABB();
+        chunk.boundingSphere = boundsAccumulator.GetSphere(&chunk.vertices[0].position, chunk.vertices.size(), sizeof(VertexData));
+    }
+
+    meshes = std::move(chunks);
 }
 
 std::unique_ptr<MaterialData> ModelLoader::ProcessMaterial(aiMaterial* material, const std::string& modelDir)
@@ -201,34 +721,54 @@ std::unique_ptr<MaterialData> ModelLoader::ProcessMaterial(aiMaterial* material,
     return processedMaterial;
 }
 
+void ModelLoader::GenerateLODs(MeshData& mesh) const
+{
+    // Meshlets are only built for pure triangle meshes, point and line meshes have nothing to simplify
+    if (m_lodRatios.empty() || mesh.meshletData.meshlets.empty())
+    {
+        return;
+    }
+
+    MeshSimplifier::GenerateLODs(mesh, m_lodRatios.data(), m_lodRatios.size());
+
+    // Levels share the full resolution vertex buffer, only their triangle order can still be improved
+    if (m_optimizeMeshes)
+    {
+        for (MeshLOD& lod : mesh.lods)
+        {
+            MeshOptimizer::OptimizeVertexCache(lod.indices.data(), lod.indices.size(), mesh.vertices.size());
+        }
+    }
+}
+
 void ModelLoader::CalculateBoundingBox(ModelData* outModel)
 {
-    if (outModel->meshes.empty())
+    if (outModel->instances.empty())
     {
         outModel->boundingBoxMin = XMFLOAT3(0.0f, 0.0f, 0.0f);
         outModel->boundingBoxMax = XMFLOAT3(0.0f, 0.0f, 0.0f);
         return;
     }
 
-    XMFLOAT3 minBounds(FLT_MAX, FLT_MAX, FLT_MAX);
-    XMFLOAT3 maxBounds(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-
-    for (const auto& mesh : outModel->meshes)
+    // Merge the transformed mesh bounds instead of walking every vertex again
+    AABB modelBounds;
+    for (const MeshInstance& instance : outModel->instances)
     {
-        for (const auto& vertex : mesh.vertices)
+        AABB bounds = GetInstanceBounds(*outModel, instance);
+        if (bounds.IsValid())
         {
-            minBounds.x = std::min(minBounds.x, vertex.position.x);
-            minBounds.y = std::min(minBounds.y, vertex.position.y);
-            minBounds.z = std::min(minBounds.z, vertex.position.z);
-
-            maxBounds.x = std::max(maxBounds.x, vertex.position.x);
-            maxBounds.y = std::max(maxBounds.y, vertex.position.y);
-            maxBounds.z = std::max(maxBounds.z, vertex.position.z);
+            modelBounds.Merge(bounds);
         }
     }
 
-    outModel->boundingBoxMin = minBounds;
-    outModel->boundingBoxMax = maxBounds;
+    if (!modelBounds.IsValid())
+    {
+        modelBounds.min = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        modelBounds.max = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    }
+
+    outModel->boundingBoxMin = modelBounds.min;
+    outModel->boundingBoxMax = modelBounds.max;
 }
 
 void ModelLoader::CalculateTangentSpace(std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices)
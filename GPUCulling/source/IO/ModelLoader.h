@@ -3,51 +3,32 @@
 #include <vector>
 #include <string>
 #include <memory>
-#include <DirectXMath.h>
-#include <assimp/scene.h>
+#include <iterator>
 
-using namespace DirectX;
+#include "IO/MeshletBuilder.h"
+#include "IO/MeshOptimizer.h"
+#include "IO/MeshSimplifier.h"
+#include "IO/ModelData.h"
 
-struct VertexData
-{
-    XMFLOAT3 position;
-    XMFLOAT3 normal;
-    XMFLOAT2 texCoord;
-    XMFLOAT3 tangent;
-    XMFLOAT3 bitangent;
-};
-
-struct MeshData
-{
-    std::vector<VertexData> vertices;
-    std::vector<uint32_t> indices;
-    std::string name;
-    uint32_t materialIndex = 0;
-};
+// Only ModelLoader.cpp sees Assimp, code reading cooked files does not need its headers
+struct aiScene;
+struct aiMesh;
+struct aiMaterial;
 
-struct MaterialData
-{
-    std::string name;
-    XMFLOAT3 diffuse = XMFLOAT3(0.8f, 0.8f, 0.8f);
-    XMFLOAT3 specular = XMFLOAT3(0.5f, 0.5f, 0.5f);
-    XMFLOAT3 ambient = XMFLOAT3(0.2f, 0.2f, 0.2f);
-    float shininess = 32.0f;
-    std::string diffuseTexture;
-    std::string normalTexture;
-    std::string specularTexture;
-};
-
-struct ModelData
-{
-    std::vector<MeshData> meshes;
-    std::vector<MaterialData> materials;
-    XMFLOAT3 boundingBoxMin;
-    XMFLOAT3 boundingBoxMax;
-};
+class CookedModel;
+struct ModelDependency;
 
 class ModelLoader
 {
 public:
+    enum class CookResult
+    {
+        Cooked,
+        // The output already holds this source cooked with the current settings
+        UpToDate,
+        Failed,
+    };
+
     ModelLoader() = default;
     ~ModelLoader() = default;
 
@@ -56,13 +37,74 @@ public:
     ModelLoader(ModelLoader&&) = default;
     ModelLoader& operator=(ModelLoader&&) = default;
 
+    // Reads the cooked file of filePath when it matches the source and the current settings, otherwise imports
+    // through Assimp and writes the cooked file for the next load
     std::unique_ptr<ModelData> LoadModel(const std::string& filePath);
+    // Same lookup, but hands out the mapped cooked file itself so nothing is copied. Fails when the cooked file cannot
+    // be written, LoadModel still works in that case.
+    std::unique_ptr<CookedModel> LoadCookedModel(const std::string& filePath);
+    // Imports filePath and writes it as a cooked file at outputPath, for tools that cook assets ahead of time. The
+    // result opens with CookedModel::Open without the source. Safe to run on several loaders in parallel.
+    CookResult CookModel(const std::string& filePath, const std::string& outputPath);
     bool IsFileSupported(const std::string& filePath) const;
 
+    void SetMeshletLimits(uint32_t maxVertices, uint32_t maxTriangles) { m_meshletBuilder.SetLimits(maxVertices, maxTriangles); }
+    // Triangle ratios of the simplified levels built per mesh, empty disables LOD generation
+    void SetLODRatios(std::vector<float> ratios) { m_lodRatios = std::move(ratios); }
+    // Cooked files are written next to their source unless a directory is set
+    void SetCacheDirectory(std::string directory) { m_cacheDirectory = std::move(directory); }
+    void SetCacheEnabled(bool enabled) { m_cacheEnabled = enabled; }
+    // Vertex cache, overdraw and vertex fetch reordering of every triangle mesh, on by default
+    void SetMeshOptimization(bool enabled) { m_optimizeMeshes = enabled; }
+    // Splits meshes with more vertices than 16-bit indices address into chunks that fit, off by default. The chunks
+    // keep the mesh's name and material.
+    void SetSplitLargeMeshes(bool enabled) { m_splitLargeMeshes = enabled; }
+    // Keeps the node hierarchy instead of baking every node transform into its meshes, off by default. Each distinct
+    // geometry is stored once and placed by the instance table, including copies Assimp imported as separate meshes.
+    void SetPreserveInstancing(bool enabled) { m_preserveInstancing = enabled; }
+    // Fills MeshData::quantizedVertices for every mesh, off by default. Cooked files then hold only the quantized
+    // vertices, meshes read back from them decode their full precision vertices from those.
+    void SetQuantizeVertices(bool enabled) { m_quantizeVertices = enabled; }
+    // Vertex cache statistics of the last Assimp import before and after optimization, all zero after a cache hit
+    const MeshOptimizer::Report& GetOptimizationReport() const { return m_optimizationReport; }
+
 private:
-    void ProcessNode(aiNode* node, const aiScene* scene, ModelData* outModel);
-    std::unique_ptr<MeshData> ProcessMesh(aiMesh* mesh, const aiScene* scene);
+    // Also lists every file besides filePath the import read or references, for the cooked file's dependencies
+    std::unique_ptr<ModelData> ImportModel(const std::string& filePath, std::vector<ModelDependency>& outDependencies);
+    std::string GetCachePath(const std::string& filePath) const;
+    // Covers everything besides the source file contents that ends up in the cooked file
+    uint64_t GetSettingsHash(const std::string& filePath) const;
+
+    // A node's reference to a scene mesh with the node's accumulated transform
+    struct MeshReference
+    {
+        uint32_t sceneMeshIndex = 0;
+        XMFLOAT4X4 world;
+    };
+
+    unsigned int GetImportFlags() const;
+    // Flattens the node hierarchy into the mesh references, in depth first order
+    void CollectMeshes(const aiScene* scene, std::vector<MeshReference>& outReferences) const;
+    // Hash of everything ProcessMesh reads besides the name and material, equal for copies of the same geometry
+    static uint64_t HashMeshGeometry(const aiMesh* mesh);
+    static bool IsSameGeometry(const aiMesh* a, const aiMesh* b);
+    // Runs on the thread pool, one call per mesh, so it only reads loader state. Fills outMeshes with the mesh or with
+    // its chunks when it is split.
+    void ProcessMesh(const aiMesh* mesh, std::vector<MeshData>& outMeshes, MeshOptimizer::Report& outReport) const;
+    // Replaces the single mesh in meshes with chunks of at most MAX_UINT16_INDEX_VERTICES vertices
+    static void SplitMesh(std::vector<MeshData>& meshes);
     std::unique_ptr<MaterialData> ProcessMaterial(aiMaterial* material, const std::string& modelDir);
+    void GenerateLODs(MeshData& mesh) const;
     void CalculateBoundingBox(ModelData* outModel);
     void CalculateTangentSpace(std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices);
+
+    MeshletBuilder m_meshletBuilder;
+    std::vector<float> m_lodRatios = std::vector<float>(std::begin(MeshSimplifier::DEFAULT_LOD_RATIOS), std::end(MeshSimplifier::DEFAULT_LOD_RATIOS));
+    std::string m_cacheDirectory;
+    bool m_cacheEnabled = true;
+    bool m_optimizeMeshes = true;
+    bool m_splitLargeMeshes = false;
+    bool m_preserveInstancing = false;
+    bool m_quantizeVertices = false;
+    MeshOptimizer::Report m_optimizationReport;
 };
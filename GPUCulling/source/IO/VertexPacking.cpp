@@ -0,0 +1,218 @@
+#include "stdafx.h"
+#include "IO/VertexPacking.h"
+#include "Culling/SIMDLanes.h"
+
+#include <DirectXPackedVector.h>
+
+using namespace ShaderInterop;
+
+namespace
+{
+    constexpr size_t MAX_LANES = 8;
+
+    // Structure of arrays codes of one lane group, still as floats holding integers
+    struct EncodedLanes
+    {
+        float normalX[MAX_LANES];
+        float normalY[MAX_LANES];
+        float tangentX[MAX_LANES];
+        float tangentY[MAX_LANES];
+        float positionX[MAX_LANES];
+        float positionY[MAX_LANES];
+        float positionZ[MAX_LANES];
+    };
+
+    // Folds the unit vector onto the octahedron and its lower half over the upper one. A zero vector encodes as +Z.
+    template<typename Lanes>
+    void EncodeOctahedral(typename Lanes::Float x, typename Lanes::Float y, typename Lanes::Float z, float yScale,
+        float* outX, float* outY)
+    {
+        using Float = typename Lanes::Float;
+        using std::floor;
+
+        const Float zero = 0.0f;
+        const Float one = 1.0f;
+
+        Float length = Lanes::Max(x, -x) + Lanes::Max(y, -y) + Lanes::Max(z, -z);
+        Float invLength = Lanes::Select(length > zero, one / Lanes::Max(length, Float(FLT_MIN)), zero);
+        Float u = x * invLength;
+        Float v = y * invLength;
+
+        Float foldedU = (one - Lanes::Max(v, -v)) * Lanes::Select(u >= zero, one, -one);
+        Float foldedV = (one - Lanes::Max(u, -u)) * Lanes::Select(v >= zero, one, -one);
+        typename Lanes::Mask lower = z < zero;
+        u = Lanes::Select(lower, foldedU, u);
+        v = Lanes::Select(lower, foldedV, v);
+
+        u = Lanes::Min(Lanes::Max(u, -one), one);
+        v = Lanes::Min(Lanes::Max(v, -one), one);
+        Lanes::Store(outX, floor(u * Float(OCTAHEDRAL_SNORM16_SCALE) + Float(0.5f)));
+        Lanes::Store(outY, floor(v * Float(yScale) + Float(0.5f)));
+    }
+
+    // Nearest code, a degenerate axis has scale 0 and always encodes 0
+    template<typename Lanes>
+    void QuantizePosition(typename Lanes::Float value, float origin, float scale, float* outCodes)
+    {
+        using Float = typename Lanes::Float;
+        using std::floor;
+
+        float invScale = scale > 0.0f ? 1.0f / scale : 0.0f;
+        Float code = (value - Float(origin)) * Float(invScale);
+        code = Lanes::Min(Lanes::Max(code, Float(0.0f)), Float(static_cast<float>(QUANTIZED_BOUNDS_MAX_CODE)));
+        Lanes::Store(outCodes, floor(code + Float(0.5f)));
+    }
+
+    template<typename Lanes>
+    void EncodeLanes(const VertexData* vertices, const BoundsQuantization* quantization, EncodedLanes& outCodes)
+    {
+        constexpr size_t WIDTH = Lanes::WIDTH;
+
+        // Transpose the interleaved vertices into lanes
+        float normalX[WIDTH], normalY[WIDTH], normalZ[WIDTH];
+        float tangentX[WIDTH], tangentY[WIDTH], tangentZ[WIDTH];
+        float positionX[WIDTH], positionY[WIDTH], positionZ[WIDTH];
+        for (size_t lane = 0; lane < WIDTH; ++lane)
+        {
+            const VertexData& vertex = vertices[lane];
+            normalX[lane] = vertex.normal.x;
+            normalY[lane] = vertex.normal.y;
+            normalZ[lane] = vertex.normal.z;
+            tangentX[lane] = vertex.tangent.x;
+            tangentY[lane] = vertex.tangent.y;
+            tangentZ[lane] = vertex.tangent.z;
+            positionX[lane] = vertex.position.x;
+            positionY[lane] = vertex.position.y;
+            positionZ[lane] = vertex.position.z;
+        }
+
+        EncodeOctahedral<Lanes>(Lanes::Load(normalX), Lanes::Load(normalY), Lanes::Load(normalZ),
+            OCTAHEDRAL_SNORM16_SCALE, outCodes.normalX, outCodes.normalY);
+        EncodeOctahedral<Lanes>(Lanes::Load(tangentX), Lanes::Load(tangentY), Lanes::Load(tangentZ),
+            OCTAHEDRAL_SNORM15_SCALE, outCodes.tangentX, outCodes.tangentY);
+
+        if (quantization)
+        {
+            QuantizePosition<Lanes>(Lanes::Load(positionX), quantization->origin.x, quantization->scale.x, outCodes.positionX);
+            QuantizePosition<Lanes>(Lanes::Load(positionY), quantization->origin.y, quantization->scale.y, outCodes.positionY);
+            QuantizePosition<Lanes>(Lanes::Load(positionZ), quantization->origin.z, quantization->scale.z, outCodes.positionZ);
+        }
+    }
+
+    uint32_t PackPair(float low, float high, uint32_t highMask)
+    {
+        return (static_cast<uint32_t>(static_cast<int32_t>(low)) & 0xFFFF) |
+            ((static_cast<uint32_t>(static_cast<int32_t>(high)) & highMask) << 16);
+    }
+
+    float GetTangentSign(const VertexData& vertex)
+    {
+        const XMFLOAT3& n = vertex.normal;
+        const XMFLOAT3& t = vertex.tangent;
+        const XMFLOAT3& b = vertex.bitangent;
+        float handedness = (n.y * t.z - n.z * t.y) * b.x + (n.z * t.x - n.x * t.z) * b.y + (n.x * t.y - n.y * t.x) * b.z;
+        return handedness < 0.0f ? -1.0f : 1.0f;
+    }
+
+    void PackFrame(const VertexData& vertex, const EncodedLanes& codes, size_t lane, uint32_t& outNormal, uint32_t& outTangent, uint32_t& outTexCoord)
+    {
+        outNormal = PackPair(codes.normalX[lane], codes.normalY[lane], 0xFFFF);
+        outTangent = PackPair(codes.tangentX[lane], codes.tangentY[lane], 0x7FFF);
+        if (GetTangentSign(vertex) < 0.0f)
+        {
+            outTangent |= TANGENT_SIGN_BIT;
+        }
+        outTexCoord = PackedVector::XMConvertFloatToHalf(vertex.texCoord.x) |
+            (static_cast<uint32_t>(PackedVector::XMConvertFloatToHalf(vertex.texCoord.y)) << 16);
+    }
+
+    void PackVertex(const VertexData& vertex, const EncodedLanes& codes, size_t lane, PackedVertex& outVertex)
+    {
+        outVertex.position = vertex.position;
+        PackFrame(vertex, codes, lane, outVertex.normal, outVertex.tangent, outVertex.texCoord);
+    }
+
+    void PackVertex(const VertexData& vertex, const EncodedLanes& codes, size_t lane, QuantizedVertex& outVertex)
+    {
+        outVertex.positionXY = PackPair(codes.positionX[lane], codes.positionY[lane], 0xFFFF);
+        outVertex.positionZ = static_cast<uint32_t>(codes.positionZ[lane]);
+        PackFrame(vertex, codes, lane, outVertex.normal, outVertex.tangent, outVertex.texCoord);
+    }
+
+    // Full lane groups on Lanes, the remainder one vertex at a time
+    template<typename Lanes, typename Vertex>
+    void PackLanes(const VertexData* vertices, size_t count, const BoundsQuantization* quantization, Vertex* outVertices)
+    {
+        EncodedLanes codes;
+        size_t i = 0;
+        for (; i + Lanes::WIDTH <= count; i += Lanes::WIDTH)
+        {
+            EncodeLanes<Lanes>(vertices + i, quantization, codes);
+            for (size_t lane = 0; lane < Lanes::WIDTH; ++lane)
+            {
+                PackVertex(vertices[i + lane], codes, lane, outVertices[i + lane]);
+            }
+        }
+
+        for (; i < count; ++i)
+        {
+            EncodeLanes<SIMD::ScalarLanes>(vertices + i, quantization, codes);
+            PackVertex(vertices[i], codes, 0, outVertices[i]);
+        }
+    }
+
+    template<typename Vertex>
+    void Pack(const VertexData* vertices, size_t count, const BoundsQuantization* quantization, Vertex* outVertices, CullPath path)
+    {
+        assertm(path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2, "PackVertices called with a path this build does not support");
+
+        switch (path)
+        {
+#if defined(__AVX2__)
+        case CullPath::AVX2:
+            PackLanes<SIMD::AVX2Lanes>(vertices, count, quantization, outVertices);
+            break;
+#endif
+        case CullPath::SSE:
+            PackLanes<SIMD::SSELanes>(vertices, count, quantization, outVertices);
+            break;
+        default:
+            PackLanes<SIMD::ScalarLanes>(vertices, count, quantization, outVertices);
+            break;
+        }
+    }
+
+    void UnpackFrame(uint32_t normal, uint32_t tangent, uint32_t texCoord, VertexData& outVertex)
+    {
+        outVertex.normal = DecodeNormal(normal);
+        outVertex.tangent = DecodeTangent(tangent);
+        outVertex.bitangent = GetBitangent(outVertex.normal, outVertex.tangent, GetBitangentSign(tangent));
+        outVertex.texCoord = DecodeTexCoord(texCoord);
+    }
+}
+
+void PackVertices(const VertexData* vertices, size_t count, PackedVertex* outVertices, CullPath path)
+{
+    Pack(vertices, count, nullptr, outVertices, path);
+}
+
+void PackVertices(const VertexData* vertices, size_t count, const BoundsQuantization& quantization, QuantizedVertex* outVertices, CullPath path)
+{
+    Pack(vertices, count, &quantization, outVertices, path);
+}
+
+VertexData UnpackVertex(const PackedVertex& vertex)
+{
+    VertexData result;
+    result.position = vertex.position;
+    UnpackFrame(vertex.normal, vertex.tangent, vertex.texCoord, result);
+    return result;
+}
+
+VertexData UnpackVertex(const QuantizedVertex& vertex, const BoundsQuantization& quantization)
+{
+    VertexData result;
+    result.position = DecodeVertexPosition(vertex, quantization);
+    UnpackFrame(vertex.normal, vertex.tangent, vertex.texCoord, result);
+    return result;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Culling/CullingCommon.h"
+#include "IO/ModelData.h"
+#include "Shaders/PackedVertexShared.h"
+
+// Encoders for the compressed vertex layouts in Shaders/PackedVertexShared.h, run at import time. Normals, tangents
+// and quantized positions are encoded on SIMD lanes, texture coordinates and the bitangent sign per vertex. Every
+// path produces the same bits.
+//
+// Worst case decode error: about 0.004 degrees for normals, 0.006 degrees for tangents, half a quantization step for
+// positions, and half float rounding (11 significant bits) for texture coordinates.
+
+void PackVertices(const VertexData* vertices, size_t count, ShaderInterop::PackedVertex* outVertices, CullPath path = DEFAULT_CULL_PATH);
+// quantization is usually MakeBoundsQuantization(mesh.bounds), positions outside of it are clamped
+void PackVertices(const VertexData* vertices, size_t count, const ShaderInterop::BoundsQuantization& quantization,
+    ShaderInterop::QuantizedVertex* outVertices, CullPath path = DEFAULT_CULL_PATH);
+
+// Decode through the shared shader functions, with the bitangent rebuilt from normal, tangent and sign
+VertexData UnpackVertex(const ShaderInterop::PackedVertex& vertex);
+VertexData UnpackVertex(const ShaderInterop::QuantizedVertex& vertex, const ShaderInterop::BoundsQuantization& quantization);
@@ -2,8 +2,9 @@
 
 #include "System/SystemWindow.h"
 
-int main()
+// The optional argument is the cooked model to draw, as written by AssetCooker
+int main(int argc, char** argv)
 {
     SystemWindow window;
-    return window.WinMain(GetModuleHandle(NULL), NULL, NULL, SW_SHOWDEFAULT);
+    return window.WinMain(GetModuleHandle(NULL), NULL, argc > 1 ? argv[1] : NULL, SW_SHOWDEFAULT);
 }
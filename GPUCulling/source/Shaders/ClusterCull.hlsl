@@ -0,0 +1,53 @@
+#include "ClusterCullingShared.h"
+
+// Cluster backface cone and small primitive culling. The tests are the ones ClusterCuller runs on the CPU.
+// g_visibleClusters[0] is the count of surviving clusters, followed by their indices.
+
+#define CLUSTER_CULL_ROOT_SIGNATURE \
+    "RootConstants(num32BitConstants=28, b0)," \
+    "SRV(t0)," \
+    "UAV(u0)"
+
+// Plain cbuffer so the constants can be passed to the shared functions as a struct
+cbuffer ClusterCullConstantBuffer : register(b0)
+{
+    ClusterCullConstants g_constants;
+};
+
+StructuredBuffer<ClusterBounds> g_clusters : register(t0);
+RWStructuredBuffer<uint> g_visibleClusters : register(u0);
+
+[RootSignature(CLUSTER_CULL_ROOT_SIGNATURE)]
+[numthreads(CLUSTER_CULL_GROUP_SIZE, 1, 1)]
+void CSMain(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    uint clusterIndex = dispatchThreadId.x;
+    if (clusterIndex >= g_constants.clusterCount)
+    {
+        return;
+    }
+
+    ClusterBounds cluster = g_clusters[clusterIndex];
+    bool culled = false;
+
+    if (g_constants.cullFlags & CLUSTER_CULL_BACKFACE)
+    {
+        culled = IsClusterBackfacing(
+            cluster.coneApex.x, cluster.coneApex.y, cluster.coneApex.z,
+            cluster.coneAxis.x, cluster.coneAxis.y, cluster.coneAxis.z,
+            cluster.coneCutoff, g_constants.cameraPosition);
+    }
+
+    if (!culled && (g_constants.cullFlags & CLUSTER_CULL_SMALL_PRIMITIVE))
+    {
+        float3 viewCenter = mul(float4(cluster.center, 1.0f), g_constants.view).xyz;
+        culled = IsClusterBetweenSamples(viewCenter.x, viewCenter.y, viewCenter.z, cluster.radius, g_constants);
+    }
+
+    if (!culled)
+    {
+        uint slot;
+        InterlockedAdd(g_visibleClusters[0], 1, slot);
+        g_visibleClusters[slot + 1] = clusterIndex;
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef CLUSTER_CULLING_SHARED_H
+#define CLUSTER_CULLING_SHARED_H
+
+#include "ShaderInterop.h"
+
+SHADER_INTEROP_BEGIN
+
+static const uint CLUSTER_CULL_GROUP_SIZE = 64;
+
+static const uint CLUSTER_CULL_BACKFACE = 1;
+static const uint CLUSTER_CULL_SMALL_PRIMITIVE = 2;
+
+struct ClusterCullConstants
+{
+    // Transposed on upload so HLSL's default column major packing reads back the row vector matrix
+    float4x4 view;
+    float3 cameraPosition;
+    // Projection matrix _11 and _22
+    float projectionScaleX;
+    float2 viewportSize;
+    float projectionScaleY;
+    float nearPlane;
+    uint clusterCount;
+    uint cullFlags;
+    uint2 padding;
+};
+
+struct ClusterBounds
+{
+    float3 center;
+    float radius;
+    float3 coneApex;
+    float coneCutoff;
+    float3 coneAxis;
+    float padding;
+};
+
+// True when every triangle of the cluster faces away from the camera (see Meshlet::coneCutoff)
+LANE_TEMPLATE
+lane_bool IsClusterBackfacing(lane_float apexX, lane_float apexY, lane_float apexZ,
+    lane_float axisX, lane_float axisY, lane_float axisZ, lane_float cutoff, float3 cameraPosition)
+{
+    lane_float dx = apexX - cameraPosition.x;
+    lane_float dy = apexY - cameraPosition.y;
+    lane_float dz = apexZ - cameraPosition.z;
+    lane_float distance = sqrt(dx * dx + dy * dy + dz * dz);
+    return dx * axisX + dy * axisY + dz * axisZ >= cutoff * distance;
+}
+
+// One bound of the tight perspective projection of a view space sphere along view x or y (Mara and McGuire 2013),
+// divided by view z. tangent is sqrt(viewAxis^2 + viewZ^2 - radius^2), side is -1 for the lower bound and 1 for the
+// upper one.
+LANE_TEMPLATE
+lane_float GetSphereProjectionBound(lane_float viewAxis, lane_float viewZ, lane_float radius, lane_float tangent, float side)
+{
+    return (tangent * viewAxis + side * radius * viewZ) / (tangent * viewZ - side * radius * viewAxis);
+}
+
+// True when the screen rectangle of a view space sphere contains no pixel sample centre, so the cluster cannot
+// produce a single fragment
+LANE_TEMPLATE
+lane_bool IsClusterBetweenSamples(lane_float viewX, lane_float viewY, lane_float viewZ, lane_float radius,
+    ClusterCullConstants constants)
+{
+    // Spheres crossing the near plane have no bounded projection, the rest of the math is masked off for them
+    lane_bool projectable = viewZ - radius > constants.nearPlane;
+
+    lane_float radiusSquared = radius * radius;
+    lane_float tangentX = sqrt(viewX * viewX + viewZ * viewZ - radiusSquared);
+    lane_float tangentY = sqrt(viewY * viewY + viewZ * viewZ - radiusSquared);
+
+    lane_float minX = LANE_CALL(GetSphereProjectionBound)(viewX, viewZ, radius, tangentX, -1.0f);
+    lane_float maxX = LANE_CALL(GetSphereProjectionBound)(viewX, viewZ, radius, tangentX, 1.0f);
+    lane_float minY = LANE_CALL(GetSphereProjectionBound)(viewY, viewZ, radius, tangentY, -1.0f);
+    lane_float maxY = LANE_CALL(GetSphereProjectionBound)(viewY, viewZ, radius, tangentY, 1.0f);
+
+    // Pixel space with y pointing down
+    lane_float pixelMinX = (minX * constants.projectionScaleX * 0.5f + 0.5f) * constants.viewportSize.x;
+    lane_float pixelMaxX = (maxX * constants.projectionScaleX * 0.5f + 0.5f) * constants.viewportSize.x;
+    lane_float pixelMinY = (0.5f - maxY * constants.projectionScaleY * 0.5f) * constants.viewportSize.y;
+    lane_float pixelMaxY = (0.5f - minY * constants.projectionScaleY * 0.5f) * constants.viewportSize.y;
+
+    // Sample centres sit at integer + 0.5, one on the rectangle edge counts as covered
+    lane_bool missesX = ceil(pixelMinX - 0.5f) > floor(pixelMaxX - 0.5f);
+    lane_bool missesY = ceil(pixelMinY - 0.5f) > floor(pixelMaxY - 0.5f);
+    return projectable && (missesX || missesY);
+}
+
+SHADER_INTEROP_END
+
+#endif // CLUSTER_CULLING_SHARED_H
@@ -0,0 +1,29 @@
+#ifndef GEOMETRY_POOL_SHARED_H
+#define GEOMETRY_POOL_SHARED_H
+
+#include "ShaderInterop.h"
+
+SHADER_INTEROP_BEGIN
+
+// Where one mesh lives in the scene geometry pool, 64 bytes. Vertices are in the shared vertex buffer, indices in the
+// index buffer of indexFormat and relative to baseVertex, so a draw of LOD 0 is fully described by the descriptor.
+struct GeometryDescriptor
+{
+    // Object space bounds
+    float3 boundsMin;
+    uint baseVertex;
+    float3 boundsMax;
+    uint vertexCount;
+    float3 sphereCenter;
+    float sphereRadius;
+    // LOD 0, coarser levels follow it in the same index range
+    uint firstIndex;
+    uint indexCount;
+    // IndexFormat, 0 for 16-bit and 1 for 32-bit
+    uint indexFormat;
+    uint lodCount;
+};
+
+SHADER_INTEROP_END
+
+#endif // GEOMETRY_POOL_SHARED_H
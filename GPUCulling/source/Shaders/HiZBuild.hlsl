@@ -0,0 +1,50 @@
+#include "HiZShared.h"
+
+// Builds one level of the Hi-Z pyramid. Mirrors HiZPyramid::Build / HiZPyramid::ReduceLevel:
+// when source and destination sizes match this is the level 0 copy, otherwise each texel keeps the
+// farthest depth of its 2x2 footprint, widened to 3 texels at the odd edge of the source.
+
+#define HIZ_BUILD_ROOT_SIGNATURE \
+    "RootConstants(num32BitConstants=4, b0)," \
+    "DescriptorTable(SRV(t0))," \
+    "DescriptorTable(UAV(u0))"
+
+ConstantBuffer<HiZBuildConstants> g_constants : register(b0);
+Texture2D<float> g_source : register(t0);
+RWTexture2D<float> g_destination : register(u0);
+
+[RootSignature(HIZ_BUILD_ROOT_SIGNATURE)]
+[numthreads(HIZ_BUILD_GROUP_SIZE, HIZ_BUILD_GROUP_SIZE, 1)]
+void CSMain(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    uint2 texel = dispatchThreadId.xy;
+    if (any(texel >= g_constants.destinationSize))
+    {
+        return;
+    }
+
+    uint2 sourceSize = g_constants.sourceSize;
+    if (all(sourceSize == g_constants.destinationSize))
+    {
+        g_destination[texel] = g_source.Load(int3(texel, 0));
+        return;
+    }
+
+    bool extraColumn = (sourceSize.x & 1) != 0 && sourceSize.x > 1;
+    bool extraRow = (sourceSize.y & 1) != 0 && sourceSize.y > 1;
+    uint footprintWidth = (extraColumn && texel.x == g_constants.destinationSize.x - 1) ? 3 : 2;
+    uint footprintHeight = (extraRow && texel.y == g_constants.destinationSize.y - 1) ? 3 : 2;
+
+    float farthest = 0.0f;
+    for (uint dy = 0; dy < footprintHeight; ++dy)
+    {
+        uint sy = min(texel.y * 2 + dy, sourceSize.y - 1);
+        for (uint dx = 0; dx < footprintWidth; ++dx)
+        {
+            uint sx = min(texel.x * 2 + dx, sourceSize.x - 1);
+            farthest = max(farthest, g_source.Load(int3(sx, sy, 0)));
+        }
+    }
+
+    g_destination[texel] = farthest;
+}
@@ -0,0 +1,108 @@
+#include "HiZShared.h"
+
+// Tests every instance against the Hi-Z pyramid. Mirrors HiZPyramid::IsVisible and HiZPyramid::CullInstances.
+// g_visibility holds last frame's flags on entry (HIZ_VISIBLE marks the set phase one already drew) and this frame's
+// on exit. g_newlyVisible[0] is the count of instances phase two has to draw, followed by their indices.
+
+#define HIZ_CULL_ROOT_SIGNATURE \
+    "RootConstants(num32BitConstants=20, b0)," \
+    "SRV(t0)," \
+    "DescriptorTable(SRV(t1))," \
+    "UAV(u0)," \
+    "UAV(u1)"
+
+ConstantBuffer<HiZCullConstants> g_constants : register(b0);
+StructuredBuffer<InstanceBounds> g_instanceBounds : register(t0);
+Texture2D<float> g_hiZ : register(t1);
+RWStructuredBuffer<uint> g_visibility : register(u0);
+RWStructuredBuffer<uint> g_newlyVisible : register(u1);
+
+bool IsVisible(InstanceBounds bounds)
+{
+    float2 uvMin = float2(3.402823466e+38f, 3.402823466e+38f);
+    float2 uvMax = -uvMin;
+    float zMin = 3.402823466e+38f;
+
+    [unroll]
+    for (uint corner = 0; corner < 8; ++corner)
+    {
+        float3 position = float3(
+            (corner & 1) ? bounds.boundsMax.x : bounds.boundsMin.x,
+            (corner & 2) ? bounds.boundsMax.y : bounds.boundsMin.y,
+            (corner & 4) ? bounds.boundsMax.z : bounds.boundsMin.z);
+
+        float4 clip = mul(float4(position, 1.0f), g_constants.viewProjection);
+        if (clip.w <= 0.0f)
+        {
+            return true;
+        }
+
+        float invW = 1.0f / clip.w;
+        float2 uv = float2(clip.x * invW * 0.5f + 0.5f, clip.y * invW * -0.5f + 0.5f);
+        uvMin = min(uvMin, uv);
+        uvMax = max(uvMax, uv);
+        zMin = min(zMin, clip.z * invW);
+    }
+
+    if (any(uvMax < 0.0f) || any(uvMin > 1.0f) || zMin > 1.0f)
+    {
+        return false;
+    }
+
+    uvMin = saturate(uvMin);
+    uvMax = saturate(uvMax);
+
+    // The rectangle is found once on level 0 and carried down the footprints of the reduction, so every level covers
+    // at least the texels the level 0 rectangle does. Walk down to the first level where it touches at most 2x2 texels.
+    uint2 baseMin = min(uint2(floor(uvMin * float2(g_constants.hiZSize))), g_constants.hiZSize - 1);
+    uint2 baseMax = min(uint2(floor(uvMax * float2(g_constants.hiZSize))), g_constants.hiZSize - 1);
+
+    uint mip = 0;
+    uint2 levelSize = g_constants.hiZSize;
+    uint2 texelMin;
+    uint2 texelMax;
+    for (;;)
+    {
+        texelMin = uint2(GetHiZTexel(baseMin.x, mip, levelSize.x), GetHiZTexel(baseMin.y, mip, levelSize.y));
+        texelMax = uint2(GetHiZTexel(baseMax.x, mip, levelSize.x), GetHiZTexel(baseMax.y, mip, levelSize.y));
+        if (all(texelMax - texelMin <= 1) || mip + 1 == g_constants.mipCount)
+        {
+            break;
+        }
+        ++mip;
+        levelSize = max(levelSize >> 1, 1);
+    }
+
+    float farthest = 0.0f;
+    for (uint y = texelMin.y; y <= texelMax.y; ++y)
+    {
+        for (uint x = texelMin.x; x <= texelMax.x; ++x)
+        {
+            farthest = max(farthest, g_hiZ.Load(int3(x, y, mip)));
+        }
+    }
+
+    return zMin <= farthest;
+}
+
+[RootSignature(HIZ_CULL_ROOT_SIGNATURE)]
+[numthreads(HIZ_CULL_GROUP_SIZE, 1, 1)]
+void CSMain(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    uint instanceIndex = dispatchThreadId.x;
+    if (instanceIndex >= g_constants.instanceCount)
+    {
+        return;
+    }
+
+    uint flags = IsVisible(g_instanceBounds[instanceIndex]) ? HIZ_VISIBLE : 0;
+    if (flags != 0 && (g_visibility[instanceIndex] & HIZ_VISIBLE) == 0)
+    {
+        flags |= HIZ_NEWLY_VISIBLE;
+
+        uint slot;
+        InterlockedAdd(g_newlyVisible[0], 1, slot);
+        g_newlyVisible[slot + 1] = instanceIndex;
+    }
+    g_visibility[instanceIndex] = flags;
+}
@@ -0,0 +1,49 @@
+#ifndef HIZ_SHARED_H
+#define HIZ_SHARED_H
+
+#include "ShaderInterop.h"
+
+SHADER_INTEROP_BEGIN
+
+static const uint HIZ_BUILD_GROUP_SIZE = 8;
+static const uint HIZ_CULL_GROUP_SIZE = 64;
+
+// Per instance flags the cull writes into the visibility buffer. Phase one of the next frame draws the visible
+// instances, phase two of this frame the newly visible ones, which failed the previous cull.
+static const uint HIZ_VISIBLE = 1;
+static const uint HIZ_NEWLY_VISIBLE = 2;
+
+struct HiZBuildConstants
+{
+    uint2 sourceSize;
+    uint2 destinationSize;
+};
+
+struct HiZCullConstants
+{
+    // Transposed on upload so HLSL's default column major packing reads back the row vector matrix
+    float4x4 viewProjection;
+    uint2 hiZSize;
+    uint mipCount;
+    uint instanceCount;
+};
+
+// Texel of the given mip that covers texel levelZeroTexel of level 0. Reduction halves rounding down and folds an
+// odd trailing row/column into the last texel, so shifting down and clamping to the last texel follows the footprints
+// exactly. Scaling the uv by the level size instead misses texels of odd sized levels.
+SHARED_FUNCTION uint GetHiZTexel(uint levelZeroTexel, uint mip, uint levelSize)
+{
+    return min(levelZeroTexel >> mip, levelSize - 1);
+}
+
+struct InstanceBounds
+{
+    float3 boundsMin;
+    float padding0;
+    float3 boundsMax;
+    float padding1;
+};
+
+SHADER_INTEROP_END
+
+#endif // HIZ_SHARED_H
@@ -0,0 +1,148 @@
+#include "IndirectDrawShared.h"
+
+// GPU driven draw generation, mirrors IndirectDrawBuilder::Build step by step so the argument buffer is byte identical:
+// CSCountVisible  per group count of the instances inside the frustum
+// CSScanGroups    exclusive prefix sum of the group counts, writes the draw count
+// CSWriteDraws    compacts the visible instances into draw arguments in ascending instance order
+// The Hi-Z visibility buffer stays in the unordered access state the cull writes it in, so it is bound as a UAV and
+// only read here.
+
+#define INDIRECT_DRAW_ROOT_SIGNATURE \
+    "RootConstants(num32BitConstants=40, b0)," \
+    "SRV(t0)," \
+    "SRV(t1)," \
+    "UAV(u0)," \
+    "UAV(u1)," \
+    "UAV(u2)"
+
+ConstantBuffer<IndirectDrawConstants> g_constants : register(b0);
+StructuredBuffer<DrawInstance> g_instances : register(t0);
+StructuredBuffer<GeometryDescriptor> g_geometry : register(t1);
+RWStructuredBuffer<uint> g_groupOffsets : register(u0);
+RWStructuredBuffer<uint> g_drawArguments : register(u1);
+RWStructuredBuffer<uint> g_visibility : register(u2);
+
+groupshared uint gs_visibleCount;
+groupshared uint gs_visibleSums[INDIRECT_DRAW_GROUP_SIZE];
+groupshared uint gs_partialSums[INDIRECT_DRAW_SCAN_GROUP_SIZE];
+
+// The visibility buffer is only read while a mask is set, nothing may be bound to it otherwise
+uint GetVisibilityFlags(DrawInstance instance)
+{
+    if (g_constants.visibilityMask == 0 || instance.visibilityIndex >= g_constants.visibilityCount)
+    {
+        return HIZ_VISIBLE;
+    }
+    return g_visibility[instance.visibilityIndex];
+}
+
+// The descriptor is only read for handles inside the buffer
+bool IsInstanceVisible(uint instanceIndex)
+{
+    if (instanceIndex >= g_constants.instanceCount)
+    {
+        return false;
+    }
+
+    DrawInstance instance = g_instances[instanceIndex];
+    uint meshHandle = min(instance.meshHandle, max(g_constants.geometryCount, 1) - 1);
+    return IsDrawInstanceResident(instance, g_geometry[meshHandle], g_constants) &&
+        IsDrawInstanceSelected(GetVisibilityFlags(instance), g_constants) && IsDrawInstanceVisible(instance, g_constants);
+}
+
+[RootSignature(INDIRECT_DRAW_ROOT_SIGNATURE)]
+[numthreads(INDIRECT_DRAW_GROUP_SIZE, 1, 1)]
+void CSCountVisible(uint3 dispatchThreadId : SV_DispatchThreadID, uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+    if (groupIndex == 0)
+    {
+        gs_visibleCount = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (IsInstanceVisible(dispatchThreadId.x))
+    {
+        InterlockedAdd(gs_visibleCount, 1);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (groupIndex == 0)
+    {
+        g_groupOffsets[groupId.x] = gs_visibleCount;
+    }
+}
+
+[RootSignature(INDIRECT_DRAW_ROOT_SIGNATURE)]
+[numthreads(INDIRECT_DRAW_SCAN_GROUP_SIZE, 1, 1)]
+void CSScanGroups(uint groupIndex : SV_GroupIndex)
+{
+    uint chunkSize = (g_constants.groupCount + INDIRECT_DRAW_SCAN_GROUP_SIZE - 1) / INDIRECT_DRAW_SCAN_GROUP_SIZE;
+    uint chunkBegin = min(groupIndex * chunkSize, g_constants.groupCount);
+    uint chunkEnd = min(chunkBegin + chunkSize, g_constants.groupCount);
+
+    uint chunkSum = 0;
+    for (uint i = chunkBegin; i < chunkEnd; ++i)
+    {
+        chunkSum += g_groupOffsets[i];
+    }
+
+    gs_partialSums[groupIndex] = chunkSum;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Inclusive Hillis-Steele scan over the chunk sums
+    for (uint stride = 1; stride < INDIRECT_DRAW_SCAN_GROUP_SIZE; stride <<= 1)
+    {
+        uint addend = groupIndex >= stride ? gs_partialSums[groupIndex - stride] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        gs_partialSums[groupIndex] += addend;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint offset = gs_partialSums[groupIndex] - chunkSum;
+    for (uint j = chunkBegin; j < chunkEnd; ++j)
+    {
+        uint count = g_groupOffsets[j];
+        g_groupOffsets[j] = offset;
+        offset += count;
+    }
+
+    if (groupIndex == INDIRECT_DRAW_SCAN_GROUP_SIZE - 1)
+    {
+        g_drawArguments[INDIRECT_DRAW_COUNT_OFFSET / 4] = gs_partialSums[groupIndex];
+    }
+}
+
+[RootSignature(INDIRECT_DRAW_ROOT_SIGNATURE)]
+[numthreads(INDIRECT_DRAW_GROUP_SIZE, 1, 1)]
+void CSWriteDraws(uint3 dispatchThreadId : SV_DispatchThreadID, uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+    uint instanceIndex = dispatchThreadId.x;
+    uint visible = IsInstanceVisible(instanceIndex) ? 1 : 0;
+
+    // Inclusive Hillis-Steele scan of the visibility flags keeps the instance order inside the group
+    gs_visibleSums[groupIndex] = visible;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint stride = 1; stride < INDIRECT_DRAW_GROUP_SIZE; stride <<= 1)
+    {
+        uint addend = groupIndex >= stride ? gs_visibleSums[groupIndex - stride] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        gs_visibleSums[groupIndex] += addend;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (visible == 0)
+    {
+        return;
+    }
+
+    uint drawIndex = g_groupOffsets[groupId.x] + gs_visibleSums[groupIndex] - 1;
+    DrawInstance instance = g_instances[instanceIndex];
+    DrawIndexedArguments arguments = MakeDrawArguments(instance, g_geometry[instance.meshHandle], instanceIndex);
+
+    uint base = INDIRECT_DRAW_ARGUMENTS_OFFSET / 4 + drawIndex * INDIRECT_DRAW_ARGUMENT_UINTS;
+    g_drawArguments[base + 0] = arguments.indexCountPerInstance;
+    g_drawArguments[base + 1] = arguments.instanceCount;
+    g_drawArguments[base + 2] = arguments.startIndexLocation;
+    g_drawArguments[base + 3] = asuint(arguments.baseVertexLocation);
+    g_drawArguments[base + 4] = arguments.startInstanceLocation;
+}
@@ -0,0 +1,115 @@
+#ifndef INDIRECT_DRAW_SHARED_H
+#define INDIRECT_DRAW_SHARED_H
+
+#include "ShaderInterop.h"
+#include "QuantizedBoundsShared.h"
+#include "GeometryPoolShared.h"
+#include "HiZShared.h"
+
+SHADER_INTEROP_BEGIN
+
+static const uint INDIRECT_DRAW_GROUP_SIZE = 64;
+static const uint INDIRECT_DRAW_SCAN_GROUP_SIZE = 1024;
+
+// The argument buffer holds the draw count in uint 0 followed by one DrawIndexedArguments per visible instance
+static const uint INDIRECT_DRAW_COUNT_OFFSET = 0;
+static const uint INDIRECT_DRAW_ARGUMENTS_OFFSET = 4;
+static const uint INDIRECT_DRAW_ARGUMENT_UINTS = 5;
+
+struct IndirectDrawConstants
+{
+    // Frustum planes as (normal, distance) with the normal pointing inside, see Frustum
+    float4 frustumPlanes[6];
+    // Cell the instance bounds are quantized in, usually the scene bounds
+    BoundsQuantization boundsQuantization;
+    uint instanceCount;
+    uint groupCount;
+    // Descriptors in the geometry buffer, instances of meshes outside it are never drawn
+    uint geometryCount;
+    // Hi-Z flags an instance needs one of to be drawn, HIZ_VISIBLE for phase one and HIZ_NEWLY_VISIBLE for phase two.
+    // Zero draws every instance in the frustum and leaves the visibility buffer unread.
+    uint visibilityMask;
+    // Flags in the visibility buffer
+    uint visibilityCount;
+    uint3 padding;
+};
+
+// One drawable instance: its quantized world space bounds and the part of a pooled mesh it draws, 32 bytes. Where the
+// mesh lives is read from its GeometryDescriptor when the draw is written, so the pool can move meshes around.
+struct DrawInstance
+{
+    QuantizedBounds bounds;
+    // GeometryPool mesh handle, indexes the geometry descriptors
+    uint meshHandle;
+    // Relative to the mesh's first index, e.g. the range of one level of detail
+    uint firstIndex;
+    uint indexCount;
+    // Slot of the instance in the Hi-Z visibility buffer, its index in the HiZOcclusionPass instance bounds
+    uint visibilityIndex;
+};
+
+// Per instance vertex stream of the draws, 96 bytes: the object to world matrix and the frame the positions of the
+// instance's mesh are quantized in, see GeometryPool::GetVertexQuantization
+struct DrawInstanceTransform
+{
+    // Row vector convention, rows are read as four float4 elements
+    float4x4 world;
+    BoundsQuantization vertexQuantization;
+};
+
+// Matches D3D12_DRAW_INDEXED_ARGUMENTS member for member
+struct DrawIndexedArguments
+{
+    uint indexCountPerInstance;
+    uint instanceCount;
+    uint startIndexLocation;
+    int baseVertexLocation;
+    uint startInstanceLocation;
+};
+
+// Removed meshes keep their handle's descriptor slot zeroed until it is reused
+SHARED_FUNCTION bool IsDrawInstanceResident(DrawInstance instance, GeometryDescriptor geometry, IndirectDrawConstants constants)
+{
+    return instance.meshHandle < constants.geometryCount && geometry.indexCount != 0;
+}
+
+// Instances without a visibility slot count as visible, phase one draws them and phase two never does
+SHARED_FUNCTION bool IsDrawInstanceSelected(uint visibilityFlags, IndirectDrawConstants constants)
+{
+    return constants.visibilityMask == 0 || (visibilityFlags & constants.visibilityMask) != 0;
+}
+
+// Sphere test, then positive vertex test of the decoded box against every plane. Same evaluation order on both sides
+// so the draw lists match bit for bit.
+SHARED_FUNCTION bool IsDrawInstanceVisible(DrawInstance instance, IndirectDrawConstants constants)
+{
+    float3 boundsMin = GetQuantizedBoundsMin(instance.bounds, constants.boundsQuantization);
+    float3 boundsMax = GetQuantizedBoundsMax(instance.bounds, constants.boundsQuantization);
+    float3 center = GetQuantizedBoundsCenter(instance.bounds, constants.boundsQuantization);
+    float radius = GetQuantizedBoundsRadius(instance.bounds);
+
+    for (uint p = 0; p < 6; ++p)
+    {
+        float4 plane = constants.frustumPlanes[p];
+        PRECISE float centerDistance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+        PRECISE float distance = plane.x * (plane.x >= 0.0f ? boundsMax.x : boundsMin.x) +
+            plane.y * (plane.y >= 0.0f ? boundsMax.y : boundsMin.y) +
+            plane.z * (plane.z >= 0.0f ? boundsMax.z : boundsMin.z) + plane.w;
+        if (centerDistance < -radius || distance < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The start instance carries the instance index, vertex shaders read it from a per instance stream
+SHARED_FUNCTION DrawIndexedArguments MakeDrawArguments(DrawInstance instance, GeometryDescriptor geometry, uint instanceIndex)
+{
+    DrawIndexedArguments arguments = { instance.indexCount, 1, geometry.firstIndex + instance.firstIndex, int(geometry.baseVertex), instanceIndex };
+    return arguments;
+}
+
+SHADER_INTEROP_END
+
+#endif // INDIRECT_DRAW_SHARED_H
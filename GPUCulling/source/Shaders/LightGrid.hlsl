@@ -0,0 +1,213 @@
+#include "LightGridShared.h"
+#include "LightShared.h"
+
+// Clustered light grid builder, mirrors LightGrid::Build step by step so the output is byte identical:
+// CSLightRanges  per light cluster range (LightGrid::ComputeLightRanges)
+// CSCountLights  per cluster light count
+// CSScanCells    exclusive prefix sum into offsets, clamped to the index capacity
+// CSFillLights   per cluster light indices in ascending light order
+
+#define LIGHT_GRID_ROOT_SIGNATURE \
+    "RootConstants(num32BitConstants=20, b0)," \
+    "SRV(t0)," \
+    "SRV(t1)," \
+    "UAV(u0)," \
+    "UAV(u1)," \
+    "UAV(u2)"
+
+ConstantBuffer<LightGridConstants> g_constants : register(b0);
+StructuredBuffer<LightData> g_lights : register(t0);
+StructuredBuffer<LightGridBoundary> g_boundaries : register(t1);
+RWStructuredBuffer<LightClusterRange> g_lightRanges : register(u0);
+RWStructuredBuffer<LightGridCell> g_cells : register(u1);
+RWStructuredBuffer<uint> g_lightIndices : register(u2);
+
+groupshared LightClusterRange gs_ranges[LIGHT_GRID_GROUP_SIZE];
+groupshared uint gs_partialSums[LIGHT_GRID_SCAN_GROUP_SIZE];
+
+uint PackRange(uint first, uint last)
+{
+    return first <= last ? (first | (last << 16)) : LIGHT_RANGE_EMPTY;
+}
+
+bool RangeContains(uint range, uint value)
+{
+    return value >= (range & 0xFFFF) && value <= (range >> 16);
+}
+
+bool RangeContainsCluster(LightClusterRange range, uint3 cluster)
+{
+    return RangeContains(range.columns, cluster.x) && RangeContains(range.rows, cluster.y) && RangeContains(range.slices, cluster.z);
+}
+
+uint3 GetClusterCoordinates(uint clusterIndex)
+{
+    uint sliceSize = g_constants.gridSize.x * g_constants.gridSize.y;
+    uint slice = clusterIndex / sliceSize;
+    uint tile = clusterIndex - slice * sliceSize;
+    return uint3(tile % g_constants.gridSize.x, tile / g_constants.gridSize.x, slice);
+}
+
+// Stages the next batch of light ranges in group shared memory, every thread of the group has to call it
+uint LoadRangeBatch(uint batchBegin, uint groupIndex)
+{
+    uint lightIndex = batchBegin + groupIndex;
+    LightClusterRange empty = { LIGHT_RANGE_EMPTY, LIGHT_RANGE_EMPTY, LIGHT_RANGE_EMPTY };
+    gs_ranges[groupIndex] = lightIndex < g_constants.lightCount ? g_lightRanges[lightIndex] : empty;
+    GroupMemoryBarrierWithGroupSync();
+    return min(LIGHT_GRID_GROUP_SIZE, g_constants.lightCount - batchBegin);
+}
+
+[RootSignature(LIGHT_GRID_ROOT_SIGNATURE)]
+[numthreads(LIGHT_GRID_GROUP_SIZE, 1, 1)]
+void CSLightRanges(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    uint lightIndex = dispatchThreadId.x;
+    if (lightIndex >= g_constants.lightCount)
+    {
+        return;
+    }
+
+    LightData light = g_lights[lightIndex];
+    float viewX = TransformToView(light.cullCenter.x, light.cullCenter.y, light.cullCenter.z, g_constants.viewColumnX);
+    float viewY = TransformToView(light.cullCenter.x, light.cullCenter.y, light.cullCenter.z, g_constants.viewColumnY);
+    float viewZ = TransformToView(light.cullCenter.x, light.cullCenter.y, light.cullCenter.z, g_constants.viewColumnZ);
+    float radius = light.cullRadius;
+
+    uint3 first = uint3(0xFFFF, 0xFFFF, 0xFFFF);
+    uint3 last = uint3(0, 0, 0);
+
+    for (uint slice = 0; slice < g_constants.gridSize.z; ++slice)
+    {
+        if (SphereOverlapsSlice(viewZ, radius, g_boundaries[slice].sliceDepth, g_boundaries[slice + 1].sliceDepth))
+        {
+            first.z = min(first.z, slice);
+            last.z = slice;
+        }
+    }
+
+    float lowDistance = TileBoundaryDistance(viewX, viewZ, g_boundaries[0].columnPlane);
+    for (uint column = 0; column < g_constants.gridSize.x; ++column)
+    {
+        float highDistance = TileBoundaryDistance(viewX, viewZ, g_boundaries[column + 1].columnPlane);
+        if (SphereOverlapsTileSlab(lowDistance, highDistance, radius))
+        {
+            first.x = min(first.x, column);
+            last.x = column;
+        }
+        lowDistance = highDistance;
+    }
+
+    lowDistance = TileBoundaryDistance(viewY, viewZ, g_boundaries[0].rowPlane);
+    for (uint row = 0; row < g_constants.gridSize.y; ++row)
+    {
+        float highDistance = TileBoundaryDistance(viewY, viewZ, g_boundaries[row + 1].rowPlane);
+        if (SphereOverlapsTileSlab(lowDistance, highDistance, radius))
+        {
+            first.y = min(first.y, row);
+            last.y = row;
+        }
+        lowDistance = highDistance;
+    }
+
+    LightClusterRange range = { LIGHT_RANGE_EMPTY, LIGHT_RANGE_EMPTY, LIGHT_RANGE_EMPTY };
+    if (all(first <= last))
+    {
+        range.columns = PackRange(first.x, last.x);
+        range.rows = PackRange(first.y, last.y);
+        range.slices = PackRange(first.z, last.z);
+    }
+    g_lightRanges[lightIndex] = range;
+}
+
+[RootSignature(LIGHT_GRID_ROOT_SIGNATURE)]
+[numthreads(LIGHT_GRID_GROUP_SIZE, 1, 1)]
+void CSCountLights(uint3 dispatchThreadId : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+    uint clusterIndex = dispatchThreadId.x;
+    uint3 cluster = GetClusterCoordinates(clusterIndex);
+
+    // Threads past the last cluster keep loading batches for the group barrier
+    uint count = 0;
+    for (uint batchBegin = 0; batchBegin < g_constants.lightCount; batchBegin += LIGHT_GRID_GROUP_SIZE)
+    {
+        uint batchCount = LoadRangeBatch(batchBegin, groupIndex);
+        for (uint i = 0; i < batchCount; ++i)
+        {
+            count += RangeContainsCluster(gs_ranges[i], cluster) ? 1 : 0;
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (clusterIndex < g_constants.clusterCount)
+    {
+        g_cells[clusterIndex].count = count;
+    }
+}
+
+[RootSignature(LIGHT_GRID_ROOT_SIGNATURE)]
+[numthreads(LIGHT_GRID_SCAN_GROUP_SIZE, 1, 1)]
+void CSScanCells(uint groupIndex : SV_GroupIndex)
+{
+    uint chunkSize = (g_constants.clusterCount + LIGHT_GRID_SCAN_GROUP_SIZE - 1) / LIGHT_GRID_SCAN_GROUP_SIZE;
+    uint chunkBegin = min(groupIndex * chunkSize, g_constants.clusterCount);
+    uint chunkEnd = min(chunkBegin + chunkSize, g_constants.clusterCount);
+
+    uint chunkSum = 0;
+    for (uint i = chunkBegin; i < chunkEnd; ++i)
+    {
+        chunkSum += g_cells[i].count;
+    }
+
+    gs_partialSums[groupIndex] = chunkSum;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Inclusive Hillis-Steele scan over the chunk sums
+    for (uint stride = 1; stride < LIGHT_GRID_SCAN_GROUP_SIZE; stride <<= 1)
+    {
+        uint addend = groupIndex >= stride ? gs_partialSums[groupIndex - stride] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        gs_partialSums[groupIndex] += addend;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    // Offsets follow the unclamped counts so a truncated cluster never shifts the ones after it
+    uint offset = gs_partialSums[groupIndex] - chunkSum;
+    for (uint j = chunkBegin; j < chunkEnd; ++j)
+    {
+        uint count = g_cells[j].count;
+        uint capacity = offset < g_constants.maxLightIndices ? g_constants.maxLightIndices - offset : 0;
+        g_cells[j].offset = offset;
+        g_cells[j].count = min(count, capacity);
+        offset += count;
+    }
+}
+
+[RootSignature(LIGHT_GRID_ROOT_SIGNATURE)]
+[numthreads(LIGHT_GRID_GROUP_SIZE, 1, 1)]
+void CSFillLights(uint3 dispatchThreadId : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+    uint clusterIndex = dispatchThreadId.x;
+    uint3 cluster = GetClusterCoordinates(clusterIndex);
+
+    LightGridCell cell = { 0, 0 };
+    if (clusterIndex < g_constants.clusterCount)
+    {
+        cell = g_cells[clusterIndex];
+    }
+
+    uint written = 0;
+    for (uint batchBegin = 0; batchBegin < g_constants.lightCount; batchBegin += LIGHT_GRID_GROUP_SIZE)
+    {
+        uint batchCount = LoadRangeBatch(batchBegin, groupIndex);
+        for (uint i = 0; i < batchCount; ++i)
+        {
+            if (written < cell.count && RangeContainsCluster(gs_ranges[i], cluster))
+            {
+                g_lightIndices[cell.offset + written] = batchBegin + i;
+                ++written;
+            }
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+}
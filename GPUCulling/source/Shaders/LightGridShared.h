@@ -0,0 +1,93 @@
+#ifndef LIGHT_GRID_SHARED_H
+#define LIGHT_GRID_SHARED_H
+
+#include "ShaderInterop.h"
+
+SHADER_INTEROP_BEGIN
+
+static const uint LIGHT_GRID_GROUP_SIZE = 64;
+static const uint LIGHT_GRID_SCAN_GROUP_SIZE = 1024;
+
+// Per axis limits. Every light is tested against each boundary of an axis, so these bound the range pass cost as
+// well as the cluster count.
+static const uint LIGHT_GRID_MAX_TILES = 64;
+static const uint LIGHT_GRID_MAX_SLICES = 64;
+
+// Packed range with min 0xFFFF above max 0, contains nothing
+static const uint LIGHT_RANGE_EMPTY = 0x0000FFFF;
+
+struct LightGridConstants
+{
+    // Columns of the row vector view matrix, a view space coordinate is dot(float4(world, 1), column)
+    float4 viewColumnX;
+    float4 viewColumnY;
+    float4 viewColumnZ;
+    // Tiles along x and y, exponential depth slices along z
+    uint3 gridSize;
+    uint lightCount;
+    uint clusterCount;
+    // Capacity of the light index list, clusters past it are truncated identically on both builders
+    uint maxLightIndices;
+    uint tileSize;
+    uint padding;
+};
+
+// Boundary k of every grid axis. Tile boundaries are planes through the eye with the signed distance
+// plane.x * view.x (or view.y) + plane.y * view.z, growing towards higher tile indices. Slices are split at view depths.
+struct LightGridBoundary
+{
+    float2 columnPlane;
+    float2 rowPlane;
+    float sliceDepth;
+    float3 padding;
+};
+
+// Slice of the light index list belonging to one cluster
+struct LightGridCell
+{
+    uint offset;
+    uint count;
+};
+
+// Inclusive tile, row and slice range a light touches, min in the low and max in the high 16 bits
+struct LightClusterRange
+{
+    uint columns;
+    uint rows;
+    uint slices;
+};
+
+LANE_TEMPLATE
+lane_float TransformToView(lane_float x, lane_float y, lane_float z, float4 viewColumn)
+{
+    PRECISE lane_float result = x * viewColumn.x + y * viewColumn.y + z * viewColumn.z + viewColumn.w;
+    return result;
+}
+
+// Signed distance of a view space point to a tile boundary plane
+LANE_TEMPLATE
+lane_float TileBoundaryDistance(lane_float coordinate, lane_float viewZ, float2 plane)
+{
+    PRECISE lane_float distance = plane.x * coordinate + plane.y * viewZ;
+    return distance;
+}
+
+// Conservative sphere test against the slab between two tile boundaries, each plane is tested on its own. Takes the
+// TileBoundaryDistance of both, neighbouring slabs share a boundary so a walk over the tiles computes each once.
+LANE_TEMPLATE
+lane_bool SphereOverlapsTileSlab(lane_float lowDistance, lane_float highDistance, lane_float radius)
+{
+    return lowDistance >= -radius && highDistance <= radius;
+}
+
+LANE_TEMPLATE
+lane_bool SphereOverlapsSlice(lane_float viewZ, lane_float radius, float nearDepth, float farDepth)
+{
+    PRECISE lane_float front = viewZ - radius;
+    PRECISE lane_float back = viewZ + radius;
+    return back >= nearDepth && front <= farDepth;
+}
+
+SHADER_INTEROP_END
+
+#endif // LIGHT_GRID_SHARED_H
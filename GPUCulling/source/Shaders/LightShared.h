@@ -0,0 +1,30 @@
+#ifndef LIGHT_SHARED_H
+#define LIGHT_SHARED_H
+
+#include "ShaderInterop.h"
+
+SHADER_INTEROP_BEGIN
+
+static const uint LIGHT_TYPE_POINT = 0;
+static const uint LIGHT_TYPE_SPOT = 1;
+
+struct LightData
+{
+    float3 position;
+    float range;
+    float3 color;
+    float intensity;
+    // Spot lights only, unit length
+    float3 direction;
+    float spotCosOuter;
+    // World space sphere enclosing everything the light reaches, the only shape light culling looks at
+    float3 cullCenter;
+    float cullRadius;
+    uint type;
+    float spotCosInner;
+    uint2 padding;
+};
+
+SHADER_INTEROP_END
+
+#endif // LIGHT_SHARED_H
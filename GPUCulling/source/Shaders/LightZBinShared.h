@@ -0,0 +1,58 @@
+#ifndef LIGHT_ZBIN_SHARED_H
+#define LIGHT_ZBIN_SHARED_H
+
+#include "LightGridShared.h"
+
+SHADER_INTEROP_BEGIN
+
+static const uint LIGHT_ZBIN_GROUP_SIZE = 64;
+
+// Per axis tile limit, tile ranges are packed into 16 bits like the light grid's
+static const uint LIGHT_ZBIN_MAX_TILES = 256;
+
+// Bin touched by no light, min above max
+static const uint LIGHT_ZBIN_EMPTY_MIN = 0xFFFFFFFF;
+static const uint LIGHT_ZBIN_EMPTY_MAX = 0;
+
+struct LightZBinConstants
+{
+    // Columns of the row vector view matrix, see LightGridConstants
+    float4 viewColumnX;
+    float4 viewColumnY;
+    float4 viewColumnZ;
+    uint2 tileCount;
+    // Lights that survived culling, sorted front to back. Bit i of a tile mask is sorted light i.
+    uint lightCount;
+    // 32-bit mask words per tile, masks are stored word major so neighbouring tiles share cache lines
+    uint wordCount;
+    uint tileSize;
+    uint binCount;
+    // Bins split [binNear, binNear + binCount / binScale] into equal view depth steps
+    float binNear;
+    float binScale;
+};
+
+// Inclusive range of sorted light indices touching a depth bin
+struct LightZBin
+{
+    uint minLight;
+    uint maxLight;
+};
+
+// Inclusive tile column and row range of a sorted light, min in the low and max in the high 16 bits
+struct LightTileRange
+{
+    uint columns;
+    uint rows;
+};
+
+// The same function bins light extents and pixel depths, so a pixel always lands in a bin its lights were added to
+SHARED_FUNCTION uint GetLightZBin(float viewZ, float binNear, float binScale, uint binCount)
+{
+    PRECISE float position = (viewZ - binNear) * binScale;
+    return uint(min(max(position, 0.0f), float(binCount - 1)));
+}
+
+SHADER_INTEROP_END
+
+#endif // LIGHT_ZBIN_SHARED_H
@@ -0,0 +1,50 @@
+#include "LightZBinShared.h"
+
+// Z-binned light culling, tile mask expansion. Lights are culled, sorted and binned on the CPU (LightZBins::BuildBins),
+// this pass mirrors LightZBins::BuildTileMasks and produces byte identical masks.
+// CSTileMasks  one thread per tile and mask word, bit i set when sorted light word * 32 + i touches the tile
+
+#define LIGHT_ZBIN_ROOT_SIGNATURE \
+    "RootConstants(num32BitConstants=20, b0)," \
+    "SRV(t0)," \
+    "UAV(u0)"
+
+ConstantBuffer<LightZBinConstants> g_constants : register(b0);
+StructuredBuffer<LightTileRange> g_tileRanges : register(t0);
+RWStructuredBuffer<uint> g_tileMasks : register(u0);
+
+bool RangeContains(uint range, uint value)
+{
+    return value >= (range & 0xFFFF) && value <= (range >> 16);
+}
+
+[RootSignature(LIGHT_ZBIN_ROOT_SIGNATURE)]
+[numthreads(LIGHT_ZBIN_GROUP_SIZE, 1, 1)]
+void CSTileMasks(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    uint tileCount = g_constants.tileCount.x * g_constants.tileCount.y;
+    uint tile = dispatchThreadId.x;
+    uint word = dispatchThreadId.y;
+    if (tile >= tileCount || word >= g_constants.wordCount)
+    {
+        return;
+    }
+
+    uint column = tile % g_constants.tileCount.x;
+    uint row = tile / g_constants.tileCount.x;
+    uint firstLight = word * 32;
+    uint lightCount = min(32, g_constants.lightCount - firstLight);
+
+    // Every thread of a group reads the same 32 ranges
+    uint mask = 0;
+    for (uint i = 0; i < lightCount; ++i)
+    {
+        LightTileRange range = g_tileRanges[firstLight + i];
+        if (RangeContains(range.columns, column) && RangeContains(range.rows, row))
+        {
+            mask |= 1u << i;
+        }
+    }
+
+    g_tileMasks[word * tileCount + tile] = mask;
+}
@@ -0,0 +1,65 @@
+#include "OpaqueShared.h"
+#include "PackedVertexShared.h"
+
+// Lambert shading of the pooled scene geometry drawn by IndirectDrawPass. Slot 0 is the pool's QuantizedVertex
+// stream, slot 1 the per instance DrawInstanceTransform: the object to world rows and the frame the mesh's positions
+// are quantized in. ExecuteIndirect starts every draw at its instance, so the single instance of a draw reads the
+// transform of the instance that produced it.
+
+#define OPAQUE_ROOT_SIGNATURE \
+    "RootFlags(ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT)," \
+    "RootConstants(num32BitConstants=20, b0)"
+
+ConstantBuffer<OpaqueConstants> g_constants : register(b0);
+
+struct VertexInput
+{
+    // QuantizedVertex::positionXY and positionZ
+    uint2 position : POSITION;
+    // Octahedral snorm16
+    uint normal : NORMAL;
+    // Rows of the row vector object to world matrix
+    float4 world0 : WORLD0;
+    float4 world1 : WORLD1;
+    float4 world2 : WORLD2;
+    float4 world3 : WORLD3;
+    // BoundsQuantization::origin and scale, the padding is not read
+    float4 quantizationOrigin : QUANTIZATION0;
+    float4 quantizationScale : QUANTIZATION1;
+};
+
+struct PixelInput
+{
+    float4 position : SV_Position;
+    float3 normal : NORMAL;
+};
+
+[RootSignature(OPAQUE_ROOT_SIGNATURE)]
+PixelInput VSMain(VertexInput input)
+{
+    // Same decode as UnpackVertex on the CPU
+    QuantizedVertex vertex = (QuantizedVertex)0;
+    vertex.positionXY = input.position.x;
+    vertex.positionZ = input.position.y;
+    BoundsQuantization quantization = (BoundsQuantization)0;
+    quantization.origin = input.quantizationOrigin.xyz;
+    quantization.scale = input.quantizationScale.xyz;
+    float3 position = DecodeVertexPosition(vertex, quantization);
+    float3 normal = DecodeNormal(input.normal);
+
+    float4x4 world = float4x4(input.world0, input.world1, input.world2, input.world3);
+    float4 worldPosition = mul(float4(position, 1.0f), world);
+
+    PixelInput output;
+    output.position = mul(worldPosition, g_constants.viewProjection);
+    // Scene transforms are rotations with uniform scale, the pixel shader renormalizes
+    output.normal = mul(normal, (float3x3)world);
+    return output;
+}
+
+float4 PSMain(PixelInput input) : SV_Target
+{
+    float diffuse = saturate(dot(normalize(input.normal), g_constants.lightDirection));
+    float intensity = g_constants.ambient + (1.0f - g_constants.ambient) * diffuse;
+    return float4(intensity, intensity, intensity, 1.0f);
+}
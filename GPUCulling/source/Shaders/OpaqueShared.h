@@ -0,0 +1,19 @@
+#ifndef OPAQUE_SHARED_H
+#define OPAQUE_SHARED_H
+
+#include "ShaderInterop.h"
+
+SHADER_INTEROP_BEGIN
+
+struct OpaqueConstants
+{
+    // Transposed on upload so HLSL's default column major packing reads back the row vector matrix
+    float4x4 viewProjection;
+    // World space direction towards the light, normalized
+    float3 lightDirection;
+    float ambient;
+};
+
+SHADER_INTEROP_END
+
+#endif // OPAQUE_SHARED_H
@@ -0,0 +1,105 @@
+#ifndef PACKED_VERTEX_SHARED_H
+#define PACKED_VERTEX_SHARED_H
+
+#include "ShaderInterop.h"
+#include "QuantizedBoundsShared.h"
+
+SHADER_INTEROP_BEGIN
+
+// Octahedral components are signed normalized, 16 bits for normals and x of the tangent, 15 bits for y of the
+// tangent whose top bit holds the bitangent sign
+static const float OCTAHEDRAL_SNORM16_SCALE = 32767.0f;
+static const float OCTAHEDRAL_SNORM15_SCALE = 16383.0f;
+static const uint TANGENT_SIGN_BIT = 0x80000000;
+
+// Compressed vertex layouts for vertex and structured buffers, which pack tightly so the float3 needs no padding.
+// Normal and tangent are unit vectors mapped onto an octahedron, the bitangent is rebuilt as cross(normal, tangent)
+// times the stored sign, and the texture coordinates are two half floats. See IO/VertexPacking.h for the encoder.
+
+// Full precision position, 24 bytes against 56 for VertexData
+struct PackedVertex
+{
+    float3 position;
+    // x | y << 16, octahedral snorm16
+    uint normal;
+    // x | y << 16 | bitangent sign << 31, octahedral snorm16 and snorm15
+    uint tangent;
+    // u | v << 16, half floats
+    uint texCoord;
+};
+
+// Position as 16-bit codes in the mesh's bounds, rounded to nearest, 20 bytes
+struct QuantizedVertex
+{
+    // x | y << 16
+    uint positionXY;
+    // z in the low 16 bits
+    uint positionZ;
+    uint normal;
+    uint tangent;
+    uint texCoord;
+};
+
+SHARED_FUNCTION float DecodeSnorm(int value, float scale)
+{
+    return max(float(value) / scale, -1.0f);
+}
+
+// Unfolds the lower half of the octahedron and renormalizes
+SHARED_FUNCTION float3 DecodeOctahedral(float x, float y)
+{
+    float z = 1.0f - abs(x) - abs(y);
+    float t = max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    float invLength = 1.0f / sqrt(x * x + y * y + z * z);
+    float3 result = { x * invLength, y * invLength, z * invLength };
+    return result;
+}
+
+SHARED_FUNCTION float3 DecodeNormal(uint packed)
+{
+    return DecodeOctahedral(
+        DecodeSnorm(int(packed << 16) >> 16, OCTAHEDRAL_SNORM16_SCALE),
+        DecodeSnorm(int(packed) >> 16, OCTAHEDRAL_SNORM16_SCALE));
+}
+
+SHARED_FUNCTION float3 DecodeTangent(uint packed)
+{
+    return DecodeOctahedral(
+        DecodeSnorm(int(packed << 16) >> 16, OCTAHEDRAL_SNORM16_SCALE),
+        DecodeSnorm(int(packed << 1) >> 17, OCTAHEDRAL_SNORM15_SCALE));
+}
+
+SHARED_FUNCTION float GetBitangentSign(uint packedTangent)
+{
+    return (packedTangent & TANGENT_SIGN_BIT) != 0 ? -1.0f : 1.0f;
+}
+
+SHARED_FUNCTION float3 GetBitangent(float3 normal, float3 tangent, float sign)
+{
+    float3 result = {
+        (normal.y * tangent.z - normal.z * tangent.y) * sign,
+        (normal.z * tangent.x - normal.x * tangent.z) * sign,
+        (normal.x * tangent.y - normal.y * tangent.x) * sign };
+    return result;
+}
+
+SHARED_FUNCTION float2 DecodeTexCoord(uint packed)
+{
+    float2 result = { f16tof32(packed), f16tof32(packed >> 16) };
+    return result;
+}
+
+SHARED_FUNCTION float3 DecodeVertexPosition(QuantizedVertex vertex, BoundsQuantization quantization)
+{
+    float3 result = {
+        DequantizeBound(vertex.positionXY & 0xFFFF, quantization.origin.x, quantization.scale.x),
+        DequantizeBound(vertex.positionXY >> 16, quantization.origin.y, quantization.scale.y),
+        DequantizeBound(vertex.positionZ & 0xFFFF, quantization.origin.z, quantization.scale.z) };
+    return result;
+}
+
+SHADER_INTEROP_END
+
+#endif // PACKED_VERTEX_SHARED_H
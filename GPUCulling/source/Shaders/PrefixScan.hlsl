@@ -0,0 +1,176 @@
+#include "PrefixScanShared.h"
+
+// Single pass prefix scan and stream compaction with decoupled lookback (Merrill and Garland 2016).
+// Groups take partitions in launch order from a ticket counter, so every partition a group waits on is already
+// running. Each group publishes its sum right away and walks back over its predecessors until one has published
+// a full prefix, so the input is read once and no second pass over the partition sums is needed.
+// CSClearStatus    zeroes the ticket counter and the partition status, runs before every scan
+// CSExclusiveScan  g_output[i] is the sum of g_input[0, i), g_output[elementCount] the total
+// CSCompact        g_output[0] is the count of non zero g_input elements, followed by their indices in order
+// PrefixScan::ExclusiveScan and PrefixScan::Compact are the CPU reference and return the same sums and indices.
+
+#define PREFIX_SCAN_ROOT_SIGNATURE \
+    "RootConstants(num32BitConstants=4, b0)," \
+    "SRV(t0)," \
+    "UAV(u0)," \
+    "UAV(u1)"
+
+ConstantBuffer<PrefixScanConstants> g_constants : register(b0);
+StructuredBuffer<uint> g_input : register(t0);
+RWStructuredBuffer<uint> g_output : register(u0);
+globallycoherent RWStructuredBuffer<uint> g_status : register(u1);
+
+groupshared uint gs_partitionIndex;
+groupshared uint gs_threadSums[SCAN_GROUP_SIZE];
+groupshared uint gs_partitionPrefix;
+
+// Both words carry the flag, readers pair the halves only once the flags match
+void PublishStatus(uint partitionIndex, uint flag, uint value)
+{
+    uint statusIndex = GetScanStatusIndex(partitionIndex);
+    uint previous;
+    InterlockedExchange(g_status[statusIndex], PackScanStatus(flag, value), previous);
+    InterlockedExchange(g_status[statusIndex + 1], PackScanStatus(flag, value >> 16), previous);
+}
+
+// Every thread of the group has to call it. Returns the sum of everything before the thread's first element.
+uint ScanPartition(uint partitionIndex, uint groupIndex, uint threadSum)
+{
+    // Inclusive Hillis-Steele scan over the per thread sums
+    gs_threadSums[groupIndex] = threadSum;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint stride = 1; stride < SCAN_GROUP_SIZE; stride <<= 1)
+    {
+        uint addend = groupIndex >= stride ? gs_threadSums[groupIndex - stride] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        gs_threadSums[groupIndex] += addend;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (groupIndex == 0)
+    {
+        uint aggregate = gs_threadSums[SCAN_GROUP_SIZE - 1];
+        PublishStatus(partitionIndex, partitionIndex == 0 ? SCAN_STATUS_PREFIX : SCAN_STATUS_AGGREGATE, aggregate);
+
+        uint prefix = 0;
+        uint lookback = partitionIndex;
+        [allow_uav_condition]
+        while (lookback > 0)
+        {
+            // Atomic reads, a plain load may be served from a stale cache line while the predecessor publishes
+            uint statusIndex = GetScanStatusIndex(lookback - 1);
+            uint lowStatus;
+            uint highStatus;
+            InterlockedOr(g_status[statusIndex], 0, lowStatus);
+            InterlockedOr(g_status[statusIndex + 1], 0, highStatus);
+
+            // Differing flags mean the predecessor is halfway through a publish
+            uint flag = GetScanStatusFlag(lowStatus);
+            if (flag == SCAN_STATUS_NOT_READY || flag != GetScanStatusFlag(highStatus))
+            {
+                continue;
+            }
+
+            prefix += GetScanStatusValue(lowStatus, highStatus);
+            if (flag == SCAN_STATUS_PREFIX)
+            {
+                break;
+            }
+            --lookback;
+        }
+
+        if (partitionIndex > 0)
+        {
+            PublishStatus(partitionIndex, SCAN_STATUS_PREFIX, prefix + aggregate);
+        }
+        gs_partitionPrefix = prefix;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    return gs_partitionPrefix + gs_threadSums[groupIndex] - threadSum;
+}
+
+// Hands out partitions in the order the groups start, SV_GroupID order is not guaranteed to be launch order
+uint AcquirePartition(uint groupIndex)
+{
+    if (groupIndex == 0)
+    {
+        InterlockedAdd(g_status[SCAN_STATUS_COUNTER_INDEX], 1, gs_partitionIndex);
+    }
+    GroupMemoryBarrierWithGroupSync();
+    return gs_partitionIndex;
+}
+
+[RootSignature(PREFIX_SCAN_ROOT_SIGNATURE)]
+[numthreads(SCAN_GROUP_SIZE, 1, 1)]
+void CSClearStatus(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    if (dispatchThreadId.x < GetScanStatusCount(g_constants.elementCount))
+    {
+        g_status[dispatchThreadId.x] = 0;
+    }
+}
+
+[RootSignature(PREFIX_SCAN_ROOT_SIGNATURE)]
+[numthreads(SCAN_GROUP_SIZE, 1, 1)]
+void CSExclusiveScan(uint groupIndex : SV_GroupIndex)
+{
+    uint partitionIndex = AcquirePartition(groupIndex);
+    uint first = partitionIndex * SCAN_PARTITION_SIZE + groupIndex * SCAN_ITEMS_PER_THREAD;
+
+    uint values[SCAN_ITEMS_PER_THREAD];
+    uint threadSum = 0;
+    [unroll]
+    for (uint i = 0; i < SCAN_ITEMS_PER_THREAD; ++i)
+    {
+        values[i] = first + i < g_constants.elementCount ? g_input[first + i] : 0;
+        threadSum += values[i];
+    }
+
+    uint sum = ScanPartition(partitionIndex, groupIndex, threadSum);
+    [unroll]
+    for (uint j = 0; j < SCAN_ITEMS_PER_THREAD; ++j)
+    {
+        if (first + j < g_constants.elementCount)
+        {
+            g_output[first + j] = sum;
+        }
+        sum += values[j];
+    }
+
+    if (partitionIndex == g_constants.partitionCount - 1 && groupIndex == SCAN_GROUP_SIZE - 1)
+    {
+        g_output[g_constants.elementCount] = sum;
+    }
+}
+
+[RootSignature(PREFIX_SCAN_ROOT_SIGNATURE)]
+[numthreads(SCAN_GROUP_SIZE, 1, 1)]
+void CSCompact(uint groupIndex : SV_GroupIndex)
+{
+    uint partitionIndex = AcquirePartition(groupIndex);
+    uint first = partitionIndex * SCAN_PARTITION_SIZE + groupIndex * SCAN_ITEMS_PER_THREAD;
+
+    // One bit per kept element of the thread
+    uint keepMask = 0;
+    [unroll]
+    for (uint i = 0; i < SCAN_ITEMS_PER_THREAD; ++i)
+    {
+        if (first + i < g_constants.elementCount && g_input[first + i] != 0)
+        {
+            keepMask |= 1u << i;
+        }
+    }
+
+    uint slot = ScanPartition(partitionIndex, groupIndex, countbits(keepMask));
+    for (uint remaining = keepMask; remaining != 0; remaining &= remaining - 1)
+    {
+        g_output[1 + slot] = first + firstbitlow(remaining);
+        ++slot;
+    }
+
+    if (partitionIndex == g_constants.partitionCount - 1 && groupIndex == SCAN_GROUP_SIZE - 1)
+    {
+        g_output[0] = slot;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef PREFIX_SCAN_SHARED_H
+#define PREFIX_SCAN_SHARED_H
+
+#include "ShaderInterop.h"
+
+SHADER_INTEROP_BEGIN
+
+// One group scans one partition of SCAN_PARTITION_SIZE consecutive elements, SCAN_ITEMS_PER_THREAD per thread
+static const uint SCAN_GROUP_SIZE = 256;
+static const uint SCAN_ITEMS_PER_THREAD = 16;
+static const uint SCAN_PARTITION_SIZE = SCAN_GROUP_SIZE * SCAN_ITEMS_PER_THREAD;
+
+// The status buffer holds the partition ticket counter followed by two status words per partition. 32-bit atomics
+// cannot publish a flag next to a full 32-bit sum, so each word carries the flag in its top 2 bits over one 16-bit
+// half of the sum. The words are published one after the other and a reader takes a status only once both show the
+// same flag: a flag never repeats, so matching flags mean both halves come from the same publish.
+static const uint SCAN_STATUS_COUNTER_INDEX = 0;
+static const uint SCAN_STATUS_FIRST_PARTITION = 1;
+static const uint SCAN_STATUS_WORDS_PER_PARTITION = 2;
+static const uint SCAN_STATUS_HALF_MASK = 0xFFFF;
+static const uint SCAN_STATUS_NOT_READY = 0;
+// The partition published its own sum, the lookback has to keep walking
+static const uint SCAN_STATUS_AGGREGATE = 1;
+// The partition published the inclusive sum of every element up to its end, the lookback stops here
+static const uint SCAN_STATUS_PREFIX = 2;
+
+struct PrefixScanConstants
+{
+    uint elementCount;
+    uint partitionCount;
+    uint2 padding;
+};
+
+SHARED_FUNCTION uint GetScanPartitionCount(uint elementCount)
+{
+    return (elementCount + SCAN_PARTITION_SIZE - 1) / SCAN_PARTITION_SIZE;
+}
+
+// Elements of the status buffer for a scan of elementCount elements
+SHARED_FUNCTION uint GetScanStatusCount(uint elementCount)
+{
+    return SCAN_STATUS_FIRST_PARTITION + GetScanPartitionCount(elementCount) * SCAN_STATUS_WORDS_PER_PARTITION;
+}
+
+// First of the partition's two status words, the low half of the sum, the high half follows
+SHARED_FUNCTION uint GetScanStatusIndex(uint partitionIndex)
+{
+    return SCAN_STATUS_FIRST_PARTITION + partitionIndex * SCAN_STATUS_WORDS_PER_PARTITION;
+}
+
+SHARED_FUNCTION uint PackScanStatus(uint flag, uint half)
+{
+    return (flag << 30) | (half & SCAN_STATUS_HALF_MASK);
+}
+
+SHARED_FUNCTION uint GetScanStatusFlag(uint status)
+{
+    return status >> 30;
+}
+
+SHARED_FUNCTION uint GetScanStatusValue(uint lowStatus, uint highStatus)
+{
+    return (lowStatus & SCAN_STATUS_HALF_MASK) | ((highStatus & SCAN_STATUS_HALF_MASK) << 16);
+}
+
+SHADER_INTEROP_END
+
+#endif // PREFIX_SCAN_SHARED_H
@@ -0,0 +1,79 @@
+#ifndef QUANTIZED_BOUNDS_SHARED_H
+#define QUANTIZED_BOUNDS_SHARED_H
+
+#include "ShaderInterop.h"
+
+SHADER_INTEROP_BEGIN
+
+static const uint QUANTIZED_BOUNDS_MAX_CODE = 0xFFFF;
+
+// Frame of a cell, every bound quantized in it decodes as origin + q * scale. The scale is chosen so the top code
+// reaches the cell's max, see MakeBoundsQuantization.
+struct BoundsQuantization
+{
+    float3 origin;
+    float padding0;
+    float3 scale;
+    float padding1;
+};
+
+// An AABB as 16-bit codes relative to its cell plus a float16 sphere radius around the decoded box center: 16 bytes
+// against 24 for a float AABB, 40 with a float sphere. Codes are rounded outward and the radius upward on encode, so
+// the decoded shapes always enclose the original bounds.
+struct QuantizedBounds
+{
+    // min.x | min.y << 16
+    uint minXY;
+    // min.z | max.x << 16
+    uint minZMaxX;
+    // max.y | max.z << 16
+    uint maxYZ;
+    // Half float bits in the low 16 bits
+    uint radius;
+};
+
+// Both sides evaluate the decode unfused, so the GPU decodes to the same floats the CPU encoder checked
+SHARED_FUNCTION float DequantizeBound(uint code, float origin, float scale)
+{
+    PRECISE float value = origin + float(code) * scale;
+    return value;
+}
+
+SHARED_FUNCTION float3 GetQuantizedBoundsMin(QuantizedBounds bounds, BoundsQuantization quantization)
+{
+    float3 result = {
+        DequantizeBound(bounds.minXY & 0xFFFF, quantization.origin.x, quantization.scale.x),
+        DequantizeBound(bounds.minXY >> 16, quantization.origin.y, quantization.scale.y),
+        DequantizeBound(bounds.minZMaxX & 0xFFFF, quantization.origin.z, quantization.scale.z) };
+    return result;
+}
+
+SHARED_FUNCTION float3 GetQuantizedBoundsMax(QuantizedBounds bounds, BoundsQuantization quantization)
+{
+    float3 result = {
+        DequantizeBound(bounds.minZMaxX >> 16, quantization.origin.x, quantization.scale.x),
+        DequantizeBound(bounds.maxYZ & 0xFFFF, quantization.origin.y, quantization.scale.y),
+        DequantizeBound(bounds.maxYZ >> 16, quantization.origin.z, quantization.scale.z) };
+    return result;
+}
+
+// The sphere is centered on the decoded box
+SHARED_FUNCTION float3 GetQuantizedBoundsCenter(QuantizedBounds bounds, BoundsQuantization quantization)
+{
+    float3 boundsMin = GetQuantizedBoundsMin(bounds, quantization);
+    float3 boundsMax = GetQuantizedBoundsMax(bounds, quantization);
+    PRECISE float x = (boundsMin.x + boundsMax.x) * 0.5f;
+    PRECISE float y = (boundsMin.y + boundsMax.y) * 0.5f;
+    PRECISE float z = (boundsMin.z + boundsMax.z) * 0.5f;
+    float3 result = { x, y, z };
+    return result;
+}
+
+SHARED_FUNCTION float GetQuantizedBoundsRadius(QuantizedBounds bounds)
+{
+    return f16tof32(bounds.radius);
+}
+
+SHADER_INTEROP_END
+
+#endif // QUANTIZED_BOUNDS_SHARED_H
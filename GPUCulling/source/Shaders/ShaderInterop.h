@@ -0,0 +1,71 @@
+#ifndef SHADER_INTEROP_H
+#define SHADER_INTEROP_H
+
+// Lets structure definitions be shared between C++ and HLSL so constant and buffer layouts cannot drift apart.
+// Shared structs must follow HLSL packing rules: keep float3 members padded to 16 bytes.
+// Shared headers use include guards rather than #pragma once because the HLSL compiler parses them too.
+#ifdef __cplusplus
+
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace ShaderInterop
+{
+    using std::abs;
+    using std::ceil;
+    using std::floor;
+    using std::max;
+    using std::min;
+    using std::sqrt;
+
+    using uint = uint32_t;
+    using uint2 = DirectX::XMUINT2;
+    using uint3 = DirectX::XMUINT3;
+    using uint4 = DirectX::XMUINT4;
+    using float2 = DirectX::XMFLOAT2;
+    using float3 = DirectX::XMFLOAT3;
+    using float4 = DirectX::XMFLOAT4;
+    using float4x4 = DirectX::XMFLOAT4X4;
+
+    // HLSL intrinsic, converts the half float in the low 16 bits exactly
+    inline float f16tof32(uint value)
+    {
+        return DirectX::PackedVector::XMConvertHalfToFloat(static_cast<DirectX::PackedVector::HALF>(value & 0xFFFF));
+    }
+}
+
+#define SHADER_INTEROP_BEGIN namespace ShaderInterop {
+#define SHADER_INTEROP_END }
+
+// Shared kernels are written against lane_float / lane_bool using only component math. In C++ they are templates,
+// so the same code runs on plain floats and on the SIMD lane types of the CPU paths.
+#define LANE_TEMPLATE template<typename lane_float, typename lane_bool>
+// Calls one shared kernel from another with the caller's lane types
+#define LANE_CALL(function) function<lane_float, lane_bool>
+
+// Marks arithmetic the GPU must not contract into mad, so it rounds exactly like the CPU path
+#define PRECISE
+
+// Plain shared functions, header defined so they need inline linkage in C++
+#define SHARED_FUNCTION inline
+
+#else
+
+#define SHADER_INTEROP_BEGIN
+#define SHADER_INTEROP_END
+
+#define LANE_TEMPLATE
+#define LANE_CALL(function) function
+typedef float lane_float;
+typedef bool lane_bool;
+
+#define PRECISE precise
+
+#define SHARED_FUNCTION
+
+#endif
+
+#endif // SHADER_INTEROP_H
@@ -0,0 +1,109 @@
+#include "stdafx.h"
+#include "System/Hash.h"
+
+#include <cstring>
+
+namespace
+{
+    constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t PRIME3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+    uint64_t RotateLeft(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    uint64_t Read64(const uint8_t* data)
+    {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint32_t Read32(const uint8_t* data)
+    {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint64_t Round(uint64_t accumulator, uint64_t input)
+    {
+        accumulator += input * PRIME2;
+        accumulator = RotateLeft(accumulator, 31);
+        return accumulator * PRIME1;
+    }
+
+    uint64_t MergeRound(uint64_t hash, uint64_t accumulator)
+    {
+        hash ^= Round(0, accumulator);
+        return hash * PRIME1 + PRIME4;
+    }
+}
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const uint8_t* end = bytes + size;
+    uint64_t hash;
+
+    // Four independent lanes over 32 byte stripes keep the multipliers busy
+    if (size >= 32)
+    {
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+
+        const uint8_t* stripeEnd = end - 32;
+        do
+        {
+            v1 = Round(v1, Read64(bytes));
+            v2 = Round(v2, Read64(bytes + 8));
+            v3 = Round(v3, Read64(bytes + 16));
+            v4 = Round(v4, Read64(bytes + 24));
+            bytes += 32;
+        } while (bytes <= stripeEnd);
+
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    }
+    else
+    {
+        hash = seed + PRIME5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+
+    for (; bytes + 8 <= end; bytes += 8)
+    {
+        hash ^= Round(0, Read64(bytes));
+        hash = RotateLeft(hash, 27) * PRIME1 + PRIME4;
+    }
+
+    if (bytes + 4 <= end)
+    {
+        hash ^= static_cast<uint64_t>(Read32(bytes)) * PRIME1;
+        hash = RotateLeft(hash, 23) * PRIME2 + PRIME3;
+        bytes += 4;
+    }
+
+    for (; bytes < end; ++bytes)
+    {
+        hash ^= static_cast<uint64_t>(*bytes) * PRIME5;
+        hash = RotateLeft(hash, 11) * PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
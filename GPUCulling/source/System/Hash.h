@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit xxHash of a byte range. Fast enough to fingerprint multi gigabyte source assets on every load, and
+// stable across runs and platforms so the results can be stored in files.
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+// Folds value into seed, for hashing a handful of settings into one key
+inline uint64_t HashCombine(uint64_t seed, uint64_t value)
+{
+    return HashBytes(&value, sizeof(value), seed);
+}
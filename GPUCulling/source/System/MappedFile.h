@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read only mapping of a whole file. Pages are faulted in by the OS when first touched, so opening costs the same for
+// any file size and data that is never read is never loaded. The view stays valid until Close or destruction.
+class MappedFile
+{
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    // Fails for missing and empty files. Closes any previously open file first.
+    bool Open(const std::string& filePath);
+    void Close();
+
+    bool IsOpen() const { return m_data != nullptr; }
+    const uint8_t* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    // File and file mapping HANDLEs, kept as void* so windows.h stays out of the header
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
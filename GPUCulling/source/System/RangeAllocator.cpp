@@ -0,0 +1,308 @@
+#include "stdafx.h"
+#include "System/RangeAllocator.h"
+
+#include <bit>
+
+namespace
+{
+    constexpr uint32_t MANTISSA_BITS = 3;
+    constexpr uint32_t MANTISSA_VALUE = 1u << MANTISSA_BITS;
+    constexpr uint32_t MANTISSA_MASK = MANTISSA_VALUE - 1;
+
+    // Lowest set bit at or above startBit, 32 when there is none
+    uint32_t FindLowestSetBit(uint32_t mask, uint32_t startBit)
+    {
+        uint32_t maskedBits = startBit < 32 ? mask & (~0u << startBit) : 0;
+        return static_cast<uint32_t>(std::countr_zero(maskedBits));
+    }
+}
+
+// Sizes below 8 map to themselves, larger ones to exponent and 3 mantissa bits. Rounding up may carry the mantissa
+// into the exponent, which is the next bin as intended.
+uint32_t RangeAllocator::GetBinRoundUp(uint32_t size)
+{
+    if (size < MANTISSA_VALUE)
+    {
+        return size;
+    }
+
+    uint32_t highestBit = static_cast<uint32_t>(std::bit_width(size)) - 1;
+    uint32_t mantissaShift = highestBit - MANTISSA_BITS;
+    uint32_t exponent = mantissaShift + 1;
+    uint32_t mantissa = (size >> mantissaShift) & MANTISSA_MASK;
+    if ((size & ((1u << mantissaShift) - 1)) != 0)
+    {
+        ++mantissa;
+    }
+    return (exponent << MANTISSA_BITS) + mantissa;
+}
+
+uint32_t RangeAllocator::GetBinRoundDown(uint32_t size)
+{
+    if (size < MANTISSA_VALUE)
+    {
+        return size;
+    }
+
+    uint32_t highestBit = static_cast<uint32_t>(std::bit_width(size)) - 1;
+    uint32_t mantissaShift = highestBit - MANTISSA_BITS;
+    uint32_t exponent = mantissaShift + 1;
+    uint32_t mantissa = (size >> mantissaShift) & MANTISSA_MASK;
+    return (exponent << MANTISSA_BITS) | mantissa;
+}
+
+void RangeAllocator::Initialize(uint32_t capacity)
+{
+    Release();
+
+    m_capacity = capacity;
+    if (capacity > 0)
+    {
+        InsertFreeNode(CreateNode(0, capacity));
+    }
+}
+
+void RangeAllocator::Release()
+{
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_usedTopBins = 0;
+    m_usedLeafBins.fill(0);
+    m_binHeads.fill(INVALID_NODE);
+    m_capacity = 0;
+    m_usedSize = 0;
+    m_allocationCount = 0;
+}
+
+RangeAllocator::Allocation RangeAllocator::Allocate(uint32_t size)
+{
+    assertm(size > 0, "RangeAllocator::Allocate called with zero size");
+
+    uint32_t nodeIndex = INVALID_NODE;
+    uint32_t bin = FindFreeBin(GetBinRoundUp(size));
+    if (bin != INVALID_NODE)
+    {
+        nodeIndex = m_binHeads[bin];
+    }
+    else
+    {
+        // No bin guarantees a fit, but the bin the size rounds down to may still hold a range large enough for it
+        for (uint32_t candidate = m_binHeads[GetBinRoundDown(size)]; candidate != INVALID_NODE; candidate = m_nodes[candidate].binNext)
+        {
+            if (m_nodes[candidate].size >= size)
+            {
+                nodeIndex = candidate;
+                break;
+            }
+        }
+
+        if (nodeIndex == INVALID_NODE)
+        {
+            return {};
+        }
+    }
+
+    RemoveFreeNode(nodeIndex);
+
+    // The remainder is split off behind the allocation and filed as a free range of its own
+    uint32_t remainder = m_nodes[nodeIndex].size - size;
+    if (remainder > 0)
+    {
+        uint32_t remainderIndex = CreateNode(m_nodes[nodeIndex].offset + size, remainder);
+        Node& node = m_nodes[nodeIndex];
+        Node& remainderNode = m_nodes[remainderIndex];
+
+        remainderNode.neighborPrevious = nodeIndex;
+        remainderNode.neighborNext = node.neighborNext;
+        if (node.neighborNext != INVALID_NODE)
+        {
+            m_nodes[node.neighborNext].neighborPrevious = remainderIndex;
+        }
+        node.neighborNext = remainderIndex;
+        node.size = size;
+
+        InsertFreeNode(remainderIndex);
+    }
+
+    Node& node = m_nodes[nodeIndex];
+    node.isUsed = true;
+    m_usedSize += size;
+    ++m_allocationCount;
+
+    Allocation allocation;
+    allocation.offset = node.offset;
+    allocation.size = size;
+    allocation.node = nodeIndex;
+    return allocation;
+}
+
+void RangeAllocator::Free(const Allocation& allocation)
+{
+    assertm(allocation.IsValid() && allocation.node < m_nodes.size() && m_nodes[allocation.node].isUsed,
+        "RangeAllocator::Free called with an invalid or already freed allocation");
+
+    uint32_t nodeIndex = allocation.node;
+    m_usedSize -= m_nodes[nodeIndex].size;
+    --m_allocationCount;
+    m_nodes[nodeIndex].isUsed = false;
+
+    // Free neighbors are absorbed into this node, so free ranges never touch
+    uint32_t previousIndex = m_nodes[nodeIndex].neighborPrevious;
+    if (previousIndex != INVALID_NODE && !m_nodes[previousIndex].isUsed)
+    {
+        RemoveFreeNode(previousIndex);
+        Node& node = m_nodes[nodeIndex];
+        const Node& previous = m_nodes[previousIndex];
+        node.offset = previous.offset;
+        node.size += previous.size;
+        node.neighborPrevious = previous.neighborPrevious;
+        if (node.neighborPrevious != INVALID_NODE)
+        {
+            m_nodes[node.neighborPrevious].neighborNext = nodeIndex;
+        }
+        DestroyNode(previousIndex);
+    }
+
+    uint32_t nextIndex = m_nodes[nodeIndex].neighborNext;
+    if (nextIndex != INVALID_NODE && !m_nodes[nextIndex].isUsed)
+    {
+        RemoveFreeNode(nextIndex);
+        Node& node = m_nodes[nodeIndex];
+        const Node& next = m_nodes[nextIndex];
+        node.size += next.size;
+        node.neighborNext = next.neighborNext;
+        if (node.neighborNext != INVALID_NODE)
+        {
+            m_nodes[node.neighborNext].neighborPrevious = nodeIndex;
+        }
+        DestroyNode(nextIndex);
+    }
+
+    InsertFreeNode(nodeIndex);
+}
+
+uint32_t RangeAllocator::GetLargestFreeRange() const
+{
+    if (m_usedTopBins == 0)
+    {
+        return 0;
+    }
+
+    // Ranges in one bin differ by up to a mantissa step, the top bin's list is walked for the exact size
+    uint32_t topBin = static_cast<uint32_t>(std::bit_width(m_usedTopBins)) - 1;
+    uint32_t leafBin = static_cast<uint32_t>(std::bit_width(static_cast<uint32_t>(m_usedLeafBins[topBin]))) - 1;
+
+    uint32_t largest = 0;
+    for (uint32_t nodeIndex = m_binHeads[topBin * LEAF_BINS_PER_TOP_BIN + leafBin]; nodeIndex != INVALID_NODE;
+        nodeIndex = m_nodes[nodeIndex].binNext)
+    {
+        largest = std::max(largest, m_nodes[nodeIndex].size);
+    }
+    return largest;
+}
+
+uint32_t RangeAllocator::CreateNode(uint32_t offset, uint32_t size)
+{
+    uint32_t nodeIndex;
+    if (!m_freeNodes.empty())
+    {
+        nodeIndex = m_freeNodes.back();
+        m_freeNodes.pop_back();
+    }
+    else
+    {
+        nodeIndex = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+
+    Node& node = m_nodes[nodeIndex];
+    node = Node();
+    node.offset = offset;
+    node.size = size;
+    return nodeIndex;
+}
+
+void RangeAllocator::DestroyNode(uint32_t nodeIndex)
+{
+    m_freeNodes.push_back(nodeIndex);
+}
+
+void RangeAllocator::InsertFreeNode(uint32_t nodeIndex)
+{
+    uint32_t bin = GetBinRoundDown(m_nodes[nodeIndex].size);
+    uint32_t topBin = bin / LEAF_BINS_PER_TOP_BIN;
+    uint32_t leafBin = bin % LEAF_BINS_PER_TOP_BIN;
+
+    if (m_binHeads[bin] == INVALID_NODE)
+    {
+        m_usedLeafBins[topBin] |= static_cast<uint8_t>(1u << leafBin);
+        m_usedTopBins |= 1u << topBin;
+    }
+
+    Node& node = m_nodes[nodeIndex];
+    node.binPrevious = INVALID_NODE;
+    node.binNext = m_binHeads[bin];
+    if (node.binNext != INVALID_NODE)
+    {
+        m_nodes[node.binNext].binPrevious = nodeIndex;
+    }
+    m_binHeads[bin] = nodeIndex;
+}
+
+void RangeAllocator::RemoveFreeNode(uint32_t nodeIndex)
+{
+    Node& node = m_nodes[nodeIndex];
+    uint32_t bin = GetBinRoundDown(node.size);
+
+    if (node.binPrevious != INVALID_NODE)
+    {
+        m_nodes[node.binPrevious].binNext = node.binNext;
+    }
+    else
+    {
+        m_binHeads[bin] = node.binNext;
+    }
+
+    if (node.binNext != INVALID_NODE)
+    {
+        m_nodes[node.binNext].binPrevious = node.binPrevious;
+    }
+    node.binPrevious = INVALID_NODE;
+    node.binNext = INVALID_NODE;
+
+    if (m_binHeads[bin] == INVALID_NODE)
+    {
+        uint32_t topBin = bin / LEAF_BINS_PER_TOP_BIN;
+        uint32_t leafBin = bin % LEAF_BINS_PER_TOP_BIN;
+        m_usedLeafBins[topBin] &= static_cast<uint8_t>(~(1u << leafBin));
+        if (m_usedLeafBins[topBin] == 0)
+        {
+            m_usedTopBins &= ~(1u << topBin);
+        }
+    }
+}
+
+uint32_t RangeAllocator::FindFreeBin(uint32_t minBin) const
+{
+    uint32_t minTopBin = minBin / LEAF_BINS_PER_TOP_BIN;
+    uint32_t minLeafBin = minBin % LEAF_BINS_PER_TOP_BIN;
+
+    // The leaf bins of the smallest top bin are only partly large enough, every bin of a larger top bin fits
+    if (minTopBin < TOP_BIN_COUNT && (m_usedTopBins & (1u << minTopBin)) != 0)
+    {
+        uint32_t leafBin = FindLowestSetBit(m_usedLeafBins[minTopBin], minLeafBin);
+        if (leafBin < LEAF_BINS_PER_TOP_BIN)
+        {
+            return minTopBin * LEAF_BINS_PER_TOP_BIN + leafBin;
+        }
+    }
+
+    uint32_t topBin = FindLowestSetBit(m_usedTopBins, minTopBin + 1);
+    if (topBin >= TOP_BIN_COUNT)
+    {
+        return INVALID_NODE;
+    }
+
+    uint32_t leafBin = static_cast<uint32_t>(std::countr_zero(static_cast<uint32_t>(m_usedLeafBins[topBin])));
+    return topBin * LEAF_BINS_PER_TOP_BIN + leafBin;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Two level segregated fit (TLSF) allocator of ranges in [0, capacity). It only hands out offsets, the memory itself
+// lives elsewhere, e.g. in one large GPU buffer. Free ranges are binned by a small float of their size, 8 linear bins
+// per power of two, and two bitmasks find the first non-empty bin that fits, so Allocate and Free are O(1) whatever
+// the number of ranges. Freed ranges merge with free neighbors right away.
+//
+// A range is taken from a bin whose every member fits, so an allocation may be served from a range up to 12.5%
+// larger than the smallest fitting one. The remainder is split off and stays free. Only when no such bin is left is the
+// bin the size itself falls in searched, so Allocate fails only when no free range holds the size.
+class RangeAllocator
+{
+    RangeAllocator(const RangeAllocator&) = delete;
+    RangeAllocator& operator=(const RangeAllocator&) = delete;
+
+public:
+    static constexpr uint32_t INVALID_OFFSET = UINT32_MAX;
+
+    struct Allocation
+    {
+        uint32_t offset = INVALID_OFFSET;
+        uint32_t size = 0;
+        // Internal node, identifies the allocation to Free
+        uint32_t node = INVALID_OFFSET;
+
+        bool IsValid() const { return offset != INVALID_OFFSET; }
+    };
+
+    RangeAllocator() = default;
+    ~RangeAllocator() = default;
+
+    // Drops every allocation and starts over with one free range of capacity
+    void Initialize(uint32_t capacity);
+    void Release();
+
+    // Invalid allocation when no free range holds size
+    Allocation Allocate(uint32_t size);
+    void Free(const Allocation& allocation);
+
+    uint32_t GetCapacity() const { return m_capacity; }
+    uint32_t GetUsedSize() const { return m_usedSize; }
+    uint32_t GetFreeSize() const { return m_capacity - m_usedSize; }
+    uint32_t GetAllocationCount() const { return m_allocationCount; }
+    // Largest size Allocate can serve right now
+    uint32_t GetLargestFreeRange() const;
+
+private:
+    static constexpr uint32_t LEAF_BINS_PER_TOP_BIN = 8;
+    static constexpr uint32_t TOP_BIN_COUNT = 32;
+    static constexpr uint32_t BIN_COUNT = TOP_BIN_COUNT * LEAF_BINS_PER_TOP_BIN;
+    static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+    struct Node
+    {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        // Free list of the bin, only linked while the node is free
+        uint32_t binPrevious = INVALID_NODE;
+        uint32_t binNext = INVALID_NODE;
+        // Address ordered neighbors, used or free
+        uint32_t neighborPrevious = INVALID_NODE;
+        uint32_t neighborNext = INVALID_NODE;
+        bool isUsed = false;
+    };
+
+    // Smallest bin whose every range holds size, and the bin a free range of size is filed under
+    static uint32_t GetBinRoundUp(uint32_t size);
+    static uint32_t GetBinRoundDown(uint32_t size);
+
+    uint32_t CreateNode(uint32_t offset, uint32_t size);
+    void DestroyNode(uint32_t nodeIndex);
+    void InsertFreeNode(uint32_t nodeIndex);
+    void RemoveFreeNode(uint32_t nodeIndex);
+    // First non-empty bin at or above minBin, INVALID_NODE when there is none
+    uint32_t FindFreeBin(uint32_t minBin) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_freeNodes;
+
+    uint32_t m_usedTopBins = 0;
+    std::array<uint8_t, TOP_BIN_COUNT> m_usedLeafBins = {};
+    std::array<uint32_t, BIN_COUNT> m_binHeads = {};
+
+    uint32_t m_capacity = 0;
+    uint32_t m_usedSize = 0;
+    uint32_t m_allocationCount = 0;
+};
@@ -55,7 +55,7 @@ int __stdcall SystemWindow::WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance
     ShowWindow(hwnd, nCmdShow);
     UpdateWindow(hwnd);
 
-    s_App.Startup(hwnd);
+    s_App.Startup(hwnd, lpCmdLine ? lpCmdLine : "");
 
     MSG msg = {};
     while (msg.message != WM_QUIT)
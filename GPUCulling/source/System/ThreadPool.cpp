@@ -0,0 +1,137 @@
+#include "stdafx.h"
+#include "System/ThreadPool.h"
+
+#include <atomic>
+#include <memory>
+
+namespace
+{
+    struct ParallelForJob
+    {
+        const std::function<void(size_t, size_t)>* function = nullptr;
+        size_t count = 0;
+        size_t batchSize = 0;
+        size_t batchCount = 0;
+        std::atomic<size_t> nextBatch = 0;
+        std::atomic<size_t> completedBatches = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    // Runs batches until none are left. Helpers that start after the last batch was claimed return without touching
+    // the function, which may already be out of scope by then.
+    void RunBatches(ParallelForJob& job)
+    {
+        for (;;)
+        {
+            size_t batch = job.nextBatch.fetch_add(1);
+            if (batch >= job.batchCount)
+            {
+                return;
+            }
+
+            size_t begin = batch * job.batchSize;
+            size_t end = std::min(begin + job.batchSize, job.count);
+            (*job.function)(begin, end);
+
+            if (job.completedBatches.fetch_add(1) + 1 == job.batchCount)
+            {
+                std::lock_guard<std::mutex> lock(job.mutex);
+                job.finished.notify_all();
+            }
+        }
+    }
+}
+
+ThreadPool& ThreadPool::Get()
+{
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
+
+ThreadPool::ThreadPool(uint32_t workerCount)
+{
+    m_workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; ++i)
+    {
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_taskAvailable.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t begin, size_t end)>& function)
+{
+    assertm(batchSize > 0, "ThreadPool::ParallelFor called with zero batch size");
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Batch boundaries are kept when running inline too, callers may index per batch results by begin / batchSize
+    size_t batchCount = (count + batchSize - 1) / batchSize;
+    if (batchCount == 1 || m_workers.empty())
+    {
+        for (size_t begin = 0; begin < count; begin += batchSize)
+        {
+            function(begin, std::min(begin + batchSize, count));
+        }
+        return;
+    }
+
+    auto job = std::make_shared<ParallelForJob>();
+    job->function = &function;
+    job->count = count;
+    job->batchSize = batchSize;
+    job->batchCount = batchCount;
+
+    // The caller takes batches too, so one helper fewer than batches is enough
+    size_t helperCount = std::min(batchCount - 1, m_workers.size());
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < helperCount; ++i)
+        {
+            m_tasks.emplace_back([job]() { RunBatches(*job); });
+        }
+    }
+    m_taskAvailable.notify_all();
+
+    RunBatches(*job);
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job]() { return job->completedBatches.load() == job->batchCount; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskAvailable.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping && m_tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads shared by the CPU side processing (BVH builds, asset import, light binning).
+// ParallelFor lets the calling thread work through its own batches, so it is safe to call from inside another job.
+class ThreadPool
+{
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+public:
+    // Process wide pool with one worker per hardware thread besides the caller
+    static ThreadPool& Get();
+
+    explicit ThreadPool(uint32_t workerCount);
+    ~ThreadPool();
+
+    // Workers plus the calling thread
+    uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+    // Calls function(begin, end) over [0, count) in batches of batchSize and returns once every batch has run.
+    // Batches run in any order on any thread, callers that need deterministic output write to per batch slots.
+    void ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t begin, size_t end)>& function);
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_taskAvailable;
+    bool m_stopping = false;
+};
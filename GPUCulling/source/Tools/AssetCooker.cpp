@@ -0,0 +1,244 @@
+#include "stdafx.h"
+#include "IO/ModelLoader.h"
+#include "System/ThreadPool.h"
+
+#include <cstring>
+#include <mutex>
+
+// Offline cooker: imports every supported model under a directory and writes the cooked files the runtime opens with
+// CookedModel::Open, so the game never runs the Assimp import. Sources whose cooked file is up to date are skipped.
+//
+// Texture paths are stored as the loader resolves them against the source path, run the cooker from the directory
+// the game resolves asset paths against and pass the input relative to it.
+
+namespace
+{
+    struct CookerOptions
+    {
+        std::filesystem::path inputPath;
+        std::filesystem::path outputDirectory;
+        bool preserveInstancing = false;
+        bool splitLargeMeshes = false;
+        bool optimizeMeshes = true;
+        bool generateLODs = true;
+        bool quantizeVertices = true;
+        uint32_t meshletMaxVertices = 0;
+        uint32_t meshletMaxTriangles = 0;
+    };
+
+    struct CookJob
+    {
+        std::filesystem::path sourcePath;
+        std::filesystem::path outputPath;
+        ModelLoader::CookResult result = ModelLoader::CookResult::Failed;
+    };
+
+    void PrintUsage()
+    {
+        std::cout << "Usage: AssetCooker <input file or directory> <output directory> [options]\n"
+            << "Cooks every supported model under the input into <output directory>/<relative path>.cooked\n"
+            << "\n"
+            << "Options:\n"
+            << "  --instancing              Keep the node hierarchy and store each distinct mesh once\n"
+            << "  --split-large-meshes      Split meshes so every chunk fits 16-bit indices\n"
+            << "  --meshlet-limits <v> <t>  Maximum vertices and triangles per meshlet\n"
+            << "  --no-optimize             Skip the vertex cache, overdraw and vertex fetch reordering\n"
+            << "  --no-lods                 Skip the simplified levels of detail\n"
+            << "  --no-quantize             Skip the quantized vertex stream\n"
+            << std::endl;
+    }
+
+    bool ParseUInt(const char* text, uint32_t& outValue)
+    {
+        char* end = nullptr;
+        unsigned long value = std::strtoul(text, &end, 10);
+        if (end == text || *end != '\0' || value == 0 || value > UINT32_MAX)
+        {
+            return false;
+        }
+        outValue = static_cast<uint32_t>(value);
+        return true;
+    }
+
+    bool ParseArguments(int argc, char** argv, CookerOptions& outOptions)
+    {
+        std::vector<const char*> positional;
+        for (int i = 1; i < argc; ++i)
+        {
+            const char* argument = argv[i];
+            if (std::strcmp(argument, "--instancing") == 0)
+            {
+                outOptions.preserveInstancing = true;
+            }
+            else if (std::strcmp(argument, "--split-large-meshes") == 0)
+            {
+                outOptions.splitLargeMeshes = true;
+            }
+            else if (std::strcmp(argument, "--no-optimize") == 0)
+            {
+                outOptions.optimizeMeshes = false;
+            }
+            else if (std::strcmp(argument, "--no-lods") == 0)
+            {
+                outOptions.generateLODs = false;
+            }
+            else if (std::strcmp(argument, "--no-quantize") == 0)
+            {
+                outOptions.quantizeVertices = false;
+            }
+            else if (std::strcmp(argument, "--meshlet-limits") == 0)
+            {
+                if (i + 2 >= argc || !ParseUInt(argv[i + 1], outOptions.meshletMaxVertices) ||
+                    !ParseUInt(argv[i + 2], outOptions.meshletMaxTriangles))
+                {
+                    std::cerr << "--meshlet-limits takes two positive integers" << std::endl;
+                    return false;
+                }
+                i += 2;
+            }
+            else if (argument[0] == '-' && argument[1] == '-')
+            {
+                std::cerr << "Unknown option " << argument << std::endl;
+                return false;
+            }
+            else
+            {
+                positional.push_back(argument);
+            }
+        }
+
+        if (positional.size() != 2)
+        {
+            return false;
+        }
+
+        outOptions.inputPath = positional[0];
+        outOptions.outputDirectory = positional[1];
+        return true;
+    }
+
+    void ConfigureLoader(const CookerOptions& options, ModelLoader& loader)
+    {
+        loader.SetPreserveInstancing(options.preserveInstancing);
+        loader.SetSplitLargeMeshes(options.splitLargeMeshes);
+        loader.SetMeshOptimization(options.optimizeMeshes);
+        loader.SetQuantizeVertices(options.quantizeVertices);
+        if (!options.generateLODs)
+        {
+            loader.SetLODRatios({});
+        }
+        if (options.meshletMaxVertices > 0)
+        {
+            loader.SetMeshletLimits(options.meshletMaxVertices, options.meshletMaxTriangles);
+        }
+    }
+
+    // Sorted by path so the log and the output do not depend on the directory iteration order
+    bool CollectJobs(const CookerOptions& options, std::vector<CookJob>& outJobs)
+    {
+        ModelLoader loader;
+        std::error_code error;
+
+        auto addJob = [&](const std::filesystem::path& sourcePath, const std::filesystem::path& relativePath)
+        {
+            CookJob job;
+            job.sourcePath = sourcePath;
+            job.outputPath = options.outputDirectory / relativePath;
+            job.outputPath += ".cooked";
+            outJobs.push_back(std::move(job));
+        };
+
+        if (std::filesystem::is_regular_file(options.inputPath, error))
+        {
+            addJob(options.inputPath, options.inputPath.filename());
+            return true;
+        }
+
+        std::filesystem::recursive_directory_iterator it(options.inputPath, error);
+        if (error)
+        {
+            std::cerr << "Cannot read " << options.inputPath.string() << ": " << error.message() << std::endl;
+            return false;
+        }
+
+        for (const std::filesystem::directory_entry& entry : it)
+        {
+            if (entry.is_regular_file(error) && loader.IsFileSupported(entry.path().string()))
+            {
+                addJob(entry.path(), entry.path().lexically_relative(options.inputPath));
+            }
+        }
+
+        std::sort(outJobs.begin(), outJobs.end(), [](const CookJob& a, const CookJob& b) { return a.sourcePath < b.sourcePath; });
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    CookerOptions options;
+    if (!ParseArguments(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    std::vector<CookJob> jobs;
+    if (!CollectJobs(options, jobs))
+    {
+        return 1;
+    }
+
+    // Directories are created up front, creating the same one from several workers races
+    for (const CookJob& job : jobs)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(job.outputPath.parent_path(), error);
+        if (error)
+        {
+            std::cerr << "Cannot create " << job.outputPath.parent_path().string() << ": " << error.message() << std::endl;
+            return 1;
+        }
+    }
+
+    // One model per batch on the shared pool. Each import spreads its meshes over the same pool, so a single large
+    // model still uses every thread while small ones cook side by side.
+    std::mutex logMutex;
+    ThreadPool::Get().ParallelFor(jobs.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            CookJob& job = jobs[i];
+
+            ModelLoader loader;
+            ConfigureLoader(options, loader);
+            job.result = loader.CookModel(job.sourcePath.string(), job.outputPath.string());
+
+            const char* status = job.result == ModelLoader::CookResult::Cooked ? "cooked" :
+                job.result == ModelLoader::CookResult::UpToDate ? "up to date" : "FAILED";
+
+            std::lock_guard<std::mutex> lock(logMutex);
+            std::cout << status << ": " << job.sourcePath.string();
+            if (job.result == ModelLoader::CookResult::Cooked && loader.GetOptimizationReport().after.triangleCount > 0)
+            {
+                const MeshOptimizer::Report& report = loader.GetOptimizationReport();
+                std::cout << " (ACMR " << report.before.GetACMR() << " -> " << report.after.GetACMR() << ")";
+            }
+            std::cout << std::endl;
+        }
+    });
+
+    size_t cookedCount = 0;
+    size_t upToDateCount = 0;
+    size_t failedCount = 0;
+    for (const CookJob& job : jobs)
+    {
+        cookedCount += job.result == ModelLoader::CookResult::Cooked ? 1 : 0;
+        upToDateCount += job.result == ModelLoader::CookResult::UpToDate ? 1 : 0;
+        failedCount += job.result == ModelLoader::CookResult::Failed ? 1 : 0;
+    }
+
+    std::cout << jobs.size() << " models: " << cookedCount << " cooked, " << upToDateCount << " up to date, "
+        << failedCount << " failed" << std::endl;
+    return failedCount > 0 ? 1 : 0;
+}
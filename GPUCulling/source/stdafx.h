@@ -1,8 +1,11 @@
 #pragma once
 
+// The asset tools build on Linux too, they only use the CPU side of the tree
+#ifdef _WIN32
 #include <d3d12.h>
 #include <dxgi.h>
 #include <dxgi1_4.h>
+#endif
 
 #include <vector>
 #include <array>
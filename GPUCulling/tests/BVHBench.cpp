@@ -0,0 +1,41 @@
+#include "TestFramework.h"
+#include "TestScene.h"
+
+#include "Culling/BVH.h"
+#include "Culling/FrustumCuller.h"
+
+// The scene size the BVH was built for, compared against the flat SoA cull over the same boxes
+BENCHMARK_CASE(BVH, CullVersusBruteForce)
+{
+    constexpr size_t INSTANCE_COUNT = 500000;
+    std::vector<AABB> boxes = MakeRandomBoxes(INSTANCE_COUNT, 2, 4.0f);
+
+    BVH bvh;
+    double buildMilliseconds = MeasureMilliseconds(3, [&]() { bvh.Build(boxes.data(), boxes.size()); });
+    ReportTiming("BVH build, 500k instances", buildMilliseconds);
+
+    FrustumCuller culler;
+    culler.Reserve(INSTANCE_COUNT);
+    for (const AABB& box : boxes)
+    {
+        culler.AddInstance(box);
+    }
+
+    std::vector<uint32_t> bvhVisible;
+    std::vector<uint32_t> flatVisible(INSTANCE_COUNT + FrustumCuller::OUTPUT_PADDING);
+
+    // A wide view sees a third of the scene, a narrow one only a sliver
+    for (float farPlane : { 800.0f, 150.0f })
+    {
+        Frustum frustum = MakeTestFrustum(0.3f, farPlane);
+
+        size_t visibleCount = 0;
+        double bvhMilliseconds = MeasureMilliseconds(10, [&]() { visibleCount = bvh.Cull(frustum, bvhVisible); });
+        double flatMilliseconds = MeasureMilliseconds(10, [&]() { culler.Cull(frustum, flatVisible.data()); });
+
+        std::printf("    far plane %.0f, %zu visible\n", farPlane, visibleCount);
+        ReportTiming("BVH cull", bvhMilliseconds);
+        ReportTiming("brute force SoA cull", flatMilliseconds);
+        std::printf("        BVH speedup %.2fx\n", flatMilliseconds / bvhMilliseconds);
+    }
+}
@@ -0,0 +1,160 @@
+#include "TestFramework.h"
+#include "TestScene.h"
+
+#include "Culling/BVH.h"
+
+#include <numeric>
+
+namespace
+{
+    std::vector<uint32_t> CullReference(const std::vector<AABB>& boxes, const Frustum& frustum)
+    {
+        std::vector<uint32_t> visible;
+        for (size_t i = 0; i < boxes.size(); ++i)
+        {
+            if (frustum.IntersectsAABB(boxes[i]))
+            {
+                visible.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        return visible;
+    }
+
+    bool Encloses(const AABB& outer, const AABB& inner)
+    {
+        return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+            outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+    }
+
+    // Every primitive below a child has to lie inside the child's decoded bounds
+    void CheckNodeBounds(const BVH& bvh, uint32_t nodeIndex)
+    {
+        const BVH::Node& node = bvh.GetNodes()[nodeIndex];
+        for (uint32_t c = 0; c < BVH::NODE_WIDTH; ++c)
+        {
+            if (node.childType[c] == BVH::EMPTY_CHILD)
+            {
+                continue;
+            }
+
+            AABB childBounds = BVH::GetChildBounds(node, c);
+            uint32_t begin = node.child[c];
+            uint32_t end = begin + node.childType[c];
+            if (node.childType[c] == BVH::INNER_CHILD)
+            {
+                const BVH::Node& childNode = bvh.GetNodes()[node.child[c]];
+                begin = childNode.primitiveBegin;
+                end = childNode.primitiveEnd;
+                CheckNodeBounds(bvh, node.child[c]);
+            }
+
+            for (uint32_t p = begin; p < end; ++p)
+            {
+                CHECK(Encloses(childBounds, bvh.GetPrimitiveBounds()[p]));
+            }
+        }
+    }
+}
+
+TEST_CASE(BVH, BuildKeepsEveryPrimitive)
+{
+    for (size_t count : { size_t(1), size_t(4), size_t(5), size_t(33), size_t(20000) })
+    {
+        std::vector<AABB> boxes = MakeRandomBoxes(count, static_cast<uint32_t>(count));
+        BVH bvh;
+        bvh.Build(boxes.data(), boxes.size());
+        REQUIRE(bvh.GetPrimitiveCount() == count);
+        REQUIRE(bvh.GetNodeCount() > 0);
+
+        // The tree order is a permutation of the input
+        std::vector<uint32_t> indices = bvh.GetPrimitiveIndices();
+        std::sort(indices.begin(), indices.end());
+        std::vector<uint32_t> expected(count);
+        std::iota(expected.begin(), expected.end(), 0u);
+        CHECK(indices == expected);
+
+        for (size_t p = 0; p < count; ++p)
+        {
+            const AABB& original = boxes[bvh.GetPrimitiveIndices()[p]];
+            CHECK(Encloses(original, bvh.GetPrimitiveBounds()[p]) && Encloses(bvh.GetPrimitiveBounds()[p], original));
+            CHECK(Encloses(bvh.GetBounds(), original));
+        }
+
+        CheckNodeBounds(bvh, 0);
+    }
+}
+
+TEST_CASE(BVH, CullMatchesBruteForce)
+{
+    std::vector<AABB> boxes = MakeRandomBoxes(50000, 11);
+    BVH bvh;
+    bvh.Build(boxes.data(), boxes.size());
+
+    // Includes a far plane inside the scene and views from outside it
+    for (float yaw : { 0.0f, 0.3f, 1.5f, 3.1f })
+    {
+        for (float farPlane : { 100.0f, 800.0f, 5000.0f })
+        {
+            Frustum frustum = MakeTestFrustum(yaw, farPlane);
+            std::vector<uint32_t> reference = CullReference(boxes, frustum);
+
+            for (CullPath path : { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 })
+            {
+                if (path == CullPath::AVX2 && DEFAULT_CULL_PATH != CullPath::AVX2)
+                {
+                    continue;
+                }
+
+                std::vector<uint32_t> visible;
+                CHECK(bvh.Cull(frustum, visible, path) == reference.size());
+                std::sort(visible.begin(), visible.end());
+                CHECK(visible == reference);
+            }
+        }
+    }
+}
+
+TEST_CASE(BVH, CullViewsMatchesCull)
+{
+    std::vector<AABB> boxes = MakeRandomBoxes(20000, 5);
+    BVH bvh;
+    bvh.Build(boxes.data(), boxes.size());
+
+    Frustum frusta[MAX_CULL_VIEWS];
+    for (uint32_t v = 0; v < MAX_CULL_VIEWS; ++v)
+    {
+        frusta[v] = MakeTestFrustum(v * 0.8f, 150.0f + 100.0f * v);
+    }
+
+    for (uint32_t viewCount = 1; viewCount <= MAX_CULL_VIEWS; ++viewCount)
+    {
+        std::vector<uint32_t> visible;
+        std::vector<uint8_t> viewMasks;
+        bvh.CullViews(frusta, viewCount, visible, viewMasks);
+        REQUIRE(visible.size() == viewMasks.size());
+
+        for (uint32_t v = 0; v < viewCount; ++v)
+        {
+            std::vector<uint32_t> single;
+            bvh.Cull(frusta[v], single);
+            std::sort(single.begin(), single.end());
+
+            std::vector<uint32_t> fromViews;
+            for (size_t i = 0; i < visible.size(); ++i)
+            {
+                if (viewMasks[i] & (1u << v))
+                {
+                    fromViews.push_back(visible[i]);
+                }
+            }
+            std::sort(fromViews.begin(), fromViews.end());
+            CHECK(fromViews == single);
+        }
+
+        // Each primitive is listed once, with at least one view
+        std::vector<uint32_t> sorted = visible;
+        std::sort(sorted.begin(), sorted.end());
+        CHECK(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+        CHECK(std::find(viewMasks.begin(), viewMasks.end(), uint8_t(0)) == viewMasks.end());
+    }
+}
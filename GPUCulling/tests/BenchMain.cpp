@@ -0,0 +1,7 @@
+#include "TestFramework.h"
+
+// GPUCullingBench [suite], build in Release for meaningful numbers
+int main(int argc, char** argv)
+{
+    return RunTestCases(GetBenchmarkCases(), argc > 1 ? argv[1] : nullptr) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,91 @@
+#include "TestFramework.h"
+
+#include "Culling/Bounds.h"
+
+#include <cmath>
+#include <random>
+
+namespace
+{
+    // Points on a unit sphere around the center, the smallest enclosing sphere has radius 1
+    std::vector<XMFLOAT3> MakeSpherePoints(const XMFLOAT3& center, size_t count, uint32_t seed)
+    {
+        std::mt19937 generator(seed);
+        std::normal_distribution<float> normal;
+        std::vector<XMFLOAT3> points(count);
+        for (XMFLOAT3& point : points)
+        {
+            XMFLOAT3 direction;
+            XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(normal(generator), normal(generator), normal(generator), 0.0f)));
+            point = XMFLOAT3(center.x + direction.x, center.y + direction.y, center.z + direction.z);
+        }
+        return points;
+    }
+
+    bool Encloses(const Sphere& sphere, const std::vector<XMFLOAT3>& points)
+    {
+        for (const XMFLOAT3& point : points)
+        {
+            double dx = double(point.x) - sphere.center.x;
+            double dy = double(point.y) - sphere.center.y;
+            double dz = double(point.z) - sphere.center.z;
+            if (std::sqrt(dx * dx + dy * dy + dz * dz) > sphere.radius)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST_CASE(Bounds, RitterSphereEnclosesAndStaysTight)
+{
+    // Counts off a multiple of four leave points after the grouped tests, and far from the origin the pad has to
+    // cover the rounding of the coordinates rather than the radius
+    const XMFLOAT3 centers[] = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(-700.0f, 300.0f, 900.0f) };
+    for (const XMFLOAT3& center : centers)
+    {
+        for (size_t count : { 1u, 3u, 2001u })
+        {
+            std::vector<XMFLOAT3> points = MakeSpherePoints(center, count, static_cast<uint32_t>(count));
+            Sphere sphere = ComputeBoundingSphere(points.data(), points.size());
+            CHECK(Encloses(sphere, points));
+            CHECK(sphere.radius <= 1.15f);
+        }
+    }
+
+    // The streamed accumulator gives the same sphere for points inside a larger vertex
+    struct Vertex
+    {
+        XMFLOAT3 position;
+        float padding[5];
+    };
+    std::vector<XMFLOAT3> points = MakeSpherePoints(XMFLOAT3(5.0f, 0.0f, 0.0f), 999, 7);
+    std::vector<Vertex> vertices(points.size());
+    BoundsAccumulator accumulator;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        vertices[i].position = points[i];
+        accumulator.Add(points[i]);
+    }
+    Sphere streamed = accumulator.GetSphere(&vertices[0].position, vertices.size(), sizeof(Vertex));
+    Sphere packed = ComputeBoundingSphere(points.data(), points.size());
+    CHECK(streamed.radius == packed.radius);
+    CHECK(streamed.center.x == packed.center.x && streamed.center.y == packed.center.y && streamed.center.z == packed.center.z);
+    CHECK(Encloses(streamed, points));
+}
+
+TEST_CASE(Bounds, RitterSphereSeedsFromTheLongestAxis)
+{
+    // A thin rod along z with its middle added first: the extremes along z seed the sphere at the rod's exact extent
+    std::vector<XMFLOAT3> points;
+    points.push_back(XMFLOAT3(0.0f, 0.0f, 0.0f));
+    for (int i = -50; i <= 50; ++i)
+    {
+        points.push_back(XMFLOAT3(0.001f * static_cast<float>(i % 3), 0.0f, static_cast<float>(i) * 0.1f));
+    }
+    Sphere sphere = ComputeBoundingSphere(points.data(), points.size());
+    CHECK(Encloses(sphere, points));
+    CHECK(std::abs(sphere.center.z) < 1e-3f);
+    CHECK(sphere.radius < 5.01f);
+}
@@ -0,0 +1,304 @@
+#include "TestFramework.h"
+
+#include "Culling/ClusterCuller.h"
+#include "Culling/FrustumCuller.h"
+#include "Engine/Camera.h"
+
+#include <cmath>
+#include <random>
+
+using namespace ShaderInterop;
+
+namespace
+{
+    constexpr float VIEWPORT_WIDTH = 1920.0f;
+    constexpr float VIEWPORT_HEIGHT = 1080.0f;
+
+    struct TestMesh
+    {
+        std::vector<XMFLOAT3> positions;
+        std::vector<uint32_t> indices;
+        MeshletData meshlets;
+        uint32_t firstCluster = 0;
+    };
+
+    // UV sphere, optionally with its normals pointing in so the camera sees the inside
+    TestMesh MakeSphere(const XMFLOAT3& center, float radius, uint32_t slices, uint32_t stacks, bool isInverted)
+    {
+        TestMesh mesh;
+        for (uint32_t stack = 0; stack <= stacks; ++stack)
+        {
+            float phi = XM_PI * stack / stacks;
+            for (uint32_t slice = 0; slice <= slices; ++slice)
+            {
+                float theta = XM_2PI * slice / slices;
+                mesh.positions.push_back(XMFLOAT3(center.x + radius * std::sin(phi) * std::cos(theta), center.y + radius * std::cos(phi),
+                    center.z + radius * std::sin(phi) * std::sin(theta)));
+            }
+        }
+        for (uint32_t stack = 0; stack < stacks; ++stack)
+        {
+            for (uint32_t slice = 0; slice < slices; ++slice)
+            {
+                uint32_t v = stack * (slices + 1) + slice;
+                if (isInverted)
+                {
+                    mesh.indices.insert(mesh.indices.end(), { v, v + slices + 1, v + 1, v + 1, v + slices + 1, v + slices + 2 });
+                }
+                else
+                {
+                    mesh.indices.insert(mesh.indices.end(), { v, v + 1, v + slices + 1, v + 1, v + slices + 2, v + slices + 1 });
+                }
+            }
+        }
+        return mesh;
+    }
+
+    TestMesh MakeTerrain(uint32_t size)
+    {
+        TestMesh mesh;
+        for (uint32_t z = 0; z < size; ++z)
+        {
+            for (uint32_t x = 0; x < size; ++x)
+            {
+                float height = 4.0f * std::sin(x * 0.15f) * std::cos(z * 0.1f);
+                mesh.positions.push_back(XMFLOAT3(x - size * 0.5f, height - 10.0f, z - size * 0.5f));
+            }
+        }
+        for (uint32_t z = 0; z + 1 < size; ++z)
+        {
+            for (uint32_t x = 0; x + 1 < size; ++x)
+            {
+                uint32_t v = z * size + x;
+                mesh.indices.insert(mesh.indices.end(), { v, v + size, v + 1, v + 1, v + size, v + size + 1 });
+            }
+        }
+        return mesh;
+    }
+
+    void InitializeCamera(Camera& camera, const XMFLOAT3& position, float yaw, float pitch)
+    {
+        camera.Initialize(70.0f, VIEWPORT_WIDTH / VIEWPORT_HEIGHT, 0.1f, 1000.0f);
+        camera.SetPosition(position);
+        camera.SetRotation(yaw, pitch);
+    }
+
+    // Every path has to keep exactly the clusters the scalar path keeps
+    std::vector<uint32_t> CullOnEveryPath(const ClusterCuller& culler, const ClusterCullConstants& constants)
+    {
+        std::vector<uint32_t> reference;
+        culler.Cull(constants, reference, CullPath::Scalar);
+        for (CullPath path : { CullPath::SSE, CullPath::AVX2 })
+        {
+            if (FrustumCuller::IsCullPathSupported(path))
+            {
+                std::vector<uint32_t> visible;
+                culler.Cull(constants, visible, path);
+                CHECK(visible == reference);
+            }
+        }
+        return reference;
+    }
+
+    // Points spread evenly over a sphere (Fibonacci lattice)
+    std::vector<XMFLOAT3> SampleSphere(const XMFLOAT3& center, float radius, uint32_t count)
+    {
+        std::vector<XMFLOAT3> points(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            float y = 1.0f - 2.0f * (i + 0.5f) / count;
+            float ring = std::sqrt(std::max(1.0f - y * y, 0.0f));
+            float theta = i * 2.39996323f;
+            points[i] = XMFLOAT3(center.x + radius * ring * std::cos(theta), center.y + radius * y, center.z + radius * ring * std::sin(theta));
+        }
+        return points;
+    }
+}
+
+TEST_CASE(ClusterCuller, ConeTestKeepsFrontFacingClusters)
+{
+    std::vector<TestMesh> meshes;
+    meshes.push_back(MakeSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 10.0f, 64, 32, false));
+    meshes.push_back(MakeSphere(XMFLOAT3(30.0f, 5.0f, -10.0f), 3.0f, 24, 12, false));
+    meshes.push_back(MakeSphere(XMFLOAT3(-25.0f, 0.0f, 20.0f), 15.0f, 48, 24, true));
+    meshes.push_back(MakeTerrain(80));
+
+    ClusterCuller culler;
+    MeshletBuilder builder(MeshletBuilder::DEFAULT_MAX_VERTICES, 32);
+    for (TestMesh& mesh : meshes)
+    {
+        builder.Build(mesh.positions.data(), mesh.positions.size(), sizeof(XMFLOAT3), mesh.indices.data(), mesh.indices.size(), mesh.meshlets);
+        mesh.firstCluster = culler.AddMeshlets(mesh.meshlets);
+    }
+
+    // Viewers all over the scene, just off the surfaces and inside the inverted sphere
+    std::mt19937 generator(21);
+    std::uniform_real_distribution<float> coordinate(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<XMFLOAT3> viewers;
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        viewers.push_back(XMFLOAT3(coordinate(generator), coordinate(generator), coordinate(generator)));
+        XMVECTOR direction = XMVector3Normalize(XMVectorSet(unit(generator), unit(generator), unit(generator), 0.0f));
+        XMFLOAT3 nearSurface;
+        XMStoreFloat3(&nearSurface, XMVectorScale(direction, 10.0f + 0.01f * (i % 10)));
+        viewers.push_back(nearSurface);
+        XMFLOAT3 inside;
+        XMStoreFloat3(&inside, XMVectorAdd(XMVectorSet(-25.0f, 0.0f, 20.0f, 0.0f), XMVectorScale(direction, 14.0f * (i % 10) / 10.0f)));
+        viewers.push_back(inside);
+    }
+
+    size_t culledCount = 0;
+    for (const XMFLOAT3& viewer : viewers)
+    {
+        Camera camera;
+        InitializeCamera(camera, viewer, 0.0f, 0.0f);
+        ClusterCullConstants constants = ClusterCuller::BuildConstants(camera, VIEWPORT_WIDTH, VIEWPORT_HEIGHT, CLUSTER_CULL_BACKFACE);
+        std::vector<uint32_t> visible = CullOnEveryPath(culler, constants);
+        std::vector<bool> isVisible(culler.GetClusterCount(), false);
+        for (uint32_t cluster : visible)
+        {
+            isVisible[cluster] = true;
+        }
+
+        // A culled cluster may not have a single triangle facing the viewer
+        for (const TestMesh& mesh : meshes)
+        {
+            for (size_t m = 0; m < mesh.meshlets.meshlets.size(); ++m)
+            {
+                if (isVisible[mesh.firstCluster + m])
+                {
+                    continue;
+                }
+
+                ++culledCount;
+                const Meshlet& meshlet = mesh.meshlets.meshlets[m];
+                for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+                {
+                    const uint8_t* triangle = &mesh.meshlets.triangles[meshlet.triangleOffset + t * 3];
+                    XMVECTOR p0 = XMLoadFloat3(&mesh.positions[mesh.meshlets.vertices[meshlet.vertexOffset + triangle[0]]]);
+                    XMVECTOR p1 = XMLoadFloat3(&mesh.positions[mesh.meshlets.vertices[meshlet.vertexOffset + triangle[1]]]);
+                    XMVECTOR p2 = XMLoadFloat3(&mesh.positions[mesh.meshlets.vertices[meshlet.vertexOffset + triangle[2]]]);
+                    XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+                    XMVECTOR toViewer = XMVectorSubtract(XMLoadFloat3(&viewer), p0);
+                    float facing = XMVectorGetX(XMVector3Dot(toViewer, normal));
+                    float scale = XMVectorGetX(XMVector3Length(toViewer)) * XMVectorGetX(XMVector3Length(normal));
+                    CHECK(facing <= 1e-4f * scale);
+                }
+            }
+        }
+    }
+
+    // Roughly the far half of every closed surface goes
+    CHECK(culledCount > culler.GetClusterCount() * viewers.size() / 10);
+}
+
+TEST_CASE(ClusterCuller, SphereBoundsContainTheProjectedSphere)
+{
+    std::mt19937 generator(22);
+    std::uniform_real_distribution<float> lateral(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> depth(0.2f, 400.0f);
+    std::uniform_real_distribution<float> exponent(-3.0f, 1.5f);
+
+    for (uint32_t i = 0; i < 2000; ++i)
+    {
+        float radius = std::pow(10.0f, exponent(generator));
+        XMFLOAT3 center(lateral(generator), lateral(generator), depth(generator) + radius);
+        if (center.z - radius <= 0.1f)
+        {
+            continue;
+        }
+
+        float radiusSquared = radius * radius;
+        float tangentX = std::sqrt(center.x * center.x + center.z * center.z - radiusSquared);
+        float tangentY = std::sqrt(center.y * center.y + center.z * center.z - radiusSquared);
+        float minX = GetSphereProjectionBound<float, bool>(center.x, center.z, radius, tangentX, -1.0f);
+        float maxX = GetSphereProjectionBound<float, bool>(center.x, center.z, radius, tangentX, 1.0f);
+        float minY = GetSphereProjectionBound<float, bool>(center.y, center.z, radius, tangentY, -1.0f);
+        float maxY = GetSphereProjectionBound<float, bool>(center.y, center.z, radius, tangentY, 1.0f);
+        REQUIRE(minX <= maxX && minY <= maxY);
+
+        // The box of the projected surface samples lies inside the bounds and reaches nearly to them
+        float sampleMinX = FLT_MAX, sampleMaxX = -FLT_MAX, sampleMinY = FLT_MAX, sampleMaxY = -FLT_MAX;
+        for (const XMFLOAT3& point : SampleSphere(center, radius, 4096))
+        {
+            sampleMinX = std::min(sampleMinX, point.x / point.z);
+            sampleMaxX = std::max(sampleMaxX, point.x / point.z);
+            sampleMinY = std::min(sampleMinY, point.y / point.z);
+            sampleMaxY = std::max(sampleMaxY, point.y / point.z);
+        }
+
+        float toleranceX = 1e-5f * (std::fabs(minX) + std::fabs(maxX)) + 1e-6f;
+        float toleranceY = 1e-5f * (std::fabs(minY) + std::fabs(maxY)) + 1e-6f;
+        CHECK(minX <= sampleMinX + toleranceX && maxX >= sampleMaxX - toleranceX);
+        CHECK(minY <= sampleMinY + toleranceY && maxY >= sampleMaxY - toleranceY);
+        CHECK(sampleMinX - minX <= 0.01f * (maxX - minX) + toleranceX && maxX - sampleMaxX <= 0.01f * (maxX - minX) + toleranceX);
+        CHECK(sampleMinY - minY <= 0.01f * (maxY - minY) + toleranceY && maxY - sampleMaxY <= 0.01f * (maxY - minY) + toleranceY);
+    }
+}
+
+TEST_CASE(ClusterCuller, SmallClustersCoverNoSample)
+{
+    // Clusters from a few pixels down to far below one, a count that leaves a scalar tail on the SIMD paths
+    std::mt19937 generator(23);
+    std::uniform_real_distribution<float> coordinate(-300.0f, 300.0f);
+    std::uniform_real_distribution<float> exponent(-3.0f, 0.5f);
+
+    ClusterCuller culler;
+    std::vector<Sphere> spheres;
+    for (uint32_t i = 0; i < 5003; ++i)
+    {
+        Meshlet meshlet;
+        meshlet.boundingSphere.center = XMFLOAT3(coordinate(generator), coordinate(generator), coordinate(generator));
+        meshlet.boundingSphere.radius = std::pow(10.0f, exponent(generator));
+        spheres.push_back(meshlet.boundingSphere);
+        culler.AddCluster(meshlet);
+    }
+
+    size_t culledCount = 0;
+    for (float yaw : { 0.0f, 90.0f, 200.0f })
+    {
+        Camera camera;
+        InitializeCamera(camera, XMFLOAT3(10.0f, 5.0f, -20.0f), yaw, -5.0f);
+        ClusterCullConstants constants = ClusterCuller::BuildConstants(camera, VIEWPORT_WIDTH, VIEWPORT_HEIGHT, CLUSTER_CULL_SMALL_PRIMITIVE);
+        std::vector<uint32_t> visible = CullOnEveryPath(culler, constants);
+        std::vector<bool> isVisible(culler.GetClusterCount(), false);
+        for (uint32_t cluster : visible)
+        {
+            isVisible[cluster] = true;
+        }
+
+        // Project the surface of every culled sphere in front of the camera: no pixel centre may fall inside
+        XMMATRIX view = camera.GetViewMatrix();
+        for (size_t i = 0; i < spheres.size(); ++i)
+        {
+            if (isVisible[i])
+            {
+                continue;
+            }
+
+            ++culledCount;
+            XMFLOAT3 viewCenter;
+            XMStoreFloat3(&viewCenter, XMVector3Transform(XMLoadFloat3(&spheres[i].center), view));
+            CHECK(viewCenter.z - spheres[i].radius > constants.nearPlane);
+
+            float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX;
+            for (const XMFLOAT3& point : SampleSphere(viewCenter, spheres[i].radius, 256))
+            {
+                float pixelX = (point.x / point.z * constants.projectionScaleX * 0.5f + 0.5f) * VIEWPORT_WIDTH;
+                float pixelY = (0.5f - point.y / point.z * constants.projectionScaleY * 0.5f) * VIEWPORT_HEIGHT;
+                minX = std::min(minX, pixelX);
+                maxX = std::max(maxX, pixelX);
+                minY = std::min(minY, pixelY);
+                maxY = std::max(maxY, pixelY);
+            }
+            bool coversSample = std::ceil(minX - 0.5f) <= std::floor(maxX - 0.5f) && std::ceil(minY - 0.5f) <= std::floor(maxY - 0.5f);
+            CHECK(!coversSample);
+        }
+
+        // Turning the test off keeps everything
+        constants.cullFlags = 0;
+        CHECK(CullOnEveryPath(culler, constants).size() == culler.GetClusterCount());
+    }
+    CHECK(culledCount > 1000);
+}
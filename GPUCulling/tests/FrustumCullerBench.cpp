@@ -0,0 +1,48 @@
+#include "TestFramework.h"
+#include "TestScene.h"
+
+#include "Culling/FrustumCuller.h"
+
+namespace
+{
+    // Throughput the SoA layout was built for, per core
+    constexpr double MIN_BOX_TESTS_PER_SECOND = 100.0e6;
+}
+
+BENCHMARK_CASE(FrustumCuller, BoxTestsPerSecond)
+{
+    constexpr size_t BOX_COUNT = 1 << 20;
+    std::vector<AABB> boxes = MakeRandomBoxes(BOX_COUNT, 1);
+
+    FrustumCuller culler;
+    culler.Reserve(BOX_COUNT);
+    for (const AABB& box : boxes)
+    {
+        culler.AddInstance(box);
+    }
+
+    Frustum frustum = MakeTestFrustum();
+    std::vector<uint32_t> visible(BOX_COUNT + FrustumCuller::OUTPUT_PADDING);
+
+    for (CullPath path : { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 })
+    {
+        if (!FrustumCuller::IsCullPathSupported(path))
+        {
+            continue;
+        }
+
+        size_t visibleCount = 0;
+        double milliseconds = MeasureMilliseconds(10, [&]() { visibleCount = culler.Cull(frustum, visible.data(), path); });
+        double boxTestsPerSecond = BOX_COUNT / (milliseconds * 1.0e-3);
+
+        const char* label = path == CullPath::Scalar ? "scalar, 1M boxes" : path == CullPath::SSE ? "SSE, 1M boxes" : "AVX2, 1M boxes";
+        ReportTiming(label, milliseconds);
+        std::printf("        %.1fM box tests/s, %zu visible\n", boxTestsPerSecond * 1.0e-6, visibleCount);
+
+        // The scalar path is the reference, only the SIMD paths have to reach the target
+        if (path != CullPath::Scalar)
+        {
+            CHECK(boxTestsPerSecond >= MIN_BOX_TESTS_PER_SECOND);
+        }
+    }
+}
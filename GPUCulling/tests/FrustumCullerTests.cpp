@@ -0,0 +1,139 @@
+#include "TestFramework.h"
+#include "TestScene.h"
+
+#include "Culling/FrustumCuller.h"
+#include "Engine/Camera.h"
+
+namespace
+{
+    std::vector<uint32_t> CullReference(const std::vector<AABB>& boxes, const Frustum& frustum)
+    {
+        std::vector<uint32_t> visible;
+        for (size_t i = 0; i < boxes.size(); ++i)
+        {
+            if (frustum.IntersectsAABB(boxes[i]))
+            {
+                visible.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        return visible;
+    }
+
+    bool IsSameFrustum(const Frustum& a, const Frustum& b)
+    {
+        for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            if (a.planes[p].x != b.planes[p].x || a.planes[p].y != b.planes[p].y || a.planes[p].z != b.planes[p].z ||
+                a.planes[p].w != b.planes[p].w)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST_CASE(FrustumCuller, FrustumPlanesPointInside)
+{
+    Frustum frustum = Frustum::FromMatrix(XMMatrixMultiply(
+        XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)),
+        XMMatrixPerspectiveFovLH(XMConvertToRadians(90.0f), 1.0f, 1.0f, 100.0f)));
+
+    CHECK(frustum.ContainsPoint(XMFLOAT3(0.0f, 0.0f, 50.0f)));
+    CHECK(frustum.ContainsPoint(XMFLOAT3(9.0f, -9.0f, 10.0f)));
+    CHECK(!frustum.ContainsPoint(XMFLOAT3(0.0f, 0.0f, -5.0f)));
+    CHECK(!frustum.ContainsPoint(XMFLOAT3(0.0f, 0.0f, 0.5f)));
+    CHECK(!frustum.ContainsPoint(XMFLOAT3(0.0f, 0.0f, 101.0f)));
+    CHECK(!frustum.ContainsPoint(XMFLOAT3(11.0f, 0.0f, 10.0f)));
+    CHECK(!frustum.ContainsPoint(XMFLOAT3(0.0f, 11.0f, 10.0f)));
+
+    AABB straddling;
+    straddling.min = XMFLOAT3(-200.0f, -1.0f, 20.0f);
+    straddling.max = XMFLOAT3(-5.0f, 1.0f, 30.0f);
+    CHECK(frustum.IntersectsAABB(straddling));
+
+    AABB behind;
+    behind.min = XMFLOAT3(-1.0f, -1.0f, -10.0f);
+    behind.max = XMFLOAT3(1.0f, 1.0f, -2.0f);
+    CHECK(!frustum.IntersectsAABB(behind));
+}
+
+TEST_CASE(FrustumCuller, CameraFrustumFollowsCamera)
+{
+    Camera camera;
+    camera.Initialize(60.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+    camera.SetPosition(0.0f, 0.0f, -10.0f);
+    camera.SetTarget(0.0f, 0.0f, 0.0f);
+
+    CHECK(IsSameFrustum(camera.GetFrustum(), Frustum::FromMatrix(camera.GetViewProjectionMatrix())));
+    CHECK(camera.GetFrustum().ContainsPoint(XMFLOAT3(0.0f, 0.0f, 0.0f)));
+
+    // Moving past the origin has to invalidate the cached planes
+    camera.SetPosition(0.0f, 0.0f, 10.0f);
+    camera.SetTarget(0.0f, 0.0f, 20.0f);
+    CHECK(IsSameFrustum(camera.GetFrustum(), Frustum::FromMatrix(camera.GetViewProjectionMatrix())));
+    CHECK(!camera.GetFrustum().ContainsPoint(XMFLOAT3(0.0f, 0.0f, 0.0f)));
+
+    camera.SetClipPlanes(0.1f, 5.0f);
+    CHECK(!camera.GetFrustum().ContainsPoint(XMFLOAT3(0.0f, 0.0f, 16.0f)));
+}
+
+TEST_CASE(FrustumCuller, PathsMatchReference)
+{
+    // Counts around the SIMD widths exercise the scalar tails
+    for (size_t count : { size_t(0), size_t(1), size_t(3), size_t(4), size_t(7), size_t(8), size_t(9), size_t(1000), size_t(65537) })
+    {
+        std::vector<AABB> boxes = MakeRandomBoxes(count, static_cast<uint32_t>(count) + 1);
+
+        FrustumCuller culler;
+        culler.Reserve(count);
+        for (const AABB& box : boxes)
+        {
+            culler.AddInstance(box);
+        }
+        REQUIRE(culler.GetInstanceCount() == count);
+
+        for (float yaw : { 0.0f, 0.3f, 2.0f, -1.2f })
+        {
+            Frustum frustum = MakeTestFrustum(yaw);
+            std::vector<uint32_t> reference = CullReference(boxes, frustum);
+
+            for (CullPath path : { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 })
+            {
+                if (!FrustumCuller::IsCullPathSupported(path))
+                {
+                    continue;
+                }
+
+                std::vector<uint32_t> visible;
+                CHECK(culler.Cull(frustum, visible, path) == reference.size());
+                CHECK(visible == reference);
+            }
+        }
+    }
+}
+
+TEST_CASE(FrustumCuller, SetInstanceBoundsUpdatesCull)
+{
+    std::vector<AABB> boxes = MakeRandomBoxes(100, 7);
+    FrustumCuller culler;
+    for (const AABB& box : boxes)
+    {
+        culler.AddInstance(box);
+    }
+
+    // Move every box behind the camera, nothing survives
+    AABB behind;
+    behind.min = XMFLOAT3(-1.0f, -1.0f, -TEST_SCENE_EXTENT * 2.0f);
+    behind.max = XMFLOAT3(1.0f, 1.0f, -TEST_SCENE_EXTENT * 2.0f + 1.0f);
+    for (uint32_t i = 0; i < culler.GetInstanceCount(); ++i)
+    {
+        culler.SetInstanceBounds(i, behind);
+    }
+
+    AABB stored = culler.GetInstanceBounds(42);
+    CHECK(stored.min.z == behind.min.z && stored.max.z == behind.max.z);
+
+    std::vector<uint32_t> visible;
+    CHECK(culler.Cull(MakeTestFrustum(), visible) == 0);
+}
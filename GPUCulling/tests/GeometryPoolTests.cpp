@@ -0,0 +1,319 @@
+#include "TestFramework.h"
+
+#include "IO/GeometryPool.h"
+#include "IO/VertexPacking.h"
+#include "Culling/QuantizedBounds.h"
+
+#include <cstring>
+#include <map>
+#include <random>
+
+namespace
+{
+    // Every quantized vertex is distinct, so a vertex range read from the wrong place never matches. Without
+    // quantized vertices the pool packs the full precision ones on the way in.
+    MeshData MakeMesh(uint32_t vertexCount, IndexFormat indexFormat, uint32_t seed, bool isQuantized = true)
+    {
+        std::mt19937 generator(seed);
+        MeshData mesh;
+        mesh.indexFormat = indexFormat;
+        mesh.vertices.resize(vertexCount);
+        mesh.bounds.min = XMFLOAT3(0.0f, -1.0f, 0.0f);
+        mesh.bounds.max = XMFLOAT3(1.0f, 0.0f, 0.5f);
+        for (uint32_t i = 0; i < vertexCount; ++i)
+        {
+            float value = static_cast<float>(i) / static_cast<float>(vertexCount);
+            VertexData& vertex = mesh.vertices[i];
+            vertex.position = XMFLOAT3(value, -value, 0.5f * value);
+            vertex.normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+            vertex.texCoord = XMFLOAT2(value, 2.0f * value);
+            vertex.tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
+            vertex.bitangent = XMFLOAT3(0.0f, 0.0f, -1.0f);
+        }
+
+        if (isQuantized)
+        {
+            mesh.quantization = MakeBoundsQuantization(mesh.bounds);
+            mesh.quantizedVertices.resize(vertexCount);
+            for (uint32_t i = 0; i < vertexCount; ++i)
+            {
+                uint32_t value = seed * 10000 + i;
+                mesh.quantizedVertices[i] = { value, ~value, value * 3, value * 5, value * 7 };
+            }
+        }
+
+        std::uniform_int_distribution<uint32_t> vertex(0, vertexCount - 1);
+        for (size_t count : { 12, 6, 3 })
+        {
+            std::vector<uint32_t>& indices = count == 12 ? mesh.indices : mesh.lods.emplace_back().indices;
+            for (size_t i = 0; i < count; ++i)
+            {
+                indices.push_back(vertex(generator));
+            }
+        }
+        return mesh;
+    }
+
+    // Contents of the GPU buffers, written by replaying the queued work the way GeometryPoolPass does
+    struct GPUStreams
+    {
+        std::array<std::vector<uint8_t>, GEOMETRY_STREAM_COUNT> buffers;
+
+        explicit GPUStreams(const GeometryPool& pool)
+        {
+            for (size_t stream = 0; stream < GEOMETRY_STREAM_COUNT; ++stream)
+            {
+                buffers[stream].resize(pool.GetStreamCapacity(static_cast<GeometryStream>(stream)));
+            }
+        }
+    };
+
+    struct ByteRange
+    {
+        GeometryStream stream;
+        uint64_t offset;
+        uint64_t size;
+
+        bool Overlaps(const ByteRange& other) const
+        {
+            return stream == other.stream && offset < other.offset + other.size && other.offset < offset + size;
+        }
+    };
+
+    // Uploads and copies must touch disjoint ranges, no copy may read a range written in the same frame
+    void ReplayPendingWork(GeometryPool& pool, GPUStreams& gpu)
+    {
+        std::vector<ByteRange> writes;
+        std::vector<ByteRange> reads;
+        for (const GeometryPool::Upload& upload : pool.GetPendingUploads())
+        {
+            if (upload.size > 0)
+            {
+                writes.push_back({ upload.stream, upload.destinationOffset, upload.size });
+            }
+        }
+        for (const GeometryPool::Copy& copy : pool.GetPendingCopies())
+        {
+            if (copy.size > 0)
+            {
+                writes.push_back({ copy.stream, copy.destinationOffset, copy.size });
+                reads.push_back({ copy.stream, copy.sourceOffset, copy.size });
+            }
+        }
+
+        for (size_t i = 0; i < writes.size(); ++i)
+        {
+            CHECK(writes[i].offset + writes[i].size <= gpu.buffers[static_cast<size_t>(writes[i].stream)].size());
+            for (size_t j = i + 1; j < writes.size(); ++j)
+            {
+                CHECK(!writes[i].Overlaps(writes[j]));
+            }
+            for (const ByteRange& read : reads)
+            {
+                CHECK(!writes[i].Overlaps(read));
+            }
+        }
+
+        for (const GeometryPool::Copy& copy : pool.GetPendingCopies())
+        {
+            std::vector<uint8_t>& buffer = gpu.buffers[static_cast<size_t>(copy.stream)];
+            std::memmove(buffer.data() + copy.destinationOffset, buffer.data() + copy.sourceOffset, copy.size);
+        }
+        for (const GeometryPool::Upload& upload : pool.GetPendingUploads())
+        {
+            std::vector<uint8_t>& buffer = gpu.buffers[static_cast<size_t>(upload.stream)];
+            std::memcpy(buffer.data() + upload.destinationOffset, pool.GetUploadData().data() + upload.dataOffset, upload.size);
+        }
+
+        pool.ClearPendingWork();
+    }
+
+    // What the GPU reads through the descriptors and LOD ranges is the data every live mesh was added with
+    void CheckResidentMeshes(const GeometryPool& pool, const GPUStreams& gpu, const std::map<uint32_t, MeshData>& meshes)
+    {
+        CHECK(pool.GetMeshCount() == meshes.size());
+        for (const auto& [meshHandle, mesh] : meshes)
+        {
+            REQUIRE(pool.IsMeshValid(meshHandle));
+            const ShaderInterop::GeometryDescriptor& descriptor = pool.GetDescriptor(meshHandle);
+            CHECK(descriptor.vertexCount == mesh.vertices.size() && descriptor.lodCount == mesh.GetLODCount());
+
+            // Quantized vertices arrive as they are, the others packed in the mesh bounds
+            std::vector<ShaderInterop::QuantizedVertex> expected = mesh.quantizedVertices;
+            ShaderInterop::BoundsQuantization quantization = mesh.quantization;
+            if (expected.empty())
+            {
+                quantization = MakeBoundsQuantization(mesh.bounds);
+                expected.resize(mesh.vertices.size());
+                PackVertices(mesh.vertices.data(), mesh.vertices.size(), quantization, expected.data());
+            }
+            CHECK(std::memcmp(&pool.GetVertexQuantization(meshHandle), &quantization, sizeof(quantization)) == 0);
+            const uint8_t* vertices = gpu.buffers[static_cast<size_t>(GeometryStream::Vertices)].data();
+            CHECK(std::memcmp(vertices + uint64_t(descriptor.baseVertex) * sizeof(ShaderInterop::QuantizedVertex), expected.data(),
+                expected.size() * sizeof(ShaderInterop::QuantizedVertex)) == 0);
+
+            CHECK(pool.GetLODRange(meshHandle, 0).firstIndex == descriptor.firstIndex);
+            CHECK(pool.GetLODRange(meshHandle, 0).indexCount == descriptor.indexCount);
+            const std::vector<uint8_t>& indexBuffer = gpu.buffers[static_cast<size_t>(GetIndexStream(mesh.indexFormat))];
+            for (uint32_t lod = 0; lod < mesh.GetLODCount(); ++lod)
+            {
+                const std::vector<uint32_t>& indices = mesh.GetLODIndices(lod);
+                GeometryPool::IndexRange range = pool.GetLODRange(meshHandle, lod);
+                REQUIRE(range.indexCount == indices.size());
+
+                std::vector<uint8_t> expected(indices.size() * GetIndexSize(mesh.indexFormat));
+                WriteIndices(indices.data(), indices.size(), mesh.indexFormat, expected.data());
+                CHECK(std::memcmp(indexBuffer.data() + uint64_t(range.firstIndex) * GetIndexSize(mesh.indexFormat), expected.data(),
+                    expected.size()) == 0);
+            }
+        }
+    }
+
+    // Adds the meshes in order, so they are placed back to back from the start of every stream
+    std::vector<uint32_t> AddMeshes(GeometryPool& pool, std::map<uint32_t, MeshData>& meshes, const std::vector<MeshData>& added)
+    {
+        std::vector<uint32_t> handles;
+        for (const MeshData& mesh : added)
+        {
+            uint32_t meshHandle = pool.AddMesh(mesh);
+            CHECK(meshHandle != GeometryPool::INVALID_MESH);
+            handles.push_back(meshHandle);
+            meshes[meshHandle] = mesh;
+        }
+        return handles;
+    }
+
+    void RemoveMeshes(GeometryPool& pool, std::map<uint32_t, MeshData>& meshes, const std::vector<uint32_t>& removed)
+    {
+        for (uint32_t meshHandle : removed)
+        {
+            pool.RemoveMesh(meshHandle);
+            meshes.erase(meshHandle);
+        }
+    }
+
+    void AdvanceFrames(GeometryPool& pool, uint32_t count)
+    {
+        for (uint32_t frame = 0; frame < count; ++frame)
+        {
+            pool.AdvanceFrame();
+        }
+    }
+
+    constexpr uint32_t FRAME_LATENCY = 2;
+    constexpr uint32_t INDEX_CAPACITY = 4096;
+    constexpr uint64_t VERTEX_STRIDE = sizeof(ShaderInterop::QuantizedVertex);
+}
+
+TEST_CASE(GeometryPool, DefragmentRetargetsPendingUploads)
+{
+    // 300 | hole 150 | 150 | hole 150, the vertex stream is full before the holes are opened
+    GeometryPool pool;
+    pool.Initialize(750, INDEX_CAPACITY, INDEX_CAPACITY, FRAME_LATENCY);
+    GPUStreams gpu(pool);
+    std::map<uint32_t, MeshData> meshes;
+    std::vector<uint32_t> handles = AddMeshes(pool, meshes, { MakeMesh(300, IndexFormat::UInt16, 1), MakeMesh(150, IndexFormat::UInt16, 2),
+        MakeMesh(150, IndexFormat::UInt32, 3, false), MakeMesh(150, IndexFormat::UInt16, 4) });
+    ReplayPendingWork(pool, gpu);
+    CheckResidentMeshes(pool, gpu, meshes);
+
+    RemoveMeshes(pool, meshes, { handles[1], handles[3] });
+    ReplayPendingWork(pool, gpu);
+    AdvanceFrames(pool, FRAME_LATENCY);
+
+    // The new mesh lands in the upper hole, last freed first, and leaves the rest of it as a second free range
+    uint32_t added = AddMeshes(pool, meshes, { MakeMesh(100, IndexFormat::UInt16, 5) })[0];
+    CHECK(pool.GetDescriptor(added).baseVertex == 600);
+    CHECK(pool.GetStreamFragmentation(GeometryStream::Vertices) >= GeometryPool::DEFRAGMENT_THRESHOLD);
+    size_t uploadCount = pool.GetPendingUploads().size();
+
+    // Moving it down rewrites where its pending upload goes instead of copying data that is not there yet
+    CHECK(pool.Defragment(UINT64_MAX) == 100 * VERTEX_STRIDE);
+    CHECK(pool.GetDescriptor(added).baseVertex == 300);
+    CHECK(pool.GetPendingUploads().size() == uploadCount);
+    CHECK(pool.GetPendingCopies().empty() && pool.GetPendingCopySize() == 0);
+
+    ReplayPendingWork(pool, gpu);
+    CheckResidentMeshes(pool, gpu, meshes);
+    pool.AdvanceFrame();
+    CheckResidentMeshes(pool, gpu, meshes);
+}
+
+TEST_CASE(GeometryPool, DefragmentRetargetsPendingCopies)
+{
+    // 300 | hole 100 | 200 | hole 150 | 98, full before the holes are opened
+    GeometryPool pool;
+    pool.Initialize(848, INDEX_CAPACITY, INDEX_CAPACITY, FRAME_LATENCY);
+    GPUStreams gpu(pool);
+    std::map<uint32_t, MeshData> meshes;
+    std::vector<uint32_t> handles = AddMeshes(pool, meshes, { MakeMesh(300, IndexFormat::UInt16, 1), MakeMesh(100, IndexFormat::UInt16, 2),
+        MakeMesh(200, IndexFormat::UInt32, 3, false), MakeMesh(150, IndexFormat::UInt16, 4), MakeMesh(98, IndexFormat::UInt32, 5) });
+    uint32_t top = handles[4];
+    ReplayPendingWork(pool, gpu);
+    RemoveMeshes(pool, meshes, { handles[1], handles[3] });
+    ReplayPendingWork(pool, gpu);
+    AdvanceFrames(pool, FRAME_LATENCY);
+    CheckResidentMeshes(pool, gpu, meshes);
+
+    // Only the larger hole is sure to fit the top mesh, it moves there with a copy
+    CHECK(pool.Defragment(UINT64_MAX) == 98 * VERTEX_STRIDE);
+    CHECK(pool.GetDescriptor(top).baseVertex == 600);
+    REQUIRE(pool.GetPendingCopies().size() == 1);
+    CHECK(pool.GetPendingCopies()[0].sourceOffset == 750 * VERTEX_STRIDE);
+    CHECK(pool.GetPendingCopySize() == 98 * VERTEX_STRIDE);
+
+    // A second pass in the same frame finds the lower hole. The range of the first move was never written, so the
+    // queued copy is sent to the new place instead of chaining a second one behind it.
+    CHECK(pool.Defragment(UINT64_MAX) == 98 * VERTEX_STRIDE);
+    CHECK(pool.GetDescriptor(top).baseVertex == 300);
+    REQUIRE(pool.GetPendingCopies().size() == 1);
+    CHECK(pool.GetPendingCopies()[0].sourceOffset == 750 * VERTEX_STRIDE);
+    CHECK(pool.GetPendingCopies()[0].destinationOffset == 300 * VERTEX_STRIDE);
+    CHECK(pool.GetPendingCopySize() == 98 * VERTEX_STRIDE);
+    CHECK(pool.GetPendingUploads().empty());
+
+    // Both ranges the mesh left stay allocated while frames in flight may still read them
+    uint64_t liveSize = (300 + 200 + 98) * VERTEX_STRIDE;
+    ReplayPendingWork(pool, gpu);
+    CheckResidentMeshes(pool, gpu, meshes);
+    for (uint32_t frame = 0; frame < FRAME_LATENCY; ++frame)
+    {
+        CHECK(pool.GetStreamUsedSize(GeometryStream::Vertices) == liveSize + 2 * 98 * VERTEX_STRIDE);
+        pool.AdvanceFrame();
+    }
+    CHECK(pool.GetStreamUsedSize(GeometryStream::Vertices) == liveSize);
+    CheckResidentMeshes(pool, gpu, meshes);
+}
+
+TEST_CASE(GeometryPool, RetiredRangesWaitForFrameLatency)
+{
+    for (uint32_t frameLatency : { 1u, 3u })
+    {
+        GeometryPool pool;
+        pool.Initialize(1000, INDEX_CAPACITY, INDEX_CAPACITY, frameLatency);
+        GPUStreams gpu(pool);
+        std::map<uint32_t, MeshData> meshes;
+        uint32_t filling = AddMeshes(pool, meshes, { MakeMesh(1000, IndexFormat::UInt16, 1) })[0];
+        ReplayPendingWork(pool, gpu);
+        pool.AdvanceFrame();
+
+        // The removed mesh keeps its ranges for frameLatency AdvanceFrame calls, a replacement cannot take them sooner
+        RemoveMeshes(pool, meshes, { filling });
+        ReplayPendingWork(pool, gpu);
+        MeshData replacement = MakeMesh(1000, IndexFormat::UInt16, 2);
+        for (uint32_t frame = 0; frame < frameLatency; ++frame)
+        {
+            CHECK(pool.GetStreamUsedSize(GeometryStream::Vertices) == pool.GetStreamCapacity(GeometryStream::Vertices));
+            CHECK(pool.AddMesh(replacement) == GeometryPool::INVALID_MESH);
+            // Its index range waits as well
+            CHECK(pool.GetStreamUsedSize(GeometryStream::Indices16) == 21 * sizeof(uint16_t));
+            pool.AdvanceFrame();
+        }
+        CHECK(pool.GetStreamUsedSize(GeometryStream::Vertices) == 0 && pool.GetStreamUsedSize(GeometryStream::Indices16) == 0);
+
+        uint32_t replaced = AddMeshes(pool, meshes, { replacement })[0];
+        CHECK(replaced == filling);
+        ReplayPendingWork(pool, gpu);
+        CheckResidentMeshes(pool, gpu, meshes);
+    }
+}
@@ -0,0 +1,43 @@
+#include "TestFramework.h"
+#include "TestScene.h"
+
+#include "Culling/HiZPyramid.h"
+
+#include <random>
+
+// CPU reference cost of a 1080p pyramid and of culling the test scene against it
+BENCHMARK_CASE(HiZPyramid, BuildAndCull)
+{
+    constexpr uint32_t WIDTH = 1920;
+    constexpr uint32_t HEIGHT = 1080;
+    constexpr size_t INSTANCE_COUNT = 100000;
+
+    // Depth rising towards the top of the screen like a floor, with nearer slabs for walls
+    std::mt19937 generator(2);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<float> depth(static_cast<size_t>(WIDTH) * HEIGHT);
+    for (uint32_t y = 0; y < HEIGHT; ++y)
+    {
+        for (uint32_t x = 0; x < WIDTH; ++x)
+        {
+            float wall = (x / 240) % 2 == 0 ? 0.9f : 1.0f;
+            depth[static_cast<size_t>(y) * WIDTH + x] = std::min(wall, 0.95f + 0.05f * (1.0f - float(y) / HEIGHT));
+        }
+    }
+
+    HiZPyramid pyramid;
+    double buildMilliseconds = MeasureMilliseconds(5, [&]() { pyramid.Build(depth.data(), WIDTH, HEIGHT); });
+    ReportTiming("build, 1080p", buildMilliseconds);
+
+    std::vector<AABB> boxes = MakeRandomBoxes(INSTANCE_COUNT, 6);
+    XMMATRIX viewProjection = MakeTestViewProjection();
+    std::vector<uint32_t> visibility;
+    std::vector<uint32_t> newlyVisible;
+    double cullMilliseconds = MeasureMilliseconds(5, [&]()
+    {
+        visibility.assign(INSTANCE_COUNT, 0);
+        pyramid.CullInstances(boxes.data(), boxes.size(), viewProjection, visibility, newlyVisible);
+    });
+    ReportTiming("cull, 100k instances", cullMilliseconds);
+    std::printf("        %zu visible\n", newlyVisible.size());
+}
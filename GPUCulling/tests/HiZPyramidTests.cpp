@@ -0,0 +1,245 @@
+#include "TestFramework.h"
+
+#include "Culling/HiZPyramid.h"
+#include "Shaders/HiZShared.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace ShaderInterop;
+
+// Synthetic depth images against brute force maxima over level 0. With the identity view-projection a point maps to
+// uv = (x * 0.5 + 0.5, 0.5 - y * 0.5) and depth z, so the expected rectangles follow directly from the box.
+
+namespace
+{
+    // Odd, non power of two, single row and single column footprints
+    const uint32_t IMAGE_SIZES[][2] = { { 64, 64 }, { 37, 23 }, { 23, 37 }, { 3, 3 }, { 1, 7 }, { 5, 1 }, { 1, 1 }, { 1920, 1080 }, { 255, 129 } };
+
+    // Blocks of constant depth on a far background, like walls in front of a sky
+    std::vector<float> MakeDepthImage(uint32_t width, uint32_t height, uint32_t seed)
+    {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<float> depth(static_cast<size_t>(width) * height, 1.0f);
+        for (uint32_t block = 0; block < 40; ++block)
+        {
+            uint32_t x0 = static_cast<uint32_t>(generator()) % width;
+            uint32_t y0 = static_cast<uint32_t>(generator()) % height;
+            uint32_t x1 = std::min(width, x0 + 1 + static_cast<uint32_t>(generator()) % std::max(width / 3, 1u));
+            uint32_t y1 = std::min(height, y0 + 1 + static_cast<uint32_t>(generator()) % std::max(height / 3, 1u));
+            float value = 0.1f + 0.8f * unit(generator);
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                for (uint32_t x = x0; x < x1; ++x)
+                {
+                    float& texel = depth[static_cast<size_t>(y) * width + x];
+                    texel = std::min(texel, value);
+                }
+            }
+        }
+        // A little per texel noise so no two texels of a footprint are guaranteed equal
+        for (float& texel : depth)
+        {
+            texel = std::min(texel, texel - 0.01f * unit(generator) + 0.005f);
+        }
+        return depth;
+    }
+
+    float GetTexel(const std::vector<float>& depth, uint32_t width, uint32_t x, uint32_t y)
+    {
+        return depth[static_cast<size_t>(y) * width + x];
+    }
+
+    uint32_t ToTexel(float uv, uint32_t size)
+    {
+        return std::min(static_cast<uint32_t>(std::floor(std::clamp(uv, 0.0f, 1.0f) * static_cast<float>(size))), size - 1);
+    }
+}
+
+TEST_CASE(HiZPyramid, MipChainHalvesRoundingDown)
+{
+    CHECK(HiZPyramid::ComputeMipCount(1, 1) == 1);
+    CHECK(HiZPyramid::ComputeMipCount(2, 1) == 2);
+    CHECK(HiZPyramid::ComputeMipCount(1920, 1080) == 11);
+    CHECK(HiZPyramid::ComputeMipCount(37, 23) == 6);
+
+    std::vector<float> depth = MakeDepthImage(37, 23, 1);
+    HiZPyramid pyramid;
+    pyramid.Build(depth.data(), 37, 23);
+    REQUIRE(pyramid.GetMipCount() == 6);
+    const uint32_t expected[][2] = { { 37, 23 }, { 18, 11 }, { 9, 5 }, { 4, 2 }, { 2, 1 }, { 1, 1 } };
+    for (uint32_t mip = 0; mip < pyramid.GetMipCount(); ++mip)
+    {
+        CHECK(pyramid.GetLevel(mip).width == expected[mip][0]);
+        CHECK(pyramid.GetLevel(mip).height == expected[mip][1]);
+    }
+    CHECK(pyramid.GetLevel(0).depth == depth);
+}
+
+TEST_CASE(HiZPyramid, TexelsHoldTheMaxOfTheirFootprint)
+{
+    // GetHiZTexel maps every level 0 texel to the texel whose footprint holds it, so the brute force max over the
+    // level 0 texels mapping to a texel has to reproduce it bit for bit
+    for (const auto& size : IMAGE_SIZES)
+    {
+        uint32_t width = size[0];
+        uint32_t height = size[1];
+        std::vector<float> depth = MakeDepthImage(width, height, width * 131 + height);
+        HiZPyramid pyramid;
+        pyramid.Build(depth.data(), width, height);
+
+        for (uint32_t mip = 1; mip < pyramid.GetMipCount(); ++mip)
+        {
+            const HiZPyramid::Level& level = pyramid.GetLevel(mip);
+            std::vector<float> expected(level.depth.size(), 0.0f);
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    float& texel = expected[static_cast<size_t>(GetHiZTexel(y, mip, level.height)) * level.width + GetHiZTexel(x, mip, level.width)];
+                    texel = std::max(texel, GetTexel(depth, width, x, y));
+                }
+            }
+            CHECK(level.depth == expected);
+        }
+    }
+}
+
+TEST_CASE(HiZPyramid, TexelRangesCoverTheirLevelZeroRange)
+{
+    // Any level 0 range maps into the range between its mapped ends, on every level of odd sizes too
+    for (uint32_t size : { 1u, 2u, 3u, 7u, 37u, 64u, 129u, 1080u })
+    {
+        for (uint32_t mip = 0; mip < HiZPyramid::ComputeMipCount(size, 1); ++mip)
+        {
+            uint32_t levelSize = std::max(size >> mip, 1u);
+            for (uint32_t first = 0; first < size; first += 1 + first / 8)
+            {
+                for (uint32_t last = first; last < size; last += 1 + last / 8)
+                {
+                    uint32_t mappedFirst = GetHiZTexel(first, mip, levelSize);
+                    uint32_t mappedLast = GetHiZTexel(last, mip, levelSize);
+                    CHECK(mappedLast < levelSize);
+                    for (uint32_t t = first; t <= last; ++t)
+                    {
+                        uint32_t mapped = GetHiZTexel(t, mip, levelSize);
+                        CHECK(mapped >= mappedFirst && mapped <= mappedLast);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE(HiZPyramid, IsVisibleMatchesBruteForce)
+{
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<float> position(-1.2f, 1.2f);
+    std::uniform_real_distribution<float> extent(0.0f, 0.5f);
+    std::uniform_real_distribution<float> depthValue(0.0f, 1.0f);
+    XMMATRIX identity = XMMatrixIdentity();
+
+    for (const auto& size : IMAGE_SIZES)
+    {
+        uint32_t width = size[0];
+        uint32_t height = size[1];
+        std::vector<float> depth = MakeDepthImage(width, height, width + height * 7);
+        HiZPyramid pyramid;
+        pyramid.Build(depth.data(), width, height);
+
+        uint32_t hiddenCount = 0;
+        for (uint32_t i = 0; i < 2000; ++i)
+        {
+            AABB box;
+            box.min = XMFLOAT3(position(generator), position(generator), depthValue(generator));
+            box.max = XMFLOAT3(box.min.x + extent(generator), box.min.y + extent(generator), box.min.z + 0.05f);
+
+            bool isVisible = pyramid.IsVisible(box, identity);
+            bool isOnScreen = box.max.x >= -1.0f && box.min.x <= 1.0f && box.max.y >= -1.0f && box.min.y <= 1.0f;
+            if (!isOnScreen)
+            {
+                CHECK(!isVisible);
+                continue;
+            }
+
+            uint32_t x0 = ToTexel(box.min.x * 0.5f + 0.5f, width);
+            uint32_t x1 = ToTexel(box.max.x * 0.5f + 0.5f, width);
+            uint32_t y0 = ToTexel(0.5f - box.max.y * 0.5f, height);
+            uint32_t y1 = ToTexel(0.5f - box.min.y * 0.5f, height);
+            float farthest = 0.0f;
+            for (uint32_t y = y0; y <= y1; ++y)
+            {
+                for (uint32_t x = x0; x <= x1; ++x)
+                {
+                    farthest = std::max(farthest, GetTexel(depth, width, x, y));
+                }
+            }
+
+            // Conservative: whatever the covered level 0 texels do not hide stays visible
+            if (box.min.z <= farthest)
+            {
+                CHECK(isVisible);
+            }
+            hiddenCount += isVisible ? 0 : 1;
+        }
+
+        // The coarse levels still hide the boxes in front of a wall's depth only on the larger images
+        if (width * height >= 64 * 64)
+        {
+            CHECK(hiddenCount > 0);
+        }
+    }
+}
+
+TEST_CASE(HiZPyramid, BoxesAtTheNearPlaneStayVisible)
+{
+    std::vector<float> depth(64 * 64, 0.0f);
+    HiZPyramid pyramid;
+    pyramid.Build(depth.data(), 64, 64);
+
+    XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(90.0f), 1.0f, 0.1f, 100.0f);
+    AABB crossing;
+    crossing.min = XMFLOAT3(-1.0f, -1.0f, -1.0f);
+    crossing.max = XMFLOAT3(1.0f, 1.0f, 5.0f);
+    CHECK(pyramid.IsVisible(crossing, projection));
+
+    // Everything in front of the camera is behind a depth of zero
+    AABB inFront;
+    inFront.min = XMFLOAT3(-1.0f, -1.0f, 4.0f);
+    inFront.max = XMFLOAT3(1.0f, 1.0f, 5.0f);
+    CHECK(!pyramid.IsVisible(inFront, projection));
+}
+
+TEST_CASE(HiZPyramid, CullInstancesFlagsNewlyVisible)
+{
+    // Left half near, right half far
+    std::vector<float> depth(32 * 32);
+    for (uint32_t y = 0; y < 32; ++y)
+    {
+        for (uint32_t x = 0; x < 32; ++x)
+        {
+            depth[y * 32 + x] = x < 16 ? 0.2f : 1.0f;
+        }
+    }
+    HiZPyramid pyramid;
+    pyramid.Build(depth.data(), 32, 32);
+
+    std::vector<AABB> boxes(3);
+    boxes[0].min = XMFLOAT3(-0.9f, -0.5f, 0.5f);
+    boxes[0].max = XMFLOAT3(-0.5f, 0.5f, 0.6f);
+    boxes[1].min = XMFLOAT3(0.5f, -0.5f, 0.5f);
+    boxes[1].max = XMFLOAT3(0.9f, 0.5f, 0.6f);
+    boxes[2].min = XMFLOAT3(-0.9f, -0.5f, 0.1f);
+    boxes[2].max = XMFLOAT3(-0.5f, 0.5f, 0.15f);
+
+    // Box 0 was visible last frame and is hidden now, box 1 was hidden and is visible, box 2 stays visible
+    std::vector<uint32_t> visibility = { HIZ_VISIBLE, 0, HIZ_VISIBLE };
+    std::vector<uint32_t> newlyVisible;
+    pyramid.CullInstances(boxes.data(), boxes.size(), XMMatrixIdentity(), visibility, newlyVisible);
+    CHECK(visibility[0] == 0);
+    CHECK(visibility[1] == (HIZ_VISIBLE | HIZ_NEWLY_VISIBLE));
+    CHECK(visibility[2] == HIZ_VISIBLE);
+    CHECK(newlyVisible == std::vector<uint32_t>{ 1 });
+}
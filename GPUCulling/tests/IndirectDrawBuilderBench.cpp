@@ -0,0 +1,43 @@
+#include "TestFramework.h"
+#include "TestScene.h"
+
+#include "Culling/IndirectDrawBuilder.h"
+
+using namespace ShaderInterop;
+
+// Argument buffer generation for the instance count that made per draw submission the bottleneck. The CPU emulation
+// is a verification path, this only tracks its cost so the tests stay cheap.
+BENCHMARK_CASE(IndirectDrawBuilder, Build)
+{
+    constexpr uint32_t INSTANCE_COUNT = 100000;
+    constexpr uint32_t MESH_COUNT = 64;
+
+    AABB scene;
+    scene.min = XMFLOAT3(-TEST_SCENE_EXTENT, -TEST_SCENE_EXTENT, -TEST_SCENE_EXTENT);
+    scene.max = XMFLOAT3(TEST_SCENE_EXTENT + 10.0f, TEST_SCENE_EXTENT + 10.0f, TEST_SCENE_EXTENT + 10.0f);
+    BoundsQuantization quantization = MakeBoundsQuantization(scene);
+
+    std::vector<GeometryDescriptor> geometry(MESH_COUNT);
+    for (uint32_t m = 0; m < MESH_COUNT; ++m)
+    {
+        geometry[m].baseVertex = m * 1000;
+        geometry[m].firstIndex = m * 3000;
+        geometry[m].indexCount = 3000;
+    }
+
+    std::vector<AABB> boxes = MakeRandomBoxes(INSTANCE_COUNT, 4);
+    std::vector<DrawInstance> instances;
+    for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+    {
+        instances.push_back(IndirectDrawBuilder::MakeInstance(boxes[i], quantization, i % MESH_COUNT, 0, 3000, i));
+    }
+
+    IndirectDrawBuilder builder;
+    builder.SetInstances(quantization, instances.data(), instances.size());
+    Frustum frustum = MakeTestFrustum();
+
+    double milliseconds = MeasureMilliseconds(10, [&]() { builder.Build(frustum, geometry); });
+    ReportTiming("argument buffer, 100k instances", milliseconds);
+    std::printf("        %u draws, %.2f MB argument buffer\n", builder.GetDrawCount(),
+        IndirectDrawBuilder::GetArgumentBufferSize(INSTANCE_COUNT) / (1024.0 * 1024.0));
+}
@@ -0,0 +1,235 @@
+#include "TestFramework.h"
+#include "TestScene.h"
+
+#include "Culling/IndirectDrawBuilder.h"
+
+#include <cstddef>
+#include <cstring>
+
+using namespace ShaderInterop;
+
+namespace
+{
+    // Pool of meshes where every fifth handle is a removed mesh with a zeroed descriptor
+    std::vector<GeometryDescriptor> MakeGeometry(uint32_t meshCount)
+    {
+        std::vector<GeometryDescriptor> geometry(meshCount);
+        for (uint32_t m = 0; m < meshCount; ++m)
+        {
+            if (m % 5 == 4)
+            {
+                continue;
+            }
+            geometry[m].baseVertex = m * 1000;
+            geometry[m].vertexCount = 1000;
+            geometry[m].firstIndex = m * 3000;
+            geometry[m].indexCount = 3000;
+            geometry[m].lodCount = 1;
+        }
+        return geometry;
+    }
+
+    // Instances over the random test boxes, a few of them referencing handles past the end of the pool
+    std::vector<DrawInstance> MakeInstances(const std::vector<AABB>& boxes, const BoundsQuantization& quantization, uint32_t meshCount)
+    {
+        std::vector<DrawInstance> instances;
+        for (uint32_t i = 0; i < boxes.size(); ++i)
+        {
+            uint32_t meshHandle = (i % 97 == 0) ? meshCount + i % 3 : i % meshCount;
+            instances.push_back(IndirectDrawBuilder::MakeInstance(boxes[i], quantization, meshHandle, (i % 3) * 300, 300 + i % 7, i));
+        }
+        return instances;
+    }
+
+    BoundsQuantization MakeSceneQuantization()
+    {
+        AABB scene;
+        scene.min = XMFLOAT3(-TEST_SCENE_EXTENT, -TEST_SCENE_EXTENT, -TEST_SCENE_EXTENT);
+        scene.max = XMFLOAT3(TEST_SCENE_EXTENT + 10.0f, TEST_SCENE_EXTENT + 10.0f, TEST_SCENE_EXTENT + 10.0f);
+        return MakeBoundsQuantization(scene);
+    }
+
+    // Straight serial reading of the shader: filter the instances in order and append their arguments
+    std::vector<uint32_t> BuildReference(const std::vector<DrawInstance>& instances, const IndirectDrawConstants& constants,
+        const std::vector<GeometryDescriptor>& geometry, const std::vector<uint32_t>& visibility)
+    {
+        std::vector<uint32_t> buffer(1, 0);
+        for (uint32_t i = 0; i < instances.size(); ++i)
+        {
+            const DrawInstance& instance = instances[i];
+            if (instance.meshHandle >= geometry.size() || geometry[instance.meshHandle].indexCount == 0)
+            {
+                continue;
+            }
+            uint32_t flags = instance.visibilityIndex < visibility.size() ? visibility[instance.visibilityIndex] : HIZ_VISIBLE;
+            if (constants.visibilityMask != 0 && (flags & constants.visibilityMask) == 0)
+            {
+                continue;
+            }
+            if (!IsDrawInstanceVisible(instance, constants))
+            {
+                continue;
+            }
+
+            const GeometryDescriptor& mesh = geometry[instance.meshHandle];
+            buffer.insert(buffer.end(), { instance.indexCount, 1u, mesh.firstIndex + instance.firstIndex, mesh.baseVertex, i });
+            ++buffer[0];
+        }
+        return buffer;
+    }
+
+    bool MatchesWrittenPart(const IndirectDrawBuilder& builder, const std::vector<uint32_t>& reference)
+    {
+        const std::vector<uint32_t>& buffer = builder.GetArgumentBuffer();
+        return buffer.size() >= reference.size() && std::memcmp(buffer.data(), reference.data(), reference.size() * sizeof(uint32_t)) == 0;
+    }
+}
+
+TEST_CASE(IndirectDrawBuilder, LayoutMatchesShader)
+{
+    // Root constants of IndirectDraw.hlsl and the structured buffer strides
+    CHECK(sizeof(IndirectDrawConstants) == 40 * sizeof(uint32_t));
+    CHECK(sizeof(DrawInstance) == 32);
+    CHECK(sizeof(GeometryDescriptor) == 64);
+
+    // ExecuteIndirect reads D3D12_DRAW_INDEXED_ARGUMENTS right after the count
+    CHECK(sizeof(DrawIndexedArguments) == 20);
+    CHECK(offsetof(DrawIndexedArguments, indexCountPerInstance) == 0);
+    CHECK(offsetof(DrawIndexedArguments, instanceCount) == 4);
+    CHECK(offsetof(DrawIndexedArguments, startIndexLocation) == 8);
+    CHECK(offsetof(DrawIndexedArguments, baseVertexLocation) == 12);
+    CHECK(offsetof(DrawIndexedArguments, startInstanceLocation) == 16);
+    CHECK(INDIRECT_DRAW_ARGUMENTS_OFFSET == 4);
+    CHECK(IndirectDrawBuilder::GetArgumentBufferSize(0) == 4);
+    CHECK(IndirectDrawBuilder::GetArgumentBufferSize(1000) == 4 + 1000 * 20);
+}
+
+TEST_CASE(IndirectDrawBuilder, CompactsVisibleInstancesInOrder)
+{
+    constexpr uint32_t MESH_COUNT = 40;
+    BoundsQuantization quantization = MakeSceneQuantization();
+    std::vector<GeometryDescriptor> geometry = MakeGeometry(MESH_COUNT);
+
+    // Counts around the dispatch group size, an empty buffer and enough instances for several scan chunks
+    for (size_t count : { size_t(0), size_t(1), size_t(63), size_t(64), size_t(65), size_t(5000), size_t(70000) })
+    {
+        std::vector<AABB> boxes = MakeRandomBoxes(count, static_cast<uint32_t>(count) + 1);
+        std::vector<DrawInstance> instances = MakeInstances(boxes, quantization, MESH_COUNT);
+
+        IndirectDrawBuilder builder;
+        builder.SetInstances(quantization, instances.data(), instances.size());
+        REQUIRE(builder.GetArgumentBuffer().size() * sizeof(uint32_t) == IndirectDrawBuilder::GetArgumentBufferSize(static_cast<uint32_t>(count)));
+
+        for (float yaw : { 0.3f, 2.0f })
+        {
+            Frustum frustum = MakeTestFrustum(yaw);
+            builder.Build(frustum, geometry);
+
+            IndirectDrawConstants constants = IndirectDrawBuilder::BuildConstants(frustum, quantization, static_cast<uint32_t>(count), MESH_COUNT);
+            std::vector<uint32_t> reference = BuildReference(instances, constants, geometry, {});
+            CHECK(builder.GetDrawCount() == reference[0]);
+            CHECK(MatchesWrittenPart(builder, reference));
+
+            // The decoded bounds only grow, nothing the float bounds see is lost
+            std::vector<bool> isDrawn(count, false);
+            for (uint32_t d = 0; d < builder.GetDrawCount(); ++d)
+            {
+                isDrawn[builder.GetDrawArguments(d).startInstanceLocation] = true;
+            }
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                bool isResident = instances[i].meshHandle < MESH_COUNT && geometry[instances[i].meshHandle].indexCount != 0;
+                if (isResident && frustum.IntersectsAABB(boxes[i]))
+                {
+                    CHECK(isDrawn[i]);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE(IndirectDrawBuilder, SkipsMeshesOutsideThePool)
+{
+    BoundsQuantization quantization = MakeSceneQuantization();
+    std::vector<GeometryDescriptor> geometry = MakeGeometry(5);
+
+    // One box in front of the camera, drawn with every handle
+    AABB box;
+    box.min = XMFLOAT3(-1.0f, 10.0f, -150.0f);
+    box.max = XMFLOAT3(1.0f, 12.0f, -148.0f);
+    Frustum frustum = MakeTestFrustum(0.0f);
+    REQUIRE(frustum.IntersectsAABB(box));
+
+    std::vector<DrawInstance> instances;
+    for (uint32_t meshHandle = 0; meshHandle < 8; ++meshHandle)
+    {
+        instances.push_back(IndirectDrawBuilder::MakeInstance(box, quantization, meshHandle, 6, 30, meshHandle));
+    }
+
+    IndirectDrawBuilder builder;
+    builder.SetInstances(quantization, instances.data(), instances.size());
+    builder.Build(frustum, geometry);
+
+    // Handle 4 is removed, 5 and up are past the end of the pool
+    REQUIRE(builder.GetDrawCount() == 4);
+    for (uint32_t d = 0; d < 4; ++d)
+    {
+        DrawIndexedArguments arguments = builder.GetDrawArguments(d);
+        CHECK(arguments.startInstanceLocation == d);
+        CHECK(arguments.indexCountPerInstance == 30);
+        CHECK(arguments.instanceCount == 1);
+        CHECK(arguments.startIndexLocation == geometry[d].firstIndex + 6);
+        CHECK(arguments.baseVertexLocation == static_cast<int>(geometry[d].baseVertex));
+    }
+
+    // Fewer descriptors than handles in use hides the rest
+    geometry.resize(2);
+    builder.Build(frustum, geometry);
+    CHECK(builder.GetDrawCount() == 2);
+}
+
+TEST_CASE(IndirectDrawBuilder, OcclusionPhasesSplitTheDraws)
+{
+    constexpr uint32_t MESH_COUNT = 16;
+    constexpr size_t INSTANCE_COUNT = 20000;
+    BoundsQuantization quantization = MakeSceneQuantization();
+    std::vector<GeometryDescriptor> geometry = MakeGeometry(MESH_COUNT);
+    std::vector<AABB> boxes = MakeRandomBoxes(INSTANCE_COUNT, 17);
+    std::vector<DrawInstance> instances = MakeInstances(boxes, quantization, MESH_COUNT);
+
+    // The last slots have no flags and fall back to visible
+    std::vector<uint32_t> visibility(INSTANCE_COUNT - 100);
+    for (size_t i = 0; i < visibility.size(); ++i)
+    {
+        visibility[i] = (i % 3 == 0) ? HIZ_VISIBLE : (i % 3 == 1) ? HIZ_NEWLY_VISIBLE | HIZ_VISIBLE : 0;
+    }
+
+    IndirectDrawBuilder builder;
+    builder.SetInstances(quantization, instances.data(), instances.size());
+    Frustum frustum = MakeTestFrustum();
+
+    for (uint32_t visibilityMask : { uint32_t(0), HIZ_VISIBLE, HIZ_NEWLY_VISIBLE })
+    {
+        builder.Build(frustum, geometry, visibility, visibilityMask);
+        IndirectDrawConstants constants = IndirectDrawBuilder::BuildConstants(frustum, quantization, static_cast<uint32_t>(INSTANCE_COUNT),
+            MESH_COUNT, visibilityMask, static_cast<uint32_t>(visibility.size()));
+        std::vector<uint32_t> reference = BuildReference(instances, constants, geometry, visibility);
+        CHECK(builder.GetDrawCount() == reference[0]);
+        CHECK(MatchesWrittenPart(builder, reference));
+
+        for (uint32_t d = 0; d < builder.GetDrawCount(); ++d)
+        {
+            uint32_t instance = builder.GetDrawArguments(d).startInstanceLocation;
+            if (visibilityMask == HIZ_NEWLY_VISIBLE)
+            {
+                CHECK(instance < visibility.size() && (visibility[instance] & HIZ_NEWLY_VISIBLE) != 0);
+            }
+        }
+    }
+
+    // A mask of zero ignores the flags entirely
+    builder.Build(frustum, geometry, visibility, 0);
+    uint32_t unmaskedCount = builder.GetDrawCount();
+    builder.Build(frustum, geometry);
+    CHECK(builder.GetDrawCount() == unmaskedCount);
+}
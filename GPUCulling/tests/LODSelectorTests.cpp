@@ -0,0 +1,182 @@
+#include "TestFramework.h"
+
+#include "Culling/LODSelector.h"
+#include "IO/GeometryPool.h"
+
+#include <cmath>
+
+namespace
+{
+    // Errors of four levels, each twice the previous one
+    constexpr float LOD_ERRORS[] = { 0.0f, 1.0f, 2.0f, 4.0f };
+    constexpr uint32_t LOD_COUNT = static_cast<uint32_t>(std::size(LOD_ERRORS));
+
+    // A 90 degree view two pixels high projects one world unit to one pixel at distance one, so the projected error
+    // of a level is its error over the gap between the camera and the unit sphere
+    LODSelector MakeSelector(float gap)
+    {
+        LODSelector selector;
+        selector.SetView(XMFLOAT3(0.0f, 0.0f, -(1.0f + gap)), 90.0f, 0.01f, 2.0f);
+        return selector;
+    }
+
+    Sphere MakeUnitSphere()
+    {
+        Sphere sphere;
+        sphere.radius = 1.0f;
+        return sphere;
+    }
+
+    // Three levels with distinct index counts, so a range of the wrong level never matches
+    MeshData MakeMesh()
+    {
+        MeshData mesh;
+        mesh.indexFormat = IndexFormat::UInt16;
+        mesh.vertices.resize(3);
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            mesh.vertices[i].position = XMFLOAT3(static_cast<float>(i), 0.0f, 0.0f);
+        }
+        mesh.bounds.min = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        mesh.bounds.max = XMFLOAT3(2.0f, 0.0f, 0.0f);
+        mesh.boundingSphere.radius = 1.0f;
+        mesh.indices.assign(12, 0);
+        mesh.lods.push_back({ std::vector<uint32_t>(6, 1), 0.1f });
+        mesh.lods.push_back({ std::vector<uint32_t>(3, 2), 0.4f });
+        return mesh;
+    }
+}
+
+TEST_CASE(LODSelector, ProjectedErrorShrinksWithDistance)
+{
+    Sphere sphere = MakeUnitSphere();
+    CHECK(std::abs(MakeSelector(1.0f).ComputeProjectedError(1.0f, sphere) - 1.0f) < 1e-5f);
+    CHECK(std::abs(MakeSelector(4.0f).ComputeProjectedError(2.0f, sphere) - 0.5f) < 1e-5f);
+
+    // Inside the sphere the error is measured at the near plane
+    LODSelector selector;
+    selector.SetView(XMFLOAT3(0.0f, 0.0f, 0.0f), 90.0f, 0.01f, 2.0f);
+    CHECK(std::abs(selector.ComputeProjectedError(1.0f, sphere) - 100.0f) < 1e-2f);
+}
+
+TEST_CASE(LODSelector, HysteresisHoldsLevelAroundThreshold)
+{
+    Sphere sphere = MakeUnitSphere();
+
+    // LOD 1 reaches the one pixel threshold at a gap of 1. Coarsening waits for 0.75 pixels, a gap of 4/3, and refining
+    // for 1.25 pixels, a gap of 0.8. Anywhere in between the level a mesh arrived with is kept.
+    for (uint32_t startLOD : { 0u, 1u })
+    {
+        uint32_t lod = startLOD;
+        uint32_t switches = 0;
+        for (uint32_t step = 0; step < 400; ++step)
+        {
+            float phase = static_cast<float>(step % 100) / 50.0f;
+            float gap = 0.82f + 0.49f * (phase < 1.0f ? phase : 2.0f - phase);
+            uint32_t next = MakeSelector(gap).SelectLOD(LOD_ERRORS, LOD_COUNT, sphere, lod);
+            switches += next != lod ? 1 : 0;
+            lod = next;
+        }
+        CHECK(switches == 0);
+        CHECK(lod == startLOD);
+    }
+
+    // Past the margin in either direction the level switches
+    CHECK(MakeSelector(1.31f).SelectLOD(LOD_ERRORS, LOD_COUNT, sphere, 0) == 0);
+    CHECK(MakeSelector(1.35f).SelectLOD(LOD_ERRORS, LOD_COUNT, sphere, 0) == 1);
+    CHECK(MakeSelector(0.82f).SelectLOD(LOD_ERRORS, LOD_COUNT, sphere, 1) == 1);
+    CHECK(MakeSelector(0.78f).SelectLOD(LOD_ERRORS, LOD_COUNT, sphere, 1) == 0);
+
+    // Without hysteresis the threshold itself is the switching point
+    LODSelector selector = MakeSelector(0.99f);
+    selector.SetHysteresis(0.0f);
+    CHECK(selector.SelectLOD(LOD_ERRORS, LOD_COUNT, sphere, 1) == 0);
+    selector = MakeSelector(1.01f);
+    selector.SetHysteresis(0.0f);
+    CHECK(selector.SelectLOD(LOD_ERRORS, LOD_COUNT, sphere, 0) == 1);
+}
+
+TEST_CASE(LODSelector, SweepSwitchesEachLevelOncePerDirection)
+{
+    Sphere sphere = MakeUnitSphere();
+
+    // Out to a gap of 10 and back in small steps: the levels only coarsen on the way out and only refine on the way
+    // back, and each switch back happens closer than the switch out did
+    std::vector<float> outGaps(LOD_COUNT, 0.0f);
+    std::vector<float> inGaps(LOD_COUNT, 0.0f);
+    uint32_t lod = 0;
+    uint32_t switches = 0;
+    constexpr uint32_t STEPS = 1000;
+    for (uint32_t step = 0; step <= 2 * STEPS; ++step)
+    {
+        bool isOutward = step <= STEPS;
+        float gap = 0.5f + 9.5f * static_cast<float>(isOutward ? step : 2 * STEPS - step) / STEPS;
+        uint32_t next = MakeSelector(gap).SelectLOD(LOD_ERRORS, LOD_COUNT, sphere, lod);
+        if (next != lod)
+        {
+            CHECK(isOutward ? next == lod + 1 : next + 1 == lod);
+            (isOutward ? outGaps[next] : inGaps[lod]) = gap;
+            ++switches;
+        }
+        lod = next;
+    }
+
+    CHECK(switches == 2 * (LOD_COUNT - 1));
+    CHECK(lod == 0);
+    for (uint32_t level = 1; level < LOD_COUNT; ++level)
+    {
+        // Coarsened at 0.75 pixels, refined at 1.25
+        CHECK(std::abs(outGaps[level] - LOD_ERRORS[level] / 0.75f) < 0.01f);
+        CHECK(std::abs(inGaps[level] - LOD_ERRORS[level] / 1.25f) < 0.01f);
+    }
+}
+
+TEST_CASE(LODSelector, PooledInstancesTakeLODRanges)
+{
+    // The second mesh does not start at index 0, so absolute and relative ranges differ
+    GeometryPool pool;
+    pool.Initialize(64, 256, 0, 1);
+    uint32_t first = pool.AddMesh(MakeMesh());
+    uint32_t second = pool.AddMesh(MakeMesh());
+    REQUIRE(first != GeometryPool::INVALID_MESH && second != GeometryPool::INVALID_MESH);
+    CHECK(pool.GetLODErrors(second) == std::vector<float>({ 0.0f, 0.1f, 0.4f }));
+
+    // Two instances of the mesh, the second scaled up fourfold so its errors are four times larger
+    ShaderInterop::DrawInstance instances[2] = {};
+    Sphere spheres[2];
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        GeometryPool::IndexRange range = pool.GetLODRange(second, 0);
+        instances[i].meshHandle = second;
+        instances[i].firstIndex = range.firstIndex - pool.GetDescriptor(second).firstIndex;
+        instances[i].indexCount = range.indexCount;
+        Sphere sphere;
+        sphere.radius = pool.GetDescriptor(second).sphereRadius;
+        spheres[i] = TransformSphere(sphere, XMMatrixScaling(i == 0 ? 1.0f : 4.0f, 1.0f, 1.0f));
+    }
+    CHECK(spheres[1].radius == 4.0f);
+
+    // Both spheres are placed half a unit from the camera. The first instance takes LOD 2 at 0.4 / 0.5 = 0.8 pixels,
+    // the scaled one already LOD 1 at 4 * 0.1 / 0.5 = 0.8 pixels.
+    uint32_t lods[2] = { 0, 0 };
+    LODSelector selector;
+    selector.SetView(XMFLOAT3(0.0f, 0.0f, -1.5f), 90.0f, 0.01f, 2.0f);
+    selector.SetHysteresis(0.0f);
+    spheres[1].center = XMFLOAT3(0.0f, 0.0f, 3.0f);
+    CHECK(selector.SelectLODs(pool, spheres, instances, lods, 2) == 2);
+    CHECK(lods[0] == 2 && lods[1] == 1);
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        GeometryPool::IndexRange range = pool.GetLODRange(second, lods[i]);
+        CHECK(instances[i].firstIndex + pool.GetDescriptor(second).firstIndex == range.firstIndex);
+        CHECK(instances[i].indexCount == range.indexCount);
+        CHECK(instances[i].meshHandle == second);
+    }
+
+    // Nothing changes while the view stays, and removed meshes are left alone
+    CHECK(selector.SelectLODs(pool, spheres, instances, lods, 2) == 0);
+    pool.RemoveMesh(second);
+    selector.SetView(XMFLOAT3(0.0f, 0.0f, -100.0f), 90.0f, 0.01f, 2.0f);
+    CHECK(selector.SelectLODs(pool, spheres, instances, lods, 2) == 0);
+}
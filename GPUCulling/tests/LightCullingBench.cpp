@@ -0,0 +1,132 @@
+#include "TestFramework.h"
+
+#include "Culling/LightGrid.h"
+#include "Culling/LightZBins.h"
+
+#include <random>
+
+// Clustered grid against Z-binned tiles over the same light list. The clustered grid has to assign 10k dynamic
+// lights within the frame budget it was written for.
+
+namespace
+{
+    constexpr uint32_t LIGHT_COUNT = 10000;
+    constexpr double LIGHT_ASSIGNMENT_BUDGET_MS = 0.5;
+
+    constexpr float FOV_DEGREES = 60.0f;
+    constexpr float NEAR_PLANE = 0.1f;
+    constexpr float FAR_PLANE = 1000.0f;
+
+    struct Viewport
+    {
+        const char* name;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    constexpr Viewport VIEWPORTS[] = { { "1080p", 1920, 1080 }, { "4K", 3840, 2160 } };
+
+    // Point and spot lights scattered in front of a camera at the origin looking down +z, most of them on screen
+    void MakeLights(LightList& lights)
+    {
+        std::mt19937 generator(10);
+        std::uniform_real_distribution<float> lateral(-150.0f, 150.0f);
+        std::uniform_real_distribution<float> height(-10.0f, 40.0f);
+        std::uniform_real_distribution<float> depth(1.0f, 300.0f);
+        std::uniform_real_distribution<float> range(1.0f, 12.0f);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        lights.Reserve(LIGHT_COUNT);
+        for (uint32_t i = 0; i < LIGHT_COUNT; ++i)
+        {
+            XMFLOAT3 position(lateral(generator), height(generator), depth(generator));
+            XMFLOAT3 color(1.0f, 0.9f, 0.8f);
+            if (i % 4 == 3)
+            {
+                XMFLOAT3 direction;
+                XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(unit(generator), -1.0f, unit(generator), 0.0f)));
+                lights.AddSpotLight(position, direction, range(generator), 20.0f, 35.0f, color, 10.0f);
+            }
+            else
+            {
+                lights.AddPointLight(position, range(generator), color, 5.0f);
+            }
+        }
+    }
+
+    XMMATRIX MakeView()
+    {
+        return XMMatrixLookAtLH(XMVectorSet(0.0f, 5.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 5.0f, 1.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    }
+
+    float GetProjectionScaleY()
+    {
+        return 1.0f / std::tan(XMConvertToRadians(FOV_DEGREES) * 0.5f);
+    }
+}
+
+BENCHMARK_CASE(LightCulling, ClusteredGrid)
+{
+    LightList lights;
+    MakeLights(lights);
+
+    for (const Viewport& viewport : VIEWPORTS)
+    {
+        float scaleY = GetProjectionScaleY();
+        float scaleX = scaleY * viewport.height / viewport.width;
+
+        LightGrid grid;
+        grid.Configure(viewport.width, viewport.height, scaleX, scaleY, NEAR_PLANE, FAR_PLANE);
+        grid.SetView(MakeView());
+
+        std::vector<uint32_t> referenceIndices;
+        for (CullPath path : { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 })
+        {
+            if (path == CullPath::AVX2 && DEFAULT_CULL_PATH != CullPath::AVX2)
+            {
+                continue;
+            }
+
+            double milliseconds = MeasureMilliseconds(50, [&]() { grid.Build(lights, path); });
+
+            // Every path builds the same grid
+            if (path == CullPath::Scalar)
+            {
+                referenceIndices = grid.GetLightIndices();
+            }
+            CHECK(grid.GetLightIndices() == referenceIndices);
+
+            std::string label = std::string("grid ") + viewport.name + (path == CullPath::Scalar ? ", scalar" : path == CullPath::SSE ? ", SSE" : ", AVX2");
+            ReportTiming(label.c_str(), milliseconds, path == DEFAULT_CULL_PATH ? LIGHT_ASSIGNMENT_BUDGET_MS : 0.0);
+        }
+        std::printf("        %u clusters, %zu light indices, %.2f MB\n", grid.GetClusterCount(), grid.GetLightIndices().size(),
+            grid.GetMemoryUsage() / (1024.0 * 1024.0));
+    }
+}
+
+BENCHMARK_CASE(LightCulling, ZBinnedTiles)
+{
+    LightList lights;
+    MakeLights(lights);
+
+    for (const Viewport& viewport : VIEWPORTS)
+    {
+        float scaleY = GetProjectionScaleY();
+        float scaleX = scaleY * viewport.height / viewport.width;
+
+        LightZBins zBins;
+        zBins.Configure(viewport.width, viewport.height, scaleX, scaleY, NEAR_PLANE, FAR_PLANE);
+        zBins.SetView(MakeView());
+
+        // The bins run on the CPU in every mode, the tile masks only when the GPU does not build them
+        double binMilliseconds = MeasureMilliseconds(50, [&]() { zBins.BuildBins(lights); });
+        double maskMilliseconds = MeasureMilliseconds(50, [&]() { zBins.BuildTileMasks(); });
+
+        std::string label = std::string("Z-bins ") + viewport.name + ", bins";
+        ReportTiming(label.c_str(), binMilliseconds);
+        label = std::string("Z-bins ") + viewport.name + ", tile masks";
+        ReportTiming(label.c_str(), maskMilliseconds);
+        std::printf("        %u tiles, %zu sorted lights, %.2f MB\n", zBins.GetTileCount(), zBins.GetSortedLights().size(),
+            zBins.GetMemoryUsage() / (1024.0 * 1024.0));
+    }
+}
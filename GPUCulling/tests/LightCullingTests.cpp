@@ -0,0 +1,192 @@
+#include "TestFramework.h"
+
+#include "Culling/LightGrid.h"
+#include "Culling/LightZBins.h"
+
+#include <cmath>
+#include <random>
+
+// Both light culling modes have to be conservative: a point inside a light's cull sphere finds the light in its
+// cluster and in its Z-binned tile gather.
+
+namespace
+{
+    constexpr uint32_t VIEWPORT_WIDTH = 1280;
+    constexpr uint32_t VIEWPORT_HEIGHT = 720;
+    constexpr float NEAR_PLANE = 0.1f;
+    constexpr float FAR_PLANE = 500.0f;
+    constexpr float CAMERA_HEIGHT = 5.0f;
+
+    float GetProjectionScaleY()
+    {
+        return 1.0f / std::tan(XMConvertToRadians(60.0f) * 0.5f);
+    }
+
+    float GetProjectionScaleX()
+    {
+        return GetProjectionScaleY() * VIEWPORT_HEIGHT / VIEWPORT_WIDTH;
+    }
+
+    // Camera at (0, CAMERA_HEIGHT, 0) looking down +z, so view space is world space shifted down
+    XMMATRIX MakeView()
+    {
+        return XMMatrixLookAtLH(XMVectorSet(0.0f, CAMERA_HEIGHT, 0.0f, 1.0f), XMVectorSet(0.0f, CAMERA_HEIGHT, 1.0f, 1.0f),
+            XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    }
+
+    // Includes lights crossing the near plane and the screen edges, every third one a spot light
+    void MakeLights(LightList& lights, uint32_t lightCount)
+    {
+        std::mt19937 generator(21);
+        std::uniform_real_distribution<float> lateral(-60.0f, 60.0f);
+        std::uniform_real_distribution<float> depth(-5.0f, 150.0f);
+        std::uniform_real_distribution<float> range(0.5f, 15.0f);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        for (uint32_t i = 0; i < lightCount; ++i)
+        {
+            XMFLOAT3 position(lateral(generator), lateral(generator) * 0.5f, depth(generator));
+            XMFLOAT3 color(1.0f, 1.0f, 1.0f);
+            if (i % 3 == 2)
+            {
+                XMFLOAT3 direction;
+                XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(unit(generator), unit(generator), 1.0f, 0.0f)));
+                lights.AddSpotLight(position, direction, range(generator), 15.0f, 40.0f, color, 1.0f);
+            }
+            else
+            {
+                lights.AddPointLight(position, range(generator), color, 1.0f);
+            }
+        }
+    }
+
+    struct ScreenSample
+    {
+        float pixelX;
+        float pixelY;
+        float viewZ;
+    };
+
+    // Projects a view space point, false if it is off screen or outside the depth range
+    bool ProjectToScreen(const XMFLOAT3& viewPosition, ScreenSample& outSample)
+    {
+        if (viewPosition.z < NEAR_PLANE || viewPosition.z > FAR_PLANE)
+        {
+            return false;
+        }
+        float ndcX = viewPosition.x * GetProjectionScaleX() / viewPosition.z;
+        float ndcY = viewPosition.y * GetProjectionScaleY() / viewPosition.z;
+        outSample.pixelX = (ndcX + 1.0f) * 0.5f * VIEWPORT_WIDTH;
+        outSample.pixelY = (1.0f - ndcY) * 0.5f * VIEWPORT_HEIGHT;
+        outSample.viewZ = viewPosition.z;
+        return outSample.pixelX >= 0.0f && outSample.pixelX < VIEWPORT_WIDTH && outSample.pixelY >= 0.0f && outSample.pixelY < VIEWPORT_HEIGHT;
+    }
+
+    // Points inside every light's cull sphere, on its surface included, tagged with the light
+    std::vector<std::pair<uint32_t, ScreenSample>> MakeSamples(const LightList& lights)
+    {
+        std::mt19937 generator(22);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        std::vector<std::pair<uint32_t, ScreenSample>> samples;
+        for (uint32_t light = 0; light < lights.GetLightCount(); ++light)
+        {
+            for (uint32_t s = 0; s < 16; ++s)
+            {
+                XMVECTOR offset = XMVectorSet(unit(generator), unit(generator), unit(generator), 0.0f);
+                float length = XMVectorGetX(XMVector3Length(offset));
+                if (length == 0.0f || length > 1.0f)
+                {
+                    continue;
+                }
+                // Half of the samples sit right on the surface, the worst case for the tile tests
+                float scale = (s % 2 == 0 ? 0.999f / length : 1.0f) * lights.GetCullRadius()[light];
+                XMFLOAT3 viewPosition(lights.GetCullCenterX()[light] + XMVectorGetX(offset) * scale,
+                    lights.GetCullCenterY()[light] + XMVectorGetY(offset) * scale - CAMERA_HEIGHT,
+                    lights.GetCullCenterZ()[light] + XMVectorGetZ(offset) * scale);
+
+                ScreenSample sample;
+                if (ProjectToScreen(viewPosition, sample))
+                {
+                    samples.emplace_back(light, sample);
+                }
+            }
+        }
+        return samples;
+    }
+}
+
+TEST_CASE(LightCulling, GridClustersHoldOverlappingLights)
+{
+    LightList lights;
+    MakeLights(lights, 2000);
+    std::vector<std::pair<uint32_t, ScreenSample>> samples = MakeSamples(lights);
+    REQUIRE(samples.size() > 5000);
+
+    LightGrid grid;
+    grid.Configure(VIEWPORT_WIDTH, VIEWPORT_HEIGHT, GetProjectionScaleX(), GetProjectionScaleY(), NEAR_PLANE, FAR_PLANE);
+    grid.SetView(MakeView());
+
+    std::vector<uint32_t> referenceIndices;
+    for (CullPath path : { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 })
+    {
+        if (path == CullPath::AVX2 && DEFAULT_CULL_PATH != CullPath::AVX2)
+        {
+            continue;
+        }
+
+        grid.Build(lights, path);
+        if (path == CullPath::Scalar)
+        {
+            referenceIndices = grid.GetLightIndices();
+        }
+        CHECK(grid.GetLightIndices() == referenceIndices);
+    }
+
+    size_t missingCount = 0;
+    for (const auto& [light, sample] : samples)
+    {
+        uint32_t cluster = grid.GetClusterIndex(sample.pixelX, sample.pixelY, sample.viewZ);
+        REQUIRE(cluster != UINT32_MAX);
+        const ShaderInterop::LightGridCell& cell = grid.GetCells()[cluster];
+        const uint32_t* begin = grid.GetLightIndices().data() + cell.offset;
+        missingCount += std::binary_search(begin, begin + cell.count, light) ? 0 : 1;
+    }
+    CHECK(missingCount == 0);
+}
+
+TEST_CASE(LightCulling, ZBinGatherHoldsOverlappingLights)
+{
+    LightList lights;
+    MakeLights(lights, 2000);
+    std::vector<std::pair<uint32_t, ScreenSample>> samples = MakeSamples(lights);
+
+    LightZBins zBins;
+    zBins.Configure(VIEWPORT_WIDTH, VIEWPORT_HEIGHT, GetProjectionScaleX(), GetProjectionScaleY(), NEAR_PLANE, FAR_PLANE);
+    zBins.SetView(MakeView());
+
+    std::vector<uint32_t> referenceMasks;
+    for (CullPath path : { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 })
+    {
+        if (path == CullPath::AVX2 && DEFAULT_CULL_PATH != CullPath::AVX2)
+        {
+            continue;
+        }
+
+        zBins.Build(lights, path);
+        if (path == CullPath::Scalar)
+        {
+            referenceMasks = zBins.GetTileMasks();
+        }
+        CHECK(zBins.GetTileMasks() == referenceMasks);
+    }
+
+    size_t missingCount = 0;
+    std::vector<uint32_t> gathered;
+    for (const auto& [light, sample] : samples)
+    {
+        zBins.GatherLights(sample.pixelX, sample.pixelY, sample.viewZ, gathered);
+        missingCount += std::find(gathered.begin(), gathered.end(), light) != gathered.end() ? 0 : 1;
+    }
+    CHECK(missingCount == 0);
+}
@@ -0,0 +1,307 @@
+#include "TestFramework.h"
+#include "TestScene.h"
+
+#include "Culling/LooseOctree.h"
+
+#include <map>
+
+namespace
+{
+    constexpr uint32_t INVALID_INDEX = LooseOctree::INVALID_INDEX;
+
+    AABB MakeWorldBounds()
+    {
+        AABB world;
+        world.min = XMFLOAT3(-TEST_SCENE_EXTENT, -TEST_SCENE_EXTENT, -TEST_SCENE_EXTENT);
+        world.max = XMFLOAT3(TEST_SCENE_EXTENT + 10.0f, TEST_SCENE_EXTENT + 10.0f, TEST_SCENE_EXTENT + 10.0f);
+        return world;
+    }
+
+    AABB MakeBox(const XMFLOAT3& center, float halfSize)
+    {
+        AABB box;
+        box.min = XMFLOAT3(center.x - halfSize, center.y - halfSize, center.z - halfSize);
+        box.max = XMFLOAT3(center.x + halfSize, center.y + halfSize, center.z + halfSize);
+        return box;
+    }
+
+    bool Encloses(const AABB& outer, const AABB& inner)
+    {
+        return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+            outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+    }
+
+    AABB GetLooseBox(const LooseOctree::Node& parent, uint32_t slot)
+    {
+        AABB box;
+        box.min = XMFLOAT3(parent.minX[slot], parent.minY[slot], parent.minZ[slot]);
+        box.max = XMFLOAT3(parent.maxX[slot], parent.maxY[slot], parent.maxZ[slot]);
+        return box;
+    }
+
+    uint32_t GetSlot(const LooseOctree::Node& node)
+    {
+        return (node.cellX & 1) | ((node.cellY & 1) << 1) | ((node.cellZ & 1) << 2);
+    }
+
+    // Walks the tree from the root and checks it against the live objects the test keeps by handle
+    void CheckTree(const LooseOctree& octree, const std::map<uint32_t, AABB>& live)
+    {
+        const std::vector<LooseOctree::Node>& nodes = octree.GetNodes();
+        const std::vector<LooseOctree::Object>& objects = octree.GetObjects();
+        REQUIRE(octree.GetObjectCount() == live.size());
+
+        size_t reachableNodes = 0;
+        size_t linkedObjects = 0;
+        std::vector<uint32_t> stack = { 0 };
+        while (!stack.empty())
+        {
+            uint32_t nodeIndex = stack.back();
+            stack.pop_back();
+            const LooseOctree::Node& node = nodes[nodeIndex];
+            ++reachableNodes;
+
+            // Empty leaves are pruned, only the root may be left without anything
+            CHECK(nodeIndex == 0 || node.objectCount > 0 || node.childMask != 0);
+
+            uint32_t listed = 0;
+            uint32_t previous = INVALID_INDEX;
+            for (uint32_t handle = node.firstObject; handle != INVALID_INDEX; handle = objects[handle].next)
+            {
+                REQUIRE(live.count(handle) == 1);
+                CHECK(objects[handle].node == nodeIndex);
+                CHECK(objects[handle].previous == previous);
+                previous = handle;
+                ++listed;
+            }
+            CHECK(listed == node.objectCount);
+            linkedObjects += listed;
+
+            for (uint32_t slot = 0; slot < LooseOctree::NODE_WIDTH; ++slot)
+            {
+                bool hasChild = (node.childMask & (1u << slot)) != 0;
+                CHECK(hasChild == (node.child[slot] != INVALID_INDEX));
+                if (hasChild)
+                {
+                    const LooseOctree::Node& child = nodes[node.child[slot]];
+                    CHECK(child.parent == nodeIndex && child.depth == node.depth + 1 && GetSlot(child) == slot);
+                    CHECK(child.halfSize == node.halfSize * 0.5f);
+                    stack.push_back(node.child[slot]);
+                }
+            }
+        }
+        CHECK(reachableNodes == octree.GetNodeCount());
+        CHECK(linkedObjects == live.size());
+
+        // Every object lies in the loose box of its cell and of every ancestor, and its cell is not too small for it
+        for (const auto& [handle, bounds] : live)
+        {
+            CHECK(Encloses(octree.GetObjectBounds(handle), bounds) && Encloses(bounds, octree.GetObjectBounds(handle)));
+            uint32_t nodeIndex = objects[handle].node;
+            if (nodeIndex != 0)
+            {
+                XMFLOAT3 extents = bounds.GetExtents();
+                CHECK(std::max(std::max(extents.x, extents.y), extents.z) <= nodes[nodeIndex].halfSize);
+            }
+            while (nodeIndex != 0)
+            {
+                const LooseOctree::Node& node = nodes[nodeIndex];
+                CHECK(Encloses(GetLooseBox(nodes[node.parent], GetSlot(node)), bounds));
+                nodeIndex = node.parent;
+            }
+        }
+    }
+
+    void CheckCullMatchesBruteForce(const LooseOctree& octree, const std::map<uint32_t, AABB>& live)
+    {
+        for (float yaw : { 0.0f, 0.3f, 1.5f, 3.1f })
+        {
+            for (float farPlane : { 100.0f, 800.0f, 5000.0f })
+            {
+                Frustum frustum = MakeTestFrustum(yaw, farPlane);
+                std::vector<uint32_t> reference;
+                for (const auto& [handle, bounds] : live)
+                {
+                    if (frustum.IntersectsAABB(bounds))
+                    {
+                        reference.push_back(handle);
+                    }
+                }
+
+                for (CullPath path : { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 })
+                {
+                    if (path == CullPath::AVX2 && DEFAULT_CULL_PATH != CullPath::AVX2)
+                    {
+                        continue;
+                    }
+
+                    std::vector<uint32_t> visible;
+                    CHECK(octree.Cull(frustum, visible, path) == reference.size());
+                    std::sort(visible.begin(), visible.end());
+                    CHECK(visible == reference);
+                }
+            }
+        }
+    }
+
+    // Sizes from tiny to larger than the world, a few centers outside of it
+    AABB MakeRandomObject(std::mt19937& generator)
+    {
+        std::uniform_real_distribution<float> position(-TEST_SCENE_EXTENT * 1.1f, TEST_SCENE_EXTENT * 1.1f);
+        std::uniform_real_distribution<float> exponent(-2.0f, 2.5f);
+        XMFLOAT3 center(position(generator), position(generator), position(generator));
+        float halfSize = std::generate_canonical<float, 24>(generator) < 0.01f ? 700.0f : std::pow(10.0f, exponent(generator));
+        return MakeBox(center, halfSize);
+    }
+}
+
+TEST_CASE(LooseOctree, InsertMoveRemoveAcrossCells)
+{
+    std::mt19937 generator(31);
+    LooseOctree octree;
+    octree.Initialize(MakeWorldBounds());
+
+    std::map<uint32_t, AABB> live;
+    for (uint32_t i = 0; i < 5000; ++i)
+    {
+        AABB bounds = MakeRandomObject(generator);
+        uint32_t handle = octree.Insert(bounds);
+        CHECK(live.count(handle) == 0);
+        live[handle] = bounds;
+    }
+    CheckTree(octree, live);
+    CheckCullMatchesBruteForce(octree, live);
+
+    // Jitter inside the cell, hops across cell boundaries, size changes that pick another depth and moves out of the
+    // world and back
+    std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+    std::uniform_real_distribution<float> hop(-60.0f, 60.0f);
+    for (uint32_t round = 0; round < 4; ++round)
+    {
+        for (auto& [handle, bounds] : live)
+        {
+            XMFLOAT3 center = bounds.GetCenter();
+            float halfSize = bounds.GetExtents().x;
+            switch ((handle + round) % 4)
+            {
+            case 0:
+                center = XMFLOAT3(center.x + jitter(generator), center.y + jitter(generator), center.z + jitter(generator));
+                break;
+            case 1:
+                center = XMFLOAT3(center.x + hop(generator), center.y + hop(generator), center.z + hop(generator));
+                break;
+            case 2:
+                halfSize = round % 2 == 0 ? halfSize * 9.0f : halfSize / 9.0f;
+                break;
+            default:
+                center.x = round % 2 == 0 ? center.x + 2.0f * TEST_SCENE_EXTENT : center.x - 2.0f * TEST_SCENE_EXTENT;
+                break;
+            }
+            bounds = MakeBox(center, halfSize);
+            octree.Move(handle, bounds);
+        }
+        CheckTree(octree, live);
+        CheckCullMatchesBruteForce(octree, live);
+    }
+
+    // Removing every other object and then the rest prunes the tree down to the root
+    for (auto it = live.begin(); it != live.end();)
+    {
+        if (it->first % 2 == 0)
+        {
+            octree.Remove(it->first);
+            it = live.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    CheckTree(octree, live);
+    CheckCullMatchesBruteForce(octree, live);
+
+    for (const auto& [handle, bounds] : live)
+    {
+        octree.Remove(handle);
+    }
+    live.clear();
+    CheckTree(octree, live);
+    CHECK(octree.GetNodeCount() == 1);
+    CHECK(octree.GetNodes()[0].childMask == 0);
+}
+
+TEST_CASE(LooseOctree, FreeListsReuseSlots)
+{
+    std::mt19937 generator(32);
+    LooseOctree octree;
+    octree.Initialize(MakeWorldBounds());
+
+    std::map<uint32_t, AABB> live;
+    for (uint32_t i = 0; i < 2000; ++i)
+    {
+        AABB bounds = MakeRandomObject(generator);
+        live[octree.Insert(bounds)] = bounds;
+    }
+    size_t objectPoolSize = octree.GetObjects().size();
+    size_t nodePoolSize = octree.GetNodes().size();
+
+    // Freed handles come back last freed first, the object pool does not grow
+    std::vector<uint32_t> removed = { 17, 1999, 0, 512, 1000 };
+    for (uint32_t handle : removed)
+    {
+        octree.Remove(handle);
+        live.erase(handle);
+    }
+    for (auto it = removed.rbegin(); it != removed.rend(); ++it)
+    {
+        AABB bounds = MakeRandomObject(generator);
+        CHECK(octree.Insert(bounds) == *it);
+        live[*it] = bounds;
+    }
+    CHECK(octree.GetObjects().size() == objectPoolSize);
+    CheckTree(octree, live);
+
+    // Emptying the tree and filling it again with the same boxes reuses every node
+    std::vector<AABB> boxes;
+    for (const auto& [handle, bounds] : live)
+    {
+        boxes.push_back(bounds);
+        octree.Remove(handle);
+    }
+    live.clear();
+    CHECK(octree.GetNodeCount() == 1);
+    CHECK(octree.GetNodes().size() == nodePoolSize);
+
+    for (const AABB& bounds : boxes)
+    {
+        uint32_t handle = octree.Insert(bounds);
+        CHECK(handle < objectPoolSize);
+        live[handle] = bounds;
+    }
+    CHECK(octree.GetNodes().size() == nodePoolSize);
+    CHECK(octree.GetObjects().size() == objectPoolSize);
+    CheckTree(octree, live);
+    CheckCullMatchesBruteForce(octree, live);
+
+    // Clear drops the pools
+    octree.Clear();
+    CHECK(octree.GetObjectCount() == 0 && octree.GetNodeCount() == 1 && octree.GetObjects().empty());
+}
+
+TEST_CASE(LooseOctree, CullMatchesBruteForce)
+{
+    // The shared test scene at every depth limit, including a flat list in the root
+    std::vector<AABB> boxes = MakeRandomBoxes(30000, 33);
+    for (uint32_t maxDepth : { 0u, 3u, LooseOctree::DEFAULT_MAX_DEPTH, LooseOctree::MAX_DEPTH })
+    {
+        LooseOctree octree;
+        octree.Initialize(MakeWorldBounds(), maxDepth);
+        std::map<uint32_t, AABB> live;
+        for (const AABB& box : boxes)
+        {
+            live[octree.Insert(box)] = box;
+        }
+        CheckTree(octree, live);
+        CheckCullMatchesBruteForce(octree, live);
+    }
+}
@@ -0,0 +1,241 @@
+#include "TestFramework.h"
+
+#include "Culling/MaskedOcclusionRasterizer.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+// Depth buffers are compared against the 16-bit PGM reference images in tests/data. Both paths have to reproduce
+// them byte for byte. The rasterizer only ever sees normalized device positions under an identity transform there,
+// the projection is done here with plain float math so the images do not depend on how the local DirectXMath builds
+// and applies its matrices. Set GPUCULLING_UPDATE_REFERENCE_IMAGES=1 to rewrite them from the scalar path after an
+// intended change to the rasterizer.
+
+namespace
+{
+    struct OccluderMesh
+    {
+        std::vector<XMFLOAT3> positions;
+        std::vector<uint32_t> indices;
+
+        void AddQuad(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, const XMFLOAT3& d)
+        {
+            uint32_t base = static_cast<uint32_t>(positions.size());
+            positions.insert(positions.end(), { a, b, c, d });
+            indices.insert(indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+        }
+    };
+
+    // Eye at (0.5, 1.7, -2) looking at (0, 1.2, 10), 75 degree vertical FOV, aspect 2, near 0.1 and far 100, written
+    // out so every platform starts from the same bits
+    const XMFLOAT4X4 INTERIOR_VIEW_PROJECTION(
+        0.651047766f, -0.00225666817f, -0.0416361541f, -0.0415945165f,
+        0.0f, 1.30209756f, -0.0416361541f, -0.0415945165f,
+        0.0271269903f, 0.0541600361f, 0.999267697f, 0.998268425f,
+        -0.271269888f, -2.10411739f, 1.99003506f, 2.08804488f);
+
+    XMMATRIX MakeInteriorViewProjection()
+    {
+        return XMLoadFloat4x4(&INTERIOR_VIEW_PROJECTION);
+    }
+
+    // A corridor of floor, side walls and staggered partitions, a few hundred triangles like a real occluder set
+    OccluderMesh MakeInteriorOccluders()
+    {
+        OccluderMesh mesh;
+        for (int segment = 0; segment < 24; ++segment)
+        {
+            float z0 = segment * 2.0f;
+            float z1 = z0 + 2.0f;
+            mesh.AddQuad(XMFLOAT3(-4.0f, 0.0f, z0), XMFLOAT3(-4.0f, 0.0f, z1), XMFLOAT3(4.0f, 0.0f, z1), XMFLOAT3(4.0f, 0.0f, z0));
+            mesh.AddQuad(XMFLOAT3(-4.0f, 0.0f, z0), XMFLOAT3(-4.0f, 3.0f, z0), XMFLOAT3(-4.0f, 3.0f, z1), XMFLOAT3(-4.0f, 0.0f, z1));
+            mesh.AddQuad(XMFLOAT3(4.0f, 0.0f, z1), XMFLOAT3(4.0f, 3.0f, z1), XMFLOAT3(4.0f, 3.0f, z0), XMFLOAT3(4.0f, 0.0f, z0));
+
+            // Partitions alternate sides and leave a gap to look through
+            float side = (segment % 2 == 0) ? -1.0f : 1.0f;
+            float inner = side * (0.6f + 0.05f * segment);
+            mesh.AddQuad(XMFLOAT3(side * 4.0f, 0.0f, z0 + 1.0f), XMFLOAT3(side * 4.0f, 3.0f, z0 + 1.0f),
+                XMFLOAT3(inner, 3.0f, z0 + 1.0f), XMFLOAT3(inner, 0.0f, z0 + 1.0f));
+        }
+        return mesh;
+    }
+
+    // Random screen space triangles with an identity transform, every fourth one has a horizontal edge
+    OccluderMesh MakeRandomOccluders(uint32_t seed, uint32_t triangleCount)
+    {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<float> position(-1.3f, 1.3f);
+        std::uniform_real_distribution<float> depth(0.05f, 0.95f);
+
+        OccluderMesh mesh;
+        for (uint32_t t = 0; t < triangleCount; ++t)
+        {
+            for (uint32_t v = 0; v < 3; ++v)
+            {
+                float y = (v == 1 && t % 4 == 0) ? mesh.positions.back().y : position(generator);
+                mesh.positions.push_back(XMFLOAT3(position(generator), y, depth(generator)));
+                mesh.indices.push_back(static_cast<uint32_t>(mesh.indices.size()));
+            }
+        }
+        return mesh;
+    }
+
+    // Row vector times matrix and the divide by w, one rounding per operation in a fixed order
+    OccluderMesh ProjectToNormalizedDevice(const OccluderMesh& mesh, const XMFLOAT4X4& modelToClip)
+    {
+        const auto& m = modelToClip.m;
+        OccluderMesh projected;
+        projected.indices = mesh.indices;
+        for (const XMFLOAT3& p : mesh.positions)
+        {
+            float x = p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0];
+            float y = p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1];
+            float z = p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2];
+            float w = p.x * m[0][3] + p.y * m[1][3] + p.z * m[2][3] + m[3][3];
+            // Near clipped triangles would be dropped on the clip space positions, the divide cannot express that
+            CHECK(w > 0.1f);
+            float invW = 1.0f / w;
+            projected.positions.push_back(XMFLOAT3(x * invW, y * invW, z * invW));
+        }
+        return projected;
+    }
+
+    std::vector<char> ReadFileBytes(const std::string& filePath)
+    {
+        std::ifstream file(filePath, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void CheckAgainstReferenceImage(const OccluderMesh& mesh, const char* imageName)
+    {
+        XMMATRIX modelToClip = XMMatrixIdentity();
+        std::string referencePath = std::string(GPUCULLING_TEST_DATA_DIR) + "/" + imageName;
+        const char* update = std::getenv("GPUCULLING_UPDATE_REFERENCE_IMAGES");
+        if (update && std::strcmp(update, "1") == 0)
+        {
+            MaskedOcclusionRasterizer rasterizer;
+            rasterizer.Initialize();
+            rasterizer.RenderTriangles(mesh.positions.data(), sizeof(XMFLOAT3), mesh.indices.data(), mesh.indices.size() / 3, modelToClip,
+                CullPath::Scalar);
+            CHECK(rasterizer.WriteDepthImage(referencePath));
+            return;
+        }
+
+        std::vector<char> reference = ReadFileBytes(referencePath);
+        REQUIRE(!reference.empty());
+
+        for (CullPath path : { CullPath::Scalar, CullPath::AVX2 })
+        {
+            if (!MaskedOcclusionRasterizer::IsCullPathSupported(path))
+            {
+                continue;
+            }
+
+            MaskedOcclusionRasterizer rasterizer;
+            REQUIRE(rasterizer.Initialize());
+            rasterizer.RenderTriangles(mesh.positions.data(), sizeof(XMFLOAT3), mesh.indices.data(), mesh.indices.size() / 3, modelToClip, path);
+
+            // Mismatches are left next to the test binary for diffing
+            std::string actualPath = std::string(path == CullPath::Scalar ? "scalar_" : "avx2_") + imageName;
+            REQUIRE(rasterizer.WriteDepthImage(actualPath));
+            bool isMatch = ReadFileBytes(actualPath) == reference;
+            CHECK(isMatch);
+            if (isMatch)
+            {
+                std::remove(actualPath.c_str());
+            }
+        }
+    }
+}
+
+TEST_CASE(MaskedOcclusion, InteriorMatchesReferenceImage)
+{
+    CheckAgainstReferenceImage(ProjectToNormalizedDevice(MakeInteriorOccluders(), INTERIOR_VIEW_PROJECTION), "MaskedOcclusionInterior.pgm");
+}
+
+TEST_CASE(MaskedOcclusion, RandomTrianglesMatchReferenceImage)
+{
+    CheckAgainstReferenceImage(MakeRandomOccluders(9, 300), "MaskedOcclusionRandom.pgm");
+}
+
+TEST_CASE(MaskedOcclusion, PathsMatchWithExtremeCoordinates)
+{
+    // Huge and tiny triangles stress the edge setup, including the degenerate edges both paths must resolve alike
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<float> exponent(-40.0f, 40.0f);
+    if (!MaskedOcclusionRasterizer::IsCullPathSupported(CullPath::AVX2))
+    {
+        return;
+    }
+
+    for (uint32_t scene = 0; scene < 50; ++scene)
+    {
+        OccluderMesh mesh = MakeRandomOccluders(100 + scene, 60);
+        float scale = std::pow(10.0f, exponent(generator));
+        for (XMFLOAT3& position : mesh.positions)
+        {
+            position.x *= scale;
+            position.y *= scale;
+        }
+
+        MaskedOcclusionRasterizer scalar;
+        MaskedOcclusionRasterizer avx2;
+        scalar.Initialize();
+        avx2.Initialize();
+        XMMATRIX identity = XMMatrixIdentity();
+        scalar.RenderTriangles(mesh.positions.data(), sizeof(XMFLOAT3), mesh.indices.data(), mesh.indices.size() / 3, identity, CullPath::Scalar);
+        avx2.RenderTriangles(mesh.positions.data(), sizeof(XMFLOAT3), mesh.indices.data(), mesh.indices.size() / 3, identity, CullPath::AVX2);
+
+        std::vector<float> scalarDepth;
+        std::vector<float> avx2Depth;
+        scalar.ComputeDepthImage(scalarDepth);
+        avx2.ComputeDepthImage(avx2Depth);
+        CHECK(std::memcmp(scalarDepth.data(), avx2Depth.data(), scalarDepth.size() * sizeof(float)) == 0);
+    }
+}
+
+TEST_CASE(MaskedOcclusion, BoxQueries)
+{
+    XMMATRIX viewProjection = MakeInteriorViewProjection();
+    OccluderMesh mesh;
+    // Full width wall across the corridor at z = 6
+    mesh.AddQuad(XMFLOAT3(-20.0f, -5.0f, 6.0f), XMFLOAT3(-20.0f, 20.0f, 6.0f), XMFLOAT3(20.0f, 20.0f, 6.0f), XMFLOAT3(20.0f, -5.0f, 6.0f));
+
+    MaskedOcclusionRasterizer rasterizer;
+    REQUIRE(rasterizer.Initialize());
+    rasterizer.RenderTriangles(mesh.positions.data(), sizeof(XMFLOAT3), mesh.indices.data(), mesh.indices.size() / 3, viewProjection);
+
+    AABB behindWall;
+    behindWall.min = XMFLOAT3(-1.0f, 0.0f, 10.0f);
+    behindWall.max = XMFLOAT3(1.0f, 2.0f, 12.0f);
+    CHECK(rasterizer.TestAABB(behindWall, viewProjection) == OcclusionResult::Occluded);
+
+    AABB beforeWall;
+    beforeWall.min = XMFLOAT3(-1.0f, 0.0f, 2.0f);
+    beforeWall.max = XMFLOAT3(1.0f, 2.0f, 3.0f);
+    CHECK(rasterizer.TestAABB(beforeWall, viewProjection) == OcclusionResult::Visible);
+
+    // Crossing the wall, part of it is in front
+    AABB throughWall;
+    throughWall.min = XMFLOAT3(-1.0f, 0.0f, 5.0f);
+    throughWall.max = XMFLOAT3(1.0f, 2.0f, 8.0f);
+    CHECK(rasterizer.TestAABB(throughWall, viewProjection) == OcclusionResult::Visible);
+
+    AABB besideView;
+    besideView.min = XMFLOAT3(200.0f, 0.0f, 10.0f);
+    besideView.max = XMFLOAT3(202.0f, 2.0f, 12.0f);
+    CHECK(rasterizer.TestAABB(besideView, viewProjection) == OcclusionResult::ViewCulled);
+
+    // Boxes crossing the camera plane cannot be projected and stay visible
+    AABB aroundCamera;
+    aroundCamera.min = XMFLOAT3(-1.0f, 0.0f, -20.0f);
+    aroundCamera.max = XMFLOAT3(1.0f, 2.0f, 20.0f);
+    CHECK(rasterizer.TestAABB(aroundCamera, viewProjection) == OcclusionResult::Visible);
+
+    // Nothing occludes after a clear
+    rasterizer.ClearBuffer();
+    CHECK(rasterizer.TestAABB(behindWall, viewProjection) == OcclusionResult::Visible);
+}
@@ -0,0 +1,69 @@
+#include "TestFramework.h"
+
+#include "IO/MeshOptimizer.h"
+#include "IO/ModelData.h"
+
+#include <array>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    // 300 x 300 quads around a torus, 180k triangles, in shuffled order like an unoptimized export
+    MeshData MakeShuffledTorus()
+    {
+        constexpr uint32_t RING_COUNT = 300;
+        constexpr uint32_t SIDE_COUNT = 300;
+
+        MeshData mesh;
+        for (uint32_t ring = 0; ring < RING_COUNT; ++ring)
+        {
+            float u = XM_2PI * ring / RING_COUNT;
+            for (uint32_t side = 0; side < SIDE_COUNT; ++side)
+            {
+                float v = XM_2PI * side / SIDE_COUNT;
+                VertexData vertex = {};
+                vertex.normal = XMFLOAT3(std::cos(u) * std::cos(v), std::sin(v), std::sin(u) * std::cos(v));
+                vertex.position = XMFLOAT3(std::cos(u) * 3.0f + vertex.normal.x, vertex.normal.y, std::sin(u) * 3.0f + vertex.normal.z);
+                mesh.vertices.push_back(vertex);
+            }
+        }
+
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (uint32_t ring = 0; ring < RING_COUNT; ++ring)
+        {
+            for (uint32_t side = 0; side < SIDE_COUNT; ++side)
+            {
+                uint32_t a = ring * SIDE_COUNT + side;
+                uint32_t b = ((ring + 1) % RING_COUNT) * SIDE_COUNT + side;
+                uint32_t c = ring * SIDE_COUNT + (side + 1) % SIDE_COUNT;
+                uint32_t d = ((ring + 1) % RING_COUNT) * SIDE_COUNT + (side + 1) % SIDE_COUNT;
+                triangles.push_back({ a, c, b });
+                triangles.push_back({ c, d, b });
+            }
+        }
+        std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1));
+        for (const auto& triangle : triangles)
+        {
+            mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+        }
+        return mesh;
+    }
+}
+
+BENCHMARK_CASE(MeshOptimizer, ShuffledTorus)
+{
+    const MeshData torus = MakeShuffledTorus();
+
+    MeshOptimizer::Report report;
+    double milliseconds = MeasureMilliseconds(3, [&]()
+    {
+        MeshData mesh = torus;
+        report = MeshOptimizer::Optimize(mesh);
+    });
+
+    ReportTiming("optimize, 180k triangles", milliseconds);
+    std::printf("        ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", report.before.GetACMR(), report.after.GetACMR(), report.before.GetATVR(),
+        report.after.GetATVR());
+    CHECK(report.after.GetACMR() < 0.7f);
+}
@@ -0,0 +1,159 @@
+#include "TestFramework.h"
+
+#include "IO/MeshOptimizer.h"
+#include "IO/ModelData.h"
+
+#include <array>
+#include <random>
+
+namespace
+{
+    // A size x size vertex grid in the xz plane, its triangles shuffled so the input has no locality at all
+    MeshData MakeShuffledGrid(uint32_t size, uint32_t seed)
+    {
+        MeshData mesh;
+        for (uint32_t z = 0; z < size; ++z)
+        {
+            for (uint32_t x = 0; x < size; ++x)
+            {
+                VertexData vertex = {};
+                vertex.position = XMFLOAT3(static_cast<float>(x), 0.0f, static_cast<float>(z));
+                vertex.normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+                mesh.vertices.push_back(vertex);
+            }
+        }
+
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (uint32_t z = 0; z + 1 < size; ++z)
+        {
+            for (uint32_t x = 0; x + 1 < size; ++x)
+            {
+                uint32_t v = z * size + x;
+                triangles.push_back({ v, v + size, v + 1 });
+                triangles.push_back({ v + 1, v + size, v + size + 1 });
+            }
+        }
+        std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+        for (const auto& triangle : triangles)
+        {
+            mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+        }
+        return mesh;
+    }
+
+    // Triangles as position triples rotated to start at their smallest vertex, so the winding is part of the key
+    std::vector<std::array<float, 9>> GetSortedTriangles(const MeshData& mesh)
+    {
+        std::vector<std::array<float, 9>> triangles;
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            std::array<XMFLOAT3, 3> corners;
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                corners[c] = mesh.vertices[mesh.indices[i + c]].position;
+            }
+            auto less = [](const XMFLOAT3& a, const XMFLOAT3& b) { return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z); };
+            size_t first = std::min_element(corners.begin(), corners.end(), less) - corners.begin();
+            std::rotate(corners.begin(), corners.begin() + first, corners.end());
+
+            std::array<float, 9> key;
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                key[c * 3] = corners[c].x;
+                key[c * 3 + 1] = corners[c].y;
+                key[c * 3 + 2] = corners[c].z;
+            }
+            triangles.push_back(key);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+}
+
+TEST_CASE(MeshOptimizer, CacheSimulatorIsFIFO)
+{
+    // One triangle transforms all three vertices, drawing it again hits
+    const uint32_t repeated[] = { 0, 1, 2, 2, 1, 0 };
+    VertexCacheStatistics statistics = MeshOptimizer::AnalyzeVertexCache(repeated, 6, 3);
+    CHECK(statistics.vertexTransforms == 3);
+    CHECK(statistics.triangleCount == 2);
+    CHECK(statistics.vertexCount == 3);
+    CHECK(statistics.GetACMR() == 1.5f);
+    CHECK(statistics.GetATVR() == 1.0f);
+
+    // With three entries, 3 evicts 0 even though 0 was just hit, an LRU cache would keep it
+    const uint32_t evicting[] = { 0, 1, 2, 0, 1, 2, 3, 0, 1 };
+    statistics = MeshOptimizer::AnalyzeVertexCache(evicting, 9, 4, 3);
+    CHECK(statistics.vertexTransforms == 6);
+    CHECK(statistics.vertexCount == 4);
+    CHECK(statistics.GetATVR() == 1.5f);
+
+    CHECK(MeshOptimizer::AnalyzeVertexCache(nullptr, 0, 0).GetACMR() == 0.0f);
+}
+
+TEST_CASE(MeshOptimizer, VertexCacheOrderReachesGridLimit)
+{
+    MeshData mesh = MakeShuffledGrid(100, 1);
+    std::vector<std::array<float, 9>> triangles = GetSortedTriangles(mesh);
+    VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+
+    MeshOptimizer::OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    std::printf("    ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.GetACMR(), after.GetACMR(), before.GetATVR(), after.GetATVR());
+
+    CHECK(GetSortedTriangles(mesh) == triangles);
+    // A shuffled grid misses nearly every vertex, Tipsify gets within reach of the 0.5 limit
+    CHECK(before.GetACMR() > 2.5f);
+    CHECK(after.GetACMR() < 0.8f);
+    CHECK(after.GetATVR() < 1.6f);
+
+    // Already optimized input does not get worse
+    MeshOptimizer::OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    CHECK(MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size()).GetACMR() <= after.GetACMR() * 1.05f);
+}
+
+TEST_CASE(MeshOptimizer, OverdrawOrderKeepsCacheEfficiency)
+{
+    MeshData mesh = MakeShuffledGrid(100, 2);
+    std::vector<std::array<float, 9>> triangles = GetSortedTriangles(mesh);
+
+    MeshOptimizer::OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    float cacheACMR = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size()).GetACMR();
+
+    MeshOptimizer::OptimizeOverdraw(mesh.indices.data(), mesh.indices.size(), &mesh.vertices[0].position, mesh.vertices.size(), sizeof(VertexData));
+    float overdrawACMR = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size()).GetACMR();
+
+    CHECK(GetSortedTriangles(mesh) == triangles);
+    CHECK(overdrawACMR <= cacheACMR * MeshOptimizer::DEFAULT_OVERDRAW_THRESHOLD);
+}
+
+TEST_CASE(MeshOptimizer, FetchRemapFollowsFirstUse)
+{
+    // Vertex 1 and 4 are never referenced
+    const uint32_t indices[] = { 5, 2, 0, 0, 2, 3 };
+    std::vector<uint32_t> remap;
+    MeshOptimizer::BuildVertexFetchRemap(indices, 6, 6, remap);
+    REQUIRE(remap.size() == 6);
+    CHECK(remap[5] == 0 && remap[2] == 1 && remap[0] == 2 && remap[3] == 3);
+    CHECK((remap[1] == 4 && remap[4] == 5) || (remap[1] == 5 && remap[4] == 4));
+}
+
+TEST_CASE(MeshOptimizer, OptimizeKeepsTheSurface)
+{
+    MeshData mesh = MakeShuffledGrid(64, 3);
+    std::vector<std::array<float, 9>> triangles = GetSortedTriangles(mesh);
+
+    MeshOptimizer::Report report = MeshOptimizer::Optimize(mesh);
+    CHECK(GetSortedTriangles(mesh) == triangles);
+    CHECK(report.after.GetACMR() < report.before.GetACMR() * 0.3f);
+    CHECK(report.after.triangleCount == report.before.triangleCount);
+    CHECK(report.after.vertexCount == report.before.vertexCount);
+
+    // Vertices are stored in order of first use
+    uint32_t nextVertex = 0;
+    for (uint32_t index : mesh.indices)
+    {
+        CHECK(index <= nextVertex);
+        nextVertex = std::max(nextVertex, index + 1);
+    }
+}
@@ -0,0 +1,234 @@
+#include "TestFramework.h"
+
+#include "IO/MeshSimplifier.h"
+#include "IO/ModelData.h"
+
+#include <cmath>
+#include <map>
+
+namespace
+{
+    constexpr uint32_t GRID_SIZE = 33;
+    constexpr uint32_t SEAM_COLUMN = 16;
+
+    float GetHeight(float x, float z)
+    {
+        return 0.6f * std::sin(0.35f * x) * std::cos(0.25f * z);
+    }
+
+    // A size x size heightfield with an open border and a UV seam along one column: the cells left of it use
+    // vertices with u = 1 there, the cells right of it a second set of vertices at the same positions with u = 0
+    MeshData MakeSeamedGrid()
+    {
+        MeshData mesh;
+        for (uint32_t z = 0; z < GRID_SIZE; ++z)
+        {
+            for (uint32_t x = 0; x < GRID_SIZE; ++x)
+            {
+                VertexData vertex = {};
+                vertex.position = XMFLOAT3(static_cast<float>(x), GetHeight(static_cast<float>(x), static_cast<float>(z)), static_cast<float>(z));
+                vertex.normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+                vertex.texCoord = XMFLOAT2(x == SEAM_COLUMN ? 1.0f : static_cast<float>(x) / SEAM_COLUMN, static_cast<float>(z) / GRID_SIZE);
+                mesh.vertices.push_back(vertex);
+            }
+        }
+
+        std::vector<uint32_t> seamTwins(GRID_SIZE);
+        for (uint32_t z = 0; z < GRID_SIZE; ++z)
+        {
+            VertexData vertex = mesh.vertices[z * GRID_SIZE + SEAM_COLUMN];
+            vertex.texCoord.x = 0.0f;
+            seamTwins[z] = static_cast<uint32_t>(mesh.vertices.size());
+            mesh.vertices.push_back(vertex);
+        }
+
+        auto getVertex = [&](uint32_t x, uint32_t z, bool isRightOfSeam)
+        {
+            return x == SEAM_COLUMN && isRightOfSeam ? seamTwins[z] : z * GRID_SIZE + x;
+        };
+
+        for (uint32_t z = 0; z + 1 < GRID_SIZE; ++z)
+        {
+            for (uint32_t x = 0; x + 1 < GRID_SIZE; ++x)
+            {
+                bool isRightOfSeam = x >= SEAM_COLUMN;
+                uint32_t v00 = getVertex(x, z, isRightOfSeam);
+                uint32_t v10 = getVertex(x + 1, z, isRightOfSeam);
+                uint32_t v01 = getVertex(x, z + 1, isRightOfSeam);
+                uint32_t v11 = getVertex(x + 1, z + 1, isRightOfSeam);
+                mesh.indices.insert(mesh.indices.end(), { v00, v01, v10, v10, v01, v11 });
+            }
+        }
+        return mesh;
+    }
+
+    struct Vector
+    {
+        double x, y, z;
+
+        Vector(const XMFLOAT3& p) : x(p.x), y(p.y), z(p.z) {}
+        Vector(double x, double y, double z) : x(x), y(y), z(z) {}
+
+        Vector operator+(const Vector& v) const { return { x + v.x, y + v.y, z + v.z }; }
+        Vector operator-(const Vector& v) const { return { x - v.x, y - v.y, z - v.z }; }
+        Vector operator*(double s) const { return { x * s, y * s, z * s }; }
+        double Dot(const Vector& v) const { return x * v.x + y * v.y + z * v.z; }
+    };
+
+    // Closest point on the triangle by Voronoi region, as in Ericson's Real-Time Collision Detection
+    double GetDistanceToTriangle(const Vector& p, const Vector& a, const Vector& b, const Vector& c)
+    {
+        Vector ab = b - a, ac = c - a, ap = p - a;
+        double d1 = ab.Dot(ap), d2 = ac.Dot(ap);
+        Vector closest = a;
+        if (d1 > 0.0 || d2 > 0.0)
+        {
+            Vector bp = p - b;
+            double d3 = ab.Dot(bp), d4 = ac.Dot(bp);
+            Vector cp = p - c;
+            double d5 = ab.Dot(cp), d6 = ac.Dot(cp);
+            double va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+
+            if (d3 >= 0.0 && d4 <= d3)
+            {
+                closest = b;
+            }
+            else if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+            {
+                closest = a + ab * (d1 / (d1 - d3));
+            }
+            else if (d6 >= 0.0 && d5 <= d6)
+            {
+                closest = c;
+            }
+            else if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+            {
+                closest = a + ac * (d2 / (d2 - d6));
+            }
+            else if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+            {
+                closest = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+            }
+            else
+            {
+                double denominator = 1.0 / (va + vb + vc);
+                closest = a + ab * (vb * denominator) + ac * (vc * denominator);
+            }
+        }
+
+        Vector offset = p - closest;
+        return std::sqrt(offset.Dot(offset));
+    }
+
+    double GetDistanceToSurface(const MeshData& mesh, const std::vector<uint32_t>& indices, const Vector& p)
+    {
+        double distance = INFINITY;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            distance = std::min(distance, GetDistanceToTriangle(p, mesh.vertices[indices[i]].position,
+                mesh.vertices[indices[i + 1]].position, mesh.vertices[indices[i + 2]].position));
+        }
+        return distance;
+    }
+
+    // Both directions: from points spread over every triangle of one surface to the other surface
+    double GetHausdorffDistance(const MeshData& mesh, const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+    {
+        constexpr uint32_t SAMPLES = 4;
+        double distance = 0.0;
+        for (const auto& [from, to] : { std::make_pair(&a, &b), std::make_pair(&b, &a) })
+        {
+            for (size_t i = 0; i < from->size(); i += 3)
+            {
+                Vector p0 = mesh.vertices[(*from)[i]].position;
+                Vector p1 = mesh.vertices[(*from)[i + 1]].position;
+                Vector p2 = mesh.vertices[(*from)[i + 2]].position;
+                for (uint32_t u = 0; u <= SAMPLES; ++u)
+                {
+                    for (uint32_t v = 0; u + v <= SAMPLES; ++v)
+                    {
+                        Vector p = p0 + (p1 - p0) * (double(u) / SAMPLES) + (p2 - p0) * (double(v) / SAMPLES);
+                        distance = std::max(distance, GetDistanceToSurface(mesh, *to, p));
+                    }
+                }
+            }
+        }
+        return distance;
+    }
+
+    // Edges by position: the seam must stay closed, so only the outline of the grid may be used by one triangle
+    void CheckSeamClosed(const MeshData& mesh, const std::vector<uint32_t>& indices)
+    {
+        auto getKey = [&](uint32_t vertex)
+        {
+            const XMFLOAT3& p = mesh.vertices[vertex].position;
+            return static_cast<uint32_t>(p.z) * GRID_SIZE + static_cast<uint32_t>(p.x);
+        };
+        auto isOutline = [](uint32_t key)
+        {
+            uint32_t x = key % GRID_SIZE, z = key / GRID_SIZE;
+            return x == 0 || z == 0 || x == GRID_SIZE - 1 || z == GRID_SIZE - 1;
+        };
+
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> edgeUses;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (uint32_t e = 0; e < 3; ++e)
+            {
+                uint32_t a = getKey(indices[i + e]), b = getKey(indices[i + (e + 1) % 3]);
+                ++edgeUses[std::minmax(a, b)];
+            }
+        }
+
+        for (const auto& [edge, uses] : edgeUses)
+        {
+            CHECK(uses == 2 || (uses == 1 && isOutline(edge.first) && isOutline(edge.second)));
+        }
+    }
+}
+
+TEST_CASE(MeshSimplifier, SeamedGridReachesTargetRatio)
+{
+    MeshData mesh = MakeSeamedGrid();
+    size_t triangleCount = mesh.indices.size() / 3;
+    MeshSimplifier::GenerateLODs(mesh, MeshSimplifier::DEFAULT_LOD_RATIOS, std::size(MeshSimplifier::DEFAULT_LOD_RATIOS));
+    REQUIRE(mesh.lods.size() == std::size(MeshSimplifier::DEFAULT_LOD_RATIOS));
+
+    float previousError = 0.0f;
+    for (size_t lod = 0; lod < mesh.lods.size(); ++lod)
+    {
+        const MeshLOD& level = mesh.lods[lod];
+        size_t targetCount = static_cast<size_t>(triangleCount * MeshSimplifier::DEFAULT_LOD_RATIOS[lod]);
+        size_t levelCount = level.indices.size() / 3;
+        CHECK(levelCount <= targetCount && levelCount >= targetCount * 9 / 10);
+        CHECK(level.error >= previousError);
+        previousError = level.error;
+        CheckSeamClosed(mesh, level.indices);
+
+        // The seam slides along itself on both sides alike
+        std::vector<bool> isUsed(mesh.vertices.size(), false);
+        for (uint32_t index : level.indices)
+        {
+            isUsed[index] = true;
+        }
+        uint32_t leftSeamVertices = 0;
+        uint32_t rightSeamVertices = 0;
+        for (uint32_t z = 0; z < GRID_SIZE; ++z)
+        {
+            bool isLeftUsed = isUsed[z * GRID_SIZE + SEAM_COLUMN];
+            bool isRightUsed = isUsed[GRID_SIZE * GRID_SIZE + z];
+            CHECK(isLeftUsed == isRightUsed);
+            leftSeamVertices += isLeftUsed ? 1 : 0;
+            rightSeamVertices += isRightUsed ? 1 : 0;
+        }
+        CHECK(leftSeamVertices == rightSeamVertices);
+        if (lod + 1 == mesh.lods.size())
+        {
+            CHECK(leftSeamVertices <= GRID_SIZE / 2);
+        }
+
+        // The error bounds the distance to the full resolution surface, yet stays within a few times of it
+        double hausdorff = GetHausdorffDistance(mesh, mesh.indices, level.indices);
+        CHECK(hausdorff <= level.error && level.error <= 4.0 * hausdorff);
+    }
+}
@@ -0,0 +1,334 @@
+#include "TestFramework.h"
+
+#include "IO/MeshletBuilder.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace
+{
+    struct TestMesh
+    {
+        std::vector<XMFLOAT3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    // Closed UV sphere, every patch of it curves a little so most meshlets get a usable cone
+    TestMesh MakeSphere(uint32_t slices, uint32_t stacks, float radius)
+    {
+        TestMesh mesh;
+        for (uint32_t stack = 0; stack <= stacks; ++stack)
+        {
+            float phi = XM_PI * stack / stacks;
+            for (uint32_t slice = 0; slice <= slices; ++slice)
+            {
+                float theta = XM_2PI * slice / slices;
+                mesh.positions.push_back(XMFLOAT3(radius * std::sin(phi) * std::cos(theta), radius * std::cos(phi),
+                    radius * std::sin(phi) * std::sin(theta)));
+            }
+        }
+
+        // Triangles touching the poles are degenerate, two of their corners share a position
+        for (uint32_t stack = 0; stack < stacks; ++stack)
+        {
+            for (uint32_t slice = 0; slice < slices; ++slice)
+            {
+                uint32_t v = stack * (slices + 1) + slice;
+                mesh.indices.insert(mesh.indices.end(), { v, v + 1, v + slices + 1, v + 1, v + slices + 2, v + slices + 1 });
+            }
+        }
+        return mesh;
+    }
+
+    // Rolling hills over a grid with the triangles shuffled, plus a few triangles that repeat a vertex index
+    TestMesh MakeShuffledTerrain(uint32_t size, uint32_t seed)
+    {
+        TestMesh mesh;
+        for (uint32_t z = 0; z < size; ++z)
+        {
+            for (uint32_t x = 0; x < size; ++x)
+            {
+                float height = 3.0f * std::sin(x * 0.2f) * std::cos(z * 0.15f);
+                mesh.positions.push_back(XMFLOAT3(static_cast<float>(x), height, static_cast<float>(z)));
+            }
+        }
+
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (uint32_t z = 0; z + 1 < size; ++z)
+        {
+            for (uint32_t x = 0; x + 1 < size; ++x)
+            {
+                uint32_t v = z * size + x;
+                triangles.push_back({ v, v + size, v + 1 });
+                triangles.push_back({ v + 1, v + size, v + size + 1 });
+            }
+        }
+        for (uint32_t i = 0; i < 20; ++i)
+        {
+            triangles.push_back({ i * 7, i * 7, i * 7 + 1 });
+        }
+        std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+        for (const auto& triangle : triangles)
+        {
+            mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+        }
+        return mesh;
+    }
+
+    std::vector<std::array<uint32_t, 3>> GetSourceTriangles(const TestMesh& mesh)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            triangles.push_back({ mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2] });
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    // Source triangles rebuilt from the local indices of every meshlet, in the winding they were emitted with
+    std::vector<std::array<uint32_t, 3>> GetMeshletTriangles(const MeshletData& data)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (const Meshlet& meshlet : data.meshlets)
+        {
+            for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+            {
+                std::array<uint32_t, 3> triangle;
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    triangle[k] = data.vertices[meshlet.vertexOffset + data.triangles[meshlet.triangleOffset + t * 3 + k]];
+                }
+                triangles.push_back(triangle);
+            }
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    void CheckLayout(const MeshletData& data, const TestMesh& mesh, uint32_t maxVertices, uint32_t maxTriangles)
+    {
+        // Meshlets pack their vertex and triangle ranges back to back
+        uint32_t vertexOffset = 0;
+        uint32_t triangleOffset = 0;
+        for (const Meshlet& meshlet : data.meshlets)
+        {
+            CHECK(meshlet.vertexOffset == vertexOffset && meshlet.triangleOffset == triangleOffset);
+            CHECK(meshlet.vertexCount >= 1 && meshlet.vertexCount <= maxVertices);
+            CHECK(meshlet.triangleCount >= 1 && meshlet.triangleCount <= maxTriangles);
+            vertexOffset += meshlet.vertexCount;
+            triangleOffset += meshlet.triangleCount * 3;
+
+            // Local indices stay inside the meshlet and every local vertex is used once in its list
+            std::vector<uint32_t> vertices(data.vertices.begin() + meshlet.vertexOffset,
+                data.vertices.begin() + meshlet.vertexOffset + meshlet.vertexCount);
+            std::sort(vertices.begin(), vertices.end());
+            CHECK(std::adjacent_find(vertices.begin(), vertices.end()) == vertices.end());
+            for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i)
+            {
+                CHECK(data.triangles[meshlet.triangleOffset + i] < meshlet.vertexCount);
+            }
+
+            for (uint32_t vertex : vertices)
+            {
+                CHECK(vertex < mesh.positions.size());
+                XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&mesh.positions[vertex]), XMLoadFloat3(&meshlet.boundingSphere.center));
+                CHECK(XMVectorGetX(XMVector3Length(offset)) <= meshlet.boundingSphere.radius * (1.0f + 1e-5f));
+            }
+        }
+        CHECK(vertexOffset == data.vertices.size());
+        CHECK(triangleOffset == data.triangles.size());
+
+        // Every source triangle comes out exactly once, with its winding
+        CHECK(GetMeshletTriangles(data) == GetSourceTriangles(mesh));
+    }
+
+    float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+    }
+
+    // Returns how many viewers the cone rejected, every one of them must see only back faces
+    uint32_t CheckCones(const MeshletData& data, const TestMesh& mesh, uint32_t seed)
+    {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> distance(0.01f, 20.0f);
+
+        uint32_t rejectedViewers = 0;
+        for (const Meshlet& meshlet : data.meshlets)
+        {
+            if (meshlet.coneCutoff >= 1.0f)
+            {
+                continue;
+            }
+
+            CHECK(std::fabs(Dot(meshlet.coneAxis, meshlet.coneAxis) - 1.0f) < 1e-5f);
+            float minDot = std::sqrt(1.0f - meshlet.coneCutoff * meshlet.coneCutoff);
+
+            struct Face
+            {
+                XMFLOAT3 point;
+                XMFLOAT3 normal;
+            };
+            std::vector<Face> faces;
+            for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+            {
+                const uint8_t* triangle = &data.triangles[meshlet.triangleOffset + t * 3];
+                XMFLOAT3 p0 = mesh.positions[data.vertices[meshlet.vertexOffset + triangle[0]]];
+                XMFLOAT3 p1 = mesh.positions[data.vertices[meshlet.vertexOffset + triangle[1]]];
+                XMFLOAT3 p2 = mesh.positions[data.vertices[meshlet.vertexOffset + triangle[2]]];
+                XMVECTOR normal = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), XMLoadFloat3(&p0)),
+                    XMVectorSubtract(XMLoadFloat3(&p2), XMLoadFloat3(&p0)));
+                if (XMVectorGetX(XMVector3Length(normal)) <= 0.0f)
+                {
+                    continue;
+                }
+
+                Face face;
+                face.point = p0;
+                XMStoreFloat3(&face.normal, XMVector3Normalize(normal));
+                faces.push_back(face);
+
+                // Every normal lies inside the cone and the apex behind every triangle plane
+                CHECK(Dot(face.normal, meshlet.coneAxis) >= minDot - 1e-4f);
+                CHECK(Dot(Subtract(meshlet.coneApex, p0), face.normal) <= 1e-4f * meshlet.boundingSphere.radius);
+            }
+
+            // Viewers scattered around the back of the cone, from right at the apex to far away
+            for (uint32_t i = 0; i < 64; ++i)
+            {
+                XMVECTOR direction = XMVector3Normalize(XMVectorAdd(XMLoadFloat3(&meshlet.coneAxis),
+                    XMVectorSet(jitter(generator), jitter(generator), jitter(generator), 0.0f)));
+                XMFLOAT3 viewer;
+                XMStoreFloat3(&viewer, XMVectorSubtract(XMLoadFloat3(&meshlet.coneApex),
+                    XMVectorScale(direction, distance(generator) * meshlet.boundingSphere.radius)));
+
+                // The shader's test, see IsClusterBackfacing
+                XMFLOAT3 toApex = Subtract(meshlet.coneApex, viewer);
+                if (Dot(toApex, meshlet.coneAxis) < meshlet.coneCutoff * std::sqrt(Dot(toApex, toApex)))
+                {
+                    continue;
+                }
+
+                ++rejectedViewers;
+                for (const Face& face : faces)
+                {
+                    XMFLOAT3 toViewer = Subtract(viewer, face.point);
+                    CHECK(Dot(toViewer, face.normal) <= 1e-4f * (meshlet.boundingSphere.radius + std::sqrt(Dot(toViewer, toViewer))));
+                }
+            }
+        }
+        return rejectedViewers;
+    }
+}
+
+TEST_CASE(MeshletBuilder, MeshletsRespectTheLimits)
+{
+    TestMesh sphere = MakeSphere(48, 24, 10.0f);
+    TestMesh terrain = MakeShuffledTerrain(60, 3);
+
+    // The smallest limits, the defaults, the 8-bit maximum and a triangle bound tighter than the vertex bound
+    const uint32_t limits[][2] = { { 3, 1 }, { 4, 2 }, { MeshletBuilder::DEFAULT_MAX_VERTICES, MeshletBuilder::DEFAULT_MAX_TRIANGLES },
+        { MeshletBuilder::MAX_VERTICES_LIMIT, MeshletBuilder::MAX_TRIANGLES_LIMIT }, { 128, 32 } };
+    for (const auto& limit : limits)
+    {
+        MeshletBuilder builder(limit[0], limit[1]);
+        for (const TestMesh* mesh : { &sphere, &terrain })
+        {
+            MeshletData data;
+            builder.Build(mesh->positions.data(), mesh->positions.size(), sizeof(XMFLOAT3), mesh->indices.data(), mesh->indices.size(), data);
+            CheckLayout(data, *mesh, limit[0], limit[1]);
+        }
+    }
+}
+
+TEST_CASE(MeshletBuilder, DefaultMeshletsStayFull)
+{
+    // A connected surface fills most meshlets, only the tail of a region runs short
+    TestMesh terrain = MakeShuffledTerrain(100, 4);
+    MeshletBuilder builder;
+    MeshletData data;
+    builder.Build(terrain.positions.data(), terrain.positions.size(), sizeof(XMFLOAT3), terrain.indices.data(), terrain.indices.size(), data);
+
+    size_t triangleCount = terrain.indices.size() / 3;
+    size_t minMeshletCount = (triangleCount + MeshletBuilder::DEFAULT_MAX_TRIANGLES - 1) / MeshletBuilder::DEFAULT_MAX_TRIANGLES;
+    CHECK(data.meshlets.size() >= minMeshletCount);
+    CHECK(data.meshlets.size() <= minMeshletCount * 3 / 2);
+
+    // Triangles share vertices inside a meshlet, a grid patch needs far fewer than three per triangle
+    CHECK(data.vertices.size() < triangleCount);
+}
+
+TEST_CASE(MeshletBuilder, ReadsStridedPositions)
+{
+    struct Vertex
+    {
+        XMFLOAT3 position;
+        XMFLOAT3 normal;
+        XMFLOAT2 uv;
+    };
+
+    TestMesh sphere = MakeSphere(32, 16, 4.0f);
+    std::vector<Vertex> vertices(sphere.positions.size());
+    for (size_t v = 0; v < vertices.size(); ++v)
+    {
+        vertices[v].position = sphere.positions[v];
+        vertices[v].normal = XMFLOAT3(NAN, NAN, NAN);
+    }
+
+    MeshletBuilder builder;
+    MeshletData tight;
+    MeshletData strided;
+    builder.Build(sphere.positions.data(), sphere.positions.size(), sizeof(XMFLOAT3), sphere.indices.data(), sphere.indices.size(), tight);
+    builder.Build(&vertices[0].position, vertices.size(), sizeof(Vertex), sphere.indices.data(), sphere.indices.size(), strided);
+    CheckLayout(strided, sphere, MeshletBuilder::DEFAULT_MAX_VERTICES, MeshletBuilder::DEFAULT_MAX_TRIANGLES);
+
+    // Same positions, same meshlets
+    CHECK(tight.vertices == strided.vertices);
+    CHECK(tight.triangles == strided.triangles);
+    REQUIRE(tight.meshlets.size() == strided.meshlets.size());
+    for (size_t m = 0; m < tight.meshlets.size(); ++m)
+    {
+        CHECK(std::memcmp(&tight.meshlets[m], &strided.meshlets[m], sizeof(Meshlet)) == 0);
+    }
+}
+
+TEST_CASE(MeshletBuilder, ConesAreConservative)
+{
+    TestMesh sphere = MakeSphere(48, 24, 10.0f);
+    TestMesh terrain = MakeShuffledTerrain(60, 5);
+
+    for (const TestMesh* mesh : { &sphere, &terrain })
+    {
+        for (uint32_t maxTriangles : { 16u, MeshletBuilder::DEFAULT_MAX_TRIANGLES })
+        {
+            MeshletBuilder builder(MeshletBuilder::DEFAULT_MAX_VERTICES, maxTriangles);
+            MeshletData data;
+            builder.Build(mesh->positions.data(), mesh->positions.size(), sizeof(XMFLOAT3), mesh->indices.data(), mesh->indices.size(), data);
+
+            // Curved patches still get cones, and some viewers have to be rejected for the check to mean anything
+            size_t coneCount = std::count_if(data.meshlets.begin(), data.meshlets.end(), [](const Meshlet& meshlet) { return meshlet.coneCutoff < 1.0f; });
+            CHECK(coneCount * 2 > data.meshlets.size());
+            CHECK(CheckCones(data, *mesh, maxTriangles) > 0);
+        }
+    }
+
+    // A flat quad has a zero width cone, any viewer behind its plane rejects it
+    TestMesh quad;
+    quad.positions = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(1.0f, 0.0f, 1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f) };
+    quad.indices = { 0, 1, 2, 0, 2, 3 };
+    MeshletData data;
+    MeshletBuilder().Build(quad.positions.data(), quad.positions.size(), sizeof(XMFLOAT3), quad.indices.data(), quad.indices.size(), data);
+    REQUIRE(data.meshlets.size() == 1);
+    CHECK(data.meshlets[0].coneCutoff == 0.0f);
+    CHECK(data.meshlets[0].coneAxis.y == 1.0f);
+    CHECK(CheckCones(data, quad, 1) > 0);
+}
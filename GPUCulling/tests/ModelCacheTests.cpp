@@ -0,0 +1,147 @@
+#include "TestFramework.h"
+
+#include "IO/ModelCache.h"
+#include "IO/VertexPacking.h"
+#include "Culling/QuantizedBounds.h"
+
+#include <cmath>
+
+#include <fstream>
+
+// Cooked files are written to a scratch directory under the working directory, which CTest sets to the build tree
+
+namespace
+{
+    std::filesystem::path MakeScratchDirectory(const char* name)
+    {
+        std::filesystem::path directory = std::filesystem::path("ModelCacheTests") / name;
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        return directory;
+    }
+
+    void WriteTextFile(const std::filesystem::path& path, const char* text)
+    {
+        std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+        stream << text;
+    }
+
+    ModelData MakeTriangleModel()
+    {
+        ModelData model;
+        MeshData& mesh = model.meshes.emplace_back();
+        mesh.name = "Triangle";
+        mesh.vertices.resize(3);
+        mesh.vertices[1].position = XMFLOAT3(1.0f, 0.0f, 0.0f);
+        mesh.vertices[2].position = XMFLOAT3(0.0f, 1.0f, 0.0f);
+        mesh.indices = { 0, 1, 2 };
+        mesh.bounds.min = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        mesh.bounds.max = XMFLOAT3(1.0f, 1.0f, 0.0f);
+
+        MaterialData& material = model.materials.emplace_back();
+        material.name = "Default";
+        material.diffuseTexture = "Diffuse.png";
+
+        MeshInstance& instance = model.instances.emplace_back();
+        XMStoreFloat4x4(&instance.world, XMMatrixIdentity());
+        model.boundingBoxMin = mesh.bounds.min;
+        model.boundingBoxMax = mesh.bounds.max;
+        return model;
+    }
+}
+
+TEST_CASE(ModelCache, RoundTripsUnderItsKey)
+{
+    std::filesystem::path directory = MakeScratchDirectory("RoundTrip");
+    std::string cookedPath = (directory / "Triangle.cooked").string();
+    ModelCacheKey key = { 1, 2, 3 };
+    REQUIRE(WriteCookedModel(cookedPath, MakeTriangleModel(), key));
+
+    CookedModel cooked;
+    REQUIRE(cooked.Open(cookedPath, key));
+    REQUIRE(cooked.GetMeshCount() == 1);
+    CHECK(cooked.GetMesh(0).name == "Triangle");
+    CHECK(cooked.GetMesh(0).indices.size() == 3);
+    CHECK(cooked.GetMaterial(0).diffuseTexture == "Diffuse.png");
+    CHECK(cooked.GetInstances().size() == 1);
+    cooked.Close();
+
+    ModelCacheKey otherSettings = key;
+    otherSettings.settingsHash = 4;
+    CHECK(!cooked.Open(cookedPath, otherSettings));
+    CHECK(cooked.Open(cookedPath));
+}
+
+TEST_CASE(ModelCache, QuantizedMeshesStoreOnlyThePackedVertices)
+{
+    std::filesystem::path directory = MakeScratchDirectory("Quantized");
+    std::string cookedPath = (directory / "Triangle.cooked").string();
+    ModelData model = MakeTriangleModel();
+    MeshData& mesh = model.meshes[0];
+    mesh.quantization = MakeBoundsQuantization(mesh.bounds);
+    mesh.quantizedVertices.resize(mesh.vertices.size());
+    PackVertices(mesh.vertices.data(), mesh.vertices.size(), mesh.quantization, mesh.quantizedVertices.data());
+    ModelCacheKey key = { 1, 2, 3 };
+    REQUIRE(WriteCookedModel(cookedPath, model, key));
+
+    CookedModel cooked;
+    REQUIRE(cooked.Open(cookedPath, key));
+    CookedMesh cookedMesh = cooked.GetMesh(0);
+    CHECK(cookedMesh.vertices.empty());
+    CHECK(cookedMesh.quantizedVertices.size() == 3 && cookedMesh.GetVertexCount() == 3);
+
+    // The full precision vertices come back decoded, within the quantization step
+    std::unique_ptr<ModelData> decoded = cooked.ToModelData();
+    REQUIRE(decoded->meshes.size() == 1 && decoded->meshes[0].vertices.size() == 3);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        const XMFLOAT3& expected = mesh.vertices[i].position;
+        const XMFLOAT3& actual = decoded->meshes[0].vertices[i].position;
+        CHECK(std::abs(actual.x - expected.x) < 1e-3f && std::abs(actual.y - expected.y) < 1e-3f && std::abs(actual.z - expected.z) < 1e-3f);
+    }
+}
+
+TEST_CASE(ModelCache, ChangedDependenciesRejectTheFile)
+{
+    std::filesystem::path directory = MakeScratchDirectory("Dependencies");
+    std::filesystem::path materialPath = directory / "Triangle.mtl";
+    std::filesystem::path texturePath = directory / "Diffuse.png";
+    WriteTextFile(materialPath, "newmtl Default\nmap_Kd Diffuse.png\n");
+    WriteTextFile(texturePath, "not really a png");
+
+    std::vector<ModelDependency> dependencies(2);
+    REQUIRE(GetModelDependency(materialPath.string(), dependencies[0]));
+    REQUIRE(GetModelDependency(texturePath.string(), dependencies[1]));
+    CHECK(dependencies[0].size == 34);
+
+    ModelDependency unused;
+    CHECK(!GetModelDependency((directory / "Missing.bin").string(), unused));
+    CHECK(!GetModelDependency(directory.string(), unused));
+
+    std::string cookedPath = (directory / "Triangle.cooked").string();
+    ModelCacheKey key = { 1, 2, 3 };
+    REQUIRE(WriteCookedModel(cookedPath, MakeTriangleModel(), key, dependencies));
+
+    CookedModel cooked;
+    REQUIRE(cooked.Open(cookedPath, key));
+    cooked.Close();
+
+    // A rewritten side file with a different size
+    WriteTextFile(materialPath, "newmtl Default\nmap_Kd Other.png\n");
+    CHECK(!cooked.Open(cookedPath, key));
+    WriteTextFile(materialPath, "newmtl Default\nmap_Kd Diffuse.png\n");
+    std::filesystem::last_write_time(materialPath, std::filesystem::file_time_type(std::filesystem::file_time_type::duration(dependencies[0].writeTime)));
+    REQUIRE(cooked.Open(cookedPath, key));
+    cooked.Close();
+
+    // Same size, touched later
+    std::filesystem::last_write_time(texturePath, std::filesystem::last_write_time(texturePath) + std::chrono::seconds(5));
+    CHECK(!cooked.Open(cookedPath, key));
+
+    // Gone altogether
+    std::filesystem::remove(texturePath);
+    CHECK(!cooked.Open(cookedPath, key));
+
+    // Files that ship without their source do not check their dependencies either
+    CHECK(cooked.Open(cookedPath));
+}
@@ -0,0 +1,46 @@
+#include "TestFramework.h"
+
+#include "Culling/PrefixScan.h"
+
+#include <random>
+
+// Scan and compaction throughput from one to a hundred million elements, the range the culling stages feed it
+BENCHMARK_CASE(PrefixScan, ScanAndCompact)
+{
+    constexpr size_t MAX_COUNT = 100000000;
+
+    std::mt19937 generator(1);
+    std::vector<uint32_t> values(MAX_COUNT);
+    for (uint32_t& value : values)
+    {
+        // A third of the flags set, the sums stay within 32 bits
+        value = generator() % 3 == 0 ? 1u : 0u;
+    }
+    std::vector<uint32_t> output(MAX_COUNT);
+
+    PrefixScan scan;
+    for (size_t count : { size_t(1000000), size_t(10000000), MAX_COUNT })
+    {
+        uint32_t repetitions = count == MAX_COUNT ? 3 : 10;
+        std::printf("    %zuM elements\n", count / 1000000);
+
+        for (CullPath path : { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 })
+        {
+            if (path == CullPath::AVX2 && DEFAULT_CULL_PATH != CullPath::AVX2)
+            {
+                continue;
+            }
+
+            const char* pathName = path == CullPath::Scalar ? "scalar" : path == CullPath::SSE ? "SSE" : "AVX2";
+            double scanMilliseconds = MeasureMilliseconds(repetitions, [&]() { scan.ExclusiveScan(values.data(), count, output.data(), path); });
+            double compactMilliseconds = MeasureMilliseconds(repetitions, [&]() { scan.Compact(values.data(), count, output.data(), path); });
+
+            std::string label = std::string("exclusive scan, ") + pathName;
+            ReportTiming(label.c_str(), scanMilliseconds);
+            std::printf("        %.2f G elements/s\n", count / (scanMilliseconds * 1e6));
+            label = std::string("compact, ") + pathName;
+            ReportTiming(label.c_str(), compactMilliseconds);
+            std::printf("        %.2f G elements/s\n", count / (compactMilliseconds * 1e6));
+        }
+    }
+}
@@ -0,0 +1,140 @@
+#include "TestFramework.h"
+
+#include "Culling/PrefixScan.h"
+
+#include <random>
+
+namespace
+{
+    // Sizes around the register widths and the thread pool block size, plus inputs spanning several blocks
+    const size_t SCAN_COUNTS[] = { 0, 1, 7, 8, 9, 31, 33, 1000, PrefixScan::BLOCK_SIZE - 1, PrefixScan::BLOCK_SIZE,
+        PrefixScan::BLOCK_SIZE + 1, PrefixScan::BLOCK_SIZE * 5 + 123 };
+
+    const CullPath SCAN_PATHS[] = { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 };
+
+    bool IsPathSupported(CullPath path)
+    {
+        return path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2;
+    }
+
+    std::vector<uint32_t> MakeValues(size_t count, uint32_t seed, uint32_t maxValue)
+    {
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<uint32_t> value(0, maxValue);
+        std::vector<uint32_t> values(count);
+        for (uint32_t& v : values)
+        {
+            v = value(generator);
+        }
+        return values;
+    }
+
+    // Flags with roughly keepPercent of them set, any non zero value counts
+    std::vector<uint32_t> MakeFlags(size_t count, uint32_t seed, uint32_t keepPercent)
+    {
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<uint32_t> percent(0, 99);
+        std::vector<uint32_t> flags(count);
+        for (uint32_t& flag : flags)
+        {
+            flag = percent(generator) < keepPercent ? 1u + generator() % 7 : 0u;
+        }
+        return flags;
+    }
+}
+
+TEST_CASE(PrefixScan, ExclusiveScanMatchesSerialSum)
+{
+    PrefixScan scan;
+    for (size_t count : SCAN_COUNTS)
+    {
+        std::vector<uint32_t> values = MakeValues(count, static_cast<uint32_t>(count), 1000);
+        std::vector<uint32_t> reference(count);
+        uint32_t sum = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            reference[i] = sum;
+            sum += values[i];
+        }
+
+        for (CullPath path : SCAN_PATHS)
+        {
+            if (!IsPathSupported(path))
+            {
+                continue;
+            }
+
+            std::vector<uint32_t> sums(count, 0xcdcdcdcd);
+            CHECK(scan.ExclusiveScan(values.data(), count, sums.data(), path) == sum);
+            CHECK(sums == reference);
+
+            // In place
+            std::vector<uint32_t> inPlace = values;
+            CHECK(scan.ExclusiveScan(inPlace.data(), count, inPlace.data(), path) == sum);
+            CHECK(inPlace == reference);
+        }
+    }
+}
+
+TEST_CASE(PrefixScan, ExclusiveScanWrapsLike32BitAdds)
+{
+    PrefixScan scan;
+    size_t count = PrefixScan::BLOCK_SIZE * 3 + 17;
+    std::vector<uint32_t> values = MakeValues(count, 4, UINT32_MAX);
+    std::vector<uint32_t> reference(count);
+    uint32_t sum = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        reference[i] = sum;
+        sum += values[i];
+    }
+
+    for (CullPath path : SCAN_PATHS)
+    {
+        if (IsPathSupported(path))
+        {
+            std::vector<uint32_t> sums(count);
+            CHECK(scan.ExclusiveScan(values.data(), count, sums.data(), path) == sum);
+            CHECK(sums == reference);
+        }
+    }
+}
+
+TEST_CASE(PrefixScan, CompactKeepsSetFlagsInOrder)
+{
+    PrefixScan scan;
+    for (size_t count : SCAN_COUNTS)
+    {
+        // Empty, sparse, half and full lists
+        for (uint32_t keepPercent : { 0u, 3u, 50u, 100u })
+        {
+            std::vector<uint32_t> flags = MakeFlags(count, static_cast<uint32_t>(count) + keepPercent, keepPercent);
+            std::vector<uint32_t> reference;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (flags[i] != 0)
+                {
+                    reference.push_back(static_cast<uint32_t>(i));
+                }
+            }
+
+            for (CullPath path : SCAN_PATHS)
+            {
+                if (!IsPathSupported(path))
+                {
+                    continue;
+                }
+
+                std::vector<uint32_t> indices;
+                CHECK(scan.Compact(flags.data(), count, indices, path) == reference.size());
+                CHECK(indices == reference);
+
+                // The pointer version may only write inside the count elements it was given
+                std::vector<uint32_t> guarded(count + 16, 0xcdcdcdcd);
+                CHECK(scan.Compact(flags.data(), count, guarded.data(), path) == reference.size());
+                CHECK(std::equal(reference.begin(), reference.end(), guarded.begin()));
+                CHECK(std::all_of(guarded.begin() + count, guarded.end(), [](uint32_t v) { return v == 0xcdcdcdcd; }));
+            }
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#include "TestFramework.h"
+#include "TestScene.h"
+
+#include "Culling/FrustumCuller.h"
+#include "Culling/QuantizedFrustumCuller.h"
+
+// The same million instances culled from float and from 16-bit bounds. Both cull a stream of boxes, so the bytes per
+// box set how fast a path can go once it is memory bound.
+BENCHMARK_CASE(QuantizedBounds, BandwidthAt1MInstances)
+{
+    constexpr size_t INSTANCE_COUNT = 1000000;
+    constexpr double FLOAT_BYTES_PER_INSTANCE = 6 * sizeof(float);
+    constexpr double QUANTIZED_BYTES_PER_INSTANCE = 6 * sizeof(uint16_t);
+    std::vector<AABB> boxes = MakeRandomBoxes(INSTANCE_COUNT, 3);
+
+    AABB cell;
+    cell.min = XMFLOAT3(-TEST_SCENE_EXTENT, -TEST_SCENE_EXTENT, -TEST_SCENE_EXTENT);
+    cell.max = XMFLOAT3(TEST_SCENE_EXTENT + 10.0f, TEST_SCENE_EXTENT + 10.0f, TEST_SCENE_EXTENT + 10.0f);
+
+    FrustumCuller floatCuller;
+    QuantizedFrustumCuller quantizedCuller;
+    floatCuller.Reserve(INSTANCE_COUNT);
+    quantizedCuller.Initialize(cell);
+    quantizedCuller.Reserve(INSTANCE_COUNT);
+    for (const AABB& box : boxes)
+    {
+        floatCuller.AddInstance(box);
+        quantizedCuller.AddInstance(box);
+    }
+
+    Frustum frustum = MakeTestFrustum();
+    std::vector<uint32_t> visible(INSTANCE_COUNT + FrustumCuller::OUTPUT_PADDING);
+    std::printf("    bounds: float %.1f MB, quantized %.1f MB\n", INSTANCE_COUNT * FLOAT_BYTES_PER_INSTANCE / (1024.0 * 1024.0),
+        INSTANCE_COUNT * QUANTIZED_BYTES_PER_INSTANCE / (1024.0 * 1024.0));
+
+    for (CullPath path : { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 })
+    {
+        if (!FrustumCuller::IsCullPathSupported(path))
+        {
+            continue;
+        }
+
+        size_t floatCount = 0;
+        size_t quantizedCount = 0;
+        double floatMilliseconds = MeasureMilliseconds(10, [&]() { floatCount = floatCuller.Cull(frustum, visible.data(), path); });
+        double quantizedMilliseconds = MeasureMilliseconds(10, [&]() { quantizedCount = quantizedCuller.Cull(frustum, visible.data(), path); });
+
+        const char* pathName = path == CullPath::Scalar ? "scalar" : path == CullPath::SSE ? "SSE" : "AVX2";
+        std::string label = std::string("float bounds, ") + pathName;
+        ReportTiming(label.c_str(), floatMilliseconds);
+        std::printf("        %.2f GB/s of bounds, %zu visible\n", INSTANCE_COUNT * FLOAT_BYTES_PER_INSTANCE / (floatMilliseconds * 1e6), floatCount);
+        label = std::string("quantized bounds, ") + pathName;
+        ReportTiming(label.c_str(), quantizedMilliseconds);
+        std::printf("        %.2f GB/s of bounds, %zu visible\n", INSTANCE_COUNT * QUANTIZED_BYTES_PER_INSTANCE / (quantizedMilliseconds * 1e6),
+            quantizedCount);
+
+        // Rounding outward never loses an instance
+        CHECK(quantizedCount >= floatCount);
+    }
+}
@@ -0,0 +1,187 @@
+#include "TestFramework.h"
+#include "TestScene.h"
+
+#include "Culling/FrustumCuller.h"
+#include "Culling/QuantizedFrustumCuller.h"
+
+#include <cmath>
+
+using namespace ShaderInterop;
+
+namespace
+{
+    bool Encloses(const AABB& outer, const AABB& inner)
+    {
+        return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+            outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+    }
+
+    float Distance(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        float dx = a.x - b.x;
+        float dy = a.y - b.y;
+        float dz = a.z - b.z;
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    AABB MakeSceneCell()
+    {
+        AABB cell;
+        cell.min = XMFLOAT3(-TEST_SCENE_EXTENT, -TEST_SCENE_EXTENT, -TEST_SCENE_EXTENT);
+        cell.max = XMFLOAT3(TEST_SCENE_EXTENT + 10.0f, TEST_SCENE_EXTENT + 10.0f, TEST_SCENE_EXTENT + 10.0f);
+        return cell;
+    }
+}
+
+TEST_CASE(QuantizedBounds, CodesRoundOutwardAndStayTight)
+{
+    std::mt19937 generator(6);
+    // Cells with awkward origins and extents, including one far from the origin
+    const float cells[][2] = { { -500.0f, 510.0f }, { 0.001f, 0.37f }, { 12345.6f, 12399.1f }, { -3.0f, 1e6f } };
+    for (const auto& cell : cells)
+    {
+        AABB cellBounds;
+        cellBounds.min = XMFLOAT3(cell[0], cell[0], cell[0]);
+        cellBounds.max = XMFLOAT3(cell[1], cell[1], cell[1]);
+        BoundsQuantization quantization = MakeBoundsQuantization(cellBounds);
+        float origin = quantization.origin.x;
+        float scale = quantization.scale.x;
+        CHECK(DequantizeBound(QUANTIZED_BOUNDS_MAX_CODE, origin, scale) >= cell[1]);
+
+        std::uniform_real_distribution<float> value(cell[0], cell[1]);
+        for (uint32_t i = 0; i < 20000; ++i)
+        {
+            float v = value(generator);
+            uint16_t low = QuantizeBoundMin(v, origin, scale);
+            uint16_t high = QuantizeBoundMax(v, origin, scale);
+            CHECK(DequantizeBound(low, origin, scale) <= v);
+            CHECK(DequantizeBound(high, origin, scale) >= v);
+            // The nearest conservative code, one step further in would cut into the value
+            CHECK(low == QUANTIZED_BOUNDS_MAX_CODE || DequantizeBound(low + 1u, origin, scale) > v);
+            CHECK(high == 0 || DequantizeBound(high - 1u, origin, scale) < v);
+        }
+    }
+}
+
+TEST_CASE(QuantizedBounds, RadiusRoundsUp)
+{
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> exponent(-10.0f, 4.0f);
+    for (uint32_t i = 0; i < 20000; ++i)
+    {
+        float radius = std::pow(10.0f, exponent(generator));
+        uint32_t bits = QuantizeRadius(radius);
+        CHECK(f16tof32(bits) >= radius);
+        CHECK(bits == 0 || f16tof32(bits - 1) < radius);
+    }
+    CHECK(f16tof32(QuantizeRadius(0.0f)) == 0.0f);
+}
+
+TEST_CASE(QuantizedBounds, DecodedBoundsEncloseTheInput)
+{
+    AABB cell = MakeSceneCell();
+    BoundsQuantization quantization = MakeBoundsQuantization(cell);
+    std::vector<AABB> boxes = MakeRandomBoxes(20000, 8);
+    boxes.push_back(cell);
+
+    for (const AABB& box : boxes)
+    {
+        REQUIRE(IsInsideQuantization(box, quantization));
+        QuantizedBounds bounds = QuantizeBounds(box, quantization);
+        AABB decoded = DequantizeBounds(bounds, quantization);
+        CHECK(Encloses(decoded, box));
+
+        // The sphere around the decoded center holds the whole decoded box
+        XMFLOAT3 center = GetQuantizedBoundsCenter(bounds, quantization);
+        CHECK(GetQuantizedBoundsRadius(bounds) >= Distance(center, decoded.max));
+        CHECK(GetQuantizedBoundsRadius(bounds) >= Distance(center, decoded.min));
+
+        // A tight sphere only ever shrinks the radius, and still holds the sphere it came from
+        Sphere sphere;
+        sphere.center = XMFLOAT3((box.min.x + box.max.x) * 0.5f, (box.min.y + box.max.y) * 0.5f, (box.min.z + box.max.z) * 0.5f);
+        sphere.radius = std::min(box.max.x - box.min.x, std::min(box.max.y - box.min.y, box.max.z - box.min.z)) * 0.5f;
+        QuantizedBounds withSphere = QuantizeBounds(box, sphere, quantization);
+        CHECK(withSphere.minXY == bounds.minXY && withSphere.minZMaxX == bounds.minZMaxX && withSphere.maxYZ == bounds.maxYZ);
+        CHECK(GetQuantizedBoundsRadius(withSphere) <= GetQuantizedBoundsRadius(bounds));
+        CHECK(GetQuantizedBoundsRadius(withSphere) >= Distance(center, sphere.center) + sphere.radius ||
+            withSphere.radius == bounds.radius);
+    }
+
+    AABB outside;
+    outside.min = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    outside.max = XMFLOAT3(600.0f, 1.0f, 1.0f);
+    CHECK(!IsInsideQuantization(outside, quantization));
+}
+
+TEST_CASE(QuantizedBounds, CullerKeepsEverythingTheFloatCullerSees)
+{
+    std::vector<AABB> boxes = MakeRandomBoxes(30000, 9);
+
+    FrustumCuller floatCuller;
+    QuantizedFrustumCuller quantizedCuller;
+    quantizedCuller.Initialize(MakeSceneCell());
+    for (const AABB& box : boxes)
+    {
+        floatCuller.AddInstance(box);
+        quantizedCuller.AddInstance(box);
+    }
+
+    for (float yaw : { 0.0f, 0.3f, 1.5f, 3.1f })
+    {
+        for (float farPlane : { 100.0f, 800.0f })
+        {
+            Frustum frustum = MakeTestFrustum(yaw, farPlane);
+            std::vector<uint32_t> floatVisible;
+            floatCuller.Cull(frustum, floatVisible, CullPath::Scalar);
+
+            std::vector<uint32_t> reference;
+            quantizedCuller.Cull(frustum, reference, CullPath::Scalar);
+            CHECK(std::includes(reference.begin(), reference.end(), floatVisible.begin(), floatVisible.end()));
+            // Outward rounding by a code step only lets a sliver more through
+            CHECK(reference.size() <= floatVisible.size() + floatVisible.size() / 50 + 10);
+
+            for (CullPath path : { CullPath::SSE, CullPath::AVX2 })
+            {
+                if (FrustumCuller::IsCullPathSupported(path))
+                {
+                    std::vector<uint32_t> visible;
+                    quantizedCuller.Cull(frustum, visible, path);
+                    CHECK(visible == reference);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE(QuantizedBounds, CellGrowthStaysConservative)
+{
+    // No cell up front, every far away instance grows it and re-encodes the others
+    std::vector<AABB> boxes = MakeRandomBoxes(2000, 10);
+    QuantizedFrustumCuller culler;
+    for (uint32_t i = 0; i < boxes.size(); ++i)
+    {
+        if (i % 500 == 499)
+        {
+            float offset = 1000.0f * static_cast<float>(i / 500 + 1);
+            boxes[i].min.x += offset;
+            boxes[i].max.x += offset;
+        }
+        culler.AddInstance(boxes[i]);
+    }
+
+    REQUIRE(culler.GetInstanceCount() == boxes.size());
+    for (uint32_t i = 0; i < boxes.size(); ++i)
+    {
+        CHECK(Encloses(culler.GetInstanceBounds(i), boxes[i]));
+    }
+
+    AABB moved;
+    moved.min = XMFLOAT3(-9000.0f, 3.0f, 3.0f);
+    moved.max = XMFLOAT3(-8990.0f, 4.0f, 4.0f);
+    culler.SetInstanceBounds(7, moved);
+    boxes[7] = moved;
+    for (uint32_t i = 0; i < boxes.size(); ++i)
+    {
+        CHECK(Encloses(culler.GetInstanceBounds(i), boxes[i]));
+    }
+}
@@ -0,0 +1,171 @@
+#include "TestFramework.h"
+
+#include "System/RangeAllocator.h"
+
+#include <cmath>
+#include <map>
+#include <random>
+
+namespace
+{
+    // Live allocations by offset, the reference the allocator is checked against
+    using IntervalSet = std::map<uint32_t, RangeAllocator::Allocation>;
+
+    uint32_t GetLargestGap(const IntervalSet& live, uint32_t capacity)
+    {
+        uint32_t largest = 0;
+        uint32_t end = 0;
+        for (const auto& [offset, allocation] : live)
+        {
+            largest = std::max(largest, offset - end);
+            end = offset + allocation.size;
+        }
+        return std::max(largest, capacity - end);
+    }
+
+    // The new range may neither leave the capacity nor touch its neighbors in the reference
+    bool FitsBetweenNeighbors(const IntervalSet& live, const RangeAllocator::Allocation& allocation, uint32_t capacity)
+    {
+        if (uint64_t(allocation.offset) + allocation.size > capacity)
+        {
+            return false;
+        }
+
+        auto next = live.lower_bound(allocation.offset);
+        if (next != live.end() && next->first < allocation.offset + allocation.size)
+        {
+            return false;
+        }
+        if (next != live.begin())
+        {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second.size > allocation.offset)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void CheckAgainstReference(const RangeAllocator& allocator, const IntervalSet& live)
+    {
+        uint64_t usedSize = 0;
+        for (const auto& [offset, allocation] : live)
+        {
+            usedSize += allocation.size;
+        }
+        CHECK(allocator.GetUsedSize() == usedSize);
+        CHECK(allocator.GetAllocationCount() == live.size());
+        CHECK(allocator.GetLargestFreeRange() == GetLargestGap(live, allocator.GetCapacity()));
+    }
+}
+
+TEST_CASE(RangeAllocator, RandomStressMatchesIntervalSet)
+{
+    // Capacities off every bin boundary, and sizes from single elements to a sizeable share of the capacity
+    for (uint32_t capacity : { 1000003u, 4097u, 1u << 20 })
+    {
+        std::mt19937 generator(capacity);
+        std::uniform_real_distribution<float> logSize(0.0f, std::log2(static_cast<float>(capacity) / 8.0f));
+        std::uniform_int_distribution<uint32_t> operation(0, 99);
+
+        RangeAllocator allocator;
+        allocator.Initialize(capacity);
+        CHECK(allocator.GetLargestFreeRange() == capacity);
+
+        IntervalSet live;
+        uint32_t failures = 0;
+        for (uint32_t step = 0; step < 100000; ++step)
+        {
+            // Mostly allocating while the set is small, mostly freeing once it fills up
+            bool isAllocating = live.empty() || operation(generator) >= 40 + std::min<uint32_t>(static_cast<uint32_t>(live.size()) / 8, 50);
+            if (isAllocating)
+            {
+                uint32_t size = std::max(1u, static_cast<uint32_t>(std::exp2(logSize(generator))));
+                uint32_t largestGap = GetLargestGap(live, capacity);
+                RangeAllocator::Allocation allocation = allocator.Allocate(size);
+
+                // Fails exactly when no free range holds the size
+                CHECK(allocation.IsValid() == (size <= largestGap));
+                if (allocation.IsValid())
+                {
+                    CHECK(allocation.size == size);
+                    CHECK(FitsBetweenNeighbors(live, allocation, capacity));
+                    live[allocation.offset] = allocation;
+                }
+                else
+                {
+                    ++failures;
+                }
+            }
+            else
+            {
+                auto it = live.begin();
+                std::advance(it, std::uniform_int_distribution<size_t>(0, live.size() - 1)(generator));
+                allocator.Free(it->second);
+                live.erase(it);
+            }
+
+            if (step % 250 == 0)
+            {
+                CheckAgainstReference(allocator, live);
+            }
+        }
+        CheckAgainstReference(allocator, live);
+        CHECK(failures > 0);
+
+        // The largest free range is always servable
+        uint32_t largest = allocator.GetLargestFreeRange();
+        if (largest > 0)
+        {
+            RangeAllocator::Allocation allocation = allocator.Allocate(largest);
+            REQUIRE(allocation.IsValid());
+            CHECK(FitsBetweenNeighbors(live, allocation, capacity));
+            allocator.Free(allocation);
+        }
+
+        // Freed in random order, everything coalesces back into the one initial range
+        std::vector<RangeAllocator::Allocation> remaining;
+        for (const auto& [offset, allocation] : live)
+        {
+            remaining.push_back(allocation);
+        }
+        std::shuffle(remaining.begin(), remaining.end(), generator);
+        for (const RangeAllocator::Allocation& allocation : remaining)
+        {
+            allocator.Free(allocation);
+        }
+        CHECK(allocator.GetUsedSize() == 0 && allocator.GetAllocationCount() == 0);
+        CHECK(allocator.GetLargestFreeRange() == capacity);
+        RangeAllocator::Allocation whole = allocator.Allocate(capacity);
+        CHECK(whole.IsValid() && whole.offset == 0 && whole.size == capacity);
+        CHECK(!allocator.Allocate(1).IsValid());
+    }
+}
+
+TEST_CASE(RangeAllocator, FreeMergesWithBothNeighbors)
+{
+    RangeAllocator allocator;
+    allocator.Initialize(100);
+
+    RangeAllocator::Allocation a = allocator.Allocate(10);
+    RangeAllocator::Allocation b = allocator.Allocate(20);
+    RangeAllocator::Allocation c = allocator.Allocate(30);
+    RangeAllocator::Allocation d = allocator.Allocate(40);
+    REQUIRE(a.IsValid() && b.IsValid() && c.IsValid() && d.IsValid());
+    CHECK(allocator.GetLargestFreeRange() == 0);
+
+    // Two separate holes, then the range between them joins all three
+    allocator.Free(a);
+    allocator.Free(c);
+    CHECK(allocator.GetLargestFreeRange() == 30);
+    CHECK(!allocator.Allocate(31).IsValid());
+    allocator.Free(b);
+    CHECK(allocator.GetLargestFreeRange() == 60);
+
+    RangeAllocator::Allocation joined = allocator.Allocate(60);
+    CHECK(joined.IsValid() && joined.offset == 0);
+    allocator.Free(joined);
+    allocator.Free(d);
+    CHECK(allocator.GetLargestFreeRange() == 100);
+}
@@ -0,0 +1,74 @@
+#include "TestFramework.h"
+
+#include <cstring>
+
+namespace
+{
+    uint32_t s_failureCount = 0;
+}
+
+std::vector<TestCase>& GetTestCases()
+{
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+std::vector<TestCase>& GetBenchmarkCases()
+{
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+void ReportFailure(const char* expression, const char* file, int line)
+{
+    std::cerr << "    " << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+    ++s_failureCount;
+}
+
+void ReportTiming(const char* label, double milliseconds, double budgetMilliseconds)
+{
+    std::printf("    %-48s %10.3f ms", label, milliseconds);
+    if (budgetMilliseconds > 0.0)
+    {
+        bool isWithinBudget = milliseconds <= budgetMilliseconds;
+        std::printf("  (budget %.3f ms, %s)", budgetMilliseconds, isWithinBudget ? "ok" : "over budget");
+        if (!isWithinBudget)
+        {
+            ++s_failureCount;
+        }
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+}
+
+int RunTestCases(const std::vector<TestCase>& cases, const char* suiteFilter)
+{
+    int failedCases = 0;
+    int ranCases = 0;
+    for (const TestCase& testCase : cases)
+    {
+        if (suiteFilter && std::strcmp(suiteFilter, testCase.suite) != 0)
+        {
+            continue;
+        }
+
+        std::cout << testCase.suite << "." << testCase.name << std::endl;
+        uint32_t failuresBefore = s_failureCount;
+        testCase.function();
+        ++ranCases;
+        if (s_failureCount != failuresBefore)
+        {
+            std::cout << "    FAILED" << std::endl;
+            ++failedCases;
+        }
+    }
+
+    if (ranCases == 0)
+    {
+        std::cerr << "No cases match " << (suiteFilter ? suiteFilter : "") << std::endl;
+        return 1;
+    }
+
+    std::cout << ranCases - failedCases << " of " << ranCases << " cases passed" << std::endl;
+    return failedCases;
+}
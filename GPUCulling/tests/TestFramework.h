@@ -0,0 +1,67 @@
+#pragma once
+
+#include "stdafx.h"
+#include <chrono>
+#include <cstdio>
+
+// Minimal self registering test and benchmark cases for the headless targets. Tests run under CTest, one test per
+// suite, benchmarks run on demand from GPUCullingBench. Both executables take an optional suite name to run only
+// that suite.
+
+using TestFunction = void (*)();
+
+struct TestCase
+{
+    const char* suite;
+    const char* name;
+    TestFunction function;
+};
+
+std::vector<TestCase>& GetTestCases();
+std::vector<TestCase>& GetBenchmarkCases();
+
+struct TestRegistrar
+{
+    TestRegistrar(std::vector<TestCase>& cases, const char* suite, const char* name, TestFunction function)
+    {
+        cases.push_back({ suite, name, function });
+    }
+};
+
+// Counts a failed check of the running case, the case keeps running unless the check was a REQUIRE
+void ReportFailure(const char* expression, const char* file, int line);
+// Runs the registered cases of suiteFilter, or all of them for null. Returns the number of failed cases.
+int RunTestCases(const std::vector<TestCase>& cases, const char* suiteFilter);
+
+#define TEST_CASE(suite, name) \
+    static void suite##_##name(); \
+    static TestRegistrar suite##_##name##_registrar(GetTestCases(), #suite, #name, suite##_##name); \
+    static void suite##_##name()
+
+#define BENCHMARK_CASE(suite, name) \
+    static void suite##_##name(); \
+    static TestRegistrar suite##_##name##_registrar(GetBenchmarkCases(), #suite, #name, suite##_##name); \
+    static void suite##_##name()
+
+#define CHECK(expression) ((expression) ? (void)0 : ReportFailure(#expression, __FILE__, __LINE__))
+#define REQUIRE(expression) do { if (!(expression)) { ReportFailure(#expression, __FILE__, __LINE__); return; } } while (false)
+
+// Best of repetitions wall clock time of function in milliseconds, the first call warms the caches
+template <typename Function>
+double MeasureMilliseconds(uint32_t repetitions, Function&& function)
+{
+    function();
+
+    double best = std::numeric_limits<double>::max();
+    for (uint32_t i = 0; i < repetitions; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+// Prints one benchmark result line. A budget of 0 only reports, otherwise going over it fails the benchmark.
+void ReportTiming(const char* label, double milliseconds, double budgetMilliseconds = 0.0);
@@ -0,0 +1,7 @@
+#include "TestFramework.h"
+
+// GPUCullingTests [suite]
+int main(int argc, char** argv)
+{
+    return RunTestCases(GetTestCases(), argc > 1 ? argv[1] : nullptr) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
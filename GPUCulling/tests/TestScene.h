@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Culling/Bounds.h"
+#include "Culling/Frustum.h"
+#include <cmath>
+#include <random>
+
+// Deterministic scenes shared by the tests and benchmarks: boxes scattered through a cube around the origin and a
+// camera looking into it, so roughly a third of the boxes end up inside the frustum.
+
+static constexpr float TEST_SCENE_EXTENT = 500.0f;
+
+inline std::vector<AABB> MakeRandomBoxes(size_t count, uint32_t seed, float maxSize = 8.0f)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> position(-TEST_SCENE_EXTENT, TEST_SCENE_EXTENT);
+    std::uniform_real_distribution<float> size(0.1f, maxSize);
+
+    std::vector<AABB> boxes(count);
+    for (AABB& box : boxes)
+    {
+        box.min = XMFLOAT3(position(generator), position(generator), position(generator));
+        box.max = XMFLOAT3(box.min.x + size(generator), box.min.y + size(generator), box.min.z + size(generator));
+    }
+    return boxes;
+}
+
+inline XMMATRIX MakeTestViewProjection(float yawRadians = 0.3f, float farPlane = 800.0f)
+{
+    XMVECTOR eye = XMVectorSet(0.0f, 20.0f, -TEST_SCENE_EXTENT * 0.5f, 1.0f);
+    XMVECTOR direction = XMVectorSet(std::sin(yawRadians), -0.05f, std::cos(yawRadians), 0.0f);
+    XMMATRIX view = XMMatrixLookAtLH(eye, XMVectorAdd(eye, direction), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(70.0f), 16.0f / 9.0f, 0.1f, farPlane);
+    return XMMatrixMultiply(view, projection);
+}
+
+inline Frustum MakeTestFrustum(float yawRadians = 0.3f, float farPlane = 800.0f)
+{
+    return Frustum::FromMatrix(MakeTestViewProjection(yawRadians, farPlane));
+}
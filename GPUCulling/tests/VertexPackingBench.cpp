@@ -0,0 +1,50 @@
+#include "TestFramework.h"
+
+#include "Culling/QuantizedBounds.h"
+#include "IO/VertexPacking.h"
+
+#include <random>
+
+// Import time cost of packing a mesh's vertices, per path
+BENCHMARK_CASE(VertexPacking, Encode200kVertices)
+{
+    constexpr size_t VERTEX_COUNT = 200000;
+
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<VertexData> vertices(VERTEX_COUNT);
+    for (VertexData& vertex : vertices)
+    {
+        vertex.position = XMFLOAT3(unit(generator) * 10.0f, unit(generator) * 10.0f, unit(generator) * 10.0f);
+        XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMVectorSet(unit(generator), unit(generator), unit(generator), 0.0f)));
+        XMStoreFloat3(&vertex.tangent, XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&vertex.normal), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f))));
+        XMStoreFloat3(&vertex.bitangent, XMVector3Cross(XMLoadFloat3(&vertex.normal), XMLoadFloat3(&vertex.tangent)));
+        vertex.texCoord = XMFLOAT2(unit(generator), unit(generator));
+    }
+
+    AABB bounds;
+    bounds.min = XMFLOAT3(-10.0f, -10.0f, -10.0f);
+    bounds.max = XMFLOAT3(10.0f, 10.0f, 10.0f);
+    ShaderInterop::BoundsQuantization quantization = MakeBoundsQuantization(bounds);
+    std::vector<ShaderInterop::PackedVertex> packed(VERTEX_COUNT);
+    std::vector<ShaderInterop::QuantizedVertex> quantized(VERTEX_COUNT);
+
+    for (CullPath path : { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 })
+    {
+        if (path == CullPath::AVX2 && DEFAULT_CULL_PATH != CullPath::AVX2)
+        {
+            continue;
+        }
+
+        const char* pathName = path == CullPath::Scalar ? "scalar" : path == CullPath::SSE ? "SSE" : "AVX2";
+        double packedMilliseconds = MeasureMilliseconds(5, [&]() { PackVertices(vertices.data(), VERTEX_COUNT, packed.data(), path); });
+        double quantizedMilliseconds = MeasureMilliseconds(5, [&]() {
+            PackVertices(vertices.data(), VERTEX_COUNT, quantization, quantized.data(), path);
+        });
+
+        std::string label = std::string("PackedVertex, ") + pathName;
+        ReportTiming(label.c_str(), packedMilliseconds);
+        label = std::string("QuantizedVertex, ") + pathName;
+        ReportTiming(label.c_str(), quantizedMilliseconds);
+    }
+}
@@ -0,0 +1,195 @@
+#include "TestFramework.h"
+
+#include "Culling/QuantizedBounds.h"
+#include "IO/VertexPacking.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+using namespace ShaderInterop;
+
+namespace
+{
+    // Worst case decode errors documented in IO/VertexPacking.h
+    constexpr float MAX_NORMAL_ERROR_DEGREES = 0.004f;
+    constexpr float MAX_TANGENT_ERROR_DEGREES = 0.006f;
+
+    const CullPath PACKING_PATHS[] = { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 };
+
+    XMFLOAT3 RandomUnitVector(std::mt19937& generator)
+    {
+        std::normal_distribution<float> component(0.0f, 1.0f);
+        XMFLOAT3 result;
+        XMStoreFloat3(&result, XMVector3Normalize(XMVectorSet(component(generator), component(generator), component(generator), 0.0f)));
+        return result;
+    }
+
+    // Orthonormal frames with either handedness, positions inside a box and texture coordinates over several tiles
+    std::vector<VertexData> MakeVertices(size_t count, uint32_t seed)
+    {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<float> position(-37.0f, 113.0f);
+        std::uniform_real_distribution<float> texCoord(-4.0f, 4.0f);
+
+        std::vector<VertexData> vertices(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            VertexData& vertex = vertices[i];
+            vertex.position = XMFLOAT3(position(generator), position(generator), position(generator));
+            vertex.normal = RandomUnitVector(generator);
+            vertex.texCoord = XMFLOAT2(texCoord(generator), texCoord(generator));
+
+            XMVECTOR normal = XMLoadFloat3(&vertex.normal);
+            XMFLOAT3 direction = RandomUnitVector(generator);
+            XMVECTOR tangent = XMLoadFloat3(&direction);
+            tangent = XMVector3Normalize(XMVectorSubtract(tangent, XMVectorScale(normal, XMVectorGetX(XMVector3Dot(normal, tangent)))));
+            XMVECTOR bitangent = XMVector3Cross(normal, tangent);
+            XMStoreFloat3(&vertex.tangent, tangent);
+            XMStoreFloat3(&vertex.bitangent, (i % 2 == 0) ? bitangent : XMVectorNegate(bitangent));
+        }
+        return vertices;
+    }
+
+    // atan2 of cross and dot in double, acos is too coarse near zero to resolve thousandths of a degree
+    float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        double cx = double(a.y) * b.z - double(a.z) * b.y;
+        double cy = double(a.z) * b.x - double(a.x) * b.z;
+        double cz = double(a.x) * b.y - double(a.y) * b.x;
+        double dot = double(a.x) * b.x + double(a.y) * b.y + double(a.z) * b.z;
+        return static_cast<float>(std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot) * 180.0 / 3.14159265358979323846);
+    }
+
+    // Half floats keep 11 significant bits, round to nearest halves that
+    bool IsWithinHalfRounding(float decoded, float original)
+    {
+        return std::abs(decoded - original) <= std::abs(original) * (1.0f / 2048.0f) + 1e-7f;
+    }
+
+    bool IsSameBits(const void* a, const void* b, size_t size)
+    {
+        return std::memcmp(a, b, size) == 0;
+    }
+}
+
+TEST_CASE(VertexPacking, LayoutsPackTightly)
+{
+    CHECK(sizeof(PackedVertex) == 24);
+    CHECK(sizeof(QuantizedVertex) == 20);
+}
+
+TEST_CASE(VertexPacking, PackedVertexErrorStaysInBounds)
+{
+    // Not a multiple of any register width, so every path runs its tail
+    std::vector<VertexData> vertices = MakeVertices(20011, 1);
+    std::vector<PackedVertex> reference(vertices.size());
+    PackVertices(vertices.data(), vertices.size(), reference.data(), CullPath::Scalar);
+
+    for (CullPath path : PACKING_PATHS)
+    {
+        if (path != CullPath::Scalar && (path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2))
+        {
+            std::vector<PackedVertex> packed(vertices.size());
+            PackVertices(vertices.data(), vertices.size(), packed.data(), path);
+            CHECK(IsSameBits(packed.data(), reference.data(), packed.size() * sizeof(PackedVertex)));
+        }
+    }
+
+    float maxNormalError = 0.0f;
+    float maxTangentError = 0.0f;
+    float maxBitangentError = 0.0f;
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        const VertexData& original = vertices[i];
+        VertexData decoded = UnpackVertex(reference[i]);
+        CHECK(decoded.position.x == original.position.x && decoded.position.y == original.position.y && decoded.position.z == original.position.z);
+        CHECK(IsWithinHalfRounding(decoded.texCoord.x, original.texCoord.x));
+        CHECK(IsWithinHalfRounding(decoded.texCoord.y, original.texCoord.y));
+
+        maxNormalError = std::max(maxNormalError, AngleDegrees(decoded.normal, original.normal));
+        maxTangentError = std::max(maxTangentError, AngleDegrees(decoded.tangent, original.tangent));
+        // The sign has to survive, a flipped bitangent would be 180 degrees off
+        maxBitangentError = std::max(maxBitangentError, AngleDegrees(decoded.bitangent, original.bitangent));
+    }
+
+    std::printf("    max error: normal %.4f deg, tangent %.4f deg, bitangent %.4f deg\n", maxNormalError, maxTangentError, maxBitangentError);
+    CHECK(maxNormalError <= MAX_NORMAL_ERROR_DEGREES);
+    CHECK(maxTangentError <= MAX_TANGENT_ERROR_DEGREES);
+    CHECK(maxBitangentError <= MAX_NORMAL_ERROR_DEGREES + MAX_TANGENT_ERROR_DEGREES);
+}
+
+TEST_CASE(VertexPacking, QuantizedPositionsRoundToNearest)
+{
+    std::vector<VertexData> vertices = MakeVertices(20011, 2);
+    AABB bounds;
+    bounds.min = XMFLOAT3(-37.0f, -37.0f, -37.0f);
+    bounds.max = XMFLOAT3(113.0f, 113.0f, 113.0f);
+    BoundsQuantization quantization = MakeBoundsQuantization(bounds);
+
+    std::vector<QuantizedVertex> reference(vertices.size());
+    PackVertices(vertices.data(), vertices.size(), quantization, reference.data(), CullPath::Scalar);
+    for (CullPath path : PACKING_PATHS)
+    {
+        if (path != CullPath::Scalar && (path != CullPath::AVX2 || DEFAULT_CULL_PATH == CullPath::AVX2))
+        {
+            std::vector<QuantizedVertex> packed(vertices.size());
+            PackVertices(vertices.data(), vertices.size(), quantization, packed.data(), path);
+            CHECK(IsSameBits(packed.data(), reference.data(), packed.size() * sizeof(QuantizedVertex)));
+        }
+    }
+
+    // Half a step, plus the float rounding of the decode itself
+    const float* scale = &quantization.scale.x;
+    float maxStepError = 0.0f;
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        VertexData decoded = UnpackVertex(reference[i], quantization);
+        const float* original = &vertices[i].position.x;
+        const float* position = &decoded.position.x;
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            maxStepError = std::max(maxStepError, std::abs(position[axis] - original[axis]) / scale[axis]);
+        }
+
+        // The frame is packed the same way as in PackedVertex
+        PackedVertex packed;
+        PackVertices(&vertices[i], 1, &packed, CullPath::Scalar);
+        CHECK(reference[i].normal == packed.normal && reference[i].tangent == packed.tangent && reference[i].texCoord == packed.texCoord);
+    }
+    std::printf("    max position error: %.3f steps\n", maxStepError);
+    CHECK(maxStepError <= 0.51f);
+
+    // Outside the bounds clamps to the cell
+    VertexData outside = vertices[0];
+    outside.position = XMFLOAT3(-1000.0f, 1000.0f, 50.0f);
+    QuantizedVertex clamped;
+    PackVertices(&outside, 1, quantization, &clamped, CullPath::Scalar);
+    VertexData decoded = UnpackVertex(clamped, quantization);
+    CHECK(decoded.position.x == quantization.origin.x);
+    CHECK(decoded.position.y >= bounds.max.y && decoded.position.y <= bounds.max.y + scale[1]);
+}
+
+TEST_CASE(VertexPacking, DegenerateFramesDecodeToUnitVectors)
+{
+    std::vector<VertexData> vertices(4);
+    // Zero normal, axis aligned frames on the octahedron's folds and a frame on its lower tip
+    vertices[1].normal = XMFLOAT3(1.0f, 0.0f, 0.0f);
+    vertices[1].tangent = XMFLOAT3(0.0f, 1.0f, 0.0f);
+    vertices[2].normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
+    vertices[2].tangent = XMFLOAT3(-1.0f, 0.0f, 0.0f);
+    vertices[3].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+    vertices[3].tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
+
+    std::vector<PackedVertex> packed(vertices.size());
+    PackVertices(vertices.data(), vertices.size(), packed.data(), CullPath::Scalar);
+
+    VertexData zero = UnpackVertex(packed[0]);
+    CHECK(zero.normal.x == 0.0f && zero.normal.y == 0.0f && zero.normal.z == 1.0f);
+    for (size_t i = 1; i < vertices.size(); ++i)
+    {
+        VertexData decoded = UnpackVertex(packed[i]);
+        CHECK(AngleDegrees(decoded.normal, vertices[i].normal) <= MAX_NORMAL_ERROR_DEGREES);
+        CHECK(AngleDegrees(decoded.tangent, vertices[i].tangent) <= MAX_TANGENT_ERROR_DEGREES);
+    }
+}
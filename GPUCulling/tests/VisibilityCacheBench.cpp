@@ -0,0 +1,82 @@
+#include "TestFramework.h"
+#include "TestScene.h"
+
+#include "Culling/BVH.h"
+#include "Culling/VisibilityCache.h"
+#include "Engine/Camera.h"
+
+namespace
+{
+    void StartWalk(Camera& camera)
+    {
+        camera.Initialize(70.0f, 16.0f / 9.0f, 0.1f, 800.0f);
+        camera.SetPosition(0.0f, 20.0f, -TEST_SCENE_EXTENT * 0.5f);
+        camera.SetRotation(17.0f, -3.0f);
+    }
+
+    // Walking pace at 60 Hz, half a unit per frame
+    void StepWalk(Camera& camera, float turnDegrees)
+    {
+        camera.MoveForward(0.5f);
+        camera.Rotate(turnDegrees, 0.0f);
+    }
+}
+
+// Per frame cost of the temporal cull along a walk, against a full BVH cull of the same frames
+BENCHMARK_CASE(VisibilityCache, WalkVersusFullCull)
+{
+    constexpr size_t INSTANCE_COUNT = 500000;
+    constexpr uint32_t FRAME_COUNT = 200;
+    std::vector<AABB> boxes = MakeRandomBoxes(INSTANCE_COUNT, 2, 4.0f);
+    BVH bvh;
+    bvh.Build(boxes.data(), boxes.size());
+
+    VisibilityCache cache;
+    cache.Initialize(bvh);
+    Camera camera;
+    std::vector<uint32_t> visible;
+
+    // Each repetition walks the same path from a full cull, the first frame is included in the total. Turning moves
+    // the far corners of the frustum by far more than walking does and leaves less to reuse.
+    for (float turnDegrees : { 0.0f, 0.3f })
+    {
+        uint64_t reuses = 0;
+        uint64_t tests = 0;
+        uint64_t changes = 0;
+        double cacheMilliseconds = MeasureMilliseconds(5, [&]()
+        {
+            StartWalk(camera);
+            cache.Invalidate();
+            reuses = 0;
+            tests = 0;
+            changes = 0;
+            for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+            {
+                cache.Update(camera);
+                const VisibilityCache::Stats& stats = cache.GetStats();
+                reuses += stats.nodeReuses + stats.primitiveReuses;
+                tests += stats.nodeTests + stats.primitiveTests;
+                changes += cache.GetChangedIndices().size();
+                StepWalk(camera, turnDegrees);
+            }
+        });
+
+        size_t visibleCount = 0;
+        double fullMilliseconds = MeasureMilliseconds(5, [&]()
+        {
+            StartWalk(camera);
+            for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+            {
+                visibleCount = bvh.Cull(camera.GetFrustum(), visible);
+                StepWalk(camera, turnDegrees);
+            }
+        });
+
+        std::printf("    500k instances, %u frames turning %.1f degrees per frame, %zu visible at the end\n", FRAME_COUNT, turnDegrees,
+            visibleCount);
+        ReportTiming("visibility cache, per frame", cacheMilliseconds / FRAME_COUNT);
+        ReportTiming("full BVH cull, per frame", fullMilliseconds / FRAME_COUNT);
+        std::printf("        %.1f%% of the boxes reused, %.0f changed per frame, speedup %.2fx\n", 100.0 * reuses / double(reuses + tests),
+            double(changes) / FRAME_COUNT, fullMilliseconds / cacheMilliseconds);
+    }
+}
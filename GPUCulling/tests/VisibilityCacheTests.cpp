@@ -0,0 +1,172 @@
+#include "TestFramework.h"
+#include "TestScene.h"
+
+#include "Culling/BVH.h"
+#include "Culling/VisibilityCache.h"
+#include "Engine/Camera.h"
+
+#include <cmath>
+
+namespace
+{
+    enum class CameraStep
+    {
+        Still,
+        Move,
+        Cut,
+        Zoom
+    };
+
+    // A walkthrough of the test scene: small moves and turns with a few still frames, one cut to the other side of
+    // the scene, a strafe, a run of FOV changes and a slow walk back
+    CameraStep AdvanceCamera(Camera& camera, uint32_t frame)
+    {
+        if (frame == 0)
+        {
+            camera.Initialize(70.0f, 16.0f / 9.0f, 0.1f, 800.0f);
+            camera.SetPosition(0.0f, 20.0f, -TEST_SCENE_EXTENT * 0.5f);
+            camera.SetRotation(17.0f, -3.0f);
+            return CameraStep::Cut;
+        }
+        if (frame % 25 == 0)
+        {
+            return CameraStep::Still;
+        }
+        if (frame < 150)
+        {
+            camera.MoveForward(0.4f);
+            camera.Rotate(0.3f, 0.2f * std::sin(frame * 0.1f));
+            return CameraStep::Move;
+        }
+        if (frame == 150)
+        {
+            camera.SetPosition(300.0f, 50.0f, 300.0f);
+            camera.SetRotation(-130.0f, -10.0f);
+            return CameraStep::Cut;
+        }
+        if (frame < 240)
+        {
+            camera.MoveRight(0.3f);
+            camera.Rotate(-0.25f, 0.0f);
+            return CameraStep::Move;
+        }
+        if (frame < 260)
+        {
+            camera.SetFOV(70.0f - 2.0f * (frame - 239));
+            return CameraStep::Zoom;
+        }
+        camera.MoveBackward(0.5f);
+        camera.Rotate(0.1f, -0.05f);
+        return CameraStep::Move;
+    }
+
+    std::vector<uint32_t> CullSorted(const BVH& bvh, const Frustum& frustum)
+    {
+        std::vector<uint32_t> visible;
+        bvh.Cull(frustum, visible);
+        std::sort(visible.begin(), visible.end());
+        return visible;
+    }
+}
+
+TEST_CASE(VisibilityCache, CameraPathMatchesFullCull)
+{
+    constexpr uint32_t FRAME_COUNT = 320;
+    std::vector<AABB> boxes = MakeRandomBoxes(30000, 12);
+    BVH bvh;
+    bvh.Build(boxes.data(), boxes.size());
+
+    for (CullPath path : { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 })
+    {
+        if (path == CullPath::AVX2 && DEFAULT_CULL_PATH != CullPath::AVX2)
+        {
+            continue;
+        }
+
+        VisibilityCache cache;
+        cache.Initialize(bvh);
+        Camera camera;
+        std::vector<bool> previousVisible(boxes.size(), false);
+        uint32_t fullCullTests = 0;
+
+        for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+        {
+            CameraStep step = AdvanceCamera(camera, frame);
+            cache.Update(camera, path);
+            const VisibilityCache::Stats& stats = cache.GetStats();
+
+            std::vector<uint32_t> visible;
+            cache.GetVisibleIndices(visible);
+            std::vector<uint32_t> reference = CullSorted(bvh, camera.GetFrustum());
+            CHECK(visible == reference);
+            CHECK(cache.GetVisibleCount() == reference.size());
+
+            // The changed list patches the previous frame into this one
+            for (uint32_t index : cache.GetChangedIndices())
+            {
+                previousVisible[index] = !previousVisible[index];
+            }
+            for (uint32_t i = 0; i < boxes.size(); ++i)
+            {
+                CHECK(previousVisible[i] == cache.IsVisible(i));
+            }
+
+            // Cuts and projection changes start over, everything else reuses part of the last frame
+            uint32_t tests = stats.nodeTests + stats.primitiveTests;
+            CHECK(stats.fullCull == (step == CameraStep::Cut || step == CameraStep::Zoom));
+            if (stats.fullCull)
+            {
+                fullCullTests = tests;
+                CHECK(stats.nodeReuses == 0 && stats.primitiveReuses == 0);
+            }
+            else
+            {
+                CHECK(stats.nodeReuses + stats.primitiveReuses > 0);
+                CHECK(tests < fullCullTests);
+            }
+            if (step == CameraStep::Still)
+            {
+                // Only boxes within rounding distance of a plane are looked at again
+                CHECK(cache.GetChangedIndices().empty());
+                CHECK(tests * 20 < fullCullTests);
+            }
+        }
+    }
+}
+
+TEST_CASE(VisibilityCache, InvalidateAndCutThresholdsForceFullCulls)
+{
+    std::vector<AABB> boxes = MakeRandomBoxes(5000, 13);
+    BVH bvh;
+    bvh.Build(boxes.data(), boxes.size());
+
+    VisibilityCache cache;
+    cache.Initialize(bvh);
+    Camera camera;
+    AdvanceCamera(camera, 0);
+    cache.Update(camera);
+    CHECK(cache.GetStats().fullCull);
+
+    camera.MoveForward(0.5f);
+    cache.Update(camera);
+    CHECK(!cache.GetStats().fullCull);
+
+    cache.Invalidate();
+    cache.Update(camera);
+    CHECK(cache.GetStats().fullCull);
+
+    // With the thresholds below the step size every move counts as a cut
+    cache.SetCutThresholds(0.1f, 20.0f);
+    camera.MoveForward(0.5f);
+    cache.Update(camera);
+    CHECK(cache.GetStats().fullCull);
+
+    cache.SetCutThresholds(VisibilityCache::DEFAULT_CUT_DISTANCE, 0.1f);
+    camera.Rotate(0.5f, 0.0f);
+    cache.Update(camera);
+    CHECK(cache.GetStats().fullCull);
+
+    std::vector<uint32_t> visible;
+    cache.GetVisibleIndices(visible);
+    CHECK(visible == CullSorted(bvh, camera.GetFrustum()));
+}